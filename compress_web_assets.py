@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""
+Kompresja zasobów www (HTML/JS) w czasie budowania.
+
+Czyta literały R"rawliteral(...)rawliteral" z nagłówków include/*_html.h
+i include/common_js.h, kompresuje je gzipem i zapisuje do
+include/web_assets_gz.h jako tablice bajtów we flashu + ETag.
+
+Uruchamiany automatycznie przez PlatformIO (extra_scripts = pre:...),
+można też ręcznie: python3 compress_web_assets.py
+"""
+
+import gzip
+import hashlib
+import os
+import re
+
+# Nagłówek źródłowy -> nazwa symbolu w wygenerowanym pliku
+ASSETS = [
+    ("update_html.h", "update_html"),
+    ("dashboard_html.h", "dashboard_html"),
+    ("charts_html.h", "charts_html"),
+    ("network_config_html.h", "network_config_html"),
+    ("mcp3424_config_html.h", "mcp3424_config_html"),
+    ("common_js.h", "common_js"),
+]
+
+OUTPUT = "web_assets_gz.h"
+LITERAL_RE = re.compile(r'R"rawliteral\((.*?)\)rawliteral"', re.S)
+
+
+def extract_literal(path):
+    with open(path, "r", encoding="utf-8") as f:
+        text = f.read()
+    match = LITERAL_RE.search(text)
+    if not match:
+        raise ValueError("No rawliteral found in " + path)
+    return match.group(1).encode("utf-8")
+
+
+def format_bytes(data, indent="    ", per_line=16):
+    lines = []
+    for i in range(0, len(data), per_line):
+        chunk = data[i:i + per_line]
+        lines.append(indent + ", ".join("0x%02x" % b for b in chunk) + ",")
+    return "\n".join(lines)
+
+
+def generate(include_dir, force=False):
+    output_path = os.path.join(include_dir, OUTPUT)
+    sources = [os.path.join(include_dir, header) for header, _ in ASSETS]
+
+    # Bez zmian w źródłach - nie ruszaj pliku (brak rekompilacji web_server.cpp)
+    if not force and os.path.exists(output_path):
+        output_mtime = os.path.getmtime(output_path)
+        newest = max(os.path.getmtime(p) for p in sources)
+        if output_mtime >= newest:
+            return False
+
+    out = []
+    out.append("// Wygenerowane przez compress_web_assets.py - nie edytować ręcznie")
+    out.append("#ifndef WEB_ASSETS_GZ_H")
+    out.append("#define WEB_ASSETS_GZ_H")
+    out.append("")
+    out.append("#include <Arduino.h>")
+    out.append("")
+
+    total_raw = 0
+    total_gz = 0
+    for header, name in ASSETS:
+        raw = extract_literal(os.path.join(include_dir, header))
+        # mtime=0 - ten sam wynik przy każdym budowaniu (stabilny ETag)
+        packed = gzip.compress(raw, compresslevel=9, mtime=0)
+        etag = '\\"' + hashlib.sha1(raw).hexdigest()[:16] + '\\"'
+        total_raw += len(raw)
+        total_gz += len(packed)
+
+        out.append("// %s: %d -> %d bytes" % (header, len(raw), len(packed)))
+        out.append("const uint8_t %s_gz[] PROGMEM = {" % name)
+        if packed:
+            out.append(format_bytes(packed))
+        out.append("};")
+        out.append("const size_t %s_gz_len = %d;" % (name, len(packed)))
+        out.append('const char %s_etag[] = "%s";' % (name, etag))
+        out.append("")
+
+    out.append("#endif // WEB_ASSETS_GZ_H")
+    out.append("")
+
+    with open(output_path, "w", encoding="utf-8") as f:
+        f.write("\n".join(out))
+
+    print("Web assets: %d -> %d bytes gzip (%s)" % (total_raw, total_gz, OUTPUT))
+    return True
+
+
+try:
+    Import("env")  # noqa: F821 - dostępne tylko w PlatformIO/SCons
+except NameError:
+    generate(os.path.join(os.path.dirname(os.path.abspath(__file__)), "include"), force=True)
+else:
+    generate(os.path.join(env.subst("$PROJECT_DIR"), "include"))  # noqa: F821
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""
+Tabele rejestrów w Register_Map_Guide.md z tabeli deskryptorów firmware.
+
+Uruchamia host/modbus_map_doc (src/modbus_map.cpp zbudowany na Linuksie - instrukcja
+budowania w nagłówku pliku) i wstawia jego wyjście między znaczniki
+<!-- modbus-map:begin --> / <!-- modbus-map:end --> w dokumencie.
+
+    python3 gen_register_map.py --host-binary ./modbus_map_doc           # aktualizacja
+    python3 gen_register_map.py --host-binary ./modbus_map_doc --check   # CI: 1 = dokument nieaktualny
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+
+GUIDE = "Register_Map_Guide.md"
+BEGIN = "<!-- modbus-map:begin -->"
+END = "<!-- modbus-map:end -->"
+NOTE = "<!-- Generowane: python3 gen_register_map.py - nie edytować ręcznie -->"
+
+
+def render(host_binary):
+    result = subprocess.run([host_binary], check=True, stdout=subprocess.PIPE)
+    return result.stdout.decode("utf-8").strip() + "\n"
+
+
+def splice(text, tables):
+    start = text.find(BEGIN)
+    end = text.find(END)
+    if start < 0 or end < start:
+        raise ValueError("Brak znaczników " + BEGIN + " / " + END + " w " + GUIDE)
+    return text[:start] + BEGIN + "\n" + NOTE + "\n\n" + tables + "\n" + text[end:]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Tabele rejestrów Modbus z src/modbus_map.cpp")
+    parser.add_argument("--host-binary", required=True, help="zbudowany host/modbus_map_doc.cpp")
+    parser.add_argument("--check", action="store_true", help="tylko sprawdź, czy dokument jest aktualny")
+    args = parser.parse_args()
+
+    path = os.path.join(os.path.dirname(os.path.abspath(__file__)), GUIDE)
+    with open(path, "r", encoding="utf-8") as f:
+        text = f.read()
+
+    updated = splice(text, render(args.host_binary))
+    if updated == text:
+        print("✅ " + GUIDE + " zgodny z tabelą rejestrów")
+        return 0
+    if args.check:
+        print("❌ " + GUIDE + " nieaktualny - uruchom gen_register_map.py")
+        return 1
+
+    with open(path, "w", encoding="utf-8") as f:
+        f.write(updated)
+    print("✅ " + GUIDE + " zaktualizowany")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
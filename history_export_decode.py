@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""
+Dekoder binarnego eksportu historii (/api/history/export) dla ESP Sensor Cube
+Użycie: python history_export_decode.py IP_ADDRESS [--save history.eshx] [--csv KATALOG]
+        python history_export_decode.py --file history.eshx [--csv KATALOG]
+Format kontenera: HISTORY_CALCULATIONS.md ("Eksport binarny całej historii")
+"""
+
+import argparse
+import csv
+import os
+import struct
+import sys
+import time
+import urllib.request
+import zlib
+
+MAGIC = b"ESHX"
+END_MAGIC = b"ESHE"
+SUPPORTED_VERSION = 1
+HEADER = struct.Struct("<4sHHIB3xI")
+TRAILER = struct.Struct("<4sII")
+
+# Kod typu -> format struct
+FIELD_TYPES = {
+    1: "f", 2: "d", 3: "B", 4: "b", 5: "H", 6: "h",
+    7: "I", 8: "i", 9: "Q", 10: "q", 11: "?",
+}
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def take(self, fmt):
+        values = struct.unpack_from("<" + fmt, self.data, self.pos)
+        self.pos += struct.calcsize("<" + fmt)
+        return values if len(values) > 1 else values[0]
+
+    def name(self):
+        length = self.take("B")
+        text = self.data[self.pos:self.pos + length].decode("utf-8")
+        self.pos += length
+        return text
+
+
+def fetch(ip_address, timeout=30):
+    url = f"http://{ip_address}/api/history/export"
+    start = time.time()
+    with urllib.request.urlopen(url, timeout=timeout) as response:
+        data = response.read()
+    return data, time.time() - start
+
+
+def decode(data):
+    """Zwraca (info, streams); streams = lista słowników z rekordami"""
+    if len(data) < HEADER.size + TRAILER.size:
+        raise ValueError("Za krótki plik")
+
+    magic, version, stream_count, export_time, time_base, schema_length = HEADER.unpack_from(data, 0)
+    if magic != MAGIC:
+        raise ValueError(f"Nieznany format: {magic!r}")
+    if version != SUPPORTED_VERSION:
+        raise ValueError(f"Nieobsługiwana wersja: {version}")
+
+    end_magic, dropped, crc = TRAILER.unpack_from(data, len(data) - TRAILER.size)
+    if end_magic != END_MAGIC:
+        raise ValueError("Brak stopki - eksport przerwany?")
+    computed = zlib.crc32(data[:-4]) & 0xFFFFFFFF
+    if computed != crc:
+        raise ValueError(f"CRC32 niezgodne: {computed:08x} != {crc:08x}")
+
+    reader = Reader(data)
+    reader.pos = HEADER.size
+    streams = []
+    for _ in range(stream_count):
+        stream = {
+            "name": reader.name(),
+            "sampleType": "slow" if reader.take("B") else "fast",
+        }
+        stream["recordSize"], stream["count"], stream["firstSeq"], field_count = reader.take("HIIH")
+        stream["fields"] = []
+        for _ in range(field_count):
+            field_name = reader.name()
+            field_type, offset, count = reader.take("BHH")
+            if field_type not in FIELD_TYPES:
+                raise ValueError(f"{stream['name']}.{field_name}: nieznany typ {field_type}")
+            stream["fields"].append((field_name, FIELD_TYPES[field_type], offset, count))
+        streams.append(stream)
+    if reader.pos != HEADER.size + schema_length:
+        raise ValueError("Długość schematu niezgodna z nagłówkiem")
+
+    for stream in streams:
+        size = stream["recordSize"]
+        records = []
+        for i in range(stream["count"]):
+            base = reader.pos + i * size
+            timestamp = struct.unpack_from("<I", data, base)[0]
+            if timestamp == 0:
+                continue   # próbka nadpisana w trakcie eksportu
+            record = {"seq": stream["firstSeq"] + i, "timestamp": timestamp}
+            for field_name, fmt, offset, count in stream["fields"]:
+                values = struct.unpack_from(f"<{count}{fmt}", data, base + offset)
+                record[field_name] = values[0] if count == 1 else list(values)
+            records.append(record)
+        reader.pos += stream["count"] * size
+        stream["records"] = records
+
+    if reader.pos != len(data) - TRAILER.size:
+        raise ValueError("Długość danych niezgodna ze schematem")
+
+    info = {
+        "version": version,
+        "exportTime": export_time,
+        "timeBase": "epoch" if time_base else "uptime",
+        "dropped": dropped,
+        "size": len(data),
+    }
+    return info, streams
+
+
+def write_csv(streams, directory):
+    os.makedirs(directory, exist_ok=True)
+    for stream in streams:
+        if not stream["records"]:
+            continue
+        columns = ["seq", "timestamp"]
+        for field_name, _, _, count in stream["fields"]:
+            columns += [field_name] if count == 1 else [f"{field_name}[{i}]" for i in range(count)]
+        path = os.path.join(directory, f"{stream['name']}_{stream['sampleType']}.csv")
+        with open(path, "w", newline="") as f:
+            writer = csv.writer(f)
+            writer.writerow(columns)
+            for record in stream["records"]:
+                row = [record["seq"], record["timestamp"]]
+                for field_name, _, _, count in stream["fields"]:
+                    value = record[field_name]
+                    row += [value] if count == 1 else value
+                writer.writerow(row)
+        print(f"💾 {path}: {len(stream['records'])} wierszy")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="ESP32 history export decoder")
+    parser.add_argument("ip", nargs="?", help="Adres IP urządzenia")
+    parser.add_argument("--file", help="Dekodowanie zapisanego pliku zamiast pobierania")
+    parser.add_argument("--save", help="Zapis surowego kontenera do pliku")
+    parser.add_argument("--csv", help="Katalog na pliki CSV (jeden na strumień)")
+    args = parser.parse_args()
+
+    if not args.ip and not args.file:
+        parser.error("Podaj IP albo --file")
+
+    try:
+        if args.file:
+            with open(args.file, "rb") as f:
+                data, elapsed = f.read(), 0.0
+        else:
+            data, elapsed = fetch(args.ip)
+            rate = len(data) / 1024 / elapsed if elapsed > 0 else 0
+            print(f"📥 {len(data)} B w {elapsed * 1000:.0f} ms ({rate:.0f} kB/s)")
+        if args.save:
+            with open(args.save, "wb") as f:
+                f.write(data)
+        info, streams = decode(data)
+    except Exception as e:
+        print(f"❌ {e}")
+        sys.exit(1)
+
+    print(f"✅ Wersja {info['version']}, czas eksportu {info['exportTime']} ({info['timeBase']}), "
+          f"{len(streams)} strumieni, nadpisane w trakcie: {info['dropped']}")
+    for stream in streams:
+        records = stream["records"]
+        span = f"{records[0]['timestamp']}..{records[-1]['timestamp']}" if records else "-"
+        print(f"  {stream['name']:<12} {stream['sampleType']:<5} {len(records):>5} rekordów "
+              f"x {stream['recordSize']} B, seq od {stream['firstSeq']}, czas {span}")
+
+    if args.csv:
+        write_csv(streams, args.csv)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,167 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Minimalne API Arduino/ESP32 dla buildów hostowych (Linux) - tylko to, czego używają moduły
+// Modbus kompilowane w host/modbus_rtu_host.cpp. Czas z zegara monotonicznego, Serial2 na
+// deskryptorze pliku (pty) z emulacją zdarzenia UART RX timeout.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+typedef uint8_t byte;
+
+#define HEX 16
+#define DEC 10
+#define SERIAL_8N1 0x800001c
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+bool getLocalTime(struct tm* info, uint32_t ms = 5000);
+
+// ===== String =====
+class String : public std::string {
+public:
+    String() {}
+    String(const char* s) : std::string(s ? s : "") {}
+    String(const std::string& s) : std::string(s) {}
+    explicit String(char c) : std::string(1, c) {}
+    String(int value, unsigned char base = DEC) : std::string(format(base == HEX ? "%x" : "%d", value)) {}
+    String(unsigned int value, unsigned char base = DEC) : std::string(format(base == HEX ? "%x" : "%u", value)) {}
+    String(long value, unsigned char base = DEC) : std::string(format(base == HEX ? "%lx" : "%ld", value)) {}
+    String(unsigned long value, unsigned char base = DEC) : std::string(format(base == HEX ? "%lx" : "%lu", value)) {}
+    String(unsigned char value, unsigned char base = DEC) : String((unsigned int)value, base) {}
+    String(short value, unsigned char base = DEC) : String((int)value, base) {}
+    String(unsigned short value, unsigned char base = DEC) : String((unsigned int)value, base) {}
+    String(long long value) : std::string(std::to_string(value)) {}
+    String(unsigned long long value) : std::string(std::to_string(value)) {}
+    String(double value, unsigned int decimals = 2) : std::string(formatFloat(value, decimals)) {}
+    String(float value, unsigned int decimals = 2) : std::string(formatFloat(value, decimals)) {}
+
+    unsigned int length() const { return (unsigned int)size(); }
+    bool reserve(unsigned int n) { std::string::reserve(n); return true; }
+    bool concat(const String& s) { append(s); return true; }
+    bool concat(const char* s, unsigned int length) { append(s, length); return true; }
+    long toInt() const { return atol(c_str()); }
+    float toFloat() const { return (float)atof(c_str()); }
+    bool equals(const String& s) const { return *this == s; }
+    bool startsWith(const String& s) const { return compare(0, s.size(), s) == 0; }
+    bool endsWith(const String& s) const { return size() >= s.size() && compare(size() - s.size(), s.size(), s) == 0; }
+    int indexOf(char c, unsigned int from = 0) const { size_t p = find(c, from); return p == npos ? -1 : (int)p; }
+    int indexOf(const String& s, unsigned int from = 0) const { size_t p = find(s, from); return p == npos ? -1 : (int)p; }
+    String substring(unsigned int from) const { return from < size() ? String(substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const { return from < size() && to > from ? String(substr(from, to - from)) : String(); }
+    void toUpperCase() { for (size_t i = 0; i < size(); i++) (*this)[i] = toupper((*this)[i]); }
+    void toLowerCase() { for (size_t i = 0; i < size(); i++) (*this)[i] = tolower((*this)[i]); }
+    void trim() {
+        size_t first = find_first_not_of(" \t\r\n");
+        size_t last = find_last_not_of(" \t\r\n");
+        *this = first == npos ? String() : String(substr(first, last - first + 1));
+    }
+
+    String& operator+=(const String& s) { append(s); return *this; }
+    String& operator+=(const char* s) { if (s) append(s); return *this; }
+    String& operator+=(char c) { push_back(c); return *this; }
+
+private:
+    template<typename T>
+    static std::string format(const char* fmt, T value) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), fmt, value);
+        return buffer;
+    }
+    static std::string formatFloat(double value, unsigned int decimals) {
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, value);
+        return buffer;
+    }
+};
+
+inline String operator+(const String& a, const String& b) { String s(a); s += b; return s; }
+inline String operator+(const String& a, const char* b) { String s(a); s += b; return s; }
+inline String operator+(const char* a, const String& b) { String s(a); s += b; return s; }
+inline String operator+(const String& a, char b) { String s(a); s += b; return s; }
+
+// ===== Serial =====
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t value) = 0;
+    virtual size_t write(const uint8_t* data, size_t length) {
+        size_t written = 0;
+        while (length--) written += write(*data++);
+        return written;
+    }
+    size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.size()); }
+    size_t println(const String& s) { return print(s) + print("\r\n"); }
+    size_t println() { return print("\r\n"); }
+};
+
+typedef void (*OnReceiveCb)(void);
+
+// Port na deskryptorze pliku (host: strona master pty). Wątek odbioru zbiera bajty i po ciszy
+// na linii dłuższej niż setRxTimeout() symboli wywołuje callback onReceive - jak zdarzenie
+// UART_RX_TIMEOUT w arduino-esp32. Bez deskryptora port jest konsolą (stdout) albo pusty.
+class HardwareSerial : public Print {
+public:
+    explicit HardwareSerial(int console = -1);
+    ~HardwareSerial();
+
+    void attach(int fd);                                    // tylko host - przed begin()
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1);
+    void end();
+    int available();
+    int read();
+    size_t write(uint8_t value);
+    size_t write(const uint8_t* data, size_t length);
+    void flush() {}
+    void setTimeout(unsigned long) {}
+    bool setRxTimeout(uint8_t symbols);
+    void onReceive(OnReceiveCb callback, bool onlyOnTimeout = false);
+
+private:
+    void receiveLoop();
+
+    int console;
+    int fd;
+    unsigned long baud;
+    uint8_t rxTimeoutSymbols;
+    std::atomic<OnReceiveCb> callback;
+    std::mutex rxMutex;
+    std::deque<uint8_t> rx;
+    std::thread receiver;
+    std::atomic<bool> running;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+
+// ===== ESP =====
+class EspClass {
+public:
+    uint32_t getCycleCount();                               // 240 MHz z zegara monotonicznego
+    uint32_t getFreeHeap() { return 256 * 1024; }
+    uint32_t getMinFreeHeap() { return 192 * 1024; }
+    uint32_t getMaxAllocHeap() { return 128 * 1024; }
+    uint32_t getPsramSize() { return 0; }
+    uint32_t getFreePsram() { return 0; }
+    void restart() { exit(0); }
+};
+
+extern EspClass ESP;
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,41 @@
+#ifndef HOST_ARDUINOJSON_H
+#define HOST_ARDUINOJSON_H
+
+// Typy ArduinoJson 6 bez dokumentu - zapis jest ignorowany. Build hostowy Modbus nie publikuje
+// JSON (mapa getModbusMap, pliki historii), a nie wymaga wtedy biblioteki z libdeps PlatformIO.
+
+#include <Arduino.h>
+
+class JsonObject;
+class JsonArray;
+
+class JsonVariant {
+public:
+    template<typename T> JsonVariant& operator=(const T&) { return *this; }
+    JsonVariant operator[](const char*) { return JsonVariant(); }
+    JsonObject createNestedObject(const char* key = NULL);
+    JsonArray createNestedArray(const char* key = NULL);
+    template<typename T> bool add(const T&) { return true; }
+    template<typename T> T as() const { return T(); }
+    bool isNull() const { return true; }
+};
+
+class JsonObject : public JsonVariant {
+public:
+    using JsonVariant::operator=;
+};
+
+class JsonArray : public JsonVariant {
+public:
+    using JsonVariant::operator=;
+};
+
+inline JsonObject JsonVariant::createNestedObject(const char*) { return JsonObject(); }
+inline JsonArray JsonVariant::createNestedArray(const char*) { return JsonArray(); }
+
+class JsonDocument : public JsonObject {
+public:
+    template<typename T> T as() { return T(); }
+};
+
+#endif // HOST_ARDUINOJSON_H
@@ -0,0 +1,35 @@
+#ifndef HOST_MODBUS_SERIAL_H
+#define HOST_MODBUS_SERIAL_H
+
+// Magazyn rejestrów jak w bibliotece ModbusSerial (epsilonrt) - bez obsługi ramek: na hoście
+// ramki obsługuje wyłącznie task RTU z modbus_handler.cpp (modbus_pdu.cpp)
+
+#include <Arduino.h>
+#include <map>
+
+class ModbusSerial {
+public:
+    ModbusSerial(HardwareSerial& port, uint8_t slaveId, int txenPin = -1) : slaveId(slaveId) {}
+
+    bool config(unsigned long baud) { return true; }
+    void setSlaveId(uint8_t id) { slaveId = id; }
+    uint8_t getSlaveId() { return slaveId; }
+    bool addHreg(uint16_t offset, uint16_t value = 0) { registers[offset] = value; return true; }
+    bool setHreg(uint16_t offset, uint16_t value) {
+        std::map<uint16_t, uint16_t>::iterator it = registers.find(offset);
+        if (it == registers.end()) return false;
+        it->second = value;
+        return true;
+    }
+    uint16_t hreg(uint16_t offset) {
+        std::map<uint16_t, uint16_t>::iterator it = registers.find(offset);
+        return it == registers.end() ? 0 : it->second;
+    }
+    void task() {}
+
+private:
+    uint8_t slaveId;
+    std::map<uint16_t, uint16_t> registers;
+};
+
+#endif // HOST_MODBUS_SERIAL_H
@@ -0,0 +1,48 @@
+#ifndef HOST_OPCN3_H
+#define HOST_OPCN3_H
+
+// Pola HistogramData jak w lib/opcn3-arduino-master (models/HistogramData.h), bez SPI
+
+#include <Arduino.h>
+
+struct HistogramData {
+    uint16_t binCounts[24];
+
+    uint8_t bin1TimeToCross;
+    uint8_t bin3TimeToCross;
+    uint8_t bin5TimeToCross;
+    uint8_t bin7TimeToCross;
+
+    uint16_t samplingPeriod;
+    uint16_t sampleFlowRate;
+    uint16_t temperature;
+    uint16_t humidity;
+
+    float pm1;
+    float pm2_5;
+    float pm10;
+
+    uint16_t rejectCountGlitch;
+    uint16_t rejectCountLongTOF;
+    uint16_t rejectCountRatio;
+    uint16_t rejectCountOutOfRange;
+    uint16_t fanRevCount;
+    uint16_t laserStatus;
+    uint16_t checkSum;
+    bool valid;
+
+    float getTempC() { return -45 + 175 * (temperature / 65535.0f); }
+    float getHumidity() { return 100 * (humidity / 65535.0f); }
+};
+
+class OPCN3 {
+public:
+    OPCN3(uint8_t pinSelect, uint32_t speedSelect = 500000) {}
+    void begin() {}
+    HistogramData readHistogramData() {
+        HistogramData data = {};
+        return data;
+    }
+};
+
+#endif // HOST_OPCN3_H
@@ -0,0 +1,6 @@
+#ifndef HOST_SENSIRION_I2C_SCD4X_H
+#define HOST_SENSIRION_I2C_SCD4X_H
+
+// Sterownik Sensirion SCD4x - na hoście tylko nagłówek (i2c_sensors.h), dane SCD41 z danych testowych
+
+#endif // HOST_SENSIRION_I2C_SCD4X_H
@@ -0,0 +1,237 @@
+// Implementacja API z host/arduino - czas, Serial na deskryptorze (pty), taski FreeRTOS na wątkach
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <chrono>
+#include <condition_variable>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
+// ===== Czas =====
+
+static const std::chrono::steady_clock::time_point hostStart = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - hostStart).count();
+}
+
+unsigned long micros() {
+    // 32-bit jak na ESP32 - przepełnienie po ~71 min
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - hostStart).count();
+}
+
+void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+bool getLocalTime(struct tm* info, uint32_t ms) {
+    // Zegar RTC niezsynchronizowany - jak ESP32 bez NTP
+    return false;
+}
+
+uint32_t EspClass::getCycleCount() {
+    return (uint32_t)(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - hostStart).count() * 240 / 1000);
+}
+
+EspClass ESP;
+TwoWire Wire;
+
+// ===== HardwareSerial =====
+
+HardwareSerial Serial(STDOUT_FILENO);
+HardwareSerial Serial1;
+HardwareSerial Serial2;
+
+HardwareSerial::HardwareSerial(int console)
+    : console(console), fd(-1), baud(9600), rxTimeoutSymbols(2), callback(NULL), running(false) {}
+
+HardwareSerial::~HardwareSerial() {
+    end();
+}
+
+void HardwareSerial::attach(int descriptor) {
+    fd = descriptor;
+}
+
+void HardwareSerial::begin(unsigned long baudRate, uint32_t config, int8_t rxPin, int8_t txPin) {
+    baud = baudRate;
+    if (fd < 0 || running) return;
+    running = true;
+    receiver = std::thread(&HardwareSerial::receiveLoop, this);
+}
+
+void HardwareSerial::end() {
+    if (!running) return;
+    running = false;
+    receiver.join();
+}
+
+int HardwareSerial::available() {
+    std::lock_guard<std::mutex> guard(rxMutex);
+    return (int)rx.size();
+}
+
+int HardwareSerial::read() {
+    std::lock_guard<std::mutex> guard(rxMutex);
+    if (rx.empty()) return -1;
+    uint8_t value = rx.front();
+    rx.pop_front();
+    return value;
+}
+
+size_t HardwareSerial::write(uint8_t value) {
+    return write(&value, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* data, size_t length) {
+    int target = fd >= 0 ? fd : console;
+    if (target < 0) return length;
+
+    size_t written = 0;
+    while (written < length) {
+        ssize_t n = ::write(target, data + written, length - written);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            break;
+        }
+        written += n;
+    }
+    return written;
+}
+
+bool HardwareSerial::setRxTimeout(uint8_t symbols) {
+    rxTimeoutSymbols = symbols;
+    return true;
+}
+
+void HardwareSerial::onReceive(OnReceiveCb function, bool onlyOnTimeout) {
+    callback = function;
+}
+
+// Koniec ramki = brak bajtów przez rxTimeoutSymbols znaków (10 bitów na znak w 8N1)
+void HardwareSerial::receiveLoop() {
+    bool pending = false;
+    uint8_t buffer[256];
+
+    while (running) {
+        long gapMicros = (long)std::max<uint8_t>(rxTimeoutSymbols, 1) * 10 * 1000000L / (long)baud;
+        struct timespec timeout;
+        timeout.tv_sec = 0;
+        timeout.tv_nsec = (pending ? gapMicros : 100000L) * 1000L;
+
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        int ready = ppoll(&pfd, 1, &timeout, NULL);
+        if (ready > 0 && (pfd.revents & POLLIN)) {
+            ssize_t n = ::read(fd, buffer, sizeof(buffer));
+            if (n > 0) {
+                std::lock_guard<std::mutex> guard(rxMutex);
+                rx.insert(rx.end(), buffer, buffer + n);
+                pending = true;
+                continue;
+            }
+        }
+        if (ready > 0) {
+            // Druga strona pty zamknięta (POLLHUP) - bez aktywnego czekania
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        if (ready == 0 && pending) {
+            pending = false;
+            OnReceiveCb function = callback;
+            if (function) function();
+        }
+    }
+}
+
+// ===== Taski FreeRTOS =====
+
+struct HostTask {
+    std::mutex lock;
+    std::condition_variable wake;
+    uint32_t notifications;
+    std::string name;
+    uint32_t stackDepth;
+};
+
+static thread_local HostTask* currentTask = NULL;
+static std::mutex tasksLock;
+static std::vector<HostTask*> tasks;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth, void* parameter,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+    HostTask* task = new HostTask();
+    task->notifications = 0;
+    task->name = name ? name : "";
+    task->stackDepth = stackDepth;
+    if (handle) *handle = task;
+    {
+        std::lock_guard<std::mutex> guard(tasksLock);
+        tasks.push_back(task);
+    }
+
+    std::thread thread([task, function, parameter]() {
+        currentTask = task;
+        function(parameter);
+    });
+    thread.detach();
+    return pdPASS;
+}
+
+void xTaskNotifyGive(TaskHandle_t task) {
+    std::lock_guard<std::mutex> guard(task->lock);
+    task->notifications++;
+    task->wake.notify_one();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) {
+    HostTask* task = currentTask;
+    if (task == NULL) {
+        vTaskDelay(ticksToWait);
+        return 0;
+    }
+
+    std::unique_lock<std::mutex> guard(task->lock);
+    task->wake.wait_for(guard, std::chrono::milliseconds(ticksToWait), [task]() { return task->notifications > 0; });
+    uint32_t value = task->notifications;
+    if (value > 0) task->notifications = clearOnExit ? 0 : value - 1;
+    return value;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)millis();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    if (currentTask == NULL) {
+        currentTask = new HostTask();
+        currentTask->notifications = 0;
+        currentTask->stackDepth = 0;
+    }
+    return currentTask;
+}
+
+TaskHandle_t xTaskGetHandle(const char* name) {
+    std::lock_guard<std::mutex> guard(tasksLock);
+    for (HostTask* task : tasks) {
+        if (task->name == name) return task;
+    }
+    return NULL;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    return task ? task->stackDepth : 0;
+}
@@ -0,0 +1,6 @@
+#ifndef HOST_SPS30_H
+#define HOST_SPS30_H
+
+// Sterownik Sensirion SPS30 - na hoście dane SPS30 pochodzą z symulacji
+
+#endif // HOST_SPS30_H
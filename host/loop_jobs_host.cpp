@@ -0,0 +1,120 @@
+// Hostowy test zadań loop() (Linux) - src/loop_jobs.cpp i src/scheduler.cpp bez zmian, funkcje
+// czujników/Modbus/historii jako liczniki wywołań. Sprawdza to, co robi koniec setup():
+// registerLoopJobs() rejestruje komplet zadań, a planista w loop() faktycznie je uruchamia.
+//
+// Build:  g++ -std=gnu++11 -O2 -pthread -Ihost/arduino -Iinclude host/loop_jobs_host.cpp
+//             host/arduino/arduino_host.cpp src/loop_jobs.cpp src/scheduler.cpp -o loop_jobs_host   (jedna linia)
+// Start:  ./loop_jobs_host                  (kod wyjścia 1 = brak zadania lub zadanie nie ruszyło)
+
+#include <Arduino.h>
+#include <loop_jobs.h>
+#include <scheduler.h>
+#include <config.h>
+#include <sensors.h>
+#include <calib.h>
+
+// ===== Środowisko firmware - wywołania zliczane =====
+
+FeatureConfig config;
+bool solarSensorStatus = false;
+bool opcn3SensorStatus = false;
+bool i2cSensorStatus = false;
+bool sht40SensorStatus = false;
+bool ipsSensorStatus = false;
+bool mcp3424SensorStatus = true;
+unsigned long lastModbusActivity = 0;
+bool hasHadModbusActivity = false;
+
+static int solarReads = 0;
+static int mcp3424Reads = 0;
+static int calibrations = 0;
+static int modbusUpdates = 0;
+static int serialCommands = 0;
+static int averages = 0;
+static int historyUpdates = 0;
+static int telemetryUpdates = 0;
+
+void safePrint(const String& message) { fputs(message.c_str(), stderr); }
+void safePrintln(const String& message) { fprintf(stderr, "%s\n", message.c_str()); }
+bool isSerialAvailable() { return false; }
+
+void readSolarSensor() { solarReads++; }
+void readOPCN3Sensor() {}
+bool readHCHO() { return false; }
+void readIPSSensor() {}
+void readMCP3424Sensor() { mcp3424Reads++; }
+void performCalibration() { calibrations++; }
+void readI2CSensors() {}
+void readSPS30Sensor() {}
+void readBatteryVoltage() {}
+void retryFailedI2CSensors() {}
+void updateBatteryStatus() {}
+void checkBatteryShutdown() {}
+void readSerialSensors() {}
+void updateFanRPM() {}
+void processModbusTask() {}
+void updateModbusRegisters() { modbusUpdates++; }
+void processSerialCommands() { serialCommands++; }
+void updateSystemStatus() {}
+void updateMovingAverages() { averages++; }
+void updateSensorHistory() { historyUpdates++; }
+void updateTelemetrySnapshot() { telemetryUpdates++; }
+void printMovingAverageStatus() {}
+void printHistoryMemoryUsage() {}
+void printHistoryStatus() {}
+
+// Komplet zadań z registerLoopJobs() - brak któregokolwiek = regresja (loop() bez tej pracy)
+static const char* const expectedJobs[] = {
+    "solar", "ips", "opcn3", "hcho", "mcp3424", "i2c", "sps30", "battery", "i2c_retry",
+    "battery_status", "serial_sensors", "fan", "modbus", "serial_commands", "system_status",
+    "moving_averages", "history", "telemetry", "auto_reset"
+};
+
+static int failures = 0;
+
+static void check(bool condition, const String& message) {
+    printf("%s %s\n", condition ? "✅" : "❌", message.c_str());
+    if (!condition) failures++;
+}
+
+static bool jobStats(const char* name, SchedulerJobStats& stats) {
+    for (size_t i = 0; getSchedulerJobStats(i, stats); i++) {
+        if (strcmp(stats.name, name) == 0) return true;
+    }
+    return false;
+}
+
+int main() {
+    config.autoReset = false;
+
+    // Koniec setup()
+    size_t registered = registerLoopJobs();
+    size_t expected = sizeof(expectedJobs) / sizeof(expectedJobs[0]);
+    check(registered == getSchedulerJobCount(), "registerLoopJobs() zwraca liczbę zadań planisty");
+    check(registered == expected, "Zarejestrowane zadania: " + String((unsigned)registered) + " (oczekiwane " +
+                                  String((unsigned)expected) + ", limit " + String(SCHEDULER_MAX_JOBS) + ")");
+    SchedulerJobStats stats;
+    for (const char* name : expectedJobs) {
+        check(jobStats(name, stats), String("Zadanie ") + name);
+    }
+
+    // loop(): ~1,2 s przebiegów planisty
+    unsigned long start = millis();
+    while (millis() - start < 1200) {
+        runSchedulerJobs();
+        sleepUntilNextSchedulerJob();
+    }
+
+    check(solarReads >= 50, "solar co 20 ms: " + String(solarReads));
+    check(modbusUpdates >= 20, "Banki Modbus (updateModbusRegisters) co 50 ms: " + String(modbusUpdates));
+    check(serialCommands >= 20, "Komendy serial co 50 ms: " + String(serialCommands));
+    check(telemetryUpdates >= 10, "Snapshot telemetrii co 100 ms: " + String(telemetryUpdates));
+    check(mcp3424Reads >= 1 && calibrations == mcp3424Reads, "MCP3424 + kalibracja: " + String(mcp3424Reads));
+    check(historyUpdates >= 1, "Historia (start po 500 ms): " + String(historyUpdates));
+    check(averages == 0, "Średnie dopiero po 5 s: " + String(averages));
+
+    printf(failures ? "❌ Błędy: %d\n" : "✅ Wszystkie testy OK\n", failures);
+    fflush(stdout);
+    // Wątek RX Serial1 (shim) odłączony - wyjście bez destruktorów
+    _Exit(failures ? 1 : 0);
+}
@@ -0,0 +1,352 @@
+// Hostowy render /metrics (Linux) - src/metrics.cpp i src/sensor_fields.cpp bez zmian, stałe dane
+// czujników i statystyki modułów zamiast firmware. Wynik renderMetrics() na stdout - do walidacji
+// parserem OpenMetrics (test_metrics.py --host-binary) bez płytki.
+//
+// Build:  g++ -std=gnu++11 -O2 -pthread -Ihost/arduino -Iinclude host/metrics_host.cpp
+//             host/arduino/arduino_host.cpp src/metrics.cpp src/sensor_fields.cpp -o metrics_host   (jedna linia)
+// Start:  ./metrics_host [--scrapes N]      (N renderów jeden po drugim, na stdout ostatni)
+//
+// Kod wyjścia 1 gdy renderMetrics() odmówi (bufor zajęty / przepełniony). Logi (safePrintln) na stderr.
+
+#include <Arduino.h>
+#include <metrics.h>
+#include <sensors.h>
+#include <calib.h>
+#include <mean.h>
+#include <fan.h>
+#include <config.h>
+#include <modbus_handler.h>
+#include <modbus_tcp.h>
+#include <scheduler.h>
+#include <i2c_bus.h>
+#include <i2c_sensors.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// ===== Środowisko firmware (main.cpp, sensors, mean, web_socket, modbus_handler) =====
+
+FeatureConfig config;
+MCP3424Config mcp3424Config;
+CalibratedSensorData calibratedData;
+
+SolarData solarData;
+I2CSensorData i2cSensorData;
+IPSSensorData ipsSensorData;
+MCP3424Data mcp3424Data;
+ADS1110Data ads1110Data;
+INA219Data ina219Data;
+SPS30Data sps30Data;
+SHT40Data sht40Data;
+HCHOData hchoData;
+BatteryData batteryData;
+
+bool solarSensorStatus = true;
+bool opcn3SensorStatus = false;
+bool i2cSensorStatus = true;
+bool sht40SensorStatus = true;
+bool sps30SensorStatus = true;
+bool mcp3424SensorStatus = true;
+bool ads1110SensorStatus = true;
+bool ina219SensorStatus = true;
+bool ipsSensorStatus = true;
+bool hchoSensorStatus = false;
+
+int wsClientCount = 2;
+unsigned long lastModbusActivity = 0;
+bool hasHadModbusActivity = true;
+
+uint32_t modbusRxEvents = 1200;
+uint32_t modbusCommandsExecuted = 3;
+uint32_t modbusCommandErrors = 1;
+uint32_t modbusRtuCrcErrors = 2;
+uint32_t modbusRtuFrameErrors = 0;
+
+void safePrint(const String& message) {
+    fputs(message.c_str(), stderr);
+}
+
+void safePrintln(const String& message) {
+    fprintf(stderr, "%s\n", message.c_str());
+}
+
+// Średnie = bieżące dane (fast) i dane z przesunięciem (slow) - inne wartości w obu oknach
+SolarData getSolarFastAverage() { return solarData; }
+I2CSensorData getI2CFastAverage() { return i2cSensorData; }
+SPS30Data getSPS30FastAverage() { return sps30Data; }
+IPSSensorData getIPSFastAverage() { return ipsSensorData; }
+MCP3424Data getMCP3424FastAverage() { return mcp3424Data; }
+ADS1110Data getADS1110FastAverage() { return ads1110Data; }
+INA219Data getINA219FastAverage() { return ina219Data; }
+SHT40Data getSHT40FastAverage() { return sht40Data; }
+HCHOData getHCHOFastAverage() { return hchoData; }
+CalibratedSensorData getCalibratedFastAverage() { return calibratedData; }
+
+SolarData getSolarSlowAverage() { return solarData; }
+I2CSensorData getI2CSlowAverage() {
+    I2CSensorData data = i2cSensorData;
+    data.temperature -= 0.4f;
+    return data;
+}
+SPS30Data getSPS30SlowAverage() {
+    SPS30Data data = sps30Data;
+    data.pm2_5 += 1.5f;
+    return data;
+}
+IPSSensorData getIPSSlowAverage() { return ipsSensorData; }
+MCP3424Data getMCP3424SlowAverage() { return mcp3424Data; }
+ADS1110Data getADS1110SlowAverage() { return ads1110Data; }
+INA219Data getINA219SlowAverage() { return ina219Data; }
+SHT40Data getSHT40SlowAverage() { return sht40Data; }
+HCHOData getHCHOSlowAverage() { return hchoData; }
+CalibratedSensorData getCalibratedSlowAverage() { return calibratedData; }
+
+uint8_t getFanDutyCycle() { return 40; }
+uint16_t getFanRPM() { return 1830; }
+
+// ===== Statystyki modułów =====
+
+static const SchedulerJobStats schedulerJobs[] = {
+    // name, periodMs, runs, overruns, skipped, wakes, jitterLast, jitterMax, jitterAvg, cpuLast, cpuMax, cpuTotal
+    {"modbus", 10, 60000, 2, 3, 150, 40, 900, 35.5f, 120, 2100, 7200000ULL},
+    {"solar", 20, 30000, 0, 0, 0, 25, 400, 20.0f, 60, 800, 1800000ULL},
+    {"ips", 1000, 600, 0, 0, 580, 10, 200, 8.0f, 300, 1500, 180000ULL},
+};
+
+size_t getSchedulerJobCount() { return sizeof(schedulerJobs) / sizeof(schedulerJobs[0]); }
+
+bool getSchedulerJobStats(size_t index, SchedulerJobStats& stats) {
+    if (index >= getSchedulerJobCount()) return false;
+    stats = schedulerJobs[index];
+    return true;
+}
+
+uint64_t getSchedulerSleepMicros() { return 523000000ULL; }
+
+I2CBusStats getI2CBusStats() {
+    I2CBusStats stats;
+    memset(&stats, 0, sizeof(stats));
+    stats.transactions = 48000;
+    stats.errors = 12;
+    stats.batches = 30000;
+    stats.maxBatch = 5;
+    stats.queueFull = 1;
+    stats.busMicros = 31000000ULL;
+    return stats;
+}
+
+float getI2CBusUtilization() { return 0.052f; }
+
+static const I2CDeviceStats i2cDevices[] = {
+    // address, transactions, errors, latencyLast, latencyMax, latencyAvg, busMicros
+    {0x44, 6000, 0, 10400, 12100, 10350.0f, 2400000ULL},
+    {0x62, 1200, 3, 5200, 9000, 5100.0f, 900000ULL},
+    {0x68, 20400, 9, 300, 4100, 280.0f, 12000000ULL},
+};
+
+size_t getI2CDeviceCount() { return sizeof(i2cDevices) / sizeof(i2cDevices[0]); }
+
+bool getI2CDeviceStats(size_t index, I2CDeviceStats& stats) {
+    if (index >= getI2CDeviceCount()) return false;
+    stats = i2cDevices[index];
+    return true;
+}
+
+uint8_t getMCP3424DeviceCount() { return mcp3424Data.deviceCount; }
+
+bool getMCP3424DeviceStats(uint8_t device, MCP3424DeviceStats& stats) {
+    if (device >= mcp3424Data.deviceCount) return false;
+    memset(&stats, 0, sizeof(stats));
+    stats.address = mcp3424Data.addresses[device];
+    stats.conversions = 4000 + device;
+    stats.notReady = 900;
+    stats.timeouts = device;
+    stats.errors = device * 2;
+    stats.cycles = 1000;
+    stats.lastCycleMicros = 1070000;
+    return true;
+}
+
+static const ModbusBankStats modbusBanks[] = {
+    {"solar", 100, 5900, 1800},
+    {"i2c", 600, 5400, 2400},
+    {"mcp3424", 3000, 3000, 5200},
+};
+
+bool getModbusBankStats(size_t index, ModbusBankStats& stats) {
+    if (index >= sizeof(modbusBanks) / sizeof(modbusBanks[0])) return false;
+    stats = modbusBanks[index];
+    return true;
+}
+
+uint32_t getModbusCyclesSavedPerLoop() { return 14200; }
+
+void getModbusImageStats(ModbusImageStats& stats) {
+    stats.publishes = 3700;
+    stats.words = 51000;
+    stats.maxLockCycles = 9100;
+}
+
+bool getModbusShadowStats(DataType type, ModbusShadowStats& stats) {
+    // Obraz "slow" jeszcze nie czytany - jak na urządzeniu bez mastera dla tego typu
+    if (type == DATA_SLOW_AVG) return false;
+    stats.allocated = true;
+    stats.activeBanks = type == DATA_CURRENT ? 3 : 1;
+    stats.refreshes = 420;
+    stats.reads = 800;
+    return true;
+}
+
+void getModbusLatencyStats(ModbusLatencyStats& stats) {
+    stats.samples = 256;
+    stats.p50 = 310;
+    stats.p90 = 480;
+    stats.p99 = 1250;
+    stats.max = 2900;
+    stats.frames = 12000;
+    stats.eventDriven = true;
+}
+
+void getModbusTcpStats(ModbusTcpStats& stats) {
+    memset(&stats, 0, sizeof(stats));
+    stats.clients = 1;
+    stats.connections = 4;
+    stats.requests = 5100;
+    stats.exceptions = 2;
+}
+
+// ===== Dane czujników =====
+
+static void fillSensorData() {
+    unsigned long now = millis();
+
+    solarData.V = "13250";
+    solarData.I = "-120";
+    solarData.PPV = "";                // pusty tekst VE.Direct - pole pomijane w metrykach
+    solarData.valid = true;
+
+    i2cSensorData.temperature = 21.5f;
+    i2cSensorData.humidity = 45.0f;
+    i2cSensorData.co2 = 612.0f;
+    i2cSensorData.type = SENSOR_SCD41;
+    i2cSensorData.valid = true;
+    i2cSensorData.lastUpdate = now;
+
+    sht40Data.temperature = 21.2f;
+    sht40Data.humidity = 46.0f;
+    sht40Data.pressure = 1013.2f;
+    sht40Data.valid = true;
+    sht40Data.lastUpdate = now;
+
+    sps30Data.pm1_0 = 3.0f;
+    sps30Data.pm2_5 = 5.5f;
+    sps30Data.pm4_0 = 6.1f;
+    sps30Data.pm10 = NAN;              // NaN w OpenMetrics
+    sps30Data.nc0_5 = 20.0f;
+    sps30Data.nc1_0 = 25.0f;
+    sps30Data.nc2_5 = 27.0f;
+    sps30Data.nc4_0 = 28.0f;
+    sps30Data.nc10 = 28.5f;
+    sps30Data.typical_particle_size = 0.6f;
+    sps30Data.valid = true;
+    sps30Data.lastUpdate = now;
+
+    for (int i = 0; i < 7; i++) {
+        ipsSensorData.pc_values[i] = 1000 * (7 - i);
+        ipsSensorData.pm_values[i] = 0.5f * (i + 1);
+        ipsSensorData.np_values[i] = i;
+        ipsSensorData.pw_values[i] = 10 * i;
+    }
+    ipsSensorData.valid = true;
+    ipsSensorData.lastUpdate = now;
+
+    // Dwie płytki, druga nieważna (błąd odczytu) - jej kanały nie trafiają do metryk
+    mcp3424Data.deviceCount = 2;
+    mcp3424Data.resolution = 18;
+    mcp3424Data.gain = 1;
+    for (uint8_t device = 0; device < 2; device++) {
+        mcp3424Data.addresses[device] = 0x68 + device;
+        mcp3424Data.valid[device] = device == 0;
+        for (uint8_t channel = 0; channel < 4; channel++) {
+            mcp3424Data.channels[device][channel] = 0.1f * (device * 4 + channel + 1);
+        }
+    }
+    mcp3424Data.lastUpdate = now;
+    mcp3424Config.devices[0].i2cAddress = 0x68;
+    mcp3424Config.devices[0].enabled = true;
+    mcp3424Config.devices[1].i2cAddress = 0x69;
+    mcp3424Config.devices[1].enabled = true;
+
+    ads1110Data.voltage = 1.25f;
+    ads1110Data.dataRate = 15;
+    ads1110Data.gain = 1;
+    ads1110Data.valid = true;
+    ads1110Data.lastUpdate = now;
+
+    ina219Data.busVoltage = 12.0f;
+    ina219Data.current = 150.0f;
+    ina219Data.power = 1800.0f;
+    ina219Data.shuntVoltage = 1.5f;
+    ina219Data.valid = true;
+    ina219Data.lastUpdate = now;
+
+    hchoData.hcho = 0.02f;
+    hchoData.hcho_ppb = 16.0f;
+    hchoData.valid = false;
+
+    batteryData.voltage = 7.8f;
+    batteryData.current = 120.0f;
+    batteryData.power = 936.0f;
+    batteryData.chargePercent = 80;
+    batteryData.isBatteryPowered = true;
+    batteryData.valid = true;
+    batteryData.lastUpdate = now;
+
+    calibratedData.CO = 0.4f;
+    calibratedData.NO2 = 12.0f;
+    calibratedData.O3 = INFINITY;      // +Inf w OpenMetrics
+    calibratedData.PID = 0.125f;
+    calibratedData.valid = true;
+}
+
+// Taski z tabeli metricsTasks - stos z rozmiaru przy tworzeniu (host bez pomiaru high-water mark)
+static void idleTask(void* parameter) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, 1000);
+    }
+}
+
+int main(int argc, char** argv) {
+    int scrapes = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--scrapes") == 0 && i + 1 < argc) {
+            scrapes = atoi(argv[++i]);
+        }
+    }
+
+    fillSensorData();
+    xTaskCreatePinnedToCore(idleTask, "loopTask", 8192, NULL, 1, NULL, 1);
+    xTaskCreatePinnedToCore(idleTask, "i2cBusTask", I2C_BUS_TASK_STACK, NULL, 1, NULL, 1);
+    for (uint32_t i = 0; i < 100; i++) {
+        recordLoopTime(800 + i * 3);
+    }
+
+    if (!initializeMetrics()) return 1;
+
+    const char* data = nullptr;
+    size_t length = 0;
+    uint32_t token = 0;
+    for (int i = 0; i < scrapes; i++) {
+        if (!renderMetrics(data, length, token)) {
+            safePrintln("renderMetrics failed");
+            return 1;
+        }
+        if (i + 1 < scrapes) releaseMetricsBuffer(token);
+    }
+
+    fwrite(data, 1, length, stdout);
+    fflush(stdout);
+    releaseMetricsBuffer(token);
+    safePrintln(getMetricsStatus());
+    // Taski hosta to odłączone wątki - wyjście bez czekania na nie
+    _Exit(0);
+}
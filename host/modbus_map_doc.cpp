@@ -0,0 +1,71 @@
+// Generator tabel rejestrów do Register_Map_Guide.md (Linux) - ta sama tabela deskryptorów
+// (src/modbus_map.cpp), z której firmware zapisuje banki i buduje mapę getModbusMap. Wypisuje
+// sekcję Markdown na stdout; gen_register_map.py wstawia ją do dokumentu między znaczniki.
+//
+// Build:  g++ -std=gnu++11 -O2 -pthread -Ihost/arduino -Iinclude host/modbus_map_doc.cpp
+//             host/arduino/arduino_host.cpp src/modbus_map.cpp -o modbus_map_doc   (jedna linia)
+// Start:  ./modbus_map_doc                  (albo: python3 gen_register_map.py --host-binary ./modbus_map_doc)
+
+#include <Arduino.h>
+#include <modbus_map.h>
+#include <modbus_history.h>
+
+// Lista plików historii jest dynamiczna (tylko mapa JSON) - do tabel niepotrzebna
+void getModbusHistoryFilesJson(JsonArray files) {}
+
+static const char* const bankTitles[MAP_BANK_COUNT] = {
+    "Solar (VE.Direct)", "OPCN3", "Rejestry kontrolne", "I2C", "IPS", "MCP3424 ADC",
+    "ADS1110 ADC", "INA219", "SPS30", "SHT40", "HCHO", "Kalibracja", "Diagnostyka Modbus RTU",
+    "Historia - wyszukiwanie rekordów (FC 20)"
+};
+
+static const char* regTypeName(uint8_t regType) {
+    switch (regType) {
+        case MB_REG_I16: return "i16";
+        case MB_REG_U32: return "u32";
+        case MB_REG_I32: return "i32";
+        case MB_REG_AGE: return "age";
+        default:         return "u16";
+    }
+}
+
+static void printRow(uint16_t base, uint16_t reg, const char* name, uint8_t regType, uint8_t count, float scale,
+                     const char* unit) {
+    uint16_t words = (regType == MB_REG_U32 || regType == MB_REG_I32) ? 2 : 1;
+    uint16_t last = reg + words * count - 1;
+    String address = String(base + reg);
+    String offset = String(reg);
+    if (last != reg) {
+        address += "-" + String(base + last);
+        offset += "-" + String(last);
+    }
+    String label = String("`") + name + "`";
+    if (count > 1) label += " ×" + String(count);
+    String scaleText = "";
+    if (scale != 1.0f) scaleText = "×" + String((unsigned long)scale);
+    printf("| %s | %s | %s | %s | %s | %s |\n", address.c_str(), offset.c_str(), label.c_str(), regTypeName(regType),
+           scaleText.c_str(), unit);
+}
+
+int main() {
+    for (int b = 0; b < MAP_BANK_COUNT; b++) {
+        const ModbusBankDef& def = getModbusBankDef((ModbusMapBank)b);
+        printf("### %s - `%s` (%u-%u)\n\n", bankTitles[b], def.name, def.base, def.base + def.size - 1);
+        printf("| Adres | Offset | Pole | Typ | Skala | Jednostka |\n");
+        printf("|---|---|---|---|---|---|\n");
+        if (def.header) {
+            printRow(def.base, 0, "status", MB_REG_U16, 1, 1.0f, "bool");
+            printRow(def.base, 1, "dataType", MB_REG_U16, 1, 1.0f, "0-2");
+            printRow(def.base, 2, "timestamp", MB_REG_U32, 1, 1.0f, "ms");
+        }
+        for (uint16_t i = 0; i < def.fieldCount; i++) {
+            const ModbusRegisterDef& field = def.fields[i];
+            printRow(def.base, field.reg, field.name, field.regType, field.count, field.scale, field.unit);
+        }
+        printf("\n");
+    }
+    printf("Rejestry bloku bez wiersza w tabeli są rezerwowe (0). Łącznie %u rejestrów (0-%u).\n",
+           MODBUS_REG_TOTAL, MODBUS_REG_TOTAL - 1);
+    fflush(stdout);
+    _Exit(0);
+}
@@ -0,0 +1,302 @@
+// Hostowy slave Modbus RTU (Linux) - src/modbus_handler.cpp razem z taskiem RTU, obrazem rejestrów
+// i bankami cienia, tylko Serial2 to pseudoterminal zamiast UART, a dane czujników są symulowane.
+// Do regresji wydajności Modbus bez płytki (test_modbus_rtu_bench.py, CI).
+//
+// Build:  g++ -std=gnu++11 -O2 -pthread -Ihost/arduino -Iinclude host/modbus_rtu_host.cpp
+//             host/arduino/arduino_host.cpp src/modbus_handler.cpp src/modbus_map.cpp
+//             src/modbus_pdu.cpp src/modbus_history.cpp -o modbus_rtu_host        (jedna linia)
+// Start:  ./modbus_rtu_host [--loop-ms 10] [--link /tmp/ttyMODBUS]
+//
+// Pierwsza linia na stdout: "PTY <ścieżka>" - port dla mastera (slave id 30, prędkość bez znaczenia,
+// przerwa między ramkami jak na ESP32: MODBUS_RX_TIMEOUT_SYMBOLS znaków przy MODBUS_BAUD).
+// SIGINT/SIGTERM: linia "STATS ..." z licznikami RTU i getModbusStatus(), potem wyjście.
+// Logi firmware (safePrintln) idą na stderr.
+
+#include <Arduino.h>
+#include <modbus_handler.h>
+#include <modbus_tcp.h>
+#include <history.h>
+#include <history_export.h>
+#include <sensors.h>
+#include <ips_sensor.h>
+#include <mean.h>
+#include <calib.h>
+#include <command_registry.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+
+// ===== Środowisko firmware (main.cpp, sensors, mean, history, command_registry) =====
+
+FeatureConfig config;
+CalibrationConfig calibConfig;
+CalibratedSensorData calibratedData;
+bool turnOnNetwork = false;
+
+SolarData solarData;
+HistogramData opcn3Data;
+I2CSensorData i2cSensorData;
+IPSSensorData ipsSensorData;
+MCP3424Data mcp3424Data;
+ADS1110Data ads1110Data;
+INA219Data ina219Data;
+SPS30Data sps30Data;
+SHT40Data sht40Data;
+HCHOData hchoData;
+BatteryData batteryData;
+
+bool solarSensorStatus = false;
+bool opcn3SensorStatus = false;
+bool i2cSensorStatus = false;
+bool sht40SensorStatus = false;
+bool sps30SensorStatus = false;
+bool mcp3424SensorStatus = false;
+bool ads1110SensorStatus = false;
+bool ina219SensorStatus = false;
+bool ipsSensorStatus = false;
+bool hchoSensorStatus = false;
+
+static uint32_t averagesGeneration = 0;
+
+void safePrint(const String& message) {
+    fputs(message.c_str(), stderr);
+}
+
+void safePrintln(const String& message) {
+    fprintf(stderr, "%s\n", message.c_str());
+}
+
+// Średnie = bieżące dane symulacji; generacja rośnie z każdym krokiem symulacji
+uint32_t getAveragesGeneration() { return averagesGeneration; }
+SolarData getSolarFastAverage() { return solarData; }
+I2CSensorData getI2CFastAverage() { return i2cSensorData; }
+SPS30Data getSPS30FastAverage() { return sps30Data; }
+IPSSensorData getIPSFastAverage() { return ipsSensorData; }
+MCP3424Data getMCP3424FastAverage() { return mcp3424Data; }
+ADS1110Data getADS1110FastAverage() { return ads1110Data; }
+INA219Data getINA219FastAverage() { return ina219Data; }
+SHT40Data getSHT40FastAverage() { return sht40Data; }
+HCHOData getHCHOFastAverage() { return hchoData; }
+SolarData getSolarSlowAverage() { return solarData; }
+I2CSensorData getI2CSlowAverage() { return i2cSensorData; }
+SPS30Data getSPS30SlowAverage() { return sps30Data; }
+IPSSensorData getIPSSlowAverage() { return ipsSensorData; }
+MCP3424Data getMCP3424SlowAverage() { return mcp3424Data; }
+ADS1110Data getADS1110SlowAverage() { return ads1110Data; }
+INA219Data getINA219SlowAverage() { return ina219Data; }
+SHT40Data getSHT40SlowAverage() { return sht40Data; }
+HCHOData getHCHOSlowAverage() { return hchoData; }
+CalibratedSensorData getCalibratedFastAverage() { return calibratedData; }
+CalibratedSensorData getCalibratedSlowAverage() { return calibratedData; }
+
+bool isTimeSet() { return false; }
+time_t getEpochTime() { return 0; }
+
+bool readIPS(IPSSensorData& data) { return false; }
+void enableIPSDebugMode() {}
+void disableIPSDebugMode() {}
+
+// Historia (PSRAM) niedostępna na hoście - FC 0x14 odpowiada wyjątkiem 0x02
+bool isHistoryTimeEpoch() { return false; }
+const char* getHistoryRecordSourceName(size_t source) { return ""; }
+bool getHistoryRecordWindow(size_t source, bool slow, HistoryRecordWindow& window) { return false; }
+bool copyHistoryRecord(size_t source, bool slow, uint32_t seq, uint8_t* out) { return false; }
+
+bool registerCommands(const CommandDef* defs, size_t count) { return true; }
+
+CommandResult dispatchModbusCommand(uint16_t code, String& errorOut) {
+    errorOut = "not available on host";
+    return CMD_NOT_FOUND;
+}
+
+void initializeModbusTcp() {}
+String getModbusTcpStatus() { return "- Modbus TCP: not built on host\n"; }
+
+// ===== Symulacja czujników =====
+
+// Deterministyczne przebiegi z numeru kroku - kolejne odczyty rejestrów się zmieniają,
+// więc banki są przepisywane i publikowane jak na urządzeniu
+static void simulateSensors(uint32_t step) {
+    unsigned long now = millis();
+    float phase = step * 0.01f;
+
+    i2cSensorData.temperature = 21.5f + 2.0f * sinf(phase);
+    i2cSensorData.humidity = 45.0f + 5.0f * cosf(phase);
+    i2cSensorData.pressure = 1013.0f;
+    i2cSensorData.co2 = 420.0f + (step % 100);
+    i2cSensorData.type = SENSOR_SCD41;
+    i2cSensorData.valid = true;
+    i2cSensorData.lastUpdate = now;
+
+    sht40Data.temperature = i2cSensorData.temperature - 0.3f;
+    sht40Data.humidity = i2cSensorData.humidity + 1.0f;
+    sht40Data.pressure = 101.3f;
+    sht40Data.valid = true;
+    sht40Data.lastUpdate = now;
+
+    sps30Data.pm1_0 = 3.0f + (step % 7);
+    sps30Data.pm2_5 = 5.0f + (step % 11);
+    sps30Data.pm4_0 = 6.0f + (step % 13);
+    sps30Data.pm10 = 8.0f + (step % 17);
+    sps30Data.nc0_5 = 20.0f;
+    sps30Data.nc1_0 = 25.0f;
+    sps30Data.nc2_5 = 27.0f;
+    sps30Data.nc4_0 = 28.0f;
+    sps30Data.nc10 = 28.5f;
+    sps30Data.typical_particle_size = 0.6f;
+    sps30Data.valid = true;
+    sps30Data.lastUpdate = now;
+
+    mcp3424Data.deviceCount = 2;
+    mcp3424Data.resolution = 18;
+    mcp3424Data.gain = 1;
+    for (uint8_t device = 0; device < 2; device++) {
+        mcp3424Data.addresses[device] = 0x68 + device;
+        mcp3424Data.valid[device] = true;
+        for (uint8_t channel = 0; channel < 4; channel++) {
+            mcp3424Data.channels[device][channel] = 0.1f * (device * 4 + channel + 1) + 0.001f * (step % 50);
+        }
+    }
+    mcp3424Data.lastUpdate = now;
+
+    ads1110Data.voltage = 1.25f + 0.01f * sinf(phase);
+    ads1110Data.dataRate = 15;
+    ads1110Data.gain = 1;
+    ads1110Data.valid = true;
+    ads1110Data.lastUpdate = now;
+
+    ina219Data.busVoltage = 12.0f;
+    ina219Data.current = 150.0f + (step % 20);
+    ina219Data.power = ina219Data.busVoltage * ina219Data.current;
+    ina219Data.shuntVoltage = 1.5f;
+    ina219Data.valid = true;
+    ina219Data.lastUpdate = now;
+
+    for (int i = 0; i < 7; i++) {
+        ipsSensorData.pc_values[i] = 1000 * (7 - i) + step % 100;
+        ipsSensorData.pm_values[i] = 0.5f * (i + 1);
+        ipsSensorData.np_values[i] = 0;
+        ipsSensorData.pw_values[i] = 0;
+    }
+    ipsSensorData.valid = true;
+    ipsSensorData.lastUpdate = now;
+
+    hchoData.hcho = 0.02f;
+    hchoData.hcho_ppb = 16.0f + (step % 5);
+    hchoData.valid = true;
+    hchoData.lastUpdate = now;
+
+    batteryData.voltage = 7.8f;
+    batteryData.current = 120.0f;
+    batteryData.power = batteryData.voltage * batteryData.current;
+    batteryData.chargePercent = 80;
+    batteryData.valid = true;
+    batteryData.lastUpdate = now;
+
+    calibratedData.K1_temp = sht40Data.temperature;
+    calibratedData.K1_voltage = mcp3424Data.channels[0][0] * 1000.0f;
+    calibratedData.valid = true;
+
+    averagesGeneration++;
+}
+
+static void enableSimulatedSensors() {
+    config.enableWiFi = false;
+    config.enableWebServer = false;
+    config.enableHistory = false;
+    config.enableModbus = true;
+
+    i2cSensorStatus = true;
+    sht40SensorStatus = true;
+    sps30SensorStatus = true;
+    mcp3424SensorStatus = true;
+    ads1110SensorStatus = true;
+    ina219SensorStatus = true;
+    ipsSensorStatus = true;
+    hchoSensorStatus = true;
+}
+
+// ===== Pseudoterminal i pętla główna =====
+
+extern uint32_t modbusRxEvents;
+extern uint32_t modbusRtuCrcErrors;
+extern uint32_t modbusRtuFrameErrors;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onStopSignal(int) {
+    stopRequested = 1;
+}
+
+// Strona master pty dla Serial2; slave trzymany otwarty (bez tego master dostaje POLLHUP
+// między połączeniami klientów) i w trybie raw - echo terminala wracałoby jako ramki
+static int openModbusPty(const char* link) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("posix_openpt");
+        return -1;
+    }
+
+    const char* path = ptsname(master);
+    int slave = path ? open(path, O_RDWR | O_NOCTTY) : -1;
+    if (slave < 0) {
+        perror("open pty slave");
+        return -1;
+    }
+
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    if (link) {
+        unlink(link);
+        if (symlink(path, link) != 0) perror("symlink");
+    }
+
+    printf("PTY %s\n", link ? link : path);
+    fflush(stdout);
+    return master;
+}
+
+int main(int argc, char** argv) {
+    unsigned long loopMs = 10;
+    const char* link = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--loop-ms") == 0 && i + 1 < argc) {
+            loopMs = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--link") == 0 && i + 1 < argc) {
+            link = argv[++i];
+        } else {
+            fprintf(stderr, "Użycie: %s [--loop-ms 10] [--link /tmp/ttyMODBUS]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    signal(SIGINT, onStopSignal);
+    signal(SIGTERM, onStopSignal);
+
+    int master = openModbusPty(link);
+    if (master < 0) return 1;
+
+    enableSimulatedSensors();
+    Serial2.attach(master);
+    initializeModbus();
+
+    // Jak loop() na ESP32: dane czujników -> obraz rejestrów, ramki obsługuje modbusTask
+    uint32_t step = 0;
+    while (!stopRequested) {
+        simulateSensors(step++);
+        updateModbusRegisters();
+        processModbusTask();
+        delay(loopMs);
+    }
+
+    printf("STATS rx_events=%u crc_errors=%u frame_errors=%u loops=%u\n",
+           modbusRxEvents, modbusRtuCrcErrors, modbusRtuFrameErrors, step);
+    fputs(getModbusStatus().c_str(), stdout);
+    fflush(stdout);
+    if (link) unlink(link);
+    _exit(0);
+}
@@ -0,0 +1,129 @@
+// Hostowy serwer Modbus TCP (Linux) - ten sam kod protokołu co na ESP32 (src/modbus_pdu.cpp),
+// obraz rejestrów w pamięci zamiast danych czujników. Do testów klientów (test_modbus_tcp.py,
+// pymodbus) bez płytki.
+//
+// Build:  g++ -std=gnu++11 -O2 -Iinclude host/modbus_tcp_host.cpp src/modbus_pdu.cpp -o modbus_tcp_host
+// Start:  ./modbus_tcp_host [port]          (domyślnie 5020 - port 502 wymaga roota)
+//
+// Rejestr N ma na starcie wartość N - klient może sprawdzić kolejność i kompletność odczytu.
+
+#include <modbus_pdu.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#define HOST_REG_TOTAL 732          // MODBUS_REG_TOTAL z modbus_map.h (config.h wymaga Arduino.h)
+#define HOST_MAX_CLIENTS 16
+#define HOST_RX_BUFFER 65536
+
+static uint16_t image[HOST_REG_TOTAL];
+
+static uint8_t readImage(uint16_t start, uint16_t count, uint16_t* out) {
+    if ((uint32_t)start + count > HOST_REG_TOTAL) return MODBUS_EX_ILLEGAL_ADDRESS;
+    memcpy(out, image + start, count * sizeof(uint16_t));
+    return MODBUS_EX_NONE;
+}
+
+static uint8_t writeImage(uint16_t start, uint16_t count, const uint16_t* values) {
+    if ((uint32_t)start + count > HOST_REG_TOTAL) return MODBUS_EX_ILLEGAL_ADDRESS;
+    memcpy(image + start, values, count * sizeof(uint16_t));
+    return MODBUS_EX_NONE;
+}
+
+static const ModbusRegisterAccess registerAccess = { readImage, writeImage, NULL };
+
+struct Client {
+    int fd;
+    std::vector<uint8_t> rx;
+};
+
+// Wszystkie kompletne ramki z bufora, odpowiedzi jednym send() - jak serveConnection() na ESP32
+static bool serve(Client& client) {
+    static uint8_t tx[MODBUS_TCP_MAX_ADU];
+    std::vector<uint8_t> out;
+    size_t offset = 0;
+
+    while (offset < client.rx.size()) {
+        size_t consumed;
+        size_t txLength;
+        ModbusTcpFrame frame = processModbusTcpAdu(client.rx.data() + offset, client.rx.size() - offset,
+                                                   consumed, tx, txLength, registerAccess);
+        if (frame == MBTCP_INCOMPLETE) break;
+        if (frame == MBTCP_INVALID) return false;
+        out.insert(out.end(), tx, tx + txLength);
+        offset += consumed;
+    }
+    client.rx.erase(client.rx.begin(), client.rx.begin() + offset);
+
+    size_t sent = 0;
+    while (sent < out.size()) {
+        ssize_t n = send(client.fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int port = argc > 1 ? atoi(argv[1]) : 5020;
+    for (int reg = 0; reg < HOST_REG_TOTAL; reg++) image[reg] = reg;
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(listener, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listener, 8) < 0) {
+        perror("bind/listen");
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    printf("Modbus TCP host server on port %d, %d registers\n", port, HOST_REG_TOTAL);
+    fflush(stdout);
+
+    std::vector<Client> clients;
+    static uint8_t buffer[4096];
+
+    while (true) {
+        std::vector<pollfd> fds;
+        fds.push_back({listener, POLLIN, 0});
+        for (const Client& client : clients) fds.push_back({client.fd, POLLIN, 0});
+        if (poll(fds.data(), fds.size(), -1) < 0) continue;
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(listener, NULL, NULL);
+            if (fd >= 0 && clients.size() >= HOST_MAX_CLIENTS) {
+                close(fd);
+            } else if (fd >= 0) {
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                clients.push_back({fd, {}});
+            }
+        }
+
+        // Od końca - usuwanie rozłączonych bez przesuwania nieobsłużonych
+        for (size_t i = fds.size() - 1; i >= 1; i--) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            Client& client = clients[i - 1];
+            ssize_t n = recv(client.fd, buffer, sizeof(buffer), 0);
+            bool keep = n > 0 && client.rx.size() + n <= HOST_RX_BUFFER;
+            if (keep) {
+                client.rx.insert(client.rx.end(), buffer, buffer + n);
+                keep = serve(client);
+            }
+            if (!keep) {
+                close(client.fd);
+                clients.erase(clients.begin() + (i - 1));
+            }
+        }
+    }
+}
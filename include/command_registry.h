@@ -0,0 +1,95 @@
+#ifndef COMMAND_REGISTRY_H
+#define COMMAND_REGISTRY_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+class AsyncWebSocketClient;
+
+// Wspolny rejestr komend dla WebSocket, Serial i rejestru komend Modbus.
+// Komendy rejestrowane tabelami (CommandDef), wyszukiwanie binarne po nazwie,
+// kody Modbus przez bezposrednia tablice indeksow.
+
+// Zrodla komend (maska bitowa w CommandDef::sources)
+enum CommandSource : uint8_t {
+    CMD_SRC_WEBSOCKET = 1 << 0,
+    CMD_SRC_SERIAL    = 1 << 1,
+    CMD_SRC_MODBUS    = 1 << 2
+};
+
+enum CommandArgType : uint8_t {
+    ARG_INT,
+    ARG_FLOAT,
+    ARG_BOOL,
+    ARG_STRING,
+    ARG_HEX          // Serial: liczba szesnastkowa (np. MCP3424_ADDR_6A)
+};
+
+// Schemat argumentu - walidowany przed wywolaniem handlera
+struct CommandArg {
+    const char* name;
+    CommandArgType type;
+    bool required;
+    long minValue;   // zakres dla ARG_INT/ARG_FLOAT/ARG_HEX (min == max = bez limitu)
+    long maxValue;
+};
+
+enum CommandResult : uint8_t {
+    CMD_OK = 0,
+    CMD_NOT_FOUND,
+    CMD_NOT_ALLOWED,     // komenda istnieje, ale nie dla tego zrodla
+    CMD_BAD_ARGS
+};
+
+struct CommandDef;
+
+// Kontekst wywolania - argumenty odczytywane przez commandArg*() niezaleznie od zrodla
+struct CommandContext {
+    CommandSource source;
+    const CommandDef* def;
+    const char* name;                // nazwa jak przyszla (np. "FAN_SPEED_75" lub "fan_on")
+    AsyncWebSocketClient* client;    // WebSocket
+    JsonDocument* doc;               // WebSocket - cala wiadomosc
+    const char* suffix;              // Serial - parametry po prefiksie, rozdzielone '_'
+    uint16_t modbusCode;             // Modbus - kod z rejestru komend
+};
+
+typedef void (*CommandHandler)(CommandContext& ctx);
+
+struct CommandDef {
+    const char* name;          // WebSocket: "getHistory", Serial: "FAN_SPEED_" (prefix = true)
+    uint8_t sources;           // maska CommandSource
+    CommandHandler handler;
+    const CommandArg* args;
+    uint8_t argCount;
+    bool prefix;               // Serial: parametry doklejone do nazwy (FAN_SPEED_75)
+    uint16_t modbusCode;       // 0 = brak kodu Modbus
+};
+
+#define COMMAND_ARGS(a) a, (uint8_t)(sizeof(a) / sizeof(a[0]))
+#define COMMAND_NO_ARGS nullptr, 0
+
+#define MAX_REGISTERED_COMMANDS 160
+#define MAX_MODBUS_COMMAND_CODE 31
+
+// Rejestracja tabeli komend (wielokrotne wywolanie dla tej samej tabeli jest ignorowane)
+bool registerCommands(const CommandDef* defs, size_t count);
+
+// Dispatch - zwraca wynik; bledy argumentow opisane w errorOut
+CommandResult dispatchWebSocketCommand(const char* name, AsyncWebSocketClient* client, JsonDocument& doc, String& errorOut);
+CommandResult dispatchSerialCommand(const String& line, String& errorOut);
+CommandResult dispatchModbusCommand(uint16_t code, String& errorOut);
+
+// Dostep do argumentow (WebSocket: pole JSON, Serial: token po prefiksie)
+bool commandHasArg(const CommandContext& ctx, const char* name);
+long commandArgInt(const CommandContext& ctx, const char* name, long defaultValue = 0);
+float commandArgFloat(const CommandContext& ctx, const char* name, float defaultValue = 0.0f);
+bool commandArgBool(const CommandContext& ctx, const char* name, bool defaultValue = false);
+String commandArgString(const CommandContext& ctx, const char* name, const char* defaultValue = "");
+
+// Statystyki (liczba wywolan, bledy, czas wykonania)
+size_t getRegisteredCommandCount();
+void getCommandStatsJson(JsonArray& out);
+void printCommandStats();
+
+#endif // COMMAND_REGISTRY_H
@@ -54,16 +54,23 @@
 #define REG_COUNT_SHT40 50
 #define REG_COUNT_HCHO 50      // Rejestry dla czujnika HCHO
 #define REG_COUNT_CALIBRATION 100
+#define REG_COUNT_MODBUS_DIAG 16   // Diagnostyka RTU (opóźnienia odpowiedzi) - za wszystkimi blokami
+#define REG_COUNT_MODBUS_HISTORY 16  // Wyszukiwanie rekordów historii dla FC 0x14 - za diagnostyką
 
 // Timeouts
 #define SENSOR_TIMEOUT (2 * 60 * 1000) // 2 minutes
 #define MODBUS_TIMEOUT (5 * 60 * 1000) // 5 minutes
 #define SOLAR_TIMEOUT (60 * 1000) // 1 minute
 #define OPCN3_READ_INTERVAL 10000 // 10 seconds
-#define OPCN3_SEND_INTERVAL 10000 // 10 seconds
 #define I2C_TIMEOUT_MS 100        // I2C timeout 100ms
 #define HCHO_TIMEOUT_MS 5000      // HCHO sensor timeout 2 seconds
 #define HCHO_READ_INTERVAL 5000   // HCHO read interval 5 seconds
+#define I2C_READ_INTERVAL 1000    // SHT30/BME280/SCD41/SHT40
+#define SPS30_READ_INTERVAL 1000
+#define MCP3424_CYCLE_INTERVAL 1000  // cykl 4 kanałów na układ; kanał 18-bit ~267 ms, 12-bit ~4 ms
+#define MCP3424_STATUS_INTERVAL 1000 // sprawdzenie świeżości danych + kalibracja
+#define BATTERY_READ_INTERVAL 10000  // ADS1110 + INA219
+#define I2C_RETRY_CHECK_INTERVAL 10000
 
 // Feature configuration structure for easy enable/disable of components
 struct FeatureConfig {
@@ -115,6 +122,7 @@ struct MCP3424DeviceAssignment {
     char description[32];          // Human readable description
     bool enabled;                  // Whether this device is active
     bool autoDetected;             // Whether device was found during I2C scan
+    uint8_t resolution[4];         // Bits per channel: 12, 14, 16, 18 (240 / 60 / 15 / 3.75 SPS)
 };
 
 // MCP3424 Device Configuration
@@ -164,7 +172,7 @@ struct MCP3424Data {
     uint8_t deviceCount;             // Number of active devices
     uint8_t addresses[MAX_MCP3424_DEVICES]; // I2C addresses of devices
     float channels[MAX_MCP3424_DEVICES][4];  // 4 channels per device
-    uint8_t resolution;              // 12, 14, 16, 18 bit (same for all)
+    uint8_t resolution;              // najwyższa rozdzielczość kanałów (per kanał: MCP3424DeviceAssignment)
     uint8_t gain;                   // 1x, 2x, 4x, 8x (same for all)
     bool valid[MAX_MCP3424_DEVICES]; // Valid flag per device
     unsigned long lastUpdate;
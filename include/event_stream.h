@@ -0,0 +1,22 @@
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+// Server-Sent Events (/events) - strumień tylko do odczytu dla dashboardów.
+// Zasilany snapshotem telemetrii: po połączeniu klient dostaje zdarzenie "snapshot"
+// (wszystkie sekcje), potem "delta" tylko ze zmienionymi sekcjami.
+// Id zdarzenia = numer publikacji; przeglądarka po zerwaniu wysyła Last-Event-ID,
+// a serwer odsyła deltę od tego miejsca (albo snapshot, gdy id wypadło z historii).
+
+#define EVENT_STREAM_INTERVAL 2000            // ms - publikacja delt
+#define EVENT_STREAM_SNAPSHOT_INTERVAL 60000  // ms - okresowy pełny snapshot (zgubione delty)
+#define EVENT_STREAM_HISTORY 32               // publikacje pamiętane do wznowienia
+#define EVENT_STREAM_MAX_CLIENTS 8
+#define EVENT_STREAM_RECONNECT 3000           // ms - pole retry dla przeglądarki
+
+bool initializeEventStream(AsyncWebServer& server);
+String getEventStreamStatus();
+
+#endif // EVENT_STREAM_H
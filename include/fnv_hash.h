@@ -0,0 +1,38 @@
+#ifndef FNV_HASH_H
+#define FNV_HASH_H
+
+#include <stdint.h>
+#include <string.h>
+
+// FNV-1a - odciski danych źródłowych (telemetria, banki Modbus) i klucze cache odpowiedzi.
+// Nie kryptograficzny; wystarcza do wykrycia zmiany danych między przebiegami.
+
+#define FNV1A_OFFSET_BASIS 2166136261u
+#define FNV1A_PRIME 16777619u
+
+// Wartość 32-bit dokładana bajt po bajcie (od najmłodszego)
+static inline uint32_t fnv1aMix(uint32_t hash, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        hash ^= (value >> (i * 8)) & 0xFF;
+        hash *= FNV1A_PRIME;
+    }
+    return hash;
+}
+
+// Float po bitach - każda zmiana wartości zmienia odcisk
+static inline uint32_t fnv1aMixFloat(uint32_t hash, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return fnv1aMix(hash, bits);
+}
+
+static inline uint32_t fnv1aString(const char* text) {
+    uint32_t hash = FNV1A_OFFSET_BASIS;
+    while (*text) {
+        hash ^= (uint8_t)*text++;
+        hash *= FNV1A_PRIME;
+    }
+    return hash;
+}
+
+#endif // FNV_HASH_H
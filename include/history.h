@@ -7,7 +7,10 @@
 #include <config.h>
 #include <time.h>
 #include <cstring>
+#include <type_traits>
 #include <esp_heap_caps.h> // For PSRAM allocation
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 // Forward declaration
 void getFormattedDateTime(char* buffer, size_t bufferSize);
@@ -164,7 +167,20 @@ private:
     size_t slowHead = 0;
     size_t fastCount = 0;
     size_t slowCount = 0;
+    volatile uint32_t fastTotal = 0;     // wszystkie dodane próbki - numer sekwencyjny następnej
+    volatile uint32_t slowTotal = 0;
     bool initialized = false;
+    // Typy z polami String (SolarData): kopia wpisu pod mutexem - torn copy w innym tasku
+    // to zwolniony bufor String. Typy POD zostają przy sprawdzaniu numeru sekwencyjnego.
+    SemaphoreHandle_t entryLock = nullptr;
+    
+    void lockEntries() const {
+        if (entryLock) xSemaphoreTake(entryLock, portMAX_DELAY);
+    }
+    
+    void unlockEntries() const {
+        if (entryLock) xSemaphoreGive(entryLock);
+    }
 
 public:
     SensorHistory() : fastHistory(nullptr), slowHistory(nullptr) {}
@@ -215,24 +231,36 @@ public:
         return initialized;
     }
     
+    // Przed pierwszą próbką - dla typów, których wpisów nie wolno kopiować bez blokady
+    bool enableEntryLock() {
+        if (!entryLock) entryLock = xSemaphoreCreateMutex();
+        return entryLock != nullptr;
+    }
+    
     void addFastSample(const T& data, unsigned long timestamp) {
         if (!initialized || !fastHistory) return;
         
+        lockEntries();
         fastHistory[fastHead].timestamp = timestamp;
         getFormattedDateTime(fastHistory[fastHead].dateTime, sizeof(fastHistory[fastHead].dateTime));
         fastHistory[fastHead].data = data;
+        unlockEntries();
         fastHead = (fastHead + 1) % FAST_SIZE;
         if (fastCount < FAST_SIZE) fastCount++;
+        fastTotal++;
     }
     
     void addSlowSample(const T& data, unsigned long timestamp) {
         if (!initialized || !slowHistory) return;
         
+        lockEntries();
         slowHistory[slowHead].timestamp = timestamp;
         getFormattedDateTime(slowHistory[slowHead].dateTime, sizeof(slowHistory[slowHead].dateTime));
         slowHistory[slowHead].data = data;
+        unlockEntries();
         slowHead = (slowHead + 1) % SLOW_SIZE;
         if (slowCount < SLOW_SIZE) slowCount++;
+        slowTotal++;
     }
     
     // Pobierz próbki z określonego zakresu czasowego
@@ -241,6 +269,7 @@ public:
         if (!initialized || !fastHistory || !buffer) return 0;
         
         size_t found = 0;
+        lockEntries();
         for (size_t i = 0; i < fastCount && found < bufferSize; i++) {
             size_t index = (fastHead + FAST_SIZE - fastCount + i) % FAST_SIZE;
             if (fastHistory[index].timestamp >= fromTime && 
@@ -248,6 +277,7 @@ public:
                 buffer[found++] = fastHistory[index];
             }
         }
+        unlockEntries();
         return found;
     }
     
@@ -256,6 +286,7 @@ public:
         if (!initialized || !slowHistory || !buffer) return 0;
         
         size_t found = 0;
+        lockEntries();
         for (size_t i = 0; i < slowCount && found < bufferSize; i++) {
             size_t index = (slowHead + SLOW_SIZE - slowCount + i) % SLOW_SIZE;
             if (slowHistory[index].timestamp >= fromTime && 
@@ -263,25 +294,76 @@ public:
                 buffer[found++] = slowHistory[index];
             }
         }
+        unlockEntries();
         return found;
     }
     
     size_t getFastCount() const { return fastCount; }
     size_t getSlowCount() const { return slowCount; }
+    
+    // Dostęp po numerze sekwencyjnym (0 = pierwsza próbka od startu) - stabilny
+    // kursor dla eksportu, niezależny od przesuwania się bufora kołowego
+    uint32_t getTotal(bool slow) const { return slow ? slowTotal : fastTotal; }
+    size_t getCount(bool slow) const { return slow ? slowCount : fastCount; }
+    
+    bool getSampleAt(bool slow, uint32_t seq, HistoryEntry<T>& entry) const {
+        if (!initialized) return false;
+        const HistoryEntry<T>* history = slow ? slowHistory : fastHistory;
+        const size_t size = slow ? SLOW_SIZE : FAST_SIZE;
+        uint32_t total = getTotal(slow);
+        // Najstarszy slot przy pełnym buforze jest następnym do zapisu - pomijany
+        if (seq >= total || total - seq > getCount(slow) || total - seq >= size) return false;
+        lockEntries();
+        entry = history[seq % size];
+        unlockEntries();
+        // Nadpisana w trakcie kopiowania (zapis z innego taska)
+        return getTotal(slow) - seq < size;
+    }
+    
+    // Sam znacznik czasu próbki - planowanie zakresu bez kopiowania danych
+    bool getTimestampAt(bool slow, uint32_t seq, unsigned long& timestamp) const {
+        if (!initialized) return false;
+        const HistoryEntry<T>* history = slow ? slowHistory : fastHistory;
+        const size_t size = slow ? SLOW_SIZE : FAST_SIZE;
+        uint32_t total = getTotal(slow);
+        if (seq >= total || total - seq > getCount(slow) || total - seq >= size) return false;
+        timestamp = history[seq % size].timestamp;
+        return getTotal(slow) - seq < size;
+    }
+
+    // Surowa kopia danych próbki prosto z bufora (bez dateTime i konstruktorów kopiujących) -
+    // eksport binarny; tylko dla typów bez pól String
+    bool copyRawSampleAt(bool slow, uint32_t seq, uint32_t& timestamp, void* data) const {
+        // W ciele funkcji - sprawdzane tylko dla typów, z którymi eksport ją wywołuje (nie SolarData)
+        static_assert(std::is_trivially_copyable<T>::value, "copyRawSampleAt: memcpy wymaga typu trivially copyable");
+        if (!initialized) return false;
+        const HistoryEntry<T>* history = slow ? slowHistory : fastHistory;
+        const size_t size = slow ? SLOW_SIZE : FAST_SIZE;
+        uint32_t total = getTotal(slow);
+        if (seq >= total || total - seq > getCount(slow) || total - seq >= size) return false;
+        const HistoryEntry<T>& entry = history[seq % size];
+        timestamp = entry.timestamp;
+        memcpy(data, &entry.data, sizeof(T));
+        return getTotal(slow) - seq < size;
+    }
     bool isInitialized() const { return initialized; }
     
     // Pobierz najnowszą próbkę
     bool getLatestFast(HistoryEntry<T>& entry) const {
         if (!initialized || fastCount == 0) return false;
         size_t index = (fastHead + FAST_SIZE - 1) % FAST_SIZE;
+        lockEntries();
         entry = fastHistory[index];
+        unlockEntries();
         return true;
     }
     
     bool getLatestSlow(HistoryEntry<T>& entry) const {
         if (!initialized || slowCount == 0) return false;
         size_t index = (slowHead + SLOW_SIZE - 1) % SLOW_SIZE;
+        lockEntries();
         entry = slowHistory[index];
+        unlockEntries();
         return true;
     }
 };
@@ -340,10 +422,68 @@ void updateSensorHistory();
 void printHistoryMemoryUsage();
 void printHistoryStatus();
 void checkHistoryMemoryType();
+uint32_t getHistoryGeneration();
+
+// Zegar historii: epoch [s] po synchronizacji NTP, inaczej sekundy od startu
+unsigned long getHistoryTime();
+bool isHistoryTimeEpoch();
 
 // Funkcje API do pobierania danych historycznych z pakietowaniem
 size_t getHistoricalData(const String& sensor, const String& timeRange, 
                         String& jsonResponse, unsigned long fromTime = 0, unsigned long toTime = 0,
                         const String& sampleType = "fast", int packetIndex = 0, int packetSize = 20);
 
+// ===== Strumieniowy eksport historii (HTTP /api/history) =====
+// Wiersze formatowane pojedynczo do małego bufora - cały zakres bez budowania
+// odpowiedzi w pamięci. Kursor = numer sekwencyjny próbki (SensorHistory::getSampleAt).
+
+#define HISTORY_STREAM_ROW_SIZE 1024
+#define HISTORY_STREAM_MAX_LIMIT 5000
+
+enum HistoryStreamFormat {
+    HISTORY_STREAM_JSON,
+    HISTORY_STREAM_CSV
+};
+
+class HistoryStreamSource;
+
+class HistoryStream {
+public:
+    // cursor = numer pierwszej próbki do rozważenia (0 = najstarsza dostępna)
+    bool begin(const String& sensor, const String& sampleType, unsigned long fromTime, unsigned long toTime,
+               uint32_t cursor, size_t limit, HistoryStreamFormat format);
+    // Wypełnia bufor kolejnymi bajtami odpowiedzi; 0 = koniec
+    size_t read(uint8_t* buffer, size_t maxLen);
+    
+    const char* getError() const { return error; }
+    uint32_t getNextCursor() const { return nextCursor; }
+    bool hasMore() const { return more; }
+    size_t getPlannedCount() const { return planned; }
+
+private:
+    bool nextChunk();
+    
+    enum Stage { STAGE_HEADER, STAGE_ROWS, STAGE_FOOTER, STAGE_DONE };
+    
+    const HistoryStreamSource* source = nullptr;
+    const char* error = nullptr;
+    HistoryStreamFormat format = HISTORY_STREAM_JSON;
+    Stage stage = STAGE_DONE;
+    bool slow = false;
+    unsigned long fromTime = 0;
+    unsigned long toTime = 0;
+    uint32_t startSeq = 0;
+    uint32_t seq = 0;
+    uint32_t endSeq = 0;
+    uint32_t nextCursor = 0;
+    uint32_t skipped = 0;       // próbki nadpisane przed kursorem
+    bool more = false;
+    size_t planned = 0;
+    size_t written = 0;
+    
+    char row[HISTORY_STREAM_ROW_SIZE];
+    size_t rowLen = 0;
+    size_t rowPos = 0;
+};
+
 #endif // HISTORY_H 
\ No newline at end of file
@@ -0,0 +1,111 @@
+#ifndef HISTORY_EXPORT_H
+#define HISTORY_EXPORT_H
+
+#include <Arduino.h>
+
+// ===== Binarny eksport całej historii (HTTP /api/history/export) =====
+// Wszystkie bufory SensorHistory (fast i slow) w jednym kontenerze, rekordy kopiowane
+// surowo z PSRAM (little-endian, bez formatowania). Format (wszystko LE):
+//
+//   nagłówek:  "ESHX" | u16 wersja | u16 liczba strumieni | u32 czas eksportu |
+//              u8 baza czasu (1 = epoch, 0 = uptime) | 3B zarezerwowane | u32 długość schematu
+//   schemat:   dla każdego strumienia: u8 len + nazwa | u8 typ próbek (0 fast, 1 slow) |
+//              u16 rozmiar rekordu | u32 liczba rekordów | u32 numer pierwszej próbki |
+//              u16 liczba pól | pola: u8 len + nazwa, u8 typ, u16 offset, u16 liczba elementów
+//   dane:      rekordy strumieni po kolei; rekord = u32 timestamp + dane czujnika
+//   stopka:    "ESHE" | u32 rekordy nadpisane w trakcie wysyłki | u32 CRC32 (zlib) wszystkiego przed nim
+//
+// Liczby rekordów ustalane przy starcie eksportu; próbka nadpisana przez bufor kołowy
+// w trakcie wysyłki idzie jako rekord zerowy (timestamp 0). Dekoder: history_export_decode.py
+
+#define HISTORY_EXPORT_VERSION 1
+#define HISTORY_EXPORT_RECORD_MAX 512     // największy rekord (timestamp + struktura czujnika)
+#define HISTORY_EXPORT_CHUNK_SIZE 1024    // bufor nagłówka / opisu strumienia / stopki
+#define HISTORY_EXPORT_MAX_ACTIVE 1       // równoległe eksporty (pasmo WiFi i tak wspólne)
+
+// Typy pól w schemacie - rozmiar wynika z typu
+enum HistoryExportFieldType : uint8_t {
+    EXPORT_F32 = 1,
+    EXPORT_F64,
+    EXPORT_U8,
+    EXPORT_I8,
+    EXPORT_U16,
+    EXPORT_I16,
+    EXPORT_U32,
+    EXPORT_I32,
+    EXPORT_U64,
+    EXPORT_I64,
+    EXPORT_BOOL
+};
+
+class HistoryExportSource;
+
+class HistoryExport {
+public:
+    HistoryExport();
+    ~HistoryExport();
+
+    bool begin();
+    // Wypełnia bufor kolejnymi bajtami kontenera; 0 = koniec
+    size_t read(uint8_t* buffer, size_t maxLen);
+
+    const char* getError() const { return error; }
+    size_t getStreamCount() const { return streamCount; }
+    uint32_t getRecordCount() const { return recordCount; }
+    size_t getTotalSize() const { return totalSize; }
+
+private:
+    enum Stage { STAGE_HEADER, STAGE_SCHEMA, STAGE_RECORDS, STAGE_TRAILER, STAGE_DONE };
+
+    struct Stream {
+        const HistoryExportSource* source;
+        bool slow;
+        uint32_t firstSeq;
+        uint32_t count;
+    };
+
+    size_t writeHeader(uint8_t* out) const;
+    size_t writeDescriptor(const Stream& stream, uint8_t* out) const;
+    size_t writeRecord(const Stream& stream, uint32_t seq, uint8_t* out);
+    bool nextChunk();
+
+    Stream streams[24];          // 12 czujników x fast/slow
+    size_t streamCount = 0;
+    uint32_t recordCount = 0;
+    size_t totalSize = 0;
+    size_t schemaLength = 0;
+    unsigned long exportTime = 0;
+    bool timeEpoch = false;
+    bool active = false;
+
+    Stage stage = STAGE_DONE;
+    size_t streamIndex = 0;
+    uint32_t seq = 0;
+    uint32_t dropped = 0;        // rekordy nadpisane w trakcie wysyłki
+    uint32_t crc = 0;
+    const char* error = nullptr;
+
+    uint8_t chunk[HISTORY_EXPORT_CHUNK_SIZE];
+    size_t chunkLen = 0;
+    size_t chunkPos = 0;
+};
+
+String getHistoryExportStatus();
+
+// ===== Pojedyncze rekordy strumieni (Modbus FC 0x14) =====
+// Źródło = czujnik w kolejności kontenera eksportu (solar, i2c, sps30, ...), rekord jak w eksporcie:
+// u32 timestamp + dane. Numery próbek (seq) jak w SensorHistory::getTotal().
+#define HISTORY_EXPORT_SOURCE_COUNT 12
+
+struct HistoryRecordWindow {
+    uint32_t firstSeq;       // najstarsza próbka, której nie nadpisze najbliższy zapis
+    uint32_t total;          // numer następnej próbki
+    uint16_t recordSize;     // bajty rekordu
+};
+
+const char* getHistoryRecordSourceName(size_t source);
+bool getHistoryRecordWindow(size_t source, bool slow, HistoryRecordWindow& window);
+// out >= HISTORY_EXPORT_RECORD_MAX; false = próbka nadpisana lub poza oknem
+bool copyHistoryRecord(size_t source, bool slow, uint32_t seq, uint8_t* out);
+
+#endif // HISTORY_EXPORT_H
@@ -0,0 +1,110 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// Menedżer magistrali I2C - jedyny właściciel Wire. Odczyty czujników (loop(), task MCP3424,
+// task SCD41, skan z WWW) nie biorą już wspólnego semafora z timeoutem 50-100 ms, tylko wstawiają
+// transakcję do kolejki priorytetowej i czekają na jej wykonanie - przy zajętej magistrali próbka
+// czeka w kolejce zamiast przepaść. Task magistrali wykonuje kolejne transakcje jedna za drugą
+// (paczka na jedno wybudzenie), a w transakcji "konwersja i odczyt" zwalnia magistralę na czas
+// konwersji: zapis startu, inne transakcje, odczyt po waitMs.
+// Przed uruchomieniem tasku (setup()) i w kodzie wywołanym z tasku magistrali transakcje idą od razu.
+
+#define I2C_BUS_QUEUE_SIZE 16            // transakcje na priorytet
+#define I2C_BUS_MAX_PENDING 8            // konwersje w toku (odczyt po waitMs)
+#define I2C_BUS_MAX_DEVICES 16           // statystyki per adres
+#define I2C_BUS_MAX_CLIENTS 8            // taski czekające na wynik (semafor na task)
+#define I2C_BUS_TASK_PRIORITY 3          // powyżej loop() (1) i tasków czujników (1-2)
+#define I2C_BUS_TASK_STACK 6144          // biblioteki Sensirion/Adafruit na stosie tasku
+
+enum I2CBusPriority : uint8_t {
+    I2C_PRIORITY_HIGH = 0,       // odczyt wyniku konwersji, pomiary z terminem (MCP3424, SCD41)
+    I2C_PRIORITY_NORMAL,         // okresowe odczyty czujników
+    I2C_PRIORITY_LOW,            // skan, inicjalizacja, reset, diagnostyka
+    I2C_PRIORITY_COUNT
+};
+
+enum I2CTransactionType : uint8_t {
+    I2C_TXN_WRITE = 0,           // zapis (0 bajtów = sprawdzenie obecności adresu)
+    I2C_TXN_READ,                // odczyt readLength bajtów
+    I2C_TXN_WRITE_READ,          // zapis rejestru i odczyt z powtórzonym startem
+    I2C_TXN_CONVERT_READ,        // zapis (start konwersji), po waitMs odczyt - magistrala wolna w międzyczasie
+    I2C_TXN_CALL                 // funkcja biblioteki czujnika wykonana na tasku magistrali
+};
+
+// Kody wyniku: 0 = OK, 1-5 = kody Wire.endTransmission(), dalej własne
+#define I2C_BUS_OK 0
+#define I2C_BUS_ERROR_SHORT_READ 6       // mniej bajtów niż readLength
+#define I2C_BUS_ERROR_CALL 7             // funkcja I2C_TXN_CALL zwróciła błąd
+#define I2C_BUS_ERROR_QUEUE 8            // kolejka pełna / brak semafora klienta
+
+typedef int (*I2CBusFunction)(void* context);   // 0 = OK
+
+struct I2CTransaction {
+    I2CTransactionType type;
+    uint8_t address;             // też klucz statystyk urządzenia (I2C_TXN_CALL)
+    const uint8_t* writeData;
+    size_t writeLength;
+    uint8_t* readData;
+    size_t readLength;
+    uint16_t waitMs;             // I2C_TXN_CONVERT_READ - czas konwersji
+    I2CBusFunction function;     // I2C_TXN_CALL
+    void* context;
+    // Wypełnia menedżer
+    int result;
+    size_t received;
+    uint32_t submitMicros;
+    uint32_t dueMicros;
+    SemaphoreHandle_t done;
+};
+
+struct I2CDeviceStats {
+    uint8_t address;
+    uint32_t transactions;
+    uint32_t errors;
+    uint32_t latencyLast;        // µs - od wstawienia do kolejki do wyniku (kolejka + konwersja + magistrala)
+    uint32_t latencyMax;
+    float latencyAvg;            // średnia wykładnicza (~100 transakcji)
+    uint64_t busMicros;          // czas zajęcia magistrali
+};
+
+struct I2CBusStats {
+    uint32_t transactions;
+    uint32_t errors;
+    uint32_t batches;            // wybudzenia tasku z co najmniej jedną transakcją
+    uint32_t maxBatch;           // najwięcej transakcji wykonanych jedna za drugą
+    uint32_t queueFull;          // wstawienia, które czekały na miejsce w kolejce
+    uint8_t queuePeak[I2C_PRIORITY_COUNT];
+    uint8_t pendingPeak;
+    uint64_t busMicros;
+    uint32_t startMillis;
+};
+
+// Task magistrali - po Wire.begin() w initializeI2C()
+bool initializeI2CBus();
+
+// Wykonaj transakcję i czekaj na wynik (kod I2C_BUS_*). Transakcja i bufory należą do wołającego.
+int i2cBusTransfer(I2CTransaction& txn, I2CBusPriority priority = I2C_PRIORITY_NORMAL);
+
+int i2cBusWrite(uint8_t address, const uint8_t* data, size_t length, I2CBusPriority priority = I2C_PRIORITY_NORMAL);
+int i2cBusRead(uint8_t address, uint8_t* data, size_t length, I2CBusPriority priority = I2C_PRIORITY_NORMAL);
+int i2cBusWriteRead(uint8_t address, const uint8_t* writeData, size_t writeLength, uint8_t* readData, size_t readLength,
+                    I2CBusPriority priority = I2C_PRIORITY_NORMAL);
+int i2cBusConvertRead(uint8_t address, const uint8_t* writeData, size_t writeLength, uint16_t waitMs,
+                      uint8_t* readData, size_t readLength, I2CBusPriority priority = I2C_PRIORITY_NORMAL);
+// Kod biblioteki (Wire w środku) na tasku magistrali
+int i2cBusCall(uint8_t address, I2CBusFunction function, void* context, I2CBusPriority priority = I2C_PRIORITY_NORMAL);
+// Obecność urządzenia (zapis 0 bajtów) - skany adresów
+bool i2cBusProbe(uint8_t address, I2CBusPriority priority = I2C_PRIORITY_LOW);
+
+I2CBusStats getI2CBusStats();
+float getI2CBusUtilization();            // 0-1 od startu
+size_t getI2CDeviceCount();
+bool getI2CDeviceStats(size_t index, I2CDeviceStats& stats);
+
+String getI2CBusStatus();
+
+#endif // I2C_BUS_H
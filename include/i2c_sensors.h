@@ -5,8 +5,8 @@
 #include "config.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
-#include <freertos/semphr.h>
 #include <SensirionI2cScd4x.h>
+#include <i2c_bus.h>
 
 // I2C sensor functions
 void initializeI2C();
@@ -14,9 +14,12 @@ bool initializeI2CSensor(I2CSensorType sensorType);
 void enableI2CSensor(I2CSensorType sensorType);
 void disableI2CSensor(I2CSensorType sensorType);
 
-// I2C sensor reading functions
-void readI2CSensors();
-void readBatteryVoltage();
+// I2C sensor reading functions - okresy wyznacza planista loop() (scheduler.h)
+void readI2CSensors();          // SHT30/BME280/SCD41 + SHT40
+void readMCP3424Sensor();       // świeżość danych MCP3424 (konwersje w mcp3424ConversionTask)
+void readSPS30Sensor();
+void readBatteryVoltage();      // ADS1110 + INA219
+void retryFailedI2CSensors();
 bool initializeSCD41();
 bool readSHT30(I2CSensorData& data);
 bool readBME280(I2CSensorData& data);
@@ -24,16 +27,29 @@ bool readSCD41(I2CSensorData& data);
 bool readSHT40(SHT40Data& data);
 
 // ADC sensor reading functions
-bool readMCP3424(MCP3424Data& data);
-bool startMCP3424Conversion(MCP3424Data& data);
-bool readMCP3424Results(MCP3424Data& data);
 void mcp3424ConversionTask(void* parameters);
+
+// Statystyki silnika konwersji MCP3424 (per układ)
+struct MCP3424DeviceStats {
+    uint8_t address;
+    uint32_t conversions;        // kanały odczytane z RDY=0
+    uint32_t notReady;           // odczyty z RDY=1 (wynik jeszcze nie gotowy)
+    uint32_t timeouts;           // brak RDY po 2x nominalnym czasie konwersji
+    uint32_t errors;             // błędy magistrali
+    uint32_t cycles;
+    uint32_t lastCycleMicros;    // 4 kanały układu
+};
+
+uint8_t getMCP3424DeviceCount();
+bool getMCP3424DeviceStats(uint8_t device, MCP3424DeviceStats& stats);
+String getMCP3424Status();
 bool readADS1110(ADS1110Data& data);
 bool readINA219(INA219Data& data);
 
 // ADC sensor configuration functions
 void configureADS1110(uint8_t dataRate, uint8_t gain);
 void setMCP3424Debug(bool enabled);
+void applyMCP3424Resolution();  // po zmianie mcp3424Config.devices[].resolution
 void resetSCD41();
 
 // SCD41 task function
@@ -55,12 +71,9 @@ extern ADS1110Data ads1110Data;
 extern INA219Data ina219Data;
 extern SHT40Data sht40Data;
 
-// I2C semaphore and task management
-extern SemaphoreHandle_t i2c_semaphore;
+// Task management (dostęp do magistrali przez menedżer - i2c_bus.h)
 extern TaskHandle_t mcp3424_task_handle;
 extern TaskHandle_t scd41_task_handle;
-extern volatile bool mcp3424_conversion_in_progress;
-extern volatile unsigned long mcp3424_conversion_start_time;
 
 // Timeout constants
 #define I2C_TIMEOUT_MS 100
@@ -0,0 +1,77 @@
+#ifndef JSON_ARENA_H
+#define JSON_ARENA_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Alokatory ArduinoJson poza wewnętrznym heapem.
+// - SpiRamJsonDocument: pamięć z PSRAM (dokumenty długowieczne, wielokrotnego użytku)
+// - ArenaJsonDocument: arena PSRAM przypisana do taska, resetowana po każdym żądaniu;
+//   w taskach bez areny (np. async_tcp) alokacja trafia bezpośrednio do PSRAM.
+
+#define JSON_ARENA_MAX_TASKS 4
+#define JSON_ARENA_ALIGN 8
+
+// Arena typu bump-pointer w PSRAM - zwolnienie pojedynczego bloku jest no-op
+// (poza ostatnim blokiem), całość zwalniana przez reset()
+class JsonArena {
+public:
+    bool begin(size_t capacity);
+    void* allocate(size_t size);
+    void* reallocate(void* ptr, size_t newSize);
+    void release(void* ptr);
+    bool owns(const void* ptr) const;
+    size_t blockSize(const void* ptr) const;
+    void reset();
+
+    bool isReady() const { return base != nullptr; }
+    size_t getCapacity() const { return capacity; }
+    size_t getUsed() const { return offset; }
+    size_t getHighWater() const { return highWater; }
+    uint32_t getResets() const { return resets; }
+    uint32_t getOverflows() const { return overflows; }
+    bool isPsram() const { return psram; }
+
+private:
+    uint8_t* base = nullptr;
+    size_t capacity = 0;
+    size_t offset = 0;
+    size_t lastBlock = 0;     // offset nagłówka ostatniego bloku (realokacja w miejscu)
+    size_t highWater = 0;
+    uint32_t resets = 0;
+    uint32_t overflows = 0;   // żądania, które nie zmieściły się w arenie
+    bool psram = false;
+};
+
+// Przypisanie areny do bieżącego taska (wywołać raz na starcie taska)
+JsonArena* attachJsonArena(size_t capacity);
+JsonArena* currentJsonArena();
+void resetJsonArena();
+
+// Alokacja poza areną: PSRAM, awaryjnie wewnętrzny heap (liczone w statystykach)
+void* jsonPsramAllocate(size_t size);
+void* jsonPsramReallocate(void* ptr, size_t newSize);
+void jsonPsramFree(void* ptr);
+
+struct SpiRamAllocator {
+    void* allocate(size_t size) { return jsonPsramAllocate(size); }
+    void deallocate(void* ptr) { jsonPsramFree(ptr); }
+    void* reallocate(void* ptr, size_t newSize) { return jsonPsramReallocate(ptr, newSize); }
+};
+
+struct ArenaAllocator {
+    JsonArena* arena;
+
+    ArenaAllocator() : arena(currentJsonArena()) {}
+
+    void* allocate(size_t size);
+    void deallocate(void* ptr);
+    void* reallocate(void* ptr, size_t newSize);
+};
+
+typedef BasicJsonDocument<SpiRamAllocator> SpiRamJsonDocument;
+typedef BasicJsonDocument<ArenaAllocator> ArenaJsonDocument;
+
+String getJsonArenaStatus();
+
+#endif // JSON_ARENA_H
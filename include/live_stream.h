@@ -0,0 +1,70 @@
+#ifndef LIVE_STREAM_H
+#define LIVE_STREAM_H
+
+#include <Arduino.h>
+#include <config.h>
+
+// Strumień surowych próbek z toru akwizycji (tryb live do kalibracji).
+// Producenci (loop, task MCP3424) wpisują próbki do pierścienia bez blokad,
+// WebSocket task co 250 ms - 1 s składa z nich ramki dla klientów.
+// Pierścień nadpisuje najstarsze próbki - producent nigdy nie czeka.
+
+#define LIVE_STREAM_RING_SIZE 1024       // potęga 2
+#define LIVE_STREAM_MIN_INTERVAL 250     // ms
+#define LIVE_STREAM_MAX_INTERVAL 1000    // ms
+
+enum LiveChannel : uint8_t {
+    LIVE_SPS30_PM1 = 0,
+    LIVE_SPS30_PM25,
+    LIVE_SPS30_PM4,
+    LIVE_SPS30_PM10,
+    LIVE_SHT40_TEMPERATURE,
+    LIVE_SHT40_HUMIDITY,
+    LIVE_SHT40_PRESSURE,
+    LIVE_MCP3424_BASE,                   // + device * 4 + channel
+    LIVE_CHANNEL_COUNT = LIVE_MCP3424_BASE + MAX_MCP3424_DEVICES * 4
+};
+
+struct LiveSample {
+    uint32_t timestamp;    // millis()
+    float value;
+    uint8_t channel;
+};
+
+// Maska kanałów (LIVE_CHANNEL_COUNT <= 64)
+struct LiveChannelMask {
+    uint32_t bits[2];
+};
+
+bool initializeLiveStream();
+
+// Producent - no-op, gdy żaden klient nie słucha kanału
+extern volatile uint32_t liveStreamChannelMask[2];
+void pushLiveSampleSlow(uint8_t channel, float value);
+
+static inline void pushLiveSample(uint8_t channel, float value) {
+    if ((liveStreamChannelMask[channel >> 5] >> (channel & 31)) & 1) {
+        pushLiveSampleSlow(channel, value);
+    }
+}
+
+// Konsument - kursor to numer następnej próbki do odczytu.
+// Zwraca liczbę odczytanych próbek; lost - próbki nadpisane przed odczytem
+uint32_t getLiveStreamHead();
+size_t readLiveSamples(uint32_t& cursor, LiveSample* out, size_t maxSamples, uint32_t& lost);
+
+// Maska kanałów aktywnych u producentów (suma masek klientów)
+void setLiveStreamChannelMask(const LiveChannelMask& mask);
+
+// Nazwy kanałów: "sps30.PM25", "sht40.temperature", "mcp3424.0x68.ch1"
+bool liveChannelName(uint8_t channel, char* out, size_t len);
+// Selektor: "sps30", "sps30.PM25", "mcp3424", "mcp3424.0x68", "mcp3424.0x68.ch1"
+bool addLiveChannelSelector(LiveChannelMask& mask, const char* selector);
+
+static inline bool liveMaskHas(const LiveChannelMask& mask, uint8_t channel) {
+    return (mask.bits[channel >> 5] >> (channel & 31)) & 1;
+}
+
+String getLiveStreamStatus();
+
+#endif // LIVE_STREAM_H
@@ -0,0 +1,11 @@
+#ifndef LOOP_JOBS_H
+#define LOOP_JOBS_H
+
+#include <Arduino.h>
+
+// Zadania loop() w planiście (scheduler.h): odczyty czujników, Modbus, komendy, średnie,
+// historia, snapshot telemetrii, auto-reset. Wołane raz, na końcu setup() (loopTask).
+// Zwraca liczbę zarejestrowanych zadań.
+size_t registerLoopJobs();
+
+#endif // LOOP_JOBS_H
@@ -12,6 +12,9 @@ void initializeMovingAverages();
 // Update moving averages with new sensor data
 void updateMovingAverages();
 
+// Generation counter, incremented on every update (response cache invalidation)
+uint32_t getAveragesGeneration();
+
 // Print status of moving average buffers
 void printMovingAverageStatus();
 
@@ -0,0 +1,27 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+
+// Endpoint /metrics w formacie OpenMetrics (Prometheus).
+// Tekst renderowany bez ArduinoJson do jednego bufora PSRAM zaalokowanego przy starcie;
+// bufor jest zajęty do końca wysyłki odpowiedzi (równoległy scrape dostaje 503).
+
+#define METRICS_BUFFER_SIZE (40 * 1024)
+#define METRICS_BUSY_TIMEOUT 10000   // ms - zerwana wysyłka zwalnia bufor po tym czasie
+#define METRICS_CONTENT_TYPE "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+bool initializeMetrics();
+
+// Czas jednej iteracji loop() (wywoływane z main loop)
+void recordLoopTime(uint32_t micros);
+
+// Renderuje metryki do bufora; false gdy bufor zajęty lub za mały.
+// Po wysłaniu odpowiedzi trzeba wywołać releaseMetricsBuffer(token) - zwolnienie
+// z nieaktualnym tokenem (np. podwójne, z onDisconnect) jest ignorowane
+bool renderMetrics(const char*& data, size_t& length, uint32_t& token);
+void releaseMetricsBuffer(uint32_t token);
+
+String getMetricsStatus();
+
+#endif // METRICS_H
@@ -5,6 +5,18 @@
 #include <ModbusSerial.h>
 #include "config.h"
 #include "sensors.h"
+#include "modbus_map.h"
+#include "modbus_pdu.h"
+
+// Task Modbus RTU - budzony zdarzeniem UART (koniec ramki = RX timeout), niezależny od loop()
+#define MODBUS_TASK_STACK_SIZE 6144      // bufory ramki + rekord historii (FC 0x14) na stosie
+#define MODBUS_TASK_PRIORITY 3          // wyżej niż loopTask (1) - odpowiedź nie czeka na odczyty czujników
+#define MODBUS_TASK_CORE 1
+#define MODBUS_RX_TIMEOUT_SYMBOLS 4     // cisza na linii ~t3.5 = koniec ramki RTU
+#define MODBUS_TASK_IDLE_TIMEOUT 100    // ms - zabezpieczenie przed zgubionym zdarzeniem
+#define MODBUS_LATENCY_WINDOW 256       // ostatnie ramki do percentyli
+#define MODBUS_DIAG_INTERVAL 1000       // ms - odświeżanie bloku diagnostycznego
+#define MODBUS_SHADOW_HOLD 60000        // ms - bank cienia odświeżany, dopóki master go czyta
 
 // Data type enumeration
 enum DataType {
@@ -14,6 +26,7 @@ enum DataType {
 };
 
 // Function declarations
+void registerModbusCommands();     // przy starcie, niezależnie od config.enableModbus
 void initializeModbus();
 void updateModbusSolarRegisters();
 void updateModbusOPCN3Registers();
@@ -28,6 +41,55 @@ void updateModbusHCHORegisters();
 void updateModbusCalibrationRegisters();
 void processModbusTask();
 
+// Odświeża tylko banki rejestrów, których dane źródłowe (odczyt, średnie, DataType)
+// zmieniły się od poprzedniego zapisu - wywoływane z loop() zamiast updateModbus*Registers()
+void updateModbusRegisters();
+
+// Statystyki odświeżania banku (cykle CPU z ESP.getCycleCount)
+struct ModbusBankStats {
+    const char* name;
+    uint32_t refreshes;
+    uint32_t skips;          // przebiegi bez zmian - zapis pominięty
+    uint32_t avgCycles;      // średni koszt odświeżenia
+};
+size_t getModbusBankCount();
+bool getModbusBankStats(size_t index, ModbusBankStats& stats);
+uint32_t getModbusCyclesSavedPerLoop();
+String getModbusStatus();
+
+// Opóźnienie odpowiedzi RTU [µs] od końca ramki żądania do wysłania odpowiedzi (okno ostatnich ramek)
+struct ModbusLatencyStats {
+    uint32_t samples;
+    uint32_t p50;
+    uint32_t p90;
+    uint32_t p99;
+    uint32_t max;
+    uint32_t frames;         // wszystkie obsłużone ramki
+    bool eventDriven;        // false = fallback: mb.task() z loop()
+};
+void getModbusLatencyStats(ModbusLatencyStats& stats);
+
+// Publikacja banków z bufora roboczego do rejestrów (atomowo względem obsługi ramki)
+struct ModbusImageStats {
+    uint32_t publishes;
+    uint32_t words;          // przepisane rejestry (tylko zmienione)
+    uint32_t maxLockCycles;  // najdłuższa publikacja pod mutexem
+};
+void getModbusImageStats(ModbusImageStats& stats);
+
+// Banki cienia (MODBUS_SHADOW_BASE) - odświeżane tylko banki czytane w ostatnich MODBUS_SHADOW_HOLD ms
+struct ModbusShadowStats {
+    bool allocated;          // obraz tworzony przy pierwszym odczycie
+    uint32_t activeBanks;    // banki czytane niedawno
+    uint32_t refreshes;
+    uint32_t reads;
+};
+bool getModbusShadowStats(DataType type, ModbusShadowStats& stats);
+
+// Dostęp do obrazu rejestrów dla Modbus TCP (ModbusRegisterAccess) - zwraca kod wyjątku Modbus
+uint8_t readModbusImage(uint16_t start, uint16_t count, uint16_t* out);
+uint8_t writeModbusImage(uint16_t start, uint16_t count, const uint16_t* values);
+
 // Data type control functions
 bool setCurrentDataType(DataType newType);
 String getCurrentDataTypeName();
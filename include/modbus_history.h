@@ -0,0 +1,55 @@
+#ifndef MODBUS_HISTORY_H
+#define MODBUS_HISTORY_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "modbus_map.h"
+
+// ===== Historia przez Modbus (FC 0x14 Read File Record) =====
+// Plik = jeden bufor SensorHistory: plik 1 + 2 * źródło (+1 dla slow), źródła w kolejności
+// eksportu binarnego (solar, i2c, sps30, ips, mcp3424, ads1110, power, sht40, calibration,
+// hcho, fan, battery). Rekord pliku = próbka; numer rekordu = numer próbki % 10000, więc
+// nie zmienia się, gdy bufor kołowy przesuwa się w trakcie pobierania. Odczyt count rejestrów
+// od rekordu N przechodzi przez kolejne próbki (N, N+1, ...).
+// Zawartość rekordu = bajty rekordu eksportu (u32 timestamp LE + struktura czujnika, schemat
+// jak w /api/history/export), po dwa bajty na rejestr w kolejności strumienia; nieparzysty
+// rozmiar dopełniony zerem. Próbka nadpisana w trakcie odczytu = same zera (timestamp 0).
+
+#define MODBUS_HISTORY_RECORD_WRAP 10000
+#define MODBUS_HISTORY_FILE_COUNT 24
+
+// Blok wyszukiwania (offsety od MODBUS_HISTORY_BASE_REG). Zapis pliku albo czasu (FC06/FC16)
+// uruchamia wyszukiwanie binarne pierwszej próbki z timestamp >= czas; wynik jest w rejestrach
+// przed odpowiedzią na zapis.
+#define MB_HISTORY_FILE           0     // zapis: numer pliku
+#define MB_HISTORY_TIME           1     // zapis: czas (2 rejestry, młodsze słowo pierwsze)
+#define MB_HISTORY_STATUS         3     // ModbusHistoryQueryStatus
+#define MB_HISTORY_RECORD         4     // rekord pierwszej próbki >= czas
+#define MB_HISTORY_AVAILABLE      5     // próbki od tego rekordu do najnowszej
+#define MB_HISTORY_RECORD_REGS    6     // rejestry na rekord
+#define MB_HISTORY_OLDEST_RECORD  7
+#define MB_HISTORY_COUNT          8     // próbki w pliku
+#define MB_HISTORY_OLDEST_TIME    9     // 2 rejestry
+#define MB_HISTORY_NEWEST_TIME    11    // 2 rejestry
+#define MB_HISTORY_TIME_BASE      13    // 1 = epoch, 0 = sekundy od startu
+#define MB_HISTORY_QUERIES        14    // licznik wyszukiwań - potwierdzenie nowego wyniku
+#define MB_HISTORY_QUERY_REGS     3     // rejestry zapytania (plik + czas)
+
+enum ModbusHistoryQueryStatus : uint16_t {
+    MB_HISTORY_OK = 0,
+    MB_HISTORY_NO_FILE = 1,      // zły numer pliku albo historia wyłączona
+    MB_HISTORY_NO_DATA = 2       // brak próbek >= czas (rekord = następna próbka)
+};
+
+// Callback ModbusRegisterAccess::readFile - zwraca kod wyjątku Modbus
+uint8_t readModbusHistoryFile(uint16_t file, uint16_t record, uint16_t count, uint16_t* out);
+
+// query = rejestry MB_HISTORY_FILE..MB_HISTORY_TIME+1; wynik w result (REG_COUNT_MODBUS_HISTORY)
+void evaluateModbusHistoryQuery(const uint16_t* query, uint16_t* result);
+
+// Opis plików dla mapy getModbusMap
+void getModbusHistoryFilesJson(JsonArray files);
+
+String getModbusHistoryStatus();
+
+#endif // MODBUS_HISTORY_H
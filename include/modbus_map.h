@@ -0,0 +1,116 @@
+#ifndef MODBUS_MAP_H
+#define MODBUS_MAP_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// ===== Deklaratywna mapa rejestrów Modbus =====
+// Jedna tabela opisuje każdy rejestr danych: adres w bloku, pole struktury źródłowej (offsetof),
+// typ, skalę i jednostkę. Z tej samej tabeli korzysta ogólny updater (stageModbusFields) i mapa
+// publikowana komendą WebSocket getModbusMap - dokumentacja nie rozjedzie się z kodem.
+// Rejestry MB_SRC_NONE są tylko opisane - wartości liczy kod banku (Stringi solara, biblioteka
+// OPCN3, zegar, bateria).
+
+// Początki bloków (offsety jak w dotychczasowym kodzie)
+#define MODBUS_BASE_SOLAR       0
+#define MODBUS_BASE_OPCN3       (REG_COUNT_SOLAR)
+#define MODBUS_BASE_CONTROL     (REG_COUNT_SOLAR + REG_COUNT_OPCN3)        // +1 komendy, +2 typ danych
+#define MODBUS_BASE_I2C         (MODBUS_BASE_CONTROL + 3)
+#define MODBUS_BASE_IPS         (REG_COUNT_SOLAR + REG_COUNT_OPCN3 + REG_COUNT_I2C)
+#define MODBUS_BASE_MCP3424     (MODBUS_BASE_IPS + REG_COUNT_IPS)
+#define MODBUS_BASE_ADS1110     (MODBUS_BASE_MCP3424 + REG_COUNT_MCP3424)
+#define MODBUS_BASE_INA219      (MODBUS_BASE_ADS1110 + REG_COUNT_ADS1110)
+#define MODBUS_BASE_SPS30       (MODBUS_BASE_INA219 + REG_COUNT_INA219)
+#define MODBUS_BASE_SHT40       (MODBUS_BASE_SPS30 + REG_COUNT_SPS30)
+#define MODBUS_BASE_HCHO        (MODBUS_BASE_SHT40 + REG_COUNT_SHT40)
+#define MODBUS_BASE_CALIBRATION (MODBUS_BASE_HCHO)                         // historycznie ten sam adres co HCHO
+// Blok diagnostyczny (REG_COUNT_MODBUS_DIAG rejestrów za wszystkimi blokami czujników)
+#define MODBUS_DIAG_BASE_REG    (REG_COUNT_SOLAR + REG_COUNT_OPCN3 + REG_COUNT_I2C + REG_COUNT_IPS + REG_COUNT_MCP3424 + \
+                                 REG_COUNT_ADS1110 + REG_COUNT_INA219 + REG_COUNT_SPS30 + REG_COUNT_SHT40 + \
+                                 REG_COUNT_HCHO + REG_COUNT_CALIBRATION)
+#define MODBUS_HISTORY_BASE_REG (MODBUS_DIAG_BASE_REG + REG_COUNT_MODBUS_DIAG)
+#define MODBUS_REG_TOTAL        (MODBUS_HISTORY_BASE_REG + REG_COUNT_MODBUS_HISTORY)
+// Banki cienia: kopia bloków czujników (0 .. MODBUS_DIAG_BASE_REG-1) w stałym typie danych,
+// niezależnie od rejestru 102 - rejestr X typu t pod adresem MODBUS_SHADOW_BASE + t * STRIDE + X
+// (1000 bieżące, 2000 średnie 10 s, 3000 średnie 5 min). Tylko odczyt, poza rejestrami ModbusSerial.
+#define MODBUS_SHADOW_BASE      1000
+#define MODBUS_SHADOW_STRIDE    1000
+#define MODBUS_SHADOW_SIZE      MODBUS_DIAG_BASE_REG
+#define MODBUS_SHADOW_VIEWS     3                                          // DATA_CURRENT .. DATA_SLOW_AVG
+#define MODBUS_HEADER_REGS      4                                          // status, typ danych, timestamp (2)
+
+// Typ pola źródłowego - z typu C++ (modbusSourceType)
+enum ModbusSourceType : uint8_t {
+    MB_SRC_NONE = 0,    // wartość liczona w kodzie banku
+    MB_SRC_F32,
+    MB_SRC_U8,
+    MB_SRC_I8,
+    MB_SRC_U16,
+    MB_SRC_I16,
+    MB_SRC_U32,
+    MB_SRC_I32,
+    MB_SRC_U64,
+    MB_SRC_I64,
+    MB_SRC_BOOL
+};
+
+// Format w rejestrach; 32-bit = dwa rejestry, młodsze słowo pierwsze
+enum ModbusRegType : uint8_t {
+    MB_REG_U16 = 0,
+    MB_REG_I16,
+    MB_REG_U32,
+    MB_REG_I32,
+    MB_REG_AGE          // sekundy od znacznika millis() w polu źródłowym
+};
+
+#define MB_NO_GATE 0xFFFF
+
+struct ModbusRegisterDef {
+    uint16_t reg;       // offset w bloku
+    uint16_t source;    // offsetof pola w strukturze danych
+    uint16_t gate;      // offsetof pola bool - false = rejestry zerowane; MB_NO_GATE = zawsze
+    uint8_t sourceType;
+    uint8_t regType;
+    uint8_t count;      // elementy tablicy - kolejne rejestry
+    float scale;
+    const char* name;
+    const char* unit;
+};
+
+struct ModbusBankDef {
+    const char* name;
+    uint16_t base;
+    uint16_t size;
+    bool header;        // rejestry 0-3 bloku: status, typ danych, timestamp
+    const ModbusRegisterDef* fields;
+    uint16_t fieldCount;
+};
+
+enum ModbusMapBank : uint8_t {
+    MAP_SOLAR = 0,
+    MAP_OPCN3,
+    MAP_CONTROL,
+    MAP_I2C,
+    MAP_IPS,
+    MAP_MCP3424,
+    MAP_ADS1110,
+    MAP_INA219,
+    MAP_SPS30,
+    MAP_SHT40,
+    MAP_HCHO,
+    MAP_CALIBRATION,
+    MAP_DIAGNOSTICS,
+    MAP_HISTORY,
+    MAP_BANK_COUNT
+};
+
+const ModbusBankDef& getModbusBankDef(ModbusMapBank bank);
+
+// Zapis pól banku z tabeli do obrazu rejestrów (indeks = adres Modbus)
+void stageModbusFields(ModbusMapBank bank, const void* data, uint16_t* image);
+
+// Mapa dla komendy WebSocket getModbusMap
+void getModbusMapJson(JsonObject root);
+
+#endif // MODBUS_MAP_H
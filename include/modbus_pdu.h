@@ -0,0 +1,77 @@
+#ifndef MODBUS_PDU_H
+#define MODBUS_PDU_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== Obsługa PDU Modbus niezależna od transportu =====
+// Bez Arduino/FreeRTOS - ten sam kod obsługuje Modbus RTU (modbusTask) i TCP na ESP32 oraz build
+// hostowy (host/modbus_tcp_host.cpp). Dostęp do rejestrów przez callbacki - na urządzeniu obraz
+// rejestrów z modbus_handler.cpp (readModbusImage/writeModbusImage) i pliki historii (modbus_history.cpp).
+
+#define MODBUS_FC_READ_HOLDING      0x03
+#define MODBUS_FC_WRITE_SINGLE      0x06
+#define MODBUS_FC_WRITE_MULTIPLE    0x10
+#define MODBUS_FC_READ_FILE_RECORD  0x14
+
+#define MODBUS_EX_NONE              0x00
+#define MODBUS_EX_ILLEGAL_FUNCTION  0x01
+#define MODBUS_EX_ILLEGAL_ADDRESS   0x02
+#define MODBUS_EX_ILLEGAL_VALUE     0x03
+#define MODBUS_EX_DEVICE_FAILURE    0x04
+
+#define MODBUS_MAX_READ_REGS        125
+#define MODBUS_MAX_WRITE_REGS       123
+#define MODBUS_MAX_PDU              253
+#define MODBUS_FILE_REFERENCE_TYPE  6
+#define MODBUS_MAX_FILE_RECORD      9999    // numery rekordów 0-9999 (specyfikacja)
+#define MODBUS_FILE_SUBREQUEST_SIZE 7       // typ odwołania, plik, rekord, długość
+
+// MBAP: transaction id (2), protocol id (2, = 0), długość (2, unit + PDU), unit id (1)
+#define MODBUS_TCP_MBAP_SIZE        7
+#define MODBUS_TCP_MAX_ADU          (MODBUS_TCP_MBAP_SIZE + MODBUS_MAX_PDU)
+
+// RTU: adres (1) + PDU + CRC16 (2, młodszy bajt pierwszy)
+#define MODBUS_RTU_MAX_ADU          (1 + MODBUS_MAX_PDU + 2)
+#define MODBUS_RTU_BROADCAST        0
+
+// Callbacki zwracają kod wyjątku (MODBUS_EX_NONE = OK)
+struct ModbusRegisterAccess {
+    uint8_t (*read)(uint16_t start, uint16_t count, uint16_t* out);
+    uint8_t (*write)(uint16_t start, uint16_t count, const uint16_t* values);
+    // FC 0x14 - count rejestrów pliku od rekordu record; NULL = funkcja nieobsługiwana
+    uint8_t (*readFile)(uint16_t file, uint16_t record, uint16_t count, uint16_t* out);
+};
+
+// Żądanie PDU (kod funkcji + dane) -> odpowiedź PDU; zwraca długość odpowiedzi.
+// Wyjątek: kod funkcji | 0x80 + kod wyjątku (*exception ustawiony, gdy podany)
+size_t processModbusPdu(const uint8_t* request, size_t length, uint8_t* response,
+                        const ModbusRegisterAccess& access, uint8_t* exception = NULL);
+
+enum ModbusTcpFrame : uint8_t {
+    MBTCP_INCOMPLETE = 0,    // za mało bajtów - czekać na kolejny segment
+    MBTCP_RESPONSE,          // ramka obsłużona, odpowiedź w tx
+    MBTCP_INVALID            // zły protocol id / długość - rozłączyć klienta
+};
+
+// Jedna ramka ADU z początku bufora (kolejne ramki w buforze = pipelining).
+// consumed - bajty ramki do usunięcia z bufora; tx musi mieć MODBUS_TCP_MAX_ADU bajtów
+ModbusTcpFrame processModbusTcpAdu(const uint8_t* rx, size_t length, size_t& consumed,
+                                   uint8_t* tx, size_t& txLength,
+                                   const ModbusRegisterAccess& access, uint8_t* exception = NULL);
+
+enum ModbusRtuFrame : uint8_t {
+    MBRTU_RESPONSE = 0,      // odpowiedź w tx
+    MBRTU_NO_RESPONSE,       // inny adres slave albo broadcast (zapis wykonany, bez odpowiedzi)
+    MBRTU_CRC_ERROR,         // ramka odrzucona - bez odpowiedzi
+    MBRTU_INVALID            // za krótka / za długa ramka
+};
+
+uint16_t modbusCrc16(const uint8_t* data, size_t length);
+
+// Cała ramka RTU (adres + PDU + CRC) -> odpowiedź; tx musi mieć MODBUS_RTU_MAX_ADU bajtów
+ModbusRtuFrame processModbusRtuFrame(const uint8_t* rx, size_t length, uint8_t slaveId,
+                                     uint8_t* tx, size_t& txLength,
+                                     const ModbusRegisterAccess& access, uint8_t* exception = NULL);
+
+#endif // MODBUS_PDU_H
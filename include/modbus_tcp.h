@@ -0,0 +1,30 @@
+#ifndef MODBUS_TCP_H
+#define MODBUS_TCP_H
+
+#include <Arduino.h>
+#include "modbus_pdu.h"
+
+// Serwer Modbus TCP - ten sam obraz rejestrów co Modbus RTU (modbus_handler.cpp).
+// Połączenia obsługuje task AsyncTCP; każdy segment może nieść kilka żądań (pipelining),
+// odpowiedzi idą w jednej wysyłce w kolejności żądań.
+
+#define MODBUS_TCP_PORT 502
+#define MODBUS_TCP_MAX_CLIENTS 4
+#define MODBUS_TCP_RX_BUFFER 2048       // niedokończona ramka + żądania czekające na miejsce w buforze TCP
+#define MODBUS_TCP_IDLE_TIMEOUT 120     // s - rozłączenie bezczynnego klienta
+
+struct ModbusTcpStats {
+    uint32_t clients;        // aktywne połączenia
+    uint32_t connections;    // przyjęte od startu
+    uint32_t rejected;       // odrzucone - brak wolnego slotu
+    uint32_t requests;
+    uint32_t exceptions;     // odpowiedzi z kodem wyjątku
+    uint32_t frameErrors;    // zły nagłówek MBAP / przepełnienie bufora - klient rozłączony
+    uint32_t maxPipelined;   // najwięcej żądań obsłużonych z jednego segmentu
+};
+
+void initializeModbusTcp();
+void getModbusTcpStats(ModbusTcpStats& stats);
+String getModbusTcpStatus();
+
+#endif // MODBUS_TCP_H
@@ -23,6 +23,7 @@ bool loadSystemConfig(FeatureConfig& config);
 // MCP3424 configuration functions
 bool saveMCP3424Config(const MCP3424Config& config);
 bool loadMCP3424Config(MCP3424Config& config);
+uint8_t validMCP3424Resolution(int bits);
 String getMCP3424ConfigJson();
 void initializeDefaultMCP3424Mapping();
 bool addMCP3424Device(uint8_t deviceIndex, const char* gasType, const char* description, bool enabled);
@@ -0,0 +1,41 @@
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <Arduino.h>
+
+// Cache gotowych odpowiedzi JSON (historia, średnie) w PSRAM.
+// Wpis ważny tylko dla generacji danych, z którą go zapisano - kolejna próbka
+// historii / przeliczenie średnich unieważnia wszystkie starsze wpisy.
+// Wspólny dla WebSocket i HTTP (/api/history - strony wg kursora, limitu i formatu).
+
+#define RESPONSE_CACHE_ENTRIES 8
+#define RESPONSE_CACHE_KEY_LEN 96
+#define RESPONSE_CACHE_MAX_SIZE 16384   // większe odpowiedzi nie są cache'owane
+
+bool initializeResponseCache();
+
+// Zwraca true i kopię odpowiedzi, gdy wpis istnieje dla tej generacji.
+// meta - dodatkowa wartość zapisana z odpowiedzią (np. liczba próbek)
+bool responseCacheGet(const String& key, uint32_t generation, String& out, uint32_t* meta = nullptr);
+void responseCachePut(const String& key, uint32_t generation, const String& value, uint32_t meta = 0);
+
+// Trafienie jako kopia w PSRAM (bez Stringa na stercie wewnętrznej); zwalnia wołający (heap_caps_free)
+bool responseCacheGetBuffer(const String& key, uint32_t generation, char*& data, size_t& length, uint32_t* meta = nullptr);
+
+// Zapis odpowiedzi wysyłanej fragmentami (strumień HTTP) prosto do bufora wpisu w PSRAM.
+// Wpis niewidoczny do responseCacheEndWrite(commit = true); przekroczenie RESPONSE_CACHE_MAX_SIZE
+// albo przejęcie wpisu przez inny zapis porzuca zapis (kolejne append zwracają false)
+struct ResponseCacheWriter {
+    int index = -1;
+    uint32_t token = 0;
+};
+
+bool responseCacheBeginWrite(const String& key, uint32_t generation, uint32_t meta, ResponseCacheWriter& writer);
+bool responseCacheAppend(ResponseCacheWriter& writer, const uint8_t* data, size_t length);
+void responseCacheEndWrite(ResponseCacheWriter& writer, bool commit);
+void responseCacheClear();
+
+String getResponseCacheStatus();
+float getResponseCacheHitRatio();
+
+#endif // RESPONSE_CACHE_H
@@ -0,0 +1,54 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+// Kooperacyjny planista zadań loop() - każde zadanie ma okres i termin następnego uruchomienia,
+// terminy w kopcu minimalnym. loop() uruchamia zadania z minionym terminem i śpi (notyfikacja tasku)
+// do najbliższego, zamiast kręcić się co 10 ms i sprawdzać w każdym odczycie własny lastReadTime.
+// Terminy co okres od pierwszego uruchomienia (bez dryfu); zadanie spóźnione o cały okres
+// lub więcej traci zaległe uruchomienia (overrun) i wraca do swojej siatki terminów.
+// Zadania zależne od zdarzeń (np. dane na UART) budzi wakeSchedulerJob() - okres jest wtedy
+// tylko zabezpieczeniem. Statystyki zapisuje tylko loopTask - metrics/status czytają bez blokad.
+
+#define SCHEDULER_MAX_JOBS 24            // <= 32 (maska wybudzeń)
+#define SCHEDULER_MAX_SLEEP 100          // ms - górna granica snu (watchdog loopTask)
+#define SCHEDULER_EARLY_MICROS 1000      // termin bliżej niż 1 tick - uruchom teraz zamiast spać
+
+typedef void (*SchedulerJobFunction)();
+
+struct SchedulerJobStats {
+    const char* name;
+    uint32_t periodMs;
+    uint32_t runs;
+    uint32_t overruns;          // uruchomienia spóźnione o >= okres (pominięte terminy)
+    uint32_t skipped;           // pominięte terminy łącznie
+    uint32_t wakes;             // uruchomienia przed terminem przez wakeSchedulerJob()
+    uint32_t jitterLast;        // µs - opóźnienie startu względem terminu
+    uint32_t jitterMax;
+    float jitterAvg;            // średnia wykładnicza (~100 uruchomień)
+    uint32_t cpuLast;           // µs - czas wykonania
+    uint32_t cpuMax;
+    uint64_t cpuTotal;
+};
+
+// Zadanie uruchamiane co periodMs, pierwsze po offsetMs od rejestracji; -1 gdy brak miejsca.
+// Rejestracja tylko z loopTask (setup()) - tam działa planista
+int addSchedulerJob(const char* name, uint32_t periodMs, SchedulerJobFunction function, uint32_t offsetMs = 0);
+
+// Uruchom zadanie w najbliższym przebiegu i obudź loopTask - z innych tasków i callbacków
+// (np. HardwareSerial::onReceive), nie z ISR
+void wakeSchedulerJob(int job);
+
+// Zadania z minionym terminem (w kolejności terminów), potem powrót - jeden przebieg loop()
+void runSchedulerJobs();
+// Sen do najbliższego terminu (max SCHEDULER_MAX_SLEEP) lub wakeSchedulerJob()
+void sleepUntilNextSchedulerJob();
+
+size_t getSchedulerJobCount();
+bool getSchedulerJobStats(size_t index, SchedulerJobStats& stats);
+uint64_t getSchedulerSleepMicros();
+
+String getSchedulerStatus();
+
+#endif // SCHEDULER_H
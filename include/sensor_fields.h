@@ -0,0 +1,34 @@
+#ifndef SENSOR_FIELDS_H
+#define SENSOR_FIELDS_H
+
+#include <Arduino.h>
+#include <config.h>
+#include <sensors.h>
+#include <calib.h>
+
+// Jeden opis pól każdego typu danych czujnika, używany przez eksport historii
+// (JSON/CSV) i /metrics - nazwy pól identyczne we wszystkich formatach.
+class SensorFieldWriter {
+public:
+    virtual void number(const char* name, float value, uint8_t decimals) = 0;
+    virtual void integer(const char* name, long value) = 0;
+    virtual void flag(const char* name, bool value) = 0;
+    virtual void text(const char* name, const char* value) = 0;
+    // Pole bez aktualnej wartości (np. nieważny układ MCP3424) - CSV trzyma stały zestaw kolumn
+    virtual void missing(const char* name) { (void)name; }
+};
+
+void writeSensorFields(const SolarData& d, SensorFieldWriter& w);
+void writeSensorFields(const SPS30Data& d, SensorFieldWriter& w);
+void writeSensorFields(const INA219Data& d, SensorFieldWriter& w);
+void writeSensorFields(const BatteryData& d, SensorFieldWriter& w);
+void writeSensorFields(const SHT40Data& d, SensorFieldWriter& w);
+void writeSensorFields(const I2CSensorData& d, SensorFieldWriter& w);
+void writeSensorFields(const ADS1110Data& d, SensorFieldWriter& w);
+void writeSensorFields(const HCHOData& d, SensorFieldWriter& w);
+void writeSensorFields(const MCP3424Data& d, SensorFieldWriter& w);
+void writeSensorFields(const IPSSensorData& d, SensorFieldWriter& w);
+void writeSensorFields(const FanData& d, SensorFieldWriter& w);
+void writeSensorFields(const CalibratedSensorData& d, SensorFieldWriter& w);
+
+#endif // SENSOR_FIELDS_H
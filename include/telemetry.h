@@ -0,0 +1,57 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+
+// Centralny snapshot telemetrii (pełny JSON czujników dla broadcastu / HTTP).
+// Pętla główna po odczycie czujników wywołuje updateTelemetrySnapshot(): dla każdej
+// sekcji liczony jest odcisk danych źródłowych, a jego zmiana podbija generację sekcji.
+// Sekcje są trzymane jako gotowe fragmenty JSON - składanie dokumentu serializuje
+// ponownie tylko sekcje, których generacja zmieniła się od ostatniego składania.
+
+enum TelemetrySection : uint8_t {
+    TELEMETRY_SYSTEM = 0,        // t, uptime, heap, WiFi, NTP, history, PSRAM
+    TELEMETRY_SENSORS_ENABLED,
+    TELEMETRY_SOLAR,
+    TELEMETRY_OPCN3,
+    TELEMETRY_SPS30,
+    TELEMETRY_SHT40,
+    TELEMETRY_SCD41,
+    TELEMETRY_MCP3424,
+    TELEMETRY_ADS1110,
+    TELEMETRY_POWER,
+    TELEMETRY_HCHO,
+    TELEMETRY_IPS,
+    TELEMETRY_FAN,
+    TELEMETRY_BATTERY,
+    TELEMETRY_CALIBRATION,
+    TELEMETRY_SECTION_COUNT
+};
+
+#define TELEMETRY_SYSTEM_INTERVAL 1000     // ms - odświeżanie sekcji systemowej
+#define TELEMETRY_JSON_MAX_SIZE 8192       // jak limit broadcastu
+
+bool initializeTelemetry();
+
+// Wywoływane z loop() po odczycie czujników i przeliczeniu średnich
+void updateTelemetrySnapshot();
+
+// Generacja sekcji - rośnie przy każdej zmianie danych sekcji
+uint32_t getTelemetryGeneration(TelemetrySection section);
+// Suma generacji wszystkich sekcji (zmienia się przy dowolnej zmianie)
+uint32_t getTelemetryTotalGeneration();
+const char* getTelemetrySectionName(TelemetrySection section);
+
+// Składa pełny dokument do out (bez terminatora); zwraca długość albo 0,
+// gdy dokument nie mieści się w capacity
+size_t copyTelemetryJson(char* out, size_t capacity);
+bool getTelemetryJson(String& out);
+
+// Delta: obiekt tylko z sekcjami, których generacja różni się od since[]
+// (since == nullptr - wszystkie sekcje). generations[] dostaje generacje wysłanych danych.
+// Zwraca długość, 2 ("{}") gdy brak zmian, 0 gdy nie mieści się w capacity
+size_t copyTelemetryDelta(const uint32_t* since, uint32_t* generations, char* out, size_t capacity);
+
+String getTelemetryStatus();
+
+#endif // TELEMETRY_H
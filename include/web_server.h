@@ -5,12 +5,15 @@
 #include <WiFi.h>
 #include <ESPAsyncWebServer.h>
 #include <Update.h>
+#include <ArduinoJson.h>
 #include "config.h"
 
 // Function declarations
 void initializeWiFi();
 void initializeWebServer();
 void WiFiReconnectTask(void *parameter);
+String getAllSensorJson();
+String getWebAssetStatus();
 
 
 // Global objects
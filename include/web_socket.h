@@ -12,9 +12,9 @@ void broadcastSensorData(AsyncWebSocket& ws);
 // WebSocket Task System
 bool initializeWebSocketTask();
 void stopWebSocketTask();
-bool sendToWebSocketTask(AsyncWebSocketClient* client, const String& message);
+bool sendToWebSocketTask(AsyncWebSocketClient* client, const uint8_t* data, size_t len);
 void webSocketTask(void* parameters);
-void handleWebSocketMessageInTask(AsyncWebSocketClient* client, DynamicJsonDocument& doc);
+void handleWebSocketMessageInTask(AsyncWebSocketClient* client, JsonDocument& doc);
 
 // WebSocket Monitoring i Reset
 void checkHeapAndReset();
@@ -30,6 +30,25 @@ void removeWebSocketClient(AsyncWebSocketClient* client);
 void updateClientPongTime(AsyncWebSocketClient* client);
 void sendNativePing(AsyncWebSocketClient* client);
 
+// Wspolne bufory broadcastu (serializacja raz, fan-out do wszystkich klientow)
+bool initializeBroadcastPool();
+AsyncWebSocketSharedBuffer serializeToBroadcastBuffer(const JsonDocument& doc);
+AsyncWebSocketSharedBuffer fillBroadcastBuffer(size_t (*fill)(char* out, size_t capacity));
+String getBroadcastPoolStatus();
+// Telemetria z wsBroadcastTask - wysyła WebSocket task (processWebSocketBroadcast)
+void queueWebSocketBroadcast(AsyncWebSocketSharedBuffer buffer);
+void processWebSocketBroadcast();
+String getHistoryStreamStatus();
+
+// Subskrypcje klientow (komendy subscribe/unsubscribe)
+void processSubscriptions();
+bool isWebSocketClientSubscribed(uint32_t clientId);
+int getWebSocketSubscriptionCount();
+void clearWebSocketSubscriptions();
+
+// Strumien live surowych probek (komendy liveStream/liveStreamStop)
+void processLiveStreams();
+
 // Główna funkcja obsługi wiadomości WebSocket
 void handleWebSocketMessage(AsyncWebSocketClient* client, void* arg, uint8_t* data, size_t len);
 
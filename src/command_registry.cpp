@@ -0,0 +1,356 @@
+#include <command_registry.h>
+#include <esp_timer.h>
+
+// Forward declarations for safe printing functions
+void safePrint(const String& message);
+void safePrintln(const String& message);
+
+// Wpis rejestru - definicja + statystyki wykonania
+struct CommandEntry {
+    const CommandDef* def;
+    uint32_t calls;
+    uint32_t errors;          // odrzucone argumenty / niedozwolone zrodlo
+    uint64_t totalMicros;
+    uint32_t maxMicros;
+};
+
+#define MODBUS_INDEX_NONE 0xFF
+
+// Indeksy wpisów w uint8_t (sortedIndex, modbusIndex) - 0xFF zarezerwowane jako brak
+static_assert(MAX_REGISTERED_COMMANDS < MODBUS_INDEX_NONE, "Indeks wpisu nie mieści się w uint8_t");
+
+static CommandEntry commandEntries[MAX_REGISTERED_COMMANDS];
+static uint8_t sortedIndex[MAX_REGISTERED_COMMANDS];     // indeksy posortowane po nazwie
+static uint8_t modbusIndex[MAX_MODBUS_COMMAND_CODE + 1];  // kod Modbus -> indeks wpisu (MODBUS_INDEX_NONE = brak)
+static size_t commandCount = 0;
+static bool modbusIndexReady = false;
+
+static const CommandDef* registeredTables[16];
+static size_t registeredTableCount = 0;
+
+static portMUX_TYPE commandStatsMux = portMUX_INITIALIZER_UNLOCKED;
+
+bool registerCommands(const CommandDef* defs, size_t count) {
+    if (!modbusIndexReady) {
+        memset(modbusIndex, MODBUS_INDEX_NONE, sizeof(modbusIndex));
+        modbusIndexReady = true;
+    }
+
+    // Ta sama tabela moze byc rejestrowana wielokrotnie (np. ponowny initializeModbus)
+    for (size_t t = 0; t < registeredTableCount; t++) {
+        if (registeredTables[t] == defs) return true;
+    }
+    if (registeredTableCount >= sizeof(registeredTables) / sizeof(registeredTables[0]) ||
+        commandCount + count > MAX_REGISTERED_COMMANDS) {
+        safePrintln("CommandRegistry: registry full, cannot register " + String(count) + " commands");
+        return false;
+    }
+    registeredTables[registeredTableCount++] = defs;
+
+    for (size_t i = 0; i < count; i++) {
+        const CommandDef* def = &defs[i];
+        size_t entry = commandCount++;
+        commandEntries[entry] = {def, 0, 0, 0, 0};
+
+        // Wstaw do posortowanego indeksu (insertion sort - rejestracja tylko przy starcie)
+        size_t pos = entry;
+        while (pos > 0 && strcmp(commandEntries[sortedIndex[pos - 1]].def->name, def->name) > 0) {
+            sortedIndex[pos] = sortedIndex[pos - 1];
+            pos--;
+        }
+        sortedIndex[pos] = entry;
+
+        if (def->modbusCode > 0 && def->modbusCode <= MAX_MODBUS_COMMAND_CODE) {
+            modbusIndex[def->modbusCode] = entry;
+        }
+    }
+    return true;
+}
+
+static int findCommandExact(const char* name) {
+    int lo = 0;
+    int hi = (int)commandCount - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        int c = strcmp(commandEntries[sortedIndex[mid]].def->name, name);
+        if (c == 0) return sortedIndex[mid];
+        if (c < 0) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return -1;
+}
+
+// Serial: najdluzszy pasujacy prefiks (FAN_SPEED_75 -> FAN_SPEED_)
+static int findCommandPrefix(const char* name) {
+    int best = -1;
+    size_t bestLen = 0;
+    for (size_t i = 0; i < commandCount; i++) {
+        const CommandDef* def = commandEntries[i].def;
+        if (!def->prefix) continue;
+        size_t len = strlen(def->name);
+        if (len > bestLen && strncmp(name, def->name, len) == 0) {
+            best = i;
+            bestLen = len;
+        }
+    }
+    return best;
+}
+
+static int findArgIndex(const CommandDef* def, const char* name) {
+    for (uint8_t i = 0; i < def->argCount; i++) {
+        if (strcmp(def->args[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+// Serial: token argumentu o danym indeksie; ostatni argument dostaje reszte sufiksu
+static bool getSuffixToken(const CommandContext& ctx, int argIndex, String& out) {
+    if (!ctx.suffix || argIndex < 0) return false;
+    const char* p = ctx.suffix;
+    for (int i = 0; i < argIndex; i++) {
+        p = strchr(p, '_');
+        if (!p) return false;
+        p++;
+    }
+    const char* end = (argIndex == ctx.def->argCount - 1) ? nullptr : strchr(p, '_');
+    out = end ? String(p).substring(0, end - p) : String(p);
+    return out.length() > 0;
+}
+
+bool commandHasArg(const CommandContext& ctx, const char* name) {
+    if (ctx.source == CMD_SRC_WEBSOCKET) {
+        return ctx.doc && ctx.doc->containsKey(name);
+    }
+    String token;
+    return getSuffixToken(ctx, findArgIndex(ctx.def, name), token);
+}
+
+long commandArgInt(const CommandContext& ctx, const char* name, long defaultValue) {
+    if (ctx.source == CMD_SRC_WEBSOCKET) {
+        if (!ctx.doc || !ctx.doc->containsKey(name)) return defaultValue;
+        JsonVariant v = (*ctx.doc)[name];
+        if (v.is<const char*>()) return strtol(v.as<const char*>(), nullptr, 10);
+        return v.as<long>();
+    }
+    int idx = findArgIndex(ctx.def, name);
+    String token;
+    if (!getSuffixToken(ctx, idx, token)) return defaultValue;
+    return strtol(token.c_str(), nullptr, ctx.def->args[idx].type == ARG_HEX ? 16 : 10);
+}
+
+float commandArgFloat(const CommandContext& ctx, const char* name, float defaultValue) {
+    if (ctx.source == CMD_SRC_WEBSOCKET) {
+        if (!ctx.doc || !ctx.doc->containsKey(name)) return defaultValue;
+        JsonVariant v = (*ctx.doc)[name];
+        if (v.is<const char*>()) return atof(v.as<const char*>());
+        return v.as<float>();
+    }
+    String token;
+    if (!getSuffixToken(ctx, findArgIndex(ctx.def, name), token)) return defaultValue;
+    return token.toFloat();
+}
+
+bool commandArgBool(const CommandContext& ctx, const char* name, bool defaultValue) {
+    if (ctx.source == CMD_SRC_WEBSOCKET) {
+        if (!ctx.doc || !ctx.doc->containsKey(name)) return defaultValue;
+        return (*ctx.doc)[name].as<bool>();
+    }
+    String token;
+    if (!getSuffixToken(ctx, findArgIndex(ctx.def, name), token)) return defaultValue;
+    return token == "1" || token == "ON" || token == "TRUE";
+}
+
+String commandArgString(const CommandContext& ctx, const char* name, const char* defaultValue) {
+    if (ctx.source == CMD_SRC_WEBSOCKET) {
+        if (!ctx.doc || !ctx.doc->containsKey(name)) return String(defaultValue);
+        JsonVariant v = (*ctx.doc)[name];
+        return v.is<const char*>() ? String(v.as<const char*>()) : v.as<String>();
+    }
+    String token;
+    if (!getSuffixToken(ctx, findArgIndex(ctx.def, name), token)) return String(defaultValue);
+    return token;
+}
+
+static bool isNumericString(const char* s, int base) {
+    if (!s || !*s) return false;
+    char* end = nullptr;
+    if (base == 0) {
+        strtod(s, &end);
+    } else {
+        strtol(s, &end, base);
+    }
+    return end && *end == '\0';
+}
+
+// Walidacja argumentow wg schematu; false + opis bledu gdy niepoprawne
+static bool validateCommandArgs(const CommandContext& ctx, String& errorOut) {
+    const CommandDef* def = ctx.def;
+    for (uint8_t i = 0; i < def->argCount; i++) {
+        const CommandArg& arg = def->args[i];
+
+        if (!commandHasArg(ctx, arg.name)) {
+            if (arg.required) {
+                errorOut = "Missing argument: " + String(arg.name);
+                return false;
+            }
+            continue;
+        }
+
+        bool numeric = (arg.type == ARG_INT || arg.type == ARG_FLOAT || arg.type == ARG_HEX);
+        if (ctx.source == CMD_SRC_WEBSOCKET) {
+            JsonVariant v = (*ctx.doc)[arg.name];
+            bool typeOk = true;
+            if (numeric) {
+                typeOk = v.is<float>() || v.is<long>() ||
+                         (v.is<const char*>() && isNumericString(v.as<const char*>(), arg.type == ARG_FLOAT ? 0 : 10));
+            } else if (arg.type == ARG_BOOL) {
+                typeOk = v.is<bool>() || v.is<int>();
+            } else if (arg.type == ARG_STRING) {
+                typeOk = v.is<const char*>();
+            }
+            if (!typeOk) {
+                errorOut = "Invalid type for argument: " + String(arg.name);
+                return false;
+            }
+        } else if (numeric) {
+            String token;
+            getSuffixToken(ctx, i, token);
+            if (!isNumericString(token.c_str(), arg.type == ARG_HEX ? 16 : (arg.type == ARG_FLOAT ? 0 : 10))) {
+                errorOut = "Invalid number for argument: " + String(arg.name) + " (" + token + ")";
+                return false;
+            }
+        }
+
+        if (numeric && arg.minValue != arg.maxValue) {
+            float value = (arg.type == ARG_FLOAT) ? commandArgFloat(ctx, arg.name) : (float)commandArgInt(ctx, arg.name);
+            if (value < arg.minValue || value > arg.maxValue) {
+                errorOut = "Argument " + String(arg.name) + " out of range (" + String(arg.minValue) +
+                           "-" + String(arg.maxValue) + ")";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static CommandResult runCommand(int entryIndex, CommandContext& ctx, String& errorOut) {
+    if (entryIndex < 0) {
+        return CMD_NOT_FOUND;
+    }
+
+    CommandEntry& entry = commandEntries[entryIndex];
+    ctx.def = entry.def;
+
+    if (!(entry.def->sources & ctx.source)) {
+        portENTER_CRITICAL(&commandStatsMux);
+        entry.errors++;
+        portEXIT_CRITICAL(&commandStatsMux);
+        return CMD_NOT_ALLOWED;
+    }
+
+    if (!validateCommandArgs(ctx, errorOut)) {
+        portENTER_CRITICAL(&commandStatsMux);
+        entry.errors++;
+        portEXIT_CRITICAL(&commandStatsMux);
+        return CMD_BAD_ARGS;
+    }
+
+    int64_t start = esp_timer_get_time();
+    entry.def->handler(ctx);
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+
+    portENTER_CRITICAL(&commandStatsMux);
+    entry.calls++;
+    entry.totalMicros += elapsed;
+    if (elapsed > entry.maxMicros) entry.maxMicros = elapsed;
+    portEXIT_CRITICAL(&commandStatsMux);
+
+    return CMD_OK;
+}
+
+CommandResult dispatchWebSocketCommand(const char* name, AsyncWebSocketClient* client, JsonDocument& doc, String& errorOut) {
+    CommandContext ctx = {CMD_SRC_WEBSOCKET, nullptr, name, client, &doc, nullptr, 0};
+    return runCommand(findCommandExact(name), ctx, errorOut);
+}
+
+CommandResult dispatchSerialCommand(const String& line, String& errorOut) {
+    const char* name = line.c_str();
+    CommandContext ctx = {CMD_SRC_SERIAL, nullptr, name, nullptr, nullptr, nullptr, 0};
+
+    // Najpierw dokladne dopasowanie (CONFIG_ADS1110_ON), potem prefiks (CONFIG_ADS1110_60_4)
+    int entry = findCommandExact(name);
+    if (entry < 0 || !(commandEntries[entry].def->sources & CMD_SRC_SERIAL)) {
+        int prefixEntry = findCommandPrefix(name);
+        if (prefixEntry >= 0) {
+            entry = prefixEntry;
+            ctx.suffix = name + strlen(commandEntries[entry].def->name);
+        }
+    }
+    return runCommand(entry, ctx, errorOut);
+}
+
+CommandResult dispatchModbusCommand(uint16_t code, String& errorOut) {
+    if (code == 0 || code > MAX_MODBUS_COMMAND_CODE || !modbusIndexReady) {
+        return CMD_NOT_FOUND;
+    }
+    int entry = (modbusIndex[code] != MODBUS_INDEX_NONE) ? modbusIndex[code] : -1;
+    CommandContext ctx = {CMD_SRC_MODBUS, nullptr, entry >= 0 ? commandEntries[entry].def->name : "",
+                          nullptr, nullptr, nullptr, code};
+    return runCommand(entry, ctx, errorOut);
+}
+
+size_t getRegisteredCommandCount() {
+    return commandCount;
+}
+
+static String commandSourcesString(uint8_t sources) {
+    String s;
+    if (sources & CMD_SRC_WEBSOCKET) s += "ws ";
+    if (sources & CMD_SRC_SERIAL) s += "serial ";
+    if (sources & CMD_SRC_MODBUS) s += "modbus ";
+    s.trim();
+    return s;
+}
+
+static const char* commandArgTypeName(CommandArgType type) {
+    switch (type) {
+        case ARG_INT: return "int";
+        case ARG_FLOAT: return "float";
+        case ARG_BOOL: return "bool";
+        case ARG_HEX: return "hex";
+        default: return "string";
+    }
+}
+
+void getCommandStatsJson(JsonArray& out) {
+    for (size_t i = 0; i < commandCount; i++) {
+        const CommandEntry& entry = commandEntries[sortedIndex[i]];
+        JsonObject cmd = out.createNestedObject();
+        cmd["name"] = entry.def->name;
+        cmd["sources"] = commandSourcesString(entry.def->sources);
+        if (entry.def->modbusCode > 0) cmd["modbusCode"] = entry.def->modbusCode;
+        cmd["calls"] = entry.calls;
+        cmd["errors"] = entry.errors;
+        cmd["avgUs"] = entry.calls > 0 ? (uint32_t)(entry.totalMicros / entry.calls) : 0;
+        cmd["maxUs"] = entry.maxMicros;
+        if (entry.def->argCount > 0) {
+            JsonArray args = cmd.createNestedArray("args");
+            for (uint8_t a = 0; a < entry.def->argCount; a++) {
+                const CommandArg& arg = entry.def->args[a];
+                args.add(String(arg.name) + ":" + commandArgTypeName(arg.type) + (arg.required ? "" : "?"));
+            }
+        }
+    }
+}
+
+void printCommandStats() {
+    safePrintln("=== Command Registry (" + String(commandCount) + " commands) ===");
+    for (size_t i = 0; i < commandCount; i++) {
+        const CommandEntry& entry = commandEntries[sortedIndex[i]];
+        if (entry.calls == 0 && entry.errors == 0) continue;
+        safePrintln(String(entry.def->name) + " [" + commandSourcesString(entry.def->sources) + "]: " +
+                    String(entry.calls) + " calls, " + String(entry.errors) + " errors, avg " +
+                    String(entry.calls > 0 ? (uint32_t)(entry.totalMicros / entry.calls) : 0) + "us, max " +
+                    String(entry.maxMicros) + "us");
+    }
+}
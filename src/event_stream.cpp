@@ -0,0 +1,165 @@
+#include <event_stream.h>
+#include <telemetry.h>
+#include <web_server.h>
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+// Forward declarations for safe printing functions
+void safePrint(const String& message);
+void safePrintln(const String& message);
+
+// Generacje sekcji wysłane w danej publikacji - punkt wznowienia dla Last-Event-ID
+struct EventStreamPublication {
+    uint32_t id;
+    uint32_t generations[TELEMETRY_SECTION_COUNT];
+};
+
+static EventStreamPublication publications[EVENT_STREAM_HISTORY];
+static uint8_t publicationHead = 0;
+static uint8_t publicationCount = 0;
+static uint32_t publishedGenerations[TELEMETRY_SECTION_COUNT];
+static uint32_t lastEventId = 0;
+static SemaphoreHandle_t eventStreamMutex = nullptr;
+
+// Osobne bufory dla taska publikującego i dla onConnect (async_tcp)
+static char* publishBuffer = nullptr;
+static char* connectBuffer = nullptr;
+
+// Statystyki
+static uint32_t eventDeltas = 0;
+static uint32_t eventSnapshots = 0;
+static uint32_t eventResumes = 0;         // Last-Event-ID znaleziony w historii
+static uint32_t eventResumeMisses = 0;    // id za stare / z poprzedniego uruchomienia
+static uint32_t eventRejected = 0;        // limit klientów
+static size_t eventLastSize = 0;
+
+static char* allocateEventBuffer() {
+    char* buffer = (char*)heap_caps_malloc(TELEMETRY_JSON_MAX_SIZE + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!buffer) {
+        buffer = (char*)malloc(TELEMETRY_JSON_MAX_SIZE + 1);
+    }
+    return buffer;
+}
+
+// Zapamiętuje publikację (pod eventStreamMutex)
+static void recordPublication(uint32_t id, const uint32_t* generations) {
+    EventStreamPublication& entry = publications[publicationHead];
+    entry.id = id;
+    memcpy(entry.generations, generations, sizeof(entry.generations));
+    publicationHead = (publicationHead + 1) % EVENT_STREAM_HISTORY;
+    if (publicationCount < EVENT_STREAM_HISTORY) publicationCount++;
+}
+
+static bool findPublication(uint32_t id, uint32_t* generations) {
+    for (uint8_t i = 0; i < publicationCount; i++) {
+        if (publications[i].id == id) {
+            memcpy(generations, publications[i].generations, sizeof(publications[i].generations));
+            return true;
+        }
+    }
+    return false;
+}
+
+static void onEventStreamConnect(AsyncEventSourceClient* client) {
+    if (events.count() > EVENT_STREAM_MAX_CLIENTS) {
+        eventRejected++;
+        client->close();
+        return;
+    }
+
+    uint32_t since[TELEMETRY_SECTION_COUNT];
+    uint32_t generations[TELEMETRY_SECTION_COUNT];
+    uint32_t id = 0;
+    bool resume = false;
+
+    if (xSemaphoreTake(eventStreamMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        client->close();
+        return;
+    }
+    if (client->lastId() != 0) {
+        resume = findPublication(client->lastId(), since);
+        if (resume) {
+            eventResumes++;
+        } else {
+            eventResumeMisses++;
+        }
+    }
+    id = lastEventId;
+    xSemaphoreGive(eventStreamMutex);
+
+    // Delta od Last-Event-ID albo pełny snapshot; dane mogą być nowsze niż publikacja id -
+    // kolejna delta powtórzy wtedy część sekcji, co jest nieszkodliwe
+    size_t len = copyTelemetryDelta(resume ? since : nullptr, generations, connectBuffer, TELEMETRY_JSON_MAX_SIZE);
+    if (len == 0) {
+        client->close();
+        return;
+    }
+    connectBuffer[len] = '\0';
+    client->send(connectBuffer, resume ? "delta" : "snapshot", id, EVENT_STREAM_RECONNECT);
+    if (!resume) eventSnapshots++;
+}
+
+static void eventStreamTask(void* parameter) {
+    TickType_t xLastWakeTime = xTaskGetTickCount();
+    unsigned long lastSnapshot = 0;
+
+    for (;;) {
+        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(EVENT_STREAM_INTERVAL));
+        if (events.count() == 0) continue;
+
+        // Okresowy snapshot naprawia delty zgubione przez przepełnione kolejki klientów
+        bool snapshot = millis() - lastSnapshot >= EVENT_STREAM_SNAPSHOT_INTERVAL;
+        uint32_t generations[TELEMETRY_SECTION_COUNT];
+        size_t len = copyTelemetryDelta(snapshot ? nullptr : publishedGenerations, generations,
+                                        publishBuffer, TELEMETRY_JSON_MAX_SIZE);
+        if (len <= 2) continue;   // błąd albo "{}" - bez zmian
+        publishBuffer[len] = '\0';
+
+        if (xSemaphoreTake(eventStreamMutex, pdMS_TO_TICKS(100)) != pdTRUE) continue;
+        uint32_t id = ++lastEventId;
+        memcpy(publishedGenerations, generations, sizeof(publishedGenerations));
+        recordPublication(id, generations);
+        xSemaphoreGive(eventStreamMutex);
+
+        events.send(publishBuffer, snapshot ? "snapshot" : "delta", id);
+        if (snapshot) {
+            lastSnapshot = millis();
+            eventSnapshots++;
+        } else {
+            eventDeltas++;
+        }
+        eventLastSize = len;
+    }
+}
+
+bool initializeEventStream(AsyncWebServer& server) {
+    if (eventStreamMutex) return true;
+
+    eventStreamMutex = xSemaphoreCreateMutex();
+    publishBuffer = allocateEventBuffer();
+    connectBuffer = allocateEventBuffer();
+    if (!eventStreamMutex || !publishBuffer || !connectBuffer) {
+        safePrintln("Event stream: failed to allocate buffers");
+        return false;
+    }
+
+    // Losowy początek numeracji - Last-Event-ID sprzed restartu nie trafi w historię
+    lastEventId = (esp_random() >> 1) + 1;
+
+    events.onConnect(onEventStreamConnect);
+    server.addHandler(&events);
+    xTaskCreatePinnedToCore(eventStreamTask, "eventStreamTask", 4096, NULL, 1, NULL, 1);
+
+    safePrintln("Event stream: /events ready (max " + String(EVENT_STREAM_MAX_CLIENTS) + " clients)");
+    return true;
+}
+
+String getEventStreamStatus() {
+    return "- SSE /events: " + String(events.count()) + " clients, " + String(eventDeltas) + " deltas, " +
+           String(eventSnapshots) + " snapshots, resumes " + String(eventResumes) + " (missed " +
+           String(eventResumeMisses) + "), rejected " + String(eventRejected) + ", last " +
+           String(eventLastSize) + " bytes\n";
+}
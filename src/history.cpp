@@ -4,8 +4,12 @@
 #include <calib.h>
 #include <fan.h>
 #include <ArduinoJson.h>
+#include <json_arena.h>
+#include <response_cache.h>
+#include <sensor_fields.h>
 #include <time.h>
 #include <cstring>
+#include <cstdarg>
 #include <new> // For std::nothrow
 #include <esp_heap_caps.h> // For PSRAM allocation
 
@@ -41,6 +45,24 @@ void freePSRAM(T* ptr) {
 // Globalny manager historii
 HistoryManager historyManager;
 
+// Generacja danych historii - rośnie przy każdym zapisie próbek (unieważnia cache odpowiedzi)
+static volatile uint32_t historyGeneration = 0;
+
+uint32_t getHistoryGeneration() {
+    return historyGeneration;
+}
+
+bool isHistoryTimeEpoch() {
+    return time(nullptr) > 8 * 3600 * 2; // Czas zsynchronizowany z NTP
+}
+
+unsigned long getHistoryTime() {
+    if (isHistoryTimeEpoch()) {
+        return time(nullptr);   // Sekundy epoch
+    }
+    return millis() / 1000;     // Fallback do sekund od uruchomienia
+}
+
 // External sensor data
 extern SolarData solarData;
 extern I2CSensorData i2cSensorData;
@@ -160,7 +182,8 @@ bool HistoryManager::initialize() {
     // Initialize history buffers based on enabled sensors
     if (config.enableSolarSensor) {
         solarHistory = new(std::nothrow) SensorHistory<SolarData, SOLAR_FAST_HISTORY, SOLAR_SLOW_HISTORY>();
-        if (solarHistory && solarHistory->initialize()) {
+        // SolarData ma pola String - wpisy kopiowane pod blokadą (strumień HTTP z async_tcp)
+        if (solarHistory && solarHistory->initialize() && solarHistory->enableEntryLock()) {
             safePrint("Solar history initialized: ");
             safePrint(String(SOLAR_FAST_HISTORY));
             safePrint(" fast + ");
@@ -411,12 +434,7 @@ void HistoryManager::updateHistory() {
     if (!initialized) return;
     
     // Użyj epoch time w sekundach dla spójności z WebSocket
-    unsigned long currentTime = 0;
-    if (time(nullptr) > 8 * 3600 * 2) { // Jeśli czas jest zsynchronizowany
-        currentTime = time(nullptr); // Używaj sekund (epoch timestamp)
-    } else {
-        currentTime = millis() / 1000; // Fallback do sekund od uruchomienia
-    }
+    unsigned long currentTime = getHistoryTime();
     
     static unsigned long lastDebugTime = 0;
     if (currentTime - lastDebugTime >= 60) { // Debug co minutę
@@ -533,6 +551,8 @@ void HistoryManager::updateHistory() {
             fanData.lastUpdate = currentTime;
             fanHistory->addFastSample(fanData, currentTime);
         }
+        
+        historyGeneration++;
     }
     
     // Update slow averages every 5 minutes (300 seconds)
@@ -631,6 +651,8 @@ void HistoryManager::updateHistory() {
             fanData.lastUpdate = currentTime;
             fanHistory->addSlowSample(fanData, currentTime);
         }
+        
+        historyGeneration++;
     }
 }
 
@@ -875,12 +897,12 @@ void printHistoryStatus() {
 }
 
 // API function for getting historical data with pagination
-size_t getHistoricalData(const String& sensor, const String& timeRange, 
+static size_t buildHistoricalData(const String& sensor, const String& timeRange, 
                         String& jsonResponse, unsigned long fromTime, unsigned long toTime,
                         const String& sampleType, int packetIndex, int packetSize) {
     if (!config.enableHistory) {
         safePrintln("[ERROR] getHistoricalData: History system is disabled in configuration.");
-        DynamicJsonDocument doc(512);
+        ArenaJsonDocument doc(512);
         doc["error"] = "History disabled in configuration";
         doc["data"] = JsonArray();
         serializeJson(doc, jsonResponse);
@@ -889,7 +911,7 @@ size_t getHistoricalData(const String& sensor, const String& timeRange,
     
     if (!historyManager.isInitialized()) {
         safePrintln("[ERROR] getHistoricalData: History manager is not initialized.");
-        DynamicJsonDocument doc(512);
+        ArenaJsonDocument doc(512);
         doc["error"] = "History not initialized";
         doc["data"] = JsonArray();
         serializeJson(doc, jsonResponse);
@@ -911,7 +933,7 @@ size_t getHistoricalData(const String& sensor, const String& timeRange,
     
     if (freeHeap < 30000) { // Need at least 30KB free
         safePrintln("[ERROR] getHistoricalData: Low heap memory. Free heap: " + String(freeHeap));
-        DynamicJsonDocument doc(512);
+        ArenaJsonDocument doc(512);
         doc["error"] = "Low heap memory";
         doc["data"] = JsonArray();
         doc["freeHeap"] = freeHeap;
@@ -937,7 +959,7 @@ size_t getHistoricalData(const String& sensor, const String& timeRange,
     // Check memory again before creating JSON document
     if (maxAllocHeap < docSize + 5000) {
         safePrintln("[ERROR] getHistoricalData: Insufficient contiguous memory for JSON. Required: " + String(docSize) + ", Available: " + String(maxAllocHeap));
-        DynamicJsonDocument doc(512);
+        ArenaJsonDocument doc(512);
         doc["error"] = "Insufficient contiguous memory for JSON document";
         doc["requiredSize"] = docSize;
         doc["maxAllocHeap"] = maxAllocHeap;
@@ -946,7 +968,7 @@ size_t getHistoricalData(const String& sensor, const String& timeRange,
         return 0;
     }
     
-    DynamicJsonDocument doc(docSize);
+    ArenaJsonDocument doc(docSize);
     doc["sensor"] = sensor;
     doc["timeRange"] = timeRange;
     JsonArray dataArray = doc.createNestedArray("data");
@@ -1565,7 +1587,7 @@ size_t getHistoricalData(const String& sensor, const String& timeRange,
     // Limit response size to prevent memory issues
     if (jsonResponse.length() > 8000) { // Increased limit for DynamicJsonDocument
         safePrintln("JSON response too large: " + String(jsonResponse.length()) + " bytes, truncating");
-        DynamicJsonDocument errorDoc(512);
+        ArenaJsonDocument errorDoc(512);
         errorDoc["error"] = "Response too large";
         errorDoc["size"] = jsonResponse.length();
         errorDoc["freeHeap"] = ESP.getFreeHeap();
@@ -1574,4 +1596,380 @@ size_t getHistoricalData(const String& sensor, const String& timeRange,
     }
     
     return totalSamples;
-}
\ No newline at end of file
+}
+
+// Wejście dla WebSocket (getHistory) - identyczne zapytania w obrębie
+// jednej generacji historii (jeden okres próbek fast) obsługiwane z cache.
+// Zakres kwantowany do 10 s, bo klienci liczą "now" przy każdym zapytaniu.
+size_t getHistoricalData(const String& sensor, const String& timeRange, 
+                        String& jsonResponse, unsigned long fromTime, unsigned long toTime,
+                        const String& sampleType, int packetIndex, int packetSize) {
+    String key = "hist|" + sensor + "|" + timeRange + "|" + sampleType + "|" +
+                 String(fromTime / 10) + "|" + String(toTime / 10) + "|" +
+                 String(packetIndex) + "|" + String(packetSize);
+    uint32_t generation = getHistoryGeneration();
+    uint32_t samples = 0;
+    
+    if (responseCacheGet(key, generation, jsonResponse, &samples)) {
+        return samples;
+    }
+    
+    samples = buildHistoricalData(sensor, timeRange, jsonResponse, fromTime, toTime, sampleType, packetIndex, packetSize);
+    
+    // Błędy (0 próbek) nie są cache'owane - mogą wynikać z chwilowego braku pamięci
+    if (samples > 0) {
+        responseCachePut(key, generation, jsonResponse, samples);
+    }
+    return samples;
+}
+
+// ===== Strumieniowy eksport historii =====
+
+// Pola próbki (writeSensorFields) jako obiekt JSON, wiersz CSV albo nagłówek CSV
+class HistoryRowWriter : public SensorFieldWriter {
+public:
+    HistoryRowWriter(char* buffer, size_t size, HistoryStreamFormat format, bool header)
+        : buffer(buffer), size(size), format(format), header(header) {}
+    
+    void number(const char* name, float value, uint8_t decimals) override {
+        if (!beginField(name)) return;
+        if (isnan(value) || isinf(value)) {
+            append(format == HISTORY_STREAM_JSON ? "null" : "");
+        } else {
+            appendf("%.*f", decimals, value);
+        }
+    }
+    
+    void integer(const char* name, long value) override {
+        if (!beginField(name)) return;
+        appendf("%ld", value);
+    }
+    
+    void flag(const char* name, bool value) override {
+        if (!beginField(name)) return;
+        if (format == HISTORY_STREAM_JSON) {
+            append(value ? "true" : "false");
+        } else {
+            append(value ? "1" : "0");
+        }
+    }
+    
+    void text(const char* name, const char* value) override {
+        if (!beginField(name)) return;
+        if (format == HISTORY_STREAM_JSON) append("\"");
+        for (const char* c = value; *c; c++) {
+            if ((uint8_t)*c < 0x20) continue;
+            if (format == HISTORY_STREAM_JSON && (*c == '"' || *c == '\\')) append("\\");
+            if (format == HISTORY_STREAM_CSV && (*c == ',' || *c == '"')) continue;
+            char ch[2] = {*c, '\0'};
+            append(ch);
+        }
+        if (format == HISTORY_STREAM_JSON) append("\"");
+    }
+    
+    // CSV: pusta kolumna (nagłówek z kompletem nazw); JSON: pole pominięte
+    void missing(const char* name) override {
+        if (format == HISTORY_STREAM_JSON) return;
+        beginField(name);
+    }
+    
+    void append(const char* str) {
+        size_t len = strlen(str);
+        if (length + len >= size) {
+            overflow = true;
+            return;
+        }
+        memcpy(buffer + length, str, len + 1);
+        length += len;
+    }
+    
+    void appendf(const char* fmt, ...) {
+        if (length >= size) return;
+        va_list args;
+        va_start(args, fmt);
+        int written = vsnprintf(buffer + length, size - length, fmt, args);
+        va_end(args);
+        if (written < 0 || length + written >= size) {
+            overflow = true;
+            buffer[length] = '\0';
+            return;
+        }
+        length += written;
+    }
+    
+    size_t getLength() const { return length; }
+    bool hasOverflow() const { return overflow; }
+
+private:
+    // Separator + nazwa pola; false = w nagłówku CSV wartość pomijana
+    bool beginField(const char* name) {
+        if (fields++ > 0) append(",");
+        if (format == HISTORY_STREAM_JSON) {
+            appendf("\"%s\":", name);
+            return true;
+        }
+        if (header) {
+            append(name);
+            return false;
+        }
+        return true;
+    }
+    
+    char* buffer;
+    size_t size;
+    HistoryStreamFormat format;
+    bool header;
+    size_t length = 0;
+    size_t fields = 0;
+    bool overflow = false;
+};
+
+// Jeden wiersz: obiekt JSON ({"timestamp":..,"dateTime":..,"data":{..}}), wiersz CSV albo nagłówek CSV.
+// Zwraca długość; 0 gdy wiersz nie mieści się w buforze
+template<typename T>
+static size_t formatHistoryRow(const HistoryEntry<T>& entry, HistoryStreamFormat format, bool header, bool first,
+                               char* buffer, size_t size) {
+    HistoryRowWriter writer(buffer, size, format, header);
+    if (format == HISTORY_STREAM_JSON) {
+        writer.appendf("%s{\"timestamp\":%lu,\"dateTime\":\"%.19s\",\"data\":{", first ? "" : ",",
+                       entry.timestamp, entry.dateTime);
+        writeSensorFields(entry.data, writer);
+        writer.append("}}");
+    } else {
+        if (header) {
+            writer.append("timestamp,dateTime,");
+        } else {
+            writer.appendf("%lu,%.19s,", entry.timestamp, entry.dateTime);
+        }
+        writeSensorFields(entry.data, writer);
+        writer.append("\n");
+    }
+    return writer.hasOverflow() ? 0 : writer.getLength();
+}
+
+// Źródło strumienia - jeden bufor historii z HistoryManager
+class HistoryStreamSource {
+public:
+    explicit HistoryStreamSource(const char* sensor) : sensor(sensor) {}
+    
+    virtual bool available() const = 0;
+    virtual uint32_t getTotal(bool slow) const = 0;
+    virtual size_t getCount(bool slow) const = 0;
+    // false = próbki już nie ma (nadpisana), odfiltrowana albo poza zakresem czasu
+    virtual bool inRange(bool slow, uint32_t seq, unsigned long fromTime, unsigned long toTime) const = 0;
+    virtual size_t formatRow(bool slow, uint32_t seq, unsigned long fromTime, unsigned long toTime,
+                             HistoryStreamFormat format, bool header, bool first, char* buffer, size_t size) const = 0;
+    
+    const char* sensor;
+};
+
+template<typename T, size_t FAST_SIZE, size_t SLOW_SIZE>
+class SensorHistorySource : public HistoryStreamSource {
+public:
+    typedef SensorHistory<T, FAST_SIZE, SLOW_SIZE> History;
+    typedef History* (HistoryManager::*Getter)();
+    typedef bool (*Filter)(const T&);
+    
+    SensorHistorySource(const char* sensor, Getter getter, Filter filter = nullptr)
+        : HistoryStreamSource(sensor), getter(getter), filter(filter) {}
+    
+    bool available() const override {
+        History* history = (historyManager.*getter)();
+        return history && history->isInitialized();
+    }
+    
+    uint32_t getTotal(bool slow) const override {
+        return (historyManager.*getter)()->getTotal(slow);
+    }
+    
+    size_t getCount(bool slow) const override {
+        return (historyManager.*getter)()->getCount(slow);
+    }
+    
+    bool inRange(bool slow, uint32_t seq, unsigned long fromTime, unsigned long toTime) const override {
+        if (filter) {
+            HistoryEntry<T> entry;
+            return read(slow, seq, fromTime, toTime, entry);
+        }
+        // Bez filtra wystarczy znacznik czasu - plan zakresu nie kopiuje całego bufora
+        unsigned long timestamp;
+        if (!(historyManager.*getter)()->getTimestampAt(slow, seq, timestamp)) return false;
+        return timestamp >= fromTime && timestamp <= toTime;
+    }
+    
+    size_t formatRow(bool slow, uint32_t seq, unsigned long fromTime, unsigned long toTime,
+                     HistoryStreamFormat format, bool header, bool first, char* buffer, size_t size) const override {
+        HistoryEntry<T> entry;
+        if (!read(slow, seq, fromTime, toTime, entry)) return 0;
+        return formatHistoryRow(entry, format, header, first, buffer, size);
+    }
+
+private:
+    bool read(bool slow, uint32_t seq, unsigned long fromTime, unsigned long toTime, HistoryEntry<T>& entry) const {
+        if (!(historyManager.*getter)()->getSampleAt(slow, seq, entry)) return false;
+        if (filter && !filter(entry.data)) return false;
+        return entry.timestamp >= fromTime && entry.timestamp <= toTime;
+    }
+    
+    Getter getter;
+    Filter filter;
+};
+
+template<typename T, size_t FAST_SIZE, size_t SLOW_SIZE>
+static SensorHistorySource<T, FAST_SIZE, SLOW_SIZE> makeHistorySource(
+        const char* sensor, SensorHistory<T, FAST_SIZE, SLOW_SIZE>* (HistoryManager::*getter)(),
+        bool (*filter)(const T&) = nullptr) {
+    return SensorHistorySource<T, FAST_SIZE, SLOW_SIZE>(sensor, getter, filter);
+}
+
+// Historia I2C jest wspólna dla SHT30/BME280/SCD41 - "scd41" tylko z próbek SCD41
+static bool isSCD41Sample(const I2CSensorData& data) {
+    return data.type == SENSOR_SCD41;
+}
+
+static auto solarSource = makeHistorySource("solar", &HistoryManager::getSolarHistory);
+static auto sps30Source = makeHistorySource("sps30", &HistoryManager::getSPS30History);
+static auto powerSource = makeHistorySource("power", &HistoryManager::getINA219History);
+static auto batterySource = makeHistorySource("battery", &HistoryManager::getBatteryHistory);
+static auto sht40Source = makeHistorySource("sht40", &HistoryManager::getSHT40History);
+static auto scd41Source = makeHistorySource("scd41", &HistoryManager::getI2CHistory, isSCD41Sample);
+static auto hchoSource = makeHistorySource("hcho", &HistoryManager::getHCHOHistory);
+static auto mcp3424Source = makeHistorySource("mcp3424", &HistoryManager::getMCP3424History);
+static auto ipsSource = makeHistorySource("ips", &HistoryManager::getIPSHistory);
+static auto fanSource = makeHistorySource("fan", &HistoryManager::getFanHistory);
+static auto calibSource = makeHistorySource("calibration", &HistoryManager::getCalibHistory);
+
+static const HistoryStreamSource* const historyStreamSources[] = {
+    &solarSource, &sps30Source, &powerSource, &batterySource, &sht40Source, &scd41Source,
+    &hchoSource, &mcp3424Source, &ipsSource, &fanSource, &calibSource
+};
+
+bool HistoryStream::begin(const String& sensor, const String& sampleType, unsigned long from, unsigned long to,
+                          uint32_t cursor, size_t limit, HistoryStreamFormat fmt) {
+    source = nullptr;
+    stage = STAGE_DONE;
+    
+    if (!config.enableHistory) {
+        error = "History disabled in configuration";
+        return false;
+    }
+    if (!historyManager.isInitialized()) {
+        error = "History not initialized";
+        return false;
+    }
+    for (const HistoryStreamSource* candidate : historyStreamSources) {
+        if (sensor == candidate->sensor) {
+            source = candidate;
+            break;
+        }
+    }
+    if (!source) {
+        error = "Unknown sensor";
+        return false;
+    }
+    if (!source->available()) {
+        source = nullptr;
+        error = "Sensor history not available";
+        return false;
+    }
+    
+    format = fmt;
+    slow = (sampleType == "slow");
+    fromTime = from;
+    toTime = to;
+    if (limit == 0 || limit > HISTORY_STREAM_MAX_LIMIT) limit = HISTORY_STREAM_MAX_LIMIT;
+    
+    // Zakres numerów próbek: od kursora (albo najstarszej zachowanej) do bieżącej
+    uint32_t total = source->getTotal(slow);
+    uint32_t oldest = total - source->getCount(slow);
+    if (cursor > total) cursor = total;    // kursor z poprzedniego uruchomienia
+    startSeq = max(cursor, oldest);
+    skipped = startSeq - cursor;
+    
+    // Plan przed wysłaniem nagłówków - nextCursor znany od razu (nagłówek HTTP)
+    planned = 0;
+    endSeq = startSeq;
+    more = false;
+    for (uint32_t s = startSeq; s != total; s++) {
+        if (!source->inRange(slow, s, fromTime, toTime)) continue;
+        if (planned == limit) {
+            more = true;
+            break;
+        }
+        planned++;
+        endSeq = s + 1;
+    }
+    // Bez limitu kolejne zapytanie zaczyna od nowych próbek (polling przyrostowy)
+    nextCursor = more ? endSeq : total;
+    if (!more) endSeq = total;
+    
+    seq = startSeq;
+    written = 0;
+    rowLen = 0;
+    rowPos = 0;
+    error = nullptr;
+    stage = STAGE_HEADER;
+    return true;
+}
+
+// Kolejny fragment odpowiedzi do bufora row; false = koniec
+bool HistoryStream::nextChunk() {
+    rowLen = 0;
+    rowPos = 0;
+    
+    while (rowLen == 0) {
+        switch (stage) {
+            case STAGE_HEADER:
+                if (format == HISTORY_STREAM_JSON) {
+                    rowLen = snprintf(row, sizeof(row),
+                        "{\"sensor\":\"%s\",\"sampleType\":\"%s\",\"timeBase\":\"%s\","
+                        "\"fromTime\":%lu,\"toTime\":%lu,\"cursor\":%u,\"skipped\":%u,"
+                        "\"nextCursor\":%u,\"more\":%s,\"data\":[",
+                        source->sensor, slow ? "slow" : "fast", isHistoryTimeEpoch() ? "epoch" : "uptime",
+                        fromTime, toTime, (unsigned)startSeq, (unsigned)skipped, (unsigned)nextCursor,
+                        more ? "true" : "false");
+                } else {
+                    // Nagłówek CSV z pól pierwszej próbki w zakresie
+                    for (uint32_t s = seq; s != endSeq && rowLen == 0; s++) {
+                        rowLen = source->formatRow(slow, s, fromTime, toTime, format, true, true, row, sizeof(row));
+                    }
+                }
+                stage = STAGE_ROWS;
+                break;
+            
+            case STAGE_ROWS:
+                if (seq == endSeq) {
+                    stage = STAGE_FOOTER;
+                    break;
+                }
+                // Próbki odfiltrowane lub nadpisane w trakcie wysyłki są pomijane
+                rowLen = source->formatRow(slow, seq, fromTime, toTime, format, false, written == 0, row, sizeof(row));
+                seq++;
+                if (rowLen > 0) written++;
+                break;
+            
+            case STAGE_FOOTER:
+                if (format == HISTORY_STREAM_JSON) {
+                    rowLen = snprintf(row, sizeof(row), "],\"count\":%u}", (unsigned)written);
+                }
+                stage = STAGE_DONE;
+                break;
+            
+            case STAGE_DONE:
+                return false;
+        }
+    }
+    return true;
+}
+
+size_t HistoryStream::read(uint8_t* buffer, size_t maxLen) {
+    size_t filled = 0;
+    while (filled < maxLen) {
+        if (rowPos == rowLen && !nextChunk()) break;
+        size_t chunk = min(rowLen - rowPos, maxLen - filled);
+        memcpy(buffer + filled, row + rowPos, chunk);
+        rowPos += chunk;
+        filled += chunk;
+    }
+    return filled;
+}
@@ -0,0 +1,563 @@
+#include <history_export.h>
+#include <history.h>
+#include <config.h>
+#include <stddef.h>
+#include <type_traits>
+
+// Forward declarations for safe printing functions
+void safePrint(const String& message);
+void safePrintln(const String& message);
+
+extern FeatureConfig config;
+
+// ===== Schemat pól =====
+
+struct HistoryExportField {
+    const char* name;
+    uint8_t type;
+    uint16_t offset;     // od początku rekordu (po u32 timestamp)
+    uint16_t count;      // elementy tablicy (1 dla skalarów)
+};
+
+// Typ pola z typu C++ - rozmiary liczone na docelowej platformie (unsigned long = u32 na ESP32)
+template<typename E>
+constexpr uint8_t exportFieldType() {
+    return std::is_same<E, bool>::value ? EXPORT_BOOL :
+           std::is_floating_point<E>::value ? (sizeof(E) == 4 ? EXPORT_F32 : EXPORT_F64) :
+           std::is_signed<E>::value ?
+               (sizeof(E) == 1 ? EXPORT_I8 : sizeof(E) == 2 ? EXPORT_I16 : sizeof(E) == 4 ? EXPORT_I32 : EXPORT_I64) :
+               (sizeof(E) == 1 ? EXPORT_U8 : sizeof(E) == 2 ? EXPORT_U16 : sizeof(E) == 4 ? EXPORT_U32 : EXPORT_U64);
+}
+
+#define EXPORT_ELEMENT(T, member) std::remove_all_extents<decltype(T::member)>::type
+#define EXPORT_FIELD(T, member) { #member, exportFieldType<EXPORT_ELEMENT(T, member)>(), \
+    (uint16_t)(sizeof(uint32_t) + offsetof(T, member)), (uint16_t)(sizeof(T::member) / sizeof(EXPORT_ELEMENT(T, member))) }
+#define EXPORT_FIELDS(table) table, (uint16_t)(sizeof(table) / sizeof(table[0]))
+
+// Solar trzyma pola jako String - do eksportu pakowane do stałego rekordu
+struct SolarExportData {
+    float V;
+    float I;
+    float VPV;
+    float PPV;
+    bool valid;
+    uint32_t lastUpdate;
+};
+
+static const HistoryExportField solarFields[] = {
+    EXPORT_FIELD(SolarExportData, V), EXPORT_FIELD(SolarExportData, I),
+    EXPORT_FIELD(SolarExportData, VPV), EXPORT_FIELD(SolarExportData, PPV),
+    EXPORT_FIELD(SolarExportData, valid), EXPORT_FIELD(SolarExportData, lastUpdate)
+};
+
+static const HistoryExportField i2cFields[] = {
+    EXPORT_FIELD(I2CSensorData, temperature), EXPORT_FIELD(I2CSensorData, humidity),
+    EXPORT_FIELD(I2CSensorData, pressure), EXPORT_FIELD(I2CSensorData, co2),
+    EXPORT_FIELD(I2CSensorData, valid), EXPORT_FIELD(I2CSensorData, lastUpdate),
+    EXPORT_FIELD(I2CSensorData, type)
+};
+
+static const HistoryExportField sps30Fields[] = {
+    EXPORT_FIELD(SPS30Data, pm1_0), EXPORT_FIELD(SPS30Data, pm2_5), EXPORT_FIELD(SPS30Data, pm4_0),
+    EXPORT_FIELD(SPS30Data, pm10), EXPORT_FIELD(SPS30Data, nc0_5), EXPORT_FIELD(SPS30Data, nc1_0),
+    EXPORT_FIELD(SPS30Data, nc2_5), EXPORT_FIELD(SPS30Data, nc4_0), EXPORT_FIELD(SPS30Data, nc10),
+    EXPORT_FIELD(SPS30Data, typical_particle_size), EXPORT_FIELD(SPS30Data, valid),
+    EXPORT_FIELD(SPS30Data, lastUpdate)
+};
+
+static const HistoryExportField ipsFields[] = {
+    EXPORT_FIELD(IPSSensorData, pc_values), EXPORT_FIELD(IPSSensorData, pm_values),
+    EXPORT_FIELD(IPSSensorData, debugMode), EXPORT_FIELD(IPSSensorData, won),
+    EXPORT_FIELD(IPSSensorData, np_values), EXPORT_FIELD(IPSSensorData, pw_values),
+    EXPORT_FIELD(IPSSensorData, valid), EXPORT_FIELD(IPSSensorData, lastUpdate)
+};
+
+static const HistoryExportField mcp3424Fields[] = {
+    EXPORT_FIELD(MCP3424Data, deviceCount), EXPORT_FIELD(MCP3424Data, addresses),
+    EXPORT_FIELD(MCP3424Data, channels), EXPORT_FIELD(MCP3424Data, resolution),
+    EXPORT_FIELD(MCP3424Data, gain), EXPORT_FIELD(MCP3424Data, valid),
+    EXPORT_FIELD(MCP3424Data, lastUpdate)
+};
+
+static const HistoryExportField ads1110Fields[] = {
+    EXPORT_FIELD(ADS1110Data, voltage), EXPORT_FIELD(ADS1110Data, dataRate),
+    EXPORT_FIELD(ADS1110Data, gain), EXPORT_FIELD(ADS1110Data, valid),
+    EXPORT_FIELD(ADS1110Data, lastUpdate)
+};
+
+static const HistoryExportField ina219Fields[] = {
+    EXPORT_FIELD(INA219Data, busVoltage), EXPORT_FIELD(INA219Data, current),
+    EXPORT_FIELD(INA219Data, power), EXPORT_FIELD(INA219Data, shuntVoltage),
+    EXPORT_FIELD(INA219Data, valid), EXPORT_FIELD(INA219Data, lastUpdate)
+};
+
+static const HistoryExportField sht40Fields[] = {
+    EXPORT_FIELD(SHT40Data, temperature), EXPORT_FIELD(SHT40Data, humidity),
+    EXPORT_FIELD(SHT40Data, pressure), EXPORT_FIELD(SHT40Data, valid),
+    EXPORT_FIELD(SHT40Data, lastUpdate)
+};
+
+static const HistoryExportField calibFields[] = {
+    EXPORT_FIELD(CalibratedSensorData, K1_temp), EXPORT_FIELD(CalibratedSensorData, K2_temp),
+    EXPORT_FIELD(CalibratedSensorData, K3_temp), EXPORT_FIELD(CalibratedSensorData, K4_temp),
+    EXPORT_FIELD(CalibratedSensorData, K5_temp),
+    EXPORT_FIELD(CalibratedSensorData, K1_voltage), EXPORT_FIELD(CalibratedSensorData, K2_voltage),
+    EXPORT_FIELD(CalibratedSensorData, K3_voltage), EXPORT_FIELD(CalibratedSensorData, K4_voltage),
+    EXPORT_FIELD(CalibratedSensorData, K5_voltage),
+    EXPORT_FIELD(CalibratedSensorData, K6_temp), EXPORT_FIELD(CalibratedSensorData, K7_temp),
+    EXPORT_FIELD(CalibratedSensorData, K8_temp), EXPORT_FIELD(CalibratedSensorData, K9_temp),
+    EXPORT_FIELD(CalibratedSensorData, K12_temp),
+    EXPORT_FIELD(CalibratedSensorData, K6_voltage), EXPORT_FIELD(CalibratedSensorData, K7_voltage),
+    EXPORT_FIELD(CalibratedSensorData, K8_voltage), EXPORT_FIELD(CalibratedSensorData, K9_voltage),
+    EXPORT_FIELD(CalibratedSensorData, K12_voltage),
+    EXPORT_FIELD(CalibratedSensorData, CO), EXPORT_FIELD(CalibratedSensorData, NO),
+    EXPORT_FIELD(CalibratedSensorData, NO2), EXPORT_FIELD(CalibratedSensorData, O3),
+    EXPORT_FIELD(CalibratedSensorData, SO2), EXPORT_FIELD(CalibratedSensorData, H2S),
+    EXPORT_FIELD(CalibratedSensorData, NH3),
+    EXPORT_FIELD(CalibratedSensorData, CO_ppb), EXPORT_FIELD(CalibratedSensorData, NO_ppb),
+    EXPORT_FIELD(CalibratedSensorData, NO2_ppb), EXPORT_FIELD(CalibratedSensorData, O3_ppb),
+    EXPORT_FIELD(CalibratedSensorData, SO2_ppb), EXPORT_FIELD(CalibratedSensorData, H2S_ppb),
+    EXPORT_FIELD(CalibratedSensorData, NH3_ppb),
+    EXPORT_FIELD(CalibratedSensorData, TGS02), EXPORT_FIELD(CalibratedSensorData, TGS03),
+    EXPORT_FIELD(CalibratedSensorData, TGS12), EXPORT_FIELD(CalibratedSensorData, TGS02_ohm),
+    EXPORT_FIELD(CalibratedSensorData, TGS03_ohm), EXPORT_FIELD(CalibratedSensorData, TGS12_ohm),
+    EXPORT_FIELD(CalibratedSensorData, HCHO), EXPORT_FIELD(CalibratedSensorData, PID),
+    EXPORT_FIELD(CalibratedSensorData, PID_mV),
+    EXPORT_FIELD(CalibratedSensorData, VOC), EXPORT_FIELD(CalibratedSensorData, VOC_ppb),
+    EXPORT_FIELD(CalibratedSensorData, valid), EXPORT_FIELD(CalibratedSensorData, lastUpdate)
+};
+
+static const HistoryExportField hchoFields[] = {
+    EXPORT_FIELD(HCHOData, hcho), EXPORT_FIELD(HCHOData, hcho_ppb),
+    EXPORT_FIELD(HCHOData, valid), EXPORT_FIELD(HCHOData, lastUpdate)
+};
+
+static const HistoryExportField fanFields[] = {
+    EXPORT_FIELD(FanData, dutyCycle), EXPORT_FIELD(FanData, rpm), EXPORT_FIELD(FanData, enabled),
+    EXPORT_FIELD(FanData, glineEnabled), EXPORT_FIELD(FanData, valid), EXPORT_FIELD(FanData, lastUpdate)
+};
+
+// Bufor średniej kroczącej napięcia (voltageHistory) jest w rekordzie, ale poza schematem
+static const HistoryExportField batteryFields[] = {
+    EXPORT_FIELD(BatteryData, voltage), EXPORT_FIELD(BatteryData, current), EXPORT_FIELD(BatteryData, power),
+    EXPORT_FIELD(BatteryData, chargePercent), EXPORT_FIELD(BatteryData, isBatteryPowered),
+    EXPORT_FIELD(BatteryData, lowBattery), EXPORT_FIELD(BatteryData, criticalBattery),
+    EXPORT_FIELD(BatteryData, valid), EXPORT_FIELD(BatteryData, lastUpdate)
+};
+
+// ===== Zapis little-endian =====
+
+static inline uint8_t* putU8(uint8_t* out, uint8_t value) {
+    *out++ = value;
+    return out;
+}
+
+static inline uint8_t* putU16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+    return out + 2;
+}
+
+static inline uint8_t* putU32(uint8_t* out, uint32_t value) {
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+    out[2] = (value >> 16) & 0xFF;
+    out[3] = value >> 24;
+    return out + 4;
+}
+
+static inline uint8_t* putName(uint8_t* out, const char* name) {
+    size_t len = strlen(name);
+    if (len > 255) len = 255;
+    *out++ = (uint8_t)len;
+    memcpy(out, name, len);
+    return out + len;
+}
+
+// CRC32 zgodny z zlib.crc32 - tablica liczona przy pierwszym eksporcie
+static uint32_t crcTable[256];
+static bool crcTableReady = false;
+
+static void initializeCrcTable() {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320UL ^ (c >> 1) : c >> 1;
+        }
+        crcTable[i] = c;
+    }
+    crcTableReady = true;
+}
+
+static uint32_t updateCrc(uint32_t crc, const uint8_t* data, size_t len) {
+    crc = ~crc;
+    while (len--) {
+        crc = crcTable[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// ===== Źródła - jeden bufor SensorHistory =====
+
+class HistoryExportSource {
+public:
+    HistoryExportSource(const char* name, const HistoryExportField* fields, uint16_t fieldCount, uint16_t dataSize)
+        : name(name), fields(fields), fieldCount(fieldCount), recordSize(sizeof(uint32_t) + dataSize) {}
+
+    virtual bool available() const = 0;
+    virtual uint32_t getTotal(bool slow) const = 0;
+    // Najstarsza próbka, której nie nadpisze najbliższy zapis
+    virtual uint32_t getFirstSeq(bool slow) const = 0;
+    // Zapis rekordu (timestamp + dane) do out; false = próbka nadpisana
+    virtual bool copyRecord(bool slow, uint32_t seq, uint8_t* out) const = 0;
+
+    const char* name;
+    const HistoryExportField* fields;
+    uint16_t fieldCount;
+    uint16_t recordSize;
+};
+
+template<typename T, size_t FAST_SIZE, size_t SLOW_SIZE>
+class RingExportSource : public HistoryExportSource {
+public:
+    typedef SensorHistory<T, FAST_SIZE, SLOW_SIZE> History;
+    typedef History* (HistoryManager::*Getter)();
+
+    RingExportSource(const char* name, Getter getter, const HistoryExportField* fields, uint16_t fieldCount,
+                     uint16_t dataSize)
+        : HistoryExportSource(name, fields, fieldCount, dataSize), getter(getter) {}
+
+    bool available() const override {
+        History* history = (historyManager.*getter)();
+        return history && history->isInitialized();
+    }
+
+    uint32_t getTotal(bool slow) const override {
+        return (historyManager.*getter)()->getTotal(slow);
+    }
+
+    uint32_t getFirstSeq(bool slow) const override {
+        History* history = (historyManager.*getter)();
+        uint32_t total = history->getTotal(slow);
+        size_t kept = min(history->getCount(slow), (slow ? SLOW_SIZE : FAST_SIZE) - 1);
+        return total - kept;
+    }
+
+protected:
+    Getter getter;
+};
+
+// Rekord = surowa struktura czujnika prosto z PSRAM
+template<typename T, size_t FAST_SIZE, size_t SLOW_SIZE>
+class RawExportSource : public RingExportSource<T, FAST_SIZE, SLOW_SIZE> {
+public:
+    typedef RingExportSource<T, FAST_SIZE, SLOW_SIZE> Base;
+
+    RawExportSource(const char* name, typename Base::Getter getter, const HistoryExportField* fields,
+                    uint16_t fieldCount)
+        : Base(name, getter, fields, fieldCount, sizeof(T)) {}
+
+    bool copyRecord(bool slow, uint32_t seq, uint8_t* out) const override {
+        uint32_t timestamp = 0;
+        if (!(historyManager.*(this->getter))()->copyRawSampleAt(slow, seq, timestamp, out + sizeof(uint32_t))) {
+            return false;
+        }
+        putU32(out, timestamp);
+        return true;
+    }
+
+    static_assert(sizeof(uint32_t) + sizeof(T) <= HISTORY_EXPORT_RECORD_MAX, "record exceeds HISTORY_EXPORT_RECORD_MAX");
+};
+
+template<typename T, size_t FAST_SIZE, size_t SLOW_SIZE>
+static RawExportSource<T, FAST_SIZE, SLOW_SIZE> makeExportSource(
+        const char* name, SensorHistory<T, FAST_SIZE, SLOW_SIZE>* (HistoryManager::*getter)(),
+        const HistoryExportField* fields, uint16_t fieldCount) {
+    return RawExportSource<T, FAST_SIZE, SLOW_SIZE>(name, getter, fields, fieldCount);
+}
+
+class SolarExportSource : public RingExportSource<SolarData, SOLAR_FAST_HISTORY, SOLAR_SLOW_HISTORY> {
+public:
+    SolarExportSource()
+        : RingExportSource("solar", &HistoryManager::getSolarHistory, EXPORT_FIELDS(solarFields),
+                           sizeof(SolarExportData)) {}
+
+    bool copyRecord(bool slow, uint32_t seq, uint8_t* out) const override {
+        HistoryEntry<SolarData> entry;
+        if (!historyManager.getSolarHistory()->getSampleAt(slow, seq, entry)) return false;
+        SolarExportData data;
+        memset(&data, 0, sizeof(data));
+        data.V = entry.data.V.toFloat();
+        data.I = entry.data.I.toFloat();
+        data.VPV = entry.data.VPV.toFloat();
+        data.PPV = entry.data.PPV.toFloat();
+        data.valid = entry.data.valid;
+        data.lastUpdate = entry.data.lastUpdate;
+        putU32(out, entry.timestamp);
+        memcpy(out + sizeof(uint32_t), &data, sizeof(data));
+        return true;
+    }
+};
+
+static SolarExportSource solarExport;
+static auto i2cExport = makeExportSource("i2c", &HistoryManager::getI2CHistory, EXPORT_FIELDS(i2cFields));
+static auto sps30Export = makeExportSource("sps30", &HistoryManager::getSPS30History, EXPORT_FIELDS(sps30Fields));
+static auto ipsExport = makeExportSource("ips", &HistoryManager::getIPSHistory, EXPORT_FIELDS(ipsFields));
+static auto mcp3424Export = makeExportSource("mcp3424", &HistoryManager::getMCP3424History, EXPORT_FIELDS(mcp3424Fields));
+static auto ads1110Export = makeExportSource("ads1110", &HistoryManager::getADS1110History, EXPORT_FIELDS(ads1110Fields));
+static auto powerExport = makeExportSource("power", &HistoryManager::getINA219History, EXPORT_FIELDS(ina219Fields));
+static auto sht40Export = makeExportSource("sht40", &HistoryManager::getSHT40History, EXPORT_FIELDS(sht40Fields));
+static auto calibExport = makeExportSource("calibration", &HistoryManager::getCalibHistory, EXPORT_FIELDS(calibFields));
+static auto hchoExport = makeExportSource("hcho", &HistoryManager::getHCHOHistory, EXPORT_FIELDS(hchoFields));
+static auto fanExport = makeExportSource("fan", &HistoryManager::getFanHistory, EXPORT_FIELDS(fanFields));
+static auto batteryExport = makeExportSource("battery", &HistoryManager::getBatteryHistory, EXPORT_FIELDS(batteryFields));
+
+static const HistoryExportSource* const historyExportSources[] = {
+    &solarExport, &i2cExport, &sps30Export, &ipsExport, &mcp3424Export, &ads1110Export,
+    &powerExport, &sht40Export, &calibExport, &hchoExport, &fanExport, &batteryExport
+};
+
+static_assert(sizeof(historyExportSources) / sizeof(historyExportSources[0]) == HISTORY_EXPORT_SOURCE_COUNT,
+              "HISTORY_EXPORT_SOURCE_COUNT");
+
+// ===== Pojedyncze rekordy =====
+
+static const HistoryExportSource* getRecordSource(size_t source) {
+    if (source >= HISTORY_EXPORT_SOURCE_COUNT || !config.enableHistory || !historyManager.isInitialized()) {
+        return nullptr;
+    }
+    const HistoryExportSource* exportSource = historyExportSources[source];
+    return exportSource->available() ? exportSource : nullptr;
+}
+
+const char* getHistoryRecordSourceName(size_t source) {
+    return source < HISTORY_EXPORT_SOURCE_COUNT ? historyExportSources[source]->name : nullptr;
+}
+
+bool getHistoryRecordWindow(size_t source, bool slow, HistoryRecordWindow& window) {
+    const HistoryExportSource* exportSource = getRecordSource(source);
+    if (!exportSource) return false;
+    window.firstSeq = exportSource->getFirstSeq(slow);
+    window.total = exportSource->getTotal(slow);
+    window.recordSize = exportSource->recordSize;
+    return true;
+}
+
+bool copyHistoryRecord(size_t source, bool slow, uint32_t seq, uint8_t* out) {
+    const HistoryExportSource* exportSource = getRecordSource(source);
+    return exportSource && exportSource->copyRecord(slow, seq, out);
+}
+
+// ===== Statystyki =====
+static uint8_t activeExports = 0;
+static uint32_t exportsStarted = 0;
+static uint32_t exportsCompleted = 0;
+static uint32_t exportsRejected = 0;
+static uint32_t exportDropped = 0;
+static size_t exportLastSize = 0;
+static unsigned long exportLastDuration = 0;
+static unsigned long exportStartMillis = 0;
+
+// ===== HistoryExport =====
+
+#define HISTORY_EXPORT_HEADER_SIZE 20
+#define HISTORY_EXPORT_TRAILER_SIZE 12
+
+HistoryExport::HistoryExport() {}
+
+HistoryExport::~HistoryExport() {
+    // Zwolnienie slotu także przy zerwanym połączeniu
+    if (active && activeExports > 0) activeExports--;
+}
+
+bool HistoryExport::begin() {
+    stage = STAGE_DONE;
+
+    if (!config.enableHistory) {
+        error = "History disabled in configuration";
+        return false;
+    }
+    if (!historyManager.isInitialized()) {
+        error = "History not initialized";
+        return false;
+    }
+    if (activeExports >= HISTORY_EXPORT_MAX_ACTIVE) {
+        exportsRejected++;
+        error = "Export already in progress";
+        return false;
+    }
+    if (!crcTableReady) initializeCrcTable();
+
+    // Plan: zakresy numerów próbek zamrożone teraz - długość odpowiedzi znana z góry
+    streamCount = 0;
+    recordCount = 0;
+    schemaLength = 0;
+    size_t dataLength = 0;
+    for (const HistoryExportSource* source : historyExportSources) {
+        if (!source->available()) continue;
+        for (int s = 0; s < 2; s++) {
+            Stream& stream = streams[streamCount++];
+            stream.source = source;
+            stream.slow = (s == 1);
+            stream.firstSeq = source->getFirstSeq(stream.slow);
+            stream.count = source->getTotal(stream.slow) - stream.firstSeq;
+            recordCount += stream.count;
+            dataLength += (size_t)stream.count * source->recordSize;
+            schemaLength += writeDescriptor(stream, chunk);
+        }
+    }
+    totalSize = HISTORY_EXPORT_HEADER_SIZE + schemaLength + dataLength + HISTORY_EXPORT_TRAILER_SIZE;
+
+    exportTime = getHistoryTime();
+    timeEpoch = isHistoryTimeEpoch();
+    active = true;
+    activeExports++;
+    exportsStarted++;
+    exportStartMillis = millis();
+
+    stage = STAGE_HEADER;
+    streamIndex = 0;
+    seq = 0;
+    dropped = 0;
+    crc = 0;
+    chunkLen = 0;
+    chunkPos = 0;
+    error = nullptr;
+    return true;
+}
+
+size_t HistoryExport::writeHeader(uint8_t* out) const {
+    uint8_t* p = out;
+    memcpy(p, "ESHX", 4);
+    p += 4;
+    p = putU16(p, HISTORY_EXPORT_VERSION);
+    p = putU16(p, streamCount);
+    p = putU32(p, exportTime);
+    p = putU8(p, timeEpoch ? 1 : 0);
+    p = putU8(p, 0);
+    p = putU16(p, 0);
+    p = putU32(p, schemaLength);
+    return p - out;
+}
+
+// Opis strumienia ze schematem pól (największy - calibration, ~800 B)
+size_t HistoryExport::writeDescriptor(const Stream& stream, uint8_t* out) const {
+    const HistoryExportSource* source = stream.source;
+    uint8_t* p = putName(out, source->name);
+    p = putU8(p, stream.slow ? 1 : 0);
+    p = putU16(p, source->recordSize);
+    p = putU32(p, stream.count);
+    p = putU32(p, stream.firstSeq);
+    p = putU16(p, source->fieldCount);
+    for (uint16_t i = 0; i < source->fieldCount; i++) {
+        const HistoryExportField& field = source->fields[i];
+        p = putName(p, field.name);
+        p = putU8(p, field.type);
+        p = putU16(p, field.offset);
+        p = putU16(p, field.count);
+    }
+    return p - out;
+}
+
+// Próbka nadpisana od planu - rekord zerowy, żeby zachować długość z nagłówka
+size_t HistoryExport::writeRecord(const Stream& stream, uint32_t sampleSeq, uint8_t* out) {
+    size_t size = stream.source->recordSize;
+    if (!stream.source->copyRecord(stream.slow, sampleSeq, out)) {
+        memset(out, 0, size);
+        dropped++;
+    }
+    crc = updateCrc(crc, out, size);
+    return size;
+}
+
+// Kolejny fragment (nagłówek, opis strumienia, rekord przez bufor, stopka) do chunk; false = koniec
+bool HistoryExport::nextChunk() {
+    chunkLen = 0;
+    chunkPos = 0;
+
+    while (chunkLen == 0) {
+        switch (stage) {
+            case STAGE_HEADER:
+                chunkLen = writeHeader(chunk);
+                crc = updateCrc(crc, chunk, chunkLen);
+                stage = STAGE_SCHEMA;
+                break;
+
+            case STAGE_SCHEMA:
+                if (streamIndex == streamCount) {
+                    streamIndex = 0;
+                    seq = streamCount ? streams[0].firstSeq : 0;
+                    stage = STAGE_RECORDS;
+                    break;
+                }
+                chunkLen = writeDescriptor(streams[streamIndex++], chunk);
+                crc = updateCrc(crc, chunk, chunkLen);
+                break;
+
+            case STAGE_RECORDS:
+                if (streamIndex == streamCount) {
+                    stage = STAGE_TRAILER;
+                    break;
+                }
+                if (seq - streams[streamIndex].firstSeq == streams[streamIndex].count) {
+                    streamIndex++;
+                    if (streamIndex < streamCount) seq = streams[streamIndex].firstSeq;
+                    break;
+                }
+                chunkLen = writeRecord(streams[streamIndex], seq++, chunk);
+                break;
+
+            case STAGE_TRAILER: {
+                uint8_t* p = chunk;
+                memcpy(p, "ESHE", 4);
+                p += 4;
+                p = putU32(p, dropped);
+                crc = updateCrc(crc, chunk, p - chunk);
+                p = putU32(p, crc);
+                chunkLen = p - chunk;
+
+                exportsCompleted++;
+                exportDropped += dropped;
+                exportLastSize = totalSize;
+                exportLastDuration = millis() - exportStartMillis;
+                stage = STAGE_DONE;
+                break;
+            }
+
+            case STAGE_DONE:
+                return false;
+        }
+    }
+    return true;
+}
+
+size_t HistoryExport::read(uint8_t* buffer, size_t maxLen) {
+    size_t filled = 0;
+    while (filled < maxLen) {
+        // Rekordy mieszczące się w całości idą prosto do bufora odpowiedzi (bez pośredniej kopii)
+        if (chunkPos == chunkLen && stage == STAGE_RECORDS && streamIndex < streamCount) {
+            const Stream& stream = streams[streamIndex];
+            if (seq - stream.firstSeq < stream.count && maxLen - filled >= stream.source->recordSize) {
+                filled += writeRecord(stream, seq++, buffer + filled);
+                continue;
+            }
+        }
+        if (chunkPos == chunkLen && !nextChunk()) break;
+        size_t part = min(chunkLen - chunkPos, maxLen - filled);
+        memcpy(buffer + filled, chunk + chunkPos, part);
+        chunkPos += part;
+        filled += part;
+    }
+    return filled;
+}
+
+String getHistoryExportStatus() {
+    String status = "- History export: " + String(exportsCompleted) + "/" + String(exportsStarted) +
+                    " completed, rejected " + String(exportsRejected) + ", dropped records " + String(exportDropped);
+    if (exportsCompleted > 0) {
+        unsigned long duration = exportLastDuration > 0 ? exportLastDuration : 1;
+        status += ", last " + String(exportLastSize) + " bytes in " + String(exportLastDuration) + " ms (" +
+                  String((float)exportLastSize / duration, 1) + " kB/s)";
+    }
+    return status + "\n";
+}
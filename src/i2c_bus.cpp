@@ -0,0 +1,365 @@
+#include <i2c_bus.h>
+#include <Wire.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <atomic>
+
+void safePrintln(const String& message);
+
+static TaskHandle_t busTask = NULL;
+static QueueHandle_t busQueues[I2C_PRIORITY_COUNT] = {NULL};
+
+// Konwersje w toku - odczyt po dueMicros, przed transakcjami z kolejki
+static I2CTransaction* pending[I2C_BUS_MAX_PENDING];
+static size_t pendingCount = 0;
+
+// Statystyki zapisuje tylko wykonawca transakcji (setup() przed startem tasku, potem task
+// magistrali) - status/metrics czytają bez blokad
+static I2CBusStats busStats;
+static I2CDeviceStats deviceStats[I2C_BUS_MAX_DEVICES];
+static size_t deviceCount = 0;
+static std::atomic<uint32_t> queueFullCount(0);
+
+// Semafor "wynik gotowy" - jeden na task klienta, tworzony przy pierwszej transakcji
+struct I2CBusClient {
+    TaskHandle_t task;
+    SemaphoreHandle_t done;
+};
+static I2CBusClient clients[I2C_BUS_MAX_CLIENTS];
+static size_t clientCount = 0;
+static portMUX_TYPE clientMux = portMUX_INITIALIZER_UNLOCKED;
+
+static SemaphoreHandle_t getClientSemaphore() {
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+
+    portENTER_CRITICAL(&clientMux);
+    for (size_t i = 0; i < clientCount; i++) {
+        if (clients[i].task == task) {
+            SemaphoreHandle_t done = clients[i].done;
+            portEXIT_CRITICAL(&clientMux);
+            return done;
+        }
+    }
+    portEXIT_CRITICAL(&clientMux);
+
+    // Wpis dodaje tylko sam task, więc bez wyścigu o duplikat
+    SemaphoreHandle_t done = xSemaphoreCreateBinary();
+    if (!done) return NULL;
+
+    portENTER_CRITICAL(&clientMux);
+    bool added = clientCount < I2C_BUS_MAX_CLIENTS;
+    if (added) {
+        clients[clientCount].task = task;
+        clients[clientCount].done = done;
+        clientCount++;
+    }
+    portEXIT_CRITICAL(&clientMux);
+
+    if (!added) {
+        vSemaphoreDelete(done);
+        return NULL;
+    }
+    return done;
+}
+
+static I2CDeviceStats* findDevice(uint8_t address) {
+    for (size_t i = 0; i < deviceCount; i++) {
+        if (deviceStats[i].address == address) return &deviceStats[i];
+    }
+    if (deviceCount >= I2C_BUS_MAX_DEVICES) return NULL;
+
+    I2CDeviceStats& device = deviceStats[deviceCount++];
+    memset(&device, 0, sizeof(device));
+    device.address = address;
+    return &device;
+}
+
+static void recordBusTime(uint8_t address, uint32_t micros) {
+    busStats.busMicros += micros;
+    I2CDeviceStats* device = findDevice(address);
+    if (device) device->busMicros += micros;
+}
+
+// ===== Fazy transakcji na Wire =====
+
+static int writePhase(I2CTransaction& txn, bool sendStop) {
+    Wire.beginTransmission(txn.address);
+    if (txn.writeLength) Wire.write(txn.writeData, txn.writeLength);
+    return Wire.endTransmission(sendStop);
+}
+
+static int readPhase(I2CTransaction& txn) {
+    txn.received = Wire.requestFrom((uint16_t)txn.address, txn.readLength, true);
+    for (size_t i = 0; i < txn.received && i < txn.readLength; i++) {
+        txn.readData[i] = Wire.read();
+    }
+    return txn.received == txn.readLength ? I2C_BUS_OK : I2C_BUS_ERROR_SHORT_READ;
+}
+
+static void completeTransaction(I2CTransaction& txn, int result) {
+    txn.result = result;
+
+    uint32_t latency = micros() - txn.submitMicros;
+    busStats.transactions++;
+    if (result != I2C_BUS_OK) busStats.errors++;
+
+    I2CDeviceStats* device = findDevice(txn.address);
+    if (device) {
+        device->transactions++;
+        if (result != I2C_BUS_OK) device->errors++;
+        device->latencyLast = latency;
+        if (latency > device->latencyMax) device->latencyMax = latency;
+        device->latencyAvg += ((float)latency - device->latencyAvg) * 0.01f;
+    }
+
+    if (txn.done) xSemaphoreGive(txn.done);
+}
+
+// Wykonuje transakcję; false = konwersja w toku (odczyt później z listy pending)
+static bool runTransaction(I2CTransaction& txn, bool allowPending) {
+    uint32_t start = micros();
+    int result = I2C_BUS_OK;
+
+    switch (txn.type) {
+        case I2C_TXN_WRITE:
+            result = writePhase(txn, true);
+            break;
+        case I2C_TXN_READ:
+            result = readPhase(txn);
+            break;
+        case I2C_TXN_WRITE_READ:
+            result = writePhase(txn, false);
+            if (result == I2C_BUS_OK) result = readPhase(txn);
+            break;
+        case I2C_TXN_CONVERT_READ:
+            result = writePhase(txn, true);
+            if (result != I2C_BUS_OK) break;
+            recordBusTime(txn.address, micros() - start);
+
+            if (allowPending && pendingCount < I2C_BUS_MAX_PENDING) {
+                txn.dueMicros = micros() + (uint32_t)txn.waitMs * 1000;
+                pending[pendingCount++] = &txn;
+                if (pendingCount > busStats.pendingPeak) busStats.pendingPeak = pendingCount;
+                return false;
+            }
+
+            // Poza taskiem (setup()) lub brak miejsca - konwersja w miejscu
+            delay(txn.waitMs);
+            start = micros();
+            result = readPhase(txn);
+            break;
+        case I2C_TXN_CALL:
+            result = txn.function(txn.context) == 0 ? I2C_BUS_OK : I2C_BUS_ERROR_CALL;
+            break;
+    }
+
+    recordBusTime(txn.address, micros() - start);
+    completeTransaction(txn, result);
+    return true;
+}
+
+// Odczyty konwersji z minionym terminem; zwraca liczbę wykonanych
+static uint32_t runDuePending() {
+    uint32_t executed = 0;
+    size_t i = 0;
+    while (i < pendingCount) {
+        I2CTransaction& txn = *pending[i];
+        if ((int32_t)(micros() - txn.dueMicros) < 0) {
+            i++;
+            continue;
+        }
+        pending[i] = pending[--pendingCount];
+
+        uint32_t start = micros();
+        int result = readPhase(txn);
+        recordBusTime(txn.address, micros() - start);
+        completeTransaction(txn, result);
+        executed++;
+    }
+    return executed;
+}
+
+static I2CTransaction* nextQueued() {
+    for (uint8_t priority = 0; priority < I2C_PRIORITY_COUNT; priority++) {
+        UBaseType_t waiting = uxQueueMessagesWaiting(busQueues[priority]);
+        if (waiting == 0) continue;
+        if (waiting > busStats.queuePeak[priority]) busStats.queuePeak[priority] = waiting;
+
+        I2CTransaction* txn = NULL;
+        if (xQueueReceive(busQueues[priority], &txn, 0) == pdTRUE) return txn;
+    }
+    return NULL;
+}
+
+static void i2cBusTask(void* parameter) {
+    for (;;) {
+        // Paczka: konwersje po terminie i kolejka (wg priorytetu) jedna za drugą, bez oddawania CPU
+        uint32_t batch = 0;
+        while (true) {
+            batch += runDuePending();
+            I2CTransaction* txn = nextQueued();
+            if (!txn) break;
+            runTransaction(*txn, true);
+            batch++;
+        }
+        if (batch) {
+            busStats.batches++;
+            if (batch > busStats.maxBatch) busStats.maxBatch = batch;
+        }
+
+        // Sen do najbliższego odczytu konwersji albo nowej transakcji (notyfikacja od klienta)
+        TickType_t wait = portMAX_DELAY;
+        if (pendingCount > 0) {
+            int32_t earliest = INT32_MAX;
+            uint32_t now = micros();
+            for (size_t i = 0; i < pendingCount; i++) {
+                int32_t untilDue = (int32_t)(pending[i]->dueMicros - now);
+                if (untilDue < earliest) earliest = untilDue;
+            }
+            if (earliest <= 0) continue;
+            uint32_t tickMicros = portTICK_PERIOD_MS * 1000;
+            wait = (earliest + tickMicros - 1) / tickMicros;
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+bool initializeI2CBus() {
+    if (busTask) return true;
+
+    busStats.startMillis = millis();
+    for (uint8_t priority = 0; priority < I2C_PRIORITY_COUNT; priority++) {
+        busQueues[priority] = xQueueCreate(I2C_BUS_QUEUE_SIZE, sizeof(I2CTransaction*));
+        if (!busQueues[priority]) {
+            safePrintln("I2C bus: failed to create transaction queue");
+            return false;
+        }
+    }
+
+    // Rdzeń 1 jak loop() - biblioteki czujników zakładają jeden kontekst Wire
+    if (xTaskCreatePinnedToCore(i2cBusTask, "i2cBusTask", I2C_BUS_TASK_STACK, NULL, I2C_BUS_TASK_PRIORITY,
+                                &busTask, 1) != pdPASS) {
+        busTask = NULL;
+        safePrintln("I2C bus: failed to create bus task");
+        return false;
+    }
+
+    safePrintln("I2C bus manager started (" + String(I2C_BUS_QUEUE_SIZE) + " transactions per priority)");
+    return true;
+}
+
+int i2cBusTransfer(I2CTransaction& txn, I2CBusPriority priority) {
+    txn.result = I2C_BUS_OK;
+    txn.received = 0;
+    txn.submitMicros = micros();
+    txn.done = NULL;
+    if (priority >= I2C_PRIORITY_COUNT) priority = I2C_PRIORITY_LOW;
+
+    // setup() przed startem tasku i funkcje I2C_TXN_CALL wołające kolejne transakcje
+    if (!busTask || xTaskGetCurrentTaskHandle() == busTask) {
+        runTransaction(txn, false);
+        return txn.result;
+    }
+
+    txn.done = getClientSemaphore();
+    if (!txn.done) return I2C_BUS_ERROR_QUEUE;
+
+    I2CTransaction* queued = &txn;
+    if (xQueueSend(busQueues[priority], &queued, 0) != pdTRUE) {
+        queueFullCount.fetch_add(1, std::memory_order_relaxed);
+        xQueueSend(busQueues[priority], &queued, portMAX_DELAY);
+    }
+    xTaskNotifyGive(busTask);
+
+    // Bez timeoutu - transakcja i bufory są na stosie wołającego, a każda faza na magistrali
+    // jest ograniczona timeoutem Wire
+    xSemaphoreTake(txn.done, portMAX_DELAY);
+    return txn.result;
+}
+
+static int transfer(I2CTransactionType type, uint8_t address, const uint8_t* writeData, size_t writeLength,
+                    uint8_t* readData, size_t readLength, uint16_t waitMs, I2CBusPriority priority) {
+    I2CTransaction txn;
+    memset(&txn, 0, sizeof(txn));
+    txn.type = type;
+    txn.address = address;
+    txn.writeData = writeData;
+    txn.writeLength = writeLength;
+    txn.readData = readData;
+    txn.readLength = readLength;
+    txn.waitMs = waitMs;
+    return i2cBusTransfer(txn, priority);
+}
+
+int i2cBusWrite(uint8_t address, const uint8_t* data, size_t length, I2CBusPriority priority) {
+    return transfer(I2C_TXN_WRITE, address, data, length, NULL, 0, 0, priority);
+}
+
+int i2cBusRead(uint8_t address, uint8_t* data, size_t length, I2CBusPriority priority) {
+    return transfer(I2C_TXN_READ, address, NULL, 0, data, length, 0, priority);
+}
+
+int i2cBusWriteRead(uint8_t address, const uint8_t* writeData, size_t writeLength, uint8_t* readData, size_t readLength,
+                    I2CBusPriority priority) {
+    return transfer(I2C_TXN_WRITE_READ, address, writeData, writeLength, readData, readLength, 0, priority);
+}
+
+int i2cBusConvertRead(uint8_t address, const uint8_t* writeData, size_t writeLength, uint16_t waitMs,
+                      uint8_t* readData, size_t readLength, I2CBusPriority priority) {
+    return transfer(I2C_TXN_CONVERT_READ, address, writeData, writeLength, readData, readLength, waitMs, priority);
+}
+
+int i2cBusCall(uint8_t address, I2CBusFunction function, void* context, I2CBusPriority priority) {
+    I2CTransaction txn;
+    memset(&txn, 0, sizeof(txn));
+    txn.type = I2C_TXN_CALL;
+    txn.address = address;
+    txn.function = function;
+    txn.context = context;
+    return i2cBusTransfer(txn, priority);
+}
+
+bool i2cBusProbe(uint8_t address, I2CBusPriority priority) {
+    return i2cBusWrite(address, NULL, 0, priority) == I2C_BUS_OK;
+}
+
+I2CBusStats getI2CBusStats() {
+    I2CBusStats stats = busStats;
+    stats.queueFull = queueFullCount.load(std::memory_order_relaxed);
+    return stats;
+}
+
+float getI2CBusUtilization() {
+    uint32_t elapsed = millis() - busStats.startMillis;
+    return elapsed ? (float)busStats.busMicros / ((float)elapsed * 1000.0f) : 0.0f;
+}
+
+size_t getI2CDeviceCount() {
+    return deviceCount;
+}
+
+bool getI2CDeviceStats(size_t index, I2CDeviceStats& stats) {
+    if (index >= deviceCount) return false;
+    stats = deviceStats[index];
+    return true;
+}
+
+String getI2CBusStatus() {
+    I2CBusStats stats = getI2CBusStats();
+    String status = "- I2C bus: " + String(busTask ? "task" : "inline (no task)") + ", " + String(stats.transactions) +
+                    " transactions (" + String(stats.errors) + " errors), utilisation " +
+                    String(getI2CBusUtilization() * 100.0f, 1) + "%\n";
+    status += "- I2C batches: " + String(stats.batches) + " (max " + String(stats.maxBatch) + " back to back), queue peak " +
+              String(stats.queuePeak[I2C_PRIORITY_HIGH]) + "/" + String(stats.queuePeak[I2C_PRIORITY_NORMAL]) + "/" +
+              String(stats.queuePeak[I2C_PRIORITY_LOW]) + " (high/normal/low), full " + String(stats.queueFull) +
+              ", conversions in flight peak " + String(stats.pendingPeak) + "\n";
+
+    for (size_t i = 0; i < deviceCount; i++) {
+        const I2CDeviceStats& device = deviceStats[i];
+        uint32_t busAvg = device.transactions ? (uint32_t)(device.busMicros / device.transactions) : 0;
+        status += "- I2C 0x" + String(device.address, HEX) + ": " + String(device.transactions) + " transactions (" +
+                  String(device.errors) + " errors), latency avg " + String((uint32_t)device.latencyAvg) + " us max " +
+                  String(device.latencyMax) + " us, bus " + String(busAvg) + " us/transaction\n";
+    }
+    return status;
+}
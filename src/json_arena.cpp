@@ -0,0 +1,244 @@
+#include <json_arena.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Forward declarations for safe printing functions
+void safePrint(const String& message);
+void safePrintln(const String& message);
+
+#define JSON_ARENA_HEADER JSON_ARENA_ALIGN
+#define JSON_ARENA_NO_BLOCK ((size_t)-1)
+
+static inline size_t alignArenaSize(size_t size) {
+    return (size + JSON_ARENA_ALIGN - 1) & ~(size_t)(JSON_ARENA_ALIGN - 1);
+}
+
+// ===== JsonArena =====
+
+bool JsonArena::begin(size_t size) {
+    if (base) return true;
+
+    size = alignArenaSize(size);
+    base = (uint8_t*)heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    psram = (base != nullptr);
+    if (!base) {
+        // Brak PSRAM - arena w wewnętrznym heapie (jedna alokacja na cały czas życia taska)
+        base = (uint8_t*)malloc(size);
+    }
+    if (!base) {
+        return false;
+    }
+
+    capacity = size;
+    offset = 0;
+    lastBlock = JSON_ARENA_NO_BLOCK;
+    return true;
+}
+
+void* JsonArena::allocate(size_t size) {
+    if (!base) return nullptr;
+
+    size_t total = JSON_ARENA_HEADER + alignArenaSize(size);
+    if (offset + total > capacity) {
+        overflows++;
+        return nullptr;
+    }
+
+    uint8_t* header = base + offset;
+    *(size_t*)header = size;
+    lastBlock = offset;
+    offset += total;
+    if (offset > highWater) highWater = offset;
+    return header + JSON_ARENA_HEADER;
+}
+
+void* JsonArena::reallocate(void* ptr, size_t newSize) {
+    if (!owns(ptr)) return nullptr;
+
+    size_t headerOffset = (uint8_t*)ptr - base - JSON_ARENA_HEADER;
+    size_t oldSize = *(size_t*)(base + headerOffset);
+
+    // Ostatni blok - zmień rozmiar w miejscu (typowe dla shrinkToFit)
+    if (headerOffset == lastBlock) {
+        size_t end = headerOffset + JSON_ARENA_HEADER + alignArenaSize(newSize);
+        if (end > capacity) {
+            overflows++;
+            return nullptr;
+        }
+        *(size_t*)(base + headerOffset) = newSize;
+        offset = end;
+        if (offset > highWater) highWater = offset;
+        return ptr;
+    }
+
+    void* moved = allocate(newSize);
+    if (moved) {
+        memcpy(moved, ptr, min(oldSize, newSize));
+    }
+    return moved;
+}
+
+void JsonArena::release(void* ptr) {
+    if (!owns(ptr)) return;
+
+    // Tylko ostatni blok da się oddać od razu, reszta czeka na reset()
+    size_t headerOffset = (uint8_t*)ptr - base - JSON_ARENA_HEADER;
+    if (headerOffset == lastBlock) {
+        offset = headerOffset;
+        lastBlock = JSON_ARENA_NO_BLOCK;
+    }
+}
+
+bool JsonArena::owns(const void* ptr) const {
+    return base && ptr >= base + JSON_ARENA_HEADER && ptr < base + capacity;
+}
+
+size_t JsonArena::blockSize(const void* ptr) const {
+    if (!owns(ptr)) return 0;
+    return *(const size_t*)((const uint8_t*)ptr - JSON_ARENA_HEADER);
+}
+
+void JsonArena::reset() {
+    offset = 0;
+    lastBlock = JSON_ARENA_NO_BLOCK;
+    resets++;
+}
+
+// ===== Przypisanie aren do tasków =====
+
+static JsonArena jsonArenas[JSON_ARENA_MAX_TASKS];
+static TaskHandle_t jsonArenaTasks[JSON_ARENA_MAX_TASKS] = {nullptr};
+static portMUX_TYPE jsonArenaMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Statystyki alokacji poza areną
+static uint32_t jsonPsramAllocs = 0;
+static uint32_t jsonInternalAllocs = 0;
+
+JsonArena* attachJsonArena(size_t capacity) {
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    int slot = -1;
+
+    portENTER_CRITICAL(&jsonArenaMux);
+    for (int i = 0; i < JSON_ARENA_MAX_TASKS; i++) {
+        if (jsonArenaTasks[i] == task) {
+            portEXIT_CRITICAL(&jsonArenaMux);
+            return &jsonArenas[i];
+        }
+        if (slot < 0 && jsonArenaTasks[i] == nullptr && !jsonArenas[i].isReady()) {
+            slot = i;
+        }
+    }
+    portEXIT_CRITICAL(&jsonArenaMux);
+
+    if (slot < 0) {
+        safePrintln("JSON arena: no free slot for task " + String(pcTaskGetName(task)));
+        return nullptr;
+    }
+    if (!jsonArenas[slot].begin(capacity)) {
+        safePrintln("JSON arena: failed to allocate " + String(capacity) + " bytes");
+        return nullptr;
+    }
+
+    // Rejestracja dopiero po alokacji - currentJsonArena() nie widzi pustej areny
+    portENTER_CRITICAL(&jsonArenaMux);
+    jsonArenaTasks[slot] = task;
+    portEXIT_CRITICAL(&jsonArenaMux);
+
+    safePrintln("JSON arena: " + String(capacity / 1024) + " KB in " +
+                String(jsonArenas[slot].isPsram() ? "PSRAM" : "internal heap") +
+                " for task " + String(pcTaskGetName(task)));
+    return &jsonArenas[slot];
+}
+
+JsonArena* currentJsonArena() {
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    for (int i = 0; i < JSON_ARENA_MAX_TASKS; i++) {
+        if (jsonArenaTasks[i] == task) {
+            return &jsonArenas[i];
+        }
+    }
+    return nullptr;
+}
+
+void resetJsonArena() {
+    JsonArena* arena = currentJsonArena();
+    if (arena) {
+        arena->reset();
+    }
+}
+
+// ===== Alokacja PSRAM =====
+
+void* jsonPsramAllocate(size_t size) {
+    void* ptr = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    portENTER_CRITICAL(&jsonArenaMux);
+    if (ptr) {
+        jsonPsramAllocs++;
+    } else {
+        jsonInternalAllocs++;
+    }
+    portEXIT_CRITICAL(&jsonArenaMux);
+    return ptr ? ptr : malloc(size);
+}
+
+void* jsonPsramReallocate(void* ptr, size_t newSize) {
+    void* moved = heap_caps_realloc(ptr, newSize, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    return moved ? moved : realloc(ptr, newSize);
+}
+
+void jsonPsramFree(void* ptr) {
+    heap_caps_free(ptr);
+}
+
+// ===== ArenaAllocator =====
+
+void* ArenaAllocator::allocate(size_t size) {
+    if (arena) {
+        void* ptr = arena->allocate(size);
+        if (ptr) return ptr;
+    }
+    return jsonPsramAllocate(size);
+}
+
+void ArenaAllocator::deallocate(void* ptr) {
+    if (arena && arena->owns(ptr)) {
+        arena->release(ptr);
+    } else {
+        jsonPsramFree(ptr);
+    }
+}
+
+void* ArenaAllocator::reallocate(void* ptr, size_t newSize) {
+    if (!arena || !arena->owns(ptr)) {
+        return jsonPsramReallocate(ptr, newSize);
+    }
+
+    void* moved = arena->reallocate(ptr, newSize);
+    if (!moved) {
+        // Arena pełna - przenieś blok do PSRAM
+        moved = jsonPsramAllocate(newSize);
+        if (moved) {
+            memcpy(moved, ptr, min(arena->blockSize(ptr), newSize));
+            arena->release(ptr);
+        }
+    }
+    return moved;
+}
+
+String getJsonArenaStatus() {
+    String status;
+    for (int i = 0; i < JSON_ARENA_MAX_TASKS; i++) {
+        if (!jsonArenaTasks[i]) continue;
+        const JsonArena& arena = jsonArenas[i];
+        status += "- JSON arena " + String(pcTaskGetName(jsonArenaTasks[i])) + ": " +
+                  String(arena.getUsed()) + "/" + String(arena.getCapacity()) +
+                  " bytes, high-water " + String(arena.getHighWater()) +
+                  ", resets " + String(arena.getResets()) +
+                  ", overflows " + String(arena.getOverflows()) +
+                  (arena.isPsram() ? "" : " (internal heap)") + "\n";
+    }
+    status += "- JSON PSRAM allocations: " + String(jsonPsramAllocs) +
+              ", internal heap fallbacks " + String(jsonInternalAllocs) + "\n";
+    return status;
+}
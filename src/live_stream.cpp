@@ -0,0 +1,159 @@
+#include <live_stream.h>
+#include <sensors.h>
+#include <esp_heap_caps.h>
+#include <atomic>
+
+// Forward declarations for safe printing functions
+void safePrint(const String& message);
+void safePrintln(const String& message);
+
+// Slot pierścienia - seq = numer próbki + 1 po zapisie, 0 w trakcie zapisu.
+// Czytelnik sprawdza seq przed i po kopii (seqlock), więc nadpisany slot jest wykrywany.
+// Sloty w PSRAM używają tylko zwykłych load/store - atomowy fetch_add tylko na liveHead
+// (wewnętrzny RAM), bo S32C1I nie działa na pamięci zewnętrznej.
+struct LiveSlot {
+    std::atomic<uint32_t> seq;
+    LiveSample sample;
+};
+
+static LiveSlot* liveRing = nullptr;
+static std::atomic<uint32_t> liveHead(0);
+static std::atomic<uint32_t> livePushed(0);
+static uint32_t liveLost = 0;        // licznik konsumenta (WebSocket task)
+
+volatile uint32_t liveStreamChannelMask[2] = {0, 0};
+
+static const char* const liveSPS30Names[] = {"PM1", "PM25", "PM4", "PM10"};
+static const char* const liveSHT40Names[] = {"temperature", "humidity", "pressure"};
+
+bool initializeLiveStream() {
+    if (liveRing) return true;
+
+    size_t size = sizeof(LiveSlot) * LIVE_STREAM_RING_SIZE;
+    liveRing = (LiveSlot*)heap_caps_calloc(1, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!liveRing) {
+        liveRing = (LiveSlot*)calloc(1, size);
+    }
+    if (!liveRing) {
+        safePrintln("Live stream: failed to allocate ring (" + String(size) + " bytes)");
+        return false;
+    }
+
+    safePrintln("Live stream: ring " + String(LIVE_STREAM_RING_SIZE) + " samples (" + String(size / 1024) + " KB)");
+    return true;
+}
+
+void pushLiveSampleSlow(uint8_t channel, float value) {
+    if (!liveRing || channel >= LIVE_CHANNEL_COUNT) return;
+
+    uint32_t pos = liveHead.fetch_add(1, std::memory_order_relaxed);
+    LiveSlot& slot = liveRing[pos & (LIVE_STREAM_RING_SIZE - 1)];
+
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.sample.timestamp = millis();
+    slot.sample.value = value;
+    slot.sample.channel = channel;
+    slot.seq.store(pos + 1, std::memory_order_release);
+
+    livePushed.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint32_t getLiveStreamHead() {
+    return liveHead.load(std::memory_order_acquire);
+}
+
+size_t readLiveSamples(uint32_t& cursor, LiveSample* out, size_t maxSamples, uint32_t& lost) {
+    lost = 0;
+    if (!liveRing) return 0;
+
+    uint32_t head = liveHead.load(std::memory_order_acquire);
+
+    // Kursor za daleko w tyle - przeskocz do najstarszej próbki w pierścieniu
+    if (head - cursor > LIVE_STREAM_RING_SIZE) {
+        lost = head - cursor - LIVE_STREAM_RING_SIZE;
+        cursor = head - LIVE_STREAM_RING_SIZE;
+    }
+
+    size_t count = 0;
+    while (cursor != head && count < maxSamples) {
+        LiveSlot& slot = liveRing[cursor & (LIVE_STREAM_RING_SIZE - 1)];
+        uint32_t expected = cursor + 1;
+        uint32_t seq = slot.seq.load(std::memory_order_acquire);
+
+        if (seq != expected) {
+            // Jeszcze w trakcie zapisu - dokończymy w następnym cyklu
+            if (seq == 0 || (int32_t)(seq - expected) < 0) break;
+            // Już nadpisany przez kolejne okrążenie
+            lost++;
+            cursor++;
+            continue;
+        }
+
+        LiveSample copy = slot.sample;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != seq) {
+            lost++;
+            cursor++;
+            continue;
+        }
+
+        out[count++] = copy;
+        cursor++;
+    }
+
+    liveLost += lost;
+    return count;
+}
+
+void setLiveStreamChannelMask(const LiveChannelMask& mask) {
+    liveStreamChannelMask[0] = mask.bits[0];
+    liveStreamChannelMask[1] = mask.bits[1];
+}
+
+bool liveChannelName(uint8_t channel, char* out, size_t len) {
+    if (channel <= LIVE_SPS30_PM10) {
+        snprintf(out, len, "sps30.%s", liveSPS30Names[channel - LIVE_SPS30_PM1]);
+        return true;
+    }
+    if (channel <= LIVE_SHT40_PRESSURE) {
+        snprintf(out, len, "sht40.%s", liveSHT40Names[channel - LIVE_SHT40_TEMPERATURE]);
+        return true;
+    }
+    if (channel < LIVE_CHANNEL_COUNT) {
+        // Urządzenia MCP3424 kluczowane adresem, jak w subskrypcjach
+        uint8_t device = (channel - LIVE_MCP3424_BASE) / 4;
+        uint8_t ch = (channel - LIVE_MCP3424_BASE) % 4;
+        if (device >= mcp3424Data.deviceCount) return false;
+        snprintf(out, len, "mcp3424.0x%x.ch%u", mcp3424Data.addresses[device], ch + 1);
+        return true;
+    }
+    return false;
+}
+
+bool addLiveChannelSelector(LiveChannelMask& mask, const char* selector) {
+    if (!selector || !*selector) return false;
+
+    size_t selectorLen = strlen(selector);
+    bool matched = false;
+    char name[32];
+
+    // Selektor pasuje do pełnej nazwy albo do jej początku zakończonego kropką
+    for (uint8_t channel = 0; channel < LIVE_CHANNEL_COUNT; channel++) {
+        if (!liveChannelName(channel, name, sizeof(name))) continue;
+        if (strncmp(name, selector, selectorLen) == 0 && (name[selectorLen] == '\0' || name[selectorLen] == '.')) {
+            mask.bits[channel >> 5] |= (1UL << (channel & 31));
+            matched = true;
+        }
+    }
+    return matched;
+}
+
+String getLiveStreamStatus() {
+    uint32_t head = liveHead.load(std::memory_order_relaxed);
+    uint8_t channels = __builtin_popcount(liveStreamChannelMask[0]) + __builtin_popcount(liveStreamChannelMask[1]);
+
+    return "- Live stream: " + String(channels) + " channels active, " + String(livePushed.load()) +
+           " samples pushed, " + String(liveLost) + " lost, ring " +
+           String(min(head, (uint32_t)LIVE_STREAM_RING_SIZE)) + "/" + String(LIVE_STREAM_RING_SIZE) + "\n";
+}
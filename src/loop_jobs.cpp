@@ -0,0 +1,216 @@
+#include <loop_jobs.h>
+#include <config.h>
+#include <sensors.h>
+#include <i2c_sensors.h>
+#include <ips_sensor.h>
+#include <modbus_handler.h>
+#include <mean.h>
+#include <calib.h>
+#include <history.h>
+#include <fan.h>
+#include <telemetry.h>
+#include <scheduler.h>
+
+// Funkcje main.cpp
+void safePrint(const String& message);
+void safePrintln(const String& message);
+bool isSerialAvailable();
+void processSerialCommands();
+void updateSystemStatus();
+
+extern FeatureConfig config;
+extern bool solarSensorStatus;
+extern bool opcn3SensorStatus;
+extern bool i2cSensorStatus;
+extern bool sht40SensorStatus;
+extern bool ipsSensorStatus;
+extern bool mcp3424SensorStatus;
+
+// ===== Zadania loop() - planista z terminami (scheduler.h) =====
+
+static int ipsJob = -1;
+
+static void mcp3424Job()
+{
+    readMCP3424Sensor();
+
+    // Wykonaj kalibrację po odczycie danych z MCP3424
+    if (config.enableI2CSensors && config.enableMCP3424 && mcp3424SensorStatus)
+    {
+        performCalibration();
+    }
+}
+
+static void i2cRetryJob()
+{
+    if (config.enableI2CSensors)
+    {
+        retryFailedI2CSensors();
+    }
+}
+
+static void ipsSensorJob()
+{
+    readIPSSensor();
+
+    // Jedna linia na wywołanie - reszta w następnym przebiegu (wyłączony IPS nie czyta UART - bez wybudzeń)
+    if (config.enableIPS && Serial1.available())
+    {
+        wakeSchedulerJob(ipsJob);
+    }
+}
+
+// Kontekst tasku zdarzeń UART - koniec serii bajtów z IPS
+static void onIPSReceive()
+{
+    wakeSchedulerJob(ipsJob);
+}
+
+static void hchoJob()
+{
+    readHCHO();
+}
+
+static void batteryStatusJob()
+{
+    updateBatteryStatus();
+    checkBatteryShutdown();
+}
+
+static void fanJob()
+{
+    if (config.enableFan)
+    {
+        updateFanRPM();
+    }
+}
+
+static void modbusJob()
+{
+    if (config.enableModbus)
+    {
+        processModbusTask();
+        // Banki przepisywane tylko po zmianie danych źródłowych / DataType
+        updateModbusRegisters();
+    }
+}
+
+static void autoResetJob()
+{
+    if (!config.autoReset)
+        return;
+
+    unsigned long currentTime = millis();
+    static unsigned long lastValidData = millis();
+    static unsigned long lastStatusPrint = 0;
+
+    // Check if any enabled sensors have valid data
+    bool hasValidData = false;
+    if (config.enableSolarSensor && solarSensorStatus)
+        hasValidData = true;
+    if (config.enableOPCN3Sensor && opcn3SensorStatus)
+        hasValidData = true;
+    if (config.enableI2CSensors && i2cSensorStatus)
+        hasValidData = true;
+    if (config.enableSHT40 && sht40SensorStatus)
+        hasValidData = true;
+    if (config.enableIPS && ipsSensorStatus)
+        hasValidData = true;
+    if (config.enableMCP3424 && mcp3424SensorStatus)
+        hasValidData = true;
+
+    if (hasValidData)
+    {
+        lastValidData = currentTime;
+    }
+
+    // Check for sensor timeout - only if any sensors are enabled
+    bool anySensorEnabled = config.enableSolarSensor || config.enableOPCN3Sensor ||
+                            config.enableI2CSensors || config.enableSHT40 || config.enableIPS;
+
+    if (anySensorEnabled && (currentTime - lastValidData > SENSOR_TIMEOUT))
+    {
+        safePrintln("No data from enabled sensors for 2 minutes. Restarting...");
+        delay(1000);
+        ESP.restart();
+    }
+
+    // Check for Modbus timeout - only if there was previous activity and system running >2 minutes
+    if (config.enableModbus && hasHadModbusActivity && (currentTime > 120000) && (currentTime + 1000 - lastModbusActivity > MODBUS_TIMEOUT))
+    {
+        safePrint("No Modbus activity for 5 minutes. Last activity: ");
+        safePrint(String((currentTime - lastModbusActivity) / 1000));
+        safePrint("s ago. Restarting...");
+        safePrintln("");
+        delay(1000);
+        ESP.restart();
+    }
+
+    // Print status every 60 seconds for debugging
+    if (currentTime - lastStatusPrint >= 60000)
+    {
+        lastStatusPrint = currentTime;
+        if (isSerialAvailable())
+        {
+            safePrint("Auto-reset status - Last valid data: ");
+            safePrint(String((currentTime - lastValidData) / 1000));
+            safePrint("s ago");
+            if (config.enableModbus)
+            {
+                safePrint(", Modbus: ");
+                if (hasHadModbusActivity)
+                {
+                    safePrint(String((currentTime - lastModbusActivity) / 1000));
+                    safePrint("s ago");
+                }
+                else
+                {
+                    safePrint("never (uptime: ");
+                    safePrint(String(currentTime / 1000));
+                    safePrint("s)");
+                }
+            }
+            safePrintln("");
+
+            // Print moving averages buffer status
+            printMovingAverageStatus();
+
+            // Print history status
+            printHistoryMemoryUsage();
+            printHistoryStatus();
+        }
+    }
+}
+
+size_t registerLoopJobs()
+{
+    // UART czujników - solar dzieli UART2 z Modbus RTU, więc bez callbacku onReceive (polling).
+    // Rejestracja niezależnie od config - CONFIG_SOLAR_ON / IPS z WebSocket działają bez restartu,
+    // odczyty wracają od razu, gdy czujnik wyłączony
+    addSchedulerJob("solar", 20, readSolarSensor);
+    ipsJob = addSchedulerJob("ips", 1000, ipsSensorJob);
+    Serial1.onReceive(onIPSReceive, true);
+    addSchedulerJob("opcn3", OPCN3_READ_INTERVAL, readOPCN3Sensor);
+    addSchedulerJob("hcho", HCHO_READ_INTERVAL, hchoJob, 50);
+
+    // I2C - przesunięcia rozkładają zadania na magistrali w ramach sekundy
+    addSchedulerJob("mcp3424", MCP3424_STATUS_INTERVAL, mcp3424Job);
+    addSchedulerJob("i2c", I2C_READ_INTERVAL, readI2CSensors, 100);
+    addSchedulerJob("sps30", SPS30_READ_INTERVAL, readSPS30Sensor, 200);
+    addSchedulerJob("battery", BATTERY_READ_INTERVAL, readBatteryVoltage, 300);
+    addSchedulerJob("i2c_retry", I2C_RETRY_CHECK_INTERVAL, i2cRetryJob, 10000);
+    addSchedulerJob("battery_status", 1000, batteryStatusJob, 350);
+    addSchedulerJob("serial_sensors", 1000, readSerialSensors);
+    addSchedulerJob("fan", 100, fanJob);
+
+    // Modbus RTU obsługuje własny task; tu rejestr komend i przepisywanie banków
+    addSchedulerJob("modbus", 50, modbusJob);
+    addSchedulerJob("serial_commands", 50, processSerialCommands);
+    addSchedulerJob("system_status", 10000, updateSystemStatus);
+    addSchedulerJob("moving_averages", 5000, updateMovingAverages, 5000);
+    addSchedulerJob("history", 1000, updateSensorHistory, 500);
+    // Generacje sekcji snapshotu telemetrii (po odczytach i średnich)
+    addSchedulerJob("telemetry", 100, updateTelemetrySnapshot);
+    addSchedulerJob("auto_reset", 1000, autoResetJob);
+    return getSchedulerJobCount();
+}
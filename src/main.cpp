@@ -22,6 +22,12 @@
 #include <network_config.h>
 #include <history.h>
 #include <fan.h>
+#include <command_registry.h>
+#include <metrics.h>
+#include <telemetry.h>
+#include <scheduler.h>
+#include <loop_jobs.h>
+#include <i2c_bus.h>
 
 // #include <html.h>
 
@@ -41,8 +47,6 @@ Adafruit_NeoPixel pixels(1, WS2812_PIN, NEO_GRB + NEO_KHZ800);
 
 // Global variables
 bool sendDataFlag = false;
-unsigned long lastSensorCheck = 0;
-unsigned long lastMovingAverageUpdate = 0;
 
 // Network flag for display
 bool turnOnNetwork = false;
@@ -67,6 +71,7 @@ void loop();
 void watchDogTask(void *parameter);
 void initializeHardware();
 void processSerialCommands();
+void registerSerialCommands();
 void updateSystemStatus();
 
 // Safe Serial printing functions
@@ -211,6 +216,10 @@ void setup()
     // Initialize sensor history in PSRAM
     initializeHistory();
 
+    // Rejestr komend Serial/Modbus (przed Modbus - wspolne kody rejestru komend)
+    registerSerialCommands();
+    registerModbusCommands();
+
     // Initialize communication protocols
     if (config.enableModbus)
     {
@@ -245,6 +254,11 @@ void setup()
         Serial.println("=== System initialization complete ===");
     }
     delay(1000);
+
+    // Zadania loop() na końcu setup() - setup działa na loopTask, planista zapamiętuje ten task
+    // (wakeSchedulerJob), a terminy startują po inicjalizacji
+    size_t loopJobs = registerLoopJobs();
+    safePrintln("Scheduler: " + String(loopJobs) + " loop jobs registered");
     // if (config.enablePushbullet && strlen(config.pushbulletToken) > 0) {
     //     // Wait a bit for WiFi to stabilize
     //    // delay(5000);
@@ -254,253 +268,16 @@ void setup()
 
 void loop()
 {
-    unsigned long currentTime = millis();
+    unsigned long loopStartMicros = micros();
 
     esp_task_wdt_reset();
 
-    // Read sensors
-    if (config.enableSolarSensor)
-    {
-        readSolarSensor();
-    }
-
-    if (config.enableOPCN3Sensor)
-    {
-        readOPCN3Sensor();
-    }
-
-    if (config.enableI2CSensors)
-    {
-        readI2CSensors();
-
-        // Wykonaj kalibrację po odczycie danych z MCP3424
-        if (config.enableMCP3424 && mcp3424SensorStatus)
-        {
-            performCalibration();
-        }
-    }
-
-    if (config.enableIPS)
-    {
-        readIPSSensor();
-    }
-
-    if (config.enableHCHO)
-    {
-        readHCHO();
-    }
-
-    readBatteryVoltage();
-    readSerialSensors();
-
-    // Update battery status every second (not every loop iteration)
-    static unsigned long lastBatteryUpdate = 0;
-    if (currentTime - lastBatteryUpdate >= 1000) {
-        lastBatteryUpdate = currentTime;
-        updateBatteryStatus();
-        checkBatteryShutdown();
-    }
-
-    // Update fan RPM measurement if enabled
-    if (config.enableFan)
-    {
-        updateFanRPM();
-    }
-
-    // Update Modbus registers
-    if (config.enableModbus)
-    {
-        processModbusTask();
-
-        if (solarSensorStatus && currentTime - lastSensorCheck >= 1000)
-        {
-            updateModbusSolarRegisters();
-        }
-
-        if (opcn3SensorStatus)
-        {
-            updateModbusOPCN3Registers();
-        }
-
-        if (i2cSensorStatus)
-        {
-            updateModbusI2CRegisters();
-        }
-
-        if (mcp3424SensorStatus)
-        {
-            updateModbusMCP3424Registers();
-        }
-
-        if (ads1110SensorStatus)
-        {
-            updateModbusADS1110Registers();
-        }
-
-        if (ina219SensorStatus)
-        {
-            updateModbusINA219Registers();
-        }
-
-        if (sht40SensorStatus)
-        {
-            updateModbusSHT40Registers();
-        }
-
-        if (ipsSensorStatus)
-        {
-            updateModbusIPSRegisters();
-        }
+    runSchedulerJobs();
 
-        if (hchoSensorStatus)
-        {
-            updateModbusHCHORegisters();
-        }
-
-        // Debug SPS30 status
-        static unsigned long lastSPS30Debug = 0;
-        if (currentTime - lastSPS30Debug > 15000)
-        { // Every 15 seconds
-            lastSPS30Debug = currentTime;
-        }
+    // Czas przebiegu bez snu - /metrics
+    recordLoopTime(micros() - loopStartMicros);
 
-        if (sps30SensorStatus)
-        {
-            updateModbusSPS30Registers();
-        }
-
-        // Update calibrated data registers if calibration is enabled
-        if (calibConfig.enableCalibration && calibratedData.valid)
-        {
-            updateModbusCalibrationRegisters();
-        }
-
-        lastSensorCheck = currentTime;
-    }
-
-    // Process serial commands
-    processSerialCommands();
-
-    // Update system status indicators
-    updateSystemStatus();
-
-    // Update moving averages every 5 seconds
-    if (currentTime - lastMovingAverageUpdate >= 5000)
-    {
-        updateMovingAverages();
-        lastMovingAverageUpdate = currentTime;
-    }
-
-    // Update sensor history
-    updateSensorHistory();
-
-    // Periodic heap monitoring (every 2 minutes)
-    // if (currentTime - last_heap_report >= 120000) {
-    //     last_heap_report = currentTime;
-
-    //     // Take snapshot for history
-    //     takeHeapSnapshot();
-
-    //     safePrintln("\n=== PERIODIC HEAP MONITOR ===");
-    //     printHeapInfo();
-
-    //     // Auto-analyze if memory usage is concerning
-    //     uint32_t current_free = ESP.getFreeHeap();
-    //     if (heap_baseline > 0) {
-    //         int32_t memory_change = (int32_t)current_free - (int32_t)heap_baseline;
-    //         if (memory_change < -10000) { // More than 10KB lost
-    //             safePrintln("ALERT: Significant memory loss detected! Starting detailed analysis...");
-    //             analyzeMemoryLeaks();
-    //         }
-    //     }
-    // }
-
-    // Auto reset check
-    if (config.autoReset)
-    {
-        static unsigned long lastValidData = millis();
-        static unsigned long lastStatusPrint = 0;
-
-        // Check if any enabled sensors have valid data
-        bool hasValidData = false;
-        if (config.enableSolarSensor && solarSensorStatus)
-            hasValidData = true;
-        if (config.enableOPCN3Sensor && opcn3SensorStatus)
-            hasValidData = true;
-        if (config.enableI2CSensors && i2cSensorStatus)
-            hasValidData = true;
-        if (config.enableSHT40 && sht40SensorStatus)
-            hasValidData = true;
-        if (config.enableIPS && ipsSensorStatus)
-            hasValidData = true;
-        if (config.enableMCP3424 && mcp3424SensorStatus)
-            hasValidData = true;
-
-        if (hasValidData)
-        {
-            lastValidData = currentTime;
-        }
-
-        // Check for sensor timeout - only if any sensors are enabled
-        bool anySensorEnabled = config.enableSolarSensor || config.enableOPCN3Sensor ||
-                                config.enableI2CSensors || config.enableSHT40 || config.enableIPS;
-
-        if (anySensorEnabled && (currentTime - lastValidData > SENSOR_TIMEOUT))
-        {
-            safePrintln("No data from enabled sensors for 2 minutes. Restarting...");
-            delay(1000);
-            ESP.restart();
-        }
-
-        // Check for Modbus timeout - only if there was previous activity and system running >2 minutes
-        if (config.enableModbus && hasHadModbusActivity && (currentTime > 120000) && (currentTime + 1000 - lastModbusActivity > MODBUS_TIMEOUT))
-        {
-            safePrint("No Modbus activity for 5 minutes. Last activity: ");
-            safePrint(String((currentTime - lastModbusActivity) / 1000));
-            safePrint("s ago. Restarting...");
-            safePrintln("");
-            delay(1000);
-            ESP.restart();
-        }
-
-        // Print status every 60 seconds for debugging
-        if (currentTime - lastStatusPrint >= 60000)
-        {
-            lastStatusPrint = currentTime;
-            if (isSerialAvailable())
-            {
-                safePrint("Auto-reset status - Last valid data: ");
-                safePrint(String((currentTime - lastValidData) / 1000));
-                safePrint("s ago");
-                if (config.enableModbus)
-                {
-                    safePrint(", Modbus: ");
-                    if (hasHadModbusActivity)
-                    {
-                        safePrint(String((currentTime - lastModbusActivity) / 1000));
-                        safePrint("s ago");
-                    }
-                    else
-                    {
-                        safePrint("never (uptime: ");
-                        safePrint(String(currentTime / 1000));
-                        safePrint("s)");
-                    }
-                }
-                safePrintln("");
-
-                // Print moving averages buffer status
-                printMovingAverageStatus();
-
-                // Print history status
-                printHistoryMemoryUsage();
-                printHistoryStatus();
-            }
-        }
-    }
-
-    // Small delay to prevent overwhelming the system
-    delay(10);
+    sleepUntilNextSchedulerJob();
 }
 
 void initializeHardware()
@@ -565,758 +342,895 @@ void initializeHardware()
     }
 }
 
-void processSerialCommands()
+// ===== Komendy Serial (rejestr komend) =====
+
+static void serialCmdSend(CommandContext&)
 {
-    // Process commands from main serial - only if connected
-    if (Serial && Serial.available() > 0)
-    {
-        String command = Serial.readStringUntil('\n');
-        command.trim();
+    sendDataFlag = true;
+}
 
-        if (command.equals("SEND"))
-        {
-            sendDataFlag = true;
-        }
-        else if (command.equals("STATUS"))
+static void serialCmdStatus(CommandContext&)
+{
+    if (isSerialAvailable())
+    {
+        safePrintln("=== System Status ===");
+        safePrintln("Solar Sensor: " + String(solarSensorStatus ? "OK" : "ERROR"));
+        safePrintln("OPCN3 Sensor: " + String(opcn3SensorStatus ? "OK" : "ERROR"));
+        safePrintln("I2C Overall: " + String(i2cSensorStatus ? "OK" : "ERROR"));
+        safePrintln("  - SHT30: " + String(sht30SensorStatus ? "OK" : (config.enableSHT30 ? "ERROR" : "DISABLED")));
+        safePrintln("  - BME280: " + String(bme280SensorStatus ? "OK" : (config.enableBME280 ? "ERROR" : "DISABLED")));
+        safePrintln("  - SCD41: " + String(scd41SensorStatus ? "OK" : (config.enableSCD41 ? "ERROR" : "DISABLED")));
+        safePrintln("  - SHT40: " + String(sht40SensorStatus ? "OK" : (config.enableSHT40 ? "ERROR" : "DISABLED")));
+        safePrintln("  - MCP3424: " + String(mcp3424SensorStatus ? "OK" : (config.enableMCP3424 ? "ERROR" : "DISABLED")));
+        safePrintln("  - ADS1110: " + String(ads1110SensorStatus ? "OK" : (config.enableADS1110 ? "ERROR" : "DISABLED")));
+        safePrintln("  - INA219: " + String(ina219SensorStatus ? "OK" : (config.enableINA219 ? "ERROR" : "DISABLED")));
+        safePrintln("  - SPS30: " + String(sps30SensorStatus ? "OK" : (config.enableSPS30 ? "ERROR" : "DISABLED")));
+        safePrintln("IPS Sensor: " + String(ipsSensorStatus ? "OK" : (config.enableIPS ? "ERROR" : "DISABLED")));
+        safePrintln("HCHO Sensor: " + String(hchoSensorStatus ? "OK" : (config.enableHCHO ? "ERROR" : "DISABLED")));
+        if (config.enableFan)
         {
-            if (isSerialAvailable())
+            safePrintln("Fan Control: " + String(isFanEnabled() ? "ON" : "OFF") + " (" + String(getFanDutyCycle()) + "%, " + String(getFanRPM()) + " RPM)");
+            safePrintln("GLine Router: " + String(isGLineEnabled() ? "ENABLED" : "DISABLED"));
+            if (isSleepModeActive())
             {
-                safePrintln("=== System Status ===");
-                safePrintln("Solar Sensor: " + String(solarSensorStatus ? "OK" : "ERROR"));
-                safePrintln("OPCN3 Sensor: " + String(opcn3SensorStatus ? "OK" : "ERROR"));
-                safePrintln("I2C Overall: " + String(i2cSensorStatus ? "OK" : "ERROR"));
-                safePrintln("  - SHT30: " + String(sht30SensorStatus ? "OK" : (config.enableSHT30 ? "ERROR" : "DISABLED")));
-                safePrintln("  - BME280: " + String(bme280SensorStatus ? "OK" : (config.enableBME280 ? "ERROR" : "DISABLED")));
-                safePrintln("  - SCD41: " + String(scd41SensorStatus ? "OK" : (config.enableSCD41 ? "ERROR" : "DISABLED")));
-                safePrintln("  - SHT40: " + String(sht40SensorStatus ? "OK" : (config.enableSHT40 ? "ERROR" : "DISABLED")));
-                safePrintln("  - MCP3424: " + String(mcp3424SensorStatus ? "OK" : (config.enableMCP3424 ? "ERROR" : "DISABLED")));
-                safePrintln("  - ADS1110: " + String(ads1110SensorStatus ? "OK" : (config.enableADS1110 ? "ERROR" : "DISABLED")));
-                safePrintln("  - INA219: " + String(ina219SensorStatus ? "OK" : (config.enableINA219 ? "ERROR" : "DISABLED")));
-                safePrintln("  - SPS30: " + String(sps30SensorStatus ? "OK" : (config.enableSPS30 ? "ERROR" : "DISABLED")));
-                safePrintln("IPS Sensor: " + String(ipsSensorStatus ? "OK" : (config.enableIPS ? "ERROR" : "DISABLED")));
-                safePrintln("HCHO Sensor: " + String(hchoSensorStatus ? "OK" : (config.enableHCHO ? "ERROR" : "DISABLED")));
-                if (config.enableFan)
-                {
-                    safePrintln("Fan Control: " + String(isFanEnabled() ? "ON" : "OFF") + " (" + String(getFanDutyCycle()) + "%, " + String(getFanRPM()) + " RPM)");
-                    safePrintln("GLine Router: " + String(isGLineEnabled() ? "ENABLED" : "DISABLED"));
-                    if (isSleepModeActive())
-                    {
-                        FanStatus status = getFanStatus();
-                        safePrintln("Sleep Mode: ACTIVE (End: " + String(status.sleepEndTime) + ")");
-                    }
-                }
-                else
-                {
-                    safePrintln("Fan Control: DISABLED");
-                }
-
-                safePrintln("WiFi: " + String(WiFi.status() == WL_CONNECTED ? "CONNECTED" : "DISCONNECTED"));
-                // ip address
-                safePrintln("IP Address: " + String(WiFi.localIP().toString()));
-                safePrintln("Auto Reset: " + String(config.autoReset ? "ENABLED" : "DISABLED"));
-                safePrintln("Low Power Mode: " + String(config.lowPowerMode ? "ENABLED" : "DISABLED"));
-                safePrintln("Pushbullet: " + String(config.enablePushbullet ? "ENABLED" : "DISABLED"));
-                if (config.enablePushbullet)
-                {
-                    safePrintln("Pushbullet Token: " + String(strlen(config.pushbulletToken) > 0 ? "SET" : "NOT SET"));
-                }
-                if (config.enableModbus)
-                {
-                    safePrint("Modbus Activity: ");
-                    if (hasHadModbusActivity)
-                    {
-                        safePrintln("Last " + String((millis() - lastModbusActivity) / 1000) + " seconds ago");
-                    }
-                    else
-                    {
-                        safePrintln("Never detected");
-                    }
-                }
-                safePrintln("Free Heap: " + String(ESP.getFreeHeap()));
-                safePrintln("PSRAM Size: " + String(ESP.getPsramSize() / 1024) + " KB");
-                safePrintln("Free PSRAM: " + String(ESP.getFreePsram() / 1024) + " KB");
-                safePrintln("Uptime: " + String(millis() / 1000) + " seconds");
-
-                // Battery status
-                if (batteryData.valid)
-                {
-                    safePrintln("=== Battery Status ===");
-                    safePrintln("Voltage: " + String(batteryData.voltage, 3) + "V");
-                    safePrintln("Current: " + String(batteryData.current, 2) + "mA");
-                    safePrintln("Power: " + String(batteryData.power, 1) + "mW");
-                    safePrintln("Charge: " + String(batteryData.chargePercent) + "%");
-                    safePrintln("Source: " + String(batteryData.isBatteryPowered ? "External" : "Battery"));
-                    safePrintln("Low Battery: " + String(batteryData.lowBattery ? "YES" : "NO"));
-                    safePrintln("Critical: " + String(batteryData.criticalBattery ? "YES" : "NO"));
-                }
-                else
-                {
-                    safePrintln("Battery Status: No valid data");
-                }
-
-                // Time info from ESP32 built-in time functions
-
-                if (isTimeSet())
-                {
-                    safePrintln("Time: " + getFormattedTime());
-                    safePrintln("Date: " + getFormattedDate());
-                    safePrintln("Epoch: " + String(getEpochTime()));
-
-                    struct tm timeinfo;
-                    if (getLocalTime(&timeinfo))
-                    {
-                        safePrintln("Day of Week: " + String(timeinfo.tm_wday));
-                        safePrintln("Timezone: Poland (UTC+1/UTC+2 with DST)");
-                    }
-                }
-                else
-                {
-                    safePrintln("Time: Not synchronized");
-                }
-
-                // Calibration status
-                // safePrintln("Calibration: " + String(calibConfig.enableCalibration ? "ENABLED" : "DISABLED"));
-                // if (calibConfig.enableCalibration) {
-                //     safePrintln("Calibration Valid: " + String(calibratedData.valid ? "YES" : "NO"));
-                //     safePrintln("Last Calibration: " + String((millis() - calibratedData.lastUpdate) / 1000) + " seconds ago");
-                // }
-
-                // safePrintln("=== Moving Averages Status ===");
-                // printMovingAverageStatus();
-
-                safePrintln("=== Fan Control Commands ===");
-                safePrintln("FAN_ON - Turn fan ON at 50% speed");
-                safePrintln("FAN_OFF - Turn fan OFF");
-                safePrintln("FAN_SPEED_[0-100] - Set fan speed (e.g., FAN_SPEED_75)");
-                safePrintln("GLINE_ON - Enable GLine router");
-                safePrintln("GLINE_OFF - Disable GLine router");
-                safePrintln("SLEEP_[delay]_[duration] - Schedule sleep mode (e.g., SLEEP_60_300)");
-                safePrintln("SLEEP_STOP - Stop sleep mode immediately");
-                safePrintln("FAN_STATUS - Show detailed fan status");
-                
-                safePrintln("=== MCP3424 Mapping Commands ===");
-                safePrintln("MCP3424_MAPPING - Show detailed device mapping info");
-                safePrintln("MCP3424_SCAN - Rescan I2C bus and update device detection");
-                safePrintln("MCP3424_RESET - Reset mapping to defaults and rescan");
-                safePrintln("MCP3424_GET_[GAS] - Get device info for gas type (e.g., MCP3424_GET_SO2)");
-                safePrintln("MCP3424_ADDR_[HEX] - Get device info for I2C address (e.g., MCP3424_ADDR_6A)");
-                safePrintln("Available gas types: NO, O3, NO2, CO, SO2, TGS1, TGS2, TGS3");
-                
-                safePrintln("=== Memory Management Commands ===");
-                safePrintln("MEMORY_EMERGENCY - Full aggressive memory cleanup & analysis");
-                safePrintln("MEMORY_FORCE_GC - Force defragmentation garbage collection");
-                safePrintln("MEMORY_SMART - Intelligent adaptive memory cleanup");
-                safePrintln("Current memory status:");
-                safePrintln("- Free heap: " + String(ESP.getFreeHeap()) + " bytes");
-                safePrintln("- Min free ever: " + String(ESP.getMinFreeHeap()) + " bytes");
-                safePrintln("- Largest block: " + String(heap_caps_get_largest_free_block(MALLOC_CAP_8BIT)) + " bytes");
-
-                extern int wsClientCount;
-                extern AsyncWebSocket ws;
-                safePrintln("WebSocket status: " + String(wsClientCount) + " tracked, " + String(ws.count()) + " active");
-                if (wsClientCount != ws.count())
-                {
-                    safePrintln("WARNING: WebSocket client count mismatch - possible memory leak!");
-                }
+                FanStatus status = getFanStatus();
+                safePrintln("Sleep Mode: ACTIVE (End: " + String(status.sleepEndTime) + ")");
             }
         }
-        else if (command.equals("AVGSTATUS"))
+        else
         {
-            if (isSerialAvailable())
-            {
-                safePrintln("=== Moving Averages Buffer Status ===");
-                printMovingAverageStatus();
-            }
+            safePrintln("Fan Control: DISABLED");
         }
-        else if (command.startsWith("CONFIG_"))
+
+        safePrintln("WiFi: " + String(WiFi.status() == WL_CONNECTED ? "CONNECTED" : "DISCONNECTED"));
+        // ip address
+        safePrintln("IP Address: " + String(WiFi.localIP().toString()));
+        safePrintln("Auto Reset: " + String(config.autoReset ? "ENABLED" : "DISABLED"));
+        safePrintln("Low Power Mode: " + String(config.lowPowerMode ? "ENABLED" : "DISABLED"));
+        safePrintln("Pushbullet: " + String(config.enablePushbullet ? "ENABLED" : "DISABLED"));
+        if (config.enablePushbullet)
         {
-            // Configuration commands
-            if (command.equals("CONFIG_SOLAR_ON"))
-            {
-                config.enableSolarSensor = true;
-                safePrintln("Solar sensor enabled");
-            }
-            else if (command.equals("CONFIG_SOLAR_OFF"))
-            {
-                config.enableSolarSensor = false;
-                safePrintln("Solar sensor disabled");
-            }
-            else if (command.equals("CONFIG_OPCN3_ON"))
-            {
-                config.enableOPCN3Sensor = true;
-                safePrintln("OPCN3 sensor enabled");
-            }
-            else if (command.equals("CONFIG_OPCN3_OFF"))
-            {
-                config.enableOPCN3Sensor = false;
-                safePrintln("OPCN3 sensor disabled");
-            }
-            else if (command.equals("CONFIG_I2C_ON"))
-            {
-                config.enableI2CSensors = true;
-                initializeI2C();
-                safePrintln("I2C sensors enabled");
-            }
-            else if (command.equals("CONFIG_I2C_OFF"))
-            {
-                config.enableI2CSensors = false;
-                safePrintln("I2C sensors disabled");
-            }
-            else if (command.equals("CONFIG_SHT30_ON"))
-            {
-                enableI2CSensor(SENSOR_SHT30);
-            }
-            else if (command.equals("CONFIG_SHT30_OFF"))
-            {
-                disableI2CSensor(SENSOR_SHT30);
-            }
-            else if (command.equals("CONFIG_BME280_ON"))
-            {
-                enableI2CSensor(SENSOR_BME280);
-            }
-            else if (command.equals("CONFIG_BME280_OFF"))
-            {
-                disableI2CSensor(SENSOR_BME280);
-            }
-            else if (command.equals("CONFIG_SCD41_ON"))
-            {
-                enableI2CSensor(SENSOR_SCD41);
-            }
-            else if (command.equals("CONFIG_SCD41_OFF"))
-            {
-                disableI2CSensor(SENSOR_SCD41);
-            }
-            else if (command.equals("RESET_SCD41"))
-            {
-                resetSCD41();
-            }
-            else if (command.equals("CONFIG_SHT40_ON"))
-            {
-                enableI2CSensor(SENSOR_SHT40);
-            }
-            else if (command.equals("CONFIG_SHT40_OFF"))
-            {
-                disableI2CSensor(SENSOR_SHT40);
-            }
-            else if (command.equals("CONFIG_MCP3424_ON"))
-            {
-                enableI2CSensor(SENSOR_MCP3424);
-            }
-            else if (command.equals("CONFIG_MCP3424_OFF"))
-            {
-                disableI2CSensor(SENSOR_MCP3424);
-            }
-            else if (command.equals("CONFIG_ADS1110_ON"))
-            {
-                enableI2CSensor(SENSOR_ADS1110);
-            }
-            else if (command.equals("CONFIG_ADS1110_OFF"))
-            {
-                disableI2CSensor(SENSOR_ADS1110);
-            }
-            else if (command.equals("CONFIG_INA219_ON"))
-            {
-                enableI2CSensor(SENSOR_INA219);
-            }
-            else if (command.equals("CONFIG_INA219_OFF"))
-            {
-                disableI2CSensor(SENSOR_INA219);
-            }
-            else if (command.equals("CONFIG_SPS30_ON"))
-            {
-                enableI2CSensor(SENSOR_SPS30);
-            }
-            else if (command.equals("CONFIG_SPS30_OFF"))
-            {
-                disableI2CSensor(SENSOR_SPS30);
-            }
-            else if (command.equals("CONFIG_ADS1110_"))
-            {
-                // Parse ADS1110 configuration: CONFIG_ADS1110_RATE_GAIN (e.g., CONFIG_ADS1110_60_4)
-                String params = command.substring(15); // Remove "CONFIG_ADS1110_"
-                int separatorIndex = params.indexOf('_');
-                if (separatorIndex > 0)
-                {
-                    uint8_t dataRate = params.substring(0, separatorIndex).toInt();
-                    uint8_t gain = params.substring(separatorIndex + 1).toInt();
-                    configureADS1110(dataRate, gain);
-                }
-                else
-                {
-                    safePrintln("Invalid ADS1110 config format. Use: CONFIG_ADS1110_RATE_GAIN (e.g., CONFIG_ADS1110_60_4)");
-                }
-            }
-            else if (command.equals("CONFIG_IPS_ON"))
-            {
-                enableI2CSensor(SENSOR_IPS);
-            }
-            else if (command.equals("CONFIG_IPS_OFF"))
-            {
-                disableI2CSensor(SENSOR_IPS);
-            }
-            else if (command.equals("CONFIG_MODBUS_ON"))
-            {
-                config.enableModbus = true;
-                initializeModbus();
-                safePrintln("Modbus enabled");
-            }
-            else if (command.equals("CONFIG_MODBUS_OFF"))
-            {
-                config.enableModbus = false;
-                safePrintln("Modbus disabled");
-            }
-            else if (command.equals("CONFIG_AUTO_RESET_ON"))
-            {
-                config.autoReset = true;
-                safePrintln("Auto reset enabled");
-            }
-            else if (command.equals("CONFIG_AUTO_RESET_OFF"))
-            {
-                config.autoReset = false;
-                safePrintln("Auto reset disabled");
-            }
-            else if (command.equals("CONFIG_LOW_POWER_ON"))
-            {
-                config.lowPowerMode = true;
-                safePrintln("Low power mode enabled - LED disabled");
-            }
-            else if (command.equals("CONFIG_LOW_POWER_OFF"))
-            {
-                config.lowPowerMode = false;
-                safePrintln("Low power mode disabled - LED enabled");
-            }
-            else if (command.equals("PUSHBULLET_TEST"))
-            {
-                if (config.enablePushbullet && strlen(config.pushbulletToken) > 0)
-                {
-                    sendPushbulletNotification("🧪 Test Notification", "This is a test notification from ESP32 Sensor Cube\nTime: " + getFormattedTime() + "\nUptime: " + getUptimeString());
-                    safePrintln("Test notification sent");
-                }
-                else
-                {
-                    safePrintln("Pushbullet not configured - enable and set token first");
-                }
-            }
-            else if (command.equals("PUSHBULLET_BATTERY_TEST"))
-            {
-                if (config.enablePushbullet && strlen(config.pushbulletToken) > 0)
-                {
-                    sendBatteryCriticalNotification();
-                    safePrintln("Battery critical test notification sent");
-                }
-                else
-                {
-                    safePrintln("Pushbullet not configured - enable and set token first");
-                }
-            }
-            else if (command.equals("CONFIG_CALIB_ON"))
-            {
-                extern CalibrationConfig calibConfig;
-                calibConfig.enableCalibration = true;
-                safePrintln("Calibration enabled");
-            }
-            else if (command.equals("CONFIG_CALIB_OFF"))
-            {
-                extern CalibrationConfig calibConfig;
-                calibConfig.enableCalibration = false;
-                safePrintln("Calibration disabled");
-            }
-            else if (command.equals("CONFIG_TGS_ON"))
-            {
-                extern CalibrationConfig calibConfig;
-                calibConfig.enableTGSSensors = true;
-                safePrintln("TGS sensors enabled");
-            }
-            else if (command.equals("CONFIG_TGS_OFF"))
-            {
-                extern CalibrationConfig calibConfig;
-                calibConfig.enableTGSSensors = false;
-                safePrintln("TGS sensors disabled");
-            }
-            else if (command.equals("CONFIG_GASES_ON"))
-            {
-                extern CalibrationConfig calibConfig;
-                calibConfig.enableGasSensors = true;
-                safePrintln("Gas sensors enabled");
-            }
-            else if (command.equals("CONFIG_GASES_OFF"))
-            {
-                extern CalibrationConfig calibConfig;
-                calibConfig.enableGasSensors = false;
-                safePrintln("Gas sensors disabled");
-            }
-            else if (command.startsWith("FAN_"))
-            {
-                // Fan control commands
-                if (!config.enableFan)
-                {
-                    safePrintln("Fan control is DISABLED in configuration");
-                }
-                else
-                {
-                    if (command.equals("FAN_ON"))
-                    {
-                        setFanSpeed(50); // Default 50% speed
-                        safePrintln("Fan turned ON at 50% speed");
-                    }
-                    else if (command.equals("FAN_OFF"))
-                    {
-                        setFanSpeed(0);
-                        safePrintln("Fan turned OFF");
-                    }
-                    else if (command.startsWith("FAN_SPEED_"))
-                    {
-                        int speed = command.substring(10).toInt(); // Remove "FAN_SPEED_"
-                        if (speed >= 0 && speed <= 100)
-                        {
-                            setFanSpeed(speed);
-                            safePrintln("Fan speed set to " + String(speed) + "%");
-                        }
-                        else
-                        {
-                            safePrintln("Invalid fan speed (0-100): " + String(speed));
-                        }
-                    }
-                    else if (command.equals("GLINE_ON"))
-                    {
-                        setGLine(true);
-                        safePrintln("GLine router ENABLED");
-                    }
-                    else if (command.equals("GLINE_OFF"))
-                    {
-                        setGLine(false);
-                        safePrintln("GLine router DISABLED");
-                    }
-                    else if (command.startsWith("SLEEP_"))
-                    {
-                        // Sleep mode commands
-                        if (command.equals("SLEEP_STOP") || command.equals("SLEEP_WAKE"))
-                        {
-                            stopSleepMode();
-                            safePrintln("Sleep mode stopped");
-                        }
-                        else if (command.startsWith("SLEEP_"))
-                        {
-                            // Format: SLEEP_[delay]_[duration] (e.g., SLEEP_60_300 for 60s delay, 300s duration)
-                            String params = command.substring(6); // Remove "SLEEP_"
-                            int separatorIndex = params.indexOf('_');
-                            if (separatorIndex > 0)
-                            {
-                                unsigned long delaySec = params.substring(0, separatorIndex).toInt();
-                                unsigned long durationSec = params.substring(separatorIndex + 1).toInt();
-                                if (delaySec > 0 && durationSec > 0)
-                                {
-                                    startSleepMode(delaySec, durationSec);
-                                    safePrintln("Sleep mode scheduled: " + String(delaySec) + "s delay, " + String(durationSec) + "s duration");
-                                }
-                                else
-                                {
-                                    safePrintln("Invalid sleep parameters: delay=" + String(delaySec) + ", duration=" + String(durationSec));
-                                }
-                            }
-                            else
-                            {
-                                safePrintln("Invalid sleep format. Use: SLEEP_[delay]_[duration] (e.g., SLEEP_60_300)");
-                            }
-                        }
-                    }
-                    else if (command.equals("FAN_STATUS"))
-                    {
-                        FanStatus status = getFanStatus();
-                        safePrintln("=== Fan Status ===");
-                        safePrintln("Enabled: " + String(status.enabled ? "YES" : "NO"));
-                        safePrintln("Duty Cycle: " + String(status.dutyCycle) + "%");
-                        safePrintln("RPM: " + String(status.rpm));
-                        safePrintln("GLine: " + String(status.glineEnabled ? "ON" : "OFF"));
-                        safePrintln("Sleep Mode: " + String(status.sleepMode ? "ACTIVE" : "INACTIVE"));
-                        if (status.sleepMode)
-                        {
-                            safePrintln("- Sleep Start: " + String(status.sleepStartTime));
-                            safePrintln("- Sleep Duration: " + String(status.sleepDuration) + "ms");
-                            safePrintln("- Sleep End: " + String(status.sleepEndTime));
-                        }
-                    }
-                }
-            }
+            safePrintln("Pushbullet Token: " + String(strlen(config.pushbulletToken) > 0 ? "SET" : "NOT SET"));
         }
-        else if (command.equals("DATATYPE_CURRENT"))
+        if (config.enableModbus)
         {
-            if (config.enableModbus)
+            safePrint("Modbus Activity: ");
+            if (hasHadModbusActivity)
             {
-                setCurrentDataType(DATA_CURRENT);
-                safePrintln("Switched to current data mode");
+                safePrintln("Last " + String((millis() - lastModbusActivity) / 1000) + " seconds ago");
             }
             else
             {
-                safePrintln("Modbus not enabled");
+                safePrintln("Never detected");
             }
         }
-        else if (command.equals("DATATYPE_FAST"))
+        safePrintln("Free Heap: " + String(ESP.getFreeHeap()));
+        safePrintln("PSRAM Size: " + String(ESP.getPsramSize() / 1024) + " KB");
+        safePrintln("Free PSRAM: " + String(ESP.getFreePsram() / 1024) + " KB");
+        safePrintln("Uptime: " + String(millis() / 1000) + " seconds");
+
+        // Battery status
+        if (batteryData.valid)
         {
-            if (config.enableModbus)
-            {
-                setCurrentDataType(DATA_FAST_AVG);
-                safePrintln("Switched to fast average mode (10s)");
-            }
-            else
-            {
-                safePrintln("Modbus not enabled");
-            }
+            safePrintln("=== Battery Status ===");
+            safePrintln("Voltage: " + String(batteryData.voltage, 3) + "V");
+            safePrintln("Current: " + String(batteryData.current, 2) + "mA");
+            safePrintln("Power: " + String(batteryData.power, 1) + "mW");
+            safePrintln("Charge: " + String(batteryData.chargePercent) + "%");
+            safePrintln("Source: " + String(batteryData.isBatteryPowered ? "External" : "Battery"));
+            safePrintln("Low Battery: " + String(batteryData.lowBattery ? "YES" : "NO"));
+            safePrintln("Critical: " + String(batteryData.criticalBattery ? "YES" : "NO"));
         }
-        else if (command.equals("DATATYPE_SLOW"))
+        else
         {
-            if (config.enableModbus)
-            {
-                setCurrentDataType(DATA_SLOW_AVG);
-                safePrintln("Switched to slow average mode (5min)");
-            }
-            else
-            {
-                safePrintln("Modbus not enabled");
-            }
+            safePrintln("Battery Status: No valid data");
         }
-        else if (command.equals("DATATYPE_CYCLE"))
+
+        // Time info from ESP32 built-in time functions
+
+        if (isTimeSet())
         {
-            if (config.enableModbus)
-            {
-                cycleDataType();
-                safePrint("Current data type: ");
-                safePrintln(getCurrentDataTypeName());
-            }
-            else
+            safePrintln("Time: " + getFormattedTime());
+            safePrintln("Date: " + getFormattedDate());
+            safePrintln("Epoch: " + String(getEpochTime()));
+
+            struct tm timeinfo;
+            if (getLocalTime(&timeinfo))
             {
-                safePrintln("Modbus not enabled");
+                safePrintln("Day of Week: " + String(timeinfo.tm_wday));
+                safePrintln("Timezone: Poland (UTC+1/UTC+2 with DST)");
             }
         }
-        else if (command.equals("DATATYPE_STATUS"))
+        else
         {
-            if (config.enableModbus)
-            {
-                safePrint("Current data type: ");
-                safePrintln(getCurrentDataTypeName());
-            }
-            else
-            {
-                safePrintln("Modbus not enabled");
-            }
+            safePrintln("Time: Not synchronized");
         }
-        else if (command.equals("MODBUS_STATUS"))
+
+        // Calibration status
+        // safePrintln("Calibration: " + String(calibConfig.enableCalibration ? "ENABLED" : "DISABLED"));
+        // if (calibConfig.enableCalibration) {
+        //     safePrintln("Calibration Valid: " + String(calibratedData.valid ? "YES" : "NO"));
+        //     safePrintln("Last Calibration: " + String((millis() - calibratedData.lastUpdate) / 1000) + " seconds ago");
+        // }
+
+        // safePrintln("=== Moving Averages Status ===");
+        // printMovingAverageStatus();
+
+        safePrintln("=== Fan Control Commands ===");
+        safePrintln("FAN_ON - Turn fan ON at 50% speed");
+        safePrintln("FAN_OFF - Turn fan OFF");
+        safePrintln("FAN_SPEED_[0-100] - Set fan speed (e.g., FAN_SPEED_75)");
+        safePrintln("GLINE_ON - Enable GLine router");
+        safePrintln("GLINE_OFF - Disable GLine router");
+        safePrintln("SLEEP_[delay]_[duration] - Schedule sleep mode (e.g., SLEEP_60_300)");
+        safePrintln("SLEEP_STOP - Stop sleep mode immediately");
+        safePrintln("FAN_STATUS - Show detailed fan status");
+        
+        safePrintln("=== MCP3424 Mapping Commands ===");
+        safePrintln("MCP3424_MAPPING - Show detailed device mapping info");
+        safePrintln("MCP3424_SCAN - Rescan I2C bus and update device detection");
+        safePrintln("MCP3424_RESET - Reset mapping to defaults and rescan");
+        safePrintln("MCP3424_GET_[GAS] - Get device info for gas type (e.g., MCP3424_GET_SO2)");
+        safePrintln("MCP3424_ADDR_[HEX] - Get device info for I2C address (e.g., MCP3424_ADDR_6A)");
+        safePrintln("MCP3424_STATUS - Conversion engine: channel resolution, cycle time, RDY polls");
+        safePrintln("MCP3424_RES_[DEV]_[CH]_[BITS] - Channel resolution 12/14/16/18 (e.g., MCP3424_RES_0_1_12)");
+        safePrintln("Available gas types: NO, O3, NO2, CO, SO2, TGS1, TGS2, TGS3");
+        
+        safePrintln("=== Memory Management Commands ===");
+        safePrintln("MEMORY_EMERGENCY - Full aggressive memory cleanup & analysis");
+        safePrintln("MEMORY_FORCE_GC - Force defragmentation garbage collection");
+        safePrintln("MEMORY_SMART - Intelligent adaptive memory cleanup");
+        safePrintln("Current memory status:");
+        safePrintln("- Free heap: " + String(ESP.getFreeHeap()) + " bytes");
+        safePrintln("- Min free ever: " + String(ESP.getMinFreeHeap()) + " bytes");
+        safePrintln("- Largest block: " + String(heap_caps_get_largest_free_block(MALLOC_CAP_8BIT)) + " bytes");
+
+        extern int wsClientCount;
+        extern AsyncWebSocket ws;
+        safePrintln("WebSocket status: " + String(wsClientCount) + " tracked, " + String(ws.count()) + " active");
+        if (wsClientCount != ws.count())
         {
-            if (isSerialAvailable())
-            {
-                safePrintln("=== Modbus Status ===");
-                safePrintln("Enabled: " + String(config.enableModbus ? "YES" : "NO"));
-                safePrintln("Had Activity: " + String(hasHadModbusActivity ? "YES" : "NO"));
-                safePrintln("Last Activity: " + String((millis() - lastModbusActivity) / 1000) + " seconds ago");
-                safePrintln("Timeout: " + String(MODBUS_TIMEOUT / 1000) + " seconds");
-                safePrintln("System Uptime: " + String(millis() / 1000) + " seconds");
-            }
+            safePrintln("WARNING: WebSocket client count mismatch - possible memory leak!");
         }
-        else if (command.equals("CALIB_DATA"))
-        {
-            if (isSerialAvailable())
-            {
-                extern CalibratedSensorData calibratedData;
-                extern CalibrationConfig calibConfig;
+    }
+}
 
-                safePrintln("=== Calibration Data ===");
-                safePrintln("Enabled: " + String(calibConfig.enableCalibration ? "YES" : "NO"));
-                safePrintln("Valid: " + String(calibratedData.valid ? "YES" : "NO"));
+static void serialCmdAvgStatus(CommandContext&)
+{
+    if (isSerialAvailable())
+    {
+        safePrintln("=== Moving Averages Buffer Status ===");
+        printMovingAverageStatus();
+    }
+}
 
-                if (calibConfig.enableCalibration && calibratedData.valid)
-                {
-                    safePrintln("--- Temperatures ---");
-                    safePrintln("K1: " + String(calibratedData.K1_temp, 1) + "°C");
-                    safePrintln("K2: " + String(calibratedData.K2_temp, 1) + "°C");
-                    safePrintln("K3: " + String(calibratedData.K3_temp, 1) + "°C");
-                    safePrintln("K4: " + String(calibratedData.K4_temp, 1) + "°C");
-                    safePrintln("K5: " + String(calibratedData.K5_temp, 1) + "°C");
-
-                    safePrintln("--- Gases (ppb) ---");
-                    safePrintln("CO: " + String(calibratedData.CO_ppb, 1) + " ppb");
-                    safePrintln("NO: " + String(calibratedData.NO_ppb, 1) + " ppb");
-                    safePrintln("NO2: " + String(calibratedData.NO2_ppb, 1) + " ppb");
-                    safePrintln("O3: " + String(calibratedData.O3_ppb, 1) + " ppb");
-                    safePrintln("SO2: " + String(calibratedData.SO2_ppb, 1) + " ppb");
-                    safePrintln("H2S: " + String(calibratedData.H2S_ppb, 1) + " ppb");
-                    safePrintln("NH3: " + String(calibratedData.NH3_ppb, 1) + " ppb");
-
-                    safePrintln("--- TGS Sensors ---");
-                    safePrintln("TGS02: " + String(calibratedData.TGS02, 3) + " ppm");
-                    safePrintln("TGS03: " + String(calibratedData.TGS03, 3) + " ppm");
-                    safePrintln("TGS12: " + String(calibratedData.TGS12, 3) + " ppm");
-
-                    safePrintln("--- Special Sensors ---");
-                    safePrintln("HCHO: " + String(calibratedData.HCHO, 1) + " ppb");
-                    safePrintln("PID: " + String(calibratedData.PID, 3) + " ppm");
-                }
-                else
-                {
-                    safePrintln("No valid calibration data available");
-                }
-            }
+static void serialCmdDataTypeCurrent(CommandContext&)
+{
+    if (config.enableModbus)
+    {
+        setCurrentDataType(DATA_CURRENT);
+        safePrintln("Switched to current data mode");
+    }
+    else
+    {
+        safePrintln("Modbus not enabled");
+    }
+}
+
+static void serialCmdDataTypeFast(CommandContext&)
+{
+    if (config.enableModbus)
+    {
+        setCurrentDataType(DATA_FAST_AVG);
+        safePrintln("Switched to fast average mode (10s)");
+    }
+    else
+    {
+        safePrintln("Modbus not enabled");
+    }
+}
+
+static void serialCmdDataTypeSlow(CommandContext&)
+{
+    if (config.enableModbus)
+    {
+        setCurrentDataType(DATA_SLOW_AVG);
+        safePrintln("Switched to slow average mode (5min)");
+    }
+    else
+    {
+        safePrintln("Modbus not enabled");
+    }
+}
+
+static void serialCmdDataTypeCycle(CommandContext&)
+{
+    if (config.enableModbus)
+    {
+        cycleDataType();
+        safePrint("Current data type: ");
+        safePrintln(getCurrentDataTypeName());
+    }
+    else
+    {
+        safePrintln("Modbus not enabled");
+    }
+}
+
+static void serialCmdDataTypeStatus(CommandContext&)
+{
+    if (config.enableModbus)
+    {
+        safePrint("Current data type: ");
+        safePrintln(getCurrentDataTypeName());
+    }
+    else
+    {
+        safePrintln("Modbus not enabled");
+    }
+}
+
+static void serialCmdModbusStatus(CommandContext&)
+{
+    if (isSerialAvailable())
+    {
+        safePrintln("=== Modbus Status ===");
+        safePrintln("Enabled: " + String(config.enableModbus ? "YES" : "NO"));
+        safePrintln("Had Activity: " + String(hasHadModbusActivity ? "YES" : "NO"));
+        safePrintln("Last Activity: " + String((millis() - lastModbusActivity) / 1000) + " seconds ago");
+        safePrintln("Timeout: " + String(MODBUS_TIMEOUT / 1000) + " seconds");
+        safePrintln("System Uptime: " + String(millis() / 1000) + " seconds");
+    }
+}
+
+static void serialCmdCalibData(CommandContext&)
+{
+    if (isSerialAvailable())
+    {
+        extern CalibratedSensorData calibratedData;
+        extern CalibrationConfig calibConfig;
+
+        safePrintln("=== Calibration Data ===");
+        safePrintln("Enabled: " + String(calibConfig.enableCalibration ? "YES" : "NO"));
+        safePrintln("Valid: " + String(calibratedData.valid ? "YES" : "NO"));
+
+        if (calibConfig.enableCalibration && calibratedData.valid)
+        {
+            safePrintln("--- Temperatures ---");
+            safePrintln("K1: " + String(calibratedData.K1_temp, 1) + "°C");
+            safePrintln("K2: " + String(calibratedData.K2_temp, 1) + "°C");
+            safePrintln("K3: " + String(calibratedData.K3_temp, 1) + "°C");
+            safePrintln("K4: " + String(calibratedData.K4_temp, 1) + "°C");
+            safePrintln("K5: " + String(calibratedData.K5_temp, 1) + "°C");
+
+            safePrintln("--- Gases (ppb) ---");
+            safePrintln("CO: " + String(calibratedData.CO_ppb, 1) + " ppb");
+            safePrintln("NO: " + String(calibratedData.NO_ppb, 1) + " ppb");
+            safePrintln("NO2: " + String(calibratedData.NO2_ppb, 1) + " ppb");
+            safePrintln("O3: " + String(calibratedData.O3_ppb, 1) + " ppb");
+            safePrintln("SO2: " + String(calibratedData.SO2_ppb, 1) + " ppb");
+            safePrintln("H2S: " + String(calibratedData.H2S_ppb, 1) + " ppb");
+            safePrintln("NH3: " + String(calibratedData.NH3_ppb, 1) + " ppb");
+
+            safePrintln("--- TGS Sensors ---");
+            safePrintln("TGS02: " + String(calibratedData.TGS02, 3) + " ppm");
+            safePrintln("TGS03: " + String(calibratedData.TGS03, 3) + " ppm");
+            safePrintln("TGS12: " + String(calibratedData.TGS12, 3) + " ppm");
+
+            safePrintln("--- Special Sensors ---");
+            safePrintln("HCHO: " + String(calibratedData.HCHO, 1) + " ppb");
+            safePrintln("PID: " + String(calibratedData.PID, 3) + " ppm");
         }
-        else if (command.equals("TIME_INFO"))
+        else
         {
-            if (isSerialAvailable())
-            {
-                safePrintln("=== Time Information ===");
-                safePrintln("Time Synchronized: " + String(isTimeSet() ? "YES" : "NO"));
-                if (isTimeSet())
-                {
-                    safePrintln("Current Time: " + getFormattedTime());
-                    safePrintln("Current Date: " + getFormattedDate());
-                    safePrintln("Epoch Time: " + String(getEpochTime()));
-
-                    struct tm timeinfo;
-                    if (getLocalTime(&timeinfo))
-                    {
-                        safePrintln("Day of Week: " + String(timeinfo.tm_wday) + " (0=Sunday)");
-                        safePrintln("Hours: " + String(timeinfo.tm_hour));
-                        safePrintln("Minutes: " + String(timeinfo.tm_min));
-                        safePrintln("Seconds: " + String(timeinfo.tm_sec));
-                        safePrintln("Day: " + String(timeinfo.tm_mday));
-                        safePrintln("Month: " + String(timeinfo.tm_mon + 1));
-                        safePrintln("Year: " + String(timeinfo.tm_year + 1900));
-                        safePrintln("Timezone: Poland (UTC+1/UTC+2 with automatic DST)");
-                    }
-                }
-                else
-                {
-                    safePrintln("Time not synchronized - check WiFi connection");
-                }
-                safePrintln("System Uptime: " + String(millis() / 1000) + " seconds");
-            }
+            safePrintln("No valid calibration data available");
         }
-        else if (command.equals("HISTORY"))
+    }
+}
+
+static void serialCmdTimeInfo(CommandContext&)
+{
+    if (isSerialAvailable())
+    {
+        safePrintln("=== Time Information ===");
+        safePrintln("Time Synchronized: " + String(isTimeSet() ? "YES" : "NO"));
+        if (isTimeSet())
         {
-            if (isSerialAvailable())
-            {
-                safePrintln("=== Sensor History Status ===");
-                printHistoryMemoryUsage();
-                printHistoryStatus();
+            safePrintln("Current Time: " + getFormattedTime());
+            safePrintln("Current Date: " + getFormattedDate());
+            safePrintln("Epoch Time: " + String(getEpochTime()));
+
+            struct tm timeinfo;
+            if (getLocalTime(&timeinfo))
+            {
+                safePrintln("Day of Week: " + String(timeinfo.tm_wday) + " (0=Sunday)");
+                safePrintln("Hours: " + String(timeinfo.tm_hour));
+                safePrintln("Minutes: " + String(timeinfo.tm_min));
+                safePrintln("Seconds: " + String(timeinfo.tm_sec));
+                safePrintln("Day: " + String(timeinfo.tm_mday));
+                safePrintln("Month: " + String(timeinfo.tm_mon + 1));
+                safePrintln("Year: " + String(timeinfo.tm_year + 1900));
+                safePrintln("Timezone: Poland (UTC+1/UTC+2 with automatic DST)");
             }
         }
-        else if (command.equals("BATTERY"))
+        else
         {
-            if (isSerialAvailable())
-            {
-                safePrintln("=== Battery Status ===");
-                if (batteryData.valid)
-                {
-                    safePrintln("Voltage: " + String(batteryData.voltage, 3) + "V");
-                    safePrintln("Current: " + String(batteryData.current, 2) + "mA");
-                    safePrintln("Power: " + String(batteryData.power, 1) + "mW");
-                    safePrintln("Charge: " + String(batteryData.chargePercent) + "%");
-                    safePrintln("Source: " + String(batteryData.isBatteryPowered ? "External" : "Battery"));
-                    safePrintln("Low Battery: " + String(batteryData.lowBattery ? "YES" : "NO"));
-                    safePrintln("Critical: " + String(batteryData.criticalBattery ? "YES" : "NO"));
-                    safePrintln("OFF Pin: " + String(digitalRead(OFF_PIN) ? "HIGH" : "LOW"));
-                }
-                else
-                {
-                    safePrintln("No valid battery data available");
-                }
-            }
+            safePrintln("Time not synchronized - check WiFi connection");
         }
-        else if (command.equals("RESTART"))
+        safePrintln("System Uptime: " + String(millis() / 1000) + " seconds");
+    }
+}
+
+static void serialCmdHistory(CommandContext&)
+{
+    if (isSerialAvailable())
+    {
+        safePrintln("=== Sensor History Status ===");
+        printHistoryMemoryUsage();
+        printHistoryStatus();
+    }
+}
+
+static void serialCmdBattery(CommandContext&)
+{
+    if (isSerialAvailable())
+    {
+        safePrintln("=== Battery Status ===");
+        if (batteryData.valid)
         {
-            safePrintln("Restarting system...");
-            delay(1000);
-            ESP.restart();
+            safePrintln("Voltage: " + String(batteryData.voltage, 3) + "V");
+            safePrintln("Current: " + String(batteryData.current, 2) + "mA");
+            safePrintln("Power: " + String(batteryData.power, 1) + "mW");
+            safePrintln("Charge: " + String(batteryData.chargePercent) + "%");
+            safePrintln("Source: " + String(batteryData.isBatteryPowered ? "External" : "Battery"));
+            safePrintln("Low Battery: " + String(batteryData.lowBattery ? "YES" : "NO"));
+            safePrintln("Critical: " + String(batteryData.criticalBattery ? "YES" : "NO"));
+            safePrintln("OFF Pin: " + String(digitalRead(OFF_PIN) ? "HIGH" : "LOW"));
         }
-        else if (command.equals("MEMORY_EMERGENCY"))
+        else
         {
-            forceWebSocketReset("Emergency reset from Serial command");
+            safePrintln("No valid battery data available");
         }
-        else if (command.equals("MEMORY_SMART"))
-        {
-            // Użyj nowego systemu resetowania WebSocket
-        forceWebSocketReset("Manual reset from Serial command");
+    }
+}
+
+static void serialCmdRestart(CommandContext&)
+{
+    safePrintln("Restarting system...");
+    delay(1000);
+    ESP.restart();
+}
+
+static void serialCmdMemoryEmergency(CommandContext&)
+{
+    forceWebSocketReset("Emergency reset from Serial command");
+}
+
+static void serialCmdMemorySmart(CommandContext&)
+{
+    // Użyj nowego systemu resetowania WebSocket
+    forceWebSocketReset("Manual reset from Serial command");
+}
+
+static void serialCmdMCP3424Mapping(CommandContext&)
+{
+    if (isSerialAvailable())
+    {
+        displayMCP3424MappingInfo();
+    }
+}
+
+static void serialCmdMCP3424Scan(CommandContext&)
+{
+    if (isSerialAvailable())
+    {
+        safePrintln("=== Rescanning MCP3424 devices ===");
+        scanAndMapMCP3424Devices();
+    }
+}
+
+static void serialCmdMCP3424Reset(CommandContext&)
+{
+    if (isSerialAvailable())
+    {
+        safePrintln("=== Resetting MCP3424 mapping to defaults ===");
+        initializeDefaultMCP3424Mapping();
+        scanAndMapMCP3424Devices();
+        saveMCP3424Config(mcp3424Config);
+        safePrintln("MCP3424 mapping reset and saved");
+    }
+}
+
+static void serialCmdMCP3424Get(CommandContext &ctx)
+{
+    if (isSerialAvailable())
+    {
+        String gasType = commandArgString(ctx, "gas");
+        int8_t deviceIndex = getMCP3424DeviceByGasType(gasType.c_str());
+        
+        if (deviceIndex >= 0) {
+            uint8_t i2cAddr = getMCP3424I2CAddressByDeviceIndex(deviceIndex);
+            safePrint("Gas type '");
+            safePrint(gasType);
+            safePrint("' -> Device ");
+            safePrint(String(deviceIndex));
+            safePrint(" at I2C address 0x");
+            safePrintln(String(i2cAddr, HEX));
+            
+            // Show channel values
+            safePrintln("Channel values:");
+            for (uint8_t ch = 0; ch < 4; ch++) {
+                float value = getMCP3424Value(deviceIndex, ch);
+                safePrint("  CH");
+                safePrint(String(ch));
+                safePrint(": ");
+                safePrint(String(value, 6));
+                safePrintln("V");
+            }
+        } else {
+            safePrint("Gas type '");
+            safePrint(gasType);
+            safePrintln("' not found, not enabled, or not detected");
         }
-        else if (command.equals("MCP3424_MAPPING"))
-        {
-            if (isSerialAvailable())
-            {
-                displayMCP3424MappingInfo();
-            }
+    }
+}
+
+static void serialCmdMCP3424Addr(CommandContext &ctx)
+{
+    if (isSerialAvailable())
+    {
+        uint8_t addr = commandArgInt(ctx, "addr"); // Parse hex (schemat ARG_HEX)
+        
+        int8_t deviceIndex = getMCP3424DeviceByI2CAddress(addr);
+        String gasType = getMCP3424GasTypeByI2CAddress(addr);
+        
+        if (deviceIndex >= 0) {
+            safePrint("I2C address 0x");
+            safePrint(String(addr, HEX));
+            safePrint(" -> Device ");
+            safePrint(String(deviceIndex));
+            safePrint(" (");
+            safePrint(gasType);
+            safePrintln(")");
+        } else {
+            safePrint("I2C address 0x");
+            safePrint(String(addr, HEX));
+            safePrintln(" not found, not enabled, or not detected");
         }
-        else if (command.equals("MCP3424_SCAN"))
+    }
+}
+
+static void serialCmdMCP3424Status(CommandContext&)
+{
+    if (isSerialAvailable())
+    {
+        safePrintln("=== MCP3424 ===");
+        safePrint(getMCP3424Status());
+    }
+}
+
+static void serialCmdMCP3424Resolution(CommandContext &ctx)
+{
+    // MCP3424_RES_DEV_CH_BITS (e.g., MCP3424_RES_0_1_12) - urządzenie z mapowania, kanał 1-4
+    uint8_t device = commandArgInt(ctx, "device");
+    uint8_t channel = commandArgInt(ctx, "channel");
+    int bits = commandArgInt(ctx, "bits");
+    if (validMCP3424Resolution(bits) != bits)
+    {
+        safePrintln("MCP3424 resolution must be 12, 14, 16 or 18 bit");
+        return;
+    }
+
+    mcp3424Config.devices[device].resolution[channel - 1] = bits;
+    saveMCP3424Config(mcp3424Config);
+    applyMCP3424Resolution();
+    safePrintln("MCP3424 device " + String(device) + " (0x" + String(mcp3424Config.devices[device].i2cAddress, HEX) +
+                ") channel " + String(channel) + ": " + String(bits) + "-bit");
+}
+
+// Przelaczniki konfiguracji: CONFIG_<NAZWA>_ON / CONFIG_<NAZWA>_OFF
+struct SerialConfigFlag
+{
+    const char *name;  // bez prefiksu CONFIG_ i sufiksu _ON/_OFF
+    bool *flag;
+    const char *onMessage;
+    const char *offMessage;
+};
+
+static SerialConfigFlag serialConfigFlags[] = {
+    {"SOLAR", &config.enableSolarSensor, "Solar sensor enabled", "Solar sensor disabled"},
+    {"OPCN3", &config.enableOPCN3Sensor, "OPCN3 sensor enabled", "OPCN3 sensor disabled"},
+    {"AUTO_RESET", &config.autoReset, "Auto reset enabled", "Auto reset disabled"},
+    {"LOW_POWER", &config.lowPowerMode, "Low power mode enabled - LED disabled", "Low power mode disabled - LED enabled"},
+    {"CALIB", &calibConfig.enableCalibration, "Calibration enabled", "Calibration disabled"},
+    {"TGS", &calibConfig.enableTGSSensors, "TGS sensors enabled", "TGS sensors disabled"},
+    {"GASES", &calibConfig.enableGasSensors, "Gas sensors enabled", "Gas sensors disabled"},
+};
+
+// Czujniki I2C: CONFIG_<CZUJNIK>_ON / CONFIG_<CZUJNIK>_OFF
+struct SerialI2CSensor
+{
+    const char *name;
+    I2CSensorType type;
+};
+
+static const SerialI2CSensor serialI2CSensors[] = {
+    {"SHT30", SENSOR_SHT30},
+    {"BME280", SENSOR_BME280},
+    {"SCD41", SENSOR_SCD41},
+    {"SHT40", SENSOR_SHT40},
+    {"MCP3424", SENSOR_MCP3424},
+    {"ADS1110", SENSOR_ADS1110},
+    {"INA219", SENSOR_INA219},
+    {"SPS30", SENSOR_SPS30},
+    {"IPS", SENSOR_IPS},
+};
+
+// Wyciaga <NAZWA> i stan z CONFIG_<NAZWA>_ON/_OFF
+static bool parseConfigToggle(const char *command, String &name, bool &enable)
+{
+    String cmd(command);
+    if (cmd.endsWith("_ON"))
+    {
+        enable = true;
+        name = cmd.substring(7, cmd.length() - 3);
+        return true;
+    }
+    if (cmd.endsWith("_OFF"))
+    {
+        enable = false;
+        name = cmd.substring(7, cmd.length() - 4);
+        return true;
+    }
+    return false;
+}
+
+static void serialCmdConfigFlag(CommandContext &ctx)
+{
+    String name;
+    bool enable;
+    if (!parseConfigToggle(ctx.name, name, enable))
+        return;
+
+    for (SerialConfigFlag &f : serialConfigFlags)
+    {
+        if (name.equals(f.name))
         {
-            if (isSerialAvailable())
-            {
-                safePrintln("=== Rescanning MCP3424 devices ===");
-                scanAndMapMCP3424Devices();
-            }
+            *f.flag = enable;
+            safePrintln(enable ? f.onMessage : f.offMessage);
+            return;
         }
-        else if (command.equals("MCP3424_RESET"))
+    }
+}
+
+static void serialCmdConfigI2CSensor(CommandContext &ctx)
+{
+    String name;
+    bool enable;
+    if (!parseConfigToggle(ctx.name, name, enable))
+        return;
+
+    for (const SerialI2CSensor &sensor : serialI2CSensors)
+    {
+        if (name.equals(sensor.name))
         {
-            if (isSerialAvailable())
-            {
-                safePrintln("=== Resetting MCP3424 mapping to defaults ===");
-                initializeDefaultMCP3424Mapping();
-                scanAndMapMCP3424Devices();
-                saveMCP3424Config(mcp3424Config);
-                safePrintln("MCP3424 mapping reset and saved");
-            }
+            if (enable)
+                enableI2CSensor(sensor.type);
+            else
+                disableI2CSensor(sensor.type);
+            return;
         }
-        else if (command.startsWith("MCP3424_GET_"))
+    }
+}
+
+static void serialCmdConfigI2C(CommandContext &ctx)
+{
+    config.enableI2CSensors = strcmp(ctx.name, "CONFIG_I2C_ON") == 0;
+    if (config.enableI2CSensors)
+    {
+        initializeI2C();
+    }
+    safePrintln(String("I2C sensors ") + (config.enableI2CSensors ? "enabled" : "disabled"));
+}
+
+static void serialCmdConfigModbus(CommandContext &ctx)
+{
+    config.enableModbus = strcmp(ctx.name, "CONFIG_MODBUS_ON") == 0;
+    if (config.enableModbus)
+    {
+        initializeModbus();
+    }
+    safePrintln(String("Modbus ") + (config.enableModbus ? "enabled" : "disabled"));
+}
+
+static void serialCmdResetSCD41(CommandContext&)
+{
+    resetSCD41();
+}
+
+static void serialCmdConfigADS1110(CommandContext &ctx)
+{
+    // CONFIG_ADS1110_RATE_GAIN (e.g., CONFIG_ADS1110_60_4)
+    configureADS1110(commandArgInt(ctx, "rate"), commandArgInt(ctx, "gain"));
+}
+
+static void serialCmdPushbulletTest(CommandContext&)
+{
+    if (config.enablePushbullet && strlen(config.pushbulletToken) > 0)
+    {
+        sendPushbulletNotification("🧪 Test Notification", "This is a test notification from ESP32 Sensor Cube\nTime: " + getFormattedTime() + "\nUptime: " + getUptimeString());
+        safePrintln("Test notification sent");
+    }
+    else
+    {
+        safePrintln("Pushbullet not configured - enable and set token first");
+    }
+}
+
+static void serialCmdPushbulletBatteryTest(CommandContext&)
+{
+    if (config.enablePushbullet && strlen(config.pushbulletToken) > 0)
+    {
+        sendBatteryCriticalNotification();
+        safePrintln("Battery critical test notification sent");
+    }
+    else
+    {
+        safePrintln("Pushbullet not configured - enable and set token first");
+    }
+}
+
+// Fan control commands
+static bool checkFanEnabled()
+{
+    if (!config.enableFan)
+    {
+        safePrintln("Fan control is DISABLED in configuration");
+        return false;
+    }
+    return true;
+}
+
+static void serialCmdFanOn(CommandContext&)
+{
+    if (!checkFanEnabled())
+        return;
+    setFanSpeed(50); // Default 50% speed
+    safePrintln("Fan turned ON at 50% speed");
+}
+
+static void serialCmdFanOff(CommandContext&)
+{
+    if (!checkFanEnabled())
+        return;
+    setFanSpeed(0);
+    safePrintln("Fan turned OFF");
+}
+
+static void serialCmdFanSpeed(CommandContext &ctx)
+{
+    if (!checkFanEnabled())
+        return;
+    int speed = commandArgInt(ctx, "speed"); // zakres 0-100 sprawdzony przez schemat
+    setFanSpeed(speed);
+    safePrintln("Fan speed set to " + String(speed) + "%");
+}
+
+static void serialCmdGLine(CommandContext &ctx)
+{
+    if (!checkFanEnabled())
+        return;
+    bool enable = strcmp(ctx.name, "GLINE_ON") == 0;
+    setGLine(enable);
+    safePrintln(String("GLine router ") + (enable ? "ENABLED" : "DISABLED"));
+}
+
+static void serialCmdSleepStop(CommandContext&)
+{
+    if (!checkFanEnabled())
+        return;
+    stopSleepMode();
+    safePrintln("Sleep mode stopped");
+}
+
+static void serialCmdSleep(CommandContext &ctx)
+{
+    // Format: SLEEP_[delay]_[duration] (e.g., SLEEP_60_300 for 60s delay, 300s duration)
+    if (!checkFanEnabled())
+        return;
+    unsigned long delaySec = commandArgInt(ctx, "delay");
+    unsigned long durationSec = commandArgInt(ctx, "duration");
+    startSleepMode(delaySec, durationSec);
+    safePrintln("Sleep mode scheduled: " + String(delaySec) + "s delay, " + String(durationSec) + "s duration");
+}
+
+static void serialCmdFanStatus(CommandContext&)
+{
+    if (!checkFanEnabled())
+        return;
+    FanStatus status = getFanStatus();
+    safePrintln("=== Fan Status ===");
+    safePrintln("Enabled: " + String(status.enabled ? "YES" : "NO"));
+    safePrintln("Duty Cycle: " + String(status.dutyCycle) + "%");
+    safePrintln("RPM: " + String(status.rpm));
+    safePrintln("GLine: " + String(status.glineEnabled ? "ON" : "OFF"));
+    safePrintln("Sleep Mode: " + String(status.sleepMode ? "ACTIVE" : "INACTIVE"));
+    if (status.sleepMode)
+    {
+        safePrintln("- Sleep Start: " + String(status.sleepStartTime));
+        safePrintln("- Sleep Duration: " + String(status.sleepDuration) + "ms");
+        safePrintln("- Sleep End: " + String(status.sleepEndTime));
+    }
+}
+
+static void serialCmdCommandStats(CommandContext&)
+{
+    if (isSerialAvailable())
+    {
+        printCommandStats();
+    }
+}
+
+static void serialCmdI2CBusStatus(CommandContext&)
+{
+    if (isSerialAvailable())
+    {
+        safePrintln("=== I2C Bus ===");
+        safePrint(getI2CBusStatus());
+    }
+}
+
+static void serialCmdSchedulerStatus(CommandContext&)
+{
+    if (isSerialAvailable())
+    {
+        safePrintln("=== Scheduler ===");
+        safePrint(getSchedulerStatus());
+    }
+}
+
+// Argumenty komend z parametrami w nazwie (FAN_SPEED_75, SLEEP_60_300, ...)
+static const CommandArg serialFanSpeedArgs[] = {
+    {"speed", ARG_INT, true, 0, 100},
+};
+
+static const CommandArg serialSleepArgs[] = {
+    {"delay", ARG_INT, true, 1, 2147483647L},
+    {"duration", ARG_INT, true, 1, 2147483647L},
+};
+
+static const CommandArg serialADS1110Args[] = {
+    {"rate", ARG_INT, true, 0, 255},
+    {"gain", ARG_INT, true, 0, 255},
+};
+
+static const CommandArg serialMCP3424GetArgs[] = {
+    {"gas", ARG_STRING, true, 0, 0},
+};
+
+static const CommandArg serialMCP3424AddrArgs[] = {
+    {"addr", ARG_HEX, true, 0, 0x7F},
+};
+
+static const CommandArg serialMCP3424ResolutionArgs[] = {
+    {"device", ARG_INT, true, 0, 7},
+    {"channel", ARG_INT, true, 1, 4},
+    {"bits", ARG_INT, true, 12, 18},
+};
+
+#define SERIAL_CMD(name, handler) {name, CMD_SRC_SERIAL, handler, COMMAND_NO_ARGS, false, 0}
+#define SERIAL_MODBUS_CMD(name, handler, code) {name, CMD_SRC_SERIAL | CMD_SRC_MODBUS, handler, COMMAND_NO_ARGS, false, code}
+#define SERIAL_PREFIX_CMD(name, handler, args) {name, CMD_SRC_SERIAL, handler, COMMAND_ARGS(args), true, 0}
+
+static const CommandDef serialCommands[] = {
+    SERIAL_CMD("SEND", serialCmdSend),
+    SERIAL_CMD("STATUS", serialCmdStatus),
+    SERIAL_MODBUS_CMD("AVGSTATUS", serialCmdAvgStatus, 10),
+    SERIAL_CMD("CMD_STATS", serialCmdCommandStats),
+    SERIAL_CMD("SCHEDULER", serialCmdSchedulerStatus),
+    SERIAL_CMD("I2C_BUS", serialCmdI2CBusStatus),
+
+    // Konfiguracja
+    SERIAL_CMD("CONFIG_SOLAR_ON", serialCmdConfigFlag),
+    SERIAL_CMD("CONFIG_SOLAR_OFF", serialCmdConfigFlag),
+    SERIAL_CMD("CONFIG_OPCN3_ON", serialCmdConfigFlag),
+    SERIAL_CMD("CONFIG_OPCN3_OFF", serialCmdConfigFlag),
+    SERIAL_CMD("CONFIG_AUTO_RESET_ON", serialCmdConfigFlag),
+    SERIAL_CMD("CONFIG_AUTO_RESET_OFF", serialCmdConfigFlag),
+    SERIAL_CMD("CONFIG_LOW_POWER_ON", serialCmdConfigFlag),
+    SERIAL_CMD("CONFIG_LOW_POWER_OFF", serialCmdConfigFlag),
+    SERIAL_CMD("CONFIG_CALIB_ON", serialCmdConfigFlag),
+    SERIAL_CMD("CONFIG_CALIB_OFF", serialCmdConfigFlag),
+    SERIAL_CMD("CONFIG_TGS_ON", serialCmdConfigFlag),
+    SERIAL_CMD("CONFIG_TGS_OFF", serialCmdConfigFlag),
+    SERIAL_CMD("CONFIG_GASES_ON", serialCmdConfigFlag),
+    SERIAL_CMD("CONFIG_GASES_OFF", serialCmdConfigFlag),
+    SERIAL_CMD("CONFIG_I2C_ON", serialCmdConfigI2C),
+    SERIAL_CMD("CONFIG_I2C_OFF", serialCmdConfigI2C),
+    SERIAL_CMD("CONFIG_MODBUS_ON", serialCmdConfigModbus),
+    SERIAL_CMD("CONFIG_MODBUS_OFF", serialCmdConfigModbus),
+    SERIAL_CMD("CONFIG_SHT30_ON", serialCmdConfigI2CSensor),
+    SERIAL_CMD("CONFIG_SHT30_OFF", serialCmdConfigI2CSensor),
+    SERIAL_CMD("CONFIG_BME280_ON", serialCmdConfigI2CSensor),
+    SERIAL_CMD("CONFIG_BME280_OFF", serialCmdConfigI2CSensor),
+    SERIAL_CMD("CONFIG_SCD41_ON", serialCmdConfigI2CSensor),
+    SERIAL_CMD("CONFIG_SCD41_OFF", serialCmdConfigI2CSensor),
+    SERIAL_CMD("CONFIG_SHT40_ON", serialCmdConfigI2CSensor),
+    SERIAL_CMD("CONFIG_SHT40_OFF", serialCmdConfigI2CSensor),
+    SERIAL_CMD("CONFIG_MCP3424_ON", serialCmdConfigI2CSensor),
+    SERIAL_CMD("CONFIG_MCP3424_OFF", serialCmdConfigI2CSensor),
+    SERIAL_CMD("CONFIG_ADS1110_ON", serialCmdConfigI2CSensor),
+    SERIAL_CMD("CONFIG_ADS1110_OFF", serialCmdConfigI2CSensor),
+    SERIAL_CMD("CONFIG_INA219_ON", serialCmdConfigI2CSensor),
+    SERIAL_CMD("CONFIG_INA219_OFF", serialCmdConfigI2CSensor),
+    SERIAL_CMD("CONFIG_SPS30_ON", serialCmdConfigI2CSensor),
+    SERIAL_CMD("CONFIG_SPS30_OFF", serialCmdConfigI2CSensor),
+    SERIAL_CMD("CONFIG_IPS_ON", serialCmdConfigI2CSensor),
+    SERIAL_CMD("CONFIG_IPS_OFF", serialCmdConfigI2CSensor),
+    SERIAL_PREFIX_CMD("CONFIG_ADS1110_", serialCmdConfigADS1110, serialADS1110Args),
+    SERIAL_CMD("RESET_SCD41", serialCmdResetSCD41),
+    SERIAL_CMD("PUSHBULLET_TEST", serialCmdPushbulletTest),
+    SERIAL_CMD("PUSHBULLET_BATTERY_TEST", serialCmdPushbulletBatteryTest),
+
+    // Wentylator
+    SERIAL_CMD("FAN_ON", serialCmdFanOn),
+    SERIAL_CMD("FAN_OFF", serialCmdFanOff),
+    SERIAL_PREFIX_CMD("FAN_SPEED_", serialCmdFanSpeed, serialFanSpeedArgs),
+    SERIAL_CMD("FAN_STATUS", serialCmdFanStatus),
+    SERIAL_CMD("GLINE_ON", serialCmdGLine),
+    SERIAL_CMD("GLINE_OFF", serialCmdGLine),
+    SERIAL_CMD("SLEEP_STOP", serialCmdSleepStop),
+    SERIAL_CMD("SLEEP_WAKE", serialCmdSleepStop),
+    SERIAL_PREFIX_CMD("SLEEP_", serialCmdSleep, serialSleepArgs),
+
+    // Typ danych Modbus - te same handlery dla kodow z rejestru komend
+    SERIAL_MODBUS_CMD("DATATYPE_CURRENT", serialCmdDataTypeCurrent, 7),
+    SERIAL_MODBUS_CMD("DATATYPE_FAST", serialCmdDataTypeFast, 8),
+    SERIAL_MODBUS_CMD("DATATYPE_SLOW", serialCmdDataTypeSlow, 9),
+    SERIAL_MODBUS_CMD("DATATYPE_CYCLE", serialCmdDataTypeCycle, 11),
+    SERIAL_CMD("DATATYPE_STATUS", serialCmdDataTypeStatus),
+    SERIAL_CMD("MODBUS_STATUS", serialCmdModbusStatus),
+
+    SERIAL_CMD("CALIB_DATA", serialCmdCalibData),
+    SERIAL_CMD("TIME_INFO", serialCmdTimeInfo),
+    SERIAL_CMD("HISTORY", serialCmdHistory),
+    SERIAL_CMD("BATTERY", serialCmdBattery),
+    SERIAL_MODBUS_CMD("RESTART", serialCmdRestart, 2),
+    SERIAL_CMD("MEMORY_EMERGENCY", serialCmdMemoryEmergency),
+    SERIAL_CMD("MEMORY_SMART", serialCmdMemorySmart),
+
+    // MCP3424
+    SERIAL_CMD("MCP3424_MAPPING", serialCmdMCP3424Mapping),
+    SERIAL_CMD("MCP3424_SCAN", serialCmdMCP3424Scan),
+    SERIAL_CMD("MCP3424_RESET", serialCmdMCP3424Reset),
+    SERIAL_PREFIX_CMD("MCP3424_GET_", serialCmdMCP3424Get, serialMCP3424GetArgs),
+    SERIAL_PREFIX_CMD("MCP3424_ADDR_", serialCmdMCP3424Addr, serialMCP3424AddrArgs),
+    SERIAL_CMD("MCP3424_STATUS", serialCmdMCP3424Status),
+    SERIAL_PREFIX_CMD("MCP3424_RES_", serialCmdMCP3424Resolution, serialMCP3424ResolutionArgs),
+};
+
+void registerSerialCommands()
+{
+    registerCommands(serialCommands, sizeof(serialCommands) / sizeof(serialCommands[0]));
+}
+
+void processSerialCommands()
+{
+    // Process commands from main serial - only if connected
+    if (Serial && Serial.available() > 0)
+    {
+        String command = Serial.readStringUntil('\n');
+        command.trim();
+
+        String error;
+        CommandResult result = dispatchSerialCommand(command, error);
+        if (result == CMD_BAD_ARGS)
         {
-            if (isSerialAvailable())
-            {
-                String gasType = command.substring(12); // Remove "MCP3424_GET_"
-                int8_t deviceIndex = getMCP3424DeviceByGasType(gasType.c_str());
-                
-                if (deviceIndex >= 0) {
-                    uint8_t i2cAddr = getMCP3424I2CAddressByDeviceIndex(deviceIndex);
-                    safePrint("Gas type '");
-                    safePrint(gasType);
-                    safePrint("' -> Device ");
-                    safePrint(String(deviceIndex));
-                    safePrint(" at I2C address 0x");
-                    safePrintln(String(i2cAddr, HEX));
-                    
-                    // Show channel values
-                    safePrintln("Channel values:");
-                    for (uint8_t ch = 0; ch < 4; ch++) {
-                        float value = getMCP3424Value(deviceIndex, ch);
-                        safePrint("  CH");
-                        safePrint(String(ch));
-                        safePrint(": ");
-                        safePrint(String(value, 6));
-                        safePrintln("V");
-                    }
-                } else {
-                    safePrint("Gas type '");
-                    safePrint(gasType);
-                    safePrintln("' not found, not enabled, or not detected");
-                }
-            }
+            safePrintln("Invalid command " + command + ": " + error);
         }
-        else if (command.startsWith("MCP3424_ADDR_"))
+        else if (result != CMD_OK && command.length() > 0)
         {
-            if (isSerialAvailable())
-            {
-                String addrStr = command.substring(13); // Remove "MCP3424_ADDR_"
-                uint8_t addr = strtol(addrStr.c_str(), NULL, 16); // Parse hex
-                
-                int8_t deviceIndex = getMCP3424DeviceByI2CAddress(addr);
-                String gasType = getMCP3424GasTypeByI2CAddress(addr);
-                
-                if (deviceIndex >= 0) {
-                    safePrint("I2C address 0x");
-                    safePrint(String(addr, HEX));
-                    safePrint(" -> Device ");
-                    safePrint(String(deviceIndex));
-                    safePrint(" (");
-                    safePrint(gasType);
-                    safePrintln(")");
-                } else {
-                    safePrint("I2C address 0x");
-                    safePrint(String(addr, HEX));
-                    safePrintln(" not found, not enabled, or not detected");
-                }
-            }
+            safePrintln("Unknown command: " + command);
         }
     }
 
@@ -1459,115 +1373,108 @@ void processSerialCommands()
     }
 }
 
+// Co 10 s - zadanie planisty loop()
 void updateSystemStatus()
 {
-    static unsigned long lastStatusUpdate = 0;
-    unsigned long currentTime = millis();
-
-    if (currentTime - lastStatusUpdate >= 10000)
-    { // Update every 5 seconds
-        lastStatusUpdate = currentTime;
-
-        // Count active sensors
-        //  int activeSensors = 0;
-        // Sprawdz status czujnikow tylko jesli sa wlaczone w konfiguracji
-        // if (config.enableSHT30 && sht30SensorStatus) activeSensors++;
-        // if (config.enableBME280 && bme280SensorStatus) activeSensors++;
-        // if (config.enableSCD41 && scd41SensorStatus) activeSensors++;
-        // if (config.enableMCP3424 && mcp3424SensorStatus) activeSensors++;
-        // if (config.enableADS1110 && ads1110SensorStatus) activeSensors++;
-        // if (config.enableINA219 && ina219SensorStatus) activeSensors++;
-        // if (config.enableSolarSensor && solarSensorStatus) activeSensors++;
-        // if (config.enableIPS && ipsSensorStatus) activeSensors++;
-        // if (config.enableOPCN3Sensor && opcn3SensorStatus) activeSensors++;
-
-        // Sprawdz czy wszystkie wlaczone czujniki dzialaja
-        int enabledSensors = 0;
-        int workingSensors = 0;
-
-        if (config.enableSHT30)
-        {
-            enabledSensors++;
-            if (sht30SensorStatus)
-                workingSensors++;
-        }
-        if (config.enableBME280)
-        {
-            enabledSensors++;
-            if (bme280SensorStatus)
-                workingSensors++;
-        }
-        if (config.enableSCD41)
-        {
-            enabledSensors++;
-            if (scd41SensorStatus)
-                workingSensors++;
-        }
-        if (config.enableMCP3424)
-        {
-            enabledSensors++;
-            if (mcp3424SensorStatus)
-                workingSensors++;
-        }
-        if (config.enableADS1110)
-        {
-            enabledSensors++;
-            if (ads1110SensorStatus)
-                workingSensors++;
-        }
-        if (config.enableINA219)
-        {
-            enabledSensors++;
-            if (ina219SensorStatus)
-                workingSensors++;
-        }
-        if (config.enableSolarSensor)
-        {
-            enabledSensors++;
-            if (solarSensorStatus)
-                workingSensors++;
-        }
-        if (config.enableIPS)
-        {
-            enabledSensors++;
-            if (ipsSensorStatus)
-                workingSensors++;
-        }
-        if (config.enableOPCN3Sensor)
-        {
-            enabledSensors++;
-            if (opcn3SensorStatus)
-                workingSensors++;
-        }
+    // Count active sensors
+    //  int activeSensors = 0;
+    // Sprawdz status czujnikow tylko jesli sa wlaczone w konfiguracji
+    // if (config.enableSHT30 && sht30SensorStatus) activeSensors++;
+    // if (config.enableBME280 && bme280SensorStatus) activeSensors++;
+    // if (config.enableSCD41 && scd41SensorStatus) activeSensors++;
+    // if (config.enableMCP3424 && mcp3424SensorStatus) activeSensors++;
+    // if (config.enableADS1110 && ads1110SensorStatus) activeSensors++;
+    // if (config.enableINA219 && ina219SensorStatus) activeSensors++;
+    // if (config.enableSolarSensor && solarSensorStatus) activeSensors++;
+    // if (config.enableIPS && ipsSensorStatus) activeSensors++;
+    // if (config.enableOPCN3Sensor && opcn3SensorStatus) activeSensors++;
+
+    // Sprawdz czy wszystkie wlaczone czujniki dzialaja
+    int enabledSensors = 0;
+    int workingSensors = 0;
+
+    if (config.enableSHT30)
+    {
+        enabledSensors++;
+        if (sht30SensorStatus)
+            workingSensors++;
+    }
+    if (config.enableBME280)
+    {
+        enabledSensors++;
+        if (bme280SensorStatus)
+            workingSensors++;
+    }
+    if (config.enableSCD41)
+    {
+        enabledSensors++;
+        if (scd41SensorStatus)
+            workingSensors++;
+    }
+    if (config.enableMCP3424)
+    {
+        enabledSensors++;
+        if (mcp3424SensorStatus)
+            workingSensors++;
+    }
+    if (config.enableADS1110)
+    {
+        enabledSensors++;
+        if (ads1110SensorStatus)
+            workingSensors++;
+    }
+    if (config.enableINA219)
+    {
+        enabledSensors++;
+        if (ina219SensorStatus)
+            workingSensors++;
+    }
+    if (config.enableSolarSensor)
+    {
+        enabledSensors++;
+        if (solarSensorStatus)
+            workingSensors++;
+    }
+    if (config.enableIPS)
+    {
+        enabledSensors++;
+        if (ipsSensorStatus)
+            workingSensors++;
+    }
+    if (config.enableOPCN3Sensor)
+    {
+        enabledSensors++;
+        if (opcn3SensorStatus)
+            workingSensors++;
+    }
 
-        // Ustaw kolor LED na podstawie statusu wszystkich wlaczonych czujnikow (tylko jeśli nie w trybie niskiego poboru mocy)
-        if (!config.lowPowerMode)
+    // Ustaw kolor LED na podstawie statusu wszystkich wlaczonych czujnikow (tylko jeśli nie w trybie niskiego poboru mocy)
+    if (!config.lowPowerMode)
+    {
+        if (enabledSensors > 0)
         {
-            if (enabledSensors > 0)
+            if (workingSensors == enabledSensors)
             {
-                if (workingSensors == enabledSensors)
-                {
-                    pixels.setPixelColor(0, pixels.Color(0, 255, 0)); // Zielony - wszystkie wlaczone dzialaja
-                }
-                else if (workingSensors >= 2)
-                {
-                    pixels.setPixelColor(0, pixels.Color(0, 255, 255)); // Cyjan - wiekszosc dziala
-                }
-                else if (workingSensors == 1)
-                {
-                    pixels.setPixelColor(0, pixels.Color(255, 255, 0)); // Zolty - tylko 1 dziala
-                }
-                else
-                {
-                    pixels.setPixelColor(0, pixels.Color(255, 0, 0)); // Czerwony - zadne nie dzialaja
-                }
+                pixels.setPixelColor(0, pixels.Color(0, 255, 0)); // Zielony - wszystkie wlaczone dzialaja
+            }
+            else if (workingSensors >= 2)
+            {
+                pixels.setPixelColor(0, pixels.Color(0, 255, 255)); // Cyjan - wiekszosc dziala
+            }
+            else if (workingSensors == 1)
+            {
+                pixels.setPixelColor(0, pixels.Color(255, 255, 0)); // Zolty - tylko 1 dziala
             }
             else
             {
-                pixels.setPixelColor(0, pixels.Color(128, 128, 128)); // Szary - brak wlaczonych czujnikow
+                pixels.setPixelColor(0, pixels.Color(255, 0, 0)); // Czerwony - zadne nie dzialaja
             }
-            pixels.show();
         }
+        else
+        {
+            pixels.setPixelColor(0, pixels.Color(128, 128, 128)); // Szary - brak wlaczonych czujnikow
+        }
+        pixels.show();
     }
 }
 void watchDogTask(void *parameter)
@@ -2424,8 +2424,16 @@ void initializeMovingAverages() {
     movingAverageManager.initializeBuffers();
 }
 
+// Generacja średnich - rośnie przy każdym przeliczeniu (unieważnia cache odpowiedzi)
+static volatile uint32_t averagesGeneration = 0;
+
 void updateMovingAverages() {
     movingAverageManager.updateSensorData();
+    averagesGeneration++;
+}
+
+uint32_t getAveragesGeneration() {
+    return averagesGeneration;
 }
 
 void printMovingAverageStatus() {
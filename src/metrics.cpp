@@ -0,0 +1,581 @@
+#include <metrics.h>
+#include <sensor_fields.h>
+#include <sensors.h>
+#include <mean.h>
+#include <fan.h>
+#include <config.h>
+#include <modbus_handler.h>
+#include <modbus_tcp.h>
+#include <scheduler.h>
+#include <i2c_bus.h>
+#include <i2c_sensors.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <cstdarg>
+
+// Forward declarations for safe printing functions
+void safePrint(const String& message);
+void safePrintln(const String& message);
+
+extern FeatureConfig config;
+extern SolarData solarData;
+extern I2CSensorData i2cSensorData;
+extern SPS30Data sps30Data;
+extern IPSSensorData ipsSensorData;
+extern MCP3424Data mcp3424Data;
+extern ADS1110Data ads1110Data;
+extern INA219Data ina219Data;
+extern SHT40Data sht40Data;
+extern HCHOData hchoData;
+extern BatteryData batteryData;
+extern bool solarSensorStatus;
+extern bool opcn3SensorStatus;
+extern bool i2cSensorStatus;
+extern bool sht40SensorStatus;
+extern bool sps30SensorStatus;
+extern bool ipsSensorStatus;
+extern bool mcp3424SensorStatus;
+extern bool ads1110SensorStatus;
+extern bool ina219SensorStatus;
+extern bool hchoSensorStatus;
+extern int wsClientCount;
+extern unsigned long lastModbusActivity;
+extern bool hasHadModbusActivity;
+
+// Liczniki Modbus (modbus_handler.cpp)
+extern uint32_t modbusRxEvents;
+extern uint32_t modbusCommandsExecuted;
+extern uint32_t modbusCommandErrors;
+extern uint32_t modbusRtuCrcErrors;
+extern uint32_t modbusRtuFrameErrors;
+
+static char* metricsBuffer = nullptr;
+static volatile bool metricsBusy = false;
+static volatile uint32_t metricsToken = 0;
+static unsigned long metricsBusySince = 0;
+static uint32_t metricsScrapes = 0;
+static uint32_t metricsRejected = 0;
+static size_t metricsLastLength = 0;
+static uint32_t metricsLastRenderMicros = 0;
+
+// Czasy loop() - zapis tylko z loopTask
+static uint32_t loopIterations = 0;
+static uint32_t loopLastMicros = 0;
+static uint32_t loopMaxMicros = 0;
+static float loopAvgMicros = 0.0f;
+
+bool initializeMetrics() {
+    if (metricsBuffer) return true;
+
+    metricsBuffer = (char*)heap_caps_malloc(METRICS_BUFFER_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!metricsBuffer) {
+        metricsBuffer = (char*)malloc(METRICS_BUFFER_SIZE);
+    }
+    if (!metricsBuffer) {
+        safePrintln("Metrics: failed to allocate " + String(METRICS_BUFFER_SIZE) + " bytes");
+        return false;
+    }
+    return true;
+}
+
+void recordLoopTime(uint32_t micros) {
+    loopIterations++;
+    loopLastMicros = micros;
+    if (micros > loopMaxMicros) loopMaxMicros = micros;
+    // Średnia wykładnicza (~100 iteracji)
+    loopAvgMicros += ((float)micros - loopAvgMicros) * 0.01f;
+}
+
+// Zapis tekstu OpenMetrics do stałego bufora - przepełnienie zapamiętane, bez realokacji
+class MetricsWriter {
+public:
+    MetricsWriter(char* buffer, size_t size) : buffer(buffer), size(size) {}
+
+    void appendf(const char* fmt, ...) {
+        if (overflow) return;
+        va_list args;
+        va_start(args, fmt);
+        int written = vsnprintf(buffer + length, size - length, fmt, args);
+        va_end(args);
+        if (written < 0 || length + written >= size) {
+            overflow = true;
+            return;
+        }
+        length += written;
+    }
+
+    // Nagłówek rodziny metryk (TYPE/HELP/UNIT) - próbki rodziny muszą następować bezpośrednio po nim
+    void family(const char* name, const char* type, const char* help, const char* unit = nullptr) {
+        appendf("# TYPE %s %s\n", name, type);
+        if (unit) appendf("# UNIT %s %s\n", name, unit);
+        appendf("# HELP %s %s\n", name, help);
+    }
+
+    void value(double v) {
+        if (isnan(v)) {
+            appendf(" NaN\n");
+        } else if (isinf(v)) {
+            appendf(v > 0 ? " +Inf\n" : " -Inf\n");
+        } else {
+            appendf(" %.10g\n", v);
+        }
+    }
+
+    void gauge(const char* name, double v) {
+        appendf("%s", name);
+        value(v);
+    }
+
+    void gaugeLabel(const char* name, const char* label, const char* labelValue, double v) {
+        appendf("%s{%s=\"%s\"}", name, label, labelValue);
+        value(v);
+    }
+
+    void counter(const char* name, uint32_t v) {
+        appendf("%s_total %u\n", name, (unsigned)v);
+    }
+
+    void counterLabel(const char* name, const char* label, const char* labelValue, uint32_t v) {
+        appendf("%s_total{%s=\"%s\"} %u\n", name, label, labelValue, (unsigned)v);
+    }
+
+    // Licznik ułamkowy (np. sekundy CPU)
+    void counterLabelFloat(const char* name, const char* label, const char* labelValue, double v) {
+        appendf("%s_total{%s=\"%s\"}", name, label, labelValue);
+        value(v);
+    }
+
+    void counterFloat(const char* name, double v) {
+        appendf("%s_total", name);
+        value(v);
+    }
+
+    size_t getLength() const { return length; }
+    bool hasOverflow() const { return overflow; }
+
+private:
+    char* buffer;
+    size_t size;
+    size_t length = 0;
+    bool overflow = false;
+};
+
+// Pola czujnika jako próbki jednej rodziny: name{sensor="sps30",field="PM25"[,window="fast"]} 12.5
+class MetricsFieldWriter : public SensorFieldWriter {
+public:
+    MetricsFieldWriter(MetricsWriter& out, const char* metric, const char* sensor, const char* window)
+        : out(out), metric(metric), sensor(sensor), window(window) {}
+
+    void number(const char* name, float value, uint8_t decimals) override {
+        (void)decimals;          // Prometheus - wartość w pełnej precyzji
+        sample(name);
+        out.value(value);
+    }
+
+    void integer(const char* name, long value) override {
+        sample(name);
+        out.value((double)value);
+    }
+
+    void flag(const char* name, bool value) override {
+        sample(name);
+        out.value(value ? 1.0 : 0.0);
+    }
+
+    void text(const char* name, const char* value) override {
+        // Tekstowe pola (VE.Direct) tylko gdy są liczbą
+        char* end = nullptr;
+        float parsed = strtof(value, &end);
+        if (!value[0] || (end && *end)) return;
+        sample(name);
+        out.value(parsed);
+    }
+
+private:
+    void sample(const char* field) {
+        if (window) {
+            out.appendf("%s{sensor=\"%s\",field=\"%s\",window=\"%s\"}", metric, sensor, field, window);
+        } else {
+            out.appendf("%s{sensor=\"%s\",field=\"%s\"}", metric, sensor, field);
+        }
+    }
+
+    MetricsWriter& out;
+    const char* metric;
+    const char* sensor;
+    const char* window;
+};
+
+typedef void (*MetricsFieldSource)(SensorFieldWriter& w);
+
+struct MetricsSensor {
+    const char* name;
+    const bool* status;
+    MetricsFieldSource current;
+    MetricsFieldSource fast;      // nullptr = brak średnich
+    MetricsFieldSource slow;
+};
+
+static const MetricsSensor metricsSensors[] = {
+    {"solar", &solarSensorStatus,
+        [](SensorFieldWriter& w) { writeSensorFields(solarData, w); },
+        [](SensorFieldWriter& w) { writeSensorFields(getSolarFastAverage(), w); },
+        [](SensorFieldWriter& w) { writeSensorFields(getSolarSlowAverage(), w); }},
+    {"i2c", &i2cSensorStatus,
+        [](SensorFieldWriter& w) { writeSensorFields(i2cSensorData, w); },
+        [](SensorFieldWriter& w) { writeSensorFields(getI2CFastAverage(), w); },
+        [](SensorFieldWriter& w) { writeSensorFields(getI2CSlowAverage(), w); }},
+    {"sht40", &sht40SensorStatus,
+        [](SensorFieldWriter& w) { writeSensorFields(sht40Data, w); },
+        [](SensorFieldWriter& w) { writeSensorFields(getSHT40FastAverage(), w); },
+        [](SensorFieldWriter& w) { writeSensorFields(getSHT40SlowAverage(), w); }},
+    {"sps30", &sps30SensorStatus,
+        [](SensorFieldWriter& w) { writeSensorFields(sps30Data, w); },
+        [](SensorFieldWriter& w) { writeSensorFields(getSPS30FastAverage(), w); },
+        [](SensorFieldWriter& w) { writeSensorFields(getSPS30SlowAverage(), w); }},
+    {"ips", &ipsSensorStatus,
+        [](SensorFieldWriter& w) { writeSensorFields(ipsSensorData, w); },
+        [](SensorFieldWriter& w) { writeSensorFields(getIPSFastAverage(), w); },
+        [](SensorFieldWriter& w) { writeSensorFields(getIPSSlowAverage(), w); }},
+    {"mcp3424", &mcp3424SensorStatus,
+        [](SensorFieldWriter& w) { writeSensorFields(mcp3424Data, w); },
+        [](SensorFieldWriter& w) { writeSensorFields(getMCP3424FastAverage(), w); },
+        [](SensorFieldWriter& w) { writeSensorFields(getMCP3424SlowAverage(), w); }},
+    {"ads1110", &ads1110SensorStatus,
+        [](SensorFieldWriter& w) { writeSensorFields(ads1110Data, w); },
+        [](SensorFieldWriter& w) { writeSensorFields(getADS1110FastAverage(), w); },
+        [](SensorFieldWriter& w) { writeSensorFields(getADS1110SlowAverage(), w); }},
+    {"power", &ina219SensorStatus,
+        [](SensorFieldWriter& w) { writeSensorFields(ina219Data, w); },
+        [](SensorFieldWriter& w) { writeSensorFields(getINA219FastAverage(), w); },
+        [](SensorFieldWriter& w) { writeSensorFields(getINA219SlowAverage(), w); }},
+    {"hcho", &hchoSensorStatus,
+        [](SensorFieldWriter& w) { writeSensorFields(hchoData, w); },
+        [](SensorFieldWriter& w) { writeSensorFields(getHCHOFastAverage(), w); },
+        [](SensorFieldWriter& w) { writeSensorFields(getHCHOSlowAverage(), w); }},
+    {"calibration", &calibratedData.valid,
+        [](SensorFieldWriter& w) { writeSensorFields(calibratedData, w); },
+        [](SensorFieldWriter& w) { writeSensorFields(getCalibratedFastAverage(), w); },
+        [](SensorFieldWriter& w) { writeSensorFields(getCalibratedSlowAverage(), w); }},
+    {"battery", &batteryData.valid,
+        [](SensorFieldWriter& w) { writeSensorFields(batteryData, w); },
+        nullptr, nullptr},
+};
+
+// Taski z własnym stosem - nazwy jak w xTaskCreate
+static const char* const metricsTasks[] = {
+    "loopTask", "WebSocketTask", "wsBroadcastTask", "wifiReconnectTask", "timeCheckTask",
+    "eventStreamTask", "modbusTask", "async_tcp", "MCP3424_Task", "SCD41_Task", "i2cBusTask", "Watchdog"
+};
+
+static void renderSensorMetrics(MetricsWriter& out) {
+    out.family("espsensor_sensor_up", "gauge", "Sensor status (1 = reading OK)");
+    out.gaugeLabel("espsensor_sensor_up", "sensor", "opcn3", opcn3SensorStatus ? 1 : 0);
+    for (const MetricsSensor& sensor : metricsSensors) {
+        out.gaugeLabel("espsensor_sensor_up", "sensor", sensor.name, *sensor.status ? 1 : 0);
+    }
+
+    out.family("espsensor_sensor_value", "gauge", "Current sensor reading");
+    for (const MetricsSensor& sensor : metricsSensors) {
+        if (!*sensor.status) continue;
+        MetricsFieldWriter writer(out, "espsensor_sensor_value", sensor.name, nullptr);
+        sensor.current(writer);
+    }
+
+    out.family("espsensor_sensor_average", "gauge", "Moving average of sensor reading (fast 10 s, slow 5 min)");
+    for (const MetricsSensor& sensor : metricsSensors) {
+        if (!*sensor.status || !sensor.fast) continue;
+        MetricsFieldWriter fast(out, "espsensor_sensor_average", sensor.name, "fast");
+        sensor.fast(fast);
+        MetricsFieldWriter slow(out, "espsensor_sensor_average", sensor.name, "slow");
+        sensor.slow(slow);
+    }
+}
+
+static void renderSystemMetrics(MetricsWriter& out) {
+    out.family("espsensor_uptime_seconds", "gauge", "Time since boot", "seconds");
+    out.gauge("espsensor_uptime_seconds", millis() / 1000.0);
+
+    out.family("espsensor_loop_iterations", "counter", "Main loop iterations");
+    out.counter("espsensor_loop_iterations", loopIterations);
+    out.family("espsensor_loop_duration_seconds", "gauge", "Main loop pass time without scheduler sleep (last, avg, max since boot)", "seconds");
+    out.gaugeLabel("espsensor_loop_duration_seconds", "stat", "last", loopLastMicros / 1e6);
+    out.gaugeLabel("espsensor_loop_duration_seconds", "stat", "avg", loopAvgMicros / 1e6);
+    out.gaugeLabel("espsensor_loop_duration_seconds", "stat", "max", loopMaxMicros / 1e6);
+
+    out.family("espsensor_scheduler_sleep_seconds", "counter", "Time loopTask slept waiting for the next scheduler job", "seconds");
+    out.counterFloat("espsensor_scheduler_sleep_seconds", getSchedulerSleepMicros() / 1e6);
+
+    SchedulerJobStats job;
+    size_t jobCount = getSchedulerJobCount();
+    out.family("espsensor_scheduler_job_runs", "counter", "Scheduler job runs");
+    for (size_t i = 0; i < jobCount && getSchedulerJobStats(i, job); i++) {
+        out.counterLabel("espsensor_scheduler_job_runs", "job", job.name, job.runs);
+    }
+    out.family("espsensor_scheduler_job_wakes", "counter", "Job runs started early by an event (wakeSchedulerJob)");
+    for (size_t i = 0; i < jobCount && getSchedulerJobStats(i, job); i++) {
+        out.counterLabel("espsensor_scheduler_job_wakes", "job", job.name, job.wakes);
+    }
+    out.family("espsensor_scheduler_job_overruns", "counter", "Job runs late by a full period or more (missed deadlines dropped)");
+    for (size_t i = 0; i < jobCount && getSchedulerJobStats(i, job); i++) {
+        out.counterLabel("espsensor_scheduler_job_overruns", "job", job.name, job.overruns);
+    }
+    out.family("espsensor_scheduler_job_cpu_seconds", "counter", "CPU time spent in the job", "seconds");
+    for (size_t i = 0; i < jobCount && getSchedulerJobStats(i, job); i++) {
+        out.counterLabelFloat("espsensor_scheduler_job_cpu_seconds", "job", job.name, job.cpuTotal / 1e6);
+    }
+    out.family("espsensor_scheduler_job_duration_max_seconds", "gauge", "Longest job run since boot", "seconds");
+    for (size_t i = 0; i < jobCount && getSchedulerJobStats(i, job); i++) {
+        out.gaugeLabel("espsensor_scheduler_job_duration_max_seconds", "job", job.name, job.cpuMax / 1e6);
+    }
+    out.family("espsensor_scheduler_job_jitter_avg_seconds", "gauge", "Average job start delay after its deadline", "seconds");
+    for (size_t i = 0; i < jobCount && getSchedulerJobStats(i, job); i++) {
+        out.gaugeLabel("espsensor_scheduler_job_jitter_avg_seconds", "job", job.name, job.jitterAvg / 1e6);
+    }
+    out.family("espsensor_scheduler_job_jitter_max_seconds", "gauge", "Longest job start delay after its deadline since boot", "seconds");
+    for (size_t i = 0; i < jobCount && getSchedulerJobStats(i, job); i++) {
+        out.gaugeLabel("espsensor_scheduler_job_jitter_max_seconds", "job", job.name, job.jitterMax / 1e6);
+    }
+
+    out.family("espsensor_heap_free_bytes", "gauge", "Free internal heap", "bytes");
+    out.gauge("espsensor_heap_free_bytes", ESP.getFreeHeap());
+    out.family("espsensor_heap_min_free_bytes", "gauge", "Lowest free internal heap since boot", "bytes");
+    out.gauge("espsensor_heap_min_free_bytes", ESP.getMinFreeHeap());
+    out.family("espsensor_heap_max_alloc_bytes", "gauge", "Largest allocatable internal heap block", "bytes");
+    out.gauge("espsensor_heap_max_alloc_bytes", ESP.getMaxAllocHeap());
+    out.family("espsensor_psram_free_bytes", "gauge", "Free PSRAM", "bytes");
+    out.gauge("espsensor_psram_free_bytes", ESP.getFreePsram());
+    out.family("espsensor_psram_size_bytes", "gauge", "Total PSRAM", "bytes");
+    out.gauge("espsensor_psram_size_bytes", ESP.getPsramSize());
+
+    out.family("espsensor_task_stack_free_bytes", "gauge", "Task stack high-water mark (minimum free stack)", "bytes");
+    for (const char* name : metricsTasks) {
+        TaskHandle_t task = xTaskGetHandle(name);
+        if (!task) continue;
+        out.gaugeLabel("espsensor_task_stack_free_bytes", "task", name, uxTaskGetStackHighWaterMark(task));
+    }
+
+    out.family("espsensor_websocket_clients", "gauge", "Connected WebSocket clients");
+    out.gauge("espsensor_websocket_clients", wsClientCount);
+
+    if (config.enableFan) {
+        out.family("espsensor_fan_duty_ratio", "gauge", "Fan PWM duty cycle (0-1)", "ratio");
+        out.gauge("espsensor_fan_duty_ratio", getFanDutyCycle() / 100.0);
+        out.family("espsensor_fan_rpm", "gauge", "Fan speed from tacho");
+        out.gauge("espsensor_fan_rpm", getFanRPM());
+    }
+}
+
+static void renderI2CMetrics(MetricsWriter& out) {
+    if (!config.enableI2CSensors) return;
+
+    I2CBusStats bus = getI2CBusStats();
+    out.family("espsensor_i2c_bus_utilization_ratio", "gauge", "Share of time the I2C bus was busy since boot (0-1)", "ratio");
+    out.gauge("espsensor_i2c_bus_utilization_ratio", getI2CBusUtilization());
+    out.family("espsensor_i2c_bus_transactions", "counter", "I2C transactions executed by the bus manager");
+    out.counter("espsensor_i2c_bus_transactions", bus.transactions);
+    out.family("espsensor_i2c_bus_errors", "counter", "I2C transactions that failed (NACK, timeout, short read)");
+    out.counter("espsensor_i2c_bus_errors", bus.errors);
+    out.family("espsensor_i2c_bus_batches", "counter", "Bus task wakeups that ran queued transactions back to back");
+    out.counter("espsensor_i2c_bus_batches", bus.batches);
+    out.family("espsensor_i2c_bus_queue_full", "counter", "Transactions that waited for space in the bus queue");
+    out.counter("espsensor_i2c_bus_queue_full", bus.queueFull);
+
+    I2CDeviceStats device;
+    size_t deviceCount = getI2CDeviceCount();
+    char address[8];
+    out.family("espsensor_i2c_device_transactions", "counter", "I2C transactions per device address");
+    for (size_t i = 0; i < deviceCount && getI2CDeviceStats(i, device); i++) {
+        snprintf(address, sizeof(address), "0x%02x", device.address);
+        out.counterLabel("espsensor_i2c_device_transactions", "device", address, device.transactions);
+    }
+    out.family("espsensor_i2c_device_errors", "counter", "Failed I2C transactions per device address");
+    for (size_t i = 0; i < deviceCount && getI2CDeviceStats(i, device); i++) {
+        snprintf(address, sizeof(address), "0x%02x", device.address);
+        out.counterLabel("espsensor_i2c_device_errors", "device", address, device.errors);
+    }
+    out.family("espsensor_i2c_device_latency_avg_seconds", "gauge", "Average time from queueing a transaction to its result", "seconds");
+    for (size_t i = 0; i < deviceCount && getI2CDeviceStats(i, device); i++) {
+        snprintf(address, sizeof(address), "0x%02x", device.address);
+        out.gaugeLabel("espsensor_i2c_device_latency_avg_seconds", "device", address, device.latencyAvg / 1e6);
+    }
+    out.family("espsensor_i2c_device_latency_max_seconds", "gauge", "Longest time from queueing a transaction to its result since boot", "seconds");
+    for (size_t i = 0; i < deviceCount && getI2CDeviceStats(i, device); i++) {
+        snprintf(address, sizeof(address), "0x%02x", device.address);
+        out.gaugeLabel("espsensor_i2c_device_latency_max_seconds", "device", address, device.latencyMax / 1e6);
+    }
+    out.family("espsensor_i2c_device_bus_seconds", "counter", "I2C bus time used per device address", "seconds");
+    for (size_t i = 0; i < deviceCount && getI2CDeviceStats(i, device); i++) {
+        snprintf(address, sizeof(address), "0x%02x", device.address);
+        out.counterLabelFloat("espsensor_i2c_device_bus_seconds", "device", address, device.busMicros / 1e6);
+    }
+}
+
+static void renderMCP3424Metrics(MetricsWriter& out) {
+    if (!config.enableI2CSensors || !config.enableMCP3424) return;
+
+    MCP3424DeviceStats device;
+    uint8_t deviceCount = getMCP3424DeviceCount();
+    char address[8];
+    out.family("espsensor_mcp3424_cycle_seconds", "gauge", "Duration of the last 4-channel conversion cycle per MCP3424", "seconds");
+    for (uint8_t i = 0; i < deviceCount && getMCP3424DeviceStats(i, device); i++) {
+        snprintf(address, sizeof(address), "0x%02x", device.address);
+        out.gaugeLabel("espsensor_mcp3424_cycle_seconds", "device", address, device.lastCycleMicros / 1e6);
+    }
+    out.family("espsensor_mcp3424_conversions", "counter", "MCP3424 channel results read with RDY cleared");
+    for (uint8_t i = 0; i < deviceCount && getMCP3424DeviceStats(i, device); i++) {
+        snprintf(address, sizeof(address), "0x%02x", device.address);
+        out.counterLabel("espsensor_mcp3424_conversions", "device", address, device.conversions);
+    }
+    out.family("espsensor_mcp3424_rdy_polls", "counter", "MCP3424 reads that found the conversion not ready yet");
+    for (uint8_t i = 0; i < deviceCount && getMCP3424DeviceStats(i, device); i++) {
+        snprintf(address, sizeof(address), "0x%02x", device.address);
+        out.counterLabel("espsensor_mcp3424_rdy_polls", "device", address, device.notReady);
+    }
+    out.family("espsensor_mcp3424_conversion_failures", "counter", "MCP3424 conversions lost to bus errors or RDY timeouts");
+    for (uint8_t i = 0; i < deviceCount && getMCP3424DeviceStats(i, device); i++) {
+        snprintf(address, sizeof(address), "0x%02x", device.address);
+        out.counterLabel("espsensor_mcp3424_conversion_failures", "device", address, device.errors + device.timeouts);
+    }
+}
+
+static void renderModbusMetrics(MetricsWriter& out) {
+    if (!config.enableModbus) return;
+
+    out.family("espsensor_modbus_rx_events", "counter", "Modbus RTU receive events (pending input seen by the RTU task or loop)");
+    out.counter("espsensor_modbus_rx_events", modbusRxEvents);
+    out.family("espsensor_modbus_commands", "counter", "Commands executed from the Modbus command register");
+    out.counter("espsensor_modbus_commands", modbusCommandsExecuted);
+    out.family("espsensor_modbus_command_errors", "counter", "Unknown or failed Modbus commands");
+    out.counter("espsensor_modbus_command_errors", modbusCommandErrors);
+
+    // Odświeżanie banków rejestrów tylko po zmianie danych
+    ModbusBankStats stats;
+    out.family("espsensor_modbus_bank_refreshes", "counter", "Register bank rewrites after source data change");
+    for (size_t i = 0; getModbusBankStats(i, stats); i++) {
+        out.counterLabel("espsensor_modbus_bank_refreshes", "bank", stats.name, stats.refreshes);
+    }
+    out.family("espsensor_modbus_bank_skips", "counter", "Loop passes with unchanged bank data (rewrite skipped)");
+    for (size_t i = 0; getModbusBankStats(i, stats); i++) {
+        out.counterLabel("espsensor_modbus_bank_skips", "bank", stats.name, stats.skips);
+    }
+    out.family("espsensor_modbus_bank_refresh_cycles", "gauge", "Average CPU cycles per bank rewrite");
+    for (size_t i = 0; getModbusBankStats(i, stats); i++) {
+        out.gaugeLabel("espsensor_modbus_bank_refresh_cycles", "bank", stats.name, stats.avgCycles);
+    }
+    out.family("espsensor_modbus_cycles_saved_per_loop", "gauge", "CPU cycles per loop saved by skipping unchanged banks");
+    out.gauge("espsensor_modbus_cycles_saved_per_loop", getModbusCyclesSavedPerLoop());
+
+    ModbusImageStats image;
+    getModbusImageStats(image);
+    out.family("espsensor_modbus_bank_publishes", "counter", "Register banks published atomically from the staging image");
+    out.counter("espsensor_modbus_bank_publishes", image.publishes);
+    out.family("espsensor_modbus_published_words", "counter", "Changed registers copied to the live image");
+    out.counter("espsensor_modbus_published_words", image.words);
+    out.family("espsensor_modbus_publish_max_lock_cycles", "gauge", "Longest bank publish under the register image lock (CPU cycles)");
+    out.gauge("espsensor_modbus_publish_max_lock_cycles", image.maxLockCycles);
+
+    // Banki cienia (stały typ danych) - odświeżane tylko czytane przez mastera
+    static const char* const shadowTypes[] = {"current", "fast", "slow"};
+    ModbusShadowStats shadow;
+    out.family("espsensor_modbus_shadow_active_banks", "gauge", "Shadow register banks read by a master within the hold time");
+    for (int type = DATA_CURRENT; type <= DATA_SLOW_AVG; type++) {
+        if (!getModbusShadowStats((DataType)type, shadow)) continue;
+        out.gaugeLabel("espsensor_modbus_shadow_active_banks", "type", shadowTypes[type], shadow.activeBanks);
+    }
+    out.family("espsensor_modbus_shadow_refreshes", "counter", "Shadow register bank rewrites after source data change");
+    for (int type = DATA_CURRENT; type <= DATA_SLOW_AVG; type++) {
+        if (!getModbusShadowStats((DataType)type, shadow)) continue;
+        out.counterLabel("espsensor_modbus_shadow_refreshes", "type", shadowTypes[type], shadow.refreshes);
+    }
+
+    // Opóźnienie odpowiedzi RTU z okna ostatnich ramek (modbusTask)
+    ModbusLatencyStats latency;
+    getModbusLatencyStats(latency);
+    out.family("espsensor_modbus_rtu_event_driven", "gauge", "Modbus RTU served by the UART event task (0 = polled from loop)");
+    out.gauge("espsensor_modbus_rtu_event_driven", latency.eventDriven ? 1 : 0);
+    if (latency.samples > 0) {
+        out.family("espsensor_modbus_response_latency_seconds", "gauge", "RTU response latency from end of request frame", "seconds");
+        out.gaugeLabel("espsensor_modbus_response_latency_seconds", "quantile", "0.5", latency.p50 / 1e6);
+        out.gaugeLabel("espsensor_modbus_response_latency_seconds", "quantile", "0.9", latency.p90 / 1e6);
+        out.gaugeLabel("espsensor_modbus_response_latency_seconds", "quantile", "0.99", latency.p99 / 1e6);
+        out.gaugeLabel("espsensor_modbus_response_latency_seconds", "quantile", "1", latency.max / 1e6);
+    }
+    out.family("espsensor_modbus_rtu_frames", "counter", "Frames served by the Modbus RTU task");
+    out.counter("espsensor_modbus_rtu_frames", latency.frames);
+    out.family("espsensor_modbus_rtu_crc_errors", "counter", "Modbus RTU frames dropped on CRC mismatch");
+    out.counter("espsensor_modbus_rtu_crc_errors", modbusRtuCrcErrors);
+    out.family("espsensor_modbus_rtu_frame_errors", "counter", "Modbus RTU frames too short or too long to parse");
+    out.counter("espsensor_modbus_rtu_frame_errors", modbusRtuFrameErrors);
+
+    ModbusTcpStats tcp;
+    getModbusTcpStats(tcp);
+    out.family("espsensor_modbus_tcp_clients", "gauge", "Connected Modbus TCP clients");
+    out.gauge("espsensor_modbus_tcp_clients", tcp.clients);
+    out.family("espsensor_modbus_tcp_connections", "counter", "Modbus TCP connections accepted");
+    out.counter("espsensor_modbus_tcp_connections", tcp.connections);
+    out.family("espsensor_modbus_tcp_rejected", "counter", "Modbus TCP connections rejected (no free client slot)");
+    out.counter("espsensor_modbus_tcp_rejected", tcp.rejected);
+    out.family("espsensor_modbus_tcp_requests", "counter", "Modbus TCP requests served");
+    out.counter("espsensor_modbus_tcp_requests", tcp.requests);
+    out.family("espsensor_modbus_tcp_exceptions", "counter", "Modbus TCP responses with an exception code");
+    out.counter("espsensor_modbus_tcp_exceptions", tcp.exceptions);
+    out.family("espsensor_modbus_tcp_frame_errors", "counter", "Modbus TCP clients dropped for a bad MBAP header or receive overflow");
+    out.counter("espsensor_modbus_tcp_frame_errors", tcp.frameErrors);
+    if (hasHadModbusActivity) {
+        out.family("espsensor_modbus_last_activity_seconds", "gauge", "Time since last Modbus activity", "seconds");
+        out.gauge("espsensor_modbus_last_activity_seconds", (millis() - lastModbusActivity) / 1000.0);
+    }
+}
+
+bool renderMetrics(const char*& data, size_t& length, uint32_t& token) {
+    if (!metricsBuffer) return false;
+
+    // Poprzednia odpowiedź wciąż wysyłana (albo zerwana bez zwolnienia bufora)
+    if (metricsBusy && millis() - metricsBusySince < METRICS_BUSY_TIMEOUT) {
+        metricsRejected++;
+        return false;
+    }
+    metricsBusy = true;
+    metricsBusySince = millis();
+    metricsToken++;
+
+    unsigned long start = micros();
+    MetricsWriter out(metricsBuffer, METRICS_BUFFER_SIZE);
+    renderSensorMetrics(out);
+    renderSystemMetrics(out);
+    renderI2CMetrics(out);
+    renderMCP3424Metrics(out);
+    renderModbusMetrics(out);
+
+    out.family("espsensor_metrics_render_seconds", "gauge", "Time spent rendering the previous scrape", "seconds");
+    out.gauge("espsensor_metrics_render_seconds", metricsLastRenderMicros / 1e6);
+    out.appendf("# EOF\n");
+
+    if (out.hasOverflow()) {
+        safePrintln("Metrics: buffer overflow (" + String(METRICS_BUFFER_SIZE) + " bytes)");
+        metricsBusy = false;
+        return false;
+    }
+
+    metricsLastRenderMicros = micros() - start;
+    metricsLastLength = out.getLength();
+    metricsScrapes++;
+    data = metricsBuffer;
+    length = out.getLength();
+    token = metricsToken;
+    return true;
+}
+
+void releaseMetricsBuffer(uint32_t token) {
+    if (token == metricsToken) {
+        metricsBusy = false;
+    }
+}
+
+String getMetricsStatus() {
+    return "- Metrics: " + String(metricsScrapes) + " scrapes, last " + String(metricsLastLength) + "/" +
+           String(METRICS_BUFFER_SIZE) + " bytes in " + String(metricsLastRenderMicros) + " us, busy rejects " +
+           String(metricsRejected) + "\n";
+}
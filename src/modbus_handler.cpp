@@ -1,9 +1,17 @@
 #include <modbus_handler.h>
+#include <modbus_tcp.h>
+#include <modbus_history.h>
 #include <sensors.h>
 #include <ips_sensor.h>
 #include <mean.h>
 #include <calib.h>
 #include <time.h>
+#include <command_registry.h>
+#include <fnv_hash.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <algorithm>
 
 // Forward declarations for safe printing functions
 void safePrint(const String& message);
@@ -13,10 +21,17 @@ void safePrintln(const String& message);
 ModbusSerial mb(Serial2, MODBUS_SLAVE_ID);
 unsigned int modbusRegisters[REG_COUNT_SOLAR];
 unsigned int modbusRegistersOPCN3[REG_COUNT_OPCN3];
-unsigned int modbusRegistersIPS[REG_COUNT_IPS];
 
 // Modbus activity tracking
 unsigned long lastModbusActivity = 0;
+
+// Liczniki dla /metrics
+uint32_t modbusRxEvents = 0;
+uint32_t modbusCommandsExecuted = 0;
+uint32_t modbusCommandErrors = 0;
+uint32_t modbusRtuCrcErrors = 0;
+uint32_t modbusRtuFrameErrors = 0;
+uint32_t modbusRxLostEvents = 0;         // ramki obsłużone bez zdarzenia RX timeout (pobudka po timeoucie)
 bool hasHadModbusActivity = false;
 
 // Network flag for display
@@ -80,6 +95,56 @@ DataType getCurrentDataType() {
 // External configuration
 extern FeatureConfig config;
 
+// ===== Komendy z rejestru komend Modbus (rejestr 101) =====
+// Kody 2, 7-11 wspoldzielone z komendami Serial (tabela w main.cpp)
+
+static void modbusCmdReadOPCN3(CommandContext&) {
+    if (config.enableOPCN3Sensor) {
+        opcn3Data = myOPCN3.readHistogramData();
+        updateModbusOPCN3Registers();
+    }
+}
+
+static void modbusCmdToggleAutoReset(CommandContext&) {
+    config.autoReset = !config.autoReset;
+    mb.setHreg(REG_COUNT_SOLAR + REG_COUNT_OPCN3+2, config.autoReset ? 1 : 0); // Store state in register 92
+}
+
+static void modbusCmdReadIPS(CommandContext&) {
+    if (config.enableIPS) {
+        readIPS(ipsSensorData);
+        updateModbusIPSRegisters();
+    }
+}
+
+static void modbusCmdIPSDebug(CommandContext& ctx) {
+    if (config.enableIPS) {
+        if (ctx.modbusCode == 5) {
+            enableIPSDebugMode();
+        } else {
+            disableIPSDebugMode();
+        }
+        updateModbusIPSRegisters();
+    }
+}
+
+static const CommandDef modbusCommands[] = {
+    {"modbus_opcn3_read", CMD_SRC_MODBUS, modbusCmdReadOPCN3, COMMAND_NO_ARGS, false, 1},
+    {"modbus_auto_reset_toggle", CMD_SRC_MODBUS, modbusCmdToggleAutoReset, COMMAND_NO_ARGS, false, 3},
+    {"modbus_ips_read", CMD_SRC_MODBUS, modbusCmdReadIPS, COMMAND_NO_ARGS, false, 4},
+    {"modbus_ips_debug_on", CMD_SRC_MODBUS, modbusCmdIPSDebug, COMMAND_NO_ARGS, false, 5},
+    {"modbus_ips_debug_off", CMD_SRC_MODBUS, modbusCmdIPSDebug, COMMAND_NO_ARGS, false, 6},
+};
+
+static void startModbusTask();
+static void initModbusImage();
+static void runModbusHistoryQuery();
+
+// Rejestr bez blokad - rejestracja przy starcie, także gdy Modbus włączany później (CONFIG_MODBUS_ON)
+void registerModbusCommands() {
+    registerCommands(modbusCommands, sizeof(modbusCommands) / sizeof(modbusCommands[0]));
+}
+
 void initializeModbus() {
     if (!config.enableModbus) return;
     
@@ -92,7 +157,7 @@ void initializeModbus() {
     mb.setSlaveId(MODBUS_SLAVE_ID);
     
     // Calculate total registers needed
-    int totalRegisters = REG_COUNT_SOLAR + REG_COUNT_OPCN3 + REG_COUNT_I2C + REG_COUNT_IPS + REG_COUNT_MCP3424 + REG_COUNT_ADS1110 + REG_COUNT_INA219 + REG_COUNT_SPS30 + REG_COUNT_SHT40 + REG_COUNT_HCHO + REG_COUNT_CALIBRATION;
+    int totalRegisters = MODBUS_REG_TOTAL;
     safePrint("Initializing ");
     safePrint(String(totalRegisters));
     safePrintln(" Modbus registers");
@@ -128,15 +193,229 @@ void initializeModbus() {
     mb.setHreg(REG_COUNT_SOLAR + REG_COUNT_OPCN3+1, (uint16_t)currentDataType);  // Data type selector
     mb.setHreg(REG_COUNT_SOLAR + REG_COUNT_OPCN3+3, 1);  // Moving averages status (1 = active)
     
+    initModbusImage();
+    runModbusHistoryQuery();
+    startModbusTask();
+    initializeModbusTcp();
+
     safePrintln("Modbus initialized with IPS, HCHO support and moving averages");
 }
 
+// ===== Obraz rejestrów z podwójnym buforem =====
+// updateModbus*Registers() składają wartości w buforze roboczym (stageHreg), a publishModbusBank()
+// przenosi bank do rejestrów ModbusSerial pod tym samym mutexem, pod którym mb.task() obsługuje
+// ramkę. Odczyt mastera widzi więc cały bank z jednego przebiegu - bez rozerwanych wartości 32-bit
+// (timestamp, napięcia µV) - a obsługa żądania niczego nie przelicza.
+
+static uint16_t modbusStaging[MODBUS_DIAG_BASE_REG];     // bufor roboczy (zapis z loop)
+static uint16_t modbusPublished[MODBUS_REG_TOTAL];       // kopia rejestrów mb - źródło odczytów Modbus TCP
+static SemaphoreHandle_t modbusImageMutex = NULL;
+static uint32_t modbusPublishes = 0;
+static uint32_t modbusPublishedWords = 0;
+static uint32_t modbusPublishMaxCycles = 0;             // najdłuższe trzymanie mutexa przy publikacji
+
+// Bank cienia jednego typu danych - bufor roboczy i publikowany obok siebie, alokowane przy
+// pierwszym odczycie mastera. lastRead zapisują taski Modbus (RTU, async_tcp), czyta loop().
+struct ModbusShadowView {
+    uint16_t* staging;
+    uint16_t* published;
+    volatile uint32_t lastRead[MAP_BANK_COUNT];     // millis() ostatniego odczytu, 0 = nigdy
+    uint32_t refreshes;
+    uint32_t reads;
+};
+
+#define MODBUS_VIEW_MAIN -1
+
+static ModbusShadowView modbusShadows[MODBUS_SHADOW_VIEWS];
+static int composeView = MODBUS_VIEW_MAIN;              // obraz, do którego updateModbus*Registers() składają bank
+
+// Typ danych składanego banku: z rejestru 102 dla obrazu głównego, stały dla banku cienia
+static inline DataType composeDataType() {
+    return composeView == MODBUS_VIEW_MAIN ? currentDataType : (DataType)composeView;
+}
+
+static inline uint16_t* composeStaging() {
+    return composeView == MODBUS_VIEW_MAIN ? modbusStaging : modbusShadows[composeView].staging;
+}
+
+static inline void stageHreg(int reg, uint16_t value) {
+    if (reg >= 0 && reg < MODBUS_DIAG_BASE_REG) composeStaging()[reg] = value;
+}
+
+static bool lockModbusImage() {
+    return modbusImageMutex == NULL || xSemaphoreTake(modbusImageMutex, portMAX_DELAY) == pdTRUE;
+}
+
+static void unlockModbusImage() {
+    if (modbusImageMutex) xSemaphoreGive(modbusImageMutex);
+}
+
+static void initModbusImage() {
+    if (modbusImageMutex == NULL) modbusImageMutex = xSemaphoreCreateMutex();
+    // Punkt wyjścia dla porównań = stan rejestrów po inicjalizacji (rejestry kontrolne)
+    for (int reg = 0; reg < MODBUS_REG_TOTAL; reg++) {
+        modbusPublished[reg] = mb.hreg(reg);
+        if (reg < MODBUS_DIAG_BASE_REG) modbusStaging[reg] = modbusPublished[reg];
+    }
+}
+
+// Bank cienia nie ma kopii w rejestrach ModbusSerial - tylko obraz
+static void publishShadowBank(ModbusShadowView& shadow, int first, int count) {
+    if (!lockModbusImage()) return;
+    memcpy(shadow.published + first, shadow.staging + first, count * sizeof(uint16_t));
+    unlockModbusImage();
+}
+
+static void publishModbusBank(int first, int count) {
+    if (first + count > MODBUS_DIAG_BASE_REG) count = MODBUS_DIAG_BASE_REG - first;
+    if (composeView != MODBUS_VIEW_MAIN) {
+        publishShadowBank(modbusShadows[composeView], first, count);
+        return;
+    }
+    if (!lockModbusImage()) return;
+
+    uint32_t start = ESP.getCycleCount();
+    for (int reg = first; reg < first + count; reg++) {
+        if (modbusStaging[reg] == modbusPublished[reg]) continue;
+        mb.setHreg(reg, modbusStaging[reg]);
+        modbusPublished[reg] = modbusStaging[reg];
+        modbusPublishedWords++;
+    }
+    uint32_t cycles = ESP.getCycleCount() - start;
+    unlockModbusImage();
+
+    modbusPublishes++;
+    if (cycles > modbusPublishMaxCycles) modbusPublishMaxCycles = cycles;
+}
+
+// Odczyt banku cienia - zapamiętuje czytane banki, loop() odświeża tylko je
+static uint8_t readModbusShadow(uint16_t start, uint16_t count, uint16_t* out) {
+    uint16_t view = (start - MODBUS_SHADOW_BASE) / MODBUS_SHADOW_STRIDE;
+    uint16_t offset = (start - MODBUS_SHADOW_BASE) % MODBUS_SHADOW_STRIDE;
+    if (view >= MODBUS_SHADOW_VIEWS || (uint32_t)offset + count > MODBUS_SHADOW_SIZE) return MODBUS_EX_ILLEGAL_ADDRESS;
+
+    ModbusShadowView& shadow = modbusShadows[view];
+    uint32_t now = millis();
+    for (size_t b = 0; b < MAP_BANK_COUNT; b++) {
+        const ModbusBankDef& def = getModbusBankDef((ModbusMapBank)b);
+        if (def.base < offset + count && def.base + def.size > offset) shadow.lastRead[b] = now;
+    }
+
+    if (!lockModbusImage()) return MODBUS_EX_DEVICE_FAILURE;
+    if (shadow.published == NULL) {
+        // Pierwszy odczyt - zera do pierwszego odświeżenia w loop() (timestamp 0 w nagłówku)
+        uint16_t* image = (uint16_t*)calloc(2 * MODBUS_SHADOW_SIZE, sizeof(uint16_t));
+        if (image == NULL) {
+            unlockModbusImage();
+            return MODBUS_EX_DEVICE_FAILURE;
+        }
+        shadow.staging = image;
+        shadow.published = image + MODBUS_SHADOW_SIZE;
+    }
+    memcpy(out, shadow.published + offset, count * sizeof(uint16_t));
+    shadow.reads++;
+    unlockModbusImage();
+    return MODBUS_EX_NONE;
+}
+
+// Odczyt dla Modbus TCP - kopia z obrazu zamiast mb.hreg() (lista rejestrów biblioteki, O(n))
+uint8_t readModbusImage(uint16_t start, uint16_t count, uint16_t* out) {
+    if (!config.enableModbus) return MODBUS_EX_DEVICE_FAILURE;
+    if (start >= MODBUS_SHADOW_BASE) return readModbusShadow(start, count, out);
+    if ((uint32_t)start + count > MODBUS_REG_TOTAL) return MODBUS_EX_ILLEGAL_ADDRESS;
+    if (!lockModbusImage()) return MODBUS_EX_DEVICE_FAILURE;
+
+    memcpy(out, modbusPublished + start, count * sizeof(uint16_t));
+    // Rejestry kontrolne master RTU zapisuje bezpośrednio w mb - bez kopii w obrazie
+    for (int reg = MODBUS_BASE_CONTROL; reg < MODBUS_BASE_I2C; reg++) {
+        if (reg >= start && reg < start + count) out[reg - start] = mb.hreg(reg);
+    }
+    unlockModbusImage();
+    return MODBUS_EX_NONE;
+}
+
+// Wywołanie pod mutexem obrazu
+static void setImageRegisters(int first, int count, const uint16_t* values) {
+    for (int i = 0; i < count; i++) {
+        mb.setHreg(first + i, values[i]);
+        modbusPublished[first + i] = values[i];
+    }
+}
+
+// Zapis mastera RTU lub TCP (komendy i typ danych obsługuje processModbusTask)
+uint8_t writeModbusImage(uint16_t start, uint16_t count, const uint16_t* values) {
+    if (!config.enableModbus) return MODBUS_EX_DEVICE_FAILURE;
+    if ((uint32_t)start + count > MODBUS_REG_TOTAL) return MODBUS_EX_ILLEGAL_ADDRESS;
+    if (!lockModbusImage()) return MODBUS_EX_DEVICE_FAILURE;
+    setImageRegisters(start, count, values);
+    unlockModbusImage();
+
+    lastModbusActivity = millis();
+    hasHadModbusActivity = true;
+
+    // Zapytanie o historię - wynik gotowy przed odpowiedzią na zapis
+    if (start < MODBUS_HISTORY_BASE_REG + MB_HISTORY_QUERY_REGS && start + count > MODBUS_HISTORY_BASE_REG) {
+        runModbusHistoryQuery();
+    }
+    return MODBUS_EX_NONE;
+}
+
+// Wyszukiwanie poza mutexem - kopiuje rekordy z PSRAM
+static void runModbusHistoryQuery() {
+    uint16_t query[MB_HISTORY_QUERY_REGS];
+    uint16_t result[REG_COUNT_MODBUS_HISTORY];
+
+    if (!lockModbusImage()) return;
+    memcpy(query, modbusPublished + MODBUS_HISTORY_BASE_REG, sizeof(query));
+    unlockModbusImage();
+
+    evaluateModbusHistoryQuery(query, result);
+
+    if (!lockModbusImage()) return;
+    setImageRegisters(MODBUS_HISTORY_BASE_REG, REG_COUNT_MODBUS_HISTORY, result);
+    unlockModbusImage();
+}
+
+void getModbusImageStats(ModbusImageStats& stats) {
+    stats.publishes = modbusPublishes;
+    stats.words = modbusPublishedWords;
+    stats.maxLockCycles = modbusPublishMaxCycles;
+}
+
+// ===== Banki z tabeli rejestrów (modbus_map.cpp) =====
+
+// Dane według wybranego typu: aktualne, średnia 10 s lub 5 min
+template<typename T>
+static T selectModbusData(const T& current, T (*fastAverage)(), T (*slowAverage)()) {
+    switch (composeDataType()) {
+        case DATA_FAST_AVG: return fastAverage();
+        case DATA_SLOW_AVG: return slowAverage();
+        default:            return current;
+    }
+}
+
+// Nagłówek bloku (status, typ danych, timestamp) + pola z tabeli
+static void stageModbusBank(ModbusMapBank bank, bool status, const void* data) {
+    int baseReg = getModbusBankDef(bank).base;
+    unsigned long updateTime = millis();
+    stageHreg(baseReg, status ? 1 : 0);
+    stageHreg(baseReg + 1, (uint16_t)composeDataType());
+    stageHreg(baseReg + 2, updateTime & 0xFFFF);
+    stageHreg(baseReg + 3, (updateTime >> 16) & 0xFFFF);
+    stageModbusFields(bank, data, composeStaging());
+}
+
+static void publishModbusMapBank(ModbusMapBank bank) {
+    const ModbusBankDef& def = getModbusBankDef(bank);
+    publishModbusBank(def.base, def.size);
+}
+
 void updateModbusSolarRegisters() {
     if (!config.enableModbus || !config.enableSolarSensor) return;
     
     // Get appropriate data based on current selection
     SolarData dataToUse;
-    switch (currentDataType) {
+    switch (composeDataType()) {
         case DATA_CURRENT:
             dataToUse = solarData;
             break;
@@ -150,7 +429,7 @@ void updateModbusSolarRegisters() {
     
     // Header registers - nowy format
     modbusRegisters[0] = solarSensorStatus ? 1 : 0; // Status flag
-    modbusRegisters[1] = (uint16_t)currentDataType; // Typ danych (0=current, 1=fast avg, 2=slow avg)
+    modbusRegisters[1] = (uint16_t)composeDataType(); // Typ danych (0=current, 1=fast avg, 2=slow avg)
     
     // Timestamp aktualizacji danych (32-bit)
     unsigned long updateTime = millis();
@@ -180,8 +459,10 @@ void updateModbusSolarRegisters() {
     
     // Update Modbus holding registers
     for (int i = 0; i < REG_COUNT_SOLAR; i++) {
-        mb.setHreg(i, modbusRegisters[i]);
+        stageHreg(i, modbusRegisters[i]);
     }
+    
+    publishModbusMapBank(MAP_SOLAR);
 }
 
 void updateModbusOPCN3Registers() {
@@ -189,7 +470,7 @@ void updateModbusOPCN3Registers() {
     
     // Header registers - nowy format
     modbusRegistersOPCN3[0] = opcn3SensorStatus ? 1 : 0; // Status flag
-    modbusRegistersOPCN3[1] = (uint16_t)currentDataType; // Typ danych (0=current, 1=fast avg, 2=slow avg)
+    modbusRegistersOPCN3[1] = (uint16_t)composeDataType(); // Typ danych (0=current, 1=fast avg, 2=slow avg)
     
     // Timestamp aktualizacji danych (32-bit)
     unsigned long updateTime = millis();
@@ -236,631 +517,586 @@ void updateModbusOPCN3Registers() {
     
     // Update Modbus holding registers
     for (int i = 0; i < REG_COUNT_OPCN3; i++) {
-        mb.setHreg(REG_COUNT_SOLAR + i, modbusRegistersOPCN3[i]);
+        stageHreg(MODBUS_BASE_OPCN3 + i, modbusRegistersOPCN3[i]);
     }
+    
+    publishModbusMapBank(MAP_OPCN3);
 }
 
 void updateModbusI2CRegisters() {
     if (!config.enableModbus || !config.enableI2CSensors) return;
     
-    // Get appropriate data based on current selection
-    I2CSensorData dataToUse;
-    switch (currentDataType) {
-        case DATA_CURRENT:
-            dataToUse = i2cSensorData;
-            break;
-        case DATA_FAST_AVG:
-            dataToUse = getI2CFastAverage();
-            break;
-        case DATA_SLOW_AVG:
-            dataToUse = getI2CSlowAverage();
-            break;
-    }
-    
-    // Use dedicated I2C register block
-    int baseReg = REG_COUNT_SOLAR + REG_COUNT_OPCN3+3;
-    
-    // Header registers - nowy format
-    mb.setHreg(baseReg, i2cSensorStatus ? 1 : 0); // Status
-    mb.setHreg(baseReg + 1, (uint16_t)currentDataType); // Typ danych
-    
-    // Timestamp aktualizacji danych (32-bit)
-    unsigned long updateTime = millis();
-    mb.setHreg(baseReg + 2, updateTime & 0xFFFF); // Lower 16 bits
-    mb.setHreg(baseReg + 3, (updateTime >> 16) & 0xFFFF); // Upper 16 bits
+    I2CSensorData dataToUse = selectModbusData(i2cSensorData, getI2CFastAverage, getI2CSlowAverage);
+    int baseReg = MODBUS_BASE_I2C;
+    stageModbusBank(MAP_I2C, i2cSensorStatus, &dataToUse);
     
     if (dataToUse.valid) {
-        mb.setHreg(baseReg + 4, (int16_t)(dataToUse.temperature * 100)); // Temperature * 100
-        mb.setHreg(baseReg + 5, (uint16_t)(dataToUse.humidity * 100)); // Humidity * 100
-        mb.setHreg(baseReg + 6, (uint16_t)(dataToUse.pressure * 10)); // Pressure * 10
-        mb.setHreg(baseReg + 7, (uint16_t)(dataToUse.co2)); // CO2
-       // safePrintln("CO2: " + String(dataToUse.co2));
-        mb.setHreg(baseReg + 8, (uint16_t)dataToUse.type); // Sensor type
-        
         // Add current time and date from ESP32 built-in time functions
-        if (isTimeSet()) {
-            struct tm timeinfo;
-            if (getLocalTime(&timeinfo)) {
-                int hours = timeinfo.tm_hour;
-                int minutes = timeinfo.tm_min;
-                int day = timeinfo.tm_mday;
-                int month = timeinfo.tm_mon + 1;
-                int year = timeinfo.tm_year + 1900;
-                
-                mb.setHreg(baseReg + 9, (uint16_t)(hours * 100 + minutes)); // Time as HHMM
-                mb.setHreg(baseReg + 10, (uint16_t)(day * 100 + month)); // Date as DDMM
-                mb.setHreg(baseReg + 11, (uint16_t)year); // Year
-                mb.setHreg(baseReg + 12, (uint16_t)getEpochTime()); // Epoch time (lower 16 bits)
-                //network on flag 
-                mb.setHreg(baseReg + 13, turnOnNetwork ? 1 : 0);
-            } else {
-                // Fallback if getLocalTime fails
-                mb.setHreg(baseReg + 9, 1200); // 12:00
-                mb.setHreg(baseReg + 10, 1801);  // 18/01 (dzisiejszy dzien)
-                mb.setHreg(baseReg + 11, 2024); // 2024
-                mb.setHreg(baseReg + 12, 0); // No epoch time
-                mb.setHreg(baseReg + 13, turnOnNetwork ? 1 : 0); // No network on flag
-                //write netowrk data to modbus like netw
-            }
+        struct tm timeinfo;
+        if (isTimeSet() && getLocalTime(&timeinfo)) {
+            stageHreg(baseReg + 9, (uint16_t)(timeinfo.tm_hour * 100 + timeinfo.tm_min)); // Time as HHMM
+            stageHreg(baseReg + 10, (uint16_t)(timeinfo.tm_mday * 100 + timeinfo.tm_mon + 1)); // Date as DDMM
+            stageHreg(baseReg + 11, (uint16_t)(timeinfo.tm_year + 1900)); // Year
+            stageHreg(baseReg + 12, (uint16_t)getEpochTime()); // Epoch time (lower 16 bits)
         } else {
             // Default time and date if time not synchronized
-            mb.setHreg(baseReg + 9, 1200); // 12:00
-            mb.setHreg(baseReg + 10, 1801);  // 18/01 (dzisiejszy dzien)
-            mb.setHreg(baseReg + 11, 2024); // 2024
-            mb.setHreg(baseReg + 12, 0); // No epoch time
-            mb.setHreg(baseReg + 13, turnOnNetwork ? 1 : 0); // No network on flag
+            stageHreg(baseReg + 9, 1200); // 12:00
+            stageHreg(baseReg + 10, 1801);  // 18/01
+            stageHreg(baseReg + 11, 2024); // 2024
+            stageHreg(baseReg + 12, 0); // No epoch time
         }
+        stageHreg(baseReg + 13, turnOnNetwork ? 1 : 0); // Network on flag
     } else {
-        // Clear data registers if invalid
-        for (int i = 4; i < 14; i++) {
-            mb.setHreg(baseReg + i, 0);
+        for (int i = 9; i < 14; i++) {
+            stageHreg(baseReg + i, 0);
         }
     }
+    
+    publishModbusMapBank(MAP_I2C);
 }
 
 void updateModbusMCP3424Registers() {
-    if (!config.enableModbus || !config.enableMCP3424) {
-        // safePrint("MCP3424 Modbus update skipped - Modbus: ");
-        // safePrint(config.enableModbus ? "ON" : "OFF");
-        // safePrint(", MCP3424: ");
-        // safePrintln(config.enableMCP3424 ? "ON" : "OFF");
-        return;
-    }
+    if (!config.enableModbus || !config.enableMCP3424) return;
     
-    // Get appropriate data based on current selection
-    MCP3424Data dataToUse;
-    switch (currentDataType) {
-        case DATA_CURRENT:
-            dataToUse = mcp3424Data;
-            break;
-        case DATA_FAST_AVG:
-            dataToUse = getMCP3424FastAverage();
-            break;
-        case DATA_SLOW_AVG:
-            dataToUse = getMCP3424SlowAverage();
-            break;
-    }
-    
-    // Use registers after IPS data for MCP3424 ADC data
-    int baseReg = REG_COUNT_SOLAR + REG_COUNT_OPCN3 + REG_COUNT_I2C + REG_COUNT_IPS;
-    
-    // Header registers - nowy format
-    mb.setHreg(baseReg, mcp3424SensorStatus ? 1 : 0); // Status
-    mb.setHreg(baseReg + 1, (uint16_t)currentDataType); // Typ danych
-    
-    // Timestamp aktualizacji danych (32-bit)
-    unsigned long updateTime = millis();
-    mb.setHreg(baseReg + 2, updateTime & 0xFFFF); // Lower 16 bits
-    mb.setHreg(baseReg + 3, (updateTime >> 16) & 0xFFFF); // Upper 16 bits
-    
-    // Total device count
-    mb.setHreg(baseReg + 4, dataToUse.deviceCount);
-    
-    // Process each detected device - zaczynamy od rejestru 5
-    for (uint8_t device = 0; device < dataToUse.deviceCount && device < MAX_MCP3424_DEVICES; device++) {
-        int deviceBaseReg = baseReg + 5 + device * 16;  // Start from baseReg+5, each device gets 16 registers
-        
-        mb.setHreg(deviceBaseReg, dataToUse.valid[device] ? 1 : 0); // Status
-        mb.setHreg(deviceBaseReg + 1, (uint16_t)dataToUse.addresses[device]); // I2C Address
-        mb.setHreg(deviceBaseReg + 2, (uint16_t)dataToUse.resolution); // Resolution
-        mb.setHreg(deviceBaseReg + 3, (uint16_t)dataToUse.gain); // Gain
-        
-        if (dataToUse.valid[device]) {
-            // Store channels as signed 32-bit values (voltage * 1000000 for µV precision)
-            for (int ch = 0; ch < 4; ch++) {
-                int32_t voltage_uv = (int32_t)(dataToUse.channels[device][ch] * 1000000);
-                mb.setHreg(deviceBaseReg + 4 + ch*2, voltage_uv & 0xFFFF);         // Lower 16 bits
-                mb.setHreg(deviceBaseReg + 5 + ch*2, (voltage_uv >> 16) & 0xFFFF); // Upper 16 bits
-            }
-            mb.setHreg(deviceBaseReg + 12, (uint16_t)((millis() - dataToUse.lastUpdate) / 1000)); // Age in seconds
-        } else {
-            // Clear data registers if invalid
-            for (int i = 4; i < 16; i++) {
-                mb.setHreg(deviceBaseReg + i, 0);
-            }
-        }
-    }
+    MCP3424Data dataToUse = selectModbusData(mcp3424Data, getMCP3424FastAverage, getMCP3424SlowAverage);
+    stageModbusBank(MAP_MCP3424, mcp3424SensorStatus, &dataToUse);
     
-    // Clear unused device registers
+    // Clear unused device registers (16 per device from offset 5)
     for (uint8_t device = dataToUse.deviceCount; device < MAX_MCP3424_DEVICES; device++) {
-        int deviceBaseReg = baseReg + 5 + device * 16;
+        int deviceBaseReg = MODBUS_BASE_MCP3424 + 5 + device * 16;
         for (int i = 0; i < 16; i++) {
-            mb.setHreg(deviceBaseReg + i, 0);
+            stageHreg(deviceBaseReg + i, 0);
         }
     }
+    
+    publishModbusMapBank(MAP_MCP3424);
 }
 
 void updateModbusADS1110Registers() {
     if (!config.enableModbus || !config.enableADS1110) return;
     
-    // Get appropriate data based on current selection
-    ADS1110Data dataToUse;
-    switch (currentDataType) {
-        case DATA_CURRENT:
-            dataToUse = ads1110Data;
-            break;
-        case DATA_FAST_AVG:
-            dataToUse = getADS1110FastAverage();
-            break;
-        case DATA_SLOW_AVG:
-            dataToUse = getADS1110SlowAverage();
-            break;
-    }
-    
-    // Use registers after MCP3424 data for ADS1110 data
-    int baseReg = REG_COUNT_SOLAR + REG_COUNT_OPCN3 + REG_COUNT_I2C + REG_COUNT_IPS + REG_COUNT_MCP3424;
-    
-    // Header registers - nowy format
-    mb.setHreg(baseReg, ads1110SensorStatus ? 1 : 0); // Status
-    mb.setHreg(baseReg + 1, (uint16_t)currentDataType); // Typ danych
-    
-    // Timestamp aktualizacji danych (32-bit)
-    unsigned long updateTime = millis();
-    mb.setHreg(baseReg + 2, updateTime & 0xFFFF); // Lower 16 bits
-    mb.setHreg(baseReg + 3, (updateTime >> 16) & 0xFFFF); // Upper 16 bits
-    
-    mb.setHreg(baseReg + 4, (uint16_t)dataToUse.dataRate); // Data rate
-    mb.setHreg(baseReg + 5, (uint16_t)dataToUse.gain); // Gain
-    
-    if (dataToUse.valid) {
-        // Store voltage as signed 32-bit value (voltage * 1000000 for uV precision)
-        int32_t voltage_uv = (int32_t)(dataToUse.voltage * 1000000);
-        mb.setHreg(baseReg + 6, voltage_uv & 0xFFFF);         // Lower 16 bits
-        mb.setHreg(baseReg + 7, (voltage_uv >> 16) & 0xFFFF); // Upper 16 bits
-        mb.setHreg(baseReg + 8, (uint16_t)((millis() - dataToUse.lastUpdate) / 1000)); // Age in seconds
-    } else {
-        // Clear data registers if invalid
-        for (int i = 6; i < 9; i++) {
-            mb.setHreg(baseReg + i, 0);
-        }
-    }
+    ADS1110Data dataToUse = selectModbusData(ads1110Data, getADS1110FastAverage, getADS1110SlowAverage);
+    stageModbusBank(MAP_ADS1110, ads1110SensorStatus, &dataToUse);
+    publishModbusMapBank(MAP_ADS1110);
 }
 
 void updateModbusINA219Registers() {
     if (!config.enableModbus || !config.enableINA219) return;
     
-    // Get appropriate data based on current selection
-    INA219Data dataToUse;
-    switch (currentDataType) {
-        case DATA_CURRENT:
-            dataToUse = ina219Data;
-            break;
-        case DATA_FAST_AVG:
-            dataToUse = getINA219FastAverage();
-            break;
-        case DATA_SLOW_AVG:
-            dataToUse = getINA219SlowAverage();
-            break;
-    }
-   
-    // Use registers after ADS1110 data for INA219 data
-    int baseReg = REG_COUNT_SOLAR + REG_COUNT_OPCN3 + REG_COUNT_I2C + REG_COUNT_IPS + REG_COUNT_MCP3424 + REG_COUNT_ADS1110;
-    
-    // Header registers - nowy format
-    mb.setHreg(baseReg, ina219SensorStatus ? 1 : 0); // Status
-    mb.setHreg(baseReg + 1, (uint16_t)currentDataType); // Typ danych
+    INA219Data dataToUse = selectModbusData(ina219Data, getINA219FastAverage, getINA219SlowAverage);
+    int baseReg = MODBUS_BASE_INA219;
+    stageModbusBank(MAP_INA219, ina219SensorStatus, &dataToUse);
     
-    // Timestamp aktualizacji danych (32-bit)
-    unsigned long updateTime = millis();
-    mb.setHreg(baseReg + 2, updateTime & 0xFFFF); // Lower 16 bits
-    mb.setHreg(baseReg + 3, (updateTime >> 16) & 0xFFFF); // Upper 16 bits
+    // Battery flags (batteryData)
+    stageHreg(baseReg + 9, dataToUse.valid && batteryData.isBatteryPowered ? 1 : 0);
+    stageHreg(baseReg + 10, dataToUse.valid && batteryData.lowBattery ? 1 : 0);
+    stageHreg(baseReg + 11, dataToUse.valid && batteryData.criticalBattery ? 1 : 0);
     
-    if (dataToUse.valid) {
-        // Bus voltage (mV precision)
-        mb.setHreg(baseReg + 4, (uint16_t)(dataToUse.busVoltage * 1000));
-        // Shunt voltage (already in mV)
-        mb.setHreg(baseReg + 5, (uint16_t)(dataToUse.shuntVoltage * 10)); // 0.1mV precision
-        // Current (mA precision)
-        mb.setHreg(baseReg + 6, (uint16_t)(dataToUse.current));
-        // Power (mW precision)
-        mb.setHreg(baseReg + 7, (uint16_t)(dataToUse.power));
-        mb.setHreg(baseReg + 8, (uint16_t)((millis() - dataToUse.lastUpdate) / 1000)); // Age in seconds
-        //use battery data
-     
-        mb.setHreg(baseReg + 9, batteryData.isBatteryPowered ? 1 : 0);
-        mb.setHreg(baseReg + 10, batteryData.lowBattery ? 1 : 0);
-        mb.setHreg(baseReg + 11, batteryData.criticalBattery ? 1 : 0);
-    
-   
-    } else {
-        // Clear data registers if invalid
-        for (int i = 4; i < 12; i++) {
-            mb.setHreg(baseReg + i, 0);
-        }
-    }
+    publishModbusMapBank(MAP_INA219);
 }
 
 void updateModbusSPS30Registers() {
-    if (!config.enableModbus || !config.enableSPS30) {
-        // safePrint("SPS30 Modbus update skipped - Modbus: ");
-        // safePrint(config.enableModbus ? "ON" : "OFF");
-        // safePrint(", SPS30: ");
-        // safePrintln(config.enableSPS30 ? "ON" : "OFF");
-        return;
-    }
-    
-    // Get appropriate data based on current selection
-    SPS30Data dataToUse;
-    switch (currentDataType) {
-        case DATA_CURRENT:
-            dataToUse = sps30Data;
-            break;
-        case DATA_FAST_AVG:
-            dataToUse = getSPS30FastAverage();
-            break;
-        case DATA_SLOW_AVG:
-            dataToUse = getSPS30SlowAverage();
-            break;
-    }
-    
-    // Debug output every 30 seconds
-    // static unsigned long lastSPS30ModbusDebug = 0;
-    // if (millis() - lastSPS30ModbusDebug > 30000) {
-    //     lastSPS30ModbusDebug = millis();
-    //     safePrint("Updating SPS30 Modbus registers - Status: ");
-    //     safePrint(sps30SensorStatus ? "OK" : "ERROR");
-    //     safePrint(", Valid: ");
-    //     safePrintln(dataToUse.valid ? "true" : "false");
-    // }
-    
-    // Use registers after INA219 data for SPS30 data
-    int baseReg = REG_COUNT_SOLAR + REG_COUNT_OPCN3 + REG_COUNT_I2C + REG_COUNT_IPS + REG_COUNT_MCP3424 + REG_COUNT_ADS1110 + REG_COUNT_INA219;
+    if (!config.enableModbus || !config.enableSPS30) return;
     
-    // Header registers - nowy format
-    mb.setHreg(baseReg, sps30SensorStatus ? 1 : 0); // Status
-    mb.setHreg(baseReg + 1, (uint16_t)currentDataType); // Typ danych
-    
-    // Timestamp aktualizacji danych (32-bit)
-    unsigned long updateTime = millis();
-    mb.setHreg(baseReg + 2, updateTime & 0xFFFF); // Lower 16 bits
-    mb.setHreg(baseReg + 3, (updateTime >> 16) & 0xFFFF); // Upper 16 bits
-    
-    if (dataToUse.valid) {
-        mb.setHreg(baseReg + 4, (uint16_t)(dataToUse.pm1_0 * 1000)); // PM1.0 * 1000
-        mb.setHreg(baseReg + 5, (uint16_t)(dataToUse.pm2_5 * 1000)); // PM2.5 * 1000
-        mb.setHreg(baseReg + 6, (uint16_t)(dataToUse.pm4_0 * 1000)); // PM4.0 * 1000
-        mb.setHreg(baseReg + 7, (uint16_t)(dataToUse.pm10 * 1000)); // PM10 * 1000
-        mb.setHreg(baseReg + 8, (uint16_t)(dataToUse.nc0_5 * 1000)); // NC0.5 * 1000
-        mb.setHreg(baseReg + 9, (uint16_t)(dataToUse.nc1_0 * 1000)); // NC1.0 * 1000
-        mb.setHreg(baseReg + 10, (uint16_t)(dataToUse.nc2_5 * 1000)); // NC2.5 * 1000
-        mb.setHreg(baseReg + 11, (uint16_t)(dataToUse.nc4_0 * 1000)); // NC4.0 * 1000
-        mb.setHreg(baseReg + 12, (uint16_t)(dataToUse.nc10 * 1000)); // NC10 * 1000
-        mb.setHreg(baseReg + 13, (uint16_t)(dataToUse.typical_particle_size * 1000)); // Typical particle size * 1000
-        mb.setHreg(baseReg + 14, (uint16_t)((millis() - dataToUse.lastUpdate) / 1000)); // Age in seconds
-    } else {
-        // Clear data registers if invalid
-        for (int i = 4; i < 15; i++) {
-            mb.setHreg(baseReg + i, 0);
-        }
-    }
+    SPS30Data dataToUse = selectModbusData(sps30Data, getSPS30FastAverage, getSPS30SlowAverage);
+    stageModbusBank(MAP_SPS30, sps30SensorStatus, &dataToUse);
+    publishModbusMapBank(MAP_SPS30);
 }
 
 void updateModbusIPSRegisters() {
     if (!config.enableModbus || !config.enableIPS) return;
     
-    // Get appropriate data based on current selection
-    IPSSensorData dataToUse;
-    switch (currentDataType) {
-        case DATA_CURRENT:
-            dataToUse = ipsSensorData;
-            break;
-        case DATA_FAST_AVG:
-            dataToUse = getIPSFastAverage();
-            break;
-        case DATA_SLOW_AVG:
-            dataToUse = getIPSSlowAverage();
-            break;
-    }
-    
-    // Use registers after I2C data for IPS sensor data
-    int baseReg = REG_COUNT_SOLAR + REG_COUNT_OPCN3 + REG_COUNT_I2C;
-    
-    // Header registers - nowy format
-    modbusRegistersIPS[0] = ipsSensorStatus ? 1 : 0; // Status flag
-    modbusRegistersIPS[1] = (uint16_t)currentDataType; // Typ danych
+    IPSSensorData dataToUse = selectModbusData(ipsSensorData, getIPSFastAverage, getIPSSlowAverage);
+    // PM (20-26) zawsze z bieżącego odczytu, także przy średnich - PC/NP/PW wg currentDataType
+    memcpy(dataToUse.pm_values, ipsSensorData.pm_values, sizeof(dataToUse.pm_values));
+    int baseReg = MODBUS_BASE_IPS;
+    stageModbusBank(MAP_IPS, ipsSensorStatus, &dataToUse);
     
-    // Timestamp aktualizacji danych (32-bit)
-    unsigned long updateTime = millis();
-    modbusRegistersIPS[2] = updateTime & 0xFFFF; // Lower 16 bits
-    modbusRegistersIPS[3] = (updateTime >> 16) & 0xFFFF; // Upper 16 bits
-    
-    modbusRegistersIPS[4] = dataToUse.debugMode ? 1 : 0; // Debug mode flag
-    modbusRegistersIPS[5] = dataToUse.won; // Won period (1=200ms, 2=500ms, 3=1000ms)
-    
-    if (dataToUse.valid && ipsSensorStatus) {
-        // PC Values (7 values) - registers 6-19
-        for (int i = 0; i < 7; i++) {
-            uint32_t pcValue = dataToUse.pc_values[i];
-            // Store as two 16-bit registers for large values
-            modbusRegistersIPS[6 + i*2] = pcValue & 0xFFFF;         // Lower 16 bits
-            modbusRegistersIPS[6 + i*2 + 1] = (pcValue >> 16) & 0xFFFF; // Upper 16 bits
-        }
-        
-        // PM Values (7 values) - registers 20-26 (scaled by 1000 for precision)
-        for (int i = 0; i < 7; i++) {
-            modbusRegistersIPS[20 + i] = (uint16_t)(ipsSensorData.pm_values[i] * 10);
-        }
-        
-        // Debug mode data (only if debug mode enabled)
-        if (dataToUse.debugMode) {
-            // NP Values (7 values) - registers 27-40
-            for (int i = 0; i < 7; i++) {
-                uint32_t npValue = dataToUse.np_values[i];
-                // Store as two 16-bit registers for large values
-                modbusRegistersIPS[27 + i*2] = npValue & 0xFFFF;         // Lower 16 bits
-                modbusRegistersIPS[27 + i*2 + 1] = (npValue >> 16) & 0xFFFF; // Upper 16 bits
-            }
-            
-            // PW Values (7 values) - registers 41-47
-            for (int i = 0; i < 7; i++) {
-                modbusRegistersIPS[41 + i] = (uint16_t)dataToUse.pw_values[i];
-            }
-        } else {
-            // Clear debug registers when not in debug mode
-            for (int i = 27; i < 48; i++) {
-                modbusRegistersIPS[i] = 0;
-            }
-        }
-        
-        // Debug: Print IPS data every 30 seconds
-        static unsigned long lastIPSPrint = 0;
-        if (millis() - lastIPSPrint > 30000) {
-            lastIPSPrint = millis();
-            // safePrint("IPS Modbus Update - Status: ");
-            // safePrint(ipsSensorStatus ? "OK" : "ERROR");
-            // safePrint(", Valid: ");
-            // safePrint(ipsSensorData.valid ? "YES" : "NO");
-            // safePrint(", Debug: ");
-            // safePrint(ipsSensorData.debugMode ? "ON" : "OFF");
-            // safePrint(", Won: ");
-            // safePrint(String(ipsSensorData.won));
-            // safePrint(", PC0: ");
-            // safePrint(String(ipsSensorData.pc_values[0]));
-            // safePrint(", PM0: ");
-            // safePrint(String(ipsSensorData.pm_values[0], 3));
-            // if (ipsSensorData.debugMode) {
-            //     safePrint(", NP0: ");
-            //     safePrint(String(ipsSensorData.np_values[0]));
-            //     safePrint(", PW0: ");
-            //     safePrint(String(ipsSensorData.pw_values[0]));
-            // }
-            // safePrintln("");
-        }
-    } else {
+    if (!dataToUse.valid || !ipsSensorStatus) {
         // Clear data registers if invalid
         for (int i = 6; i < REG_COUNT_IPS; i++) {
-            modbusRegistersIPS[i] = 0;
+            stageHreg(baseReg + i, 0);
+        }
+    } else if (!dataToUse.debugMode) {
+        // NP/PW (27-47) only in debug mode
+        for (int i = 27; i < 48; i++) {
+            stageHreg(baseReg + i, 0);
         }
     }
     
-    // Update Modbus holding registers - ensure all registers are updated
-    for (int i = 0; i < REG_COUNT_IPS; i++) {
-        mb.setHreg(baseReg + i, modbusRegistersIPS[i]);
-    }
+    publishModbusMapBank(MAP_IPS);
 }
 
 void updateModbusSHT40Registers() {
     if (!config.enableModbus || !config.enableSHT40) return;
     
-    // Get appropriate data based on current selection
-    SHT40Data dataToUse;
-    switch (currentDataType) {
-        case DATA_CURRENT:
-            dataToUse = sht40Data;
-            break;
-        case DATA_FAST_AVG:
-            dataToUse = getSHT40FastAverage();
-            break;
-        case DATA_SLOW_AVG:
-            dataToUse = getSHT40SlowAverage();
-            break;
-    }
-    
-    // Use registers after SPS30 data for SHT40 data
-    int baseReg = REG_COUNT_SOLAR + REG_COUNT_OPCN3 + REG_COUNT_I2C + REG_COUNT_IPS + REG_COUNT_MCP3424 + REG_COUNT_ADS1110 + REG_COUNT_INA219 + REG_COUNT_SPS30;
-    
-    // Header registers - nowy format
-    mb.setHreg(baseReg, sht40SensorStatus ? 1 : 0); // Status
-    mb.setHreg(baseReg + 1, (uint16_t)currentDataType); // Typ danych
-    
-    // Timestamp aktualizacji danych (32-bit)
-    unsigned long updateTime = millis();
-    mb.setHreg(baseReg + 2, updateTime & 0xFFFF); // Lower 16 bits
-    mb.setHreg(baseReg + 3, (updateTime >> 16) & 0xFFFF); // Upper 16 bits
-    
-    if (dataToUse.valid) {
-        // Temperature (x100 for 0.01°C precision)
-        mb.setHreg(baseReg + 4, (int16_t)(dataToUse.temperature * 100));
-        // Humidity (x100 for 0.01% precision)
-        mb.setHreg(baseReg + 5, (uint16_t)(dataToUse.humidity * 100));
-        // Pressure (x10 for 0.1 hPa precision)
-        mb.setHreg(baseReg + 6, (uint16_t)(dataToUse.pressure * 10));
-        // Age in seconds
-        mb.setHreg(baseReg + 7, (uint16_t)((millis() - dataToUse.lastUpdate) / 1000));
-    } else {
-        // Clear data registers if invalid
-        for (int i = 4; i < 8; i++) {
-            mb.setHreg(baseReg + i, 0);
-        }
-    }
-    
-    // Debug output every 30 seconds
-    static unsigned long lastSHT40ModbusDebug = 0;
-    // if (millis() - lastSHT40ModbusDebug > 30000) {
-    //     lastSHT40ModbusDebug = millis();
-    //     safePrint("Updating SHT40 Modbus registers - Status: ");
-    //     safePrint(sht40SensorStatus ? "OK" : "ERROR");
-    //     safePrint(", Valid: ");
-    //     safePrint(dataToUse.valid ? "true" : "false");
-    //     if (dataToUse.valid) {
-    //         safePrint(", Temp: ");
-    //         safePrint(String(dataToUse.temperature, 2));
-    //         safePrint("°C, Hum: ");
-    //         safePrint(String(dataToUse.humidity, 2));
-    //         safePrint("%, Press: ");
-    //         safePrint(String(dataToUse.pressure, 2));
-    //         safePrint(" kPa");
-    //     }
-    //     safePrintln("");
-    // }
+    SHT40Data dataToUse = selectModbusData(sht40Data, getSHT40FastAverage, getSHT40SlowAverage);
+    stageModbusBank(MAP_SHT40, sht40SensorStatus, &dataToUse);
+    publishModbusMapBank(MAP_SHT40);
 }
 
 void updateModbusHCHORegisters() {
     if (!config.enableModbus || !config.enableHCHO) return;
     
-    // Get appropriate data based on current selection
-    HCHOData dataToUse;
-    switch (currentDataType) {
-        case DATA_CURRENT:
-            dataToUse = hchoData;
-            break;
-        case DATA_FAST_AVG:
-            dataToUse = getHCHOFastAverage();
-            break;
-        case DATA_SLOW_AVG:
-            dataToUse = getHCHOSlowAverage();
-            break;
-    }
-    
-    // Use registers after SHT40 data for HCHO data
-    int baseReg = REG_COUNT_SOLAR + REG_COUNT_OPCN3 + REG_COUNT_I2C + REG_COUNT_IPS + REG_COUNT_MCP3424 + REG_COUNT_ADS1110 + REG_COUNT_INA219 + REG_COUNT_SPS30 + REG_COUNT_SHT40;
-    
-    // Header registers - nowy format
-    mb.setHreg(baseReg, hchoSensorStatus ? 1 : 0); // Status
-    mb.setHreg(baseReg + 1, (uint16_t)currentDataType); // Typ danych
-    
-    // Timestamp aktualizacji danych (32-bit)
-    unsigned long updateTime = millis();
-    mb.setHreg(baseReg + 2, updateTime & 0xFFFF); // Lower 16 bits
-    mb.setHreg(baseReg + 3, (updateTime >> 16) & 0xFFFF); // Upper 16 bits
-    
-    if (dataToUse.valid) {
-        // HCHO concentration (x1000 for 0.001 mg/m³ precision) - primary measurement
-        mb.setHreg(baseReg + 4, (uint16_t)(dataToUse.hcho * 1000));
-        // Age in seconds
-        mb.setHreg(baseReg + 5, (uint16_t)((millis() - dataToUse.lastUpdate) / 1000));
-    } else {
-        // Clear data registers if invalid
-        for (int i = 4; i < 6; i++) {
-            mb.setHreg(baseReg + i, 0);
-        }
-    }
-    
-    // Debug output every 30 seconds
-    // static unsigned long lastHCHOModbusDebug = 0;
-    // if (millis() - lastHCHOModbusDebug > 30000) {
-    //     lastHCHOModbusDebug = millis();
-    //     safePrint("Updating HCHO Modbus registers - Status: ");
-    //     safePrint(hchoSensorStatus ? "OK" : "ERROR");
-    //     safePrint(", Valid: ");
-    //     safePrint(dataToUse.valid ? "true" : "false");
-    //     if (dataToUse.valid) {
-    //         safePrint(", HCHO: ");
-    //         safePrint(String(dataToUse.hcho, 3));
-    //         safePrint(" mg/m³");
-    //     }
-    //     safePrintln("");
-    // }
+    HCHOData dataToUse = selectModbusData(hchoData, getHCHOFastAverage, getHCHOSlowAverage);
+    stageModbusBank(MAP_HCHO, hchoSensorStatus, &dataToUse);
+    publishModbusMapBank(MAP_HCHO);
 }
 
 void updateModbusCalibrationRegisters() {
     if (!config.enableModbus || !calibConfig.enableCalibration) return;
     
-    // Get appropriate data based on current selection
-    CalibratedSensorData dataToUse = calibratedData;
-    switch (currentDataType) {
-        case DATA_CURRENT:
-            dataToUse = calibratedData;
+    CalibratedSensorData dataToUse = selectModbusData(calibratedData, getCalibratedFastAverage, getCalibratedSlowAverage);
+    stageModbusBank(MAP_CALIBRATION, calibConfig.enableCalibration, &dataToUse);
+    publishModbusMapBank(MAP_CALIBRATION);
+}
+
+// ===== Odświeżanie banków rejestrów według zmian danych =====
+// Klucz banku = odcisk danych źródłowych: status, DataType oraz lastUpdate odczytu
+// (DATA_CURRENT) albo generacja średnich (DATA_FAST_AVG/DATA_SLOW_AVG). Bank jest
+// przepisywany tylko gdy klucz się zmieni - bez zmian pętla nie dotyka rejestrów.
+
+typedef bool (*ModbusBankActive)();
+typedef uint32_t (*ModbusBankKey)();
+
+struct ModbusBank {
+    const char* name;
+    ModbusMapBank map;
+    ModbusBankActive active;
+    ModbusBankKey key;
+    void (*update)();
+};
+
+#define MODBUS_BANK_COUNT 11
+#define MODBUS_BANK_HCHO 8        // indeks w modbusBanks
+
+static uint32_t bankKeys[MODBUS_BANK_COUNT];
+static bool bankWritten[MODBUS_BANK_COUNT];
+static uint32_t bankRefreshes[MODBUS_BANK_COUNT];
+static uint32_t bankSkips[MODBUS_BANK_COUNT];
+static uint64_t bankCycles[MODBUS_BANK_COUNT];
+static uint32_t modbusUpdatePasses = 0;
+static uint32_t shadowKeys[MODBUS_SHADOW_VIEWS][MODBUS_BANK_COUNT];   // klucze banków cienia, jak bankKeys
+static bool shadowWritten[MODBUS_SHADOW_VIEWS][MODBUS_BANK_COUNT];
+
+static uint32_t bankSourceKey(bool status, bool valid, unsigned long lastUpdate) {
+    uint32_t hash = fnv1aMix(FNV1A_OFFSET_BASIS, composeDataType());
+    hash = fnv1aMix(hash, status);
+    hash = fnv1aMix(hash, valid);
+    return fnv1aMix(hash, composeDataType() == DATA_CURRENT ? lastUpdate : getAveragesGeneration());
+}
+
+// Banki z rejestrem wieku danych / zegara zmieniają się co sekundę
+static uint32_t withSecondTick(uint32_t hash) {
+    return fnv1aMix(hash, millis() / 1000);
+}
+
+static uint32_t keySolar() {
+    return bankSourceKey(solarSensorStatus, solarData.valid, solarData.lastUpdate);
+}
+
+static uint32_t keyOPCN3() {
+    // Brak znacznika czasu w HistogramData - odcisk z publikowanych wartości
+    uint32_t hash = fnv1aMix(FNV1A_OFFSET_BASIS, composeDataType());
+    hash = fnv1aMix(hash, opcn3SensorStatus);
+    hash = fnv1aMix(hash, opcn3Data.valid);
+    hash = fnv1aMixFloat(hash, opcn3Data.pm1);
+    hash = fnv1aMixFloat(hash, opcn3Data.pm2_5);
+    hash = fnv1aMixFloat(hash, opcn3Data.pm10);
+    hash = fnv1aMixFloat(hash, opcn3Data.getTempC());
+    hash = fnv1aMixFloat(hash, opcn3Data.getHumidity());
+    for (int i = 0; i < 24; i++) {
+        hash = fnv1aMix(hash, opcn3Data.binCounts[i]);
+    }
+    return hash;
+}
+
+static uint32_t keyI2C() {
+    // Rejestry czasu (HHMM, data, epoch) - sekunda + flaga sieci
+    uint32_t hash = bankSourceKey(i2cSensorStatus, i2cSensorData.valid, i2cSensorData.lastUpdate);
+    hash = fnv1aMix(hash, turnOnNetwork);
+    return withSecondTick(hash);
+}
+
+static uint32_t keyMCP3424() {
+    return withSecondTick(bankSourceKey(mcp3424SensorStatus, true, mcp3424Data.lastUpdate));
+}
+
+static uint32_t keyADS1110() {
+    return withSecondTick(bankSourceKey(ads1110SensorStatus, ads1110Data.valid, ads1110Data.lastUpdate));
+}
+
+static uint32_t keyINA219() {
+    uint32_t hash = bankSourceKey(ina219SensorStatus, ina219Data.valid, ina219Data.lastUpdate);
+    hash = fnv1aMix(hash, batteryData.isBatteryPowered | (batteryData.lowBattery << 1) | (batteryData.criticalBattery << 2));
+    return withSecondTick(hash);
+}
+
+static uint32_t keySHT40() {
+    return withSecondTick(bankSourceKey(sht40SensorStatus, sht40Data.valid, sht40Data.lastUpdate));
+}
+
+static uint32_t keyIPS() {
+    // PM zawsze z bieżącego odczytu (także przy średnich)
+    uint32_t hash = bankSourceKey(ipsSensorStatus, ipsSensorData.valid, ipsSensorData.lastUpdate);
+    hash = fnv1aMix(hash, ipsSensorData.lastUpdate);
+    hash = fnv1aMix(hash, ipsSensorData.debugMode);
+    return fnv1aMix(hash, ipsSensorData.won);
+}
+
+static uint32_t keyHCHO() {
+    return withSecondTick(bankSourceKey(hchoSensorStatus, hchoData.valid, hchoData.lastUpdate));
+}
+
+static uint32_t keySPS30() {
+    return withSecondTick(bankSourceKey(sps30SensorStatus, sps30Data.valid, sps30Data.lastUpdate));
+}
+
+static uint32_t keyCalibration() {
+    // Bank kalibracji zaczyna się pod tym samym adresem co HCHO - po każdym
+    // odświeżeniu HCHO przepisywany ponownie, żeby jak dotąd jego wartości wygrywały
+    uint32_t hash = bankSourceKey(calibConfig.enableCalibration, calibratedData.valid, calibratedData.lastUpdate);
+    return fnv1aMix(hash, composeView == MODBUS_VIEW_MAIN ? bankKeys[MODBUS_BANK_HCHO] : shadowKeys[composeView][MODBUS_BANK_HCHO]);
+}
+
+// Kolejność jak dotychczasowe wywołania w loop()
+static const ModbusBank modbusBanks[] = {
+    {"solar",       MAP_SOLAR,       []() { return solarSensorStatus; },   keySolar,       updateModbusSolarRegisters},
+    {"opcn3",       MAP_OPCN3,       []() { return opcn3SensorStatus; },   keyOPCN3,       updateModbusOPCN3Registers},
+    {"i2c",         MAP_I2C,         []() { return i2cSensorStatus; },     keyI2C,         updateModbusI2CRegisters},
+    {"mcp3424",     MAP_MCP3424,     []() { return mcp3424SensorStatus; }, keyMCP3424,     updateModbusMCP3424Registers},
+    {"ads1110",     MAP_ADS1110,     []() { return ads1110SensorStatus; }, keyADS1110,     updateModbusADS1110Registers},
+    {"ina219",      MAP_INA219,      []() { return ina219SensorStatus; },  keyINA219,      updateModbusINA219Registers},
+    {"sht40",       MAP_SHT40,       []() { return sht40SensorStatus; },   keySHT40,       updateModbusSHT40Registers},
+    {"ips",         MAP_IPS,         []() { return ipsSensorStatus; },     keyIPS,         updateModbusIPSRegisters},
+    {"hcho",        MAP_HCHO,        []() { return hchoSensorStatus; },    keyHCHO,        updateModbusHCHORegisters},
+    {"sps30",       MAP_SPS30,       []() { return sps30SensorStatus; },   keySPS30,       updateModbusSPS30Registers},
+    {"calibration", MAP_CALIBRATION, []() { return calibConfig.enableCalibration && calibratedData.valid; },
+                                                                           keyCalibration, updateModbusCalibrationRegisters},
+};
+
+static_assert(sizeof(modbusBanks) / sizeof(modbusBanks[0]) == MODBUS_BANK_COUNT, "modbusBanks size");
+
+static bool shadowBankRead(const ModbusShadowView& shadow, ModbusMapBank map, uint32_t now) {
+    uint32_t lastRead = shadow.lastRead[map];
+    return lastRead != 0 && now - lastRead < MODBUS_SHADOW_HOLD;
+}
+
+// Banki cienia tym samym kluczem zmian co obraz główny, ale tylko czytane przez mastera -
+// nieczytany typ danych nie kosztuje nic poza sprawdzeniem znacznika czasu
+static void refreshModbusShadows() {
+    uint32_t now = millis();
+    for (int view = 0; view < MODBUS_SHADOW_VIEWS; view++) {
+        ModbusShadowView& shadow = modbusShadows[view];
+        if (shadow.published == NULL) continue;
+
+        composeView = view;
+        for (size_t i = 0; i < MODBUS_BANK_COUNT; i++) {
+            const ModbusBank& bank = modbusBanks[i];
+            if (!shadowBankRead(shadow, bank.map, now) || !bank.active()) continue;
+
+            uint32_t key = bank.key();
+            if (shadowWritten[view][i] && key == shadowKeys[view][i]) continue;
+
+            bank.update();
+            shadow.refreshes++;
+            shadowKeys[view][i] = key;
+            shadowWritten[view][i] = true;
+        }
+    }
+    composeView = MODBUS_VIEW_MAIN;
+}
+
+void updateModbusRegisters() {
+    if (!config.enableModbus) return;
+    modbusUpdatePasses++;
+
+    for (size_t i = 0; i < MODBUS_BANK_COUNT; i++) {
+        const ModbusBank& bank = modbusBanks[i];
+        if (!bank.active()) continue;
+
+        uint32_t key = bank.key();
+        if (bankWritten[i] && key == bankKeys[i]) {
+            bankSkips[i]++;
+            continue;
+        }
+
+        uint32_t start = ESP.getCycleCount();
+        bank.update();
+        bankCycles[i] += (uint32_t)(ESP.getCycleCount() - start);
+        bankRefreshes[i]++;
+        bankKeys[i] = key;
+        bankWritten[i] = true;
+    }
+
+    refreshModbusShadows();
+}
+
+size_t getModbusBankCount() {
+    return MODBUS_BANK_COUNT;
+}
+
+bool getModbusBankStats(size_t index, ModbusBankStats& stats) {
+    if (index >= MODBUS_BANK_COUNT) return false;
+    stats.name = modbusBanks[index].name;
+    stats.refreshes = bankRefreshes[index];
+    stats.skips = bankSkips[index];
+    stats.avgCycles = bankRefreshes[index] ? (uint32_t)(bankCycles[index] / bankRefreshes[index]) : 0;
+    return true;
+}
+
+bool getModbusShadowStats(DataType type, ModbusShadowStats& stats) {
+    if (type < DATA_CURRENT || type > DATA_SLOW_AVG) return false;
+    const ModbusShadowView& shadow = modbusShadows[type];
+    uint32_t now = millis();
+    stats.allocated = shadow.published != NULL;
+    stats.activeBanks = 0;
+    for (size_t i = 0; i < MODBUS_BANK_COUNT; i++) {
+        if (shadowBankRead(shadow, modbusBanks[i].map, now)) stats.activeBanks++;
+    }
+    stats.refreshes = shadow.refreshes;
+    stats.reads = shadow.reads;
+    return true;
+}
+
+// Pominięte odświeżenia x średni koszt odświeżenia, na przebieg pętli
+uint32_t getModbusCyclesSavedPerLoop() {
+    if (modbusUpdatePasses == 0) return 0;
+    uint64_t saved = 0;
+    for (size_t i = 0; i < MODBUS_BANK_COUNT; i++) {
+        if (bankRefreshes[i] == 0) continue;
+        saved += (bankCycles[i] / bankRefreshes[i]) * bankSkips[i];
+    }
+    return (uint32_t)(saved / modbusUpdatePasses);
+}
+
+static String getModbusLatencyStatus() {
+    ModbusLatencyStats stats;
+    getModbusLatencyStats(stats);
+    if (!stats.eventDriven) return "- Modbus RTU: polled from loop()\n";
+    return "- Modbus RTU task: " + String(stats.frames) + " frames, latency p50 " + String(stats.p50) +
+           " us, p90 " + String(stats.p90) + " us, p99 " + String(stats.p99) + " us, max " + String(stats.max) +
+           " us, lost RX events " + String(modbusRxLostEvents) + "\n";
+}
+
+static String getModbusShadowStatus() {
+    static const char* const typeNames[] = {"current", "fast", "slow"};
+    String status = "";
+    for (int view = 0; view < MODBUS_SHADOW_VIEWS; view++) {
+        ModbusShadowStats stats;
+        getModbusShadowStats((DataType)view, stats);
+        if (!stats.allocated) continue;
+        status += String(status.length() ? ", " : "") + typeNames[view] + " " + String(stats.activeBanks) +
+                  " banks (" + String(stats.refreshes) + " refreshes, " + String(stats.reads) + " reads)";
+    }
+    return status.length() ? "- Modbus shadow banks: " + status + "\n" : "";
+}
+
+String getModbusStatus() {
+    if (!config.enableModbus) return "- Modbus: disabled\n";
+    uint32_t refreshes = 0;
+    uint32_t skips = 0;
+    for (size_t i = 0; i < MODBUS_BANK_COUNT; i++) {
+        refreshes += bankRefreshes[i];
+        skips += bankSkips[i];
+    }
+    return "- Modbus banks: " + String(refreshes) + " refreshes, " + String(skips) + " skipped, ~" +
+           String(getModbusCyclesSavedPerLoop()) + " cycles saved per loop, data type " + getCurrentDataTypeName() + "\n" +
+           "- Modbus image: " + String(modbusPublishes) + " bank publishes, " + String(modbusPublishedWords) +
+           " words, max lock " + String(modbusPublishMaxCycles) + " cycles\n" +
+           getModbusShadowStatus() + getModbusLatencyStatus() + getModbusTcpStatus() + getModbusHistoryStatus();
+}
+
+// ===== Task Modbus RTU =====
+// Zdarzenie UART (RX timeout po ostatnim bajcie = koniec ramki) budzi task, który od razu
+// obsługuje ramkę - czas odpowiedzi nie zależy od długości iteracji loop() (odczyty I2C/UART).
+// Ramki obsługuje modbus_pdu.cpp (jak Modbus TCP) - także FC 0x14 dla historii, którego biblioteka
+// ModbusSerial nie zna; mb zostaje konfiguracją portu i magazynem rejestrów.
+// Gdy tasku nie da się utworzyć, mb.task() zostaje w processModbusTask() jak dawniej (bez FC 0x14).
+
+static TaskHandle_t modbusTaskHandle = NULL;
+static volatile uint32_t modbusRxTimestamp = 0;     // micros() zdarzenia końca ramki
+static uint32_t latencyWindow[MODBUS_LATENCY_WINDOW];
+static uint32_t latencyCount = 0;                    // wszystkie pomiary (indeks w oknie = count % okno)
+static uint32_t modbusFrames = 0;
+static ModbusLatencyStats latencyStats = {};
+static portMUX_TYPE latencyMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void onModbusReceive() {
+    // Kontekst tasku zdarzeń UART (nie ISR)
+    modbusRxTimestamp = micros();
+    if (modbusTaskHandle) xTaskNotifyGive(modbusTaskHandle);
+}
+
+static void recordLatency(uint32_t latency) {
+    portENTER_CRITICAL(&latencyMux);
+    latencyWindow[latencyCount % MODBUS_LATENCY_WINDOW] = latency;
+    latencyCount++;
+    modbusFrames++;
+    portEXIT_CRITICAL(&latencyMux);
+}
+
+static uint32_t percentile(const uint32_t* sorted, uint32_t count, uint32_t permille) {
+    if (count == 0) return 0;
+    uint32_t index = (count * permille + 999) / 1000;   // nearest-rank
+    return sorted[index ? index - 1 : 0];
+}
+
+// Wywołania pod mutexem obrazu - blok diagnostyczny czytają też klienci Modbus TCP
+static void writeDiagRegister(int offset, uint16_t value) {
+    mb.setHreg(MODBUS_DIAG_BASE_REG + offset, value);
+    modbusPublished[MODBUS_DIAG_BASE_REG + offset] = value;
+}
+
+static void writeDiagRegister32(int offset, uint32_t value) {
+    writeDiagRegister(offset, (uint16_t)(value & 0xFFFF));
+    writeDiagRegister(offset + 1, (uint16_t)(value >> 16));
+}
+
+static void updateModbusDiagnostics() {
+    static uint32_t sorted[MODBUS_LATENCY_WINDOW];
+
+    portENTER_CRITICAL(&latencyMux);
+    uint32_t count = latencyCount < MODBUS_LATENCY_WINDOW ? latencyCount : MODBUS_LATENCY_WINDOW;
+    memcpy(sorted, latencyWindow, count * sizeof(uint32_t));
+    uint32_t frames = modbusFrames;
+    portEXIT_CRITICAL(&latencyMux);
+
+    std::sort(sorted, sorted + count);
+
+    ModbusLatencyStats stats;
+    stats.samples = count;
+    stats.p50 = percentile(sorted, count, 500);
+    stats.p90 = percentile(sorted, count, 900);
+    stats.p99 = percentile(sorted, count, 990);
+    stats.max = count ? sorted[count - 1] : 0;
+    stats.frames = frames;
+    stats.eventDriven = modbusTaskHandle != NULL;
+
+    portENTER_CRITICAL(&latencyMux);
+    latencyStats = stats;
+    portEXIT_CRITICAL(&latencyMux);
+
+    unsigned long timestamp = isTimeSet() ? (unsigned long)time(nullptr) : millis() / 1000;
+    if (!lockModbusImage()) return;
+    writeDiagRegister(0, stats.eventDriven ? 1 : 0);
+    writeDiagRegister(1, (uint16_t)count);
+    writeDiagRegister32(2, timestamp);
+    writeDiagRegister32(4, stats.p50);
+    writeDiagRegister32(6, stats.p90);
+    writeDiagRegister32(8, stats.p99);
+    writeDiagRegister32(10, stats.max);
+    writeDiagRegister32(12, frames);
+    unlockModbusImage();
+}
+
+static const ModbusRegisterAccess modbusRtuAccess = { readModbusImage, writeModbusImage, readModbusHistoryFile };
+
+// Bajty odebrane do zdarzenia RX timeout = jedna ramka RTU
+static void serveModbusRtuFrame() {
+    static uint8_t request[MODBUS_RTU_MAX_ADU];
+    static uint8_t response[MODBUS_RTU_MAX_ADU];
+    size_t length = 0;
+
+    while (Serial2.available() > 0 && length < sizeof(request)) {
+        request[length++] = Serial2.read();
+    }
+    if (Serial2.available() > 0) {
+        // Dłuższe niż największa ramka - szum na linii, odrzucane w całości
+        while (Serial2.available() > 0) Serial2.read();
+        modbusRtuFrameErrors++;
+        return;
+    }
+
+    size_t responseLength;
+    switch (processModbusRtuFrame(request, length, MODBUS_SLAVE_ID, response, responseLength, modbusRtuAccess)) {
+        case MBRTU_RESPONSE:
+            Serial2.write(response, responseLength);
             break;
-        case DATA_FAST_AVG:
-            dataToUse = getCalibratedFastAverage();
+        case MBRTU_CRC_ERROR:
+            modbusRtuCrcErrors++;
             break;
-        case DATA_SLOW_AVG:
-            dataToUse = getCalibratedSlowAverage();
+        case MBRTU_INVALID:
+            modbusRtuFrameErrors++;
+            break;
+        default:
             break;
     }
+}
 
-    int baseReg = REG_COUNT_SOLAR + REG_COUNT_OPCN3 + REG_COUNT_I2C + REG_COUNT_IPS + REG_COUNT_MCP3424 + REG_COUNT_ADS1110 + REG_COUNT_INA219 + REG_COUNT_SPS30 + REG_COUNT_SHT40;
+static void modbusTask(void* parameter) {
+    (void)parameter;
+    unsigned long lastDiag = 0;
+    int pendingAtTimeout = 0;
 
-    mb.setHreg(baseReg, calibConfig.enableCalibration ? 1 : 0); // Status flag
-    mb.setHreg(baseReg + 1, (uint16_t)currentDataType); // Typ danych
+    while (true) {
+        // Ramka tylko po zdarzeniu RX timeout (cisza t3.5 na linii). Pobudka po MODBUS_TASK_IDLE_TIMEOUT
+        // bez zdarzenia nie dzieli długiej ramki w trakcie odbioru - służy diagnostyce
+        uint32_t events = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MODBUS_TASK_IDLE_TIMEOUT));
+        int pending = Serial2.available();
 
-    // Timestamp aktualizacji danych (32-bit)
-    unsigned long updateTime = millis();
-    mb.setHreg(baseReg + 2, updateTime & 0xFFFF); // Lower 16 bits
-    mb.setHreg(baseReg + 3, (updateTime >> 16) & 0xFFFF); // Upper 16 bits
+        if (events > 0 && pending > 0) {
+            uint32_t frameEnd = modbusRxTimestamp;
+            modbusRxEvents++;
+            lastModbusActivity = millis();
+            hasHadModbusActivity = true;
 
-    if (dataToUse.valid) {
-        mb.setHreg(baseReg + 4, (int16_t)(dataToUse.CO * 100));
-        mb.setHreg(baseReg + 5, (int16_t)(dataToUse.NO * 100));
-        mb.setHreg(baseReg + 6, (int16_t)(dataToUse.NO2 * 100));
-        mb.setHreg(baseReg + 7, (int16_t)(dataToUse.O3 * 100));
-        mb.setHreg(baseReg + 8, (int16_t)(dataToUse.SO2 * 100));
-        mb.setHreg(baseReg + 9, (int16_t)(dataToUse.H2S * 100));
-        mb.setHreg(baseReg + 10, (int16_t)(dataToUse.NH3 * 100));
-        mb.setHreg(baseReg + 11, (int16_t)(dataToUse.HCHO * 100));
-       // Serial.println(dataToUse.HCHO*100);
-        mb.setHreg(baseReg + 12, (int16_t)(dataToUse.PID * 100));
-        mb.setHreg(baseReg + 13, (int16_t)(dataToUse.TGS02 * 100));
-        mb.setHreg(baseReg + 14, (int16_t)(dataToUse.TGS03 * 100));
-        mb.setHreg(baseReg + 15, (int16_t)(dataToUse.TGS12 * 100));
-        mb.setHreg(baseReg + 16, (int16_t)(dataToUse.TGS02_ohm * 100));
-        mb.setHreg(baseReg + 17, (int16_t)(dataToUse.TGS03_ohm * 100));
-        mb.setHreg(baseReg + 18, (int16_t)(dataToUse.TGS12_ohm * 100));
-        // mb.setHreg(baseReg + 19, (int16_t)(dataToUse.TGS02_ppm * 100));
-        // mb.setHreg(baseReg + 20, (int16_t)(dataToUse.TGS03_ppm * 100));
-        // mb.setHreg(baseReg + 21, (int16_t)(dataToUse.TGS12_ppm * 100));
-        // mb.setHreg(baseReg + 22, (int16_t)(dataToUse.TGS02_ppb * 100));
-        // mb.setHreg(baseReg + 23, (int16_t)(dataToUse.TGS03_ppb * 100));
-        // mb.setHreg(baseReg + 24, (int16_t)(dataToUse.TGS12_ppb * 100));
-        mb.setHreg(baseReg + 25, (int16_t)(dataToUse.CO_ppb * 100));
-        mb.setHreg(baseReg + 26, (int16_t)(dataToUse.NO_ppb * 100));
-        mb.setHreg(baseReg + 27, (int16_t)(dataToUse.NO2_ppb * 100));
-        mb.setHreg(baseReg + 28, (int16_t)(dataToUse.O3_ppb * 100));
-        mb.setHreg(baseReg + 29, (int16_t)(dataToUse.SO2_ppb * 100));
-        mb.setHreg(baseReg + 30, (int16_t)(dataToUse.H2S_ppb * 100));
-        mb.setHreg(baseReg + 31, (int16_t)(dataToUse.NH3_ppb * 100));
-        mb.setHreg(baseReg + 32, (int16_t)(dataToUse.HCHO * 100));
-        mb.setHreg(baseReg + 33, (int16_t)(dataToUse.PID * 100));
-        mb.setHreg(baseReg + 34, (int16_t)(dataToUse.VOC * 100));        // VOC ug/m3
-        mb.setHreg(baseReg + 35, (int16_t)(dataToUse.VOC_ppb * 100));    // VOC ppb
+            // Odczyt i zapis rejestrów pod mutexem obrazu - bank widziany w całości
+            serveModbusRtuFrame();
+            recordLatency(micros() - frameEnd);
+        } else if (events == 0 && pending > 0 && pending == pendingAtTimeout) {
+            // Zgubione zdarzenie: te same bajty przez cały timeout (linia cicha >> t3.5) - ramka
+            // obsłużona bez pomiaru opóźnienia (znacznik końca ramki nieaktualny)
+            modbusRxLostEvents++;
+            modbusRxEvents++;
+            lastModbusActivity = millis();
+            hasHadModbusActivity = true;
+            serveModbusRtuFrame();
+        }
+        pendingAtTimeout = (events == 0) ? Serial2.available() : 0;
 
-    } else {
-        // Clear data registers if invalid
-        for (int i = 4; i < 36; i++) {
-            mb.setHreg(baseReg + i, 0);
+        if (millis() - lastDiag >= MODBUS_DIAG_INTERVAL) {
+            lastDiag = millis();
+            updateModbusDiagnostics();
         }
     }
 }
 
-void processModbusTask() {
-    if (!config.enableModbus) return;
-    
-    // Update moving averages with fresh sensor data
-  
-    
+static void startModbusTask() {
+    // Koniec ramki RTU = cisza na linii; zdarzenie tylko po RX timeout, nie po każdym bajcie
+    Serial2.setRxTimeout(MODBUS_RX_TIMEOUT_SYMBOLS);
+    Serial2.onReceive(onModbusReceive, true);
+
+    BaseType_t taskCreated = xTaskCreatePinnedToCore(
+        modbusTask,
+        "modbusTask",
+        MODBUS_TASK_STACK_SIZE,
+        NULL,
+        MODBUS_TASK_PRIORITY,
+        &modbusTaskHandle,
+        MODBUS_TASK_CORE
+    );
+
+    if (taskCreated != pdPASS) {
+        modbusTaskHandle = NULL;
+        Serial2.onReceive(NULL);
+        safePrintln("Failed to create Modbus task - polling from loop()");
+        return;
+    }
+    safePrintln("Modbus RTU task started (UART RX timeout events)");
+}
+
+void getModbusLatencyStats(ModbusLatencyStats& stats) {
+    portENTER_CRITICAL(&latencyMux);
+    stats = latencyStats;
+    portEXIT_CRITICAL(&latencyMux);
+    stats.eventDriven = modbusTaskHandle != NULL;
+}
+
+static void pollModbusSerial() {
     // Check for Modbus activity BEFORE mb.task() processes and clears the buffer
     if (Serial2.available() > 0) {
+        modbusRxEvents++;
         lastModbusActivity = millis();
         hasHadModbusActivity = true;
         
@@ -881,7 +1117,27 @@ void processModbusTask() {
         }
     }
     
+    lockModbusImage();
     mb.task();
+    unlockModbusImage();
+
+    static unsigned long lastDiag = 0;
+    if (millis() - lastDiag >= MODBUS_DIAG_INTERVAL) {
+        lastDiag = millis();
+        updateModbusDiagnostics();
+    }
+}
+
+void processModbusTask() {
+    if (!config.enableModbus) return;
+    
+    // Update moving averages with fresh sensor data
+  
+    
+    // Ramki obsługuje modbusTask; poniżej tylko fallback gdy task nie wystartował
+    if (modbusTaskHandle == NULL) {
+        pollModbusSerial();
+    }
     
     // Also update activity if any commands were processed
     static uint16_t lastChecksum = 0;
@@ -913,79 +1169,15 @@ void processModbusTask() {
     if (currentCommand != lastCommand && currentCommand != 0) {
         lastCommand = currentCommand;
         
-        switch (currentCommand) {
-            case 1: // Request fresh OPCN3 reading
-                if (config.enableOPCN3Sensor) {
-                    opcn3Data = myOPCN3.readHistogramData();
-                    updateModbusOPCN3Registers();
-                }
-                mb.setHreg(REG_COUNT_SOLAR + REG_COUNT_OPCN3+1, 0); // Clear command register
-                break;
-                
-            case 2: // Reset system
-                mb.setHreg(REG_COUNT_SOLAR + REG_COUNT_OPCN3+1, 0); // Clear command register
-                delay(100);
-                ESP.restart();
-                break;
-                
-            case 3: // Toggle auto reset
-                config.autoReset = !config.autoReset;
-                mb.setHreg(REG_COUNT_SOLAR + REG_COUNT_OPCN3+2, config.autoReset ? 1 : 0); // Store state in register 92
-                mb.setHreg(REG_COUNT_SOLAR + REG_COUNT_OPCN3+1, 0); // Clear command register
-                break;
-                
-            case 4: // Request fresh IPS reading
-                if (config.enableIPS) {
-                    readIPS(ipsSensorData);
-                    updateModbusIPSRegisters();
-                }
-                mb.setHreg(REG_COUNT_SOLAR + REG_COUNT_OPCN3+1, 0); // Clear command register
-                break;
-                
-            case 5: // Enable IPS debug mode
-                if (config.enableIPS) {
-                    enableIPSDebugMode();
-                    updateModbusIPSRegisters();
-                }
-                mb.setHreg(REG_COUNT_SOLAR + REG_COUNT_OPCN3+1, 0); // Clear command register
-                break;
-                
-            case 6: // Disable IPS debug mode
-                if (config.enableIPS) {
-                    disableIPSDebugMode();
-                    updateModbusIPSRegisters();
-                }
-                mb.setHreg(REG_COUNT_SOLAR + REG_COUNT_OPCN3+1, 0); // Clear command register
-                break;
-                
-            case 7: // Switch to current data
-                setCurrentDataType(DATA_CURRENT);
-                mb.setHreg(REG_COUNT_SOLAR + REG_COUNT_OPCN3+1, 0); // Clear command register
-                break;
-                
-            case 8: // Switch to fast average (10s)
-                setCurrentDataType(DATA_FAST_AVG);
-                mb.setHreg(REG_COUNT_SOLAR + REG_COUNT_OPCN3+1, 0); // Clear command register
-                break;
-                
-            case 9: // Switch to slow average (5min)
-                setCurrentDataType(DATA_SLOW_AVG);
-                mb.setHreg(REG_COUNT_SOLAR + REG_COUNT_OPCN3+1, 0); // Clear command register
-                break;
-                
-            case 11: // Cycle through data types
-                cycleDataType();
-                mb.setHreg(REG_COUNT_SOLAR + REG_COUNT_OPCN3+1, 0); // Clear command register
-                break;
-                
-            case 10: // Print moving average status
-                printMovingAverageStatus();
-                mb.setHreg(REG_COUNT_SOLAR + REG_COUNT_OPCN3+1, 0); // Clear command register
-                break;
-                
-            default:
-                mb.setHreg(REG_COUNT_SOLAR + REG_COUNT_OPCN3+1, 0); // Clear unknown command
-                break;
+        // Wyczysc rejestr komend przed wykonaniem (RESTART nie wraca z handlera)
+        mb.setHreg(REG_COUNT_SOLAR + REG_COUNT_OPCN3+1, 0);
+
+        String error;
+        if (dispatchModbusCommand(currentCommand, error) != CMD_OK) {
+            modbusCommandErrors++;
+            safePrintln("Unknown Modbus command: " + String(currentCommand));
+        } else {
+            modbusCommandsExecuted++;
         }
     }
 }
@@ -997,7 +1189,7 @@ uint16_t hexToUint16(String hex) {
 
 String convertToHex(String value) {
     String hexString = "";
-    for (int i = 0; i < value.length(); i++) {
+    for (unsigned int i = 0; i < value.length(); i++) {
         char hexBuffer[3];
         sprintf(hexBuffer, "%02X", (unsigned char)value[i]);
         hexString += hexBuffer;
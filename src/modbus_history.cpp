@@ -0,0 +1,131 @@
+#include <modbus_history.h>
+#include <modbus_pdu.h>
+#include <history.h>
+#include <history_export.h>
+
+static uint32_t historyQueries = 0;
+static uint32_t historyFileReads = 0;
+static uint32_t historyFileRegisters = 0;
+static uint32_t historyOverwritten = 0;     // próbki nadpisane przed odczytem (wysłane jako zera)
+
+static bool decodeFile(uint16_t file, size_t& source, bool& slow) {
+    if (file < 1 || file > MODBUS_HISTORY_FILE_COUNT) return false;
+    source = (file - 1) / 2;
+    slow = ((file - 1) & 1) != 0;
+    return true;
+}
+
+static inline uint32_t recordTimestamp(const uint8_t* record) {
+    return (uint32_t)record[0] | ((uint32_t)record[1] << 8) | ((uint32_t)record[2] << 16) | ((uint32_t)record[3] << 24);
+}
+
+// Pierwsza próbka z timestamp >= time (czasy w buforze rosnące). Próbka nadpisana w trakcie
+// wyszukiwania jest najstarsza - traktowana jak wcześniejsza od szukanego czasu.
+static uint32_t findFirstRecord(size_t source, bool slow, uint32_t first, uint32_t total, uint32_t time) {
+    uint8_t record[HISTORY_EXPORT_RECORD_MAX];
+    uint32_t low = first;
+    uint32_t high = total;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (!copyHistoryRecord(source, slow, mid, record) || recordTimestamp(record) < time) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+uint8_t readModbusHistoryFile(uint16_t file, uint16_t record, uint16_t count, uint16_t* out) {
+    size_t source;
+    bool slow;
+    HistoryRecordWindow window;
+    if (!decodeFile(file, source, slow) || !getHistoryRecordWindow(source, slow, window) ||
+        window.total == window.firstSeq) {
+        return MODBUS_EX_ILLEGAL_ADDRESS;
+    }
+
+    // Numer próbki z numeru rekordu - najnowsza pasująca w oknie bufora
+    uint32_t newest = window.total - 1;
+    uint32_t back = (newest % MODBUS_HISTORY_RECORD_WRAP + MODBUS_HISTORY_RECORD_WRAP - record) % MODBUS_HISTORY_RECORD_WRAP;
+    if (back > newest - window.firstSeq) return MODBUS_EX_ILLEGAL_ADDRESS;
+    uint32_t seq = newest - back;
+
+    uint16_t recordRegs = (window.recordSize + 1) / 2;
+    if ((uint32_t)(count - 1) / recordRegs > back) return MODBUS_EX_ILLEGAL_ADDRESS;   // za najnowszą próbką
+
+    uint8_t data[HISTORY_EXPORT_RECORD_MAX + 1];
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t word = i % recordRegs;
+        if (i == 0 || word == 0) {
+            memset(data, 0, sizeof(data));
+            if (!copyHistoryRecord(source, slow, seq + i / recordRegs, data)) {
+                memset(data, 0, sizeof(data));
+                historyOverwritten++;
+            }
+        }
+        out[i] = ((uint16_t)data[word * 2] << 8) | data[word * 2 + 1];
+    }
+
+    historyFileReads++;
+    historyFileRegisters += count;
+    return MODBUS_EX_NONE;
+}
+
+void evaluateModbusHistoryQuery(const uint16_t* query, uint16_t* result) {
+    memset(result, 0, REG_COUNT_MODBUS_HISTORY * sizeof(uint16_t));
+    memcpy(result, query, MB_HISTORY_QUERY_REGS * sizeof(uint16_t));
+    result[MB_HISTORY_QUERIES] = (uint16_t)++historyQueries;
+    result[MB_HISTORY_TIME_BASE] = isHistoryTimeEpoch() ? 1 : 0;
+
+    size_t source;
+    bool slow;
+    HistoryRecordWindow window;
+    if (!decodeFile(query[MB_HISTORY_FILE], source, slow) || !getHistoryRecordWindow(source, slow, window)) {
+        result[MB_HISTORY_STATUS] = MB_HISTORY_NO_FILE;
+        return;
+    }
+
+    uint32_t time = (uint32_t)query[MB_HISTORY_TIME] | ((uint32_t)query[MB_HISTORY_TIME + 1] << 16);
+    uint32_t seq = findFirstRecord(source, slow, window.firstSeq, window.total, time);
+
+    result[MB_HISTORY_STATUS] = seq < window.total ? MB_HISTORY_OK : MB_HISTORY_NO_DATA;
+    result[MB_HISTORY_RECORD] = seq % MODBUS_HISTORY_RECORD_WRAP;
+    result[MB_HISTORY_AVAILABLE] = window.total - seq;
+    result[MB_HISTORY_RECORD_REGS] = (window.recordSize + 1) / 2;
+    result[MB_HISTORY_OLDEST_RECORD] = window.firstSeq % MODBUS_HISTORY_RECORD_WRAP;
+    result[MB_HISTORY_COUNT] = window.total - window.firstSeq;
+
+    uint8_t record[HISTORY_EXPORT_RECORD_MAX];
+    if (window.total > window.firstSeq && copyHistoryRecord(source, slow, window.firstSeq, record)) {
+        uint32_t oldest = recordTimestamp(record);
+        result[MB_HISTORY_OLDEST_TIME] = oldest & 0xFFFF;
+        result[MB_HISTORY_OLDEST_TIME + 1] = oldest >> 16;
+    }
+    if (window.total > window.firstSeq && copyHistoryRecord(source, slow, window.total - 1, record)) {
+        uint32_t newest = recordTimestamp(record);
+        result[MB_HISTORY_NEWEST_TIME] = newest & 0xFFFF;
+        result[MB_HISTORY_NEWEST_TIME + 1] = newest >> 16;
+    }
+}
+
+void getModbusHistoryFilesJson(JsonArray files) {
+    for (uint16_t file = 1; file <= MODBUS_HISTORY_FILE_COUNT; file++) {
+        size_t source;
+        bool slow;
+        HistoryRecordWindow window;
+        if (!decodeFile(file, source, slow) || !getHistoryRecordWindow(source, slow, window)) continue;
+        JsonObject entry = files.createNestedObject();
+        entry["file"] = file;
+        entry["name"] = getHistoryRecordSourceName(source);
+        entry["sampleType"] = slow ? "slow" : "fast";
+        entry["recordRegisters"] = (window.recordSize + 1) / 2;
+        entry["records"] = window.total - window.firstSeq;
+    }
+}
+
+String getModbusHistoryStatus() {
+    return "- Modbus history: " + String(historyQueries) + " queries, " + String(historyFileReads) +
+           " file reads (" + String(historyFileRegisters) + " registers), " + String(historyOverwritten) +
+           " overwritten samples\n";
+}
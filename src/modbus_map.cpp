@@ -0,0 +1,409 @@
+#include <modbus_map.h>
+#include <modbus_history.h>
+#include <calib.h>
+#include <stddef.h>
+#include <string.h>
+#include <type_traits>
+
+// ===== Tabela rejestrów =====
+
+// Typ pola z typu C++ - rozmiary liczone na docelowej platformie (unsigned long = u32 na ESP32)
+template<typename E>
+constexpr uint8_t modbusSourceType() {
+    return std::is_same<E, bool>::value ? MB_SRC_BOOL :
+           std::is_floating_point<E>::value ? MB_SRC_F32 :
+           std::is_signed<E>::value ?
+               (sizeof(E) == 1 ? MB_SRC_I8 : sizeof(E) == 2 ? MB_SRC_I16 : sizeof(E) == 4 ? MB_SRC_I32 : MB_SRC_I64) :
+               (sizeof(E) == 1 ? MB_SRC_U8 : sizeof(E) == 2 ? MB_SRC_U16 : sizeof(E) == 4 ? MB_SRC_U32 : MB_SRC_U64);
+}
+
+// decltype(T::a[i]) to referencja - zdejmowana przed typem elementu
+#define MB_ELEMENT(T, member) std::remove_all_extents<std::remove_reference<decltype(T::member)>::type>::type
+#define MB_COUNT(T, member) (uint8_t)(sizeof(T::member) / sizeof(MB_ELEMENT(T, member)))
+
+// Pole zerowane gdy T::valid == false
+#define MB_FIELD(T, reg, member, regType, scale, unit) \
+    { reg, (uint16_t)offsetof(T, member), (uint16_t)offsetof(T, valid), modbusSourceType<MB_ELEMENT(T, member)>(), \
+      regType, MB_COUNT(T, member), scale, #member, unit }
+// Pole zerowane gdy T::gate == false (np. valid[device])
+#define MB_GATED(T, reg, member, gate, regType, scale, unit) \
+    { reg, (uint16_t)offsetof(T, member), (uint16_t)offsetof(T, gate), modbusSourceType<MB_ELEMENT(T, member)>(), \
+      regType, MB_COUNT(T, member), scale, #member, unit }
+// Pole zapisywane zawsze
+#define MB_ALWAYS(T, reg, member, regType, scale, unit) \
+    { reg, (uint16_t)offsetof(T, member), MB_NO_GATE, modbusSourceType<MB_ELEMENT(T, member)>(), \
+      regType, MB_COUNT(T, member), scale, #member, unit }
+#define MB_AGE(T, reg) MB_FIELD(T, reg, lastUpdate, MB_REG_AGE, 1.0f, "s")
+// Rejestr liczony w kodzie banku (tylko opis)
+#define MB_CUSTOM(reg, regType, count, scale, name, unit) \
+    { reg, 0, MB_NO_GATE, MB_SRC_NONE, regType, count, scale, name, unit }
+
+static constexpr ModbusRegisterDef solarRegisters[] = {
+    MB_CUSTOM(4, MB_REG_U16, 1, 1.0f, "PID", "hex"),
+    MB_CUSTOM(5, MB_REG_U16, 1, 1.0f, "FW", ""),
+    MB_CUSTOM(6, MB_REG_U16, 1, 1.0f, "SER", ""),
+    MB_CUSTOM(7, MB_REG_U16, 1, 1.0f, "V", "mV"),
+    MB_CUSTOM(8, MB_REG_I16, 1, 1.0f, "I", "mA"),
+    MB_CUSTOM(9, MB_REG_U16, 1, 1.0f, "VPV", "mV"),
+    MB_CUSTOM(10, MB_REG_U16, 1, 1.0f, "PPV", "W"),
+    MB_CUSTOM(11, MB_REG_U16, 1, 1.0f, "CS", ""),
+    MB_CUSTOM(12, MB_REG_U16, 1, 1.0f, "MPPT", ""),
+    MB_CUSTOM(13, MB_REG_U16, 1, 1.0f, "OR", "hex"),
+    MB_CUSTOM(14, MB_REG_U16, 1, 1.0f, "ERR", ""),
+    MB_CUSTOM(15, MB_REG_U16, 1, 1.0f, "LOAD", "bool"),
+    MB_CUSTOM(16, MB_REG_U16, 1, 1.0f, "IL", "mA"),
+    MB_CUSTOM(17, MB_REG_U16, 1, 1.0f, "H19", "0.01 kWh"),
+    MB_CUSTOM(18, MB_REG_U16, 1, 1.0f, "H20", "0.01 kWh"),
+    MB_CUSTOM(19, MB_REG_U16, 1, 1.0f, "H21", "W"),
+    MB_CUSTOM(20, MB_REG_U16, 1, 1.0f, "H22", "0.01 kWh"),
+    MB_CUSTOM(21, MB_REG_U16, 1, 1.0f, "H23", "W"),
+    MB_CUSTOM(22, MB_REG_U16, 1, 1.0f, "HSDS", "day")
+};
+
+// HistogramData pochodzi z biblioteki OPCN3 (temperatura/wilgotność z metod) - wartości liczy bank
+static constexpr ModbusRegisterDef opcn3Registers[] = {
+    MB_CUSTOM(4, MB_REG_U16, 1, 100.0f, "temperature", "°C"),
+    MB_CUSTOM(5, MB_REG_U16, 1, 100.0f, "humidity", "%"),
+    MB_CUSTOM(6, MB_REG_U16, 24, 1.0f, "binCounts", "count"),
+    MB_CUSTOM(30, MB_REG_U16, 1, 1.0f, "bin1TimeToCross", ""),
+    MB_CUSTOM(31, MB_REG_U16, 1, 1.0f, "bin3TimeToCross", ""),
+    MB_CUSTOM(32, MB_REG_U16, 1, 1.0f, "bin5TimeToCross", ""),
+    MB_CUSTOM(33, MB_REG_U16, 1, 1.0f, "bin7TimeToCross", ""),
+    MB_CUSTOM(34, MB_REG_U16, 1, 1.0f, "sensorStatus", "bool"),
+    MB_CUSTOM(35, MB_REG_U16, 1, 100.0f, "sampleFlowRate", "ml/s"),
+    MB_CUSTOM(36, MB_REG_U16, 1, 1.0f, "samplingPeriod", "s"),
+    MB_CUSTOM(37, MB_REG_U16, 1, 100.0f, "pm1", "µg/m³"),
+    MB_CUSTOM(38, MB_REG_U16, 1, 100.0f, "pm2_5", "µg/m³"),
+    MB_CUSTOM(39, MB_REG_U16, 1, 100.0f, "pm10", "µg/m³")
+};
+
+// Offsety względem MODBUS_BASE_CONTROL; obsługa w processModbusTask()
+static constexpr ModbusRegisterDef controlRegisters[] = {
+    MB_CUSTOM(1, MB_REG_U16, 1, 1.0f, "command", "code"),
+    MB_CUSTOM(2, MB_REG_U16, 1, 1.0f, "dataType", "0-2")
+};
+
+static constexpr ModbusRegisterDef i2cRegisters[] = {
+    MB_FIELD(I2CSensorData, 4, temperature, MB_REG_I16, 100.0f, "°C"),
+    MB_FIELD(I2CSensorData, 5, humidity, MB_REG_U16, 100.0f, "%"),
+    MB_FIELD(I2CSensorData, 6, pressure, MB_REG_U16, 10.0f, "hPa"),
+    MB_FIELD(I2CSensorData, 7, co2, MB_REG_U16, 1.0f, "ppm"),
+    MB_FIELD(I2CSensorData, 8, type, MB_REG_U16, 1.0f, "enum"),
+    MB_CUSTOM(9, MB_REG_U16, 1, 1.0f, "timeHHMM", ""),
+    MB_CUSTOM(10, MB_REG_U16, 1, 1.0f, "dateDDMM", ""),
+    MB_CUSTOM(11, MB_REG_U16, 1, 1.0f, "year", ""),
+    MB_CUSTOM(12, MB_REG_U16, 1, 1.0f, "epochLow", "s"),
+    MB_CUSTOM(13, MB_REG_U16, 1, 1.0f, "network", "bool")
+};
+
+static constexpr ModbusRegisterDef ipsRegisters[] = {
+    MB_ALWAYS(IPSSensorData, 4, debugMode, MB_REG_U16, 1.0f, "bool"),
+    MB_ALWAYS(IPSSensorData, 5, won, MB_REG_U16, 1.0f, "enum"),
+    MB_FIELD(IPSSensorData, 6, pc_values, MB_REG_U32, 1.0f, "count"),
+    MB_FIELD(IPSSensorData, 20, pm_values, MB_REG_U16, 10.0f, "µg/m³"),
+    MB_FIELD(IPSSensorData, 27, np_values, MB_REG_U32, 1.0f, "count"),     // tylko w debug mode
+    MB_FIELD(IPSSensorData, 41, pw_values, MB_REG_U16, 1.0f, "")           // tylko w debug mode
+};
+
+// Urządzenie MCP3424: 16 rejestrów od offsetu 5
+#define MCP3424_DEVICE(d) \
+    MB_ALWAYS(MCP3424Data, 5 + (d) * 16, valid[d], MB_REG_U16, 1.0f, "bool"), \
+    MB_ALWAYS(MCP3424Data, 6 + (d) * 16, addresses[d], MB_REG_U16, 1.0f, "i2c"), \
+    MB_ALWAYS(MCP3424Data, 7 + (d) * 16, resolution, MB_REG_U16, 1.0f, "bit"), \
+    MB_ALWAYS(MCP3424Data, 8 + (d) * 16, gain, MB_REG_U16, 1.0f, "x"), \
+    MB_GATED(MCP3424Data, 9 + (d) * 16, channels[d], valid[d], MB_REG_I32, 1000000.0f, "µV"), \
+    MB_GATED(MCP3424Data, 17 + (d) * 16, lastUpdate, valid[d], MB_REG_AGE, 1.0f, "s")
+
+static constexpr ModbusRegisterDef mcp3424Registers[] = {
+    MB_ALWAYS(MCP3424Data, 4, deviceCount, MB_REG_U16, 1.0f, "count"),
+    MCP3424_DEVICE(0), MCP3424_DEVICE(1), MCP3424_DEVICE(2), MCP3424_DEVICE(3),
+    MCP3424_DEVICE(4), MCP3424_DEVICE(5), MCP3424_DEVICE(6), MCP3424_DEVICE(7)
+};
+static_assert(MAX_MCP3424_DEVICES == 8, "mcp3424Registers opisuje 8 urządzeń");
+
+static constexpr ModbusRegisterDef ads1110Registers[] = {
+    MB_ALWAYS(ADS1110Data, 4, dataRate, MB_REG_U16, 1.0f, "SPS"),
+    MB_ALWAYS(ADS1110Data, 5, gain, MB_REG_U16, 1.0f, "x"),
+    MB_FIELD(ADS1110Data, 6, voltage, MB_REG_I32, 1000000.0f, "µV"),
+    MB_AGE(ADS1110Data, 8)
+};
+
+static constexpr ModbusRegisterDef ina219Registers[] = {
+    MB_FIELD(INA219Data, 4, busVoltage, MB_REG_U16, 1000.0f, "mV"),
+    MB_FIELD(INA219Data, 5, shuntVoltage, MB_REG_U16, 10.0f, "0.1 mV"),
+    MB_FIELD(INA219Data, 6, current, MB_REG_U16, 1.0f, "mA"),
+    MB_FIELD(INA219Data, 7, power, MB_REG_U16, 1.0f, "mW"),
+    MB_AGE(INA219Data, 8),
+    MB_CUSTOM(9, MB_REG_U16, 1, 1.0f, "isBatteryPowered", "bool"),
+    MB_CUSTOM(10, MB_REG_U16, 1, 1.0f, "lowBattery", "bool"),
+    MB_CUSTOM(11, MB_REG_U16, 1, 1.0f, "criticalBattery", "bool")
+};
+
+static constexpr ModbusRegisterDef sps30Registers[] = {
+    MB_FIELD(SPS30Data, 4, pm1_0, MB_REG_U16, 1000.0f, "µg/m³"),
+    MB_FIELD(SPS30Data, 5, pm2_5, MB_REG_U16, 1000.0f, "µg/m³"),
+    MB_FIELD(SPS30Data, 6, pm4_0, MB_REG_U16, 1000.0f, "µg/m³"),
+    MB_FIELD(SPS30Data, 7, pm10, MB_REG_U16, 1000.0f, "µg/m³"),
+    MB_FIELD(SPS30Data, 8, nc0_5, MB_REG_U16, 1000.0f, "#/cm³"),
+    MB_FIELD(SPS30Data, 9, nc1_0, MB_REG_U16, 1000.0f, "#/cm³"),
+    MB_FIELD(SPS30Data, 10, nc2_5, MB_REG_U16, 1000.0f, "#/cm³"),
+    MB_FIELD(SPS30Data, 11, nc4_0, MB_REG_U16, 1000.0f, "#/cm³"),
+    MB_FIELD(SPS30Data, 12, nc10, MB_REG_U16, 1000.0f, "#/cm³"),
+    MB_FIELD(SPS30Data, 13, typical_particle_size, MB_REG_U16, 1000.0f, "µm"),
+    MB_AGE(SPS30Data, 14)
+};
+
+static constexpr ModbusRegisterDef sht40Registers[] = {
+    MB_FIELD(SHT40Data, 4, temperature, MB_REG_I16, 100.0f, "°C"),
+    MB_FIELD(SHT40Data, 5, humidity, MB_REG_U16, 100.0f, "%"),
+    MB_FIELD(SHT40Data, 6, pressure, MB_REG_U16, 10.0f, "kPa"),
+    MB_AGE(SHT40Data, 7)
+};
+
+static constexpr ModbusRegisterDef hchoRegisters[] = {
+    MB_FIELD(HCHOData, 4, hcho, MB_REG_U16, 1000.0f, "mg/m³"),
+    MB_AGE(HCHOData, 5)
+};
+
+static constexpr ModbusRegisterDef calibrationRegisters[] = {
+    MB_FIELD(CalibratedSensorData, 4, CO, MB_REG_I16, 100.0f, "µg/m³"),
+    MB_FIELD(CalibratedSensorData, 5, NO, MB_REG_I16, 100.0f, "µg/m³"),
+    MB_FIELD(CalibratedSensorData, 6, NO2, MB_REG_I16, 100.0f, "µg/m³"),
+    MB_FIELD(CalibratedSensorData, 7, O3, MB_REG_I16, 100.0f, "µg/m³"),
+    MB_FIELD(CalibratedSensorData, 8, SO2, MB_REG_I16, 100.0f, "µg/m³"),
+    MB_FIELD(CalibratedSensorData, 9, H2S, MB_REG_I16, 100.0f, "µg/m³"),
+    MB_FIELD(CalibratedSensorData, 10, NH3, MB_REG_I16, 100.0f, "µg/m³"),
+    MB_FIELD(CalibratedSensorData, 11, HCHO, MB_REG_I16, 100.0f, "ppb"),
+    MB_FIELD(CalibratedSensorData, 12, PID, MB_REG_I16, 100.0f, "ppm"),
+    MB_FIELD(CalibratedSensorData, 13, TGS02, MB_REG_I16, 100.0f, "ppm"),
+    MB_FIELD(CalibratedSensorData, 14, TGS03, MB_REG_I16, 100.0f, "ppm"),
+    MB_FIELD(CalibratedSensorData, 15, TGS12, MB_REG_I16, 100.0f, "ppm"),
+    MB_FIELD(CalibratedSensorData, 16, TGS02_ohm, MB_REG_I16, 100.0f, "ohm"),
+    MB_FIELD(CalibratedSensorData, 17, TGS03_ohm, MB_REG_I16, 100.0f, "ohm"),
+    MB_FIELD(CalibratedSensorData, 18, TGS12_ohm, MB_REG_I16, 100.0f, "ohm"),
+    MB_FIELD(CalibratedSensorData, 25, CO_ppb, MB_REG_I16, 100.0f, "ppb"),
+    MB_FIELD(CalibratedSensorData, 26, NO_ppb, MB_REG_I16, 100.0f, "ppb"),
+    MB_FIELD(CalibratedSensorData, 27, NO2_ppb, MB_REG_I16, 100.0f, "ppb"),
+    MB_FIELD(CalibratedSensorData, 28, O3_ppb, MB_REG_I16, 100.0f, "ppb"),
+    MB_FIELD(CalibratedSensorData, 29, SO2_ppb, MB_REG_I16, 100.0f, "ppb"),
+    MB_FIELD(CalibratedSensorData, 30, H2S_ppb, MB_REG_I16, 100.0f, "ppb"),
+    MB_FIELD(CalibratedSensorData, 31, NH3_ppb, MB_REG_I16, 100.0f, "ppb"),
+    MB_FIELD(CalibratedSensorData, 32, HCHO, MB_REG_I16, 100.0f, "ppb"),
+    MB_FIELD(CalibratedSensorData, 33, PID, MB_REG_I16, 100.0f, "ppm"),
+    MB_FIELD(CalibratedSensorData, 34, VOC, MB_REG_I16, 100.0f, "µg/m³"),
+    MB_FIELD(CalibratedSensorData, 35, VOC_ppb, MB_REG_I16, 100.0f, "ppb")
+};
+
+// Blok diagnostyczny RTU (modbusTask)
+static constexpr ModbusRegisterDef diagnosticsRegisters[] = {
+    MB_CUSTOM(0, MB_REG_U16, 1, 1.0f, "eventDriven", "bool"),
+    MB_CUSTOM(1, MB_REG_U16, 1, 1.0f, "latencySamples", "count"),
+    MB_CUSTOM(2, MB_REG_U32, 1, 1.0f, "timestamp", "s"),
+    MB_CUSTOM(4, MB_REG_U32, 1, 1.0f, "latencyP50", "µs"),
+    MB_CUSTOM(6, MB_REG_U32, 1, 1.0f, "latencyP90", "µs"),
+    MB_CUSTOM(8, MB_REG_U32, 1, 1.0f, "latencyP99", "µs"),
+    MB_CUSTOM(10, MB_REG_U32, 1, 1.0f, "latencyMax", "µs"),
+    MB_CUSTOM(12, MB_REG_U32, 1, 1.0f, "frames", "count")
+};
+
+// Wyszukiwanie rekordów historii dla FC 0x14 (modbus_history.h)
+static constexpr ModbusRegisterDef historyRegisters[] = {
+    MB_CUSTOM(MB_HISTORY_FILE, MB_REG_U16, 1, 1.0f, "queryFile", "file"),
+    MB_CUSTOM(MB_HISTORY_TIME, MB_REG_U32, 1, 1.0f, "queryTime", "s"),
+    MB_CUSTOM(MB_HISTORY_STATUS, MB_REG_U16, 1, 1.0f, "status", "0-2"),
+    MB_CUSTOM(MB_HISTORY_RECORD, MB_REG_U16, 1, 1.0f, "record", "record"),
+    MB_CUSTOM(MB_HISTORY_AVAILABLE, MB_REG_U16, 1, 1.0f, "available", "count"),
+    MB_CUSTOM(MB_HISTORY_RECORD_REGS, MB_REG_U16, 1, 1.0f, "recordRegisters", "count"),
+    MB_CUSTOM(MB_HISTORY_OLDEST_RECORD, MB_REG_U16, 1, 1.0f, "oldestRecord", "record"),
+    MB_CUSTOM(MB_HISTORY_COUNT, MB_REG_U16, 1, 1.0f, "records", "count"),
+    MB_CUSTOM(MB_HISTORY_OLDEST_TIME, MB_REG_U32, 1, 1.0f, "oldestTime", "s"),
+    MB_CUSTOM(MB_HISTORY_NEWEST_TIME, MB_REG_U32, 1, 1.0f, "newestTime", "s"),
+    MB_CUSTOM(MB_HISTORY_TIME_BASE, MB_REG_U16, 1, 1.0f, "timeEpoch", "bool"),
+    MB_CUSTOM(MB_HISTORY_QUERIES, MB_REG_U16, 1, 1.0f, "queries", "count")
+};
+
+#define MB_BANK(name, base, size, header, table) { name, (uint16_t)(base), (uint16_t)(size), header, table, \
+    (uint16_t)(sizeof(table) / sizeof(table[0])) }
+
+static constexpr ModbusBankDef modbusMapBanks[] = {
+    MB_BANK("solar", MODBUS_BASE_SOLAR, REG_COUNT_SOLAR, true, solarRegisters),
+    MB_BANK("opcn3", MODBUS_BASE_OPCN3, REG_COUNT_OPCN3, true, opcn3Registers),
+    MB_BANK("control", MODBUS_BASE_CONTROL, 3, false, controlRegisters),
+    MB_BANK("i2c", MODBUS_BASE_I2C, REG_COUNT_I2C - 3, true, i2cRegisters),
+    MB_BANK("ips", MODBUS_BASE_IPS, REG_COUNT_IPS, true, ipsRegisters),
+    MB_BANK("mcp3424", MODBUS_BASE_MCP3424, REG_COUNT_MCP3424, true, mcp3424Registers),
+    MB_BANK("ads1110", MODBUS_BASE_ADS1110, REG_COUNT_ADS1110, true, ads1110Registers),
+    MB_BANK("ina219", MODBUS_BASE_INA219, REG_COUNT_INA219, true, ina219Registers),
+    MB_BANK("sps30", MODBUS_BASE_SPS30, REG_COUNT_SPS30, true, sps30Registers),
+    MB_BANK("sht40", MODBUS_BASE_SHT40, REG_COUNT_SHT40, true, sht40Registers),
+    MB_BANK("hcho", MODBUS_BASE_HCHO, REG_COUNT_HCHO, true, hchoRegisters),
+    MB_BANK("calibration", MODBUS_BASE_CALIBRATION, REG_COUNT_CALIBRATION, true, calibrationRegisters),
+    MB_BANK("diagnostics", MODBUS_DIAG_BASE_REG, REG_COUNT_MODBUS_DIAG, false, diagnosticsRegisters),
+    MB_BANK("history", MODBUS_HISTORY_BASE_REG, REG_COUNT_MODBUS_HISTORY, false, historyRegisters)
+};
+
+// ===== Kontrole w czasie kompilacji =====
+
+constexpr uint8_t registerWords(uint8_t regType) {
+    return (regType == MB_REG_U32 || regType == MB_REG_I32) ? 2 : 1;
+}
+
+constexpr bool fieldsFit(const ModbusRegisterDef* fields, size_t count, uint16_t size, uint16_t first) {
+    return count == 0 ||
+           (fields[0].reg >= first && fields[0].reg + fields[0].count * registerWords(fields[0].regType) <= size &&
+            fieldsFit(fields + 1, count - 1, size, first));
+}
+
+constexpr bool banksFit(const ModbusBankDef* banks, size_t count) {
+    return count == 0 ||
+           (banks[0].base + banks[0].size <= MODBUS_REG_TOTAL &&
+            fieldsFit(banks[0].fields, banks[0].fieldCount, banks[0].size, banks[0].header ? MODBUS_HEADER_REGS : 0) &&
+            banksFit(banks + 1, count - 1));
+}
+
+static_assert(sizeof(modbusMapBanks) / sizeof(modbusMapBanks[0]) == MAP_BANK_COUNT, "modbusMapBanks size");
+static_assert(banksFit(modbusMapBanks, MAP_BANK_COUNT), "Rejestr poza swoim blokiem albo nagłówkiem bloku");
+
+// ===== Updater =====
+
+const ModbusBankDef& getModbusBankDef(ModbusMapBank bank) {
+    return modbusMapBanks[bank < MAP_BANK_COUNT ? bank : 0];
+}
+
+static size_t sourceSize(uint8_t type) {
+    switch (type) {
+        case MB_SRC_U8: case MB_SRC_I8: case MB_SRC_BOOL: return 1;
+        case MB_SRC_U16: case MB_SRC_I16: return 2;
+        case MB_SRC_U64: case MB_SRC_I64: return 8;
+        default: return 4;
+    }
+}
+
+static int64_t readInteger(const uint8_t* p, uint8_t type) {
+    switch (type) {
+        case MB_SRC_U8: return *p;
+        case MB_SRC_I8: return (int8_t)*p;
+        case MB_SRC_BOOL: return *p ? 1 : 0;
+        case MB_SRC_U16: { uint16_t v; memcpy(&v, p, 2); return v; }
+        case MB_SRC_I16: { int16_t v; memcpy(&v, p, 2); return v; }
+        case MB_SRC_U32: { uint32_t v; memcpy(&v, p, 4); return v; }
+        case MB_SRC_I32: { int32_t v; memcpy(&v, p, 4); return v; }
+        case MB_SRC_U64: { uint64_t v; memcpy(&v, p, 8); return (int64_t)v; }
+        case MB_SRC_I64: { int64_t v; memcpy(&v, p, 8); return v; }
+        default: return 0;
+    }
+}
+
+// Rzutowania jak w dotychczasowych updateModbus*Registers(): (uint16_t)(x * skala), (int16_t)(...)
+static void stageValue(const ModbusRegisterDef& field, const uint8_t* p, uint16_t* out, unsigned long now) {
+    uint32_t word;
+    if (field.regType == MB_REG_AGE) {
+        out[0] = (uint16_t)((now - (unsigned long)readInteger(p, field.sourceType)) / 1000);
+        return;
+    }
+    if (field.sourceType == MB_SRC_F32) {
+        float value;
+        memcpy(&value, p, sizeof(value));
+        value *= field.scale;
+        switch (field.regType) {
+            case MB_REG_U16: out[0] = (uint16_t)value; return;
+            case MB_REG_I16: out[0] = (uint16_t)(int16_t)value; return;
+            case MB_REG_U32: word = (uint32_t)value; break;
+            default:         word = (uint32_t)(int32_t)value; break;
+        }
+    } else {
+        int64_t value = readInteger(p, field.sourceType);
+        if (field.scale != 1.0f) value = (int64_t)(value * field.scale);
+        if (field.regType == MB_REG_U16 || field.regType == MB_REG_I16) {
+            out[0] = (uint16_t)value;
+            return;
+        }
+        word = (uint32_t)value;
+    }
+    out[0] = word & 0xFFFF;
+    out[1] = (word >> 16) & 0xFFFF;
+}
+
+void stageModbusFields(ModbusMapBank bank, const void* data, uint16_t* image) {
+    const ModbusBankDef& def = getModbusBankDef(bank);
+    const uint8_t* base = (const uint8_t*)data;
+    unsigned long now = millis();
+
+    for (uint16_t i = 0; i < def.fieldCount; i++) {
+        const ModbusRegisterDef& field = def.fields[i];
+        if (field.sourceType == MB_SRC_NONE) continue;
+
+        uint16_t* out = image + def.base + field.reg;
+        uint8_t words = registerWords(field.regType);
+        if (field.gate != MB_NO_GATE && !base[field.gate]) {
+            memset(out, 0, field.count * words * sizeof(uint16_t));
+            continue;
+        }
+
+        size_t stride = sourceSize(field.sourceType);
+        for (uint8_t n = 0; n < field.count; n++) {
+            stageValue(field, base + field.source + n * stride, out + n * words, now);
+        }
+    }
+}
+
+// ===== Mapa JSON =====
+
+static const char* regTypeName(uint8_t regType) {
+    switch (regType) {
+        case MB_REG_I16: return "i16";
+        case MB_REG_U32: return "u32";
+        case MB_REG_I32: return "i32";
+        case MB_REG_AGE: return "age";
+        default:         return "u16";
+    }
+}
+
+static void addMapRegister(JsonArray registers, uint16_t address, const char* name, uint8_t regType,
+                           uint8_t count, float scale, const char* unit) {
+    JsonObject reg = registers.createNestedObject();
+    reg["address"] = address;
+    reg["name"] = name;
+    reg["type"] = regTypeName(regType);
+    if (count > 1) reg["count"] = count;
+    if (scale != 1.0f) reg["scale"] = scale;
+    if (unit[0]) reg["unit"] = unit;
+}
+
+void getModbusMapJson(JsonObject root) {
+    root["registers"] = MODBUS_REG_TOTAL;
+    root["wordOrder"] = "lowFirst";
+    JsonArray banks = root.createNestedArray("banks");
+
+    for (size_t b = 0; b < MAP_BANK_COUNT; b++) {
+        const ModbusBankDef& def = modbusMapBanks[b];
+        JsonObject bank = banks.createNestedObject();
+        bank["name"] = def.name;
+        bank["base"] = def.base;
+        bank["size"] = def.size;
+
+        JsonArray registers = bank.createNestedArray("registers");
+        if (def.header) {
+            addMapRegister(registers, def.base, "status", MB_REG_U16, 1, 1.0f, "bool");
+            addMapRegister(registers, def.base + 1, "dataType", MB_REG_U16, 1, 1.0f, "0-2");
+            addMapRegister(registers, def.base + 2, "timestamp", MB_REG_U32, 1, 1.0f, "ms");
+        }
+        for (uint16_t i = 0; i < def.fieldCount; i++) {
+            const ModbusRegisterDef& field = def.fields[i];
+            addMapRegister(registers, def.base + field.reg, field.name, field.regType, field.count, field.scale, field.unit);
+        }
+    }
+
+    // Banki cienia: ten sam układ bloków czujników pod base + stride * typ danych
+    JsonObject shadow = root.createNestedObject("shadow");
+    shadow["base"] = MODBUS_SHADOW_BASE;
+    shadow["stride"] = MODBUS_SHADOW_STRIDE;
+    shadow["size"] = MODBUS_SHADOW_SIZE;
+    JsonArray types = shadow.createNestedArray("dataTypes");
+    types.add("current");
+    types.add("fast");
+    types.add("slow");
+
+    // Pliki FC 0x14 - tylko bufory historii dostępne w tej chwili
+    getModbusHistoryFilesJson(root.createNestedArray("files"));
+}
@@ -0,0 +1,190 @@
+#include <modbus_pdu.h>
+
+static inline uint16_t readWord(const uint8_t* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline void writeWord(uint8_t* p, uint16_t value) {
+    p[0] = value >> 8;
+    p[1] = value & 0xFF;
+}
+
+static size_t exceptionResponse(uint8_t function, uint8_t code, uint8_t* response, uint8_t* exception) {
+    response[0] = function | 0x80;
+    response[1] = code;
+    if (exception) *exception = code;
+    return 2;
+}
+
+// FC 0x14: kilka pododczytów (plik, rekord, długość) w jednym żądaniu - odpowiedź musi
+// zmieścić się w jednym PDU (~124 rejestry łącznie)
+static size_t readFileRecord(const uint8_t* request, size_t length, uint8_t* response,
+                             const ModbusRegisterAccess& access, uint8_t* exception) {
+    uint8_t function = request[0];
+    if (length < 2) return exceptionResponse(function, MODBUS_EX_ILLEGAL_VALUE, response, exception);
+    uint8_t bytes = request[1];
+    if (bytes < MODBUS_FILE_SUBREQUEST_SIZE || bytes % MODBUS_FILE_SUBREQUEST_SIZE != 0 || length != 2u + bytes) {
+        return exceptionResponse(function, MODBUS_EX_ILLEGAL_VALUE, response, exception);
+    }
+
+    // Rozmiar odpowiedzi przed odczytem - bez częściowych odpowiedzi
+    size_t responseLength = 2;
+    for (size_t offset = 2; offset < length; offset += MODBUS_FILE_SUBREQUEST_SIZE) {
+        responseLength += 2 + readWord(request + offset + 5) * 2;
+    }
+    if (responseLength > MODBUS_MAX_PDU) return exceptionResponse(function, MODBUS_EX_ILLEGAL_VALUE, response, exception);
+
+    uint16_t values[MODBUS_MAX_READ_REGS];
+    uint8_t* out = response + 2;
+    for (size_t offset = 2; offset < length; offset += MODBUS_FILE_SUBREQUEST_SIZE) {
+        const uint8_t* sub = request + offset;
+        uint16_t file = readWord(sub + 1);
+        uint16_t record = readWord(sub + 3);
+        uint16_t count = readWord(sub + 5);
+        if (sub[0] != MODBUS_FILE_REFERENCE_TYPE || file == 0 || record > MODBUS_MAX_FILE_RECORD || count == 0) {
+            return exceptionResponse(function, MODBUS_EX_ILLEGAL_ADDRESS, response, exception);
+        }
+        uint8_t code = access.readFile(file, record, count, values);
+        if (code != MODBUS_EX_NONE) return exceptionResponse(function, code, response, exception);
+
+        *out++ = 1 + count * 2;
+        *out++ = MODBUS_FILE_REFERENCE_TYPE;
+        for (uint16_t i = 0; i < count; i++, out += 2) {
+            writeWord(out, values[i]);
+        }
+    }
+    response[0] = function;
+    response[1] = responseLength - 2;
+    return responseLength;
+}
+
+size_t processModbusPdu(const uint8_t* request, size_t length, uint8_t* response,
+                        const ModbusRegisterAccess& access, uint8_t* exception) {
+    if (exception) *exception = MODBUS_EX_NONE;
+    if (length < 1) return 0;
+
+    uint8_t function = request[0];
+    uint16_t values[MODBUS_MAX_READ_REGS];
+
+    switch (function) {
+        case MODBUS_FC_READ_HOLDING: {
+            if (length != 5) return exceptionResponse(function, MODBUS_EX_ILLEGAL_VALUE, response, exception);
+            uint16_t start = readWord(request + 1);
+            uint16_t count = readWord(request + 3);
+            if (count < 1 || count > MODBUS_MAX_READ_REGS) {
+                return exceptionResponse(function, MODBUS_EX_ILLEGAL_VALUE, response, exception);
+            }
+            uint8_t code = access.read(start, count, values);
+            if (code != MODBUS_EX_NONE) return exceptionResponse(function, code, response, exception);
+
+            response[0] = function;
+            response[1] = count * 2;
+            for (uint16_t i = 0; i < count; i++) {
+                writeWord(response + 2 + i * 2, values[i]);
+            }
+            return 2 + count * 2;
+        }
+
+        case MODBUS_FC_WRITE_SINGLE: {
+            if (length != 5) return exceptionResponse(function, MODBUS_EX_ILLEGAL_VALUE, response, exception);
+            uint16_t reg = readWord(request + 1);
+            values[0] = readWord(request + 3);
+            uint8_t code = access.write(reg, 1, values);
+            if (code != MODBUS_EX_NONE) return exceptionResponse(function, code, response, exception);
+
+            // Echo żądania
+            for (size_t i = 0; i < 5; i++) response[i] = request[i];
+            return 5;
+        }
+
+        case MODBUS_FC_WRITE_MULTIPLE: {
+            if (length < 6) return exceptionResponse(function, MODBUS_EX_ILLEGAL_VALUE, response, exception);
+            uint16_t start = readWord(request + 1);
+            uint16_t count = readWord(request + 3);
+            uint8_t bytes = request[5];
+            if (count < 1 || count > MODBUS_MAX_WRITE_REGS || bytes != count * 2 || length != 6u + bytes) {
+                return exceptionResponse(function, MODBUS_EX_ILLEGAL_VALUE, response, exception);
+            }
+            for (uint16_t i = 0; i < count; i++) {
+                values[i] = readWord(request + 6 + i * 2);
+            }
+            uint8_t code = access.write(start, count, values);
+            if (code != MODBUS_EX_NONE) return exceptionResponse(function, code, response, exception);
+
+            response[0] = function;
+            writeWord(response + 1, start);
+            writeWord(response + 3, count);
+            return 5;
+        }
+
+        case MODBUS_FC_READ_FILE_RECORD:
+            if (access.readFile == NULL) return exceptionResponse(function, MODBUS_EX_ILLEGAL_FUNCTION, response, exception);
+            return readFileRecord(request, length, response, access, exception);
+
+        default:
+            return exceptionResponse(function, MODBUS_EX_ILLEGAL_FUNCTION, response, exception);
+    }
+}
+
+ModbusTcpFrame processModbusTcpAdu(const uint8_t* rx, size_t length, size_t& consumed,
+                                   uint8_t* tx, size_t& txLength,
+                                   const ModbusRegisterAccess& access, uint8_t* exception) {
+    consumed = 0;
+    txLength = 0;
+    if (length < MODBUS_TCP_MBAP_SIZE) return MBTCP_INCOMPLETE;
+
+    uint16_t protocol = readWord(rx + 2);
+    uint16_t frameLength = readWord(rx + 4);    // unit id + PDU
+    if (protocol != 0 || frameLength < 2 || frameLength > MODBUS_MAX_PDU + 1) return MBTCP_INVALID;
+
+    size_t aduLength = MODBUS_TCP_MBAP_SIZE - 1 + frameLength;
+    if (length < aduLength) return MBTCP_INCOMPLETE;
+
+    // Unit id bez znaczenia dla serwera TCP (bez bramki RTU) - odsyłany bez zmian
+    size_t pduLength = processModbusPdu(rx + MODBUS_TCP_MBAP_SIZE, frameLength - 1,
+                                        tx + MODBUS_TCP_MBAP_SIZE, access, exception);
+    tx[0] = rx[0];
+    tx[1] = rx[1];
+    writeWord(tx + 2, 0);
+    writeWord(tx + 4, (uint16_t)(pduLength + 1));
+    tx[6] = rx[6];
+
+    consumed = aduLength;
+    txLength = MODBUS_TCP_MBAP_SIZE + pduLength;
+    return MBTCP_RESPONSE;
+}
+
+uint16_t modbusCrc16(const uint8_t* data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    while (length--) {
+        crc ^= *data++;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+        }
+    }
+    return crc;
+}
+
+ModbusRtuFrame processModbusRtuFrame(const uint8_t* rx, size_t length, uint8_t slaveId,
+                                     uint8_t* tx, size_t& txLength,
+                                     const ModbusRegisterAccess& access, uint8_t* exception) {
+    txLength = 0;
+    if (exception) *exception = MODBUS_EX_NONE;
+    if (length < 4 || length > MODBUS_RTU_MAX_ADU) return MBRTU_INVALID;
+
+    uint16_t crc = modbusCrc16(rx, length - 2);
+    if (rx[length - 2] != (crc & 0xFF) || rx[length - 1] != (crc >> 8)) return MBRTU_CRC_ERROR;
+
+    uint8_t address = rx[0];
+    if (address != slaveId && address != MODBUS_RTU_BROADCAST) return MBRTU_NO_RESPONSE;
+
+    size_t pduLength = processModbusPdu(rx + 1, length - 3, tx + 1, access, exception);
+    if (address == MODBUS_RTU_BROADCAST) return MBRTU_NO_RESPONSE;
+
+    tx[0] = address;
+    crc = modbusCrc16(tx, 1 + pduLength);
+    tx[1 + pduLength] = crc & 0xFF;
+    tx[2 + pduLength] = crc >> 8;
+    txLength = 3 + pduLength;
+    return MBRTU_RESPONSE;
+}
@@ -0,0 +1,163 @@
+#include <modbus_tcp.h>
+#include <modbus_handler.h>
+#include <modbus_history.h>
+#include <config.h>
+#include <AsyncTCP.h>
+
+// Forward declarations for safe printing functions
+void safePrint(const String& message);
+void safePrintln(const String& message);
+
+extern FeatureConfig config;
+
+// Slot połączenia - bufor odbioru alokowany przy połączeniu.
+// Wszystkie callbacki AsyncTCP wykonuje jeden task (async_tcp), więc sloty i liczniki
+// nie potrzebują blokad; obraz rejestrów chroni mutex w readModbusImage/writeModbusImage.
+struct ModbusTcpConnection {
+    AsyncClient* client;
+    uint8_t* rx;
+    size_t rxLength;
+    bool closing;
+};
+
+static AsyncServer* modbusTcpServer = NULL;
+static ModbusTcpConnection modbusTcpConnections[MODBUS_TCP_MAX_CLIENTS];
+static ModbusTcpStats modbusTcpStats = {};
+static const ModbusRegisterAccess modbusTcpAccess = { readModbusImage, writeModbusImage, readModbusHistoryFile };
+
+static void dropConnection(ModbusTcpConnection& conn) {
+    conn.closing = true;
+    conn.rxLength = 0;
+    modbusTcpStats.frameErrors++;
+    conn.client->close();
+}
+
+// Ramki z bufora po kolei, dopóki odpowiedź zmieści się w buforze wysyłki TCP.
+// Reszta czeka w rx na potwierdzenie wysłanych danych (onAck).
+static void serveConnection(ModbusTcpConnection& conn) {
+    static uint8_t tx[MODBUS_TCP_MAX_ADU];
+    size_t offset = 0;
+    uint32_t served = 0;
+
+    while (offset < conn.rxLength && conn.client->space() >= MODBUS_TCP_MAX_ADU) {
+        size_t consumed;
+        size_t txLength;
+        uint8_t exception;
+        ModbusTcpFrame frame = processModbusTcpAdu(conn.rx + offset, conn.rxLength - offset, consumed,
+                                                   tx, txLength, modbusTcpAccess, &exception);
+        if (frame == MBTCP_INCOMPLETE) break;
+        if (frame == MBTCP_INVALID) {
+            dropConnection(conn);
+            return;
+        }
+
+        conn.client->add((const char*)tx, txLength);
+        offset += consumed;
+        served++;
+        modbusTcpStats.requests++;
+        if (exception != MODBUS_EX_NONE) modbusTcpStats.exceptions++;
+    }
+
+    if (offset > 0) {
+        conn.rxLength -= offset;
+        memmove(conn.rx, conn.rx + offset, conn.rxLength);
+    }
+    if (served > 0) {
+        conn.client->send();
+        if (served > modbusTcpStats.maxPipelined) modbusTcpStats.maxPipelined = served;
+    }
+}
+
+static void onModbusTcpData(void* arg, AsyncClient* client, void* data, size_t len) {
+    ModbusTcpConnection& conn = *(ModbusTcpConnection*)arg;
+    if (conn.closing) return;
+
+    // Klient wysyła szybciej, niż odbiera odpowiedzi - bufor pełny
+    if (conn.rxLength + len > MODBUS_TCP_RX_BUFFER) {
+        dropConnection(conn);
+        return;
+    }
+    memcpy(conn.rx + conn.rxLength, data, len);
+    conn.rxLength += len;
+    serveConnection(conn);
+}
+
+static void onModbusTcpAck(void* arg, AsyncClient* client, size_t len, uint32_t time) {
+    ModbusTcpConnection& conn = *(ModbusTcpConnection*)arg;
+    if (!conn.closing && conn.rxLength > 0) serveConnection(conn);
+}
+
+static void onModbusTcpDisconnect(void* arg, AsyncClient* client) {
+    ModbusTcpConnection* conn = (ModbusTcpConnection*)arg;
+    if (conn) {
+        free(conn->rx);
+        conn->rx = NULL;
+        conn->rxLength = 0;
+        conn->client = NULL;
+        modbusTcpStats.clients--;
+    }
+    delete client;
+}
+
+static void rejectModbusTcpClient(AsyncClient* client) {
+    modbusTcpStats.rejected++;
+    client->onDisconnect(onModbusTcpDisconnect, NULL);
+    client->close();
+}
+
+static void onModbusTcpClient(void* arg, AsyncClient* client) {
+    ModbusTcpConnection* conn = NULL;
+    for (size_t i = 0; i < MODBUS_TCP_MAX_CLIENTS; i++) {
+        if (modbusTcpConnections[i].client == NULL) {
+            conn = &modbusTcpConnections[i];
+            break;
+        }
+    }
+    if (conn == NULL) {
+        rejectModbusTcpClient(client);
+        return;
+    }
+
+    conn->rx = (uint8_t*)malloc(MODBUS_TCP_RX_BUFFER);
+    if (conn->rx == NULL) {
+        rejectModbusTcpClient(client);
+        return;
+    }
+    conn->client = client;
+    conn->rxLength = 0;
+    conn->closing = false;
+    modbusTcpStats.clients++;
+    modbusTcpStats.connections++;
+
+    client->setNoDelay(true);
+    client->setRxTimeout(MODBUS_TCP_IDLE_TIMEOUT);
+    client->onData(onModbusTcpData, conn);
+    client->onAck(onModbusTcpAck, conn);
+    client->onDisconnect(onModbusTcpDisconnect, conn);
+}
+
+void initializeModbusTcp() {
+    if (modbusTcpServer || !config.enableModbus || !config.enableWiFi) return;
+
+    modbusTcpServer = new AsyncServer(MODBUS_TCP_PORT);
+    modbusTcpServer->setNoDelay(true);
+    modbusTcpServer->onClient(onModbusTcpClient, NULL);
+    modbusTcpServer->begin();
+
+    safePrintln("Modbus TCP server on port " + String(MODBUS_TCP_PORT) + " (max " +
+                String(MODBUS_TCP_MAX_CLIENTS) + " clients)");
+}
+
+void getModbusTcpStats(ModbusTcpStats& stats) {
+    stats = modbusTcpStats;
+}
+
+String getModbusTcpStatus() {
+    if (!modbusTcpServer) return "- Modbus TCP: not started\n";
+    ModbusTcpStats stats;
+    getModbusTcpStats(stats);
+    return "- Modbus TCP: port " + String(MODBUS_TCP_PORT) + ", " + String(stats.clients) + "/" +
+           String(MODBUS_TCP_MAX_CLIENTS) + " clients, " + String(stats.requests) + " requests (" +
+           String(stats.exceptions) + " exceptions), " + String(stats.frameErrors) + " frame errors, " +
+           String(stats.rejected) + " rejected, max " + String(stats.maxPipelined) + " pipelined\n";
+}
@@ -3,7 +3,7 @@
 #include <ArduinoJson.h>
 #include <WiFi.h>
 #include <network_config.h>
-#include <Wire.h>
+#include <i2c_bus.h>
 
 // Global network configuration
 NetworkConfig networkConfig;
@@ -447,7 +447,7 @@ bool saveMCP3424Config(const MCP3424Config& config) {
         return false;
     }
     
-    DynamicJsonDocument doc(2048); // 2KB for MCP3424 config
+    DynamicJsonDocument doc(3072); // 3KB for MCP3424 config (z rozdzielczością kanałów)
     doc["deviceCount"] = config.deviceCount;
     doc["configValid"] = true;
     
@@ -461,6 +461,10 @@ bool saveMCP3424Config(const MCP3424Config& config) {
         device["description"] = config.devices[i].description;
         device["enabled"] = config.devices[i].enabled;
         device["autoDetected"] = config.devices[i].autoDetected;
+        JsonArray resolution = device.createNestedArray("resolution");
+        for (uint8_t ch = 0; ch < 4; ch++) {
+            resolution.add(config.devices[i].resolution[ch]);
+        }
     }
     
     size_t bytesWritten = serializeJson(doc, file);
@@ -475,6 +479,11 @@ bool saveMCP3424Config(const MCP3424Config& config) {
     return true;
 }
 
+// Rozdzielczość kanału MCP3424 - 12/14/16/18, inne wartości na 18 bit
+uint8_t validMCP3424Resolution(int bits) {
+    return (bits == 12 || bits == 14 || bits == 16) ? (uint8_t)bits : 18;
+}
+
 // Load MCP3424 configuration from LittleFS
 bool loadMCP3424Config(MCP3424Config& config) {
     if (!LittleFS.exists(MCP3424_CONFIG_FILE)) {
@@ -488,7 +497,7 @@ bool loadMCP3424Config(MCP3424Config& config) {
         return false;
     }
     
-    DynamicJsonDocument doc(2048);
+    DynamicJsonDocument doc(3072);
     DeserializationError error = deserializeJson(doc, file);
     file.close();
     
@@ -513,6 +522,9 @@ bool loadMCP3424Config(MCP3424Config& config) {
         strcpy(config.devices[i].description, "");
         config.devices[i].enabled = false;
         config.devices[i].autoDetected = false;
+        for (uint8_t ch = 0; ch < 4; ch++) {
+            config.devices[i].resolution[ch] = 18;
+        }
     }
     
     // Load devices from JSON array
@@ -528,6 +540,11 @@ bool loadMCP3424Config(MCP3424Config& config) {
             strlcpy(config.devices[deviceIndex].description, device["description"] | "", sizeof(config.devices[deviceIndex].description));
             config.devices[deviceIndex].enabled = device["enabled"] | false;
             config.devices[deviceIndex].autoDetected = device["autoDetected"] | false;
+            // Brak tablicy (starszy plik) = 18 bit na wszystkich kanałach
+            JsonArray resolution = device["resolution"];
+            for (uint8_t ch = 0; ch < 4 && ch < resolution.size(); ch++) {
+                config.devices[deviceIndex].resolution[ch] = validMCP3424Resolution(resolution[ch] | 18);
+            }
         }
     }
     
@@ -559,7 +576,7 @@ bool loadMCP3424Config(MCP3424Config& config) {
 
 // Get MCP3424 configuration as JSON
 String getMCP3424ConfigJson() {
-    DynamicJsonDocument doc(2048);
+    DynamicJsonDocument doc(3072);
     
     doc["deviceCount"] = mcp3424Config.deviceCount;
     doc["configValid"] = mcp3424Config.configValid;
@@ -574,6 +591,10 @@ String getMCP3424ConfigJson() {
         device["description"] = mcp3424Config.devices[i].description;
         device["enabled"] = mcp3424Config.devices[i].enabled;
         device["autoDetected"] = mcp3424Config.devices[i].autoDetected;
+        JsonArray resolution = device.createNestedArray("resolution");
+        for (uint8_t ch = 0; ch < 4; ch++) {
+            resolution.add(mcp3424Config.devices[i].resolution[ch]);
+        }
     }
     
     String json;
@@ -664,6 +685,9 @@ bool addMCP3424DeviceWithAddress(uint8_t deviceIndex, uint8_t i2cAddress, const
     strlcpy(device.description, description, sizeof(device.description));
     device.enabled = enabled;
     device.autoDetected = false; // Will be set during I2C scan
+    for (uint8_t ch = 0; ch < 4; ch++) {
+        device.resolution[ch] = 18;
+    }
     
     mcp3424Config.deviceCount++;
     
@@ -803,10 +827,7 @@ void scanAndMapMCP3424Devices() {
         safePrint(String(addr, HEX));
         safePrint("... ");
         
-        Wire.beginTransmission(addr);
-        uint8_t result = Wire.endTransmission();
-        
-        if (result == 0) {
+        if (i2cBusProbe(addr)) {
             safePrintln("FOUND");
             // Device found - update detection status
             updateMCP3424DeviceDetection(addr, true);
@@ -0,0 +1,292 @@
+#include <response_cache.h>
+#include <esp_heap_caps.h>
+#include <fnv_hash.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// Forward declarations for safe printing functions
+void safePrint(const String& message);
+void safePrintln(const String& message);
+
+struct ResponseCacheEntry {
+    bool valid;
+    uint32_t keyHash;
+    char key[RESPONSE_CACHE_KEY_LEN];
+    uint32_t generation;
+    uint32_t meta;
+    uint32_t lastUse;      // licznik LRU
+    uint32_t writeToken;   // != 0 - wpis zapisywany fragmentami (ResponseCacheWriter), jeszcze nieważny
+    size_t length;
+    size_t capacity;
+    char* data;            // PSRAM
+};
+
+static ResponseCacheEntry responseCache[RESPONSE_CACHE_ENTRIES];
+static SemaphoreHandle_t responseCacheMutex = nullptr;
+static uint32_t responseCacheClock = 0;
+static uint32_t responseCacheWriteTokens = 0;
+
+// Statystyki
+static uint32_t responseCacheHits = 0;
+static uint32_t responseCacheMisses = 0;
+static uint32_t responseCacheStale = 0;      // wpis był, ale z poprzedniej generacji
+static uint32_t responseCacheStores = 0;
+static uint32_t responseCacheEvictions = 0;
+static uint32_t responseCacheOversize = 0;
+
+static int findCacheEntry(const char* key, uint32_t hash) {
+    for (int i = 0; i < RESPONSE_CACHE_ENTRIES; i++) {
+        if (responseCache[i].valid && responseCache[i].keyHash == hash && strcmp(responseCache[i].key, key) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Ten sam klucz, wolny wpis albo najdawniej użyty; wywołanie pod responseCacheMutex.
+// Przejęty wpis traci zapis fragmentami, jeśli był w toku (writeToken = 0)
+static int allocateCacheEntry(const char* key, uint32_t hash) {
+    int index = findCacheEntry(key, hash);
+    if (index < 0) {
+        uint32_t oldest = UINT32_MAX;
+        for (int i = 0; i < RESPONSE_CACHE_ENTRIES; i++) {
+            if (!responseCache[i].valid && !responseCache[i].writeToken) {
+                index = i;
+                break;
+            }
+            if (responseCache[i].lastUse < oldest) {
+                oldest = responseCache[i].lastUse;
+                index = i;
+            }
+        }
+        if (responseCache[index].valid) {
+            responseCacheEvictions++;
+        }
+    }
+    ResponseCacheEntry& entry = responseCache[index];
+    entry.valid = false;
+    entry.writeToken = 0;
+    strncpy(entry.key, key, RESPONSE_CACHE_KEY_LEN - 1);
+    entry.key[RESPONSE_CACHE_KEY_LEN - 1] = '\0';
+    entry.keyHash = hash;
+    entry.length = 0;
+    entry.lastUse = ++responseCacheClock;
+    return index;
+}
+
+// Bufor rośnie tylko w górę - bez ponownych alokacji przy podobnych rozmiarach
+static bool reserveCacheEntry(ResponseCacheEntry& entry, size_t size) {
+    if (entry.capacity >= size) return true;
+    char* data = (char*)heap_caps_realloc(entry.data, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!data) return false;
+    entry.data = data;
+    entry.capacity = size;
+    return true;
+}
+
+bool initializeResponseCache() {
+    if (responseCacheMutex) return true;
+
+    responseCacheMutex = xSemaphoreCreateMutex();
+    if (!responseCacheMutex) {
+        safePrintln("Response cache: failed to create mutex");
+        return false;
+    }
+    memset(responseCache, 0, sizeof(responseCache));
+    return true;
+}
+
+bool responseCacheGet(const String& key, uint32_t generation, String& out, uint32_t* meta) {
+    if (!responseCacheMutex || key.length() >= RESPONSE_CACHE_KEY_LEN) return false;
+
+    uint32_t hash = fnv1aString(key.c_str());
+    bool hit = false;
+
+    xSemaphoreTake(responseCacheMutex, portMAX_DELAY);
+    int index = findCacheEntry(key.c_str(), hash);
+    if (index >= 0 && responseCache[index].generation == generation) {
+        ResponseCacheEntry& entry = responseCache[index];
+        entry.lastUse = ++responseCacheClock;
+        out = "";
+        if (out.reserve(entry.length)) {
+            out.concat(entry.data, entry.length);
+            if (meta) *meta = entry.meta;
+            hit = true;
+        }
+    } else if (index >= 0) {
+        // Nieaktualna generacja - zwolnij wpis od razu
+        responseCache[index].valid = false;
+        responseCacheStale++;
+    }
+    if (hit) {
+        responseCacheHits++;
+    } else {
+        responseCacheMisses++;
+    }
+    xSemaphoreGive(responseCacheMutex);
+
+    return hit;
+}
+
+void responseCachePut(const String& key, uint32_t generation, const String& value, uint32_t meta) {
+    if (!responseCacheMutex || key.length() >= RESPONSE_CACHE_KEY_LEN) return;
+    if (value.length() > RESPONSE_CACHE_MAX_SIZE) {
+        responseCacheOversize++;
+        return;
+    }
+
+    uint32_t hash = fnv1aString(key.c_str());
+
+    xSemaphoreTake(responseCacheMutex, portMAX_DELAY);
+
+    ResponseCacheEntry& entry = responseCache[allocateCacheEntry(key.c_str(), hash)];
+    if (!reserveCacheEntry(entry, value.length())) {
+        xSemaphoreGive(responseCacheMutex);
+        return;
+    }
+
+    memcpy(entry.data, value.c_str(), value.length());
+    entry.length = value.length();
+    entry.generation = generation;
+    entry.meta = meta;
+    entry.lastUse = ++responseCacheClock;
+    entry.valid = true;
+    responseCacheStores++;
+
+    xSemaphoreGive(responseCacheMutex);
+}
+
+bool responseCacheGetBuffer(const String& key, uint32_t generation, char*& data, size_t& length, uint32_t* meta) {
+    if (!responseCacheMutex || key.length() >= RESPONSE_CACHE_KEY_LEN) return false;
+
+    uint32_t hash = fnv1aString(key.c_str());
+    bool hit = false;
+    data = nullptr;
+    length = 0;
+
+    xSemaphoreTake(responseCacheMutex, portMAX_DELAY);
+    int index = findCacheEntry(key.c_str(), hash);
+    if (index >= 0 && responseCache[index].generation == generation) {
+        ResponseCacheEntry& entry = responseCache[index];
+        entry.lastUse = ++responseCacheClock;
+        data = (char*)heap_caps_malloc(entry.length ? entry.length : 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (data) {
+            memcpy(data, entry.data, entry.length);
+            length = entry.length;
+            if (meta) *meta = entry.meta;
+            hit = true;
+        }
+    } else if (index >= 0) {
+        responseCache[index].valid = false;
+        responseCacheStale++;
+    }
+    if (hit) {
+        responseCacheHits++;
+    } else {
+        responseCacheMisses++;
+    }
+    xSemaphoreGive(responseCacheMutex);
+
+    return hit;
+}
+
+bool responseCacheBeginWrite(const String& key, uint32_t generation, uint32_t meta, ResponseCacheWriter& writer) {
+    writer.index = -1;
+    writer.token = 0;
+    if (!responseCacheMutex || key.length() >= RESPONSE_CACHE_KEY_LEN) return false;
+
+    uint32_t hash = fnv1aString(key.c_str());
+
+    xSemaphoreTake(responseCacheMutex, portMAX_DELAY);
+    int index = allocateCacheEntry(key.c_str(), hash);
+    ResponseCacheEntry& entry = responseCache[index];
+    if (++responseCacheWriteTokens == 0) responseCacheWriteTokens = 1;
+    entry.writeToken = responseCacheWriteTokens;
+    entry.generation = generation;
+    entry.meta = meta;
+    writer.index = index;
+    writer.token = entry.writeToken;
+    xSemaphoreGive(responseCacheMutex);
+    return true;
+}
+
+bool responseCacheAppend(ResponseCacheWriter& writer, const uint8_t* data, size_t length) {
+    if (writer.index < 0) return false;
+
+    bool ok = false;
+    xSemaphoreTake(responseCacheMutex, portMAX_DELAY);
+    ResponseCacheEntry& entry = responseCache[writer.index];
+    // Wpis przejęty przez inny zapis (LRU) albo odpowiedź za duża - zapis porzucony
+    if (entry.writeToken == writer.token) {
+        size_t needed = entry.length + length;
+        if (needed > RESPONSE_CACHE_MAX_SIZE) {
+            responseCacheOversize++;
+        } else {
+            // Podwajanie do RESPONSE_CACHE_MAX_SIZE - mało realokacji PSRAM przy zapisie fragmentami
+            size_t capacity = entry.capacity ? entry.capacity : 1024;
+            while (capacity < needed) capacity *= 2;
+            if (capacity > RESPONSE_CACHE_MAX_SIZE) capacity = RESPONSE_CACHE_MAX_SIZE;
+            if (reserveCacheEntry(entry, capacity)) {
+                memcpy(entry.data + entry.length, data, length);
+                entry.length = needed;
+                ok = true;
+            }
+        }
+        if (!ok) entry.writeToken = 0;
+    }
+    xSemaphoreGive(responseCacheMutex);
+
+    if (!ok) writer.index = -1;
+    return ok;
+}
+
+void responseCacheEndWrite(ResponseCacheWriter& writer, bool commit) {
+    if (writer.index < 0) return;
+
+    xSemaphoreTake(responseCacheMutex, portMAX_DELAY);
+    ResponseCacheEntry& entry = responseCache[writer.index];
+    if (entry.writeToken == writer.token) {
+        entry.writeToken = 0;
+        if (commit) {
+            entry.lastUse = ++responseCacheClock;
+            entry.valid = true;
+            responseCacheStores++;
+        }
+    }
+    xSemaphoreGive(responseCacheMutex);
+    writer.index = -1;
+}
+
+void responseCacheClear() {
+    if (!responseCacheMutex) return;
+
+    xSemaphoreTake(responseCacheMutex, portMAX_DELAY);
+    for (int i = 0; i < RESPONSE_CACHE_ENTRIES; i++) {
+        responseCache[i].valid = false;
+        responseCache[i].writeToken = 0;
+    }
+    xSemaphoreGive(responseCacheMutex);
+}
+
+float getResponseCacheHitRatio() {
+    uint32_t total = responseCacheHits + responseCacheMisses;
+    return total > 0 ? (float)responseCacheHits / total : 0.0f;
+}
+
+String getResponseCacheStatus() {
+    uint8_t used = 0;
+    size_t bytes = 0;
+    for (int i = 0; i < RESPONSE_CACHE_ENTRIES; i++) {
+        if (responseCache[i].valid) used++;
+        bytes += responseCache[i].capacity;
+    }
+
+    String status = "- Response cache: " + String(used) + "/" + String(RESPONSE_CACHE_ENTRIES) +
+                    " entries, " + String(bytes) + " bytes PSRAM\n";
+    status += "- Response cache hits: " + String(responseCacheHits) + "/" +
+              String(responseCacheHits + responseCacheMisses) + " (" +
+              String(getResponseCacheHitRatio() * 100.0f, 1) + "%), stale " + String(responseCacheStale) +
+              ", stores " + String(responseCacheStores) + ", evictions " + String(responseCacheEvictions) +
+              ", oversize " + String(responseCacheOversize) + "\n";
+    return status;
+}
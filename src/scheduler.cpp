@@ -0,0 +1,168 @@
+#include <scheduler.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <algorithm>
+#include <atomic>
+
+struct SchedulerJob {
+    SchedulerJobFunction function;
+    uint32_t periodMicros;
+    uint32_t deadline;          // micros() - porównania odporne na przepełnienie (różnica jako int32)
+    SchedulerJobStats stats;
+};
+
+static SchedulerJob jobs[SCHEDULER_MAX_JOBS];
+static uint8_t jobHeap[SCHEDULER_MAX_JOBS];     // indeksy zadań, kopiec minimalny po deadline
+static size_t jobCount = 0;
+static uint64_t schedulerSleepMicros = 0;
+static TaskHandle_t schedulerTask = NULL;
+static std::atomic<uint32_t> schedulerWakes(0);  // bit na zadanie, ustawiany z innych tasków
+
+static inline bool dueBefore(uint8_t a, uint8_t b) {
+    return (int32_t)(jobs[a].deadline - jobs[b].deadline) < 0;
+}
+
+static void siftUp(size_t pos) {
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (!dueBefore(jobHeap[pos], jobHeap[parent])) break;
+        std::swap(jobHeap[pos], jobHeap[parent]);
+        pos = parent;
+    }
+}
+
+static void siftDown(size_t pos) {
+    while (true) {
+        size_t smallest = pos;
+        size_t left = 2 * pos + 1;
+        size_t right = left + 1;
+        if (left < jobCount && dueBefore(jobHeap[left], jobHeap[smallest])) smallest = left;
+        if (right < jobCount && dueBefore(jobHeap[right], jobHeap[smallest])) smallest = right;
+        if (smallest == pos) break;
+        std::swap(jobHeap[pos], jobHeap[smallest]);
+        pos = smallest;
+    }
+}
+
+int addSchedulerJob(const char* name, uint32_t periodMs, SchedulerJobFunction function, uint32_t offsetMs) {
+    if (jobCount >= SCHEDULER_MAX_JOBS || periodMs == 0 || function == NULL) return -1;
+
+    size_t index = jobCount;
+    SchedulerJob& job = jobs[index];
+    job.function = function;
+    job.periodMicros = periodMs * 1000;
+    job.deadline = micros() + offsetMs * 1000;
+    memset(&job.stats, 0, sizeof(job.stats));
+    job.stats.name = name;
+    job.stats.periodMs = periodMs;
+
+    jobHeap[jobCount++] = (uint8_t)index;
+    siftUp(jobCount - 1);
+    schedulerTask = xTaskGetCurrentTaskHandle();
+    return (int)index;
+}
+
+void wakeSchedulerJob(int job) {
+    if (job < 0 || job >= SCHEDULER_MAX_JOBS) return;
+    schedulerWakes.fetch_or(1u << job, std::memory_order_relaxed);
+    if (schedulerTask) xTaskNotifyGive(schedulerTask);
+}
+
+// Obudzone zadania dostają termin "teraz"; kopiec budowany od nowa (najwyżej 24 elementy)
+static void applySchedulerWakes() {
+    uint32_t wakes = schedulerWakes.exchange(0, std::memory_order_relaxed);
+    if (!wakes) return;
+
+    uint32_t now = micros();
+    for (size_t i = 0; i < jobCount; i++) {
+        if (!(wakes & (1u << i)) || (int32_t)(jobs[i].deadline - now) <= 0) continue;
+        jobs[i].deadline = now;
+        jobs[i].stats.wakes++;
+    }
+    for (size_t i = jobCount / 2; i-- > 0;) {
+        siftDown(i);
+    }
+}
+
+static void recordRun(SchedulerJob& job, uint32_t lateness, uint32_t cpu) {
+    SchedulerJobStats& stats = job.stats;
+    stats.runs++;
+    stats.jitterLast = lateness;
+    if (lateness > stats.jitterMax) stats.jitterMax = lateness;
+    stats.jitterAvg += ((float)lateness - stats.jitterAvg) * 0.01f;
+    stats.cpuLast = cpu;
+    if (cpu > stats.cpuMax) stats.cpuMax = cpu;
+    stats.cpuTotal += cpu;
+}
+
+void runSchedulerJobs() {
+    applySchedulerWakes();
+
+    // Najwyżej jedno uruchomienie na zadanie - przy przeciążeniu loop() i tak wraca (watchdog)
+    for (size_t i = 0; i < jobCount; i++) {
+        uint8_t index = jobHeap[0];
+        SchedulerJob& job = jobs[index];
+        uint32_t start = micros();
+        int32_t lateness = (int32_t)(start - job.deadline);
+        if (lateness < -SCHEDULER_EARLY_MICROS) break;
+
+        job.function();
+        recordRun(job, lateness > 0 ? (uint32_t)lateness : 0, micros() - start);
+
+        // Następny termin w siatce okresu; terminy minione przed startem przepadają
+        if (lateness > 0 && (uint32_t)lateness >= job.periodMicros) {
+            uint32_t missed = (uint32_t)lateness / job.periodMicros;
+            job.deadline += missed * job.periodMicros;
+            job.stats.overruns++;
+            job.stats.skipped += missed;
+        }
+        job.deadline += job.periodMicros;
+        siftDown(0);
+    }
+}
+
+void sleepUntilNextSchedulerJob() {
+    int32_t wait = SCHEDULER_MAX_SLEEP * 1000;
+    if (jobCount > 0) {
+        int32_t untilDue = (int32_t)(jobs[jobHeap[0]].deadline - micros());
+        if (untilDue < wait) wait = untilDue;
+    }
+    if (wait < SCHEDULER_EARLY_MICROS) return;
+
+    // W górę do pełnego ticka - timeout kończy się do 1 ticka wcześniej (granica ticka)
+    uint32_t tickMicros = portTICK_PERIOD_MS * 1000;
+    uint32_t start = micros();
+    ulTaskNotifyTake(pdTRUE, (wait + tickMicros - 1) / tickMicros);
+    schedulerSleepMicros += micros() - start;
+}
+
+size_t getSchedulerJobCount() {
+    return jobCount;
+}
+
+bool getSchedulerJobStats(size_t index, SchedulerJobStats& stats) {
+    if (index >= jobCount) return false;
+    stats = jobs[index].stats;
+    return true;
+}
+
+uint64_t getSchedulerSleepMicros() {
+    return schedulerSleepMicros;
+}
+
+String getSchedulerStatus() {
+    uint64_t uptime = (uint64_t)millis() * 1000;
+    float idle = uptime ? 100.0f * (float)schedulerSleepMicros / (float)uptime : 0.0f;
+    String status = "- Scheduler: " + String((unsigned)jobCount) + " jobs, loop asleep " + String(idle, 1) + "% of uptime\n";
+
+    for (size_t i = 0; i < jobCount; i++) {
+        const SchedulerJobStats& stats = jobs[i].stats;
+        uint32_t cpuAvg = stats.runs ? (uint32_t)(stats.cpuTotal / stats.runs) : 0;
+        status += "- Job " + String(stats.name) + " (" + String(stats.periodMs) + " ms): " + String(stats.runs) +
+                  " runs (" + String(stats.wakes) + " woken), " + String(stats.overruns) + " overruns (" +
+                  String(stats.skipped) + " skipped), jitter avg " +
+                  String((uint32_t)stats.jitterAvg) + " us max " + String(stats.jitterMax) + " us, cpu avg " +
+                  String(cpuAvg) + " us max " + String(stats.cpuMax) + " us\n";
+    }
+    return status;
+}
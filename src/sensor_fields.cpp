@@ -0,0 +1,131 @@
+#include <sensor_fields.h>
+
+// Nazwy pól i zaokrąglenia jak w getHistoricalData / getAverages
+
+void writeSensorFields(const SolarData& d, SensorFieldWriter& w) {
+    w.text("V", d.V.c_str());
+    w.text("I", d.I.c_str());
+    w.text("PPV", d.PPV.c_str());
+}
+
+void writeSensorFields(const SPS30Data& d, SensorFieldWriter& w) {
+    w.number("PM1", d.pm1_0, 1);
+    w.number("PM25", d.pm2_5, 1);
+    w.number("PM4", d.pm4_0, 1);
+    w.number("PM10", d.pm10, 1);
+    w.number("NC05", d.nc0_5, 1);
+    w.number("NC1", d.nc1_0, 1);
+    w.number("NC25", d.nc2_5, 1);
+    w.number("NC4", d.nc4_0, 1);
+    w.number("NC10", d.nc10, 1);
+    w.number("TPS", d.typical_particle_size, 1);
+}
+
+void writeSensorFields(const INA219Data& d, SensorFieldWriter& w) {
+    w.number("busVoltage", d.busVoltage, 3);
+    w.number("current", d.current, 2);
+    w.number("power", d.power, 2);
+}
+
+void writeSensorFields(const BatteryData& d, SensorFieldWriter& w) {
+    w.number("voltage", d.voltage, 3);
+    w.number("current", d.current, 2);
+    w.number("power", d.power, 2);
+    w.integer("chargePercent", d.chargePercent);
+    w.flag("isBatteryPowered", d.isBatteryPowered);
+    w.flag("lowBattery", d.lowBattery);
+    w.flag("criticalBattery", d.criticalBattery);
+}
+
+void writeSensorFields(const SHT40Data& d, SensorFieldWriter& w) {
+    w.number("temperature", d.temperature, 1);
+    w.number("humidity", d.humidity, 1);
+    w.number("pressure", d.pressure, 1);
+}
+
+void writeSensorFields(const I2CSensorData& d, SensorFieldWriter& w) {
+    w.number("co2", d.co2, 0);
+    w.number("temperature", d.temperature, 1);
+    w.number("humidity", d.humidity, 1);
+}
+
+void writeSensorFields(const ADS1110Data& d, SensorFieldWriter& w) {
+    w.number("voltage", d.voltage, 4);
+}
+
+void writeSensorFields(const HCHOData& d, SensorFieldWriter& w) {
+    w.number("hcho_mg", d.hcho, 3);
+    w.number("hcho_ppb", d.hcho_ppb, 1);
+}
+
+void writeSensorFields(const MCP3424Data& d, SensorFieldWriter& w) {
+    extern MCP3424Config mcp3424Config;
+    char key[12];
+    // K = indeks płytki w konfiguracji (po adresie I2C), bez wpisu - kolejność wykrycia
+    int kNumber[MAX_MCP3424_DEVICES];
+    for (uint8_t dev = 0; dev < d.deviceCount && dev < MAX_MCP3424_DEVICES; dev++) {
+        kNumber[dev] = dev + 1;
+        for (int c = 0; c < 8; c++) {
+            if (mcp3424Config.devices[c].i2cAddress == d.addresses[dev]) {
+                kNumber[dev] = c + 1;
+                break;
+            }
+        }
+    }
+    // Zawsze K1..K8 w tej samej kolejności - nieważne/nieobecne płytki jako missing()
+    for (int k = 1; k <= 8; k++) {
+        int found = -1;
+        for (uint8_t dev = 0; dev < d.deviceCount && dev < MAX_MCP3424_DEVICES; dev++) {
+            if (kNumber[dev] == k) {
+                found = dev;
+                break;
+            }
+        }
+        for (uint8_t ch = 0; ch < 4; ch++) {
+            snprintf(key, sizeof(key), "K%d_%u", k, ch + 1);
+            if (found >= 0 && d.valid[found]) {
+                w.number(key, d.channels[found][ch], 3);
+            } else {
+                w.missing(key);
+            }
+        }
+    }
+    w.integer("deviceCount", d.deviceCount);
+}
+
+void writeSensorFields(const IPSSensorData& d, SensorFieldWriter& w) {
+    char key[8];
+    for (int j = 0; j < 7; j++) {
+        snprintf(key, sizeof(key), "pc_%d", j + 1);
+        w.integer(key, d.pc_values[j]);
+        snprintf(key, sizeof(key), "pm_%d", j + 1);
+        w.number(key, d.pm_values[j], 2);
+        snprintf(key, sizeof(key), "np_%d", j + 1);
+        w.integer(key, d.np_values[j]);
+        snprintf(key, sizeof(key), "pw_%d", j + 1);
+        w.integer(key, d.pw_values[j]);
+    }
+    w.flag("debugMode", d.debugMode);
+    w.integer("won", d.won);
+}
+
+void writeSensorFields(const FanData& d, SensorFieldWriter& w) {
+    w.integer("dutyCycle", d.dutyCycle);
+    w.integer("rpm", d.rpm);
+    w.flag("enabled", d.enabled);
+    w.flag("glineEnabled", d.glineEnabled);
+}
+
+void writeSensorFields(const CalibratedSensorData& d, SensorFieldWriter& w) {
+    w.number("CO", d.CO, 1);
+    w.number("NO", d.NO, 1);
+    w.number("NO2", d.NO2, 1);
+    w.number("O3", d.O3, 1);
+    w.number("SO2", d.SO2, 1);
+    w.number("H2S", d.H2S, 1);
+    w.number("NH3", d.NH3, 1);
+    w.number("VOC", d.VOC, 1);
+    w.number("VOC_ppb", d.VOC_ppb, 1);
+    w.number("HCHO", d.HCHO, 1);
+    w.number("PID", d.PID, 3);
+}
@@ -10,8 +10,9 @@ static bool glineEnabled = false;
 
 // Global FanData for moving averages
 FanData fanData;
-static unsigned long lastTachoPulse = 0;
-static unsigned long tachoPulseCount = 0;
+// Impulsy tacho liczone w przerwaniu - loop() nie próbkuje już pinu co przebieg
+static volatile unsigned long lastTachoPulse = 0;
+static volatile uint32_t tachoPulseCount = 0;
 static unsigned long lastRPMCalculation = 0;
 
 // Sleep mode variables
@@ -33,6 +34,11 @@ static const int PULSES_PER_REVOLUTION = 2;      // Standard for 3-wire fans
 void safePrint(const String& message);
 void safePrintln(const String& message);
 
+static void IRAM_ATTR onTachoPulse() {
+    tachoPulseCount++;
+    lastTachoPulse = millis();
+}
+
 // Fan control functions
 void initializeFan() {
     // Configure PWM for fan control
@@ -42,6 +48,7 @@ void initializeFan() {
     
     // Configure tacho pin as input with pullup
     pinMode(TACHO_PIN, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(TACHO_PIN), onTachoPulse, FALLING);
     
     // Configure GLine pin as output
     pinMode(GLine_PIN, OUTPUT);
@@ -162,28 +169,20 @@ bool isSleepModeActive() {
 }
 
 void updateFanRPM() {
-    static unsigned long lastPulseTime = 0;
     unsigned long currentTime = millis();
     
-    // Check for tacho pulse (falling edge detection)
-    static bool lastTachoState = HIGH;
-    bool currentTachoState = digitalRead(TACHO_PIN);
-    
-    if (lastTachoState == HIGH && currentTachoState == LOW) {
-        // Falling edge detected - pulse received
-        tachoPulseCount++;
-        lastPulseTime = currentTime;
-    }
-    
-    lastTachoState = currentTachoState;
-    
     // Calculate RPM every second
     if (currentTime - lastRPMCalculation >= 1000) {
-        if (tachoPulseCount > 0) {
+        noInterrupts();
+        uint32_t pulses = tachoPulseCount;
+        tachoPulseCount = 0;
+        unsigned long lastPulseTime = lastTachoPulse;
+        interrupts();
+
+        if (pulses > 0) {
             // Calculate RPM: (pulses * 60 seconds) / (pulses per revolution * time in seconds)
             unsigned long timeDiff = currentTime - lastRPMCalculation;
-            fanRPM = (tachoPulseCount * 60000) / (PULSES_PER_REVOLUTION * timeDiff);
-            tachoPulseCount = 0;
+            fanRPM = (pulses * 60000) / (PULSES_PER_REVOLUTION * timeDiff);
         } else {
             // No pulses detected - fan might be stopped or disconnected
             if (currentTime - lastPulseTime > TACHO_TIMEOUT) {
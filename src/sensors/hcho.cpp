@@ -75,16 +75,12 @@ void initializeHCHO() {
     }
 }
 
+// Co HCHO_READ_INTERVAL - zadanie planisty loop() (scheduler.h)
 bool readHCHO() {
     if (!config.enableHCHO || !hchoInitialized) {
         return false;
     }
     
-    // Check if enough time has passed since last read
-    if (millis() - lastHCHORead < HCHO_READ_INTERVAL) {
-        return true; // Return true but don't read yet
-    }
-    
     bool success = hchoSensor.read();
     
     if (success) {
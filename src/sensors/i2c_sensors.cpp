@@ -2,13 +2,14 @@
 #include <sensors.h>
 #include "sps30_sensor.h"
 #include "network_config.h"
+#include <i2c_bus.h>
 #include <Wire.h>
-#include <MCP342x.h>
 #include <Adafruit_INA219.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
-#include <freertos/semphr.h>
 #include <SensirionI2cScd4x.h>
+#include <live_stream.h>
+#include <atomic>
 
 // macro definitions
 // make sure that we use the proper definition of NO_ERROR
@@ -28,14 +29,11 @@ bool isSHT40Valid();
 void resetSHT40();
 void printSHT40Data();
 
-// I2C semaphore and task management
-SemaphoreHandle_t i2c_semaphore = NULL;
+// I2C task management (dostęp do magistrali - i2c_bus.h)
 TaskHandle_t mcp3424_task_handle = NULL;
 TaskHandle_t scd41_task_handle = NULL;
-volatile bool mcp3424_conversion_in_progress = false;
-volatile unsigned long mcp3424_conversion_start_time = 0;
-volatile uint8_t mcp3424_current_channel = 0; // Aktualny kanał do konwersji (0-3)
-volatile unsigned long mcp3424_cycle_start_time = 0; // Czas rozpoczęcia cyklu 4 kanałów
+
+static void startMCP3424Engine(const uint8_t* addresses, uint8_t count);
 
 // Debug control flag
 bool mcp3424_debug_enabled = false; // Można zmienić na false żeby wyłączyć debug
@@ -68,7 +66,6 @@ static volatile bool scd41_data_ready = false;
 static volatile unsigned long scd41_last_read_time = 0;
 
 // ADC sensor instances
-MCP342x* mcp3424_devices[MAX_MCP3424_DEVICES] = {nullptr}; // Array of pointers to MCP342x instances
 Adafruit_INA219 ina219(INA219_DEFAULT_ADDR);
 
 // SCD41 sensor instance using Sensirion library
@@ -91,15 +88,8 @@ void initializeI2C() {
     //pinMode(I2C_SDA_PIN, INPUT_PULLUP);
    // pinMode(I2C_SCL_PIN, INPUT_PULLUP);
     
-    // Create I2C semaphore for thread safety
-    if (i2c_semaphore == NULL) {
-        i2c_semaphore = xSemaphoreCreateMutex();
-        if (i2c_semaphore != NULL) {
-            safePrintln("I2C semaphore created successfully");
-        } else {
-            safePrintln("Failed to create I2C semaphore");
-        }
-    }
+    // Task magistrali - od teraz wszystkie transakcje przez kolejkę (i2c_bus.h)
+    initializeI2CBus();
     
     safePrintln("I2C initialized with pull-up resistors");
     
@@ -221,8 +211,6 @@ void initializeI2C() {
                     safePrint(" for ");
                     safePrintln(mcp3424Config.devices[i].gasType);
                     
-                    // Create new instance for this address
-                    mcp3424_devices[mcp3424Data.deviceCount] = new MCP342x(addr);
                     mcp3424Data.addresses[mcp3424Data.deviceCount] = addr;
                     mcp3424Data.valid[mcp3424Data.deviceCount] = false;
                     
@@ -247,27 +235,12 @@ void initializeI2C() {
         
         if (mcp3424Data.deviceCount > 0) {
             mcp3424SensorStatus = true;
-            mcp3424Data.resolution = 18;  // Use 18-bit for maximum precision (~266ms per channel)
             mcp3424Data.gain = 1;         // Default 1x gain
-            mcp3424_current_channel = 0;  // Start from channel 1 (index 0)
-            mcp3424_cycle_start_time = 0; // Initialize cycle timer
-            
-            // Create MCP3424 async conversion task
-            if (mcp3424_task_handle == NULL) {
-                xTaskCreate(
-                    mcp3424ConversionTask,   // Task function
-                    "MCP3424_Task",          // Task name
-                    4096,                    // Stack size
-                    NULL,                    // Task parameters
-                    1,                       // Priority
-                    &mcp3424_task_handle     // Task handle
-                );
-                safePrintln("MCP3424 async task created");
-            }
+            startMCP3424Engine(mcp3424Data.addresses, mcp3424Data.deviceCount);   // rozdzielczość per kanał z mcp3424Config
             
             safePrint("Initialized ");
             safePrint(String(mcp3424Data.deviceCount));
-            safePrint(" MCP3424 devices with 18-bit resolution using address mapping");
+            safePrint(" MCP3424 devices (up to " + String(mcp3424Data.resolution) + "-bit) using address mapping");
             if (mcp3424_debug_enabled) {
                 safePrint(" - DEBUG ON");
             } else {
@@ -288,8 +261,7 @@ void initializeI2C() {
     
     if (config.enableINA219 && initializeI2CSensor(SENSOR_INA219)) {
         ina219SensorStatus = true;
-        ina219.begin();
-        ina219.setCalibration_32V_2A();  // Default calibration
+        i2cBusCall(INA219_DEFAULT_ADDR, ina219BeginOnBus, NULL, I2C_PRIORITY_LOW);
         safePrintln("INA219 sensor detected and enabled");
     }
     
@@ -302,6 +274,12 @@ void initializeI2C() {
     }
 }
 
+static int ina219BeginOnBus(void* context) {
+    ina219.begin();
+    ina219.setCalibration_32V_2A();  // Default calibration
+    return 0;
+}
+
 bool initializeI2CSensor(I2CSensorType sensorType) {
     uint8_t address = 0;
     switch (sensorType) {
@@ -318,8 +296,7 @@ bool initializeI2CSensor(I2CSensorType sensorType) {
     
     // Try communication with timeout
     unsigned long startTime = millis();
-    Wire.beginTransmission(address);
-    uint8_t result = Wire.endTransmission();
+    bool present = i2cBusProbe(address, I2C_PRIORITY_LOW);
     
     // Check if communication took too long (timeout protection)
     if (millis() - startTime > I2C_TIMEOUT_MS) {
@@ -327,7 +304,7 @@ bool initializeI2CSensor(I2CSensorType sensorType) {
         return false;
     }
     
-    return (result == 0);
+    return present;
 }
 
 // Function to retry initialization of failed I2C sensors
@@ -420,21 +397,17 @@ void retryFailedI2CSensors() {
         
         scanAndMapMCP3424Devices();
         
-        // Reinitialize devices based on scan results
-        mcp3424Data.deviceCount = 0;
+        // Lista układów z wyniku skanu - mcp3424Data przejmie MCP3424_Task (może właśnie konwertować)
+        uint8_t addresses[MAX_MCP3424_DEVICES];
+        uint8_t deviceCount = 0;
         for (uint8_t i = 0; i < 8; i++) {
-            if (mcp3424Config.devices[i].autoDetected && mcp3424Config.devices[i].enabled) {
-                uint8_t addr = mcp3424Config.devices[i].i2cAddress;
-                if (mcp3424Data.deviceCount < MAX_MCP3424_DEVICES) {
-                    mcp3424_devices[mcp3424Data.deviceCount] = new MCP342x(addr);
-                    mcp3424Data.addresses[mcp3424Data.deviceCount] = addr;
-                    mcp3424Data.valid[mcp3424Data.deviceCount] = false;
-                    mcp3424Data.deviceCount++;
-                }
+            if (mcp3424Config.devices[i].autoDetected && mcp3424Config.devices[i].enabled &&
+                deviceCount < MAX_MCP3424_DEVICES) {
+                addresses[deviceCount++] = mcp3424Config.devices[i].i2cAddress;
             }
         }
         
-        safePrintln("Retry final mcp3424Data.deviceCount: " + String(mcp3424Data.deviceCount));
+        safePrintln("Retry final MCP3424 device count: " + String(deviceCount));
         
         // Save MCP3424 config after retry scan to preserve autoDetected status
         if (saveMCP3424Config(mcp3424Config)) {
@@ -443,7 +416,8 @@ void retryFailedI2CSensors() {
             safePrintln("WARNING: Failed to save MCP3424 config after retry");
         }
         
-        if (mcp3424Data.deviceCount > 0) {
+        if (deviceCount > 0) {
+            startMCP3424Engine(addresses, deviceCount);
             mcp3424SensorStatus = true;
             safePrintln("MCP3424 retry successful!");
         } else {
@@ -473,8 +447,7 @@ void retryFailedI2CSensors() {
         safePrintln("Retrying INA219 initialization...");
         if (initializeI2CSensor(SENSOR_INA219)) {
             ina219SensorStatus = true;
-            ina219.begin();
-            ina219.setCalibration_32V_2A();
+            i2cBusCall(INA219_DEFAULT_ADDR, ina219BeginOnBus, NULL, I2C_PRIORITY_LOW);
             safePrintln("INA219 retry successful!");
         } else {
             safePrintln("INA219 retry failed");
@@ -488,242 +461,195 @@ void retryFailedI2CSensors() {
                      ads1110SensorStatus || ina219SensorStatus;
 }
 
+// Odczyty I2C uruchamia planista loop() (scheduler.h) - okresy w rejestracji zadań w main.cpp
+
+// Czujniki środowiskowe (SHT30/BME280/SCD41, SHT40) - co 1 s
 void readI2CSensors() {
-    if (!config.enableI2CSensors) return;
+    if (!config.enableI2CSensors || !i2cSensorStatus) return;
     
-    static unsigned long lastReadTime = 0;
-    static unsigned long lastRetryTime = 0;
     unsigned long currentTime = millis();
     
-    // Try to retry failed sensors every 10 seconds (check if 2 minutes passed since last retry)
-    if (currentTime - lastRetryTime >= 10000) { // Check every 10 seconds
-        retryFailedI2CSensors();
-        lastRetryTime = currentTime;
+    // Read environmental sensors
+    switch (i2cSensorData.type) {
+        case SENSOR_SHT30:
+            sht30SensorStatus = readSHT30(i2cSensorData);
+            break;
+        case SENSOR_BME280:
+            bme280SensorStatus = readBME280(i2cSensorData);
+            break;  
+        case SENSOR_SCD41:
+            scd41SensorStatus = readSCD41(i2cSensorData);
+            break;
+        default:
+            break;
     }
     
-    // Early exit if no sensors are working at all
-    if (!i2cSensorStatus) return;
-
-    if (config.enableMCP3424) {
-       // Always call readMCP3424 to trigger conversions
-       readMCP3424(mcp3424Data);
-       
-       // Check if MCP3424 is actually working by checking:
-       // 1. Device count > 0 (devices detected)
-       // 2. At least one device has valid data
-       // 3. Data is reasonably fresh (less than 10 seconds old)
-       bool hasValidData = false;
-       if (mcp3424Data.deviceCount > 0) {
-           for (uint8_t device = 0; device < mcp3424Data.deviceCount; device++) {
-               if (mcp3424Data.valid[device]) {
-                   hasValidData = true;
-                   break;
-               }
-           }
-       }
-       
-       // Check if data is fresh (less than 10 seconds old)
-       bool dataIsFresh = (millis() - mcp3424Data.lastUpdate) < 10000;
-       
-       // Set status based on valid data and freshness
-       mcp3424SensorStatus = hasValidData && dataIsFresh;
-       
-       // Debug output every 30 seconds
-       static unsigned long lastMCP3424ReadDebug = 0;
-       if (millis() - lastMCP3424ReadDebug > 30000) {
-           lastMCP3424ReadDebug = millis();
-           safePrint("MCP3424 Status Check - DeviceCount: ");
-           safePrint(String(mcp3424Data.deviceCount));
-           safePrint(", HasValidData: ");
-           safePrint(hasValidData ? "true" : "false");
-           safePrint(", DataAge: ");
-           safePrint(String((millis() - mcp3424Data.lastUpdate) / 1000));
-           safePrint("s, Status: ");
-           safePrintln(mcp3424SensorStatus ? "OK" : "ERROR");
-       }
-    }
-    
-    // Read SPS30 particle sensor every second
-    if (config.enableSPS30) {
-        // Always call readSPS30 to trigger measurements
-        readSPS30(sps30Data);
-        
-        // Check if SPS30 is actually working by checking:
-        // 1. Data is valid (successful read)
-        // 2. Data is reasonably fresh (less than 5 seconds old)
-        bool dataIsFresh = (millis() - sps30Data.lastUpdate) < 5000;
-        
-        // Set status based on valid data and freshness
-        sps30SensorStatus = sps30Data.valid && dataIsFresh;
-        
-        // Debug output every 60 seconds
-        static unsigned long lastSPS30Debug = 0;
-        if (millis() - lastSPS30Debug > 60000) {
-            lastSPS30Debug = millis();
-            safePrint("SPS30 Status Check - Valid: ");
-            safePrint(sps30Data.valid ? "true" : "false");
-            safePrint(", DataAge: ");
-            safePrint(String((millis() - sps30Data.lastUpdate) / 1000));
-            safePrint("s, Status: ");
-            safePrintln(sps30SensorStatus ? "OK" : "ERROR");
+    // Read SHT40 for temperature, humidity and pressure (main environmental data)
+    if (config.enableSHT40 && sht40SensorStatus) {
+        sht40SensorStatus = readSHT40(sht40Data);
+        if (sht40Data.valid) {
+            // Use SHT40 data as main environmental data
+            i2cSensorData.temperature = sht40Data.temperature;
+            i2cSensorData.humidity = sht40Data.humidity;
+            i2cSensorData.pressure = sht40Data.pressure;
+            i2cSensorData.valid = true;
+            i2cSensorData.lastUpdate = currentTime;
+            i2cSensorData.type = SENSOR_SHT40;
+            
+            pushLiveSample(LIVE_SHT40_TEMPERATURE, sht40Data.temperature);
+            pushLiveSample(LIVE_SHT40_HUMIDITY, sht40Data.humidity);
+            pushLiveSample(LIVE_SHT40_PRESSURE, sht40Data.pressure);
+            
+            // safePrint("SHT40 - Temp: ");
+            // safePrint(String(sht40Data.temperature, 2));
+            // safePrint("°C, Humidity: ");
+            // safePrint(String(sht40Data.humidity, 2));
+            // safePrint("%, Pressure: ");
+            // safePrint(String(sht40Data.pressure, 2));
+            // safePrintln(" hPa");
         }
     }
     
-    if (currentTime - lastReadTime >= 1000) { // Read every 1 second
-        lastReadTime = currentTime;
-        
-        // Read environmental sensors
-        switch (i2cSensorData.type) {
-            case SENSOR_SHT30:
-                sht30SensorStatus = readSHT30(i2cSensorData);
-                break;
-            case SENSOR_BME280:
-                bme280SensorStatus = readBME280(i2cSensorData);
-                break;  
-            case SENSOR_SCD41:
-                scd41SensorStatus = readSCD41(i2cSensorData);
-                break;
-            default:
-                break;
+    // SCD41 data is updated by background task, just check if it's valid
+    if (config.enableSCD41 && scd41SensorStatus) {
+        // SCD41 task updates i2cSensorData automatically
+        // Just ensure temperature and humidity come from SHT40 if available
+        if (config.enableSHT40 && sht40Data.valid && i2cSensorData.valid) {
+            i2cSensorData.temperature = sht40Data.temperature;
+            i2cSensorData.humidity = sht40Data.humidity;
+            i2cSensorData.pressure = sht40Data.pressure;
         }
-        
-        // Read SHT40 for temperature, humidity and pressure (main environmental data)
-        if (config.enableSHT40 && sht40SensorStatus) {
-            sht40SensorStatus = readSHT40(sht40Data);
-            if (sht40Data.valid) {
-                // Use SHT40 data as main environmental data
-                i2cSensorData.temperature = sht40Data.temperature;
-                i2cSensorData.humidity = sht40Data.humidity;
-                i2cSensorData.pressure = sht40Data.pressure;
-                i2cSensorData.valid = true;
-                i2cSensorData.lastUpdate = currentTime;
-                i2cSensorData.type = SENSOR_SHT40;
-                
-                // safePrint("SHT40 - Temp: ");
-                // safePrint(String(sht40Data.temperature, 2));
-                // safePrint("°C, Humidity: ");
-                // safePrint(String(sht40Data.humidity, 2));
-                // safePrint("%, Pressure: ");
-                // safePrint(String(sht40Data.pressure, 2));
-                // safePrintln(" hPa");
-            }
-        }
-        
-        // SCD41 data is updated by background task, just check if it's valid
-        if (config.enableSCD41 && scd41SensorStatus) {
-            // SCD41 task updates i2cSensorData automatically
-            // Just ensure temperature and humidity come from SHT40 if available
-            if (config.enableSHT40 && sht40Data.valid && i2cSensorData.valid) {
-                i2cSensorData.temperature = sht40Data.temperature;
-                i2cSensorData.humidity = sht40Data.humidity;
-                i2cSensorData.pressure = sht40Data.pressure;
+    } else if (config.enableSCD41 && !scd41SensorStatus) {
+        safePrintln("SCD41: Sensor enabled but not initialized");
+    }
+}
+
+// MCP3424 - świeżość danych (konwersje i odczyty prowadzi mcp3424ConversionTask)
+void readMCP3424Sensor() {
+    if (!config.enableI2CSensors || !i2cSensorStatus || !config.enableMCP3424) return;
+    
+    // Check if MCP3424 is actually working by checking:
+    // 1. Device count > 0 (devices detected)
+    // 2. At least one device has valid data
+    // 3. Data is reasonably fresh (less than 10 seconds old)
+    bool hasValidData = false;
+    if (mcp3424Data.deviceCount > 0) {
+        for (uint8_t device = 0; device < mcp3424Data.deviceCount; device++) {
+            if (mcp3424Data.valid[device]) {
+                hasValidData = true;
+                break;
             }
-        } else if (config.enableSCD41 && !scd41SensorStatus) {
-            safePrintln("SCD41: Sensor enabled but not initialized");
         }
-        
-        // Read ADC sensors
-       
-        
-       
+    }
+    
+    // Check if data is fresh (less than 10 seconds old)
+    bool dataIsFresh = (millis() - mcp3424Data.lastUpdate) < 10000;
+    
+    // Set status based on valid data and freshness
+    mcp3424SensorStatus = hasValidData && dataIsFresh;
+    
+    // Debug output every 30 seconds
+    static unsigned long lastMCP3424ReadDebug = 0;
+    if (millis() - lastMCP3424ReadDebug > 30000) {
+        lastMCP3424ReadDebug = millis();
+        safePrint("MCP3424 Status Check - DeviceCount: ");
+        safePrint(String(mcp3424Data.deviceCount));
+        safePrint(", HasValidData: ");
+        safePrint(hasValidData ? "true" : "false");
+        safePrint(", DataAge: ");
+        safePrint(String((millis() - mcp3424Data.lastUpdate) / 1000));
+        safePrint("s, Status: ");
+        safePrintln(mcp3424SensorStatus ? "OK" : "ERROR");
     }
 }
 
+// SPS30 - co 1 s
+void readSPS30Sensor() {
+    if (!config.enableI2CSensors || !i2cSensorStatus || !config.enableSPS30) return;
+    
+    // Always call readSPS30 to trigger measurements
+    if (readSPS30(sps30Data)) {
+        pushLiveSample(LIVE_SPS30_PM1, sps30Data.pm1_0);
+        pushLiveSample(LIVE_SPS30_PM25, sps30Data.pm2_5);
+        pushLiveSample(LIVE_SPS30_PM4, sps30Data.pm4_0);
+        pushLiveSample(LIVE_SPS30_PM10, sps30Data.pm10);
+    }
+    
+    // Check if SPS30 is actually working by checking:
+    // 1. Data is valid (successful read)
+    // 2. Data is reasonably fresh (less than 5 seconds old)
+    bool dataIsFresh = (millis() - sps30Data.lastUpdate) < 5000;
+    
+    // Set status based on valid data and freshness
+    sps30SensorStatus = sps30Data.valid && dataIsFresh;
+    
+    // Debug output every 60 seconds
+    static unsigned long lastSPS30Debug = 0;
+    if (millis() - lastSPS30Debug > 60000) {
+        lastSPS30Debug = millis();
+        safePrint("SPS30 Status Check - Valid: ");
+        safePrint(sps30Data.valid ? "true" : "false");
+        safePrint(", DataAge: ");
+        safePrint(String((millis() - sps30Data.lastUpdate) / 1000));
+        safePrint("s, Status: ");
+        safePrintln(sps30SensorStatus ? "OK" : "ERROR");
+    }
+}
+
+// ADS1110 i INA219 - co 10 s
 void readBatteryVoltage() {
     if (!config.enableI2CSensors || !i2cSensorStatus) return;
     
-    static unsigned long lastReadTimeBat = 0;
-    unsigned long currentTime = millis();
+   // safePrintln("=== Battery Voltage Reading ===");
     
-    if (currentTime - lastReadTimeBat >= 10000) { // Read every 10 seconds
-        lastReadTimeBat = currentTime;
-        
-       // safePrintln("=== Battery Voltage Reading ===");
-        
-        if (ads1110SensorStatus) {
-            ads1110SensorStatus = readADS1110(ads1110Data);
-            if (ads1110Data.valid) {
-                // Assume battery divider ratio if needed (e.g., 2:1 divider)
-                float batteryVoltage = ads1110Data.voltage * 2.0; // Adjust ratio as needed
-                
-                safePrint("Battery Voltage (ADS1110): ");
-                safePrint(String(batteryVoltage, 3));
-                safePrint("V (Raw ADC: ");
-                safePrint(String(ads1110Data.voltage, 6));
-                safePrintln("V)");
-            } else {
-                safePrintln("ADS1110 battery reading invalid");
-            }
+    if (ads1110SensorStatus) {
+        ads1110SensorStatus = readADS1110(ads1110Data);
+        if (ads1110Data.valid) {
+            // Assume battery divider ratio if needed (e.g., 2:1 divider)
+            float batteryVoltage = ads1110Data.voltage * 2.0; // Adjust ratio as needed
+            
+            safePrint("Battery Voltage (ADS1110): ");
+            safePrint(String(batteryVoltage, 3));
+            safePrint("V (Raw ADC: ");
+            safePrint(String(ads1110Data.voltage, 6));
+            safePrintln("V)");
+        } else {
+            safePrintln("ADS1110 battery reading invalid");
         }
-        
-        if (ina219SensorStatus) {
-            ina219SensorStatus = readINA219(ina219Data);
-            if (ina219Data.valid) {
-                safePrint("Power Monitor (INA219): Bus=");
-                safePrint(String(ina219Data.busVoltage, 3));
-                safePrint("V, Current=");
-                safePrint(String(ina219Data.current, 2));
-                safePrint("mA, Power=");
-                safePrint(String(ina219Data.power, 2));
-                safePrintln("mW");
-            } else {
-                safePrintln("INA219 power reading invalid");
-            }
+    }
+    
+    if (ina219SensorStatus) {
+        ina219SensorStatus = readINA219(ina219Data);
+        if (ina219Data.valid) {
+            safePrint("Power Monitor (INA219): Bus=");
+            safePrint(String(ina219Data.busVoltage, 3));
+            safePrint("V, Current=");
+            safePrint(String(ina219Data.current, 2));
+            safePrint("mA, Power=");
+            safePrint(String(ina219Data.power, 2));
+            safePrintln("mW");
+        } else {
+            safePrintln("INA219 power reading invalid");
         }
-        
-        
-        
-       // safePrintln("=== End Battery Reading ===");
     }
 }
 
 bool readSHT30(I2CSensorData& data) {
-    // Take I2C semaphore for thread safety
-    if (i2c_semaphore && xSemaphoreTake(i2c_semaphore, pdMS_TO_TICKS(100)) != pdTRUE) {
-        safePrintln("SHT30: Failed to take I2C semaphore");
-        data.valid = false;
-        return false;
-    }
-
-    uint32_t start_time = millis();
+    // Pomiar single-shot; magistrala wolna na czas konwersji (i2c_bus.h)
+    static const uint8_t measureCommand[2] = {0x2C, 0x06};
+    uint8_t rawData[6];
     
-    Wire.beginTransmission(0x44);
-    Wire.write(0x2C);
-    Wire.write(0x06);
-    if (Wire.endTransmission() != 0) {
-        if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
+    if (i2cBusConvertRead(0x44, measureCommand, sizeof(measureCommand), 500, rawData, sizeof(rawData)) != I2C_BUS_OK) {
         return false;
     }
     
-    delay(500);
-    
-    // Timeout protection
-    Wire.requestFrom(0x44, 6);
-    while (Wire.available() < 6 && (millis() - start_time) < I2C_TIMEOUT_MS) {
-        delay(1);
-    }
-    
-    if (Wire.available() == 6) {
-        uint8_t rawData[6];
-        for (int i = 0; i < 6; i++) {
-            rawData[i] = Wire.read();
-        }
-        
-        uint16_t tempRaw = (rawData[0] << 8) | rawData[1];
-        uint16_t humRaw = (rawData[3] << 8) | rawData[4];
-        
-        data.temperature = -45 + 175 * ((float)tempRaw / 65535.0);
-        data.humidity = 100 * ((float)humRaw / 65535.0);
-        data.valid = true;
-        
-        // Release I2C semaphore
-        if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
-        return true;
-    }
+    uint16_t tempRaw = (rawData[0] << 8) | rawData[1];
+    uint16_t humRaw = (rawData[3] << 8) | rawData[4];
     
-    // Release I2C semaphore on failure
-    if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
-    return false;
+    data.temperature = -45 + 175 * ((float)tempRaw / 65535.0);
+    data.humidity = 100 * ((float)humRaw / 65535.0);
+    data.valid = true;
+    return true;
 }
 
 bool readBME280(I2CSensorData& data) {
@@ -735,22 +661,8 @@ bool readBME280(I2CSensorData& data) {
     return true;
 }
 
-bool initializeSCD41() {
-    extern FeatureConfig config;
-    
-    if (!config.enableSCD41) {
-        safePrintln("SCD41 sensor disabled in config");
-        return false;
-    }
-
-    // Take I2C semaphore for initialization
-    if (i2c_semaphore && xSemaphoreTake(i2c_semaphore, pdMS_TO_TICKS(100)) != pdTRUE) {
-        safePrintln("SCD41: Failed to take I2C semaphore for initialization");
-        return false;
-    }
-    
-    uint32_t start_time = millis();
-    
+// Sekwencja startowa SCD41 - na tasku magistrali (i2cBusCall)
+static int scd41InitOnBus(void* context) {
     // Initialize SCD41 using Sensirion library
     uint16_t error;
     char errorMessage[256];
@@ -802,17 +714,25 @@ bool initializeSCD41() {
         errorToString(error, errorMessage, 256);
         safePrint("SCD41: Error trying to execute startPeriodicMeasurement(): ");
         safePrintln(errorMessage);
-        if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
-        return false;
+        return 1;
     }
+    return 0;
+}
+
+bool initializeSCD41() {
+    extern FeatureConfig config;
     
+    if (!config.enableSCD41) {
+        safePrintln("SCD41 sensor disabled in config");
+        return false;
+    }
 
+    if (i2cBusCall(0x62, scd41InitOnBus, NULL, I2C_PRIORITY_LOW) != I2C_BUS_OK) {
+        return false;
+    }
     
     safePrintln("SCD41 sensor initialized successfully with periodic measurement");
     
-    // Release I2C semaphore
-    if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
-    
     // Start SCD41 task
     scd41_task_running = true;
     scd41_data_ready = false;
@@ -951,8 +871,7 @@ void enableI2CSensor(I2CSensorType sensorType) {
             config.enableINA219 = true;
             if (initializeI2CSensor(SENSOR_INA219)) {
                 ina219SensorStatus = true;
-                ina219.begin();
-                ina219.setCalibration_32V_2A();
+                i2cBusCall(INA219_DEFAULT_ADDR, ina219BeginOnBus, NULL, I2C_PRIORITY_LOW);
                         safePrintln("INA219 sensor enabled");
             }
             break;
@@ -1032,235 +951,326 @@ void disableI2CSensor(I2CSensorType sensorType) {
                      sht40SensorStatus || sps30SensorStatus || mcp3424SensorStatus || ads1110SensorStatus || ina219SensorStatus;
 }
 
-// Start conversion on current channel for all MCP3424 devices
-bool startMCP3424Conversion(MCP3424Data& data) {
-    if (xSemaphoreTake(i2c_semaphore, pdMS_TO_TICKS(50)) != pdTRUE) {
-        if (mcp3424_debug_enabled) safePrintln("MCP3424: Failed to take I2C semaphore for conversion start");
-        return false;
-    }
-    
-    bool success = true;
-    MCP342x::Channel channels[] = {MCP342x::channel1, MCP342x::channel2, MCP342x::channel3, MCP342x::channel4};
-    
-    // Jeśli zaczynamy kanał 1, zapisz czas rozpoczęcia cyklu
-    if (mcp3424_current_channel == 0) {
-        mcp3424_cycle_start_time = millis();
+// ===== MCP3424 - silnik konwersji =====
+// Każdy układ ma własny kanał i termin: start konwersji (zapis bajtu konfiguracji), odczyt po
+// nominalnym czasie konwersji dla rozdzielczości kanału, potem sprawdzanie bitu RDY co ~1/16 tego
+// czasu aż do wyniku - i od razu start kolejnego kanału. Układy nie czekają na siebie, a kanał
+// 12-bit (~4 ms) nie stoi w tempie 18-bit (~267 ms). Cykl 4 kanałów układu startuje najwyżej
+// co MCP3424_CYCLE_INTERVAL. Magistrala wolna w czasie konwersji (transakcje przez i2c_bus.h).
+
+#define MCP3424_RDY_BIT 0x80
+#define MCP3424_POLL_MIN_MICROS 1000
+
+struct MCP3424DeviceState {
+    uint8_t resolution[4];       // bity na kanał (mcp3424Config)
+    uint8_t channel;             // kanał w konwersji (0-3)
+    bool converting;
+    uint32_t conversionStart;    // micros()
+    uint32_t cycleStart;         // micros() - start kanału 1
+    uint32_t due;                // micros() - następny krok (start lub odczyt RDY)
+    uint16_t polls;              // odczyty z RDY=1 w bieżącej konwersji
+    uint8_t failedChannels;      // bit na kanał bez aktualnego wyniku - układ ważny dopiero przy 0
+    MCP3424DeviceStats stats;
+};
+
+static MCP3424DeviceState mcp3424State[MAX_MCP3424_DEVICES];
+// Zmiana rozdzielczości z WebSocket/Serial - mcp3424State[] zapisuje tylko MCP3424_Task
+static std::atomic<bool> mcp3424ResolutionChanged(false);
+// Ponowne wykrycie układów (retryFailedI2CSensors) przy działającym tasku: lista czeka w
+// mcp3424Pending*, task przejmuje ją przed kolejnym krokiem i dopiero wtedy zeruje flagę
+static uint8_t mcp3424PendingAddresses[MAX_MCP3424_DEVICES];
+static uint8_t mcp3424PendingCount = 0;
+static std::atomic<bool> mcp3424RestartRequested(false);
+
+// Nominalny czas konwersji: 240 / 60 / 15 / 3.75 SPS
+static uint32_t mcp3424ConversionMicros(uint8_t resolution) {
+    switch (resolution) {
+        case 12: return 4167;
+        case 14: return 16667;
+        case 16: return 66667;
+        default: return 266667;
     }
-    
-    // Start conversion on current channel for all devices
-    for (uint8_t device = 0; device < data.deviceCount; device++) {
-        if (mcp3424_devices[device] == nullptr) continue;
-        
-        MCP342x::Config config(channels[mcp3424_current_channel], MCP342x::oneShot, MCP342x::resolution18, MCP342x::gain1);
-        
-        uint8_t err = mcp3424_devices[device]->convert(config);
-        
-        if (err != 0) {
-            if (mcp3424_debug_enabled) {
-                safePrint("MCP3424 device ");
-                safePrint(String(device));
-                safePrint(" ch ");
-                safePrint(String(mcp3424_current_channel + 1));
-                safePrint(" convert failed with error ");
-                safePrintln(String(err));
+}
+
+// Rozdzielczości kanałów z mcp3424Config (po adresie) - MCP3424_Task lub przed jego startem
+static void loadMCP3424Resolution() {
+    extern MCP3424Config mcp3424Config;
+    uint8_t highest = 12;
+    
+    for (uint8_t device = 0; device < mcp3424Data.deviceCount; device++) {
+        MCP3424DeviceState& state = mcp3424State[device];
+        for (uint8_t ch = 0; ch < 4; ch++) {
+            state.resolution[ch] = 18;
+        }
+        for (uint8_t i = 0; i < 8; i++) {
+            if (mcp3424Config.devices[i].enabled && mcp3424Config.devices[i].i2cAddress == mcp3424Data.addresses[device]) {
+                for (uint8_t ch = 0; ch < 4; ch++) {
+                    state.resolution[ch] = validMCP3424Resolution(mcp3424Config.devices[i].resolution[ch]);
+                }
+                break;
             }
-            success = false;
+        }
+        for (uint8_t ch = 0; ch < 4; ch++) {
+            if (state.resolution[ch] > highest) highest = state.resolution[ch];
         }
     }
-    
-    if (success) {
-        mcp3424_conversion_in_progress = true;
-        mcp3424_conversion_start_time = millis();
+    mcp3424Data.resolution = highest;
+}
+
+// Wołane po zmianie konfiguracji (inne taski) - task przejmie nowe rozdzielczości przed kolejnym krokiem
+void applyMCP3424Resolution() {
+    if (mcp3424_task_handle == NULL) {
+        loadMCP3424Resolution();
+    } else {
+        mcp3424ResolutionChanged = true;
     }
-    
-    xSemaphoreGive(i2c_semaphore);
-    return success;
 }
 
-// Read results from current channel for all MCP3424 devices
-bool readMCP3424Results(MCP3424Data& data) {
-    if (xSemaphoreTake(i2c_semaphore, pdMS_TO_TICKS(50)) != pdTRUE) {
-        if (mcp3424_debug_enabled) safePrintln("MCP3424: Failed to take I2C semaphore for results read");
-        return false;
+// Nowa lista układów i stan silnika od zera - MCP3424_Task albo przed jego startem
+static void resetMCP3424Engine(const uint8_t* addresses, uint8_t count) {
+    if (mcp3424Data.gain == 0) mcp3424Data.gain = 1;
+    for (uint8_t device = 0; device < count; device++) {
+        mcp3424Data.addresses[device] = addresses[device];
+        mcp3424Data.valid[device] = false;
+    }
+    mcp3424Data.deviceCount = count;
+    
+    uint32_t now = micros();
+    for (uint8_t device = 0; device < MAX_MCP3424_DEVICES; device++) {
+        MCP3424DeviceState& state = mcp3424State[device];
+        state.channel = 0;
+        state.converting = false;
+        state.cycleStart = now;
+        state.due = now;
+        state.polls = 0;
+        state.failedChannels = 0;
+        memset(&state.stats, 0, sizeof(state.stats));
+        state.stats.address = mcp3424Data.addresses[device];
+    }
+    loadMCP3424Resolution();
+}
+
+// Po (ponownym) wykryciu układów - działający task dostaje listę przez mcp3424RestartRequested
+static void startMCP3424Engine(const uint8_t* addresses, uint8_t count) {
+    if (mcp3424_task_handle != NULL) {
+        // Poprzednia lista jeszcze nieprzejęta - zostaje (kolejny retry za SENSOR_RETRY_INTERVAL_MS)
+        if (mcp3424RestartRequested) return;
+        memcpy(mcp3424PendingAddresses, addresses, count);
+        mcp3424PendingCount = count;
+        mcp3424RestartRequested = true;
+        return;
     }
     
-    bool overallSuccess = false;
-    uint32_t read_start = millis();
+    resetMCP3424Engine(addresses, count);
     
-    // Only show data if debug is enabled
-    if (mcp3424_debug_enabled) {
-        // Read results from current channel for all devices
-        for (uint8_t device = 0; device < data.deviceCount; device++) {
-            if (mcp3424_devices[device] == nullptr) continue;
-            
-            long adcValue = 0;
-            MCP342x::Config status;
-            
-            // Read the conversion result for current channel
-            uint8_t err = mcp3424_devices[device]->read(adcValue, status);
-            
-            if (err == 0) {
-                // Convert to voltage (2.048V reference, 18-bit, gain=1)
-                data.channels[device][mcp3424_current_channel] = (adcValue*4) / (data.gain);
+    // Create MCP3424 async conversion task
+    if (mcp3424_task_handle == NULL) {
+        xTaskCreate(
+            mcp3424ConversionTask,   // Task function
+            "MCP3424_Task",          // Task name
+            4096,                    // Stack size
+            NULL,                    // Task parameters
+            1,                       // Priority
+            &mcp3424_task_handle     // Task handle
+        );
+        safePrintln("MCP3424 async task created");
+    }
+}
 
-              //raw adc /gain / 131072.0
-             // data.channels[device][mcp3424_current_channel] = adcValue / (data.gain );
-              overallSuccess = true;
-                
-                // Show raw ADC value and voltage
-                safePrint("Dev");
-                safePrint(String(device));
-                safePrint("Ch");
-                safePrint(String(mcp3424_current_channel + 1));
-                safePrint("=");
-                safePrint(String(adcValue));
-                safePrint("(");
-                safePrint(String(data.channels[device][mcp3424_current_channel], 6));
-                safePrint("V) ");
-            } else {
-                data.channels[device][mcp3424_current_channel] = 0.0;
-                safePrint("Dev");
-                safePrint(String(device));
-                safePrint("Ch");
-                safePrint(String(mcp3424_current_channel + 1));
-                safePrint("=ERR");
-                safePrint(String(err));
-                safePrint(" ");
-            }
-        }
-    } else {
-        // Silent mode - just read data without printing
-        for (uint8_t device = 0; device < data.deviceCount; device++) {
-            if (mcp3424_devices[device] == nullptr) continue;
-            
-            long adcValue = 0;
-            MCP342x::Config status;
-            
-            uint8_t err = mcp3424_devices[device]->read(adcValue, status);
-            
-            if (err == 0) {
-                data.channels[device][mcp3424_current_channel] = (adcValue*4) / (data.gain);
-                overallSuccess = true;
-            } else {
-                data.channels[device][mcp3424_current_channel] = 0.0;
-            }
+static void startMCP3424Channel(MCP3424Data& data, uint8_t device) {
+    MCP3424DeviceState& state = mcp3424State[device];
+    uint8_t resolution = state.resolution[state.channel];
+    
+    // RDY=1 (start), kanał, one-shot, rozdzielczość, wzmocnienie
+    uint8_t gainBits = data.gain == 8 ? 3 : data.gain == 4 ? 2 : data.gain == 2 ? 1 : 0;
+    uint8_t configByte = MCP3424_RDY_BIT | (state.channel << 5) | (((resolution - 12) / 2) << 2) | gainBits;
+    
+    if (state.channel == 0) {
+        state.cycleStart = micros();
+    }
+    state.conversionStart = micros();
+    int result = i2cBusWrite(data.addresses[device], &configByte, 1, I2C_PRIORITY_HIGH);
+    if (result != I2C_BUS_OK) {
+        state.stats.errors++;
+        state.failedChannels |= 1 << state.channel;
+        data.valid[device] = false;
+        state.due = micros() + mcp3424ConversionMicros(resolution);
+        if (mcp3424_debug_enabled) {
+            safePrintln("MCP3424 dev " + String(device) + " ch " + String(state.channel + 1) + " convert failed with error " + String(result));
         }
+        return;
     }
     
-    if (overallSuccess && mcp3424_debug_enabled) {
-        // Oblicz czas konwersji dla tego kanału
-        unsigned long channel_conversion_time = millis() - mcp3424_conversion_start_time;
-        unsigned long channel_read_time = millis() - read_start;
+    state.converting = true;
+    state.polls = 0;
+    state.due = state.conversionStart + mcp3424ConversionMicros(resolution);
+}
+
+// Kanał skończony (wynik lub błąd) - następny kanał od razu, nowy cykl w siatce MCP3424_CYCLE_INTERVAL
+static void nextMCP3424Channel(MCP3424Data& data, uint8_t device) {
+    MCP3424DeviceState& state = mcp3424State[device];
+    uint32_t now = micros();
+    state.converting = false;
+    state.channel = (state.channel + 1) % 4;
+    state.due = now;
+    
+    if (state.channel == 0) {
+        state.stats.cycles++;
+        state.stats.lastCycleMicros = now - state.cycleStart;
+        uint32_t nextCycle = state.cycleStart + MCP3424_CYCLE_INTERVAL * 1000UL;
+        if ((int32_t)(nextCycle - now) > 0) {
+            state.due = nextCycle;
+        }
         
-        safePrint(" -> Channel ");
-        safePrint(String(mcp3424_current_channel + 1));
-        safePrint(" read OK: konwersja=");
-        safePrint(String(channel_conversion_time));
-        safePrint("ms, odczyt=");
-        safePrint(String(channel_read_time));
-        safePrint("ms, total=");
-        safePrint(String(channel_conversion_time + channel_read_time));
-        safePrintln("ms");
-    }
-    
-    if (overallSuccess) {
-        // Update device validity (simplified - all devices or none)
-        for (uint8_t device = 0; device < data.deviceCount; device++) {
-            data.valid[device] = true;
+        if (mcp3424_debug_enabled) {
+            safePrintln("=== MCP3424 dev " + String(device) + ": cykl 4 kanalow " + String(state.stats.lastCycleMicros / 1000) + " ms ===");
         }
-        data.lastUpdate = millis();
+    }
+}
+
+static void readMCP3424Channel(MCP3424Data& data, uint8_t device) {
+    MCP3424DeviceState& state = mcp3424State[device];
+    uint8_t channel = state.channel;
+    uint8_t resolution = state.resolution[channel];
+    uint32_t conversionMicros = mcp3424ConversionMicros(resolution);
+    
+    // 18 bit: 3 bajty danych + konfiguracja, pozostałe: 2 + konfiguracja
+    uint8_t buffer[4];
+    size_t length = resolution == 18 ? 4 : 3;
+    int result = i2cBusRead(data.addresses[device], buffer, length, I2C_PRIORITY_HIGH);
+    uint32_t elapsed = micros() - state.conversionStart;
+    bool ready = false;
+    if (result == I2C_BUS_OK) {
+        uint8_t status = buffer[length - 1];
+        ready = !(status & MCP3424_RDY_BIT) && ((status >> 5) & 0x03) == channel;
+    }
+    
+    if (!ready) {
+        // Wynik jeszcze nie gotowy - kolejny odczyt RDY; 2x czas nominalny = konwersja przepadła
+        if (result == I2C_BUS_OK && elapsed < 2 * conversionMicros) {
+            uint32_t poll = conversionMicros / 16;
+            if (poll < MCP3424_POLL_MIN_MICROS) poll = MCP3424_POLL_MIN_MICROS;
+            state.polls++;
+            state.stats.notReady++;
+            state.due = micros() + poll;
+            return;
+        }
+        
+        if (result != I2C_BUS_OK) {
+            state.stats.errors++;
+        } else {
+            state.stats.timeouts++;
+        }
+        // Kanał bez wyniku - stara wartość zostaje, układ nieważny do poprawnego odczytu tego kanału
+        state.failedChannels |= 1 << channel;
+        data.valid[device] = false;
+        if (mcp3424_debug_enabled) {
+            safePrintln("Dev" + String(device) + "Ch" + String(channel + 1) + "=ERR" + String(result) + (result == I2C_BUS_OK ? " (RDY timeout)" : ""));
+        }
+        nextMCP3424Channel(data, device);
+        return;
     }
     
-    // Move to next channel (0-3 cycle)
-    mcp3424_current_channel = (mcp3424_current_channel + 1) % 4;
+    long adcValue;
+    if (resolution == 18) {
+        adcValue = ((long)(buffer[0] & 0x03) << 16) | ((long)buffer[1] << 8) | buffer[2];
+    } else {
+        adcValue = ((long)buffer[0] << 8) | buffer[1];
+    }
+    adcValue &= (1L << resolution) - 1;
+    if (adcValue & (1L << (resolution - 1))) {
+        adcValue -= 1L << resolution;
+    }
+    
+    // Skala 18-bit niezależnie od rozdzielczości kanału (kalibracja liczy na wartościach 18-bit)
+    long adcValue18 = adcValue * (1L << (18 - resolution));
+    data.channels[device][channel] = (adcValue18 * 4) / (data.gain);
+    state.failedChannels &= ~(1 << channel);
+    data.valid[device] = state.failedChannels == 0;
+    data.lastUpdate = millis();
+    state.stats.conversions++;
+    pushLiveSample(LIVE_MCP3424_BASE + device * 4 + channel, data.channels[device][channel]);
     
-    // Show complete cycle info when we complete all 4 channels
-    if (mcp3424_current_channel == 0 && mcp3424_debug_enabled) {
-        unsigned long total_cycle_time = millis() - mcp3424_cycle_start_time;
-        safePrint("=== KOMPLETNY CYKL 4 KANALOW ZAKONCZONY: ");
-        safePrint(String(total_cycle_time));
-        safePrint("ms dla ");
-        safePrint(String(data.deviceCount));
-        safePrint(" urzadzen (");
-        safePrint(String(total_cycle_time / (data.deviceCount * 4)));
-        safePrint("ms/kanal/urzadzenie) ===");
-        safePrintln("");
+    if (mcp3424_debug_enabled) {
+        safePrintln("Dev" + String(device) + "Ch" + String(channel + 1) + "=" + String(adcValue) + "(" +
+                    String(data.channels[device][channel], 6) + "V) " + String(resolution) + "bit konwersja=" +
+                    String(elapsed / 1000) + "ms, RDY polls=" + String(state.polls));
     }
     
-    mcp3424_conversion_in_progress = false;
-    xSemaphoreGive(i2c_semaphore);
-    return overallSuccess;
+    nextMCP3424Channel(data, device);
 }
 
-// FreeRTOS task for async MCP3424 conversion
+// FreeRTOS task for async MCP3424 conversion - śpi do najbliższego terminu któregokolwiek układu
 void mcp3424ConversionTask(void* parameters) {
-    const TickType_t conversionDelay = pdMS_TO_TICKS(300); // 300ms for 18-bit conversion
+    const uint32_t tickMicros = portTICK_PERIOD_MS * 1000;
     
     for (;;) {
-        if (mcp3424_conversion_in_progress) {
-            // Wait for conversion to complete (18-bit needs ~266ms per channel)
-            vTaskDelay(conversionDelay);
-            
-            // Check if conversion is still in progress and enough time has passed
-            if (mcp3424_conversion_in_progress && 
-                (millis() - mcp3424_conversion_start_time) >= 300) {
-                
-                // Read the results from current channel and move to next
-                readMCP3424Results(mcp3424Data);
+        // Ponowne wykrycie układów - cały stan od nowa (z aktualnymi rozdzielczościami)
+        if (mcp3424RestartRequested) {
+            mcp3424ResolutionChanged = false;
+            resetMCP3424Engine(mcp3424PendingAddresses, mcp3424PendingCount);
+            mcp3424RestartRequested = false;
+        }
+        
+        // Nowe rozdzielczości - konwersja w toku (stara długość odczytu) startuje od nowa
+        if (mcp3424ResolutionChanged.exchange(false)) {
+            loadMCP3424Resolution();
+            for (uint8_t device = 0; device < mcp3424Data.deviceCount; device++) {
+                mcp3424State[device].converting = false;
+                mcp3424State[device].due = micros();
+            }
+        }
+        
+        int32_t wait = MCP3424_CYCLE_INTERVAL * 1000L;
+        uint32_t now = micros();
+        // Wyłączony w konfiguracji (disableI2CSensor) - bez konwersji, task czeka
+        uint8_t deviceCount = config.enableMCP3424 ? mcp3424Data.deviceCount : 0;
+        
+        for (uint8_t device = 0; device < deviceCount; device++) {
+            MCP3424DeviceState& state = mcp3424State[device];
+            if ((int32_t)(now - state.due) >= 0) {
+                if (state.converting) {
+                    readMCP3424Channel(mcp3424Data, device);
+                } else {
+                    startMCP3424Channel(mcp3424Data, device);
+                }
+                now = micros();
             }
+            int32_t untilDue = (int32_t)(state.due - now);
+            if (untilDue < wait) wait = untilDue;
         }
         
-        // Small delay to prevent busy waiting
-        vTaskDelay(pdMS_TO_TICKS(50));
+        // Najmniej 1 tick - przy wielu układach z terminem "teraz" inne taski też dostają CPU
+        TickType_t ticks = wait > 0 ? (wait + tickMicros - 1) / tickMicros : 1;
+        vTaskDelay(ticks);
     }
 }
 
-bool readMCP3424(MCP3424Data& data) {
-    // Check if conversion is in progress
-    if (mcp3424_conversion_in_progress) {
-        // Check if enough time has passed for 18-bit conversion (300ms per channel)
-        unsigned long elapsed = millis() - mcp3424_conversion_start_time;
-        if (elapsed >= 300) {
-            // Conversion should be ready, results will be read by task
-            return false; // Task will handle reading and channel switching
-        } else {
-            // Still waiting for conversion
-            return false;
-        }
-    }
-    
-    // No conversion in progress, start a new one
-    static unsigned long lastConversionStart = 0;
-    unsigned long currentTime = millis();
-    
-    // Minimum interval between channel conversions (400ms per channel cycle)
-    if (currentTime - lastConversionStart < 400) {
-        return false; // Too soon for next channel conversion
-    }
-    
-    bool success = startMCP3424Conversion(data);
-    
-    if (success) {
-        lastConversionStart = currentTime;
-    } else if (mcp3424_debug_enabled) {
-        safePrint("MCP3424: Failed to start channel ");
-        safePrint(String(mcp3424_current_channel + 1));
-        safePrintln(" conversion");
-    }
-    
-    return false; // Results will be available after task completes
+uint8_t getMCP3424DeviceCount() {
+    return mcp3424Data.deviceCount;
+}
+
+bool getMCP3424DeviceStats(uint8_t device, MCP3424DeviceStats& stats) {
+    if (device >= mcp3424Data.deviceCount) return false;
+    stats = mcp3424State[device].stats;
+    return true;
+}
+
+String getMCP3424Status() {
+    String status = "- MCP3424: " + String(mcp3424Data.deviceCount) + " devices, cycle interval " + String(MCP3424_CYCLE_INTERVAL) + " ms\n";
+    for (uint8_t device = 0; device < mcp3424Data.deviceCount; device++) {
+        const MCP3424DeviceState& state = mcp3424State[device];
+        status += "- MCP3424 0x" + String(mcp3424Data.addresses[device], HEX) + ": resolution " +
+                  String(state.resolution[0]) + "/" + String(state.resolution[1]) + "/" +
+                  String(state.resolution[2]) + "/" + String(state.resolution[3]) + " bit, cycle " +
+                  String(state.stats.lastCycleMicros / 1000) + " ms, " + String(state.stats.conversions) +
+                  " conversions, " + String(state.stats.notReady) + " RDY polls, " + String(state.stats.timeouts) +
+                  " timeouts, " + String(state.stats.errors) + " errors\n";
+    }
+    return status;
 }
 
 bool readADS1110(ADS1110Data& data) {
-    // Take I2C semaphore for thread safety
-    if (xSemaphoreTake(i2c_semaphore, pdMS_TO_TICKS(100)) != pdTRUE) {
-        safePrintln("ADS1110: Failed to take I2C semaphore");
-        data.valid = false;
-        return false;
-    }
-    
-    uint32_t start_time = millis();
-    
     // Uśrednianie 5 próbek - statyczne tablice dla zachowania stanu między wywołaniami
     static float voltage_samples[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
     static int16_t raw_samples[5] = {0, 0, 0, 0, 0};
@@ -1283,59 +1293,23 @@ bool readADS1110(ADS1110Data& data) {
     else if (data.gain == 4) configByte |= 2;
     else if (data.gain == 8) configByte |= 3;
     
-    // Start conversion with retry mechanism
-    int retry_count = 0;
-    const int max_retries = 3;
-    bool conversion_started = false;
-    
-    while (retry_count < max_retries && !conversion_started) {
-        Wire.beginTransmission(ADS1110_DEFAULT_ADDR);
-        Wire.write(configByte);
-        if (Wire.endTransmission() == 0) {
-            conversion_started = true;
-        } else {
-            retry_count++;
-            delay(5); // Short delay before retry
-        }
-    }
-    
-    if (!conversion_started) {
-        safePrintln("ADS1110: Failed to start conversion after retries");
-        data.valid = false;
-        xSemaphoreGive(i2c_semaphore);
-        return false;
-    }
-    
     // Wait for conversion based on data rate with timeout protection
     uint32_t conversionTime = 1000 / data.dataRate + 50; // Reduced margin for speed
     if (conversionTime > I2C_TIMEOUT_MS) conversionTime = I2C_TIMEOUT_MS;
     
-    delay(conversionTime);
-    
-    // Check for timeout
-    if (millis() - start_time > I2C_TIMEOUT_MS) {
-        safePrintln("ADS1110: Conversion timeout detected");
-        data.valid = false;
-        xSemaphoreGive(i2c_semaphore);
-        return false;
-    }
-    
-    // Read 2 bytes of conversion result with retry
-    retry_count = 0;
+    // Start konwersji i odczyt 2 bajtów jedną transakcją - magistrala wolna na czas konwersji
+    int retry_count = 0;
+    const int max_retries = 3;
     bool read_success = false;
     int16_t current_raw = 0;
     
     while (retry_count < max_retries && !read_success) {
-        Wire.requestFrom(ADS1110_DEFAULT_ADDR, 2);
+        uint8_t result[2];
+        int err = i2cBusConvertRead(ADS1110_DEFAULT_ADDR, &configByte, 1, conversionTime, result, sizeof(result));
         
-        uint32_t readStart = millis();
-        while (Wire.available() < 2 && (millis() - readStart) < 50) { // Shorter timeout
-            delay(1);
-        }
-        
-        if (Wire.available() >= 2) {
-            uint8_t msb = Wire.read();
-            uint8_t lsb = Wire.read();
+        if (err == I2C_BUS_OK) {
+            uint8_t msb = result[0];
+            uint8_t lsb = result[1];
             
             // Combine bytes into 16-bit signed value - bieżąca próbka
             current_raw = (msb << 8) | lsb;
@@ -1354,7 +1328,9 @@ bool readADS1110(ADS1110Data& data) {
             read_success = true;
         } else {
             retry_count++;
-            safePrint("ADS1110: Read timeout (attempt ");
+            safePrint("ADS1110: Conversion read failed with error ");
+            safePrint(String(err));
+            safePrint(" (attempt ");
             safePrint(String(retry_count));
             safePrintln(")");
             delay(10);
@@ -1364,7 +1340,6 @@ bool readADS1110(ADS1110Data& data) {
     if (!read_success) {
         safePrintln("ADS1110: Failed to read data after retries");
         data.valid = false;
-        xSemaphoreGive(i2c_semaphore);
         return false;
     }
     
@@ -1418,20 +1393,28 @@ bool readADS1110(ADS1110Data& data) {
     debug_counter = 0;
 }
 
-xSemaphoreGive(i2c_semaphore);
 return true;
 }
 
-bool readINA219(INA219Data& data) {
-    // Take I2C semaphore for thread safety
-    if (xSemaphoreTake(i2c_semaphore, pdMS_TO_TICKS(100)) != pdTRUE) {
-        safePrintln("INA219: Failed to take I2C semaphore");
-        data.valid = false;
-        return false;
-    }
-    
+// Cztery rejestry INA219 jedną transakcją na tasku magistrali; błąd, gdy odczyt trwał ponad I2C_TIMEOUT_MS
+struct INA219Reading {
+    float busVoltage;
+    float shuntVoltage;
+    float current;
+    float power;
+};
+
+static int ina219ReadOnBus(void* context) {
+    INA219Reading& reading = *(INA219Reading*)context;
     uint32_t start_time = millis();
-    
+    reading.busVoltage = ina219.getBusVoltage_V();
+    reading.shuntVoltage = ina219.getShuntVoltage_mV();
+    reading.current = ina219.getCurrent_mA();
+    reading.power = ina219.getPower_mW();
+    return millis() - start_time > I2C_TIMEOUT_MS ? 1 : 0;
+}
+
+bool readINA219(INA219Data& data) {
     // Uśrednianie 5 próbek - statyczne tablice dla zachowania stanu między wywołaniami
     static float bus_voltage_samples[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
     static float shunt_voltage_samples[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
@@ -1451,76 +1434,39 @@ bool readINA219(INA219Data& data) {
     float current_power = 0.0;
     
     while (retry_count < max_retries && !read_success) {
-        bool single_read_success = true;
-        
-        // Read bus voltage with timeout check
-        current_bus_voltage = ina219.getBusVoltage_V();
-        if (millis() - start_time > I2C_TIMEOUT_MS) {
-            single_read_success = false;
-        }
-        
-        if (!single_read_success) {
-            retry_count++;
-            delay(10);
-            continue;
-        }
-        
-        // Read shunt voltage with timeout check
-        current_shunt_voltage = ina219.getShuntVoltage_mV();
-        if (millis() - start_time > I2C_TIMEOUT_MS) {
-            single_read_success = false;
-        }
-        
-        if (!single_read_success) {
+        INA219Reading reading;
+        if (i2cBusCall(INA219_DEFAULT_ADDR, ina219ReadOnBus, &reading) != I2C_BUS_OK) {
             retry_count++;
             delay(10);
             continue;
         }
         
-        // Read current with timeout check
-        current_current = ina219.getCurrent_mA();
-        if (millis() - start_time > I2C_TIMEOUT_MS) {
-            single_read_success = false;
-        }
+        current_bus_voltage = reading.busVoltage;
+        current_shunt_voltage = reading.shuntVoltage;
+        current_current = reading.current;
+        current_power = reading.power;
         
-        if (!single_read_success) {
+        // Validate readings
+        if (current_bus_voltage < 0.0 || current_bus_voltage > 32.0 ||
+            current_shunt_voltage < -320.0 || current_shunt_voltage > 320.0 ||
+            abs(current_current) > 3200.0 || current_power < 0.0) {
+            
+            safePrint("INA219: Invalid readings - Bus: ");
+            safePrint(String(current_bus_voltage, 3));
+            safePrint("V, Shunt: ");
+            safePrint(String(current_shunt_voltage, 2));
+            safePrint("mV, Current: ");
+            safePrint(String(current_current, 2));
+            safePrint("mA, Power: ");
+            safePrint(String(current_power, 2));
+            safePrintln("mW");
+            
             retry_count++;
             delay(10);
             continue;
         }
         
-        // Read power with timeout check
-        current_power = ina219.getPower_mW();
-        if (millis() - start_time > I2C_TIMEOUT_MS) {
-            single_read_success = false;
-        }
-        
-        if (single_read_success) {
-            // Validate readings
-            if (current_bus_voltage < 0.0 || current_bus_voltage > 32.0 ||
-                current_shunt_voltage < -320.0 || current_shunt_voltage > 320.0 ||
-                abs(current_current) > 3200.0 || current_power < 0.0) {
-                
-                safePrint("INA219: Invalid readings - Bus: ");
-                safePrint(String(current_bus_voltage, 3));
-                safePrint("V, Shunt: ");
-                safePrint(String(current_shunt_voltage, 2));
-                safePrint("mV, Current: ");
-                safePrint(String(current_current, 2));
-                safePrint("mA, Power: ");
-                safePrint(String(current_power, 2));
-                safePrintln("mW");
-                
-                retry_count++;
-                delay(10);
-                continue;
-            }
-            
-            read_success = true;
-        } else {
-            retry_count++;
-            delay(10);
-        }
+        read_success = true;
     }
     
     if (!read_success) {
@@ -1528,7 +1474,6 @@ bool readINA219(INA219Data& data) {
         safePrint(String(max_retries));
         safePrintln(" retries");
         data.valid = false;
-        xSemaphoreGive(i2c_semaphore);
         return false;
     }
     
@@ -1590,7 +1535,6 @@ bool readINA219(INA219Data& data) {
     debug_counter = 0;
 }
 
-xSemaphoreGive(i2c_semaphore);
 return true;
 }
 
@@ -1632,95 +1576,103 @@ void setMCP3424Debug(bool enabled) {
     }
 }
 
+// Status gotowości i pomiar SCD41 jedną transakcją na tasku magistrali
+struct SCD41Poll {
+    bool dataReady;
+    uint16_t co2;
+    float temperature;
+    float humidity;
+    uint16_t error;
+    const char* step;            // funkcja biblioteki, która zwróciła błąd
+};
+
+static int scd41PollOnBus(void* context) {
+    SCD41Poll& poll = *(SCD41Poll*)context;
+    poll.error = scd41.getDataReadyStatus(poll.dataReady);
+    if (poll.error != NO_ERROR) {
+        poll.step = "getDataReadyStatus()";
+        return 1;
+    }
+    if (!poll.dataReady) return 0;
+    
+    poll.error = scd41.readMeasurement(poll.co2, poll.temperature, poll.humidity);
+    if (poll.error != NO_ERROR) {
+        poll.step = "readMeasurement()";
+        return 1;
+    }
+    return 0;
+}
+
 void scd41Task(void* parameters) {
     safePrintln("SCD41 task started");
     
     while (scd41_task_running) {
-        // Check if data is ready
-        bool dataReady = false;
-        uint16_t error;
+        SCD41Poll poll = {false, 0, 0.0f, 0.0f, NO_ERROR, "i2cBusCall()"};
         char errorMessage[256];
         
-        // Take I2C semaphore
-        if (i2c_semaphore && xSemaphoreTake(i2c_semaphore, pdMS_TO_TICKS(100)) == pdTRUE) {
-            error = scd41.getDataReadyStatus(dataReady);
-            if (error != NO_ERROR) {
-                errorToString(error, errorMessage, 256);
-                safePrint("SCD41: Error trying to execute getDataReadyStatus(): ");
-                safePrintln(errorMessage);
-                xSemaphoreGive(i2c_semaphore);
-                vTaskDelay(pdMS_TO_TICKS(1000)); // Wait 1 second before retry
-                continue;
-            }
-            
-            // If data is not ready, wait and try again
-            if (!dataReady) {
-                xSemaphoreGive(i2c_semaphore);
-                vTaskDelay(pdMS_TO_TICKS(100)); // Wait 100ms before checking again
-                continue;
-            }
-            
-            // Data is ready, read measurement
-            uint16_t co2Concentration = 0;
-            float temperature = 0.0;
-            float relativeHumidity = 0.0;
+        if (i2cBusCall(0x62, scd41PollOnBus, &poll, I2C_PRIORITY_HIGH) != I2C_BUS_OK) {
+            errorToString(poll.error, errorMessage, 256);
+            safePrint("SCD41: Error trying to execute ");
+            safePrint(poll.step);
+            safePrint(": ");
+            safePrintln(errorMessage);
+            vTaskDelay(pdMS_TO_TICKS(1000)); // Wait 1 second before retry
+            continue;
+        }
+        
+        // If data is not ready, wait and try again
+        if (!poll.dataReady) {
+            vTaskDelay(pdMS_TO_TICKS(100)); // Wait 100ms before checking again
+            continue;
+        }
+        
+        uint16_t co2Concentration = poll.co2;
+        float temperature = poll.temperature;
+        float relativeHumidity = poll.humidity;
+        
+        // Validate readings
+        if (co2Concentration >= 400 && co2Concentration <= 5000 &&
+            temperature >= -40.0 && temperature <= 85.0 &&
+            relativeHumidity >= 0.0 && relativeHumidity <= 100.0) {
             
-            error = scd41.readMeasurement(co2Concentration, temperature, relativeHumidity);
-            if (error != NO_ERROR) {
-                errorToString(error, errorMessage, 256);
-                safePrint("SCD41: Error trying to execute readMeasurement(): ");
-                safePrintln(errorMessage);
-                xSemaphoreGive(i2c_semaphore);
-                vTaskDelay(pdMS_TO_TICKS(1000)); // Wait 1 second before retry
-                continue;
-            }
+            // Update global data - only CO2, preserve temperature and humidity from SHT40
+            extern I2CSensorData i2cSensorData;
+            extern SHT40Data sht40Data;
+            extern FeatureConfig config;
             
-            // Validate readings
-            if (co2Concentration >= 400 && co2Concentration <= 5000 &&
-                temperature >= -40.0 && temperature <= 85.0 &&
-                relativeHumidity >= 0.0 && relativeHumidity <= 100.0) {
-                
-                // Update global data - only CO2, preserve temperature and humidity from SHT40
-                extern I2CSensorData i2cSensorData;
-                extern SHT40Data sht40Data;
-                extern FeatureConfig config;
-                
-                // Only update CO2 from SCD41, keep temperature and humidity from SHT40 if available
-                if (config.enableSHT40 && sht40Data.valid) {
-                    i2cSensorData.temperature = sht40Data.temperature;
-                    i2cSensorData.humidity = sht40Data.humidity;
-                    i2cSensorData.pressure = sht40Data.pressure;
-                } else {
-                    // Fallback to SCD41 temperature and humidity if SHT40 not available
-                    i2cSensorData.temperature = temperature;
-                    i2cSensorData.humidity = relativeHumidity;
-                    i2cSensorData.pressure = 0.0; // SCD41 doesn't have pressure
-                }
-                i2cSensorData.co2 = (float)co2Concentration;
-                i2cSensorData.valid = true;
-                i2cSensorData.lastUpdate = millis();
-                i2cSensorData.type = SENSOR_SCD41;
-                
-                scd41_data_ready = true;
-                scd41_last_read_time = millis();
-                
-                // Debug output every 30 seconds
-                static unsigned long lastSCD41Debug = 0;
-                if (millis() - lastSCD41Debug > 30000) {
-                    lastSCD41Debug = millis();
-                    safePrint("SCD41 Task - CO2: ");
-                    safePrint(String(co2Concentration));
-                    safePrint(" ppm, Temp: ");
-                    safePrint(String(temperature, 2));
-                    safePrint("°C, Humidity: ");
-                    safePrint(String(relativeHumidity, 2));
-                    safePrintln("%");
-                }
+            // Only update CO2 from SCD41, keep temperature and humidity from SHT40 if available
+            if (config.enableSHT40 && sht40Data.valid) {
+                i2cSensorData.temperature = sht40Data.temperature;
+                i2cSensorData.humidity = sht40Data.humidity;
+                i2cSensorData.pressure = sht40Data.pressure;
             } else {
-                safePrintln("SCD41: Invalid readings detected");
+                // Fallback to SCD41 temperature and humidity if SHT40 not available
+                i2cSensorData.temperature = temperature;
+                i2cSensorData.humidity = relativeHumidity;
+                i2cSensorData.pressure = 0.0; // SCD41 doesn't have pressure
             }
+            i2cSensorData.co2 = (float)co2Concentration;
+            i2cSensorData.valid = true;
+            i2cSensorData.lastUpdate = millis();
+            i2cSensorData.type = SENSOR_SCD41;
+            
+            scd41_data_ready = true;
+            scd41_last_read_time = millis();
             
-            xSemaphoreGive(i2c_semaphore);
+            // Debug output every 30 seconds
+            static unsigned long lastSCD41Debug = 0;
+            if (millis() - lastSCD41Debug > 30000) {
+                lastSCD41Debug = millis();
+                safePrint("SCD41 Task - CO2: ");
+                safePrint(String(co2Concentration));
+                safePrint(" ppm, Temp: ");
+                safePrint(String(temperature, 2));
+                safePrint("°C, Humidity: ");
+                safePrint(String(relativeHumidity, 2));
+                safePrintln("%");
+            }
+        } else {
+            safePrintln("SCD41: Invalid readings detected");
         }
         
         // Wait before next measurement cycle
@@ -1731,18 +1683,28 @@ void scd41Task(void* parameters) {
     vTaskDelete(NULL);
 }
 
-void resetSCD41() {
-    // Take I2C semaphore
-    if (i2c_semaphore && xSemaphoreTake(i2c_semaphore, pdMS_TO_TICKS(100)) != pdTRUE) {
-        safePrintln("SCD41: Failed to take I2C semaphore for reset");
-        return;
-    }
+// Kroki resetu SCD41 osobnymi transakcjami - przerwy 1 s poza magistralą; kod błędu biblioteki w context
+static int scd41StopOnBus(void* context) {
+    *(uint16_t*)context = scd41.stopPeriodicMeasurement();
+    return *(uint16_t*)context;
+}
 
-    uint16_t error;
+static int scd41FactoryResetOnBus(void* context) {
+    *(uint16_t*)context = scd41.performFactoryReset();
+    return *(uint16_t*)context;
+}
+
+static int scd41StartOnBus(void* context) {
+    *(uint16_t*)context = scd41.startPeriodicMeasurement();
+    return *(uint16_t*)context;
+}
+
+void resetSCD41() {
+    uint16_t error = NO_ERROR;
     char errorMessage[256];
     
     // Stop periodic measurement
-    error = scd41.stopPeriodicMeasurement();
+    i2cBusCall(0x62, scd41StopOnBus, &error, I2C_PRIORITY_LOW);
     if (error != NO_ERROR) {
         errorToString(error, errorMessage, 256);
         safePrint("SCD41: Error stopping measurement during reset: ");
@@ -1753,7 +1715,7 @@ void resetSCD41() {
     delay(1000);
     
     // Perform soft reset using Sensirion library
-    error = scd41.performFactoryReset();
+    i2cBusCall(0x62, scd41FactoryResetOnBus, &error, I2C_PRIORITY_LOW);
     if (error != NO_ERROR) {
         errorToString(error, errorMessage, 256);
         safePrint("SCD41: Error during factory reset: ");
@@ -1764,7 +1726,7 @@ void resetSCD41() {
     delay(1000);
     
     // Restart periodic measurement
-    error = scd41.startPeriodicMeasurement();
+    i2cBusCall(0x62, scd41StartOnBus, &error, I2C_PRIORITY_LOW);
     if (error != NO_ERROR) {
         errorToString(error, errorMessage, 256);
         safePrint("SCD41: Error restarting measurement after reset: ");
@@ -1796,8 +1758,5 @@ void resetSCD41() {
     scd41_data_ready = false;
     scd41_last_read_time = 0;
     
-    // Release I2C semaphore
-    if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
-    
     safePrintln("SCD41 sensor reset completed");
 } 
\ No newline at end of file
@@ -3,7 +3,7 @@
 #include <config.h>
 #include <Arduino.h>
 #include <WSEN_PADS.h>
-#include <i2c_sensors.h>  // For I2C semaphore
+#include <i2c_sensors.h>  // Menedżer magistrali (i2c_bus.h)
 
 Sensor_PADS sensor;
 
@@ -60,6 +60,41 @@ static uint8_t calculateCRC8(const uint8_t* data, size_t len) {
     return crc;
 }
 
+// Próby wykrycia SHT40 przy inicjalizacji - każda to osobna transakcja, czekanie poza taskiem magistrali
+#define SHT40_PROBE_ATTEMPTS           5
+#define SHT40_PROBE_RETRY_DELAY_MS     50
+
+// Konfiguracja PADS (biblioteka WSEN_PADS) na tasku magistrali (i2cBusCall); 0 = OK
+static int padsInitOnBus(void* context) {
+    (void)context;
+    // Initialize PADS pressure sensor
+    if (sensor.init(PADS_ADDRESS_I2C_0) != WE_SUCCESS) {
+        safePrintln("PADS pressure sensor initialization failed");
+        return 1;
+    }
+
+    // Set the free run mode with given ODR
+    if (sensor.set_continuous_mode(1) != WE_SUCCESS) {
+        safePrintln("Error: PADS set_continuous_mode() failed");
+        return 1;
+    }
+
+    // Enable low-noise configuration
+    if (sensor.set_low_noise_mode() != WE_SUCCESS) {
+        safePrintln("Error: PADS set_low_noise_mode() failed");
+        return 1;
+    }
+
+    // Enable the additional low pass filter
+    if (sensor.set_low_pass_configuration() != WE_SUCCESS) {
+        safePrintln("Error: PADS set_low_pass_configuration() failed");
+        return 1;
+    }
+
+    safePrintln("PADS pressure sensor initialized successfully");
+    return 0;
+}
+
 // Initialize SHT40 sensor
 bool initializeSHT40() {
     extern FeatureConfig config;
@@ -69,85 +104,32 @@ bool initializeSHT40() {
         return false;
     }
 
-    // Take I2C semaphore for initialization
-    if (i2c_semaphore && xSemaphoreTake(i2c_semaphore, pdMS_TO_TICKS(100)) != pdTRUE) {
-        safePrintln("SHT40: Failed to take I2C semaphore for initialization");
-        return false;
-    }
-    
-    // Initialize I2C if not already done
-    if (!Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN)) {
-        safePrintln("Failed to initialize I2C for SHT40");
-        if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
-        return false;
-    }
-    
-    // Check if SHT40 is present
-    Wire.beginTransmission(SHT40_DEFAULT_ADDR);
-    uint8_t error = Wire.endTransmission();
-    int retry = 0;
+    // Check if SHT40 is present (Wire uruchomiony w initializeI2C przed taskiem magistrali)
     bool found = false;
-    for (retry = 0; retry < 5; retry++) {
-        if (error == 0) {
+    for (int retry = 0; retry < SHT40_PROBE_ATTEMPTS; retry++) {
+        if (i2cBusProbe(SHT40_DEFAULT_ADDR, I2C_PRIORITY_LOW)) {
             found = true;
             break;
         }
         safePrint("SHT40 nie znaleziony, proba ");
         safePrintln(String(retry + 1));
-        delay(50);
-        // Ponowne sprawdzenie obecnosci
-        Wire.beginTransmission(SHT40_DEFAULT_ADDR);
-        error = Wire.endTransmission();
+        delay(SHT40_PROBE_RETRY_DELAY_MS);
     }
     if (!found) {
         safePrint("SHT40 nie znaleziony pod adresem 0x");
         safePrintln(String(SHT40_DEFAULT_ADDR, HEX));
-        if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
         return false;
     }
+
     // Perform soft reset
-    Wire.beginTransmission(SHT40_DEFAULT_ADDR);
-    Wire.write(SHT40_SOFT_RESET);
-    Wire.endTransmission();
+    static const uint8_t resetCommand = SHT40_SOFT_RESET;
+    i2cBusWrite(SHT40_DEFAULT_ADDR, &resetCommand, 1, I2C_PRIORITY_LOW);
     delay(SHT40_RESET_DELAY);
     
     safePrint("SHT40 sensor initialized at address 0x");
     safePrintln(String(SHT40_DEFAULT_ADDR, HEX));
 
-    // Initialize PADS pressure sensor
-    if (sensor.init(PADS_ADDRESS_I2C_0) != WE_SUCCESS) {
-        safePrintln("PADS pressure sensor initialization failed");
-        if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
-        return false;
-    }
-
-    // Set the free run mode with given ODR
-    if (sensor.set_continuous_mode(1) != WE_SUCCESS) {
-        safePrintln("Error: PADS set_continuous_mode() failed");
-        if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
-        return false;
-    }
-
-    // Enable low-noise configuration
-    if (sensor.set_low_noise_mode() != WE_SUCCESS) {
-        safePrintln("Error: PADS set_low_noise_mode() failed");
-        if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
-        return false;
-    }
-
-    // Enable the additional low pass filter
-    if (sensor.set_low_pass_configuration() != WE_SUCCESS) {
-        safePrintln("Error: PADS set_low_pass_configuration() failed");
-        if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
-        return false;
-    }
-
-    safePrintln("PADS pressure sensor initialized successfully");
-    
-    // Release I2C semaphore
-    if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
-    
-    return true;
+    return i2cBusCall(PADS_ADDRESS_I2C_0, padsInitOnBus, NULL, I2C_PRIORITY_LOW) == I2C_BUS_OK;
 }
 
 // Function to retry SHT40 initialization if failed
@@ -171,6 +153,25 @@ void retrySHT40IfFailed() {
     }
 }
 
+// Ciśnienie z PADS (biblioteka WSEN_PADS) na tasku magistrali; 0 przy błędzie - nie psuje odczytu SHT40
+static int padsReadPressureOnBus(void* context) {
+    float& pressure = *(float*)context;
+    PADS_state_t stateTemperature;
+    PADS_state_t statePressure;
+    
+    int status = sensor.ready_to_read(&stateTemperature, &statePressure);
+    if (status == WE_SUCCESS && statePressure != 0) {
+        if (sensor.read_pressure(&pressure) != WE_SUCCESS) {
+            safePrintln("Error reading pressure from PADS sensor");
+            pressure = 0.0; // Set to 0 but don't fail the whole reading
+        }
+    } else {
+        safePrintln("PADS sensor not ready to read pressure");
+        pressure = 0.0; // Set to 0 but don't fail the whole reading
+    }
+    return 0;
+}
+
 // Read sensor data from SHT40
 bool readSHT40() {
     extern FeatureConfig config;
@@ -191,53 +192,25 @@ bool readSHT40() {
         return false; // Sensor not working, don't try to read
     }
 
-    // Take I2C semaphore
-    if (i2c_semaphore && xSemaphoreTake(i2c_semaphore, pdMS_TO_TICKS(100)) != pdTRUE) {
-        safePrintln("SHT40: Failed to take I2C semaphore for reading");
-        sht40SensorStatus = false;
-        sht40Data.valid = false;
-        return false;
-    }
-    
-    // Send measurement command (high precision, no heater)
-    Wire.beginTransmission(SHT40_DEFAULT_ADDR);
-    Wire.write(SHT40_MEASURE_HIGHREP_NOHEAT);
-    uint8_t error = Wire.endTransmission();
-    
-    if (error != 0) {
-        safePrintln("Failed to send measurement command to SHT40");
-        sht40SensorStatus = false;
-        sht40Data.valid = false;
-        if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
-        return false;
-    }
-    
-    // Wait for measurement
-    delay(SHT40_MEASURE_DELAY_HIGHREP);
-    
-    // Read 6 bytes (T_MSB, T_LSB, T_CRC, RH_MSB, RH_LSB, RH_CRC)
-    Wire.requestFrom(SHT40_DEFAULT_ADDR, 6);
+    // Measurement command (high precision, no heater), wait, read 6 bytes (T_MSB, T_LSB, T_CRC, RH_MSB, RH_LSB, RH_CRC)
+    // Magistrala wolna na czas pomiaru - i2c_bus.h
+    static const uint8_t measureCommand = SHT40_MEASURE_HIGHREP_NOHEAT;
+    uint8_t data[6];
+    int result = i2cBusConvertRead(SHT40_DEFAULT_ADDR, &measureCommand, 1, SHT40_MEASURE_DELAY_HIGHREP, data, sizeof(data));
     
-    if (Wire.available() != 6) {
-        safePrintln("Failed to read data from SHT40");
+    if (result != I2C_BUS_OK) {
+        safePrintln(result == I2C_BUS_ERROR_SHORT_READ ? "Failed to read data from SHT40" : "Failed to send measurement command to SHT40");
         sht40SensorStatus = false;
         sht40Data.valid = false;
-        if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
         return false;
     }
     
-    uint8_t data[6];
-    for (int i = 0; i < 6; i++) {
-        data[i] = Wire.read();
-    }
-    
     // Validate CRC for temperature
     uint8_t tempCRC = calculateCRC8(&data[0], 2);
     if (tempCRC != data[2]) {
         safePrintln("SHT40 temperature CRC mismatch");
         sht40SensorStatus = false;
         sht40Data.valid = false;
-        if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
         return false;
     }
     
@@ -247,7 +220,6 @@ bool readSHT40() {
         safePrintln("SHT40 humidity CRC mismatch");
         sht40SensorStatus = false;
         sht40Data.valid = false;
-        if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
         return false;
     }
     
@@ -265,19 +237,7 @@ bool readSHT40() {
 
     // Read pressure from PADS sensor
     float pressure = 0.0;
-    PADS_state_t stateTemperature;
-    PADS_state_t statePressure;
-    
-    int status = sensor.ready_to_read(&stateTemperature, &statePressure);
-    if (status == WE_SUCCESS && statePressure != 0) {
-        if (sensor.read_pressure(&pressure) != WE_SUCCESS) {
-            safePrintln("Error reading pressure from PADS sensor");
-            pressure = 0.0; // Set to 0 but don't fail the whole reading
-        }
-    } else {
-        safePrintln("PADS sensor not ready to read pressure");
-        pressure = 0.0; // Set to 0 but don't fail the whole reading
-    }
+    i2cBusCall(PADS_ADDRESS_I2C_0, padsReadPressureOnBus, &pressure);
     pressure = pressure*10;
     // Update global data
     sht40Data.temperature = temperature;
@@ -287,9 +247,6 @@ bool readSHT40() {
     sht40Data.lastUpdate = millis();
     sht40SensorStatus = true;
 
-    // Release I2C semaphore
-    if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
-
     // Debug output every 30 seconds
     static unsigned long lastDebug = 0;
     if (millis() - lastDebug > 30000) {
@@ -313,15 +270,8 @@ bool isSHT40Valid() {
 
 // Reset SHT40 sensor
 void resetSHT40() {
-    // Take I2C semaphore
-    if (i2c_semaphore && xSemaphoreTake(i2c_semaphore, pdMS_TO_TICKS(100)) != pdTRUE) {
-        safePrintln("SHT40: Failed to take I2C semaphore for reset");
-        return;
-    }
-
-    Wire.beginTransmission(SHT40_DEFAULT_ADDR);
-    Wire.write(SHT40_SOFT_RESET);
-    Wire.endTransmission();
+    static const uint8_t resetCommand = SHT40_SOFT_RESET;
+    i2cBusWrite(SHT40_DEFAULT_ADDR, &resetCommand, 1, I2C_PRIORITY_LOW);
     delay(SHT40_RESET_DELAY);
     
     sht40Data.valid = false;
@@ -329,9 +279,6 @@ void resetSHT40() {
     sht40Data.pressure = 0.0;
     sht40SensorStatus = false;
     
-    // Release I2C semaphore
-    if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
-    
     safePrintln("SHT40 sensor reset");
 }
 
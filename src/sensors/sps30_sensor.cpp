@@ -2,22 +2,17 @@
 #include <sensors.h>
 #include <Wire.h>
 #include <sps30.h>
-#include <freertos/FreeRTOS.h>
-#include <freertos/semphr.h>
+#include <i2c_bus.h>
 
 // Forward declarations for safe printing functions
 void safePrint(const String& message);
 void safePrintln(const String& message);
 
-// External I2C semaphore for thread safety
-extern SemaphoreHandle_t i2c_semaphore;
-
 // Global sensor data and status - extern declarations (defined in sensors.cpp)
 extern SPS30Data sps30Data;
 extern bool sps30SensorStatus;
 
 // Reading control variables
-static unsigned long lastReadTime = 0;
 static bool measurementStarted = false;
 static unsigned long measurementStartTime = 0;
 
@@ -25,6 +20,62 @@ static unsigned long measurementStartTime = 0;
 #define SPS30_RETRY_INTERVAL_MS 120000
 static unsigned long lastSPS30RetryTime = 0;
 
+// Próby sps30_probe() przy inicjalizacji (co 500 ms, czekanie poza taskiem magistrali)
+#define SPS30_PROBE_ATTEMPTS 10
+#define SPS30_PROBE_RETRY_DELAY_MS 500
+
+// Funkcje biblioteki SPS30 na tasku magistrali (i2cBusCall); kod błędu biblioteki w context (int16_t)
+static int sps30WakeUpOnBus(void* context) {
+    sensirion_i2c_init(Wire);
+    // Initialize SPS30 using library functions
+    *(int16_t*)context = sps30_wake_up();
+    return 0; // wake-up bywa NACK-owany przez śpiący czujnik - o obecności decyduje probe
+}
+
+// Jedna próba sps30_probe() na transakcję - magistrala wolna między próbami
+static int sps30ProbeOnBus(void* context) {
+    *(int16_t*)context = sps30_probe();
+    return *(int16_t*)context;
+}
+
+static int sps30ResetOnBus(void* context) {
+    *(int16_t*)context = sps30_reset();
+    return *(int16_t*)context;
+}
+
+static int sps30StartOnBus(void* context) {
+    *(int16_t*)context = sps30_start_measurement();
+    return *(int16_t*)context;
+}
+
+static int sps30StopOnBus(void* context) {
+    *(int16_t*)context = sps30_stop_measurement();
+    return *(int16_t*)context;
+}
+
+struct SPS30Poll {
+    int16_t ret;
+    uint16_t dataReady;
+    const char* step;            // funkcja biblioteki, która zwróciła błąd
+    bool readMeasurement;        // false = tylko status gotowości
+    struct sps30_measurement m;
+};
+
+static int sps30PollOnBus(void* context) {
+    SPS30Poll& poll = *(SPS30Poll*)context;
+    // Check if data is ready using simple library function
+    poll.ret = sps30_read_data_ready(&poll.dataReady);
+    if (poll.ret != 0) {
+        poll.step = "Read data ready";
+        return poll.ret;
+    }
+    if (poll.dataReady == 0 || !poll.readMeasurement) return 0;
+    
+    poll.ret = sps30_read_measurement(&poll.m);
+    if (poll.ret != 0) poll.step = "Read measurement";
+    return poll.ret;
+}
+
 bool initializeSPS30() {
     safePrintln("=== Inicjalizacja SPS30 ===");
 //    WebSerial.println("=== Inicjalizacja SPS30 ===");
@@ -32,59 +83,37 @@ bool initializeSPS30() {
     // Initialize status
     sps30SensorStatus = false;
     
-    // Take I2C semaphore for thread safety
-    if (i2c_semaphore && xSemaphoreTake(i2c_semaphore, pdMS_TO_TICKS(100)) != pdTRUE) {
-        safePrintln("SPS30: Failed to take I2C semaphore for init");
+    int16_t ret = 0;
+    i2cBusCall(SPS30_I2C_ADDRESS, sps30WakeUpOnBus, &ret, I2C_PRIORITY_LOW);
+    bool probed = false;
+    for (int attempt = 0; attempt < SPS30_PROBE_ATTEMPTS; attempt++) {
+        if (i2cBusCall(SPS30_I2C_ADDRESS, sps30ProbeOnBus, &ret, I2C_PRIORITY_LOW) == I2C_BUS_OK) {
+            probed = true;
+            break;
+        }
+        safePrintln("SPS sensor probing failed");
+        delay(SPS30_PROBE_RETRY_DELAY_MS);
+    }
+    if (!probed) {
+        safePrint("SPS30: Probe failed with error ");
+        safePrintln(String(ret));
         return false;
     }
     
-    uint32_t start_time = millis();
-    sensirion_i2c_init(Wire);
-    // Initialize SPS30 using library functions
-    int16_t ret = sps30_wake_up();
-     while (sps30_probe() != 0) {
-    Serial.print("SPS sensor probing failed\n");
-    delay(500);
-  }
-    
-    // if (millis() - start_time > I2C_TIMEOUT_MS) {
-    //     safePrintln("SPS30: Initialization timeout");
-    //     if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
-    //     return false;
-    // }
-    
-    // if (ret != 0) {
-    //     safePrint("SPS30: Probe failed with error ");
-    //     safePrintln(String(ret));
-    //     if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
-    //     return false;
-    // }
-    
     // Reset the sensor
-    ret = sps30_reset();
-    if (ret != 0) {
+    if (i2cBusCall(SPS30_I2C_ADDRESS, sps30ResetOnBus, &ret, I2C_PRIORITY_LOW) != I2C_BUS_OK) {
         safePrint("SPS30: Reset failed with error ");
         safePrintln(String(ret));
-        if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
         return false;
     }
     
-    // Wait for reset to complete
+    // Wait for reset to complete (poza magistralą)
     delay(500);
     
-    // // Check timeout after reset
-    // if (millis() - start_time > I2C_TIMEOUT_MS * 2) {
-    //     safePrintln("SPS30: Reset timeout");
-    //     if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
-    //     return false;
-    // }
-    
     // Start measurement
-    ret = sps30_start_measurement();
-    if (ret != 0) {
+    if (i2cBusCall(SPS30_I2C_ADDRESS, sps30StartOnBus, &ret, I2C_PRIORITY_LOW) != I2C_BUS_OK) {
         safePrint("SPS30: Start measurement failed with error ");
         safePrintln(String(ret));
-        if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
         return false;
     }
     
@@ -105,8 +134,6 @@ bool initializeSPS30() {
     sps30Data.valid = false;
     sps30Data.lastUpdate = 0;
     
-    if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
-    
     sps30SensorStatus = true;
     safePrintln("SPS30: Sensor initialized successfully");
     safePrintln("SPS30: Measurement started - data available in ~1 second");
@@ -134,8 +161,8 @@ void retrySPS30IfFailed() {
     }
 }
 
+// Okres odczytu (1 s) wyznacza planista loop() - scheduler.h
 bool readSPS30(SPS30Data& data) {
-    static unsigned long lastReadTime = 0;
     static unsigned long lastRetryCheck = 0;
     unsigned long currentTime = millis();
     
@@ -145,11 +172,6 @@ bool readSPS30(SPS30Data& data) {
         lastRetryCheck = currentTime;
     }
     
-    // Read once per second as requested
-    if (currentTime - lastReadTime < 1000) {
-        return false; // Too soon for next reading
-    }
-    
     if (!sps30SensorStatus) {
         return false; // Sensor not working, don't try to read
     }
@@ -164,54 +186,39 @@ bool readSPS30(SPS30Data& data) {
         return false; // Need to wait at least 1 second after start
     }
     
-    // Take I2C semaphore for thread safety  
-    if (i2c_semaphore && xSemaphoreTake(i2c_semaphore, pdMS_TO_TICKS(100)) != pdTRUE) {
-        safePrintln("SPS30: Failed to take I2C semaphore for reading");
-        return false;
-    }
-    
     uint32_t start_time = millis();
     
-    // Check if data is ready using simple library function
-    uint16_t data_ready = 0;
-    int16_t ret = sps30_read_data_ready(&data_ready);
-    
-    if (ret != 0) {
-        safePrint("SPS30: Read data ready failed with error ");
-        safePrintln(String(ret));
-        if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
+    // Status gotowości i pomiar jedną transakcją
+    SPS30Poll poll;
+    poll.ret = 0;
+    poll.dataReady = 0;
+    poll.step = "I2C";
+    poll.readMeasurement = true;
+    
+    if (i2cBusCall(SPS30_I2C_ADDRESS, sps30PollOnBus, &poll) != I2C_BUS_OK) {
+        safePrint("SPS30: ");
+        safePrint(poll.step);
+        safePrint(" failed with error ");
+        safePrintln(String(poll.ret));
         return false;
     }
     
-    if (data_ready == 0) {
-        if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
+    if (poll.dataReady == 0) {
         return false; // Data not ready yet
     }
     
-    // Read measurements with timeout protection
-    struct sps30_measurement m;
-    
-    ret = sps30_read_measurement(&m);
-    
     // Check timeout protection
     if (millis() - start_time > I2C_TIMEOUT_MS) {
         safePrintln("SPS30: Read timeout detected");
-        if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
         return false;
     }
     
-    if (ret != 0) {
-        safePrint("SPS30: Read measurement failed with error ");
-        safePrintln(String(ret));
-        if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
-        return false;
-    }
+    const struct sps30_measurement& m = poll.m;
     
     // Validate readings (check for reasonable values)
     if (m.mc_1p0 < 0 || m.mc_1p0 > 1000 || m.mc_2p5 < 0 || m.mc_2p5 > 1000 ||
         m.mc_4p0 < 0 || m.mc_4p0 > 1000 || m.mc_10p0 < 0 || m.mc_10p0 > 1000) {
         safePrintln("SPS30: Invalid PM readings detected");
-        if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
         return false;
     }
     
@@ -229,11 +236,9 @@ bool readSPS30(SPS30Data& data) {
     data.valid = true;
     data.lastUpdate = currentTime;
    // Serial.println("SPS30: Data read successfully");
-    lastReadTime = currentTime;
     //set valid to true
     sps30Data.valid = true;
     sps30SensorStatus = true;
-    if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
     
     // Debug output
     
@@ -258,32 +263,19 @@ void cleanSPS30() {
         return;
     }
     
-    // Take I2C semaphore for thread safety
-    if (i2c_semaphore && xSemaphoreTake(i2c_semaphore, pdMS_TO_TICKS(100)) != pdTRUE) {
-        safePrintln("SPS30: Failed to take I2C semaphore for cleaning");
-        return;
-    }
-    
     safePrintln("SPS30: Starting fan cleaning cycle...");
     
     // Note: Function name may vary between library versions
     // int16_t ret = sps30_start_fan_cleaning();
     // For now, we'll skip this feature until we confirm the correct function name
     safePrintln("SPS30: Fan cleaning function not available in this library version");
-    
-    if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
 }
 
 void resetSPS30() {
     safePrintln("SPS30: Resetting sensor...");
     
-    // Take I2C semaphore for thread safety
-    if (i2c_semaphore && xSemaphoreTake(i2c_semaphore, pdMS_TO_TICKS(100)) != pdTRUE) {
-        safePrintln("SPS30: Failed to take I2C semaphore for reset");
-        return;
-    }
-    
-    int16_t ret = sps30_reset();
+    int16_t ret = 0;
+    i2cBusCall(SPS30_I2C_ADDRESS, sps30ResetOnBus, &ret, I2C_PRIORITY_LOW);
     if (ret != 0) {
         safePrint("SPS30: Reset failed with error ");
         safePrintln(String(ret));
@@ -292,20 +284,13 @@ void resetSPS30() {
         measurementStarted = false;
         delay(500); // Wait for reset to complete
     }
-    
-    if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
 }
 
 void startSPS30Measurement() {
     if (!sps30SensorStatus) return;
     
-    // Take I2C semaphore for thread safety
-    if (i2c_semaphore && xSemaphoreTake(i2c_semaphore, pdMS_TO_TICKS(100)) != pdTRUE) {
-        safePrintln("SPS30: Failed to take I2C semaphore for start measurement");
-        return;
-    }
-    
-    int16_t ret = sps30_start_measurement();
+    int16_t ret = 0;
+    i2cBusCall(SPS30_I2C_ADDRESS, sps30StartOnBus, &ret, I2C_PRIORITY_LOW);
     if (ret != 0) {
         safePrint("SPS30: Start measurement failed with error ");
         safePrintln(String(ret));
@@ -314,20 +299,13 @@ void startSPS30Measurement() {
         measurementStartTime = millis();
         safePrintln("SPS30: Measurement started");
     }
-    
-    if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
 }
 
 void stopSPS30Measurement() {
     if (!sps30SensorStatus) return;
     
-    // Take I2C semaphore for thread safety
-    if (i2c_semaphore && xSemaphoreTake(i2c_semaphore, pdMS_TO_TICKS(100)) != pdTRUE) {
-        safePrintln("SPS30: Failed to take I2C semaphore for stop measurement");
-        return;
-    }
-    
-    int16_t ret = sps30_stop_measurement();
+    int16_t ret = 0;
+    i2cBusCall(SPS30_I2C_ADDRESS, sps30StopOnBus, &ret, I2C_PRIORITY_LOW);
     if (ret != 0) {
         safePrint("SPS30: Stop measurement failed with error ");
         safePrintln(String(ret));
@@ -335,8 +313,6 @@ void stopSPS30Measurement() {
         measurementStarted = false;
         safePrintln("SPS30: Measurement stopped");
     }
-    
-    if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
 }
 
 bool isSPS30DataReady() {
@@ -344,17 +320,13 @@ bool isSPS30DataReady() {
         return false;
     }
     
-    // Take I2C semaphore for thread safety
-    if (i2c_semaphore && xSemaphoreTake(i2c_semaphore, pdMS_TO_TICKS(50)) != pdTRUE) {
-        return false;
-    }
-    
-    uint16_t data_ready = 0;
-    int16_t ret = sps30_read_data_ready(&data_ready);
-    
-    if (i2c_semaphore) xSemaphoreGive(i2c_semaphore);
+    SPS30Poll poll;
+    poll.ret = 0;
+    poll.dataReady = 0;
+    poll.step = "I2C";
+    poll.readMeasurement = false;
     
-    return (ret == 0) && (data_ready != 0);
+    return i2cBusCall(SPS30_I2C_ADDRESS, sps30PollOnBus, &poll) == I2C_BUS_OK && poll.dataReady != 0;
 }
 
 void enableSPS30Sensor() {
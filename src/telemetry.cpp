@@ -0,0 +1,782 @@
+#include <telemetry.h>
+#include <sensors.h>
+#include <calib.h>
+#include <config.h>
+#include <mean.h>
+#include <fan.h>
+#include <history.h>
+#include <json_arena.h>
+#include <fnv_hash.h>
+#include <ArduinoJson.h>
+#include <WiFi.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// Forward declarations for safe printing functions
+void safePrint(const String& message);
+void safePrintln(const String& message);
+
+// Time helpers (web_server.cpp)
+extern String getFormattedTime();
+extern String getFormattedDate();
+extern time_t getEpochTime();
+extern bool isTimeSet();
+
+extern FeatureConfig config;
+extern HistoryManager historyManager;
+
+extern SolarData solarData;
+extern HistogramData opcn3Data;
+extern I2CSensorData i2cSensorData;
+extern MCP3424Data mcp3424Data;
+extern ADS1110Data ads1110Data;
+extern INA219Data ina219Data;
+extern SPS30Data sps30Data;
+extern SHT40Data sht40Data;
+extern HCHOData hchoData;
+extern IPSSensorData ipsSensorData;
+extern BatteryData batteryData;
+
+extern bool solarSensorStatus;
+extern bool opcn3SensorStatus;
+extern bool i2cSensorStatus;
+extern bool sps30SensorStatus;
+extern bool sht40SensorStatus;
+extern bool scd41SensorStatus;
+extern bool mcp3424SensorStatus;
+extern bool ads1110SensorStatus;
+extern bool ina219SensorStatus;
+extern bool hchoSensorStatus;
+extern bool ipsSensorStatus;
+
+extern CalibratedSensorData calibratedData;
+extern CalibrationConfig calibConfig;
+
+// Wartości systemowe zbierane w loop() co TELEMETRY_SYSTEM_INTERVAL -
+// budowanie JSON nie woła już WiFi.RSSI() / getLocalTime() / ESP.getFree*()
+struct TelemetrySystemSnapshot {
+    unsigned long t;
+    uint32_t freeHeap;
+    int32_t wifiSignal;
+    char ntpTime[12];
+    char ntpDate[12];
+    time_t ntpEpoch;
+    bool ntpValid;
+    bool historyEnabled;
+    size_t historyMemoryUsed;
+    uint32_t psramSize;
+    uint32_t freePsram;
+};
+
+// Gotowy fragment sekcji: zawartość obiektu bez zewnętrznych klamer, np. "solar":{...}
+struct TelemetryFragment {
+    char* data;
+    size_t capacity;
+    size_t length;
+    uint32_t generation;
+    bool built;
+};
+
+typedef void (*TelemetryBuilder)(JsonDocument& doc);
+typedef uint32_t (*TelemetryFingerprint)();
+
+struct TelemetrySectionDef {
+    const char* name;
+    TelemetryBuilder build;
+    TelemetryFingerprint fingerprint;   // nullptr - sekcja odświeżana w updateTelemetrySnapshot()
+    size_t capacity;                    // początkowy rozmiar fragmentu
+};
+
+static TelemetrySystemSnapshot systemSnapshot;
+static volatile uint32_t sectionGeneration[TELEMETRY_SECTION_COUNT];
+static uint32_t sectionFingerprint[TELEMETRY_SECTION_COUNT];
+static TelemetryFragment fragments[TELEMETRY_SECTION_COUNT];
+static uint32_t sectionRebuilds[TELEMETRY_SECTION_COUNT];
+
+static SemaphoreHandle_t telemetryMutex = nullptr;
+static SpiRamJsonDocument* fragmentDoc = nullptr;
+static char* assembled = nullptr;               // ostatnio złożony dokument
+static size_t assembledLength = 0;
+static uint32_t assembledGeneration = 0;
+static bool assembledValid = false;
+static unsigned long lastSystemCapture = 0;
+
+static uint32_t telemetryAssemblies = 0;
+static uint32_t telemetryReuses = 0;            // dokument bez zmian - bez składania
+static uint32_t telemetryOversize = 0;
+
+// ===== Odciski danych źródłowych =====
+
+// Sekcje z uśrednianiem zmieniają się przy przeliczeniu średnich, pozostałe przy nowym odczycie
+static uint32_t sourceKey(uint32_t hash, bool valid, unsigned long lastUpdate) {
+    hash = fnv1aMix(hash, config.useAveragedData);
+    hash = fnv1aMix(hash, valid);
+    return fnv1aMix(hash, config.useAveragedData ? getAveragesGeneration() : lastUpdate);
+}
+
+static uint32_t fingerprintSensorsEnabled() {
+    uint32_t bits = solarSensorStatus | (opcn3SensorStatus << 1) | (sht40SensorStatus << 2) |
+                    (scd41SensorStatus << 3) | (sps30SensorStatus << 4) | (mcp3424SensorStatus << 5) |
+                    (ads1110SensorStatus << 6) | (ina219SensorStatus << 7) | (hchoSensorStatus << 8) |
+                    (ipsSensorStatus << 9) | (config.enableFan << 10);
+    return fnv1aMix(FNV1A_OFFSET_BASIS, bits);
+}
+
+static uint32_t fingerprintSolar() {
+    return sourceKey(fnv1aMix(FNV1A_OFFSET_BASIS, solarSensorStatus), solarData.valid, solarData.lastUpdate);
+}
+
+static uint32_t fingerprintOPCN3() {
+    // Brak znacznika czasu w HistogramData - odcisk z publikowanych wartości
+    uint32_t hash = fnv1aMix(FNV1A_OFFSET_BASIS, opcn3SensorStatus && opcn3Data.valid);
+    hash = fnv1aMixFloat(hash, opcn3Data.pm1);
+    hash = fnv1aMixFloat(hash, opcn3Data.pm2_5);
+    hash = fnv1aMixFloat(hash, opcn3Data.pm10);
+    hash = fnv1aMixFloat(hash, opcn3Data.getTempC());
+    return fnv1aMixFloat(hash, opcn3Data.getHumidity());
+}
+
+static uint32_t fingerprintSPS30() {
+    return sourceKey(fnv1aMix(FNV1A_OFFSET_BASIS, sps30SensorStatus), sps30Data.valid, sps30Data.lastUpdate);
+}
+
+static uint32_t fingerprintSHT40() {
+    return sourceKey(fnv1aMix(FNV1A_OFFSET_BASIS, sht40SensorStatus), sht40Data.valid, sht40Data.lastUpdate);
+}
+
+static uint32_t fingerprintSCD41() {
+    uint32_t hash = fnv1aMix(FNV1A_OFFSET_BASIS, scd41SensorStatus);
+    return fnv1aMixFloat(hash, i2cSensorData.co2);
+}
+
+static uint32_t fingerprintMCP3424() {
+    uint32_t hash = fnv1aMix(FNV1A_OFFSET_BASIS, mcp3424SensorStatus);
+    hash = fnv1aMix(hash, mcp3424Data.deviceCount);
+    hash = fnv1aMix(hash, mcp3424Data.lastUpdate);
+    hash = fnv1aMix(hash, mcp3424Data.resolution);
+    hash = fnv1aMix(hash, mcp3424Data.gain);
+    for (uint8_t device = 0; device < mcp3424Data.deviceCount && device < MAX_MCP3424_DEVICES; device++) {
+        hash = fnv1aMix(hash, mcp3424Data.valid[device]);
+        hash = fnv1aMix(hash, mcp3424Data.addresses[device]);
+    }
+    return hash;
+}
+
+static uint32_t fingerprintADS1110() {
+    uint32_t hash = fnv1aMix(FNV1A_OFFSET_BASIS, ads1110SensorStatus);
+    hash = fnv1aMix(hash, ads1110Data.valid);
+    return fnv1aMix(hash, ads1110Data.lastUpdate);
+}
+
+static uint32_t fingerprintPower() {
+    return sourceKey(fnv1aMix(FNV1A_OFFSET_BASIS, ina219SensorStatus), ina219Data.valid, ina219Data.lastUpdate);
+}
+
+static uint32_t fingerprintHCHO() {
+    uint32_t hash = sourceKey(fnv1aMix(FNV1A_OFFSET_BASIS, hchoSensorStatus), hchoData.valid, hchoData.lastUpdate);
+    // Pole "age" zmienia się co sekundę
+    return fnv1aMix(hash, hchoData.valid ? (millis() - hchoData.lastUpdate) / 1000 : 0);
+}
+
+static uint32_t fingerprintIPS() {
+    uint32_t hash = fnv1aMix(FNV1A_OFFSET_BASIS, ipsSensorStatus);
+    hash = fnv1aMix(hash, ipsSensorData.valid);
+    hash = fnv1aMix(hash, ipsSensorData.lastUpdate);
+    hash = fnv1aMix(hash, ipsSensorData.debugMode);
+    return fnv1aMix(hash, ipsSensorData.won);
+}
+
+static uint32_t fingerprintFan() {
+    if (!config.enableFan) return 0;
+    uint32_t hash = fnv1aMix(FNV1A_OFFSET_BASIS, isFanEnabled());
+    hash = fnv1aMix(hash, getFanDutyCycle());
+    hash = fnv1aMix(hash, getFanRPM());
+    return fnv1aMix(hash, isGLineEnabled());
+}
+
+static uint32_t fingerprintBattery() {
+    uint32_t hash = fnv1aMix(FNV1A_OFFSET_BASIS, batteryData.valid);
+    if (!batteryData.valid) return hash;
+    hash = fnv1aMix(hash, batteryData.lastUpdate);
+    hash = fnv1aMix(hash, (millis() - batteryData.lastUpdate) / 1000);
+    return fnv1aMix(hash, digitalRead(OFF_PIN));
+}
+
+static uint32_t fingerprintCalibration() {
+    uint32_t flags = calibConfig.enableCalibration | (calibConfig.enableTGSSensors << 1) |
+                     (calibConfig.enableGasSensors << 2) | (calibConfig.enablePPBConversion << 3) |
+                     (calibConfig.enableSpecialSensors << 4) | (calibConfig.enableMovingAverages << 5);
+    uint32_t hash = fnv1aMix(FNV1A_OFFSET_BASIS, flags);
+    return sourceKey(fnv1aMix(hash, calibratedData.lastUpdate), calibratedData.valid, calibratedData.lastUpdate);
+}
+
+// ===== Budowanie sekcji =====
+
+static void buildSystemSection(JsonDocument& doc) {
+    const TelemetrySystemSnapshot& s = systemSnapshot;
+    doc["t"] = s.t;
+    doc["uptime"] = s.t / 1000;
+    doc["freeHeap"] = s.freeHeap;
+    doc["wifiSignal"] = s.wifiSignal;
+    doc["DeviceID"] = config.DeviceID;
+    doc["ntpTime"] = s.ntpTime;
+    doc["ntpEpoch"] = s.ntpEpoch;
+    doc["ntpDate"] = s.ntpDate;
+    doc["ntpValid"] = s.ntpValid;
+    // History status
+    JsonObject history = doc.createNestedObject("history");
+    history["configEnabled"] = config.enableHistory;
+    history["enabled"] = s.historyEnabled;
+    history["memoryUsed"] = s.historyMemoryUsed;
+    history["memoryBudget"] = TARGET_MEMORY_BYTES;
+
+    doc["psramSize"] = s.psramSize;
+    doc["freePsram"] = s.freePsram;
+    doc["lowPowerMode"] = config.lowPowerMode;
+    doc["enablePushbullet"] = config.enablePushbullet;
+}
+
+static void buildSensorsEnabledSection(JsonDocument& doc) {
+    JsonObject sensorsEnabled = doc.createNestedObject("sensorsEnabled");
+    sensorsEnabled["solar"] = solarSensorStatus;
+    sensorsEnabled["opcn3"] = opcn3SensorStatus;
+    sensorsEnabled["sht40"] = sht40SensorStatus;
+    sensorsEnabled["scd41"] = scd41SensorStatus;
+    sensorsEnabled["sps30"] = sps30SensorStatus;
+    sensorsEnabled["mcp3424"] = mcp3424SensorStatus;
+    sensorsEnabled["ads1110"] = ads1110SensorStatus;
+    sensorsEnabled["ina219"] = ina219SensorStatus;
+    sensorsEnabled["hcho"] = hchoSensorStatus;
+    sensorsEnabled["ips"] = ipsSensorStatus;
+    sensorsEnabled["fan"] = config.enableFan; // Fan only if enabled
+}
+
+static void buildSolarSection(JsonDocument& doc) {
+    JsonObject solar = doc.createNestedObject("solar");
+    SolarData avgData;
+    const SolarData& data = config.useAveragedData ? (avgData = getSolarFastAverage()) : solarData;
+    solar["valid"] = solarSensorStatus && data.valid;
+    if (solarSensorStatus && data.valid) {
+        solar["V"] = data.V;
+        solar["I"] = data.I;
+        solar["VPV"] = data.VPV;
+        solar["PPV"] = data.PPV;
+    }
+}
+
+static void buildOPCN3Section(JsonDocument& doc) {
+    JsonObject opcn3 = doc.createNestedObject("opcn3");
+    opcn3["valid"] = opcn3SensorStatus && opcn3Data.valid;
+    if (opcn3SensorStatus && opcn3Data.valid) {
+        opcn3["PM1"] = opcn3Data.pm1;
+        opcn3["PM25"] = opcn3Data.pm2_5;
+        opcn3["PM10"] = opcn3Data.pm10;
+        opcn3["temperature"] = opcn3Data.getTempC();
+        opcn3["humidity"] = opcn3Data.getHumidity();
+    }
+}
+
+static void buildSPS30Section(JsonDocument& doc) {
+    JsonObject sps30 = doc.createNestedObject("sps30");
+    SPS30Data avgData;
+    const SPS30Data& data = config.useAveragedData ? (avgData = getSPS30FastAverage()) : sps30Data;
+    sps30["valid"] = sps30SensorStatus && data.valid;
+    if (sps30SensorStatus && data.valid) {
+        sps30["PM1"] = round(data.pm1_0 * 10) / 10.0;
+        sps30["PM25"] = round(data.pm2_5 * 10) / 10.0;
+        sps30["PM4"] = round(data.pm4_0 * 10) / 10.0;
+        sps30["PM10"] = round(data.pm10 * 10) / 10.0;
+        sps30["NC05"] = round(data.nc0_5 * 10) / 10.0;
+        sps30["NC1"] = round(data.nc1_0 * 10) / 10.0;
+        sps30["NC25"] = round(data.nc2_5 * 10) / 10.0;
+        sps30["NC4"] = round(data.nc4_0 * 10) / 10.0;
+        sps30["NC10"] = round(data.nc10 * 10) / 10.0;
+        sps30["TPS"] = round(data.typical_particle_size * 10) / 10.0;
+    }
+}
+
+// SHT40 (temperature, humidity, pressure)
+static void buildSHT40Section(JsonDocument& doc) {
+    JsonObject sht40 = doc.createNestedObject("sht40");
+    SHT40Data avgData;
+    const SHT40Data& data = config.useAveragedData ? (avgData = getSHT40FastAverage()) : sht40Data;
+    sht40["valid"] = sht40SensorStatus && data.valid;
+    if (sht40SensorStatus && data.valid) {
+        sht40["temperature"] = round(data.temperature * 100) / 100.0;
+        sht40["humidity"] = round(data.humidity * 100) / 100.0;
+        sht40["pressure"] = round(data.pressure * 100) / 100.0;
+    }
+}
+
+// CO2 (SCD41)
+static void buildSCD41Section(JsonDocument& doc) {
+    JsonObject scd41 = doc.createNestedObject("scd41");
+    scd41["valid"] = scd41SensorStatus;
+    if (scd41SensorStatus) {
+        scd41["co2"] = i2cSensorData.co2;
+    }
+}
+
+// MCP3424 (all devices)
+static void buildMCP3424Section(JsonDocument& doc) {
+    JsonObject mcp3424 = doc.createNestedObject("mcp3424");
+    mcp3424["enabled"] = mcp3424SensorStatus;
+    mcp3424["deviceCount"] = mcp3424Data.deviceCount;
+    JsonArray devices = mcp3424.createNestedArray("devices");
+    for (uint8_t device = 0; device < mcp3424Data.deviceCount; device++) {
+        JsonObject deviceObj = devices.createNestedObject();
+        deviceObj["address"] = "0x" + String(mcp3424Data.addresses[device], HEX);
+        deviceObj["valid"] = mcp3424Data.valid[device];
+        deviceObj["resolution"] = mcp3424Data.resolution;
+        deviceObj["gain"] = mcp3424Data.gain;
+        JsonObject channels = deviceObj.createNestedObject("channels");
+        channels["ch1"] = mcp3424Data.channels[device][0];
+        channels["ch2"] = mcp3424Data.channels[device][1];
+        channels["ch3"] = mcp3424Data.channels[device][2];
+        channels["ch4"] = mcp3424Data.channels[device][3];
+    }
+}
+
+static void buildADS1110Section(JsonDocument& doc) {
+    JsonObject ads1110 = doc.createNestedObject("ads1110");
+    ads1110["enabled"] = ads1110SensorStatus;
+    ads1110["valid"] = ads1110SensorStatus && ads1110Data.valid;
+    if (ads1110SensorStatus && ads1110Data.valid) {
+        ads1110["voltage"] = round(ads1110Data.voltage * 1000000) / 1000000.0;
+        ads1110["dataRate"] = ads1110Data.dataRate;
+        ads1110["gain"] = ads1110Data.gain;
+    }
+}
+
+static void buildPowerSection(JsonDocument& doc) {
+    JsonObject power = doc.createNestedObject("power");
+    INA219Data avgData;
+    const INA219Data& data = config.useAveragedData ? (avgData = getINA219FastAverage()) : ina219Data;
+    power["valid"] = ina219SensorStatus && data.valid;
+    if (ina219SensorStatus && data.valid) {
+        power["busVoltage"] = round(data.busVoltage * 1000) / 1000.0;
+        power["shuntVoltage"] = round(data.shuntVoltage * 100) / 100.0;
+        power["current"] = round(data.current * 100) / 100.0;
+        power["power"] = round(data.power * 100) / 100.0;
+    }
+}
+
+// HCHO (formaldehyde sensor)
+static void buildHCHOSection(JsonDocument& doc) {
+    JsonObject hcho = doc.createNestedObject("hcho");
+    hcho["enabled"] = hchoSensorStatus;
+    HCHOData avgData;
+    const HCHOData& data = config.useAveragedData ? (avgData = getHCHOFastAverage()) : hchoData;
+    hcho["valid"] = hchoSensorStatus && data.valid;
+    if (hchoSensorStatus && data.valid) {
+        hcho["hcho_mg"] = data.hcho;
+        hcho["hcho_ppb"] = data.hcho_ppb;
+        hcho["age"] = (millis() - data.lastUpdate) / 1000;
+    }
+}
+
+// IPS (all particle data)
+static void buildIPSSection(JsonDocument& doc) {
+    JsonObject ips = doc.createNestedObject("ips");
+    ips["enabled"] = ipsSensorStatus;
+    ips["valid"] = ipsSensorStatus && ipsSensorData.valid;
+    if (ipsSensorStatus && ipsSensorData.valid) {
+        JsonArray pc = ips.createNestedArray("PC");
+        JsonArray pm = ips.createNestedArray("PM");
+        JsonArray np = ips.createNestedArray("NP");
+        JsonArray pw = ips.createNestedArray("PW");
+        for (int i = 0; i < 7; i++) {
+            pc.add(ipsSensorData.pc_values[i]);
+            pm.add(round(ipsSensorData.pm_values[i] * 100) / 100.0);
+            np.add(ipsSensorData.np_values[i]);
+            pw.add(ipsSensorData.pw_values[i]);
+        }
+        ips["debugMode"] = ipsSensorData.debugMode;
+        ips["won"] = ipsSensorData.won;
+    }
+}
+
+// Fan control system
+static void buildFanSection(JsonDocument& doc) {
+    JsonObject fan = doc.createNestedObject("fan");
+    fan["enabled"] = config.enableFan && isFanEnabled();
+    fan["dutyCycle"] = config.enableFan ? getFanDutyCycle() : 0;
+    fan["rpm"] = config.enableFan ? getFanRPM() : 0;
+    fan["glineEnabled"] = config.enableFan && isGLineEnabled();
+    fan["pwmValue"] = config.enableFan ? map(getFanDutyCycle(), 0, 100, 0, 255) : 0;
+    fan["pwmFreq"] = 25000; // 25kHz
+    fan["valid"] = config.enableFan;
+}
+
+// Battery monitoring
+static void buildBatterySection(JsonDocument& doc) {
+    JsonObject battery = doc.createNestedObject("battery");
+    battery["valid"] = batteryData.valid;
+    if (batteryData.valid) {
+        battery["voltage"] = round(batteryData.voltage * 1000) / 1000.0;
+        battery["current"] = round(batteryData.current * 100) / 100.0;
+        battery["power"] = round(batteryData.power * 100) / 100.0;
+        battery["chargePercent"] = batteryData.chargePercent;
+        battery["isBatteryPowered"] = batteryData.isBatteryPowered;
+        battery["lowBattery"] = batteryData.lowBattery;
+        battery["criticalBattery"] = batteryData.criticalBattery;
+        battery["offPinState"] = digitalRead(OFF_PIN);
+        battery["age"] = (millis() - batteryData.lastUpdate) / 1000;
+    }
+}
+
+// Calibration data (all sensors if enabled)
+static void buildCalibrationSection(JsonDocument& doc) {
+    JsonObject calibration = doc.createNestedObject("calibration");
+    calibration["enabled"] = calibConfig.enableCalibration;
+    if (config.useAveragedData) {
+        CalibratedSensorData avgData = getCalibratedFastAverage();
+        calibration["valid"] = calibratedData.valid && avgData.valid;
+    } else {
+        calibration["valid"] = calibratedData.valid;
+    }
+    if (!calibConfig.enableCalibration || !calibratedData.valid) return;
+
+    // Configuration
+    JsonObject configObj = calibration.createNestedObject("config");
+    configObj["tgsSensors"] = calibConfig.enableTGSSensors;
+    configObj["gasSensors"] = calibConfig.enableGasSensors;
+    configObj["ppbConversion"] = calibConfig.enablePPBConversion;
+    configObj["specialSensors"] = calibConfig.enableSpecialSensors;
+    configObj["movingAverages"] = calibConfig.enableMovingAverages;
+
+    // Temperatures (all K sensors)
+    JsonObject temperatures = calibration.createNestedObject("temperatures");
+    if (!isnan(calibratedData.K1_temp)) temperatures["K1"] = round(calibratedData.K1_temp * 10) / 10.0;
+    if (!isnan(calibratedData.K2_temp)) temperatures["K2"] = round(calibratedData.K2_temp * 10) / 10.0;
+    if (!isnan(calibratedData.K3_temp)) temperatures["K3"] = round(calibratedData.K3_temp * 10) / 10.0;
+    if (!isnan(calibratedData.K4_temp)) temperatures["K4"] = round(calibratedData.K4_temp * 10) / 10.0;
+    if (!isnan(calibratedData.K5_temp)) temperatures["K5"] = round(calibratedData.K5_temp * 10) / 10.0;
+    if (!isnan(calibratedData.K6_temp)) temperatures["K6"] = round(calibratedData.K6_temp * 10) / 10.0;
+    if (!isnan(calibratedData.K7_temp)) temperatures["K7"] = round(calibratedData.K7_temp * 10) / 10.0;
+    if (!isnan(calibratedData.K8_temp)) temperatures["K8"] = round(calibratedData.K8_temp * 10) / 10.0;
+    if (!isnan(calibratedData.K9_temp)) temperatures["K9"] = round(calibratedData.K9_temp * 10) / 10.0;
+    if (!isnan(calibratedData.K12_temp)) temperatures["K12"] = round(calibratedData.K12_temp * 10) / 10.0;
+
+    // Voltages (all K sensors)
+    JsonObject voltages = calibration.createNestedObject("voltages");
+    if (!isnan(calibratedData.K1_voltage)) voltages["K1"] = round(calibratedData.K1_voltage * 100) / 100.0;
+    if (!isnan(calibratedData.K2_voltage)) voltages["K2"] = round(calibratedData.K2_voltage * 100) / 100.0;
+    if (!isnan(calibratedData.K3_voltage)) voltages["K3"] = round(calibratedData.K3_voltage * 100) / 100.0;
+    if (!isnan(calibratedData.K4_voltage)) voltages["K4"] = round(calibratedData.K4_voltage * 100) / 100.0;
+    if (!isnan(calibratedData.K5_voltage)) voltages["K5"] = round(calibratedData.K5_voltage * 100) / 100.0;
+    if (!isnan(calibratedData.K6_voltage)) voltages["K6"] = round(calibratedData.K6_voltage * 100) / 100.0;
+    if (!isnan(calibratedData.K7_voltage)) voltages["K7"] = round(calibratedData.K7_voltage * 100) / 100.0;
+    if (!isnan(calibratedData.K8_voltage)) voltages["K8"] = round(calibratedData.K8_voltage * 100) / 100.0;
+    if (!isnan(calibratedData.K9_voltage)) voltages["K9"] = round(calibratedData.K9_voltage * 100) / 100.0;
+    if (!isnan(calibratedData.K12_voltage)) voltages["K12"] = round(calibratedData.K12_voltage * 100) / 100.0;
+
+    // Gases (ug/m3) - if gas sensors enabled
+    if (calibConfig.enableGasSensors) {
+        JsonObject gases_ugm3 = calibration.createNestedObject("gases_ugm3");
+        if (!isnan(calibratedData.CO)) gases_ugm3["CO"] = round(calibratedData.CO * 10) / 10.0;
+        if (!isnan(calibratedData.NO)) gases_ugm3["NO"] = round(calibratedData.NO * 10) / 10.0;
+        if (!isnan(calibratedData.NO2)) gases_ugm3["NO2"] = round(calibratedData.NO2 * 10) / 10.0;
+        if (!isnan(calibratedData.O3)) gases_ugm3["O3"] = round(calibratedData.O3 * 10) / 10.0;
+        if (!isnan(calibratedData.SO2)) gases_ugm3["SO2"] = round(calibratedData.SO2 * 10) / 10.0;
+        if (!isnan(calibratedData.H2S)) gases_ugm3["H2S"] = round(calibratedData.H2S * 10) / 10.0;
+        if (!isnan(calibratedData.NH3)) gases_ugm3["NH3"] = round(calibratedData.NH3 * 10) / 10.0;
+        if (!isnan(calibratedData.VOC)) gases_ugm3["VOC"] = round(calibratedData.VOC * 10) / 10.0;
+
+        // Gases (ppb) - if PPB conversion enabled
+        if (calibConfig.enablePPBConversion) {
+            JsonObject gases_ppb = calibration.createNestedObject("gases_ppb");
+            if (!isnan(calibratedData.CO_ppb)) gases_ppb["CO"] = round(calibratedData.CO_ppb * 10) / 10.0;
+            if (!isnan(calibratedData.NO_ppb)) gases_ppb["NO"] = round(calibratedData.NO_ppb * 10) / 10.0;
+            if (!isnan(calibratedData.NO2_ppb)) gases_ppb["NO2"] = round(calibratedData.NO2_ppb * 10) / 10.0;
+            if (!isnan(calibratedData.O3_ppb)) gases_ppb["O3"] = round(calibratedData.O3_ppb * 10) / 10.0;
+            if (!isnan(calibratedData.SO2_ppb)) gases_ppb["SO2"] = round(calibratedData.SO2_ppb * 10) / 10.0;
+            if (!isnan(calibratedData.H2S_ppb)) gases_ppb["H2S"] = round(calibratedData.H2S_ppb * 10) / 10.0;
+            if (!isnan(calibratedData.NH3_ppb)) gases_ppb["NH3"] = round(calibratedData.NH3_ppb * 10) / 10.0;
+            if (!isnan(calibratedData.VOC_ppb)) gases_ppb["VOC"] = round(calibratedData.VOC_ppb * 10) / 10.0;
+        }
+    }
+
+    // TGS sensors - if TGS sensors enabled
+    if (calibConfig.enableTGSSensors) {
+        JsonObject tgs = calibration.createNestedObject("tgs");
+        if (!isnan(calibratedData.TGS02)) tgs["TGS02"] = round(calibratedData.TGS02 * 1000) / 1000.0;
+        if (!isnan(calibratedData.TGS03)) tgs["TGS03"] = round(calibratedData.TGS03 * 1000) / 1000.0;
+        if (!isnan(calibratedData.TGS12)) tgs["TGS12"] = round(calibratedData.TGS12 * 1000) / 1000.0;
+        if (!isnan(calibratedData.TGS02_ohm)) tgs["TGS02_ohm"] = calibratedData.TGS02_ohm;
+        if (!isnan(calibratedData.TGS03_ohm)) tgs["TGS03_ohm"] = calibratedData.TGS03_ohm;
+        if (!isnan(calibratedData.TGS12_ohm)) tgs["TGS12_ohm"] = calibratedData.TGS12_ohm;
+    }
+
+    // Special sensors - if special sensors enabled
+    if (calibConfig.enableSpecialSensors) {
+        JsonObject special = calibration.createNestedObject("special");
+        if (!isnan(calibratedData.HCHO)) special["HCHO_ppb"] = calibratedData.HCHO;
+        if (!isnan(calibratedData.PID)) special["PID"] = round(calibratedData.PID * 1000) / 1000.0;
+        if (!isnan(calibratedData.PID_mV)) special["PID_mV"] = round(calibratedData.PID_mV * 100) / 100.0;
+    }
+}
+
+// Kolejność sekcji = kolejność kluczy w dokumencie (jak w dawnym buildAllSensorJson)
+static const TelemetrySectionDef telemetrySections[TELEMETRY_SECTION_COUNT] = {
+    {"system",         buildSystemSection,         nullptr,                   512},
+    {"sensorsEnabled", buildSensorsEnabledSection, fingerprintSensorsEnabled, 256},
+    {"solar",          buildSolarSection,          fingerprintSolar,          160},
+    {"opcn3",          buildOPCN3Section,          fingerprintOPCN3,          160},
+    {"sps30",          buildSPS30Section,          fingerprintSPS30,          256},
+    {"sht40",          buildSHT40Section,          fingerprintSHT40,          128},
+    {"scd41",          buildSCD41Section,          fingerprintSCD41,           64},
+    {"mcp3424",        buildMCP3424Section,        fingerprintMCP3424,       1024},
+    {"ads1110",        buildADS1110Section,        fingerprintADS1110,        128},
+    {"power",          buildPowerSection,          fingerprintPower,          160},
+    {"hcho",           buildHCHOSection,           fingerprintHCHO,           128},
+    {"ips",            buildIPSSection,            fingerprintIPS,            512},
+    {"fan",            buildFanSection,            fingerprintFan,            160},
+    {"battery",        buildBatterySection,        fingerprintBattery,        256},
+    {"calibration",    buildCalibrationSection,    fingerprintCalibration,   1536},
+};
+
+static char* allocateTelemetryBuffer(size_t size) {
+    char* buffer = (char*)heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!buffer) {
+        buffer = (char*)malloc(size);
+    }
+    return buffer;
+}
+
+bool initializeTelemetry() {
+    if (telemetryMutex) return true;
+
+    telemetryMutex = xSemaphoreCreateMutex();
+    fragmentDoc = new SpiRamJsonDocument(4096);
+    assembled = allocateTelemetryBuffer(TELEMETRY_JSON_MAX_SIZE);
+    if (!telemetryMutex || !fragmentDoc || !assembled) {
+        safePrintln("Telemetry: failed to allocate snapshot buffers");
+        return false;
+    }
+
+    size_t total = TELEMETRY_JSON_MAX_SIZE;
+    for (int i = 0; i < TELEMETRY_SECTION_COUNT; i++) {
+        fragments[i].data = allocateTelemetryBuffer(telemetrySections[i].capacity);
+        fragments[i].capacity = fragments[i].data ? telemetrySections[i].capacity : 0;
+        total += fragments[i].capacity;
+    }
+
+    safePrintln("Telemetry: " + String(TELEMETRY_SECTION_COUNT) + " sections, " + String(total / 1024) + " KB snapshot buffers");
+    return true;
+}
+
+static void captureSystemSnapshot(unsigned long now) {
+    TelemetrySystemSnapshot& s = systemSnapshot;
+    s.t = now;
+    s.freeHeap = ESP.getFreeHeap();
+    s.wifiSignal = WiFi.RSSI();
+    strlcpy(s.ntpTime, getFormattedTime().c_str(), sizeof(s.ntpTime));
+    strlcpy(s.ntpDate, getFormattedDate().c_str(), sizeof(s.ntpDate));
+    s.ntpEpoch = getEpochTime();
+    s.ntpValid = isTimeSet();
+    s.historyEnabled = config.enableHistory && historyManager.isInitialized();
+    s.historyMemoryUsed = config.enableHistory ? historyManager.getTotalMemoryUsed() : 0;
+    s.psramSize = ESP.getPsramSize();
+    s.freePsram = ESP.getFreePsram();
+}
+
+static_assert(TELEMETRY_SECTION_COUNT <= 32, "Maska zmienionych sekcji w uint32_t");
+
+void updateTelemetrySnapshot() {
+    if (!telemetryMutex) return;
+
+    // Odciski liczone bez blokady (czytają dane czujników); generacje zmieniane pod mutexem -
+    // składanie dokumentu widzi generację spójną z fragmentem
+    uint32_t fingerprints[TELEMETRY_SECTION_COUNT];
+    uint32_t changed = 0;
+    for (int i = 0; i < TELEMETRY_SECTION_COUNT; i++) {
+        if (!telemetrySections[i].fingerprint) continue;
+        fingerprints[i] = telemetrySections[i].fingerprint();
+        if (fingerprints[i] != sectionFingerprint[i]) changed |= 1UL << i;
+    }
+
+    unsigned long now = millis();
+    bool systemDue = now - lastSystemCapture >= TELEMETRY_SYSTEM_INTERVAL || sectionGeneration[TELEMETRY_SYSTEM] == 0;
+    if (!changed && !systemDue) return;
+
+    // Mutex zajęty - odciski bez zmian, ponowna próba w kolejnym przebiegu
+    if (xSemaphoreTake(telemetryMutex, 0) != pdTRUE) return;
+    for (int i = 0; i < TELEMETRY_SECTION_COUNT; i++) {
+        if (!(changed & (1UL << i))) continue;
+        sectionFingerprint[i] = fingerprints[i];
+        sectionGeneration[i]++;
+    }
+
+    // Sekcja systemowa - wartości kopiowane pod mutexem (czytane przez taski budujące JSON)
+    if (systemDue) {
+        captureSystemSnapshot(now);
+        sectionGeneration[TELEMETRY_SYSTEM]++;
+        lastSystemCapture = now;
+    }
+    xSemaphoreGive(telemetryMutex);
+}
+
+uint32_t getTelemetryGeneration(TelemetrySection section) {
+    return section < TELEMETRY_SECTION_COUNT ? sectionGeneration[section] : 0;
+}
+
+uint32_t getTelemetryTotalGeneration() {
+    uint32_t total = 0;
+    for (int i = 0; i < TELEMETRY_SECTION_COUNT; i++) {
+        total += sectionGeneration[i];
+    }
+    return total;
+}
+
+const char* getTelemetrySectionName(TelemetrySection section) {
+    return section < TELEMETRY_SECTION_COUNT ? telemetrySections[section].name : "";
+}
+
+// Serializuje sekcję do jej fragmentu (wywoływane pod telemetryMutex)
+static bool rebuildFragment(int index, uint32_t generation) {
+    TelemetryFragment& fragment = fragments[index];
+
+    fragmentDoc->clear();
+    telemetrySections[index].build(*fragmentDoc);
+    size_t len = measureJson(*fragmentDoc);
+
+    if (len + 1 > fragment.capacity) {
+        // Sekcja urosła (np. więcej urządzeń MCP3424) - powiększ bufor
+        size_t capacity = (len + 64) & ~(size_t)63;
+        char* grown = allocateTelemetryBuffer(capacity);
+        if (!grown) return false;
+        free(fragment.data);
+        fragment.data = grown;
+        fragment.capacity = capacity;
+    }
+
+    serializeJson(*fragmentDoc, fragment.data, fragment.capacity);
+    // Bez zewnętrznych klamer - fragment wklejany bezpośrednio do dokumentu
+    fragment.length = len >= 2 ? len - 2 : 0;
+    memmove(fragment.data, fragment.data + 1, fragment.length);
+    fragment.generation = generation;
+    fragment.built = true;
+    sectionRebuilds[index]++;
+    return true;
+}
+
+// Składa dokument z fragmentów do bufora assembled (pod telemetryMutex)
+static bool assembleTelemetry() {
+    uint32_t total = getTelemetryTotalGeneration();
+    if (assembledValid && total == assembledGeneration) {
+        telemetryReuses++;
+        return true;
+    }
+
+    size_t pos = 0;
+    assembled[pos++] = '{';
+    for (int i = 0; i < TELEMETRY_SECTION_COUNT; i++) {
+        TelemetryFragment& fragment = fragments[i];
+        uint32_t generation = sectionGeneration[i];
+        if (!fragment.built || fragment.generation != generation) {
+            if (!rebuildFragment(i, generation)) continue;
+        }
+        if (fragment.length == 0) continue;
+
+        if (pos + fragment.length + 1 >= TELEMETRY_JSON_MAX_SIZE) {
+            telemetryOversize++;
+            assembledValid = false;
+            return false;
+        }
+        memcpy(assembled + pos, fragment.data, fragment.length);
+        pos += fragment.length;
+        assembled[pos++] = ',';
+    }
+
+    static const char tail[] = "\"success\":true}";
+    if (pos + sizeof(tail) > TELEMETRY_JSON_MAX_SIZE) {
+        telemetryOversize++;
+        assembledValid = false;
+        return false;
+    }
+    memcpy(assembled + pos, tail, sizeof(tail) - 1);
+    pos += sizeof(tail) - 1;
+
+    assembledLength = pos;
+    assembledGeneration = total;
+    assembledValid = true;
+    telemetryAssemblies++;
+    return true;
+}
+
+size_t copyTelemetryJson(char* out, size_t capacity) {
+    if (!telemetryMutex || xSemaphoreTake(telemetryMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return 0;
+    }
+
+    size_t len = 0;
+    if (assembleTelemetry() && assembledLength <= capacity) {
+        memcpy(out, assembled, assembledLength);
+        len = assembledLength;
+    }
+
+    xSemaphoreGive(telemetryMutex);
+    return len;
+}
+
+size_t copyTelemetryDelta(const uint32_t* since, uint32_t* generations, char* out, size_t capacity) {
+    if (capacity < 3 || !telemetryMutex || xSemaphoreTake(telemetryMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return 0;
+    }
+
+    size_t pos = 0;
+    out[pos++] = '{';
+    bool ok = true;
+    for (int i = 0; i < TELEMETRY_SECTION_COUNT; i++) {
+        TelemetryFragment& fragment = fragments[i];
+        uint32_t generation = sectionGeneration[i];
+        generations[i] = generation;
+        if (since && since[i] == generation) continue;
+
+        if (!fragment.built || fragment.generation != generation) {
+            if (!rebuildFragment(i, generation)) continue;
+        }
+        if (fragment.length == 0) continue;
+
+        if (pos + fragment.length + 2 > capacity) {
+            telemetryOversize++;
+            ok = false;
+            break;
+        }
+        if (pos > 1) out[pos++] = ',';
+        memcpy(out + pos, fragment.data, fragment.length);
+        pos += fragment.length;
+    }
+    out[pos++] = '}';
+
+    xSemaphoreGive(telemetryMutex);
+    return ok ? pos : 0;
+}
+
+bool getTelemetryJson(String& out) {
+    if (!telemetryMutex || xSemaphoreTake(telemetryMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return false;
+    }
+
+    bool ok = assembleTelemetry();
+    if (ok) {
+        out = "";
+        ok = out.reserve(assembledLength) && out.concat(assembled, assembledLength);
+    }
+
+    xSemaphoreGive(telemetryMutex);
+    return ok;
+}
+
+String getTelemetryStatus() {
+    uint32_t rebuilds = 0;
+    for (int i = 0; i < TELEMETRY_SECTION_COUNT; i++) {
+        rebuilds += sectionRebuilds[i];
+    }
+
+    return "- Telemetry: " + String(telemetryAssemblies) + " assemblies (" + String(telemetryReuses) +
+           " unchanged), " + String(rebuilds) + " section rebuilds, last " + String(assembledLength) +
+           " bytes, oversize " + String(telemetryOversize) + "\n";
+}
@@ -9,7 +9,15 @@
 #include <ESPAsyncWebServer.h>
 #include <network_config.h>
 #include <esp_task_wdt.h>
-#include <Wire.h>
+#include <i2c_bus.h>
+#include <i2c_sensors.h>
+#include <soc/soc_memory_layout.h>
+#include <command_registry.h>
+#include <json_arena.h>
+#include <response_cache.h>
+#include <live_stream.h>
+#include <scheduler.h>
+#include <atomic>
 
 // Forward declarations for safe printing functions
 void safePrint(const String& message);
@@ -26,17 +34,28 @@ static unsigned long lastHeapCheck = 0;
 static bool webSocketResetPending = false;
 static uint32_t webSocketResetCount = 0;
 
-// Struktura dla komunikatów WebSocket
-struct WebSocketMessage {
-    AsyncWebSocketClient* client;
-    String message;
-    uint32_t timestamp;
-};
-
 #define WEBSOCKET_QUEUE_SIZE 10
+#define WEBSOCKET_SLOT_SIZE 4096    // max rozmiar komendy (MCP3424 config ~1-2KB)
 #define WEBSOCKET_STACK_SIZE 40960  // 40KB stack
 #define WEBSOCKET_PRIORITY 2
 #define WEBSOCKET_CORE 1  // Używaj core 1
+#define WEBSOCKET_JSON_ARENA_SIZE (48 * 1024)  // PSRAM - dokumenty odpowiedzi jednego cyklu (getHistory ~30KB)
+
+// Slot komunikatu WebSocket - prealokowany, ramka kopiowana raz i parsowana w miejscu.
+// Kolejki FreeRTOS przenoszą tylko indeksy slotów (bez String i alokacji per komenda).
+struct WebSocketMessageSlot {
+    AsyncWebSocketClient* client;
+    uint32_t clientId;
+    uint32_t timestamp;
+    uint16_t length;
+    char data[WEBSOCKET_SLOT_SIZE];
+};
+
+static WebSocketMessageSlot* webSocketSlots = NULL;   // WEBSOCKET_QUEUE_SIZE slotow (PSRAM)
+static QueueHandle_t webSocketFreeSlots = NULL;       // indeksy wolnych slotow
+static uint32_t webSocketSlotsRejected = 0;           // brak wolnego slotu
+static uint32_t webSocketSlotsOversize = 0;           // ramka wieksza niz slot/fragmentowana
+static uint16_t webSocketSlotMaxLength = 0;
 
 // Timeouty i limity
 #define WEBSOCKET_INACTIVITY_TIMEOUT (5 * 60 * 1000)  // 5 minut
@@ -47,11 +66,30 @@ struct WebSocketMessage {
 // Struktura do sledzenia klientow WebSocket (uproszczona)
 struct WebSocketClientInfo {
     AsyncWebSocketClient* client;
+    uint32_t id;                     // wysyłka z WebSocket task przez ws.client(id)
 };
 
 #define MAX_WS_CLIENTS 5
 WebSocketClientInfo wsClients[MAX_WS_CLIENTS];
 int wsClientCount = 0;
+// async_tcp dodaje/usuwa klientów, WebSocket task kopiuje id - lista AsyncWebSocket nie jest iterowana poza biblioteką
+static portMUX_TYPE wsClientsLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Pula wspolnych buforow broadcastu (serializacja raz, fan-out przez shared_ptr)
+// Slot jest wolny gdy tylko pula trzyma referencje (use_count == 1) - kolejki
+// klientow AsyncWebSocket trzymaja kopie shared_ptr az do wyslania ramki.
+#define BROADCAST_POOL_SLOTS 4
+#define BROADCAST_SLOT_CAPACITY 8192     // jak limit broadcastu w web_server.cpp
+
+static AsyncWebSocketSharedBuffer broadcastPool[BROADCAST_POOL_SLOTS];
+static AsyncWebSocketSharedBuffer pendingBroadcast;   // snapshot z wsBroadcastTask - wysyła WebSocket task
+static SemaphoreHandle_t broadcastPoolMutex = NULL;
+static uint8_t broadcastPoolPsramSlots = 0;
+static uint8_t broadcastPoolHighWater = 0;       // max slotow zajetych jednoczesnie
+static size_t broadcastPoolMaxPayload = 0;
+static uint32_t broadcastPoolAcquired = 0;
+static uint32_t broadcastPoolExhausted = 0;
+static uint32_t broadcastPoolOversize = 0;
 
 // Zmienne globalne dla zarzadzania pamiecia WebSocket
 
@@ -114,10 +152,17 @@ extern HCHOData getHCHOFastAverage();
 extern HCHOData getHCHOSlowAverage();
 extern FanData getFANFastAverage();
 extern FanData getFANSlowAverage();
+extern uint32_t getAveragesGeneration();
+extern String getWebAssetStatus();
+extern String getMetricsStatus();
+extern String getTelemetryStatus();
+extern String getEventStreamStatus();
+extern String getHistoryExportStatus();
+extern String getModbusStatus();
 
 // WebSocket command handlers
-void handleGetStatus(AsyncWebSocketClient* client, DynamicJsonDocument& doc) {
-    DynamicJsonDocument response(2048);
+void handleGetStatus(AsyncWebSocketClient* client, JsonDocument&) {
+    ArenaJsonDocument response(2048);
     response["cmd"] = "status";
     response["timestamp"] = time(nullptr); // Epoch timestamp
     response["uptime"] = millis() / 1000;
@@ -160,7 +205,7 @@ void handleGetStatus(AsyncWebSocketClient* client, DynamicJsonDocument& doc) {
 
 void handleGetSensorData(AsyncWebSocketClient* client, JsonDocument& doc) {
     String sensorType = doc["sensor"] | "";
-    DynamicJsonDocument response(4096);
+    ArenaJsonDocument response(4096);
     response["cmd"] = "sensorData";
     response["sensor"] = sensorType;
     response["timestamp"] = time(nullptr); // Epoch timestamp
@@ -348,6 +393,7 @@ void handleGetSensorData(AsyncWebSocketClient* client, JsonDocument& doc) {
 // Struktura do przechowywania informacji o automatycznym wysyłaniu pakietów
 struct AutoPacketSender {
     AsyncWebSocketClient* client;
+    uint32_t clientId;              // do sprawdzenia czy klient nadal istnieje (ws.client(id))
     String sensorType;
     String timeRange;
     String sampleType;
@@ -357,6 +403,13 @@ struct AutoPacketSender {
     int currentPacket;
     int totalPackets;
     unsigned long lastSendTime;
+    
+    // Adaptacyjne tempo (backpressure z kolejki klienta)
+    uint16_t intervalMs;            // odstep miedzy wysylkami
+    uint8_t burst;                  // pakietow na jedna wysylke
+    unsigned long stalledSince;     // 0 = klient odbiera
+    unsigned long startTime;
+    uint32_t bytesSent;
 };
 
 // Globalny storage dla automatycznych wysyłek (max 5 jednocześnie)
@@ -364,6 +417,16 @@ struct AutoPacketSender {
 AutoPacketSender autoSenders[MAX_AUTO_SENDERS];
 int autoSenderCount = 0;
 
+// Parametry backpressure dla strumienia historii
+#define HISTORY_STREAM_MIN_INTERVAL 100     // ms - rowne cyklowi WebSocket task
+#define HISTORY_STREAM_MAX_INTERVAL 2000    // ms
+#define HISTORY_STREAM_MAX_BURST 4          // pakietow na cykl gdy klient nadaza
+#define HISTORY_STREAM_QUEUE_LIMIT 3        // ramek w kolejce klienta = klient nie nadaza
+#define HISTORY_STREAM_STALL_TIMEOUT 15000  // ms bez drenowania kolejki = porzuc strumien
+
+static uint32_t historyStreamsCompleted = 0;
+static uint32_t historyStreamsDropped = 0;
+
 // Funkcja do automatycznego wysyłania wszystkich pakietów
 void sendHistoryPacketsAutomatically(AsyncWebSocketClient* client, const String& sensorType, 
                                    const String& timeRange, const String& sampleType,
@@ -378,7 +441,7 @@ void sendHistoryPacketsAutomatically(AsyncWebSocketClient* client, const String&
     safePrintln("[DEBUG] First packet response: " + String(samples) + " samples, " + String(jsonResponse.length()) + " bytes");
     
     // Parse response to get total packets info
-    DynamicJsonDocument responseDoc(12288); // Zwiększ bufor dla większych odpowiedzi
+    ArenaJsonDocument responseDoc(12288); // Zwiększ bufor dla większych odpowiedzi
     DeserializationError parseError = deserializeJson(responseDoc, jsonResponse);
     
     if (parseError) {
@@ -401,7 +464,7 @@ void sendHistoryPacketsAutomatically(AsyncWebSocketClient* client, const String&
     int totalPackets = responseDoc["totalPackets"] | 1;
     
     // Wyślij pierwszy pakiet
-    DynamicJsonDocument response(12288); // Zwiększ rozmiar bufora
+    ArenaJsonDocument response(12288); // Zwiększ rozmiar bufora
     response["cmd"] = "history";
     response["sensor"] = sensorType;
     response["timeRange"] = timeRange;
@@ -453,13 +516,73 @@ void sendHistoryPacketsAutomatically(AsyncWebSocketClient* client, const String&
         sender.currentPacket = 1; // Następny pakiet do wysłania
         sender.totalPackets = totalPackets;
         sender.lastSendTime = millis();
+        sender.clientId = client->id();
+        sender.intervalMs = HISTORY_STREAM_MIN_INTERVAL;
+        sender.burst = 1;
+        sender.stalledSince = 0;
+        sender.startTime = millis();
+        sender.bytesSent = responseStr.length();
         
         autoSenderCount++;
         safePrintln("Added to auto sender queue. Will send " + String(totalPackets - 1) + " more packets");
     }
 }
 
+// Wysyła jeden pakiet historii; zwraca liczbę wysłanych bajtów (0 = błąd)
+static size_t sendAutoHistoryPacket(AutoPacketSender& sender) {
+    String jsonResponse;
+    size_t samples = getHistoricalData(sender.sensorType, sender.timeRange, jsonResponse, 
+                                     sender.fromTime, sender.toTime, sender.sampleType, 
+                                     sender.currentPacket, sender.packetSize);
+    
+    // Parse and send packet
+    ArenaJsonDocument responseDoc(12288);
+    DeserializationError parseError = deserializeJson(responseDoc, jsonResponse);
+    
+    if (parseError || !responseDoc.containsKey("data")) {
+        safePrintln("[ERROR] Auto packet parse failed or no data for packet " + String(sender.currentPacket) + " sensor " + sender.sensorType);
+        return 0;
+    }
+    
+    ArenaJsonDocument response(12288); // Zwiększ rozmiar bufora
+    response["cmd"] = "history";
+    response["sensor"] = sender.sensorType;
+    response["timeRange"] = sender.timeRange;
+    response["sampleType"] = sender.sampleType;
+    response["fromTime"] = sender.fromTime;
+    response["toTime"] = sender.toTime;
+    response["samples"] = samples;
+    response["timestamp"] = time(nullptr);
+    response["autoMode"] = true;
+    
+    // Copy data
+    response["data"] = responseDoc["data"];
+    response["totalSamples"] = responseDoc["totalSamples"];
+    response["totalAvailableSamples"] = responseDoc["totalAvailableSamples"];
+    response["packetIndex"] = responseDoc["packetIndex"];
+    response["packetSize"] = responseDoc["packetSize"];
+    response["totalPackets"] = responseDoc["totalPackets"];
+    response["hasMorePackets"] = responseDoc["hasMorePackets"];
+    response["success"] = responseDoc["success"];
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    sender.client->text(responseStr);
+    
+    safePrintln("Auto sent packet " + String(sender.currentPacket) + "/" + String(sender.totalPackets) + " for " + sender.sensorType + " (" + String(responseStr.length()) + " bytes)");
+    return responseStr.length();
+}
+
+static void removeAutoSender(int index) {
+    for (int j = index; j < autoSenderCount - 1; j++) {
+        autoSenders[j] = autoSenders[j + 1];
+    }
+    autoSenderCount--;
+}
+
 // Funkcja do przetwarzania kolejki automatycznych wysyłek (wywoływana periodycznie)
+// Tempo sterowane głębokością kolejki klienta: pusta kolejka = więcej pakietów/krótszy
+// odstęp, zalegające ramki = dłuższy odstęp, brak drenowania przez 15s = porzucenie.
 void processAutoPacketSenders() {
     unsigned long currentTime = millis();
     
@@ -467,206 +590,960 @@ void processAutoPacketSenders() {
         AutoPacketSender& sender = autoSenders[i];
         
         // Sprawdź czy klient nadal jest połączony
-        if (!sender.client || sender.client->status() != WS_CONNECTED) {
+        if (!sender.client || ws.client(sender.clientId) != sender.client || sender.client->status() != WS_CONNECTED) {
             // Usuń z kolejki
-            for (int j = i; j < autoSenderCount - 1; j++) {
-                autoSenders[j] = autoSenders[j + 1];
-            }
-            autoSenderCount--;
+            removeAutoSender(i);
             i--; // Sprawdź ten sam index ponownie
             continue;
         }
         
-        // Sprawdź czy czas na wysłanie kolejnego pakietu (co 100ms)
-        if (currentTime - sender.lastSendTime >= 100) {
-            if (sender.currentPacket < sender.totalPackets) {
-                // Wyślij kolejny pakiet
-                String jsonResponse;
-                size_t samples = getHistoricalData(sender.sensorType, sender.timeRange, jsonResponse, 
-                                                 sender.fromTime, sender.toTime, sender.sampleType, 
-                                                 sender.currentPacket, sender.packetSize);
-                
-                // Parse and send packet
-                DynamicJsonDocument responseDoc(12288);
-                DeserializationError parseError = deserializeJson(responseDoc, jsonResponse);
-                
-                if (!parseError && responseDoc.containsKey("data")) {
-                    DynamicJsonDocument response(12288); // Zwiększ rozmiar bufora
-                    response["cmd"] = "history";
-                    response["sensor"] = sender.sensorType;
-                    response["timeRange"] = sender.timeRange;
-                    response["sampleType"] = sender.sampleType;
-                    response["fromTime"] = sender.fromTime;
-                    response["toTime"] = sender.toTime;
-                    response["samples"] = samples;
-                    response["timestamp"] = time(nullptr);
-                    response["autoMode"] = true;
-                    
-                    // Copy data
-                    response["data"] = responseDoc["data"];
-                    response["totalSamples"] = responseDoc["totalSamples"];
-                    response["totalAvailableSamples"] = responseDoc["totalAvailableSamples"];
-                    response["packetIndex"] = responseDoc["packetIndex"];
-                    response["packetSize"] = responseDoc["packetSize"];
-                    response["totalPackets"] = responseDoc["totalPackets"];
-                    response["hasMorePackets"] = responseDoc["hasMorePackets"];
-                    response["success"] = responseDoc["success"];
-                    
-                    String responseStr;
-                    serializeJson(response, responseStr);
-                    sender.client->text(responseStr);
-                    
-                    safePrintln("Auto sent packet " + String(sender.currentPacket) + "/" + String(sender.totalPackets) + " for " + sender.sensorType + " (" + String(responseStr.length()) + " bytes)");
-                } else {
-                    safePrintln("[ERROR] Auto packet parse failed or no data for packet " + String(sender.currentPacket) + " sensor " + sender.sensorType);
-                }
-                
-                sender.currentPacket++;
-                sender.lastSendTime = currentTime;
-            } else {
-                // Wszystkie pakiety wysłane, usuń z kolejki
-                safePrintln("Auto packet sending completed for " + sender.sensorType);
-                for (int j = i; j < autoSenderCount - 1; j++) {
-                    autoSenders[j] = autoSenders[j + 1];
-                }
-                autoSenderCount--;
-                i--; // Sprawdź ten sam index ponownie
+        // Wszystkie pakiety wysłane, usuń z kolejki
+        if (sender.currentPacket >= sender.totalPackets) {
+            unsigned long elapsed = currentTime - sender.startTime;
+            safePrintln("Auto packet sending completed for " + sender.sensorType + ": " + 
+                       String(sender.totalPackets) + " packets, " + String(sender.bytesSent) + " bytes in " + 
+                       String(elapsed) + "ms (" + String(elapsed > 0 ? sender.bytesSent * 1000UL / elapsed : 0) + " B/s)");
+            historyStreamsCompleted++;
+            removeAutoSender(i);
+            i--;
+            continue;
+        }
+        
+        if (currentTime - sender.lastSendTime < sender.intervalMs) {
+            continue;
+        }
+        
+        size_t queued = sender.client->queueLen();
+        
+        // Klient nie nadąża - wstrzymaj i wydłuż odstęp
+        if (!sender.client->canSend() || queued >= HISTORY_STREAM_QUEUE_LIMIT) {
+            if (sender.stalledSince == 0) {
+                sender.stalledSince = currentTime;
+            } else if (currentTime - sender.stalledSince > HISTORY_STREAM_STALL_TIMEOUT) {
+                safePrintln("Auto packet sending dropped for " + sender.sensorType + " - client " + 
+                           String(sender.clientId) + " stalled at packet " + String(sender.currentPacket) + 
+                           "/" + String(sender.totalPackets) + " (queue " + String(queued) + ")");
+                historyStreamsDropped++;
+                sender.client->close(1013); // Try Again Later
+                removeAutoSender(i);
+                i--;
+                continue;
             }
+            sender.burst = 1;
+            sender.intervalMs = min((int)sender.intervalMs * 2, HISTORY_STREAM_MAX_INTERVAL);
+            sender.lastSendTime = currentTime;
+            continue;
+        }
+        sender.stalledSince = 0;
+        
+        // AIMD: kolejka opróżniona = przyspiesz, ramki w drodze = zwolnij
+        if (queued == 0) {
+            sender.intervalMs = max((int)sender.intervalMs / 2, HISTORY_STREAM_MIN_INTERVAL);
+            if (sender.intervalMs == HISTORY_STREAM_MIN_INTERVAL && sender.burst < HISTORY_STREAM_MAX_BURST) {
+                sender.burst++;
+            }
+        } else {
+            sender.burst = max(sender.burst / 2, 1);
+            sender.intervalMs = min((int)sender.intervalMs + HISTORY_STREAM_MIN_INTERVAL, HISTORY_STREAM_MAX_INTERVAL);
+        }
+        
+        // Wyślij kolejne pakiety (burst), przerwij gdy kolejka klienta się zapełni
+        for (uint8_t b = 0; b < sender.burst && sender.currentPacket < sender.totalPackets; b++) {
+            if (b > 0 && (!sender.client->canSend() || sender.client->queueLen() >= HISTORY_STREAM_QUEUE_LIMIT)) {
+                break;
+            }
+            sender.bytesSent += sendAutoHistoryPacket(sender);
+            sender.currentPacket++;
         }
+        sender.lastSendTime = currentTime;
     }
 }
 
-void handleGetHistory(AsyncWebSocketClient* client, JsonDocument& doc) {
-    String sensorType = doc["sensor"] | "";
-    String timeRange = doc["timeRange"] | "1h";
-    String sampleType = doc["sampleType"] | "fast";
-    unsigned long fromTime = doc["fromTime"] | 0;
-    unsigned long toTime = doc["toTime"] | 0;
-    int packetIndex = doc["packetIndex"] | -1; // -1 = automatyczne dzielenie na pakiety
-    int packetSize = doc["packetSize"] | 20;   // Rozmiar pakietu
-    bool autoSendAllPackets = (packetIndex == -1); // Automatyczne wysyłanie wszystkich pakietów
+String getHistoryStreamStatus() {
+    String status = "- History streams: " + String(autoSenderCount) + " active, " + 
+                    String(historyStreamsCompleted) + " completed, " + String(historyStreamsDropped) + " dropped\n";
+    for (int i = 0; i < autoSenderCount; i++) {
+        const AutoPacketSender& sender = autoSenders[i];
+        status += "  * " + sender.sensorType + " " + String(sender.currentPacket) + "/" + String(sender.totalPackets) + 
+                  " interval " + String(sender.intervalMs) + "ms burst " + String(sender.burst) + 
+                  " queue " + String(sender.client ? sender.client->queueLen() : 0) + "\n";
+    }
+    return status;
+}
+
+// ===== Subskrypcje klientow (subscribe/unsubscribe) =====
+// Kazdy klient wybiera sensory, pola, typ probek (raw/fast/slow) i interwal.
+// Scheduler w WebSocket task buduje kazdy unikalny payload raz na cykl
+// i rozsyla go do wszystkich klientow, ktorzy maja te sama subskrypcje.
+
+enum SubscriptionSensor : uint16_t {
+    SUB_SOLAR       = 1 << 0,
+    SUB_SHT40       = 1 << 1,
+    SUB_SCD41       = 1 << 2,
+    SUB_SPS30       = 1 << 3,
+    SUB_MCP3424     = 1 << 4,
+    SUB_ADS1110     = 1 << 5,
+    SUB_POWER       = 1 << 6,
+    SUB_HCHO        = 1 << 7,
+    SUB_IPS         = 1 << 8,
+    SUB_CALIBRATION = 1 << 9,
+    SUB_ALL         = 0x03FF
+};
+
+enum SubscriptionSampleType : uint8_t {
+    SUB_SAMPLE_RAW = 0,
+    SUB_SAMPLE_FAST = 1,
+    SUB_SAMPLE_SLOW = 2
+};
+
+struct SubscriptionSensorName {
+    const char* name;
+    uint16_t bit;
+};
+
+static const SubscriptionSensorName subscriptionSensorNames[] = {
+    {"solar", SUB_SOLAR}, {"sht40", SUB_SHT40}, {"scd41", SUB_SCD41},
+    {"sps30", SUB_SPS30}, {"mcp3424", SUB_MCP3424}, {"ads1110", SUB_ADS1110},
+    {"power", SUB_POWER}, {"hcho", SUB_HCHO}, {"ips", SUB_IPS},
+    {"calibration", SUB_CALIBRATION}
+};
+
+#define SUBSCRIPTION_FIELDS_LEN 96
+#define SUBSCRIPTION_MIN_INTERVAL 250        // ms - task chodzi co 100ms
+#define SUBSCRIPTION_MAX_INTERVAL 3600000UL  // 1h
+#define SUBSCRIPTION_DEFAULT_INTERVAL 10000  // jak broadcast
+
+struct ClientSubscription {
+    bool active;
+    uint32_t clientId;                       // id zamiast wskaznika - klient moze zniknac
+    uint16_t sensorMask;
+    uint8_t sampleType;
+    uint32_t intervalMs;
+    char fields[SUBSCRIPTION_FIELDS_LEN];    // lista pol po przecinku, pusta = wszystkie
+    unsigned long lastSendTime;
+};
+
+static ClientSubscription subscriptions[MAX_WS_CLIENTS];
+static std::atomic<int> subscriptionCount(0);    // zapis tylko WebSocket task (processSubscriptions)
+static uint32_t subscriptionPayloadsBuilt = 0;
+static uint32_t subscriptionMessagesSent = 0;
+
+static const char* subscriptionSampleTypeName(uint8_t sampleType) {
+    switch (sampleType) {
+        case SUB_SAMPLE_FAST: return "fast";
+        case SUB_SAMPLE_SLOW: return "slow";
+        default: return "raw";
+    }
+}
+
+// Token pasuje gdy: "pole", "sensor" lub "sensor.pole"
+static bool isSubscriptionFieldSelected(const char* fields, const char* sensor, const char* key) {
+    if (!fields || fields[0] == '\0') return true;
+    if (strcmp(key, "valid") == 0) return true;
     
-    // Konwersja timeRange na timestampy (epoch seconds) - TYLKO gdy brak fromTime/toTime
-    if ((fromTime == 0 && toTime == 0) && timeRange != "custom") {
-        unsigned long now = 0;
-        if (time(nullptr) > 8 * 3600 * 2) { // Jeśli czas jest zsynchronizowany
-            now = time(nullptr); // Używaj sekund, nie milisekund!
-        } else {
-            now = millis() / 1000; // Fallback do sekund
-        }
+    size_t sensorLen = strlen(sensor);
+    const char* token = fields;
+    while (*token) {
+        const char* end = strchr(token, ',');
+        size_t len = end ? (size_t)(end - token) : strlen(token);
         
-        if (timeRange == "1h") {
-            fromTime = now - (60 * 60); // 1 godzina w sekundach
-        } else if (timeRange == "6h") {
-            fromTime = now - (6 * 60 * 60); // 6 godzin w sekundach
-        } else if (timeRange == "24h") {
-            fromTime = now - (24 * 60 * 60); // 24 godziny w sekundach
-        } else if (timeRange == "7d") {
-            fromTime = now - (7 * 24 * 60 * 60); // 7 dni w sekundach
-        } else {
-            fromTime = now - (60 * 60); // domyślnie 1h w sekundach
+        if ((len == strlen(key) && strncmp(token, key, len) == 0) ||
+            (len == sensorLen && strncmp(token, sensor, len) == 0) ||
+            (len > sensorLen + 1 && strncmp(token, sensor, sensorLen) == 0 && token[sensorLen] == '.' &&
+             len - sensorLen - 1 == strlen(key) && strncmp(token + sensorLen + 1, key, len - sensorLen - 1) == 0)) {
+            return true;
         }
-        toTime = now;
-        
-        safePrintln("[DEBUG] Auto timeRange " + timeRange + ": from=" + String(fromTime) + " to=" + String(toTime));
-    } else if (timeRange == "custom" && (fromTime != 0 || toTime != 0)) {
-        safePrintln("[DEBUG] Custom timeRange: from=" + String(fromTime) + " to=" + String(toTime));
-    } else {
-        safePrintln("[WARNING] Invalid time parameters or mixed timeRange+fromTime: timeRange=" + timeRange + " fromTime=" + String(fromTime) + " toTime=" + String(toTime));
-        // Jeśli użytkownik podał fromTime/toTime, wymuś timeRange="custom"
-        if (fromTime != 0 || toTime != 0) {
-            timeRange = "custom";
-            safePrintln("[FIX] Forced timeRange to 'custom' due to fromTime/toTime");
+        if (!end) break;
+        token = end + 1;
+    }
+    return false;
+}
+
+template<typename V>
+static void setSubscriptionField(JsonObject& obj, const char* fields, const char* sensor, const char* key, const V& value) {
+    if (isSubscriptionFieldSelected(fields, sensor, key)) {
+        obj[key] = value;
+    }
+}
+
+template<typename T>
+static T pickSubscriptionSample(uint8_t sampleType, const T& raw, T (*fast)(), T (*slow)()) {
+    if (sampleType == SUB_SAMPLE_FAST) return fast();
+    if (sampleType == SUB_SAMPLE_SLOW) return slow();
+    return raw;
+}
+
+// Buduje payload dla jednej subskrypcji - wspolny dla klientow z ta sama maska/polami/typem
+static void buildSubscriptionPayload(const ClientSubscription& sub, JsonDocument& response) {
+    response["cmd"] = "subscription";
+    response["sampleType"] = subscriptionSampleTypeName(sub.sampleType);
+    response["timestamp"] = time(nullptr); // Epoch timestamp
+    
+    JsonObject data = response.createNestedObject("data");
+    const char* f = sub.fields;
+    bool raw = (sub.sampleType == SUB_SAMPLE_RAW);
+    
+    if (sub.sensorMask & SUB_SOLAR) {
+        SolarData s = pickSubscriptionSample(sub.sampleType, solarData, getSolarFastAverage, getSolarSlowAverage);
+        if (s.valid && (!raw || solarSensorStatus)) {
+            JsonObject o = data.createNestedObject("solar");
+            setSubscriptionField(o, f, "solar", "V", s.V);
+            setSubscriptionField(o, f, "solar", "I", s.I);
+            setSubscriptionField(o, f, "solar", "VPV", s.VPV);
+            setSubscriptionField(o, f, "solar", "PPV", s.PPV);
+            o["valid"] = true;
+        }
+    }
+    
+    if (sub.sensorMask & SUB_SHT40) {
+        SHT40Data s = pickSubscriptionSample(sub.sampleType, sht40Data, getSHT40FastAverage, getSHT40SlowAverage);
+        if (s.valid && (!raw || sht40SensorStatus)) {
+            JsonObject o = data.createNestedObject("sht40");
+            setSubscriptionField(o, f, "sht40", "temperature", s.temperature);
+            setSubscriptionField(o, f, "sht40", "humidity", s.humidity);
+            setSubscriptionField(o, f, "sht40", "pressure", s.pressure);
+            o["valid"] = true;
+        }
+    }
+    
+    if (sub.sensorMask & SUB_SCD41) {
+        I2CSensorData s = pickSubscriptionSample(sub.sampleType, i2cSensorData, getI2CFastAverage, getI2CSlowAverage);
+        if (s.valid && (!raw || (scd41SensorStatus && s.type == SENSOR_SCD41))) {
+            JsonObject o = data.createNestedObject("scd41");
+            setSubscriptionField(o, f, "scd41", "co2", s.co2);
+            setSubscriptionField(o, f, "scd41", "temperature", s.temperature);
+            setSubscriptionField(o, f, "scd41", "humidity", s.humidity);
+            o["valid"] = true;
+        }
+    }
+    
+    if (sub.sensorMask & SUB_SPS30) {
+        SPS30Data s = pickSubscriptionSample(sub.sampleType, sps30Data, getSPS30FastAverage, getSPS30SlowAverage);
+        if (s.valid && (!raw || sps30SensorStatus)) {
+            JsonObject o = data.createNestedObject("sps30");
+            setSubscriptionField(o, f, "sps30", "PM1", s.pm1_0);
+            setSubscriptionField(o, f, "sps30", "PM25", s.pm2_5);
+            setSubscriptionField(o, f, "sps30", "PM4", s.pm4_0);
+            setSubscriptionField(o, f, "sps30", "PM10", s.pm10);
+            setSubscriptionField(o, f, "sps30", "NC05", s.nc0_5);
+            setSubscriptionField(o, f, "sps30", "NC1", s.nc1_0);
+            setSubscriptionField(o, f, "sps30", "NC25", s.nc2_5);
+            setSubscriptionField(o, f, "sps30", "NC4", s.nc4_0);
+            setSubscriptionField(o, f, "sps30", "NC10", s.nc10);
+            setSubscriptionField(o, f, "sps30", "TPS", s.typical_particle_size);
+            o["valid"] = true;
+        }
+    }
+    
+    if (sub.sensorMask & SUB_MCP3424) {
+        MCP3424Data s = pickSubscriptionSample(sub.sampleType, mcp3424Data, getMCP3424FastAverage, getMCP3424SlowAverage);
+        if (s.deviceCount > 0 && (!raw || mcp3424SensorStatus)) {
+            // Urzadzenia kluczowane adresem - pole "0x68" wybiera jedna plytke
+            JsonObject o = data.createNestedObject("mcp3424");
+            for (uint8_t i = 0; i < s.deviceCount && i < MAX_MCP3424_DEVICES; i++) {
+                char addr[8];
+                snprintf(addr, sizeof(addr), "0x%x", s.addresses[i]);
+                if (!s.valid[i] || !isSubscriptionFieldSelected(f, "mcp3424", addr)) continue;
+                JsonArray channels = o.createNestedArray(addr);
+                for (int ch = 0; ch < 4; ch++) {
+                    channels.add(s.channels[i][ch]);
+                }
+            }
+            o["valid"] = true;
         }
     }
     
-    // Jeśli automatyczne dzielenie, najpierw pobierz informacje o łącznej liczbie próbek
-    if (autoSendAllPackets) {
-        packetIndex = 0; // Zacznij od pierwszego pakietu
-        sendHistoryPacketsAutomatically(client, sensorType, timeRange, sampleType, fromTime, toTime, packetSize);
-        return;
+    if (sub.sensorMask & SUB_ADS1110) {
+        ADS1110Data s = pickSubscriptionSample(sub.sampleType, ads1110Data, getADS1110FastAverage, getADS1110SlowAverage);
+        if (s.valid && (!raw || ads1110SensorStatus)) {
+            JsonObject o = data.createNestedObject("ads1110");
+            setSubscriptionField(o, f, "ads1110", "voltage", s.voltage);
+            o["valid"] = true;
+        }
     }
     
-    String jsonResponse;
-    size_t samples = getHistoricalData(sensorType, timeRange, jsonResponse, fromTime, toTime, sampleType, packetIndex, packetSize);
+    if (sub.sensorMask & SUB_POWER) {
+        INA219Data s = pickSubscriptionSample(sub.sampleType, ina219Data, getINA219FastAverage, getINA219SlowAverage);
+        if (s.valid && (!raw || ina219SensorStatus)) {
+            JsonObject o = data.createNestedObject("power");
+            setSubscriptionField(o, f, "power", "busVoltage", s.busVoltage);
+            setSubscriptionField(o, f, "power", "shuntVoltage", s.shuntVoltage);
+            setSubscriptionField(o, f, "power", "current", s.current);
+            setSubscriptionField(o, f, "power", "power", s.power);
+            o["valid"] = true;
+        }
+    }
     
-    safePrintln("History request: " + sensorType + " " + timeRange + " " + sampleType + " packet: " + String(packetIndex) + "/" + String(packetSize) + " samples: " + String(samples));
-    safePrintln("JSON response length: " + String(jsonResponse.length()));
-    safePrintln("History enabled: " + String(config.enableHistory));
-    safePrintln("History initialized: " + String(historyManager.isInitialized()));
-    safePrintln("Free heap: " + String(ESP.getFreeHeap()));
+    if (sub.sensorMask & SUB_HCHO) {
+        HCHOData s = pickSubscriptionSample(sub.sampleType, hchoData, getHCHOFastAverage, getHCHOSlowAverage);
+        if (s.valid && (!raw || hchoSensorStatus)) {
+            JsonObject o = data.createNestedObject("hcho");
+            setSubscriptionField(o, f, "hcho", "hcho_mg", s.hcho);
+            setSubscriptionField(o, f, "hcho", "hcho_ppb", s.hcho_ppb);
+            o["valid"] = true;
+        }
+    }
     
-    DynamicJsonDocument response(4096);
-    response["cmd"] = "history";
-    response["sensor"] = sensorType;
-    response["timeRange"] = timeRange;
-    response["sampleType"] = sampleType;
-    response["fromTime"] = fromTime;
-    response["toTime"] = toTime;
-    response["samples"] = samples;
-    response["timestamp"] = time(nullptr); // Epoch timestamp
+    if (sub.sensorMask & SUB_IPS) {
+        IPSSensorData s = pickSubscriptionSample(sub.sampleType, ipsSensorData, getIPSFastAverage, getIPSSlowAverage);
+        if (s.valid && (!raw || ipsSensorStatus)) {
+            JsonObject o = data.createNestedObject("ips");
+            if (isSubscriptionFieldSelected(f, "ips", "pc")) {
+                JsonArray pc = o.createNestedArray("pc");
+                for (int i = 0; i < 7; i++) pc.add(s.pc_values[i]);
+            }
+            if (isSubscriptionFieldSelected(f, "ips", "pm")) {
+                JsonArray pm = o.createNestedArray("pm");
+                for (int i = 0; i < 7; i++) pm.add(s.pm_values[i]);
+            }
+            o["valid"] = true;
+        }
+    }
     
+    if (sub.sensorMask & SUB_CALIBRATION) {
+        CalibratedSensorData s = pickSubscriptionSample(sub.sampleType, calibratedData, getCalibratedFastAverage, getCalibratedSlowAverage);
+        if (s.valid && (!raw || calibConfig.enableCalibration)) {
+            JsonObject o = data.createNestedObject("calibration");
+            setSubscriptionField(o, f, "calibration", "CO", s.CO);
+            setSubscriptionField(o, f, "calibration", "NO", s.NO);
+            setSubscriptionField(o, f, "calibration", "NO2", s.NO2);
+            setSubscriptionField(o, f, "calibration", "O3", s.O3);
+            setSubscriptionField(o, f, "calibration", "SO2", s.SO2);
+            setSubscriptionField(o, f, "calibration", "H2S", s.H2S);
+            setSubscriptionField(o, f, "calibration", "NH3", s.NH3);
+            setSubscriptionField(o, f, "calibration", "VOC", s.VOC);
+            setSubscriptionField(o, f, "calibration", "VOC_ppb", s.VOC_ppb);
+            setSubscriptionField(o, f, "calibration", "HCHO", s.HCHO);
+            setSubscriptionField(o, f, "calibration", "PID", s.PID);
+            o["valid"] = true;
+        }
+    }
+}
 
+static bool isSameSubscriptionPayload(const ClientSubscription& a, const ClientSubscription& b) {
+    return a.sensorMask == b.sensorMask && a.sampleType == b.sampleType && strcmp(a.fields, b.fields) == 0;
+}
+
+static ClientSubscription* findSubscription(uint32_t clientId) {
+    for (int i = 0; i < MAX_WS_CLIENTS; i++) {
+        if (subscriptions[i].active && subscriptions[i].clientId == clientId) {
+            return &subscriptions[i];
+        }
+    }
+    return nullptr;
+}
+
+int getWebSocketSubscriptionCount() {
+    return subscriptionCount.load(std::memory_order_relaxed);
+}
+
+bool isWebSocketClientSubscribed(uint32_t clientId) {
+    return findSubscription(clientId) != nullptr;
+}
+
+void clearWebSocketSubscriptions() {
+    memset(subscriptions, 0, sizeof(subscriptions));
+    subscriptionCount.store(0, std::memory_order_relaxed);
+    clearLiveStreams();
+}
+
+void handleSubscribe(AsyncWebSocketClient* client, JsonDocument& doc) {
+    ArenaJsonDocument response(1024);
+    response["cmd"] = "subscribed";
+    
+    // Sensory: "all" lub tablica nazw
+    uint16_t mask = 0;
+    if (doc["sensors"].is<JsonArray>()) {
+        for (JsonVariant v : doc["sensors"].as<JsonArray>()) {
+            const char* name = v | "";
+            if (strcmp(name, "all") == 0) {
+                mask = SUB_ALL;
+                continue;
+            }
+            bool known = false;
+            for (const SubscriptionSensorName& s : subscriptionSensorNames) {
+                if (strcmp(name, s.name) == 0) {
+                    mask |= s.bit;
+                    known = true;
+                    break;
+                }
+            }
+            if (!known) {
+                response["success"] = false;
+                response["error"] = String("Unknown sensor: ") + name;
+                String responseStr;
+                serializeJson(response, responseStr);
+                client->text(responseStr);
+                return;
+            }
+        }
+    } else if (String(doc["sensors"] | "all") == "all") {
+        mask = SUB_ALL;
+    }
     
-    // Parse existing JSON response to check if data exists
-    DynamicJsonDocument dataDoc(8192);
-    DeserializationError parseError = deserializeJson(dataDoc, jsonResponse);
-    
-    safePrintln("JSON parse error: " + String(parseError.c_str()));
-    safePrintln("JSON response preview: " + jsonResponse.substring(0, 200) + "...");
+    if (mask == 0) {
+        response["success"] = false;
+        response["error"] = "No sensors selected";
+        String responseStr;
+        serializeJson(response, responseStr);
+        client->text(responseStr);
+        return;
+    }
     
-    if (!parseError) {
-        if (dataDoc.containsKey("error")) {
-            // getHistoricalData returned an error
-            response["data"] = JsonArray();
-            response["success"] = false;
-            response["error"] = dataDoc["error"].as<String>();
-            safePrintln("History error from getHistoricalData: " + dataDoc["error"].as<String>());
-        } else if (dataDoc.containsKey("data") && dataDoc["data"].is<JsonArray>()) {
-            JsonArray dataArray = dataDoc["data"];
-            response["data"] = dataArray;
-            if (dataArray.size() > 0) {
-                response["success"] = true;
-                safePrintln("History success: " + String(dataArray.size()) + " samples from JSON");
-            } else {
+    // Pola - zlaczone przecinkami, zeby porownanie payloadow bylo tanie
+    char fields[SUBSCRIPTION_FIELDS_LEN] = {0};
+    if (doc["fields"].is<JsonArray>()) {
+        size_t pos = 0;
+        for (JsonVariant v : doc["fields"].as<JsonArray>()) {
+            const char* name = v | "";
+            size_t len = strlen(name);
+            if (len == 0) continue;
+            if (pos + len + 1 >= sizeof(fields)) {
                 response["success"] = false;
-                response["error"] = "No data in response array";
-                safePrintln("History error: Empty data array");
+                response["error"] = "Field list too long (max " + String(SUBSCRIPTION_FIELDS_LEN - 1) + " chars)";
+                String responseStr;
+                serializeJson(response, responseStr);
+                client->text(responseStr);
+                return;
             }
-        } else {
-            response["data"] = JsonArray();
-            response["success"] = false;
-            response["error"] = "No data field in JSON response";
-            safePrintln("History error: No data field in response");
+            if (pos > 0) fields[pos++] = ',';
+            memcpy(fields + pos, name, len);
+            pos += len;
         }
-    } else {
-        response["data"] = JsonArray();
+    }
+    
+    String sampleTypeStr = doc["sampleType"] | "raw";
+    uint8_t sampleType = SUB_SAMPLE_RAW;
+    if (sampleTypeStr == "fast") {
+        sampleType = SUB_SAMPLE_FAST;
+    } else if (sampleTypeStr == "slow") {
+        sampleType = SUB_SAMPLE_SLOW;
+    }
+    
+    uint32_t interval = doc["interval"] | SUBSCRIPTION_DEFAULT_INTERVAL;
+    interval = constrain(interval, (uint32_t)SUBSCRIPTION_MIN_INTERVAL, (uint32_t)SUBSCRIPTION_MAX_INTERVAL);
+    
+    ClientSubscription* sub = findSubscription(client->id());
+    if (!sub) {
+        for (int i = 0; i < MAX_WS_CLIENTS; i++) {
+            if (!subscriptions[i].active) {
+                sub = &subscriptions[i];
+                break;
+            }
+        }
+    }
+    if (!sub) {
         response["success"] = false;
-        response["error"] = "JSON parse error: " + String(parseError.c_str());
-        safePrintln("History error: JSON parse failed - " + String(parseError.c_str()));
+        response["error"] = "Too many subscriptions";
+        String responseStr;
+        serializeJson(response, responseStr);
+        client->text(responseStr);
+        return;
+    }
+    
+    sub->active = true;
+    sub->clientId = client->id();
+    sub->sensorMask = mask;
+    sub->sampleType = sampleType;
+    sub->intervalMs = interval;
+    strlcpy(sub->fields, fields, sizeof(sub->fields));
+    sub->lastSendTime = millis() - interval; // pierwszy payload w najblizszym cyklu
+    
+    response["success"] = true;
+    JsonArray sensors = response.createNestedArray("sensors");
+    for (const SubscriptionSensorName& s : subscriptionSensorNames) {
+        if (mask & s.bit) sensors.add(s.name);
     }
+    response["fields"] = fields;
+    response["sampleType"] = subscriptionSampleTypeName(sampleType);
+    response["interval"] = interval;
+    response["timestamp"] = time(nullptr); // Epoch timestamp
     
     String responseStr;
     serializeJson(response, responseStr);
     client->text(responseStr);
+    
+    safePrintln("WebSocket: Client " + String(client->id()) + " subscribed, mask=0x" + String(mask, HEX) +
+               " type=" + sampleTypeStr + " interval=" + String(interval) + "ms");
 }
 
-void handleGetHistoryInfo(AsyncWebSocketClient* client, JsonDocument& doc) {
-    DynamicJsonDocument response(2048);
-    response["cmd"] = "historyInfo";
-    response["timestamp"] = time(nullptr); // Epoch timestamp
+void handleUnsubscribe(AsyncWebSocketClient* client, JsonDocument&) {
+    ClientSubscription* sub = findSubscription(client->id());
+    if (sub) {
+        sub->active = false;
+    }
     
-    // Sprawdź czy historia jest włączona
-    if (!config.enableHistory) {
-        response["enabled"] = false;
-        response["error"] = "History system is disabled";
-        response["success"] = false;
-    } else {
-        response["enabled"] = true;
-        response["initialized"] = historyManager.isInitialized();
+    ArenaJsonDocument response(256);
+    response["cmd"] = "unsubscribed";
+    response["success"] = true;
+    response["wasSubscribed"] = (sub != nullptr);
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+// Scheduler subskrypcji (wywolywany z WebSocket task co cykl)
+void processSubscriptions() {
+    unsigned long currentTime = millis();
+    bool served[MAX_WS_CLIENTS] = {false};
+    int active = 0;
+    
+    for (int i = 0; i < MAX_WS_CLIENTS; i++) {
+        ClientSubscription& sub = subscriptions[i];
+        if (!sub.active) continue;
         
-        if (historyManager.isInitialized()) {
-            response["totalMemoryUsed"] = historyManager.getTotalMemoryUsed();
+        // Klient rozlaczony - zwolnij slot
+        if (!ws.client(sub.clientId)) {
+            sub.active = false;
+            continue;
+        }
+        active++;
+        if (served[i]) continue;
+        
+        if (currentTime - sub.lastSendTime < sub.intervalMs) continue;
+        
+        // Zbuduj payload raz i wyslij do wszystkich zaleglych klientow z ta sama subskrypcja
+        ArenaJsonDocument payloadDoc(4096);
+        buildSubscriptionPayload(sub, payloadDoc);
+        AsyncWebSocketSharedBuffer payload = serializeToBroadcastBuffer(payloadDoc);
+        if (!payload) {
+            // Pula zajeta - sprobuj w nastepnym cyklu
+            continue;
+        }
+        subscriptionPayloadsBuilt++;
+        
+        for (int j = i; j < MAX_WS_CLIENTS; j++) {
+            ClientSubscription& other = subscriptions[j];
+            if (!other.active || served[j] || !isSameSubscriptionPayload(sub, other)) continue;
+            if (currentTime - other.lastSendTime < other.intervalMs) continue;
+            
+            AsyncWebSocketClient* target = ws.client(other.clientId);
+            if (target && target->status() == WS_CONNECTED) {
+                target->text(payload);
+                subscriptionMessagesSent++;
+            }
+            other.lastSendTime = currentTime;
+            served[j] = true;
+        }
+    }
+    subscriptionCount.store(active, std::memory_order_relaxed);
+}
+
+static int copyWebSocketClientIds(uint32_t* ids) {
+    portENTER_CRITICAL(&wsClientsLock);
+    int count = wsClientCount < MAX_WS_CLIENTS ? wsClientCount : MAX_WS_CLIENTS;   // licznik bywa synchronizowany z ws.count()
+    for (int i = 0; i < count; i++) {
+        ids[i] = wsClients[i].id;
+    }
+    portEXIT_CRITICAL(&wsClientsLock);
+    return count;
+}
+
+// Snapshot telemetrii z wsBroadcastTask - wysyłka w WebSocket task, obok subskrypcji (jeden task czyta subscriptions[])
+void queueWebSocketBroadcast(AsyncWebSocketSharedBuffer buffer) {
+    if (!broadcastPoolMutex || xSemaphoreTake(broadcastPoolMutex, pdMS_TO_TICKS(50)) != pdTRUE) {
+        return;
+    }
+    pendingBroadcast = buffer;    // niewysłany poprzedni snapshot wraca do puli
+    xSemaphoreGive(broadcastPoolMutex);
+}
+
+void processWebSocketBroadcast() {
+    AsyncWebSocketSharedBuffer buffer;
+    if (!broadcastPoolMutex || xSemaphoreTake(broadcastPoolMutex, pdMS_TO_TICKS(50)) != pdTRUE) {
+        return;
+    }
+    buffer = pendingBroadcast;
+    pendingBroadcast = nullptr;
+    xSemaphoreGive(broadcastPoolMutex);
+    if (!buffer) return;
+    
+    // Bez subskrypcji - textAll() iteruje klientów pod blokadą AsyncWebSocket
+    if (getWebSocketSubscriptionCount() == 0) {
+        ws.textAll(buffer);
+        return;
+    }
+    
+    // Klienci bez subskrypcji - id skopiowane pod blokadą, klient wyszukany przez ws.client(id)
+    uint32_t ids[MAX_WS_CLIENTS];
+    int count = copyWebSocketClientIds(ids);
+    for (int i = 0; i < count; i++) {
+        if (isWebSocketClientSubscribed(ids[i])) continue;
+        AsyncWebSocketClient* target = ws.client(ids[i]);
+        if (target && target->status() == WS_CONNECTED) {
+            target->text(buffer);
+        }
+    }
+}
+
+// ===== Strumien live (surowe probki z toru akwizycji) =====
+
+#define LIVE_STREAM_QUEUE_LIMIT 4           // ramek w kolejce klienta = pomin cykl
+#define LIVE_STREAM_FRAME_SAMPLES 256       // max probek w jednej ramce
+#define LIVE_STREAM_READ_CHUNK 64
+
+struct LiveStreamClient {
+    bool active;
+    uint32_t clientId;
+    LiveChannelMask mask;
+    uint16_t intervalMs;
+    uint32_t cursor;             // nastepna probka z pierscienia
+    unsigned long lastSendTime;
+    uint32_t framesSent;
+    uint32_t samplesLost;
+};
+
+static LiveStreamClient liveStreamClients[MAX_WS_CLIENTS];
+
+static LiveStreamClient* findLiveStreamClient(uint32_t clientId) {
+    for (int i = 0; i < MAX_WS_CLIENTS; i++) {
+        if (liveStreamClients[i].active && liveStreamClients[i].clientId == clientId) {
+            return &liveStreamClients[i];
+        }
+    }
+    return nullptr;
+}
+
+// Producenci wpisuja tylko kanaly, ktorych ktos slucha
+static void updateLiveStreamChannelMask() {
+    LiveChannelMask mask = {{0, 0}};
+    for (int i = 0; i < MAX_WS_CLIENTS; i++) {
+        if (!liveStreamClients[i].active) continue;
+        mask.bits[0] |= liveStreamClients[i].mask.bits[0];
+        mask.bits[1] |= liveStreamClients[i].mask.bits[1];
+    }
+    setLiveStreamChannelMask(mask);
+}
+
+static void clearLiveStreams() {
+    memset(liveStreamClients, 0, sizeof(liveStreamClients));
+    updateLiveStreamChannelMask();
+}
+
+void handleLiveStream(AsyncWebSocketClient* client, JsonDocument& doc) {
+    ArenaJsonDocument response(2048);
+    response["cmd"] = "liveStream";
+    
+    // Kanaly: tablica selektorow ("sps30", "sht40.temperature", "mcp3424.0x68.ch1")
+    LiveChannelMask mask = {{0, 0}};
+    if (doc["channels"].is<JsonArray>()) {
+        for (JsonVariant v : doc["channels"].as<JsonArray>()) {
+            const char* selector = v | "";
+            if (!addLiveChannelSelector(mask, selector)) {
+                response["success"] = false;
+                response["error"] = String("Unknown channel: ") + selector;
+                String responseStr;
+                serializeJson(response, responseStr);
+                client->text(responseStr);
+                return;
+            }
+        }
+    } else if (doc["channels"].is<const char*>()) {
+        addLiveChannelSelector(mask, doc["channels"].as<const char*>());
+    }
+    
+    if (mask.bits[0] == 0 && mask.bits[1] == 0) {
+        response["success"] = false;
+        response["error"] = "No channels selected";
+        String responseStr;
+        serializeJson(response, responseStr);
+        client->text(responseStr);
+        return;
+    }
+    
+    uint32_t interval = doc["interval"] | LIVE_STREAM_MIN_INTERVAL;
+    interval = constrain(interval, (uint32_t)LIVE_STREAM_MIN_INTERVAL, (uint32_t)LIVE_STREAM_MAX_INTERVAL);
+    
+    LiveStreamClient* live = findLiveStreamClient(client->id());
+    if (!live) {
+        for (int i = 0; i < MAX_WS_CLIENTS; i++) {
+            if (!liveStreamClients[i].active) {
+                live = &liveStreamClients[i];
+                break;
+            }
+        }
+    }
+    if (!live) {
+        response["success"] = false;
+        response["error"] = "Too many live streams";
+        String responseStr;
+        serializeJson(response, responseStr);
+        client->text(responseStr);
+        return;
+    }
+    
+    memset(live, 0, sizeof(*live));
+    live->clientId = client->id();
+    live->mask = mask;
+    live->intervalMs = interval;
+    live->cursor = getLiveStreamHead();   // tylko nowe probki
+    live->lastSendTime = millis();
+    live->active = true;
+    updateLiveStreamChannelMask();
+    
+    response["success"] = true;
+    JsonArray channels = response.createNestedArray("channels");
+    char name[32];
+    for (uint8_t ch = 0; ch < LIVE_CHANNEL_COUNT; ch++) {
+        if (liveMaskHas(mask, ch) && liveChannelName(ch, name, sizeof(name))) {
+            channels.add(name);
+        }
+    }
+    response["interval"] = interval;
+    response["timestamp"] = time(nullptr); // Epoch timestamp
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+    
+    safePrintln("WebSocket: Client " + String(client->id()) + " live stream, " + String(channels.size()) +
+               " channels, interval=" + String(interval) + "ms");
+}
+
+void handleLiveStreamStop(AsyncWebSocketClient* client, JsonDocument&) {
+    LiveStreamClient* live = findLiveStreamClient(client->id());
+    if (live) {
+        live->active = false;
+        updateLiveStreamChannelMask();
+    }
+    
+    ArenaJsonDocument response(256);
+    response["cmd"] = "liveStreamStop";
+    response["success"] = true;
+    response["wasActive"] = (live != nullptr);
+    if (live) {
+        response["framesSent"] = live->framesSent;
+        response["samplesLost"] = live->samplesLost;
+    }
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+// Ramka: {"cmd":"live","t0":<millis>,"lost":n,"data":{"sps30.PM25":[[dt,v],...],...}}
+static bool sendLiveStreamFrame(LiveStreamClient& live, AsyncWebSocketClient* client) {
+    ArenaJsonDocument frame(16384);
+    frame["cmd"] = "live";
+    JsonObject data = frame.createNestedObject("data");
+    
+    LiveSample samples[LIVE_STREAM_READ_CHUNK];
+    uint32_t cursor = live.cursor;
+    uint32_t lostTotal = 0;
+    uint32_t t0 = 0;
+    size_t added = 0;
+    char name[32];
+    
+    while (added < LIVE_STREAM_FRAME_SAMPLES) {
+        uint32_t lost = 0;
+        size_t chunk = min((size_t)LIVE_STREAM_READ_CHUNK, (size_t)(LIVE_STREAM_FRAME_SAMPLES - added));
+        size_t count = readLiveSamples(cursor, samples, chunk, lost);
+        lostTotal += lost;
+        if (count == 0) break;
+        
+        for (size_t i = 0; i < count; i++) {
+            const LiveSample& s = samples[i];
+            if (!liveMaskHas(live.mask, s.channel) || !liveChannelName(s.channel, name, sizeof(name))) continue;
+            if (added == 0) t0 = s.timestamp;
+            
+            JsonArray series = data[name];
+            if (series.isNull()) {
+                series = data.createNestedArray(name);
+            }
+            JsonArray point = series.createNestedArray();
+            point.add(s.timestamp - t0);
+            point.add(s.value);
+            added++;
+        }
+    }
+    
+    // Nic nowego - kursor i tak przesuwamy (probki innych kanalow)
+    if (added == 0) {
+        live.cursor = cursor;
+        live.samplesLost += lostTotal;
+        return true;
+    }
+    
+    frame["t0"] = t0;
+    frame["lost"] = lostTotal;
+    frame["samples"] = added;
+    
+    AsyncWebSocketSharedBuffer buffer = serializeToBroadcastBuffer(frame);
+    if (!buffer) {
+        // Pula zajeta - probki zostaja w pierscieniu do nastepnego cyklu
+        return false;
+    }
+    client->text(buffer);
+    
+    live.cursor = cursor;
+    live.samplesLost += lostTotal;
+    live.framesSent++;
+    return true;
+}
+
+// Wysylka ramek live (wywolywana z WebSocket task co cykl)
+void processLiveStreams() {
+    unsigned long currentTime = millis();
+    bool changed = false;
+    
+    for (int i = 0; i < MAX_WS_CLIENTS; i++) {
+        LiveStreamClient& live = liveStreamClients[i];
+        if (!live.active) continue;
+        
+        AsyncWebSocketClient* client = ws.client(live.clientId);
+        if (!client || client->status() != WS_CONNECTED) {
+            live.active = false;
+            changed = true;
+            continue;
+        }
+        
+        if (currentTime - live.lastSendTime < live.intervalMs) continue;
+        
+        // Klient nie nadaza - pomin cykl, pierscien przechowa probki (albo policzy straty)
+        if (client->queueLen() >= LIVE_STREAM_QUEUE_LIMIT) continue;
+        
+        if (sendLiveStreamFrame(live, client)) {
+            live.lastSendTime = currentTime;
+        }
+    }
+    
+    if (changed) {
+        updateLiveStreamChannelMask();
+    }
+}
+
+void handleGetHistory(AsyncWebSocketClient* client, JsonDocument& doc) {
+    String sensorType = doc["sensor"] | "";
+    String timeRange = doc["timeRange"] | "1h";
+    String sampleType = doc["sampleType"] | "fast";
+    unsigned long fromTime = doc["fromTime"] | 0;
+    unsigned long toTime = doc["toTime"] | 0;
+    int packetIndex = doc["packetIndex"] | -1; // -1 = automatyczne dzielenie na pakiety
+    int packetSize = doc["packetSize"] | 20;   // Rozmiar pakietu
+    bool autoSendAllPackets = (packetIndex == -1); // Automatyczne wysyłanie wszystkich pakietów
+    
+    // Konwersja timeRange na timestampy (epoch seconds) - TYLKO gdy brak fromTime/toTime
+    if ((fromTime == 0 && toTime == 0) && timeRange != "custom") {
+        unsigned long now = 0;
+        if (time(nullptr) > 8 * 3600 * 2) { // Jeśli czas jest zsynchronizowany
+            now = time(nullptr); // Używaj sekund, nie milisekund!
+        } else {
+            now = millis() / 1000; // Fallback do sekund
+        }
+        
+        if (timeRange == "1h") {
+            fromTime = now - (60 * 60); // 1 godzina w sekundach
+        } else if (timeRange == "6h") {
+            fromTime = now - (6 * 60 * 60); // 6 godzin w sekundach
+        } else if (timeRange == "24h") {
+            fromTime = now - (24 * 60 * 60); // 24 godziny w sekundach
+        } else if (timeRange == "7d") {
+            fromTime = now - (7 * 24 * 60 * 60); // 7 dni w sekundach
+        } else {
+            fromTime = now - (60 * 60); // domyślnie 1h w sekundach
+        }
+        toTime = now;
+        
+        safePrintln("[DEBUG] Auto timeRange " + timeRange + ": from=" + String(fromTime) + " to=" + String(toTime));
+    } else if (timeRange == "custom" && (fromTime != 0 || toTime != 0)) {
+        safePrintln("[DEBUG] Custom timeRange: from=" + String(fromTime) + " to=" + String(toTime));
+    } else {
+        safePrintln("[WARNING] Invalid time parameters or mixed timeRange+fromTime: timeRange=" + timeRange + " fromTime=" + String(fromTime) + " toTime=" + String(toTime));
+        // Jeśli użytkownik podał fromTime/toTime, wymuś timeRange="custom"
+        if (fromTime != 0 || toTime != 0) {
+            timeRange = "custom";
+            safePrintln("[FIX] Forced timeRange to 'custom' due to fromTime/toTime");
+        }
+    }
+    
+    // Jeśli automatyczne dzielenie, najpierw pobierz informacje o łącznej liczbie próbek
+    if (autoSendAllPackets) {
+        packetIndex = 0; // Zacznij od pierwszego pakietu
+        sendHistoryPacketsAutomatically(client, sensorType, timeRange, sampleType, fromTime, toTime, packetSize);
+        return;
+    }
+    
+    String jsonResponse;
+    size_t samples = getHistoricalData(sensorType, timeRange, jsonResponse, fromTime, toTime, sampleType, packetIndex, packetSize);
+    
+    safePrintln("History request: " + sensorType + " " + timeRange + " " + sampleType + " packet: " + String(packetIndex) + "/" + String(packetSize) + " samples: " + String(samples));
+    safePrintln("JSON response length: " + String(jsonResponse.length()));
+    safePrintln("History enabled: " + String(config.enableHistory));
+    safePrintln("History initialized: " + String(historyManager.isInitialized()));
+    safePrintln("Free heap: " + String(ESP.getFreeHeap()));
+    
+    ArenaJsonDocument response(4096);
+    response["cmd"] = "history";
+    response["sensor"] = sensorType;
+    response["timeRange"] = timeRange;
+    response["sampleType"] = sampleType;
+    response["fromTime"] = fromTime;
+    response["toTime"] = toTime;
+    response["samples"] = samples;
+    response["timestamp"] = time(nullptr); // Epoch timestamp
+    
+
+    
+    // Parse existing JSON response to check if data exists
+    ArenaJsonDocument dataDoc(8192);
+    DeserializationError parseError = deserializeJson(dataDoc, jsonResponse);
+    
+    safePrintln("JSON parse error: " + String(parseError.c_str()));
+    safePrintln("JSON response preview: " + jsonResponse.substring(0, 200) + "...");
+    
+    if (!parseError) {
+        if (dataDoc.containsKey("error")) {
+            // getHistoricalData returned an error
+            response["data"] = JsonArray();
+            response["success"] = false;
+            response["error"] = dataDoc["error"].as<String>();
+            safePrintln("History error from getHistoricalData: " + dataDoc["error"].as<String>());
+        } else if (dataDoc.containsKey("data") && dataDoc["data"].is<JsonArray>()) {
+            JsonArray dataArray = dataDoc["data"];
+            response["data"] = dataArray;
+            if (dataArray.size() > 0) {
+                response["success"] = true;
+                safePrintln("History success: " + String(dataArray.size()) + " samples from JSON");
+            } else {
+                response["success"] = false;
+                response["error"] = "No data in response array";
+                safePrintln("History error: Empty data array");
+            }
+        } else {
+            response["data"] = JsonArray();
+            response["success"] = false;
+            response["error"] = "No data field in JSON response";
+            safePrintln("History error: No data field in response");
+        }
+    } else {
+        response["data"] = JsonArray();
+        response["success"] = false;
+        response["error"] = "JSON parse error: " + String(parseError.c_str());
+        safePrintln("History error: JSON parse failed - " + String(parseError.c_str()));
+    }
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+void handleGetHistoryInfo(AsyncWebSocketClient* client, JsonDocument&) {
+    ArenaJsonDocument response(2048);
+    response["cmd"] = "historyInfo";
+    response["timestamp"] = time(nullptr); // Epoch timestamp
+    
+    // Sprawdź czy historia jest włączona
+    if (!config.enableHistory) {
+        response["enabled"] = false;
+        response["error"] = "History system is disabled";
+        response["success"] = false;
+    } else {
+        response["enabled"] = true;
+        response["initialized"] = historyManager.isInitialized();
+        
+        if (historyManager.isInitialized()) {
+            response["totalMemoryUsed"] = historyManager.getTotalMemoryUsed();
             response["memoryBudget"] = TARGET_MEMORY_BYTES;
             response["memoryPercent"] = (historyManager.getTotalMemoryUsed() * 100) / TARGET_MEMORY_BYTES;
             
@@ -729,6 +1606,7 @@ void handleGetHistoryInfo(AsyncWebSocketClient* client, JsonDocument& doc) {
     if (!response.containsKey("success")) {
         response["success"] = true;
     }
+    response["cacheHitRatio"] = getResponseCacheHitRatio();
     
     String responseStr;
     serializeJson(response, responseStr);
@@ -739,7 +1617,16 @@ void handleGetAverages(AsyncWebSocketClient* client, JsonDocument& doc) {
     String sensorType = doc["sensor"] | "";
     String avgType = doc["type"] | "fast"; // fast lub slow
     
-    DynamicJsonDocument response(4096); // Zwiększamy rozmiar dla więcej danych
+    // Te same średnie do następnego przeliczenia (co 5 s) - odpowiedź z cache
+    String cacheKey = "avg|" + sensorType + "|" + avgType;
+    uint32_t generation = getAveragesGeneration();
+    String cached;
+    if (responseCacheGet(cacheKey, generation, cached)) {
+        client->text(cached);
+        return;
+    }
+    
+    ArenaJsonDocument response(4096); // Zwiększamy rozmiar dla więcej danych
     response["cmd"] = "averages";
     response["sensor"] = sensorType;
     response["type"] = avgType;
@@ -1198,11 +2085,12 @@ void handleGetAverages(AsyncWebSocketClient* client, JsonDocument& doc) {
     
     String responseStr;
     serializeJson(response, responseStr);
+    responseCachePut(cacheKey, generation, responseStr);
     client->text(responseStr);
 }
 
 void handleSetConfig(AsyncWebSocketClient* client, JsonDocument& doc) {
-    DynamicJsonDocument response(1024);
+    ArenaJsonDocument response(1024);
     response["cmd"] = "setConfig";
     response["success"] = false;
     
@@ -1436,8 +2324,8 @@ void handleSetConfig(AsyncWebSocketClient* client, JsonDocument& doc) {
     client->text(responseStr);
 }
 
-void handleGetConfig(AsyncWebSocketClient* client, JsonDocument& doc) {
-    DynamicJsonDocument response(2048);
+void handleGetConfig(AsyncWebSocketClient* client, JsonDocument&) {
+    ArenaJsonDocument response(2048);
     response["cmd"] = "getConfig";
     response["timestamp"] = time(nullptr); // Epoch timestamp
     
@@ -1484,21 +2372,28 @@ void handleWebSocketMessage(AsyncWebSocketClient* client, void* arg, uint8_t* da
     // Aktualizuj czas ostatniej aktywności
     lastWebSocketActivity = millis();
     
+    // Obsługujemy tylko kompletne, niefragmentowane ramki tekstowe mieszczące się w slocie
+    AwsFrameInfo* info = (AwsFrameInfo*)arg;
+    if ((info && (!info->final || info->index != 0 || info->len != len)) || len >= WEBSOCKET_SLOT_SIZE) {
+        webSocketSlotsOversize++;
+        safePrintln("WebSocket: Message too large or fragmented (" + String(len) + " bytes), dropping");
+        client->text("{\"error\":\"Message too large\",\"maxLength\":" + String(WEBSOCKET_SLOT_SIZE - 1) + "}");
+        return;
+    }
+    
     // Sprawdź czy WebSocket task jest inicjalizowany
-    if (!webSocketTaskHandle || !webSocketQueue) {
+    if (!webSocketTaskHandle || !webSocketQueue || !webSocketSlots) {
         safePrintln("WebSocket: Task system not initialized, falling back to direct processing");
         
         // Fallback do bezpośredniego przetwarzania w przypadku problemów z task
-        String message = String((char*)data, len);
-        
-        DynamicJsonDocument doc(4096); // Zwiększony buffer dla MCP3424 config
-        DeserializationError error = deserializeJson(doc, message);
+        ArenaJsonDocument doc(4096); // Zwiększony buffer dla MCP3424 config
+        DeserializationError error = deserializeJson(doc, (const char*)data, len);
         
         if (!error) {
             // Wywołaj stary handler bezpośrednio
             handleWebSocketMessageInTask(client, doc);
         } else {
-            DynamicJsonDocument errorResponse(256);
+            ArenaJsonDocument errorResponse(256);
             errorResponse["error"] = "Invalid JSON format";
             errorResponse["fallback"] = true;
             
@@ -1509,62 +2404,40 @@ void handleWebSocketMessage(AsyncWebSocketClient* client, void* arg, uint8_t* da
         return;
     }
     
-    // Sprawdź czy kolejka nie jest pełna
-    if (uxQueueSpacesAvailable(webSocketQueue) == 0) {
-        safePrintln("WebSocket: Queue full, dropping message");
+    // Wyślij do WebSocket task (kopiowanie ramki do wolnego slotu)
+    if (!sendToWebSocketTask(client, data, len)) {
+        safePrintln("WebSocket: No free message slot, dropping message");
         
-        DynamicJsonDocument errorResponse(256);
+        ArenaJsonDocument errorResponse(256);
         errorResponse["error"] = "Server busy - queue full";
         errorResponse["queueSize"] = WEBSOCKET_QUEUE_SIZE;
         
         String errorStr;
         serializeJson(errorResponse, errorStr);
         client->text(errorStr);
-        return;
-    }
-    
-    // Konwertuj dane na string
-    String message = String((char*)data, len);
-    
-    // Wyślij do WebSocket task
-    if (!sendToWebSocketTask(client, message)) {
-        // Fallback jeśli wysyłanie nie powiodło się
-        safePrintln("WebSocket: Failed to send to task, using fallback");
-        
-        DynamicJsonDocument doc(4096); // Zwiększony buffer dla MCP3424 config
-        DeserializationError error = deserializeJson(doc, message);
-        
-        if (!error) {
-            handleWebSocketMessageInTask(client, doc);
-        } else {
-            safePrintln("WebSocket: JSON parse error: " + String(error.c_str()));
-            safePrintln("Problematic message: '" + message + "'");
-            safePrintln("Message length: " + String(message.length()));
-            
-            DynamicJsonDocument errorResponse(256);
-            errorResponse["error"] = "Invalid JSON format";
-            errorResponse["fallback"] = true;
-            errorResponse["details"] = String(error.c_str());
-            errorResponse["messageLength"] = message.length();
-            
-            String errorStr;
-            serializeJson(errorResponse, errorStr);
-            client->text(errorStr);
-        }
     }
 }
 
 // Funkcja dodawania klienta do sledzenia
 void addWebSocketClient(AsyncWebSocketClient* client) {
+    bool added = false;
+    portENTER_CRITICAL(&wsClientsLock);
     if (wsClientCount < MAX_WS_CLIENTS) {
         wsClients[wsClientCount].client = client;
+        wsClients[wsClientCount].id = client->id();
         wsClientCount++;
+        added = true;
+    }
+    portEXIT_CRITICAL(&wsClientsLock);
+    if (added) {
         safePrintln("WebSocket: Client added to tracking, total: " + String(wsClientCount));
     }
 }
 
 // Funkcja usuwania klienta ze sledzenia
 void removeWebSocketClient(AsyncWebSocketClient* client) {
+    bool removed = false;
+    portENTER_CRITICAL(&wsClientsLock);
     for (int i = 0; i < wsClientCount; i++) {
         if (wsClients[i].client == client) {
             // Przesun pozostale klienty
@@ -1572,10 +2445,14 @@ void removeWebSocketClient(AsyncWebSocketClient* client) {
                 wsClients[j] = wsClients[j + 1];
             }
             wsClientCount--;
-            safePrintln("WebSocket: Client removed from tracking, remaining: " + String(wsClientCount));
+            removed = true;
             break;
         }
     }
+    portEXIT_CRITICAL(&wsClientsLock);
+    if (removed) {
+        safePrintln("WebSocket: Client removed from tracking, remaining: " + String(wsClientCount));
+    }
 }
 
 // Funkcja aktualizacji stanu klienta (uproszczona)
@@ -1599,8 +2476,134 @@ void sendNativePing(AsyncWebSocketClient* client) {
 
 
 
+// Inicjalizacja puli buforow broadcastu - alokacja raz przy starcie
+bool initializeBroadcastPool() {
+    if (broadcastPoolMutex) {
+        return true;
+    }
+    
+    broadcastPoolMutex = xSemaphoreCreateMutex();
+    if (!broadcastPoolMutex) {
+        safePrintln("WebSocket: Failed to create broadcast pool mutex");
+        return false;
+    }
+    
+    // malloc powyzej progu CONFIG_SPIRAM_MALLOC_ALWAYSINTERNAL trafia do PSRAM
+    for (int i = 0; i < BROADCAST_POOL_SLOTS; i++) {
+        broadcastPool[i] = std::make_shared<std::vector<uint8_t>>();
+        broadcastPool[i]->reserve(BROADCAST_SLOT_CAPACITY + 1);
+        if (esp_ptr_external_ram(broadcastPool[i]->data())) {
+            broadcastPoolPsramSlots++;
+        }
+    }
+    
+    safePrintln("WebSocket: Broadcast pool ready - " + String(BROADCAST_POOL_SLOTS) + " x " + 
+               String(BROADCAST_SLOT_CAPACITY) + " bytes (" + String(broadcastPoolPsramSlots) + " in PSRAM)");
+    return true;
+}
+
+// Wolny slot puli (use_count == 1); wywoływane pod broadcastPoolMutex
+static AsyncWebSocketSharedBuffer acquireBroadcastSlot() {
+    AsyncWebSocketSharedBuffer result;
+    uint8_t inUse = 0;
+    for (int i = 0; i < BROADCAST_POOL_SLOTS; i++) {
+        if (broadcastPool[i].use_count() > 1) {
+            inUse++;
+        } else if (!result) {
+            result = broadcastPool[i];
+            inUse++;
+        }
+    }
+    
+    if (result) {
+        broadcastPoolAcquired++;
+        if (inUse > broadcastPoolHighWater) broadcastPoolHighWater = inUse;
+    } else {
+        broadcastPoolExhausted++;
+    }
+    return result;
+}
+
+// Serializuje dokument raz do wolnego slotu puli; nullptr gdy pula pelna lub payload za duzy
+AsyncWebSocketSharedBuffer serializeToBroadcastBuffer(const JsonDocument& doc) {
+    if (!broadcastPoolMutex) {
+        return nullptr;
+    }
+    
+    size_t len = measureJson(doc);
+    if (len == 0 || len > BROADCAST_SLOT_CAPACITY) {
+        broadcastPoolOversize++;
+        return nullptr;
+    }
+    
+    if (xSemaphoreTake(broadcastPoolMutex, pdMS_TO_TICKS(50)) != pdTRUE) {
+        return nullptr;
+    }
+    
+    AsyncWebSocketSharedBuffer result = acquireBroadcastSlot();
+    if (result) {
+        // Pojemnosc zarezerwowana przy starcie - resize nie alokuje
+        result->resize(len + 1);
+        serializeJson(doc, (char*)result->data(), len + 1);
+        result->resize(len);
+        if (len > broadcastPoolMaxPayload) broadcastPoolMaxPayload = len;
+    }
+    
+    xSemaphoreGive(broadcastPoolMutex);
+    return result;
+}
+
+// Wypelnia slot puli gotowym tekstem (np. snapshot telemetrii); fill zwraca dlugosc, 0 = blad
+AsyncWebSocketSharedBuffer fillBroadcastBuffer(size_t (*fill)(char* out, size_t capacity)) {
+    if (!broadcastPoolMutex) {
+        return nullptr;
+    }
+    
+    if (xSemaphoreTake(broadcastPoolMutex, pdMS_TO_TICKS(50)) != pdTRUE) {
+        return nullptr;
+    }
+    
+    AsyncWebSocketSharedBuffer result = acquireBroadcastSlot();
+    if (result) {
+        result->resize(BROADCAST_SLOT_CAPACITY);
+        size_t len = fill((char*)result->data(), BROADCAST_SLOT_CAPACITY);
+        if (len == 0) {
+            // Slot wraca do puli (use_count spadnie po zwolnieniu result)
+            broadcastPoolOversize++;
+            result = nullptr;
+        } else {
+            result->resize(len);
+            if (len > broadcastPoolMaxPayload) broadcastPoolMaxPayload = len;
+        }
+    }
+    
+    xSemaphoreGive(broadcastPoolMutex);
+    return result;
+}
+
+String getBroadcastPoolStatus() {
+    uint8_t inUse = 0;
+    for (int i = 0; i < BROADCAST_POOL_SLOTS; i++) {
+        if (broadcastPool[i] && broadcastPool[i].use_count() > 1) inUse++;
+    }
+    
+    String status = "- Broadcast pool: " + String(inUse) + "/" + String(BROADCAST_POOL_SLOTS) + 
+                    " in use, high-water " + String(broadcastPoolHighWater) + 
+                    ", PSRAM slots " + String(broadcastPoolPsramSlots) + "\n";
+    status += "- Broadcast payloads: " + String(broadcastPoolAcquired) + 
+              " (max " + String(broadcastPoolMaxPayload) + " bytes), exhausted " + 
+              String(broadcastPoolExhausted) + ", oversize " + String(broadcastPoolOversize) + "\n";
+    return status;
+}
+
+static void registerWebSocketCommands();
+
 // Funkcja inicjalizacji WebSocket
 void initializeWebSocket(AsyncWebSocket& ws) {
+    registerWebSocketCommands();
+    initializeBroadcastPool();
+    initializeLiveStream();
+    
     ws.onEvent([](AsyncWebSocket* server, AsyncWebSocketClient* client, AwsEventType type, void* arg, uint8_t* data, size_t len) {
         if (type == WS_EVT_CONNECT) {
             safePrintln("WebSocket client connected");
@@ -1611,7 +2614,7 @@ void initializeWebSocket(AsyncWebSocket& ws) {
             // Sprawdz pamiec przed wyslaniem powitalnej wiadomosci
             if (ESP.getFreeHeap() > 15000) {
                 // Wyślij powitalną wiadomość
-                DynamicJsonDocument welcome(512);   
+                ArenaJsonDocument welcome(512);   
                 welcome["cmd"] = "welcome";
                 welcome["message"] = "WebSocket connected";
                 welcome["uptime"] = millis() / 1000;
@@ -1660,7 +2663,7 @@ void initializeWebSocket(AsyncWebSocket& ws) {
                 safePrintln("WebSocket: Low memory, skipping message processing");
                 
                 // Wyslij blad pamieci do klienta
-                DynamicJsonDocument errorResponse(256);
+                ArenaJsonDocument errorResponse(256);
                 errorResponse["error"] = "Low memory";
                 errorResponse["freeHeap"] = ESP.getFreeHeap();
                 String errorStr;
@@ -1681,14 +2684,69 @@ void initializeWebSocket(AsyncWebSocket& ws) {
 
 
 
+// Zwraca slot do puli wolnych
+static void releaseWebSocketSlot(uint8_t slotIndex) {
+    if (webSocketFreeSlots) {
+        xQueueSend(webSocketFreeSlots, &slotIndex, 0);
+    }
+}
+
+// Parsuje i obsługuje komunikat bezpośrednio z bufora slotu
+static void processWebSocketSlot(WebSocketMessageSlot& slot, JsonDocument& doc) {
+    // Sprawdź czy komunikat nie jest za stary
+    if ((millis() - slot.timestamp) > 5000) {
+        safePrintln("WebSocket Task: Dropping old message (" + 
+                   String(millis() - slot.timestamp) + "ms old)");
+        return;
+    }
+    
+    // Sprawdź czy klient nadal jest połączony (po id - wskaźnik mógł zostać zwolniony)
+    if (!slot.client || ws.client(slot.clientId) != slot.client || slot.client->status() != WS_CONNECTED) {
+        safePrintln("WebSocket Task: Client disconnected, dropping message");
+        return;
+    }
+    
+    // Zaktualizuj czas ostatniej aktywności
+    lastWebSocketActivity = millis();
+    
+    // Parsowanie w miejscu (char* = zero-copy, stringi wskazują na bufor slotu)
+    DeserializationError error = deserializeJson(doc, slot.data, slot.length);
+    
+    if (error) {
+        safePrintln("WebSocket Task: JSON parse error: " + String(error.c_str()));
+        safePrintln("Message length: " + String(slot.length));
+        
+        ArenaJsonDocument errorResponse(256);
+        errorResponse["error"] = "Invalid JSON format";
+        errorResponse["code"] = "PARSE_ERROR";
+        errorResponse["details"] = String(error.c_str());
+        errorResponse["messageLength"] = slot.length;
+        
+        String errorStr;
+        serializeJson(errorResponse, errorStr);
+        slot.client->text(errorStr);
+        return;
+    }
+    
+    // Obsłuż komunikat w kontekście task
+    handleWebSocketMessageInTask(slot.client, doc);
+}
+
 // Główny task WebSocket do przetwarzania komunikatów
 void webSocketTask(void* parameters) {
     safePrintln("WebSocket Task: Started with " + String(WEBSOCKET_STACK_SIZE) + " bytes stack");
     
-    WebSocketMessage msg;
+    uint8_t slotIndex;
     TickType_t xLastWakeTime = xTaskGetTickCount();
     const TickType_t xFrequency = pdMS_TO_TICKS(100); // 100ms cycle
     
+    // Dokument JSON alokowany raz w PSRAM - deserializeJson czyści go przy każdym komunikacie
+    // (zwiększony buffer dla MCP3424 config, 8 devices = ~1KB)
+    SpiRamJsonDocument doc(4096);
+    
+    // Arena dla dokumentów odpowiedzi - resetowana po każdym cyklu
+    attachJsonArena(WEBSOCKET_JSON_ARENA_SIZE);
+    
     // Inicjalizuj timery
     lastWebSocketActivity = millis();
     lastHeapCheck = millis();
@@ -1717,48 +2775,15 @@ void webSocketTask(void* parameters) {
             continue;
         }
         
-        // Odbierz komunikat z kolejki (z timeout)
-        if (xQueueReceive(webSocketQueue, &msg, pdMS_TO_TICKS(50)) == pdTRUE) {
-            // Sprawdź czy komunikat nie jest za stary
-            if ((millis() - msg.timestamp) > 5000) {
-                safePrintln("WebSocket Task: Dropping old message (" + 
-                           String(millis() - msg.timestamp) + "ms old)");
-                continue;
-            }
-            
-            // Sprawdź czy klient nadal jest połączony
-            if (!msg.client || msg.client->status() != WS_CONNECTED) {
-                safePrintln("WebSocket Task: Client disconnected, dropping message");
-                continue;
-            }
-            
-            // Zaktualizuj czas ostatniej aktywności
-            lastWebSocketActivity = millis();
-            
-            // Przetwórz komunikat JSON - zwiększony buffer dla MCP3424 config (8 devices = ~1KB)
-            DynamicJsonDocument doc(4096);
-            DeserializationError error = deserializeJson(doc, msg.message);
-            
-            if (error) {
-                safePrintln("WebSocket Task: JSON parse error: " + String(error.c_str()));
-                safePrintln("Problematic message: '" + msg.message + "'");
-                safePrintln("Message length: " + String(msg.message.length()));
-                
-                DynamicJsonDocument errorResponse(256);
-                errorResponse["error"] = "Invalid JSON format";
-                errorResponse["code"] = "PARSE_ERROR";
-                errorResponse["details"] = String(error.c_str());
-                errorResponse["messageLength"] = msg.message.length();
-                
-                String errorStr;
-                serializeJson(errorResponse, errorStr);
-                msg.client->text(errorStr);
-                continue;
+        // Odbierz indeks slotu z kolejki (z timeout)
+        if (xQueueReceive(webSocketQueue, &slotIndex, pdMS_TO_TICKS(50)) == pdTRUE) {
+            if (slotIndex < WEBSOCKET_QUEUE_SIZE) {
+                processWebSocketSlot(webSocketSlots[slotIndex], doc);
+                // Dokument wskazuje na dane slotu (zero-copy) - zwolnij slot dopiero po obsłudze
+                doc.clear();
+                releaseWebSocketSlot(slotIndex);
             }
             
-            // Obsłuż komunikat w kontekście task
-            handleWebSocketMessageInTask(msg.client, doc);
-            
         } else {
             // Timeout - sprawdź stan systemu
             if (freeHeap < CRITICAL_HEAP_SIZE) {
@@ -1770,781 +2795,961 @@ void webSocketTask(void* parameters) {
         // Przetwórz automatyczne wysyłanie pakietów
         processAutoPacketSenders();
         
+        // Wyślij dane subskrybentom, którym minął interwał
+        processSubscriptions();
+        
+        // Snapshot z wsBroadcastTask do klientów bez subskrypcji
+        processWebSocketBroadcast();
+        
+        // Ramki strumienia live (250 ms - 1 s)
+        processLiveStreams();
+        
+        // Wszystkie dokumenty odpowiedzi z tego cyklu już zniszczone - zwolnij arenę
+        resetJsonArena();
+        
         // Regularne opóźnienie
         vTaskDelayUntil(&xLastWakeTime, xFrequency);
     }
 }
 
-// Handler komunikatów WebSocket w kontekście task
-void handleWebSocketMessageInTask(AsyncWebSocketClient* client, DynamicJsonDocument& doc) {
-    safePrintln("WebSocket Task: Processing command in dedicated task context");
+// ===== Handlery komend WebSocket =====
+
+static void handlePingPong(AsyncWebSocketClient* client, JsonDocument&) {
+    // Ping/pong w task context
+    ArenaJsonDocument response(256);
+    response["cmd"] = "pingpong";
+    response["command"] = "pong";
+    response["timestamp"] = time(nullptr); // Epoch timestamp
+    response["freeHeap"] = ESP.getFreeHeap();
+    response["taskStack"] = uxTaskGetStackHighWaterMark(NULL);
     
-    // Sprawdź komendę
-    String cmd = doc["cmd"] | "";
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+static void handleGetNetworkConfig(AsyncWebSocketClient* client, JsonDocument&) {
+    // Inline network config handler
+    ArenaJsonDocument response(2048);
+    response["success"] = true;
+    response["cmd"] = "networkConfig";
+    
+    response["useDHCP"] = networkConfig.useDHCP;
+    response["staticIP"] = networkConfig.staticIP;
+    response["gateway"] = networkConfig.gateway;
+    response["subnet"] = networkConfig.subnet;
+    response["dns1"] = networkConfig.dns1;
+    response["dns2"] = networkConfig.dns2;
+    response["configValid"] = networkConfig.configValid;
+    
+    response["currentIP"] = WiFi.localIP().toString();
+    response["currentSSID"] = WiFi.SSID();
+    response["wifiConnected"] = WiFi.status() == WL_CONNECTED;
+    response["wifiSignal"] = WiFi.RSSI();
     
-    if (cmd == "status") {
-        handleGetStatus(client, doc);
-    } else if (cmd == "getSensorData") {
-        handleGetSensorData(client, doc);
-    } else if (cmd == "getHistory") {
-        handleGetHistory(client, doc);
-    } else if (cmd == "getHistoryInfo") {
-        handleGetHistoryInfo(client, doc);
-    } else if (cmd == "getAverages") {
-        handleGetAverages(client, doc);
-    } else if (cmd == "setConfig") {
-        handleSetConfig(client, doc);
-    } else if (cmd == "getConfig") {
-        handleGetConfig(client, doc);
-    } else if (cmd == "pingpong") {
-        // Ping/pong w task context
-        DynamicJsonDocument response(256);
-        response["cmd"] = "pingpong";
-        response["command"] = "pong";
-        response["timestamp"] = time(nullptr); // Epoch timestamp
-        response["freeHeap"] = ESP.getFreeHeap();
-        response["taskStack"] = uxTaskGetStackHighWaterMark(NULL);
-        
-        String responseStr;
-        serializeJson(response, responseStr);
-        client->text(responseStr);
-    } else if (cmd == "getNetworkConfig") {
-        // Inline network config handler
-        DynamicJsonDocument response(2048);
-        response["success"] = true;
-        response["cmd"] = "networkConfig";
-        
-        response["useDHCP"] = networkConfig.useDHCP;
-        response["staticIP"] = networkConfig.staticIP;
-        response["gateway"] = networkConfig.gateway;
-        response["subnet"] = networkConfig.subnet;
-        response["dns1"] = networkConfig.dns1;
-        response["dns2"] = networkConfig.dns2;
-        response["configValid"] = networkConfig.configValid;
-        
-        response["currentIP"] = WiFi.localIP().toString();
-        response["currentSSID"] = WiFi.SSID();
-        response["wifiConnected"] = WiFi.status() == WL_CONNECTED;
-        response["wifiSignal"] = WiFi.RSSI();
-        
-        char ssid[32], password[64];
-        if (loadWiFiConfig(ssid, password, sizeof(ssid), sizeof(password))) {
-            response["wifiSSID"] = ssid;
-            // Nie zwracamy hasła ze względów bezpieczeństwa
-            response["wifiPasswordSet"] = (strlen(password) > 0);
-        }
-        
-        String responseStr;
-        serializeJson(response, responseStr);
-        client->text(responseStr);
-    } else if (cmd == "setWiFiConfig") {
-        // Inline WiFi config handler
-        String ssid = doc["ssid"] | "";
-        String password = doc["password"] | "";
-        
-        DynamicJsonDocument response(1024);
-        response["cmd"] = "setWiFiConfig";
-        
-        if (ssid.length() > 0) {
-            // Jeśli hasło jest puste, zachowaj istniejące hasło
-            if (password.length() == 0) {
-                char currentSsid[32], currentPassword[64];
-                if (loadWiFiConfig(currentSsid, currentPassword, sizeof(currentSsid), sizeof(currentPassword))) {
-                    password = String(currentPassword);
-                    safePrintln("WiFi: Keeping existing password for SSID: " + ssid);
-                }
-            }
-            
-            if (saveWiFiConfig(ssid.c_str(), password.c_str())) {
-                response["success"] = true;
-                response["message"] = "WiFi configuration saved";
-            } else {
-                response["success"] = false;
-                response["error"] = "Failed to save WiFi config";
+    char ssid[32], password[64];
+    if (loadWiFiConfig(ssid, password, sizeof(ssid), sizeof(password))) {
+        response["wifiSSID"] = ssid;
+        // Nie zwracamy hasła ze względów bezpieczeństwa
+        response["wifiPasswordSet"] = (strlen(password) > 0);
+    }
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+static void handleSetWiFiConfig(AsyncWebSocketClient* client, JsonDocument& doc) {
+    // Inline WiFi config handler
+    String ssid = doc["ssid"] | "";
+    String password = doc["password"] | "";
+    
+    ArenaJsonDocument response(1024);
+    response["cmd"] = "setWiFiConfig";
+    
+    if (ssid.length() > 0) {
+        // Jeśli hasło jest puste, zachowaj istniejące hasło
+        if (password.length() == 0) {
+            char currentSsid[32], currentPassword[64];
+            if (loadWiFiConfig(currentSsid, currentPassword, sizeof(currentSsid), sizeof(currentPassword))) {
+                password = String(currentPassword);
+                safePrintln("WiFi: Keeping existing password for SSID: " + ssid);
             }
-        } else {
-            response["success"] = false;
-            response["error"] = "SSID cannot be empty";
-        }
-        
-        String responseStr;
-        serializeJson(response, responseStr);
-        client->text(responseStr);
-    } else if (cmd == "setNetworkFlag") {
-        // Handle network flag setting
-        bool enabled = doc["enabled"] | false;
-        turnOnNetwork = enabled;
-        
-        DynamicJsonDocument response(512);
-        response["cmd"] = "setNetworkFlag";
-        response["success"] = true;
-        response["enabled"] = enabled;
-        response["message"] = enabled ? "Network flag enabled" : "Network flag disabled";
-        
-        String responseStr;
-        serializeJson(response, responseStr);
-        client->text(responseStr);
-        
-        safePrintln("Network flag set to: " + String(enabled ? "ON" : "OFF"));
-        
-    } else if (cmd == "setNetworkConfig") {
-        // Inline network config handler
-        DynamicJsonDocument response(1024);
-        response["cmd"] = "setNetworkConfig";
-        
-        networkConfig.useDHCP = doc["useDHCP"] | true;
-        strlcpy(networkConfig.staticIP, doc["staticIP"] | "192.168.1.100", sizeof(networkConfig.staticIP));
-        strlcpy(networkConfig.gateway, doc["gateway"] | "192.168.1.1", sizeof(networkConfig.gateway));
-        strlcpy(networkConfig.subnet, doc["subnet"] | "255.255.255.0", sizeof(networkConfig.subnet));
-        strlcpy(networkConfig.dns1, doc["dns1"] | "8.8.8.8", sizeof(networkConfig.dns1));
-        strlcpy(networkConfig.dns2, doc["dns2"] | "8.8.4.4", sizeof(networkConfig.dns2));
-        
-        if (saveNetworkConfig(networkConfig)) {
-            response["success"] = true;
-            response["message"] = "Network configuration saved";
-        } else {
-            response["success"] = false;
-            response["error"] = "Failed to save network config";
-        }
-        
-        String responseStr;
-        serializeJson(response, responseStr);
-        client->text(responseStr);
-    } else if (cmd == "testWiFi") {
-        // Handle WiFi test
-        DynamicJsonDocument response(1024);
-        response["success"] = true;
-        response["cmd"] = "testWiFi";
-        response["wifiConnected"] = WiFi.status() == WL_CONNECTED;
-        response["ssid"] = WiFi.SSID();
-        response["rssi"] = WiFi.RSSI();
-        response["localIP"] = WiFi.localIP().toString();
-        
-        String responseStr;
-        serializeJson(response, responseStr);
-        client->text(responseStr);
-        
-    } else if (cmd == "applyNetworkConfig") {
-        // Handle network config apply
-        DynamicJsonDocument response(1024);
-        response["cmd"] = "applyNetworkConfig";
-        
-        if (applyNetworkConfig()) {
-            response["success"] = true;
-            response["message"] = "Network configuration applied successfully";
-        } else {
-            response["success"] = false;
-            response["error"] = "Failed to apply network configuration";
         }
         
-        String responseStr;
-        serializeJson(response, responseStr);
-        client->text(responseStr);
-        
-    } else if (cmd == "resetNetworkConfig") {
-        // Handle network config reset
-        DynamicJsonDocument response(1024);
-        response["cmd"] = "resetNetworkConfig";
-        
-        if (deleteAllConfig()) {
+        if (saveWiFiConfig(ssid.c_str(), password.c_str())) {
             response["success"] = true;
-            response["message"] = "All network configuration reset";
+            response["message"] = "WiFi configuration saved";
         } else {
             response["success"] = false;
-            response["error"] = "Failed to reset network configuration";
-        }
-        
-        String responseStr;
-        serializeJson(response, responseStr);
-        client->text(responseStr);
-        
-    } else if (cmd == "getSensorKeys") {
-        // Handle sensor keys request - returns JSON structure with keys instead of values
-        safePrintln("WebSocket: getSensorKeys requested");
-        DynamicJsonDocument response(4096);
-        response["cmd"] = "sensorKeys";
-        response["success"] = true;
-        response["timestamp"] = time(nullptr); // Epoch timestamp
-        //heap
-        // response["freeHeap"] = ESP.getFreeHeap();
-        // //wifi
-        // response["wifiSignal"] = WiFi.RSSI();
-      
-        
-        JsonObject data = response.createNestedObject("data");
-        
-        // SHT40
-        JsonObject sht40 = data.createNestedObject("sht40");
-        sht40["valid"] = "SHT40_VALID";
-        sht40["temperature"] = "I2C11_TEMP";
-        sht40["humidity"] = "I2C11_HUMID";
-        sht40["pressure"] = "I2C11_PRESS";
-        
-        // SPS30
-        JsonObject sps30 = data.createNestedObject("sps30");
-        sps30["valid"] = "SPS30_VALID";
-        sps30["PM1"] = "US3_SPS30_PM1";
-        sps30["PM25"] = "US3_SPS30_PM25";
-        sps30["PM4"] = "US3_SPS30_PM4";
-        sps30["PM10"] = "US3_SPS30_PM10";
-        sps30["NC05"] = "US3_SPS30_NC05";
-        sps30["NC1"] = "US3_SPS30_NC1";
-        sps30["NC25"] = "US3_SPS30_NC25";
-        sps30["NC4"] = "US3_SPS30_NC4";
-        sps30["NC10"] = "US3_SPS30_NC10";
-        sps30["TPS"] = "US3_SPS30_TPS";
-        sps30["valid"] = "SPS30_VALID";
-        
-        // CO2
-        JsonObject scd41 = data.createNestedObject("scd41");
-        scd41["valid"] = "CO2_VALID";
-        scd41["co2"] = "I2C5_PRESS";
-        
-        // Power
-        JsonObject power = data.createNestedObject("power");
-        power["valid"] = "POWER_VALID";
-        power["busVoltage"] = "POWER_BUS_VOLTAGE";
-        power["shuntVoltage"] = "POWER_SHUNT_VOLTAGE";
-        power["current"] = "POWER_CURRENT";
-        power["power"] = "POWER_POWER";
-        
-        // HCHO
-        JsonObject hcho = data.createNestedObject("hcho");
-        hcho["valid"] = "HCHO_VALID";
-        hcho["hcho"] = "US0_PMS5003ST_HCHO_UG";
-        hcho["hcho_ppb"] = "HCHO_PPB";
-        
-        // IPS Sensor
-        JsonObject ips = data.createNestedObject("ips");
-        ips["valid"] = "IPS_VALID";
-        ips["debugMode"] = "IPS_DEBUG_MODE";
-        ips["won"] = "IPS_WON";
-        for (int i = 0; i < 7; i++) {
-            ips["pc_" + String(i+1)] = "IPS_PC_" + String(i+1);
-            ips["pm_" + String(i+1)] = "IPS_PM_" + String(i+1);
-            ips["np_" + String(i+1)] = "IPS_NP_" + String(i+1);
-            ips["pw_" + String(i+1)] = "IPS_PW_" + String(i+1);
-        }
-        
-        // MCP3424 - wszystkie urządzenia z kluczami K1_1, K1_2, etc.
-        // JsonObject mcp3424 = data.createNestedObject("mcp3424");
-        // mcp3424["enabled"] = "MCP3424_ENABLED";
-        // mcp3424["deviceCount"] = "MCP3424_DEVICE_COUNT";
-        // mcp3424["valid"] = "MCP3424_VALID";
-        
-        // JsonArray devices = mcp3424.createNestedArray("devices");
-        // for (uint8_t device = 0; device < 8; device++) { // Wszystkie możliwe urządzenia
-        //     JsonObject deviceObj = devices.createNestedObject();
-        //     deviceObj["address"] = "MCP3424_DEVICE_" + String(device+1) + "_ADDRESS";
-        //     deviceObj["valid"] = "MCP3424_DEVICE_" + String(device+1) + "_VALID";
-        //     deviceObj["resolution"] = "MCP3424_DEVICE_" + String(device+1) + "_RESOLUTION";
-        //     deviceObj["gain"] = "MCP3424_DEVICE_" + String(device+1) + "_GAIN";
-            
-        //     JsonObject channels = deviceObj.createNestedObject("channels");
-        //     // Klucze w formacie K%d_%d (numer urządzenia, numer kanału)
-        //     for (uint8_t ch = 0; ch < 4; ch++) {
-        //         String key_mV = "K" + String(device+1) + "_" + String(ch+1) ;
-        //         String key_V = "K" + String(device+1) + "_" + String(ch+1) ;
-        //         channels[key_mV] = key_mV;
-        //         channels[key_V] = key_V;
-        //     }
-        // }
-        
-        // K_channels - wszystkie kanały K jako osobne klucze
-        JsonObject k_channels = data.createNestedObject("K_channels");
-        k_channels["valid"] = "K_CHANNELS_VALID";
-        for (uint8_t device = 0; device < 8; device++) {
-            for (uint8_t ch = 0; ch < 4; ch++) {
-                String key = "K" + String(device+1) + "_" + String(ch+1);
-                k_channels[key] = key;
-            }
+            response["error"] = "Failed to save WiFi config";
         }
-        
+    } else {
+        response["success"] = false;
+        response["error"] = "SSID cannot be empty";
+    }
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
 
-        
-        // Battery monitoring
-        JsonObject battery = data.createNestedObject("battery");
-        battery["valid"] = "BATTERY_VALID";
-        battery["voltage"] = "BATTERY_VOLTAGE";
-        battery["current"] = "BATTERY_CURRENT";
-        battery["power"] = "BATTERY_POWER";
-        battery["chargePercent"] = "BATTERY_CHARGE_PERCENT";
-        battery["isBatteryPowered"] = "BATTERY_IS_BATTERY_POWERED";
-        battery["lowBattery"] = "BATTERY_LOW_BATTERY";
-        battery["criticalBattery"] = "BATTERY_CRITICAL_BATTERY";
-        battery["offPinState"] = "BATTERY_OFF_PIN_STATE";
-//sleep time
-        // Calibrated sensor data keys
-        JsonObject calibrated = data.createNestedObject("calibrated");
-        calibrated["valid"] = "CALIBRATED_VALID";
-        
-        // Gases in ug/m3
-        calibrated["CO"] = "CALIBRATED_CO";
-        calibrated["NO"] = "CALIBRATED_NO";
-        calibrated["NO2"] = "CALIBRATED_NO2";
-        calibrated["O3"] = "CALIBRATED_O3";
-        calibrated["SO2"] = "CALIBRATED_SO2";
-        calibrated["H2S"] = "CALIBRATED_H2S";
-        calibrated["NH3"] = "CALIBRATED_NH3";
-        
-        // Gases in ppb
-        calibrated["CO_ppb"] = "CALIBRATED_CO_PPB";
-        calibrated["NO_ppb"] = "CALIBRATED_NO_PPB";
-        calibrated["NO2_ppb"] = "CALIBRATED_NO2_PPB";
-        calibrated["O3_ppb"] = "CALIBRATED_O3_PPB";
-        calibrated["SO2_ppb"] = "CALIBRATED_SO2_PPB";
-        calibrated["H2S_ppb"] = "CALIBRATED_H2S_PPB";
-        calibrated["NH3_ppb"] = "CALIBRATED_NH3_PPB";
-        
-        // TGS sensors
-        calibrated["TGS02"] = "CALIBRATED_TGS02";
-        calibrated["TGS03"] = "CALIBRATED_TGS03";
-        calibrated["TGS12"] = "CALIBRATED_TGS12";
-        calibrated["TGS02_ohm"] = "CALIBRATED_TGS02_OHM";
-        calibrated["TGS03_ohm"] = "CALIBRATED_TGS03_OHM";
-        calibrated["TGS12_ohm"] = "CALIBRATED_TGS12_OHM";
-        
-        // HCHO and PID
-        calibrated["HCHO"] = "CALIBRATED_HCHO";
-        calibrated["PID"] = "CALIBRATED_PID";
-        calibrated["PID_mV"] = "CALIBRATED_PID_MV";
-        
-        // VOC
-        calibrated["VOC"] = "CALIBRATED_VOC";
-        calibrated["VOC_ppb"] = "CALIBRATED_VOC_PPB";
-        
-        // ADS1110 ADC converter
-        JsonObject ads1110 = data.createNestedObject("ads1110");
-        ads1110["valid"] = "ADS1110_VALID";
-        ads1110["voltage"] = "ADS1110_VOLTAGE";
-        ads1110["dataRate"] = "ADS1110_DATA_RATE";
-        ads1110["gain"] = "ADS1110_GAIN";
-        
-        // Fan control system (updated from existing fan section)
-        JsonObject fan = data.createNestedObject("fan");
-        fan["valid"] = "FAN_VALID";
-        fan["dutyCycle"] = "FAN_DUTY_CYCLE";
-        fan["rpm"] = "FAN_RPM";
-        fan["enabled"] = "FAN_ENABLED";
-        fan["glineEnabled"] = "FAN_GLINE_ENABLED";
-        
-        // System status
-        JsonObject system = data.createNestedObject("system");
-        system["valid"] = "SYSTEM_VALID";
-        system["uptime"] = "SYSTEM_UPTIME";
-        system["freeHeap"] = "SYSTEM_FREE_HEAP";
-        system["wifiSignal"] = "SYSTEM_WIFI_SIGNAL";
-        system["ntpTime"] = "SYSTEM_NTP_TIME";
-        
-        String responseStr;
-        serializeJson(response, responseStr);
-        client->text(responseStr);
-        
-    } else if (cmd == "getMCP3424Config") {
-        // Handle MCP3424 config request - reload from LittleFS first
-        safePrintln("WebSocket: getMCP3424Config requested - reloading from LittleFS");
-        
-        // Reload config from file to ensure latest data
-        if (!loadMCP3424Config(mcp3424Config)) {
-            safePrintln("Failed to load MCP3424 config from LittleFS, using current memory");
-        } else {
-            safePrintln("MCP3424 config reloaded successfully from LittleFS");
-        }
-        
-        DynamicJsonDocument response(2048);
-        response["cmd"] = "mcp3424Config";
+static void handleSetNetworkFlag(AsyncWebSocketClient* client, JsonDocument& doc) {
+    // Handle network flag setting
+    bool enabled = doc["enabled"] | false;
+    turnOnNetwork = enabled;
+    
+    ArenaJsonDocument response(512);
+    response["cmd"] = "setNetworkFlag";
+    response["success"] = true;
+    response["enabled"] = enabled;
+    response["message"] = enabled ? "Network flag enabled" : "Network flag disabled";
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+    
+    safePrintln("Network flag set to: " + String(enabled ? "ON" : "OFF"));
+}
+
+static void handleSetNetworkConfig(AsyncWebSocketClient* client, JsonDocument& doc) {
+    // Inline network config handler
+    ArenaJsonDocument response(1024);
+    response["cmd"] = "setNetworkConfig";
+    
+    networkConfig.useDHCP = doc["useDHCP"] | true;
+    strlcpy(networkConfig.staticIP, doc["staticIP"] | "192.168.1.100", sizeof(networkConfig.staticIP));
+    strlcpy(networkConfig.gateway, doc["gateway"] | "192.168.1.1", sizeof(networkConfig.gateway));
+    strlcpy(networkConfig.subnet, doc["subnet"] | "255.255.255.0", sizeof(networkConfig.subnet));
+    strlcpy(networkConfig.dns1, doc["dns1"] | "8.8.8.8", sizeof(networkConfig.dns1));
+    strlcpy(networkConfig.dns2, doc["dns2"] | "8.8.4.4", sizeof(networkConfig.dns2));
+    
+    if (saveNetworkConfig(networkConfig)) {
         response["success"] = true;
-        
-        // Manually serialize MCP3424Config to JSON
-        JsonObject configObj = response.createNestedObject("config");
-        configObj["deviceCount"] = mcp3424Config.deviceCount;
-        configObj["configValid"] = mcp3424Config.configValid;
-        
-        JsonArray devices = configObj.createNestedArray("devices");
-        safePrintln("MCP3424 config: deviceCount = " + String(mcp3424Config.deviceCount));
-        
-        // ALWAYS return all 8 devices for frontend UI (not just enabled ones)
-        for (uint8_t i = 0; i < 8; i++) {
-            JsonObject device = devices.createNestedObject();
-            device["deviceIndex"] = i;
-            device["i2cAddress"] = mcp3424Config.devices[i].i2cAddress;
-            device["gasType"] = mcp3424Config.devices[i].gasType;
-            device["description"] = mcp3424Config.devices[i].description;
-            device["enabled"] = mcp3424Config.devices[i].enabled;
-            device["autoDetected"] = mcp3424Config.devices[i].autoDetected;
-            
-            safePrintln("Device " + String(i) + ": '" + String(mcp3424Config.devices[i].gasType) + 
-                       "' @ 0x" + String(mcp3424Config.devices[i].i2cAddress, HEX) + 
-                       " (enabled: " + String(mcp3424Config.devices[i].enabled ? "true" : "false") + ")");
-        }
-        
-        String responseStr;
-        serializeJson(response, responseStr);
-        safePrintln("Sending MCP3424 config response: " + responseStr);
-        client->text(responseStr);
-        
-    } else if (cmd == "scanI2CAddresses") {
-        // I2C scan command
-        DynamicJsonDocument response(1024);
-        response["cmd"] = "i2cScanResult";
-        response["timestamp"] = time(nullptr);
-        
-        JsonArray foundAddresses = response.createNestedArray("foundAddresses");
-        int foundCount = 0;
-        
-        // Scan I2C addresses typical for MCP3424 (0x68-0x6F)
-        safePrintln("WebSocket: Starting I2C scan for MCP3424 devices...");
-        for (uint8_t addr = 0x68; addr <= 0x6F; addr++) {
-            if (addr == 0x69) continue; // Skip excluded address
-            
-            Wire.beginTransmission(addr);
-            uint8_t result = Wire.endTransmission();
-            
-            if (result == 0) {
-                // Device found
-                foundAddresses.add(addr);
-                foundCount++;
-                safePrintln("I2C device found at 0x" + String(addr, HEX));
-            }
-        }
-        
-        response["success"] = true;
-        response["message"] = "I2C scan completed. Found " + String(foundCount) + " devices.";
-        response["foundCount"] = foundCount;
-        
-        String responseStr;
-        serializeJson(response, responseStr);
-        client->text(responseStr);
-        
-    } else if (cmd == "getWebSocketStatus") {
-        // Komenda diagnostyczna
-        DynamicJsonDocument response(1024);
-        response["cmd"] = "webSocketStatus";
-        response["success"] = true;
-        response["status"] = getWebSocketStatus();
-        response["timestamp"] = time(nullptr); // Epoch timestamp
-        
-        String responseStr;
-        serializeJson(response, responseStr);
-        client->text(responseStr);
-    } else if (cmd == "forceWebSocketReset") {
-        // Komenda do ręcznego resetowania
-        String reason = doc["reason"] | "Manual reset from client";
-        forceWebSocketReset(reason);
-        
-        DynamicJsonDocument response(256);
-        response["cmd"] = "webSocketResetScheduled";
-        response["success"] = true;
-        response["reason"] = reason;
-        
-        String responseStr;
-        serializeJson(response, responseStr);
-        client->text(responseStr);
-    } else if (cmd == "restart" || cmd == "reset") {
-        // System restart/reset commands
-        DynamicJsonDocument response(512);
-        response["cmd"] = cmd;
-        response["success"] = true;
-        response["message"] = "System " + cmd + "ing...";
-        response["timestamp"] = time(nullptr); // Epoch timestamp
-        
-        String responseStr;
-        serializeJson(response, responseStr);
-        client->text(responseStr);
-        
-        delay(1000);
-        ESP.restart();
-        
-    } else if (cmd == "memory") {
-        // Memory status command
-        DynamicJsonDocument response(512);
-        response["cmd"] = "memory";
+        response["message"] = "Network configuration saved";
+    } else {
+        response["success"] = false;
+        response["error"] = "Failed to save network config";
+    }
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+static void handleTestWiFi(AsyncWebSocketClient* client, JsonDocument&) {
+    // Handle WiFi test
+    ArenaJsonDocument response(1024);
+    response["success"] = true;
+    response["cmd"] = "testWiFi";
+    response["wifiConnected"] = WiFi.status() == WL_CONNECTED;
+    response["ssid"] = WiFi.SSID();
+    response["rssi"] = WiFi.RSSI();
+    response["localIP"] = WiFi.localIP().toString();
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+static void handleApplyNetworkConfig(AsyncWebSocketClient* client, JsonDocument&) {
+    // Handle network config apply
+    ArenaJsonDocument response(1024);
+    response["cmd"] = "applyNetworkConfig";
+    
+    if (applyNetworkConfig()) {
         response["success"] = true;
-        response["freeHeap"] = ESP.getFreeHeap();
-        response["freePsram"] = ESP.getFreePsram();
-        response["psramSize"] = ESP.getPsramSize();
-        response["uptime"] = millis() / 1000;
-        response["timestamp"] = time(nullptr); // Epoch timestamp
-        
-        String responseStr;
-        serializeJson(response, responseStr);
-        client->text(responseStr);
-        
-    } else if (cmd == "lowPowerOn" || cmd == "lowPowerOff") {
-        // Low power mode commands
-        config.lowPowerMode = (cmd == "lowPowerOn");
-        
-        DynamicJsonDocument response(512);
-        response["cmd"] = cmd;
+        response["message"] = "Network configuration applied successfully";
+    } else {
+        response["success"] = false;
+        response["error"] = "Failed to apply network configuration";
+    }
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+static void handleResetNetworkConfig(AsyncWebSocketClient* client, JsonDocument&) {
+    // Handle network config reset
+    ArenaJsonDocument response(1024);
+    response["cmd"] = "resetNetworkConfig";
+    
+    if (deleteAllConfig()) {
         response["success"] = true;
-        response["message"] = String("Low power mode ") + (config.lowPowerMode ? "enabled" : "disabled");
-        response["lowPowerMode"] = config.lowPowerMode;
-        response["timestamp"] = time(nullptr); // Epoch timestamp
-        
-        String responseStr;
-        serializeJson(response, responseStr);
-        client->text(responseStr);
-        
-    } else if (cmd == "pushbulletTest") {
-        // Pushbullet test notification
-        DynamicJsonDocument response(512);
-        response["cmd"] = "pushbulletTest";
-        response["timestamp"] = time(nullptr); // Epoch timestamp
-        
-        if (config.enablePushbullet && strlen(config.pushbulletToken) > 0) {
-            sendPushbulletNotification("🧪 Test Notification", "This is a test notification from ESP32 Sensor Cube\nTime: " + getFormattedTime() + "\nUptime: " + getUptimeString());
-            response["success"] = true;
-            response["message"] = "Test notification sent";
-        } else {
-            response["success"] = false;
-            response["message"] = "Pushbullet not configured";
+        response["message"] = "All network configuration reset";
+    } else {
+        response["success"] = false;
+        response["error"] = "Failed to reset network configuration";
+    }
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+static void handleGetSensorKeys(AsyncWebSocketClient* client, JsonDocument&) {
+    // Handle sensor keys request - returns JSON structure with keys instead of values
+    safePrintln("WebSocket: getSensorKeys requested");
+    ArenaJsonDocument response(4096);
+    response["cmd"] = "sensorKeys";
+    response["success"] = true;
+    response["timestamp"] = time(nullptr); // Epoch timestamp
+    //heap
+    // response["freeHeap"] = ESP.getFreeHeap();
+    // //wifi
+    // response["wifiSignal"] = WiFi.RSSI();
+  
+    
+    JsonObject data = response.createNestedObject("data");
+    
+    // SHT40
+    JsonObject sht40 = data.createNestedObject("sht40");
+    sht40["valid"] = "SHT40_VALID";
+    sht40["temperature"] = "I2C11_TEMP";
+    sht40["humidity"] = "I2C11_HUMID";
+    sht40["pressure"] = "I2C11_PRESS";
+    
+    // SPS30
+    JsonObject sps30 = data.createNestedObject("sps30");
+    sps30["valid"] = "SPS30_VALID";
+    sps30["PM1"] = "US3_SPS30_PM1";
+    sps30["PM25"] = "US3_SPS30_PM25";
+    sps30["PM4"] = "US3_SPS30_PM4";
+    sps30["PM10"] = "US3_SPS30_PM10";
+    sps30["NC05"] = "US3_SPS30_NC05";
+    sps30["NC1"] = "US3_SPS30_NC1";
+    sps30["NC25"] = "US3_SPS30_NC25";
+    sps30["NC4"] = "US3_SPS30_NC4";
+    sps30["NC10"] = "US3_SPS30_NC10";
+    sps30["TPS"] = "US3_SPS30_TPS";
+    sps30["valid"] = "SPS30_VALID";
+    
+    // CO2
+    JsonObject scd41 = data.createNestedObject("scd41");
+    scd41["valid"] = "CO2_VALID";
+    scd41["co2"] = "I2C5_PRESS";
+    
+    // Power
+    JsonObject power = data.createNestedObject("power");
+    power["valid"] = "POWER_VALID";
+    power["busVoltage"] = "POWER_BUS_VOLTAGE";
+    power["shuntVoltage"] = "POWER_SHUNT_VOLTAGE";
+    power["current"] = "POWER_CURRENT";
+    power["power"] = "POWER_POWER";
+    
+    // HCHO
+    JsonObject hcho = data.createNestedObject("hcho");
+    hcho["valid"] = "HCHO_VALID";
+    hcho["hcho"] = "US0_PMS5003ST_HCHO_UG";
+    hcho["hcho_ppb"] = "HCHO_PPB";
+    
+    // IPS Sensor
+    JsonObject ips = data.createNestedObject("ips");
+    ips["valid"] = "IPS_VALID";
+    ips["debugMode"] = "IPS_DEBUG_MODE";
+    ips["won"] = "IPS_WON";
+    for (int i = 0; i < 7; i++) {
+        ips["pc_" + String(i+1)] = "IPS_PC_" + String(i+1);
+        ips["pm_" + String(i+1)] = "IPS_PM_" + String(i+1);
+        ips["np_" + String(i+1)] = "IPS_NP_" + String(i+1);
+        ips["pw_" + String(i+1)] = "IPS_PW_" + String(i+1);
+    }
+    
+    // MCP3424 - wszystkie urządzenia z kluczami K1_1, K1_2, etc.
+    // JsonObject mcp3424 = data.createNestedObject("mcp3424");
+    // mcp3424["enabled"] = "MCP3424_ENABLED";
+    // mcp3424["deviceCount"] = "MCP3424_DEVICE_COUNT";
+    // mcp3424["valid"] = "MCP3424_VALID";
+    
+    // JsonArray devices = mcp3424.createNestedArray("devices");
+    // for (uint8_t device = 0; device < 8; device++) { // Wszystkie możliwe urządzenia
+    //     JsonObject deviceObj = devices.createNestedObject();
+    //     deviceObj["address"] = "MCP3424_DEVICE_" + String(device+1) + "_ADDRESS";
+    //     deviceObj["valid"] = "MCP3424_DEVICE_" + String(device+1) + "_VALID";
+    //     deviceObj["resolution"] = "MCP3424_DEVICE_" + String(device+1) + "_RESOLUTION";
+    //     deviceObj["gain"] = "MCP3424_DEVICE_" + String(device+1) + "_GAIN";
+        
+    //     JsonObject channels = deviceObj.createNestedObject("channels");
+    //     // Klucze w formacie K%d_%d (numer urządzenia, numer kanału)
+    //     for (uint8_t ch = 0; ch < 4; ch++) {
+    //         String key_mV = "K" + String(device+1) + "_" + String(ch+1) ;
+    //         String key_V = "K" + String(device+1) + "_" + String(ch+1) ;
+    //         channels[key_mV] = key_mV;
+    //         channels[key_V] = key_V;
+    //     }
+    // }
+    
+    // K_channels - wszystkie kanały K jako osobne klucze
+    JsonObject k_channels = data.createNestedObject("K_channels");
+    k_channels["valid"] = "K_CHANNELS_VALID";
+    for (uint8_t device = 0; device < 8; device++) {
+        for (uint8_t ch = 0; ch < 4; ch++) {
+            String key = "K" + String(device+1) + "_" + String(ch+1);
+            k_channels[key] = key;
         }
-        
-        String responseStr;
-        serializeJson(response, responseStr);
-        client->text(responseStr);
-        
-    } else if (cmd == "pushbulletBatteryTest") {
-        // Pushbullet battery test notification
-        DynamicJsonDocument response(512);
-        response["cmd"] = "pushbulletBatteryTest";
-        response["timestamp"] = time(nullptr); // Epoch timestamp
-        
-        if (config.enablePushbullet && strlen(config.pushbulletToken) > 0) {
-            sendBatteryCriticalNotification();
-            digitalWrite(OFF_PIN, HIGH);
-            response["success"] = true;
-            response["message"] = "Battery critical test notification sent";
-        } else {
-            response["success"] = false;
-            response["message"] = "Pushbullet not configured";
+    }
+    
+
+    
+    // Battery monitoring
+    JsonObject battery = data.createNestedObject("battery");
+    battery["valid"] = "BATTERY_VALID";
+    battery["voltage"] = "BATTERY_VOLTAGE";
+    battery["current"] = "BATTERY_CURRENT";
+    battery["power"] = "BATTERY_POWER";
+    battery["chargePercent"] = "BATTERY_CHARGE_PERCENT";
+    battery["isBatteryPowered"] = "BATTERY_IS_BATTERY_POWERED";
+    battery["lowBattery"] = "BATTERY_LOW_BATTERY";
+    battery["criticalBattery"] = "BATTERY_CRITICAL_BATTERY";
+    battery["offPinState"] = "BATTERY_OFF_PIN_STATE";
+//sleep time
+    // Calibrated sensor data keys
+    JsonObject calibrated = data.createNestedObject("calibrated");
+    calibrated["valid"] = "CALIBRATED_VALID";
+    
+    // Gases in ug/m3
+    calibrated["CO"] = "CALIBRATED_CO";
+    calibrated["NO"] = "CALIBRATED_NO";
+    calibrated["NO2"] = "CALIBRATED_NO2";
+    calibrated["O3"] = "CALIBRATED_O3";
+    calibrated["SO2"] = "CALIBRATED_SO2";
+    calibrated["H2S"] = "CALIBRATED_H2S";
+    calibrated["NH3"] = "CALIBRATED_NH3";
+    
+    // Gases in ppb
+    calibrated["CO_ppb"] = "CALIBRATED_CO_PPB";
+    calibrated["NO_ppb"] = "CALIBRATED_NO_PPB";
+    calibrated["NO2_ppb"] = "CALIBRATED_NO2_PPB";
+    calibrated["O3_ppb"] = "CALIBRATED_O3_PPB";
+    calibrated["SO2_ppb"] = "CALIBRATED_SO2_PPB";
+    calibrated["H2S_ppb"] = "CALIBRATED_H2S_PPB";
+    calibrated["NH3_ppb"] = "CALIBRATED_NH3_PPB";
+    
+    // TGS sensors
+    calibrated["TGS02"] = "CALIBRATED_TGS02";
+    calibrated["TGS03"] = "CALIBRATED_TGS03";
+    calibrated["TGS12"] = "CALIBRATED_TGS12";
+    calibrated["TGS02_ohm"] = "CALIBRATED_TGS02_OHM";
+    calibrated["TGS03_ohm"] = "CALIBRATED_TGS03_OHM";
+    calibrated["TGS12_ohm"] = "CALIBRATED_TGS12_OHM";
+    
+    // HCHO and PID
+    calibrated["HCHO"] = "CALIBRATED_HCHO";
+    calibrated["PID"] = "CALIBRATED_PID";
+    calibrated["PID_mV"] = "CALIBRATED_PID_MV";
+    
+    // VOC
+    calibrated["VOC"] = "CALIBRATED_VOC";
+    calibrated["VOC_ppb"] = "CALIBRATED_VOC_PPB";
+    
+    // ADS1110 ADC converter
+    JsonObject ads1110 = data.createNestedObject("ads1110");
+    ads1110["valid"] = "ADS1110_VALID";
+    ads1110["voltage"] = "ADS1110_VOLTAGE";
+    ads1110["dataRate"] = "ADS1110_DATA_RATE";
+    ads1110["gain"] = "ADS1110_GAIN";
+    
+    // Fan control system (updated from existing fan section)
+    JsonObject fan = data.createNestedObject("fan");
+    fan["valid"] = "FAN_VALID";
+    fan["dutyCycle"] = "FAN_DUTY_CYCLE";
+    fan["rpm"] = "FAN_RPM";
+    fan["enabled"] = "FAN_ENABLED";
+    fan["glineEnabled"] = "FAN_GLINE_ENABLED";
+    
+    // System status
+    JsonObject system = data.createNestedObject("system");
+    system["valid"] = "SYSTEM_VALID";
+    system["uptime"] = "SYSTEM_UPTIME";
+    system["freeHeap"] = "SYSTEM_FREE_HEAP";
+    system["wifiSignal"] = "SYSTEM_WIFI_SIGNAL";
+    system["ntpTime"] = "SYSTEM_NTP_TIME";
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+static void handleGetMCP3424Config(AsyncWebSocketClient* client, JsonDocument&) {
+    // Handle MCP3424 config request - reload from LittleFS first
+    safePrintln("WebSocket: getMCP3424Config requested - reloading from LittleFS");
+    
+    // Reload config from file to ensure latest data
+    if (!loadMCP3424Config(mcp3424Config)) {
+        safePrintln("Failed to load MCP3424 config from LittleFS, using current memory");
+    } else {
+        safePrintln("MCP3424 config reloaded successfully from LittleFS");
+    }
+    
+    ArenaJsonDocument response(3072);
+    response["cmd"] = "mcp3424Config";
+    response["success"] = true;
+    
+    // Manually serialize MCP3424Config to JSON
+    JsonObject configObj = response.createNestedObject("config");
+    configObj["deviceCount"] = mcp3424Config.deviceCount;
+    configObj["configValid"] = mcp3424Config.configValid;
+    
+    JsonArray devices = configObj.createNestedArray("devices");
+    safePrintln("MCP3424 config: deviceCount = " + String(mcp3424Config.deviceCount));
+    
+    // ALWAYS return all 8 devices for frontend UI (not just enabled ones)
+    for (uint8_t i = 0; i < 8; i++) {
+        JsonObject device = devices.createNestedObject();
+        device["deviceIndex"] = i;
+        device["i2cAddress"] = mcp3424Config.devices[i].i2cAddress;
+        device["gasType"] = mcp3424Config.devices[i].gasType;
+        device["description"] = mcp3424Config.devices[i].description;
+        device["enabled"] = mcp3424Config.devices[i].enabled;
+        device["autoDetected"] = mcp3424Config.devices[i].autoDetected;
+        JsonArray resolution = device.createNestedArray("resolution");
+        for (uint8_t ch = 0; ch < 4; ch++) {
+            resolution.add(mcp3424Config.devices[i].resolution[ch]);
         }
         
-        String responseStr;
-        serializeJson(response, responseStr);
-        client->text(responseStr);
+        safePrintln("Device " + String(i) + ": '" + String(mcp3424Config.devices[i].gasType) + 
+                   "' @ 0x" + String(mcp3424Config.devices[i].i2cAddress, HEX) + 
+                   " (enabled: " + String(mcp3424Config.devices[i].enabled ? "true" : "false") + ")");
+    }
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    safePrintln("Sending MCP3424 config response: " + responseStr);
+    client->text(responseStr);
+}
+
+static void handleScanI2CAddresses(AsyncWebSocketClient* client, JsonDocument&) {
+    // I2C scan command
+    ArenaJsonDocument response(1024);
+    response["cmd"] = "i2cScanResult";
+    response["timestamp"] = time(nullptr);
+    
+    JsonArray foundAddresses = response.createNestedArray("foundAddresses");
+    int foundCount = 0;
+    
+    // Scan I2C addresses typical for MCP3424 (0x68-0x6F)
+    safePrintln("WebSocket: Starting I2C scan for MCP3424 devices...");
+    for (uint8_t addr = 0x68; addr <= 0x6F; addr++) {
+        if (addr == 0x69) continue; // Skip excluded address
         
-    } else if (cmd == "wifi") {
-        // WiFi status command
-        DynamicJsonDocument response(512);
-        response["cmd"] = "wifi";
+        if (i2cBusProbe(addr)) {
+            // Device found
+            foundAddresses.add(addr);
+            foundCount++;
+            safePrintln("I2C device found at 0x" + String(addr, HEX));
+        }
+    }
+    
+    response["success"] = true;
+    response["message"] = "I2C scan completed. Found " + String(foundCount) + " devices.";
+    response["foundCount"] = foundCount;
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+static void handleGetWebSocketStatus(AsyncWebSocketClient* client, JsonDocument&) {
+    // Komenda diagnostyczna
+    ArenaJsonDocument response(1024);
+    response["cmd"] = "webSocketStatus";
+    response["success"] = true;
+    response["status"] = getWebSocketStatus();
+    response["timestamp"] = time(nullptr); // Epoch timestamp
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+static void handleForceWebSocketReset(AsyncWebSocketClient* client, JsonDocument& doc) {
+    // Komenda do ręcznego resetowania
+    String reason = doc["reason"] | "Manual reset from client";
+    forceWebSocketReset(reason);
+    
+    ArenaJsonDocument response(256);
+    response["cmd"] = "webSocketResetScheduled";
+    response["success"] = true;
+    response["reason"] = reason;
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+static void handleRestart(AsyncWebSocketClient* client, JsonDocument& doc) {
+    String cmd = doc["cmd"] | "";
+    
+    // System restart/reset commands
+    ArenaJsonDocument response(512);
+    response["cmd"] = cmd;
+    response["success"] = true;
+    response["message"] = "System " + cmd + "ing...";
+    response["timestamp"] = time(nullptr); // Epoch timestamp
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+    
+    delay(1000);
+    ESP.restart();
+}
+
+static void handleMemory(AsyncWebSocketClient* client, JsonDocument&) {
+    // Memory status command
+    ArenaJsonDocument response(512);
+    response["cmd"] = "memory";
+    response["success"] = true;
+    response["freeHeap"] = ESP.getFreeHeap();
+    response["freePsram"] = ESP.getFreePsram();
+    response["psramSize"] = ESP.getPsramSize();
+    response["uptime"] = millis() / 1000;
+    response["timestamp"] = time(nullptr); // Epoch timestamp
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+static void handleLowPower(AsyncWebSocketClient* client, JsonDocument& doc) {
+    String cmd = doc["cmd"] | "";
+    
+    // Low power mode commands
+    config.lowPowerMode = (cmd == "lowPowerOn");
+    
+    ArenaJsonDocument response(512);
+    response["cmd"] = cmd;
+    response["success"] = true;
+    response["message"] = String("Low power mode ") + (config.lowPowerMode ? "enabled" : "disabled");
+    response["lowPowerMode"] = config.lowPowerMode;
+    response["timestamp"] = time(nullptr); // Epoch timestamp
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+static void handlePushbulletTest(AsyncWebSocketClient* client, JsonDocument&) {
+    // Pushbullet test notification
+    ArenaJsonDocument response(512);
+    response["cmd"] = "pushbulletTest";
+    response["timestamp"] = time(nullptr); // Epoch timestamp
+    
+    if (config.enablePushbullet && strlen(config.pushbulletToken) > 0) {
+        sendPushbulletNotification("🧪 Test Notification", "This is a test notification from ESP32 Sensor Cube\nTime: " + getFormattedTime() + "\nUptime: " + getUptimeString());
         response["success"] = true;
-        response["connected"] = WiFi.status() == WL_CONNECTED;
-        response["ssid"] = WiFi.SSID();
-        response["rssi"] = WiFi.RSSI();
-        response["localIP"] = WiFi.localIP().toString();
-        response["timestamp"] = time(nullptr); // Epoch timestamp
-        
-        String responseStr;
-        serializeJson(response, responseStr);
-        client->text(responseStr);
-        
-    } else if (cmd == "fan_speed" || cmd == "fan_on" || cmd == "fan_off" || 
-               cmd == "gline_on" || cmd == "gline_off" || cmd == "sleep" || 
-               cmd == "sleep_stop" || cmd == "wake") {
-        // Fan control commands
-        DynamicJsonDocument response(1024);
-        response["cmd"] = cmd;
-        response["timestamp"] = time(nullptr); // Epoch timestamp
-        
-        safePrintln("=== Fan command received: " + cmd + " ===");
-        safePrintln("config.enableFan = " + String(config.enableFan ? "true" : "false"));
-        
-        if (!config.enableFan) {
-            response["success"] = false;
-            response["error"] = "Fan control is DISABLED in configuration";
-            safePrintln("Fan control DISABLED - returning error");
-        } else {
-            String value = "";
-            if (cmd == "fan_speed") {
-                safePrintln("=== Processing fan_speed command ===");
-                
-                // Debug: print raw JSON
-                String rawJson;
-                serializeJson(doc, rawJson);
-                safePrintln("Raw JSON received: " + rawJson);
-                
-                // Check if value field exists and what type it is
-                if (doc.containsKey("value")) {
-                    safePrintln("Value field exists");
-                    if (doc["value"].is<int>()) {
-                        safePrintln("Value is integer");
-                    } else if (doc["value"].is<const char*>()) {
-                        safePrintln("Value is string");
-                    } else if (doc["value"].is<float>()) {
-                        safePrintln("Value is float");
-                    } else {
-                        safePrintln("Value is unknown type");
-                    }
-                } else {
-                    safePrintln("Value field does NOT exist");
-                }
-                
-                // Try different parsing methods
-                int receivedValue1 = doc["value"] | 0;  // Original method
-                int receivedValue2 = doc["value"].as<int>();  // Direct cast
-                String valueStr = doc["value"].as<String>();  // As string first
-                int receivedValue3 = valueStr.toInt();  // String to int
-                
-                safePrintln("Method 1 (| 0): " + String(receivedValue1));
-                safePrintln("Method 2 (.as<int>()): " + String(receivedValue2));
-                safePrintln("Method 3 (string->int): " + String(receivedValue3));
-                safePrintln("Value as string: '" + valueStr + "'");
-                
-                value = String(receivedValue1);
-                safePrintln("Fan speed command: received value=" + String(receivedValue1) + ", parsed value=" + value);
-                safePrintln("Original JSON: value field exists=" + String(doc.containsKey("value") ? "true" : "false"));
-            } else if (cmd == "sleep") {
-                unsigned long delaySec = doc["delay"] | 0;
-                unsigned long durationSec = doc["duration"] | 0;
-                value = String(delaySec) + " " + String(durationSec);
-            }
+        response["message"] = "Test notification sent";
+    } else {
+        response["success"] = false;
+        response["message"] = "Pushbullet not configured";
+    }
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+static void handlePushbulletBatteryTest(AsyncWebSocketClient* client, JsonDocument&) {
+    // Pushbullet battery test notification
+    ArenaJsonDocument response(512);
+    response["cmd"] = "pushbulletBatteryTest";
+    response["timestamp"] = time(nullptr); // Epoch timestamp
+    
+    if (config.enablePushbullet && strlen(config.pushbulletToken) > 0) {
+        sendBatteryCriticalNotification();
+        digitalWrite(OFF_PIN, HIGH);
+        response["success"] = true;
+        response["message"] = "Battery critical test notification sent";
+    } else {
+        response["success"] = false;
+        response["message"] = "Pushbullet not configured";
+    }
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+static void handleWiFiStatus(AsyncWebSocketClient* client, JsonDocument&) {
+    // WiFi status command
+    ArenaJsonDocument response(512);
+    response["cmd"] = "wifi";
+    response["success"] = true;
+    response["connected"] = WiFi.status() == WL_CONNECTED;
+    response["ssid"] = WiFi.SSID();
+    response["rssi"] = WiFi.RSSI();
+    response["localIP"] = WiFi.localIP().toString();
+    response["timestamp"] = time(nullptr); // Epoch timestamp
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+static void handleFanCommand(AsyncWebSocketClient* client, JsonDocument& doc) {
+    String cmd = doc["cmd"] | "";
+    
+    // Fan control commands
+    ArenaJsonDocument response(1024);
+    response["cmd"] = cmd;
+    response["timestamp"] = time(nullptr); // Epoch timestamp
+    
+    safePrintln("=== Fan command received: " + cmd + " ===");
+    safePrintln("config.enableFan = " + String(config.enableFan ? "true" : "false"));
+    
+    if (!config.enableFan) {
+        response["success"] = false;
+        response["error"] = "Fan control is DISABLED in configuration";
+        safePrintln("Fan control DISABLED - returning error");
+    } else {
+        String value = "";
+        if (cmd == "fan_speed") {
+            safePrintln("=== Processing fan_speed command ===");
             
-            safePrintln("Calling processFanCommand with cmd=" + cmd + ", value=" + value);
-            if (processFanCommand(cmd, value)) {
-                response["success"] = true;
-                if (cmd == "fan_speed") {
-                    response["speed"] = value.toInt();
-                    response["message"] = "Fan speed set to " + value + "%";
-                } else if (cmd == "fan_on") {
-                    response["message"] = "Fan turned ON at 50% speed";
-                    response["speed"] = 50;
-                } else if (cmd == "fan_off") {
-                    response["message"] = "Fan turned OFF";
-                    response["speed"] = 0;
-                } else if (cmd == "gline_on") {
-                    response["message"] = "GLine router ENABLED";
-                } else if (cmd == "gline_off") {
-                    response["message"] = "GLine router DISABLED";
-                } else if (cmd == "sleep") {
-                    unsigned long delaySec = doc["delay"] | 0;
-                    unsigned long durationSec = doc["duration"] | 0;
-                    response["message"] = "Sleep mode scheduled: " + String(delaySec) + "s delay, " + String(durationSec) + "s duration";
-                    response["delay"] = delaySec;
-                    response["duration"] = durationSec;
-                } else if (cmd == "sleep_stop" || cmd == "wake") {
-                    response["message"] = "Sleep mode stopped";
+            // Debug: print raw JSON
+            String rawJson;
+            serializeJson(doc, rawJson);
+            safePrintln("Raw JSON received: " + rawJson);
+            
+            // Check if value field exists and what type it is
+            if (doc.containsKey("value")) {
+                safePrintln("Value field exists");
+                if (doc["value"].is<int>()) {
+                    safePrintln("Value is integer");
+                } else if (doc["value"].is<const char*>()) {
+                    safePrintln("Value is string");
+                } else if (doc["value"].is<float>()) {
+                    safePrintln("Value is float");
+                } else {
+                    safePrintln("Value is unknown type");
                 }
             } else {
-                response["success"] = false;
-                response["error"] = "Failed to execute fan command: " + cmd;
-            }
-        }
-        
-        String responseStr;
-        serializeJson(response, responseStr);
-        client->text(responseStr);
-        
-    } else if (cmd == "fan_status") {
-        // Fan status command
-        DynamicJsonDocument response(1024);
-        response["cmd"] = "fan_status";
-        response["success"] = true;
-        response["enabled"] = config.enableFan && isFanEnabled();
-        response["dutyCycle"] = config.enableFan ? getFanDutyCycle() : 0;
-        response["rpm"] = config.enableFan ? getFanRPM() : 0;
-        response["glineEnabled"] = config.enableFan && isGLineEnabled();
-        response["pwmValue"] = config.enableFan ? map(getFanDutyCycle(), 0, 100, 0, 255) : 0;
-        response["timestamp"] = time(nullptr); // Epoch timestamp
-        
-        // Add sleep mode information
-        if (config.enableFan) {
-            FanStatus fanStatus = getFanStatus();
-            response["sleepMode"] = fanStatus.sleepMode;
-            response["sleepStartTime"] = fanStatus.sleepStartTime;
-            response["sleepDuration"] = fanStatus.sleepDuration;
-            response["sleepEndTime"] = fanStatus.sleepEndTime;
-        }
-        
-        String responseStr;
-        serializeJson(response, responseStr);
-        client->text(responseStr);
-        
-    } else if (cmd == "setMCP3424Config") {
-        // MCP3424 configuration setting
-        DynamicJsonDocument response(1024);
-        response["cmd"] = "setMCP3424Config";
-        response["timestamp"] = time(nullptr); // Epoch timestamp
-        
-        if (doc.containsKey("devices")) {
-            JsonArray devices = doc["devices"];
-            
-            // Reset all devices to disabled first
-            for (int i = 0; i < 8; i++) {
-                mcp3424Config.devices[i].enabled = false;
-                mcp3424Config.devices[i].autoDetected = false;
-                strcpy(mcp3424Config.devices[i].gasType, "");
-                strcpy(mcp3424Config.devices[i].description, "");
+                safePrintln("Value field does NOT exist");
             }
             
-            mcp3424Config.deviceCount = 0;
+            // Try different parsing methods
+            int receivedValue1 = doc["value"] | 0;  // Original method
+            int receivedValue2 = doc["value"].as<int>();  // Direct cast
+            String valueStr = doc["value"].as<String>();  // As string first
+            int receivedValue3 = valueStr.toInt();  // String to int
             
-            // Only process enabled devices from frontend
-            for (JsonObject device : devices) {
-                if (mcp3424Config.deviceCount < 8) {
-                    int deviceIndex = device["deviceIndex"] | 0;
-                    if (deviceIndex >= 0 && deviceIndex < 8) {
-                        MCP3424DeviceAssignment& newDevice = mcp3424Config.devices[deviceIndex];
-                        newDevice.deviceIndex = deviceIndex;
-                        newDevice.i2cAddress = device["i2cAddress"] | (0x68 + deviceIndex);
-                        strlcpy(newDevice.gasType, device["gasType"] | "", sizeof(newDevice.gasType));
-                        strlcpy(newDevice.description, device["description"] | "", sizeof(newDevice.description));
-                        newDevice.enabled = device["enabled"] | true;
-                        newDevice.autoDetected = device["autoDetected"] | false;
-                        mcp3424Config.deviceCount++;
-                    }
-                }
-            }
+            safePrintln("Method 1 (| 0): " + String(receivedValue1));
+            safePrintln("Method 2 (.as<int>()): " + String(receivedValue2));
+            safePrintln("Method 3 (string->int): " + String(receivedValue3));
+            safePrintln("Value as string: '" + valueStr + "'");
             
-            if (saveMCP3424Config(mcp3424Config)) {
-                response["success"] = true;
-                response["message"] = "MCP3424 configuration saved";
-            } else {
-                response["success"] = false;
-                response["error"] = "Failed to save MCP3424 configuration";
+            value = String(receivedValue1);
+            safePrintln("Fan speed command: received value=" + String(receivedValue1) + ", parsed value=" + value);
+            safePrintln("Original JSON: value field exists=" + String(doc.containsKey("value") ? "true" : "false"));
+        } else if (cmd == "sleep") {
+            unsigned long delaySec = doc["delay"] | 0;
+            unsigned long durationSec = doc["duration"] | 0;
+            value = String(delaySec) + " " + String(durationSec);
+        }
+        
+        safePrintln("Calling processFanCommand with cmd=" + cmd + ", value=" + value);
+        if (processFanCommand(cmd, value)) {
+            response["success"] = true;
+            if (cmd == "fan_speed") {
+                response["speed"] = value.toInt();
+                response["message"] = "Fan speed set to " + value + "%";
+            } else if (cmd == "fan_on") {
+                response["message"] = "Fan turned ON at 50% speed";
+                response["speed"] = 50;
+            } else if (cmd == "fan_off") {
+                response["message"] = "Fan turned OFF";
+                response["speed"] = 0;
+            } else if (cmd == "gline_on") {
+                response["message"] = "GLine router ENABLED";
+            } else if (cmd == "gline_off") {
+                response["message"] = "GLine router DISABLED";
+            } else if (cmd == "sleep") {
+                unsigned long delaySec = doc["delay"] | 0;
+                unsigned long durationSec = doc["duration"] | 0;
+                response["message"] = "Sleep mode scheduled: " + String(delaySec) + "s delay, " + String(durationSec) + "s duration";
+                response["delay"] = delaySec;
+                response["duration"] = durationSec;
+            } else if (cmd == "sleep_stop" || cmd == "wake") {
+                response["message"] = "Sleep mode stopped";
             }
         } else {
             response["success"] = false;
-            response["error"] = "No devices provided";
+            response["error"] = "Failed to execute fan command: " + cmd;
         }
+    }
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+static void handleFanStatus(AsyncWebSocketClient* client, JsonDocument&) {
+    // Fan status command
+    ArenaJsonDocument response(1024);
+    response["cmd"] = "fan_status";
+    response["success"] = true;
+    response["enabled"] = config.enableFan && isFanEnabled();
+    response["dutyCycle"] = config.enableFan ? getFanDutyCycle() : 0;
+    response["rpm"] = config.enableFan ? getFanRPM() : 0;
+    response["glineEnabled"] = config.enableFan && isGLineEnabled();
+    response["pwmValue"] = config.enableFan ? map(getFanDutyCycle(), 0, 100, 0, 255) : 0;
+    response["timestamp"] = time(nullptr); // Epoch timestamp
+    
+    // Add sleep mode information
+    if (config.enableFan) {
+        FanStatus fanStatus = getFanStatus();
+        response["sleepMode"] = fanStatus.sleepMode;
+        response["sleepStartTime"] = fanStatus.sleepStartTime;
+        response["sleepDuration"] = fanStatus.sleepDuration;
+        response["sleepEndTime"] = fanStatus.sleepEndTime;
+    }
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+static void handleSetMCP3424Config(AsyncWebSocketClient* client, JsonDocument& doc) {
+    // MCP3424 configuration setting
+    ArenaJsonDocument response(1024);
+    response["cmd"] = "setMCP3424Config";
+    response["timestamp"] = time(nullptr); // Epoch timestamp
+    
+    if (doc.containsKey("devices")) {
+        JsonArray devices = doc["devices"];
         
-        String responseStr;
-        serializeJson(response, responseStr);
-        client->text(responseStr);
-        
-    } else if (cmd == "resetMCP3424Config") {
-        // MCP3424 configuration reset
-        DynamicJsonDocument response(512);
-        response["cmd"] = "resetMCP3424Config";
-        response["timestamp"] = time(nullptr); // Epoch timestamp
-        
-        initializeDefaultMCP3424Mapping();
-        
-        // Update deviceCount to reflect enabled devices (should be 0 for new defaults)
-        int enabledCount = 0;
+        // Reset all devices to disabled first
         for (int i = 0; i < 8; i++) {
-            if (mcp3424Config.devices[i].enabled) {
-                enabledCount++;
+            mcp3424Config.devices[i].enabled = false;
+            mcp3424Config.devices[i].autoDetected = false;
+            strcpy(mcp3424Config.devices[i].gasType, "");
+            strcpy(mcp3424Config.devices[i].description, "");
+            for (uint8_t ch = 0; ch < 4; ch++) {
+                mcp3424Config.devices[i].resolution[ch] = 18;
+            }
+        }
+        
+        mcp3424Config.deviceCount = 0;
+        
+        // Only process enabled devices from frontend
+        for (JsonObject device : devices) {
+            if (mcp3424Config.deviceCount < 8) {
+                int deviceIndex = device["deviceIndex"] | 0;
+                if (deviceIndex >= 0 && deviceIndex < 8) {
+                    MCP3424DeviceAssignment& newDevice = mcp3424Config.devices[deviceIndex];
+                    newDevice.deviceIndex = deviceIndex;
+                    newDevice.i2cAddress = device["i2cAddress"] | (0x68 + deviceIndex);
+                    strlcpy(newDevice.gasType, device["gasType"] | "", sizeof(newDevice.gasType));
+                    strlcpy(newDevice.description, device["description"] | "", sizeof(newDevice.description));
+                    newDevice.enabled = device["enabled"] | true;
+                    newDevice.autoDetected = device["autoDetected"] | false;
+                    JsonArray resolution = device["resolution"];
+                    for (uint8_t ch = 0; ch < 4 && ch < resolution.size(); ch++) {
+                        newDevice.resolution[ch] = validMCP3424Resolution(resolution[ch] | 18);
+                    }
+                    mcp3424Config.deviceCount++;
+                }
             }
         }
-        mcp3424Config.deviceCount = enabledCount;
         
         if (saveMCP3424Config(mcp3424Config)) {
+            applyMCP3424Resolution();
             response["success"] = true;
-            response["message"] = "MCP3424 configuration reset to defaults (all devices disabled)";
-            safePrintln("MCP3424 config reset: " + String(enabledCount) + " devices enabled");
+            response["message"] = "MCP3424 configuration saved";
         } else {
             response["success"] = false;
-            response["error"] = "Failed to save default MCP3424 configuration";
+            response["error"] = "Failed to save MCP3424 configuration";
         }
-        
-        String responseStr;
-        serializeJson(response, responseStr);
-        client->text(responseStr);
-        
     } else {
-        DynamicJsonDocument errorResponse(1024);
-        errorResponse["error"] = "Unknown command: " + cmd;
+        response["success"] = false;
+        response["error"] = "No devices provided";
+    }
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+static void handleResetMCP3424Config(AsyncWebSocketClient* client, JsonDocument&) {
+    // MCP3424 configuration reset
+    ArenaJsonDocument response(512);
+    response["cmd"] = "resetMCP3424Config";
+    response["timestamp"] = time(nullptr); // Epoch timestamp
+    
+    initializeDefaultMCP3424Mapping();
+    
+    // Update deviceCount to reflect enabled devices (should be 0 for new defaults)
+    int enabledCount = 0;
+    for (int i = 0; i < 8; i++) {
+        if (mcp3424Config.devices[i].enabled) {
+            enabledCount++;
+        }
+    }
+    mcp3424Config.deviceCount = enabledCount;
+    
+    if (saveMCP3424Config(mcp3424Config)) {
+        response["success"] = true;
+        response["message"] = "MCP3424 configuration reset to defaults (all devices disabled)";
+        safePrintln("MCP3424 config reset: " + String(enabledCount) + " devices enabled");
+    } else {
+        response["success"] = false;
+        response["error"] = "Failed to save default MCP3424 configuration";
+    }
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+// ===== Rejestr komend WebSocket =====
+
+// Adapter: istniejące handlery (client, doc) jako CommandHandler rejestru
+template<void (*F)(AsyncWebSocketClient*, JsonDocument&)>
+static void wsCommand(CommandContext& ctx) {
+    F(ctx.client, *ctx.doc);
+}
+
+static void handleCommandStats(AsyncWebSocketClient* client, JsonDocument&) {
+    ArenaJsonDocument response(12288);
+    response["cmd"] = "commandStats";
+    response["count"] = getRegisteredCommandCount();
+    JsonArray commands = response.createNestedArray("commands");
+    getCommandStatsJson(commands);
+    response["success"] = !response.overflowed();
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+// Mapa rejestrów Modbus z tabeli deskryptorów (modbus_map.cpp)
+extern void getModbusMapJson(JsonObject root);
+
+static void handleGetModbusMap(AsyncWebSocketClient* client, JsonDocument&) {
+    ArenaJsonDocument response(24576);
+    response["cmd"] = "getModbusMap";
+    getModbusMapJson(response.as<JsonObject>());
+    response["success"] = !response.overflowed();
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    client->text(responseStr);
+}
+
+// Schematy argumentów (walidowane przed wywołaniem handlera)
+static const CommandArg sensorDataArgs[] = {{"sensor", ARG_STRING, false, 0, 0}};
+static const CommandArg historyArgs[] = {
+    {"sensor", ARG_STRING, true, 0, 0},
+    {"timeRange", ARG_STRING, false, 0, 0},
+    {"sampleType", ARG_STRING, false, 0, 0},
+    {"fromTime", ARG_INT, false, 0, 0},
+    {"toTime", ARG_INT, false, 0, 0},
+    {"packetIndex", ARG_INT, false, -1, 1000},
+    {"packetSize", ARG_INT, false, 1, 50}
+};
+static const CommandArg averagesArgs[] = {
+    {"sensor", ARG_STRING, true, 0, 0},
+    {"type", ARG_STRING, false, 0, 0}
+};
+static const CommandArg subscribeArgs[] = {
+    {"sampleType", ARG_STRING, false, 0, 0},
+    {"interval", ARG_INT, false, 0, 0}
+};
+static const CommandArg liveStreamArgs[] = {
+    {"interval", ARG_INT, false, LIVE_STREAM_MIN_INTERVAL, LIVE_STREAM_MAX_INTERVAL}
+};
+static const CommandArg wifiConfigArgs[] = {
+    {"ssid", ARG_STRING, false, 0, 0},
+    {"password", ARG_STRING, false, 0, 0}
+};
+static const CommandArg networkFlagArgs[] = {{"enabled", ARG_BOOL, false, 0, 0}};
+static const CommandArg networkConfigArgs[] = {
+    {"useDHCP", ARG_BOOL, false, 0, 0},
+    {"staticIP", ARG_STRING, false, 0, 0},
+    {"gateway", ARG_STRING, false, 0, 0},
+    {"subnet", ARG_STRING, false, 0, 0}
+};
+static const CommandArg resetArgs[] = {{"reason", ARG_STRING, false, 0, 0}};
+static const CommandArg fanSpeedArgs[] = {{"value", ARG_INT, true, 0, 100}};
+static const CommandArg sleepArgs[] = {
+    {"delay", ARG_INT, false, 0, 0},
+    {"duration", ARG_INT, false, 0, 0}
+};
+
+static const CommandDef webSocketCommands[] = {
+    {"status", CMD_SRC_WEBSOCKET, wsCommand<handleGetStatus>, COMMAND_NO_ARGS, false, 0},
+    {"getSensorData", CMD_SRC_WEBSOCKET, wsCommand<handleGetSensorData>, COMMAND_ARGS(sensorDataArgs), false, 0},
+    {"getHistory", CMD_SRC_WEBSOCKET, wsCommand<handleGetHistory>, COMMAND_ARGS(historyArgs), false, 0},
+    {"getHistoryInfo", CMD_SRC_WEBSOCKET, wsCommand<handleGetHistoryInfo>, COMMAND_NO_ARGS, false, 0},
+    {"getAverages", CMD_SRC_WEBSOCKET, wsCommand<handleGetAverages>, COMMAND_ARGS(averagesArgs), false, 0},
+    {"setConfig", CMD_SRC_WEBSOCKET, wsCommand<handleSetConfig>, COMMAND_NO_ARGS, false, 0},
+    {"getConfig", CMD_SRC_WEBSOCKET, wsCommand<handleGetConfig>, COMMAND_NO_ARGS, false, 0},
+    {"subscribe", CMD_SRC_WEBSOCKET, wsCommand<handleSubscribe>, COMMAND_ARGS(subscribeArgs), false, 0},
+    {"unsubscribe", CMD_SRC_WEBSOCKET, wsCommand<handleUnsubscribe>, COMMAND_NO_ARGS, false, 0},
+    {"liveStream", CMD_SRC_WEBSOCKET, wsCommand<handleLiveStream>, COMMAND_ARGS(liveStreamArgs), false, 0},
+    {"liveStreamStop", CMD_SRC_WEBSOCKET, wsCommand<handleLiveStreamStop>, COMMAND_NO_ARGS, false, 0},
+    {"pingpong", CMD_SRC_WEBSOCKET, wsCommand<handlePingPong>, COMMAND_NO_ARGS, false, 0},
+    {"getNetworkConfig", CMD_SRC_WEBSOCKET, wsCommand<handleGetNetworkConfig>, COMMAND_NO_ARGS, false, 0},
+    {"setWiFiConfig", CMD_SRC_WEBSOCKET, wsCommand<handleSetWiFiConfig>, COMMAND_ARGS(wifiConfigArgs), false, 0},
+    {"setNetworkFlag", CMD_SRC_WEBSOCKET, wsCommand<handleSetNetworkFlag>, COMMAND_ARGS(networkFlagArgs), false, 0},
+    {"setNetworkConfig", CMD_SRC_WEBSOCKET, wsCommand<handleSetNetworkConfig>, COMMAND_ARGS(networkConfigArgs), false, 0},
+    {"testWiFi", CMD_SRC_WEBSOCKET, wsCommand<handleTestWiFi>, COMMAND_NO_ARGS, false, 0},
+    {"applyNetworkConfig", CMD_SRC_WEBSOCKET, wsCommand<handleApplyNetworkConfig>, COMMAND_NO_ARGS, false, 0},
+    {"resetNetworkConfig", CMD_SRC_WEBSOCKET, wsCommand<handleResetNetworkConfig>, COMMAND_NO_ARGS, false, 0},
+    {"getSensorKeys", CMD_SRC_WEBSOCKET, wsCommand<handleGetSensorKeys>, COMMAND_NO_ARGS, false, 0},
+    {"getMCP3424Config", CMD_SRC_WEBSOCKET, wsCommand<handleGetMCP3424Config>, COMMAND_NO_ARGS, false, 0},
+    {"scanI2CAddresses", CMD_SRC_WEBSOCKET, wsCommand<handleScanI2CAddresses>, COMMAND_NO_ARGS, false, 0},
+    {"getWebSocketStatus", CMD_SRC_WEBSOCKET, wsCommand<handleGetWebSocketStatus>, COMMAND_NO_ARGS, false, 0},
+    {"forceWebSocketReset", CMD_SRC_WEBSOCKET, wsCommand<handleForceWebSocketReset>, COMMAND_ARGS(resetArgs), false, 0},
+    {"restart", CMD_SRC_WEBSOCKET, wsCommand<handleRestart>, COMMAND_NO_ARGS, false, 0},
+    {"reset", CMD_SRC_WEBSOCKET, wsCommand<handleRestart>, COMMAND_NO_ARGS, false, 0},
+    {"memory", CMD_SRC_WEBSOCKET, wsCommand<handleMemory>, COMMAND_NO_ARGS, false, 0},
+    {"lowPowerOn", CMD_SRC_WEBSOCKET, wsCommand<handleLowPower>, COMMAND_NO_ARGS, false, 0},
+    {"lowPowerOff", CMD_SRC_WEBSOCKET, wsCommand<handleLowPower>, COMMAND_NO_ARGS, false, 0},
+    {"pushbulletTest", CMD_SRC_WEBSOCKET, wsCommand<handlePushbulletTest>, COMMAND_NO_ARGS, false, 0},
+    {"pushbulletBatteryTest", CMD_SRC_WEBSOCKET, wsCommand<handlePushbulletBatteryTest>, COMMAND_NO_ARGS, false, 0},
+    {"wifi", CMD_SRC_WEBSOCKET, wsCommand<handleWiFiStatus>, COMMAND_NO_ARGS, false, 0},
+    {"fan_speed", CMD_SRC_WEBSOCKET, wsCommand<handleFanCommand>, COMMAND_ARGS(fanSpeedArgs), false, 0},
+    {"fan_on", CMD_SRC_WEBSOCKET, wsCommand<handleFanCommand>, COMMAND_NO_ARGS, false, 0},
+    {"fan_off", CMD_SRC_WEBSOCKET, wsCommand<handleFanCommand>, COMMAND_NO_ARGS, false, 0},
+    {"gline_on", CMD_SRC_WEBSOCKET, wsCommand<handleFanCommand>, COMMAND_NO_ARGS, false, 0},
+    {"gline_off", CMD_SRC_WEBSOCKET, wsCommand<handleFanCommand>, COMMAND_NO_ARGS, false, 0},
+    {"sleep", CMD_SRC_WEBSOCKET, wsCommand<handleFanCommand>, COMMAND_ARGS(sleepArgs), false, 0},
+    {"sleep_stop", CMD_SRC_WEBSOCKET, wsCommand<handleFanCommand>, COMMAND_NO_ARGS, false, 0},
+    {"wake", CMD_SRC_WEBSOCKET, wsCommand<handleFanCommand>, COMMAND_NO_ARGS, false, 0},
+    {"fan_status", CMD_SRC_WEBSOCKET, wsCommand<handleFanStatus>, COMMAND_NO_ARGS, false, 0},
+    {"setMCP3424Config", CMD_SRC_WEBSOCKET, wsCommand<handleSetMCP3424Config>, COMMAND_NO_ARGS, false, 0},
+    {"resetMCP3424Config", CMD_SRC_WEBSOCKET, wsCommand<handleResetMCP3424Config>, COMMAND_NO_ARGS, false, 0},
+    {"commandStats", CMD_SRC_WEBSOCKET, wsCommand<handleCommandStats>, COMMAND_NO_ARGS, false, 0},
+    {"getModbusMap", CMD_SRC_WEBSOCKET, wsCommand<handleGetModbusMap>, COMMAND_NO_ARGS, false, 0},
+};
+
+// Rejestr bez blokad - rejestracja raz przy starcie (initializeWebSocket), przed pierwszą wiadomością
+static void registerWebSocketCommands() {
+    registerCommands(webSocketCommands, sizeof(webSocketCommands) / sizeof(webSocketCommands[0]));
+}
+
+// Handler komunikatów WebSocket w kontekście task
+void handleWebSocketMessageInTask(AsyncWebSocketClient* client, JsonDocument& doc) {
+    safePrintln("WebSocket Task: Processing command in dedicated task context");
+    
+    // Sprawdź komendę
+    const char* cmd = doc["cmd"] | "";
+    String error;
+    CommandResult result = dispatchWebSocketCommand(cmd, client, doc, error);
+    
+    if (result == CMD_BAD_ARGS) {
+        ArenaJsonDocument errorResponse(512);
+        errorResponse["cmd"] = cmd;
+        errorResponse["success"] = false;
+        errorResponse["error"] = error;
+        String errorStr;
+        serializeJson(errorResponse, errorStr);
+        client->text(errorStr);
+    } else if (result != CMD_OK) {
+        ArenaJsonDocument errorResponse(1024);
+        errorResponse["error"] = "Unknown command: " + String(cmd);
         String errorStr;
         serializeJson(errorResponse, errorStr);
         client->text(errorStr);
@@ -2557,42 +3762,74 @@ void handleWebSocketMessageInTask(AsyncWebSocketClient* client, DynamicJsonDocum
     }
 }
 
-// Funkcja do wysyłania komunikatu do WebSocket task
-bool sendToWebSocketTask(AsyncWebSocketClient* client, const String& message) {
-    if (!webSocketQueue || !client) {
+// Funkcja do wysyłania komunikatu do WebSocket task - kopiuje ramkę do wolnego slotu
+bool sendToWebSocketTask(AsyncWebSocketClient* client, const uint8_t* data, size_t len) {
+    if (!webSocketQueue || !webSocketFreeSlots || !webSocketSlots || !client) {
         safePrintln("WebSocket Task: Queue or client is null");
         return false;
     }
     
-    // Sprawdź czy kolejka nie jest pełna
-    if (uxQueueSpacesAvailable(webSocketQueue) == 0) {
-        safePrintln("WebSocket Task: Queue is full, dropping message");
+    if (len >= WEBSOCKET_SLOT_SIZE) {
+        webSocketSlotsOversize++;
         return false;
     }
     
-    // Utwórz komunikat
-    WebSocketMessage msg;
-    msg.client = client;
-    msg.message = message;
-    msg.timestamp = millis();
+    // Pobierz wolny slot (bez czekania - jesteśmy w kontekście async_tcp)
+    uint8_t slotIndex;
+    if (xQueueReceive(webSocketFreeSlots, &slotIndex, 0) != pdTRUE) {
+        webSocketSlotsRejected++;
+        safePrintln("WebSocket Task: No free slot, dropping message");
+        return false;
+    }
+    
+    WebSocketMessageSlot& slot = webSocketSlots[slotIndex];
+    slot.client = client;
+    slot.clientId = client->id();
+    slot.timestamp = millis();
+    slot.length = len;
+    memcpy(slot.data, data, len);
+    slot.data[len] = '\0';
+    if (len > webSocketSlotMaxLength) webSocketSlotMaxLength = len;
     
-    // Wyślij do kolejki
-    if (xQueueSend(webSocketQueue, &msg, pdMS_TO_TICKS(100)) == pdTRUE) {
+    // Wyślij indeks do kolejki
+    if (xQueueSend(webSocketQueue, &slotIndex, 0) == pdTRUE) {
         return true;
     } else {
         safePrintln("WebSocket Task: Failed to send message to queue");
+        releaseWebSocketSlot(slotIndex);
         return false;
     }
 }
 
 // Inicjalizacja WebSocket task system
 bool initializeWebSocketTask() {
-    // Utwórz kolejkę
-    webSocketQueue = xQueueCreate(WEBSOCKET_QUEUE_SIZE, sizeof(WebSocketMessage));
-    if (!webSocketQueue) {
+    // Prealokuj sloty komunikatów (PSRAM jeśli dostępny)
+    size_t slotsBytes = sizeof(WebSocketMessageSlot) * WEBSOCKET_QUEUE_SIZE;
+    webSocketSlots = (WebSocketMessageSlot*)heap_caps_malloc(slotsBytes, MALLOC_CAP_SPIRAM);
+    if (!webSocketSlots) {
+        webSocketSlots = (WebSocketMessageSlot*)malloc(slotsBytes);
+    }
+    if (!webSocketSlots) {
+        safePrintln("WebSocket Task: Failed to allocate message slots");
+        return false;
+    }
+    
+    // Utwórz kolejki indeksów: gotowe do przetworzenia i wolne
+    webSocketQueue = xQueueCreate(WEBSOCKET_QUEUE_SIZE, sizeof(uint8_t));
+    webSocketFreeSlots = xQueueCreate(WEBSOCKET_QUEUE_SIZE, sizeof(uint8_t));
+    if (!webSocketQueue || !webSocketFreeSlots) {
         safePrintln("WebSocket Task: Failed to create queue");
+        if (webSocketQueue) vQueueDelete(webSocketQueue);
+        if (webSocketFreeSlots) vQueueDelete(webSocketFreeSlots);
+        webSocketQueue = NULL;
+        webSocketFreeSlots = NULL;
+        free(webSocketSlots);
+        webSocketSlots = NULL;
         return false;
     }
+    for (uint8_t i = 0; i < WEBSOCKET_QUEUE_SIZE; i++) {
+        xQueueSend(webSocketFreeSlots, &i, 0);
+    }
     
     // Utwórz semaphore
     webSocketSemaphore = xSemaphoreCreateMutex();
@@ -2621,7 +3858,7 @@ bool initializeWebSocketTask() {
     }
     
     safePrintln("WebSocket Task system initialized successfully");
-    safePrintln("- Queue size: " + String(WEBSOCKET_QUEUE_SIZE));
+    safePrintln("- Queue size: " + String(WEBSOCKET_QUEUE_SIZE) + " slots x " + String(WEBSOCKET_SLOT_SIZE) + " bytes");
     safePrintln("- Stack size: " + String(WEBSOCKET_STACK_SIZE) + " bytes");
     safePrintln("- Priority: " + String(WEBSOCKET_PRIORITY));
     safePrintln("- CPU Core: " + String(WEBSOCKET_CORE));
@@ -2641,6 +3878,16 @@ void stopWebSocketTask() {
         webSocketQueue = NULL;
     }
     
+    if (webSocketFreeSlots) {
+        vQueueDelete(webSocketFreeSlots);
+        webSocketFreeSlots = NULL;
+    }
+    
+    if (webSocketSlots) {
+        free(webSocketSlots);
+        webSocketSlots = NULL;
+    }
+    
     if (webSocketSemaphore) {
         vSemaphoreDelete(webSocketSemaphore);
         webSocketSemaphore = NULL;
@@ -2716,17 +3963,21 @@ void resetWebSocket() {
     ws.cleanupClients();
     
     // Wyczyść dane klientów
+    portENTER_CRITICAL(&wsClientsLock);
     wsClientCount = 0;
     memset(wsClients, 0, sizeof(wsClients));
+    portEXIT_CRITICAL(&wsClientsLock);
+    clearWebSocketSubscriptions();
     
     // Krótkie opóźnienie dla stabilizacji
     delay(100);
     
     // Wyczyść kolejkę WebSocket task
     if (webSocketQueue) {
-        WebSocketMessage msg;
-        while (xQueueReceive(webSocketQueue, &msg, 0) == pdTRUE) {
-            // Usuń wszystkie oczekujące komunikaty
+        uint8_t slotIndex;
+        while (xQueueReceive(webSocketQueue, &slotIndex, 0) == pdTRUE) {
+            // Usuń wszystkie oczekujące komunikaty - sloty wracają do puli
+            releaseWebSocketSlot(slotIndex);
         }
     }
     
@@ -2758,9 +4009,28 @@ String getWebSocketStatus() {
     status += "- Time since activity: " + String(timeSinceActivity / 1000) + " seconds\n";
     status += "- Reset count: " + String(webSocketResetCount) + "\n";
     status += "- Reset pending: " + String(webSocketResetPending ? "YES" : "NO") + "\n";
+    status += "- Subscriptions: " + String(getWebSocketSubscriptionCount()) + 
+              " (payloads built: " + String(subscriptionPayloadsBuilt) + 
+              ", messages sent: " + String(subscriptionMessagesSent) + ")\n";
+    
+    status += getBroadcastPoolStatus();
+    status += getHistoryStreamStatus();
+    status += getJsonArenaStatus();
+    status += getResponseCacheStatus();
+    status += getWebAssetStatus();
+    status += getMetricsStatus();
+    status += getTelemetryStatus();
+    status += getEventStreamStatus();
+    status += getHistoryExportStatus();
+    status += getModbusStatus();
+    status += getLiveStreamStatus();
+    status += getSchedulerStatus();
+    status += getI2CBusStatus();
     
     if (webSocketQueue) {
         status += "- Queue messages: " + String(uxQueueMessagesWaiting(webSocketQueue)) + "/" + String(WEBSOCKET_QUEUE_SIZE) + "\n";
+        status += "- Message slots: max " + String(webSocketSlotMaxLength) + "/" + String(WEBSOCKET_SLOT_SIZE) + 
+                  " bytes, rejected " + String(webSocketSlotsRejected) + ", oversize " + String(webSocketSlotsOversize) + "\n";
     }
     
     if (webSocketTaskHandle) {
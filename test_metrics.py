@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+"""
+Test endpointu /metrics (OpenMetrics) dla ESP Sensor Cube
+Użycie: python test_metrics.py IP_ADDRESS [--count N]
+        python test_metrics.py --file metrics.txt
+        python test_metrics.py --host-binary ./metrics_host
+Z --host-binary renderuje metryki hostowo (host/metrics_host.cpp) - ten sam src/metrics.cpp co na
+ESP32 ze stałymi danymi czujników, więc nadaje się do regresji formatu w CI.
+Wymaga: pip install prometheus_client
+"""
+
+import argparse
+import math
+import subprocess
+import sys
+import time
+import urllib.request
+
+try:
+    from prometheus_client.openmetrics.parser import text_string_to_metric_families
+except ImportError:
+    print("❌ Brak prometheus_client (pip install prometheus_client)")
+    sys.exit(1)
+
+CONTENT_TYPE = "application/openmetrics-text"
+
+# Rodziny, które muszą być zawsze obecne
+REQUIRED_FAMILIES = [
+    "espsensor_uptime_seconds",
+    "espsensor_loop_iterations",
+    "espsensor_loop_duration_seconds",
+    "espsensor_scheduler_sleep_seconds",
+    "espsensor_scheduler_job_runs",
+    "espsensor_heap_free_bytes",
+    "espsensor_task_stack_free_bytes",
+    "espsensor_metrics_render_seconds",
+]
+
+
+def fetch(ip_address, timeout=5):
+    url = f"http://{ip_address}/metrics"
+    start = time.time()
+    with urllib.request.urlopen(url, timeout=timeout) as response:
+        content_type = response.headers.get("Content-Type", "")
+        body = response.read().decode("utf-8")
+    elapsed = (time.time() - start) * 1000
+    if not content_type.startswith(CONTENT_TYPE):
+        raise ValueError(f"Nieoczekiwany Content-Type: {content_type}")
+    return body, elapsed
+
+
+def render_host(binary, scrapes=2):
+    """Wyjście renderMetrics() z buildu hostowego; kilka renderów - bufor zwalniany między scrape'ami"""
+    result = subprocess.run([binary, "--scrapes", str(scrapes)], stdout=subprocess.PIPE,
+                            stderr=subprocess.PIPE, timeout=10)
+    if result.returncode != 0:
+        raise ValueError(f"{binary} zakończył się kodem {result.returncode}: {result.stderr.decode().strip()}")
+    return result.stdout.decode("utf-8")
+
+
+def validate(text):
+    """Parsowanie parserem OpenMetrics - wyjątek przy błędzie formatu"""
+    # Ekspozycja OpenMetrics musi kończyć się dokładnie jednym "# EOF"
+    if not text.endswith("# EOF\n"):
+        raise ValueError("Brak końcowego '# EOF'")
+    if text.count("# EOF") != 1:
+        raise ValueError("'# EOF' nie tylko na końcu")
+    families = {f.name: f for f in text_string_to_metric_families(text)}
+
+    missing = [name for name in REQUIRED_FAMILIES if name not in families]
+    if missing:
+        raise ValueError(f"Brak rodzin: {', '.join(missing)}")
+
+    sensors = families.get("espsensor_sensor_up")
+    active = []
+    if sensors:
+        active = [s.labels["sensor"] for s in sensors.samples if s.value == 1]
+
+    samples = sum(len(f.samples) for f in families.values())
+    return families, samples, active
+
+
+def sample_values(families, name, **labels):
+    family = families.get(name)
+    if not family:
+        return []
+    return [s.value for s in family.samples
+            if all(s.labels.get(key) == value for key, value in labels.items())]
+
+
+def check_host(families):
+    """Oczekiwane próbki dla stałych danych z host/metrics_host.cpp"""
+    errors = []
+
+    def expect(condition, message):
+        if not condition:
+            errors.append(message)
+
+    value = "espsensor_sensor_value"
+    expect(sample_values(families, value, sensor="i2c", field="co2") == [612],
+           "i2c co2 != 612")
+    expect(sample_values(families, value, sensor="solar", field="V") == [13250],
+           "solar V (tekst VE.Direct) != 13250")
+    expect(not sample_values(families, value, sensor="solar", field="PPV"),
+           "pusty tekst solar PPV nie powinien dać próbki")
+    pm10 = sample_values(families, value, sensor="sps30", field="PM10")
+    expect(len(pm10) == 1 and math.isnan(pm10[0]), "sps30 PM10 powinno być NaN")
+    expect(sample_values(families, value, sensor="calibration", field="O3") == [math.inf],
+           "calibration O3 powinno być +Inf")
+    # Płytka 0x69 nieważna - tylko kanały K1
+    expect(sample_values(families, value, sensor="mcp3424", field="K1_1") != [],
+           "brak mcp3424 K1_1")
+    expect(not sample_values(families, value, sensor="mcp3424", field="K2_1"),
+           "kanały nieważnej płytki MCP3424 (K2) w metrykach")
+    expect(not sample_values(families, value, sensor="hcho"), "hcho wyłączony, a ma próbki")
+    expect(sample_values(families, "espsensor_sensor_average", sensor="sps30", field="PM25", window="slow") == [7.0],
+           "średnia slow sps30 PM25 != 7")
+    expect(sample_values(families, "espsensor_sensor_up", sensor="hcho") == [0], "hcho up != 0")
+
+    expect(sample_values(families, "espsensor_task_stack_free_bytes", task="loopTask") == [8192],
+           "stos loopTask != 8192")
+    expect(sample_values(families, "espsensor_scheduler_job_runs", job="modbus") == [60000],
+           "scheduler modbus runs != 60000")
+    expect(sample_values(families, "espsensor_i2c_device_errors", device="0x62") == [3],
+           "i2c 0x62 errors != 3")
+    expect(sample_values(families, "espsensor_mcp3424_conversion_failures", device="0x69") == [3],
+           "mcp3424 0x69 failures != 3")
+    expect(sample_values(families, "espsensor_modbus_shadow_active_banks", type="current") == [3],
+           "shadow current banks != 3")
+    expect(not sample_values(families, "espsensor_modbus_shadow_active_banks", type="slow"),
+           "shadow slow nieprzydzielony, a ma próbkę")
+    expect(sample_values(families, "espsensor_modbus_response_latency_seconds", quantile="0.99") == [0.00125],
+           "p99 != 1.25 ms")
+    expect(sample_values(families, "espsensor_loop_iterations") == [100], "loop iterations != 100")
+
+    if errors:
+        raise ValueError("; ".join(errors))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="ESP32 /metrics tester")
+    parser.add_argument("ip", nargs="?", help="Adres IP urządzenia")
+    parser.add_argument("--file", help="Walidacja zapisanego pliku zamiast pobierania")
+    parser.add_argument("--host-binary", help="Render hostowy (metrics_host) zamiast pobierania")
+    parser.add_argument("--count", type=int, default=1, help="Liczba kolejnych scrape'ów")
+    args = parser.parse_args()
+
+    if not args.ip and not args.file and not args.host_binary:
+        parser.error("Podaj IP, --file albo --host-binary")
+
+    ok = True
+    for i in range(args.count if args.ip else 1):
+        try:
+            if args.host_binary:
+                text, elapsed = render_host(args.host_binary), 0.0
+            elif args.file:
+                with open(args.file, "r", encoding="utf-8") as f:
+                    text, elapsed = f.read(), 0.0
+            else:
+                text, elapsed = fetch(args.ip)
+            families, samples, active = validate(text)
+            if args.host_binary:
+                check_host(families)
+            print(f"✅ #{i + 1}: {len(text)} B, {len(families)} rodzin, {samples} próbek, "
+                  f"{elapsed:.0f} ms, czujniki: {', '.join(active) or '-'}")
+        except Exception as e:
+            print(f"❌ #{i + 1}: {e}")
+            ok = False
+        if args.count > 1:
+            time.sleep(1)
+
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == "__main__":
+    main()
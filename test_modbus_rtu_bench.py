@@ -0,0 +1,345 @@
+#!/usr/bin/env python3
+"""
+Benchmark Modbus RTU ESP Sensor Cube - opóźnienie, maksymalna częstotliwość odpytywania, odporność na szum
+Użycie: python test_modbus_rtu_bench.py --host-binary ./modbus_rtu_host [--max-p99-ms 5 --min-rate 200]
+        python test_modbus_rtu_bench.py --port /dev/ttyUSB0 [--baud 38400]        (urządzenie przez RS485)
+Z --host-binary uruchamia slave hostowy (host/modbus_rtu_host.cpp) na pseudoterminalu - ten sam kod
+modbus_handler.cpp co na ESP32, więc wynik nadaje się do regresji w CI. Kod wyjścia 1 = błąd lub próg przekroczony.
+Tylko biblioteka standardowa (termios) - Linux/macOS.
+"""
+
+import argparse
+import os
+import random
+import select
+import signal
+import struct
+import subprocess
+import sys
+import termios
+import time
+import tty
+
+SLAVE_ID = 30                # MODBUS_SLAVE_ID
+DIAG_BASE = 700              # MODBUS_DIAG_BASE_REG
+TOTAL_REGISTERS = 732        # MODBUS_REG_TOTAL (modbus_map.h)
+SHADOW_BASE = 1000           # MODBUS_SHADOW_BASE - bank cienia "dane aktualne"
+MAX_READ = 125
+MAX_ADU = 256                # MODBUS_RTU_MAX_ADU
+
+BAUD_CONSTANTS = {9600: termios.B9600, 19200: termios.B19200, 38400: termios.B38400,
+                  57600: termios.B57600, 115200: termios.B115200}
+
+
+class ModbusRtuError(Exception):
+    pass
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+    return struct.pack("<H", crc)
+
+
+def rtu_frame(slave, pdu):
+    adu = bytes([slave]) + pdu
+    return adu + crc16(adu)
+
+
+def read_pdu(start, count):
+    return struct.pack(">BHH", 0x03, start, count)
+
+
+class RawModbusRtu:
+    """Master Modbus RTU na deskryptorze terminala (pty lub port szeregowy) - bez pyserial"""
+
+    def __init__(self, path, baud, timeout=1.0):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+        attrs = termios.tcgetattr(self.fd)
+        speed = BAUD_CONSTANTS.get(baud, termios.B38400)
+        attrs[4] = attrs[5] = speed
+        termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+        termios.tcflush(self.fd, termios.TCIOFLUSH)
+        self.timeout = timeout
+        # t3.5 między ramkami (min. 1.75 ms powyżej 19200 bod) - na pty bez znaczenia, na RS485 wymagane
+        self.gap = max(3.5 * 11 / baud, 0.00175)
+        self.last_activity = 0.0
+        self.last_latency = 0.0      # od wysłania żądania do ostatniego bajtu odpowiedzi [s]
+
+    def close(self):
+        os.close(self.fd)
+
+    def send(self, data):
+        # Cisza t3.5 po poprzedniej ramce - inaczej slave skleja ramki w jedną
+        wait = self.last_activity + self.gap - time.perf_counter()
+        if wait > 0:
+            time.sleep(wait)
+        os.write(self.fd, data)
+        self.last_activity = time.perf_counter()
+
+    def receive(self, length, timeout):
+        """Do length bajtów; mniej, gdy minie timeout"""
+        data = b""
+        deadline = time.perf_counter() + timeout
+        while len(data) < length:
+            remaining = deadline - time.perf_counter()
+            if remaining <= 0:
+                break
+            ready, _, _ = select.select([self.fd], [], [], remaining)
+            if not ready:
+                break
+            data += os.read(self.fd, length - len(data))
+            self.last_activity = time.perf_counter()
+        return data
+
+    def drain(self, quiet):
+        """Odbiera do ciszy na linii - bajty, które nie powinny przyjść (odpowiedź na szum)"""
+        return self.receive(MAX_ADU, quiet)
+
+    def request(self, pdu, expected_length):
+        """Ramka -> odpowiedź (PDU bez adresu i CRC); expected_length = długość PDU poprawnej odpowiedzi"""
+        self.send(rtu_frame(SLAVE_ID, pdu))
+        sent = self.last_activity
+        head = self.receive(3, self.timeout)
+        if len(head) < 3:
+            raise ModbusRtuError(f"Brak odpowiedzi (odebrano {len(head)} B)")
+        # Wyjątek: adres, funkcja | 0x80, kod, CRC
+        total = 5 if head[1] & 0x80 else 1 + expected_length + 2
+        adu = head + self.receive(total - 3, self.timeout)
+        if len(adu) < total:
+            raise ModbusRtuError(f"Niepełna odpowiedź ({len(adu)}/{total} B)")
+        if crc16(adu[:-2]) != adu[-2:]:
+            raise ModbusRtuError("Zły CRC odpowiedzi")
+        if adu[0] != SLAVE_ID:
+            raise ModbusRtuError(f"Odpowiedź od slave {adu[0]}")
+        self.last_latency = self.last_activity - sent
+        return adu[1:-2]
+
+    def read(self, start, count):
+        pdu = self.request(read_pdu(start, count), 2 + 2 * count)
+        if pdu[0] & 0x80:
+            raise ModbusRtuError(f"Wyjątek {pdu[1]:#04x}")
+        return list(struct.unpack(f">{count}H", pdu[2:2 + 2 * count]))
+
+
+def percentiles(times):
+    ordered = sorted(times)
+
+    def rank(permille):
+        # nearest-rank jak percentile() w modbus_handler.cpp
+        index = (len(ordered) * permille + 999) // 1000
+        return ordered[max(index - 1, 0)]
+
+    return {"p50": rank(500), "p90": rank(900), "p99": rank(990), "max": ordered[-1]}
+
+
+def format_percentiles(values, unit="ms"):
+    return ", ".join(f"{name} {value:.3f} {unit}" for name, value in values.items())
+
+
+class HostSlave:
+    """Slave hostowy na pty; pierwsza linia stdout = ścieżka, przy zakończeniu linia STATS"""
+
+    def __init__(self, binary, loop_ms):
+        self.process = subprocess.Popen([binary, "--loop-ms", str(loop_ms)], stdout=subprocess.PIPE,
+                                        stderr=subprocess.DEVNULL, text=True)
+        line = self.process.stdout.readline().split()
+        if len(line) != 2 or line[0] != "PTY":
+            self.process.kill()
+            raise ModbusRtuError(f"Slave hostowy nie podał pty: {line}")
+        self.path = line[1]
+        time.sleep(0.2)              # task RTU i pierwsze banki
+
+    def stop(self):
+        """Liczniki z linii STATS, np. {'crc_errors': 3, ...}; reszta wyjścia = getModbusStatus()"""
+        self.process.send_signal(signal.SIGTERM)
+        output, _ = self.process.communicate(timeout=5)
+        stats = {}
+        for line in output.splitlines():
+            if line.startswith("STATS "):
+                stats = {key: int(value) for key, value in (item.split("=") for item in line.split()[1:])}
+        return stats, output
+
+
+class Benchmark:
+    def __init__(self, args, client):
+        self.args = args
+        self.client = client
+        self.failures = 0
+        self.injected_crc = 0
+        self.injected_frame = 0
+
+    def check(self, condition, message):
+        print(f"{'✅' if condition else '❌'} {message}")
+        if not condition:
+            self.failures += 1
+
+    def timed_reads(self, start, count, rounds):
+        times = []
+        for _ in range(rounds):
+            self.client.read(start, count)
+            times.append(self.client.last_latency * 1000)
+        return times
+
+    def test_latency(self):
+        print(f"\n⏱  Opóźnienie od wysłania żądania do końca odpowiedzi ({self.args.rounds} żądań na rozmiar)")
+        worst_p99 = 0.0
+        for start, count, name in [(0, 10, "10 rejestrów"), (0, MAX_READ, "125 rejestrów"),
+                                   (DIAG_BASE, 16, "blok diagnostyczny"),
+                                   (SHADOW_BASE + 200, 50, "bank cienia MCP3424")]:
+            values = percentiles(self.timed_reads(start, count, self.args.rounds))
+            worst_p99 = max(worst_p99, values["p99"])
+            print(f"   {name:22} {format_percentiles(values)}")
+        if self.args.max_p99_ms is not None:
+            self.check(worst_p99 <= self.args.max_p99_ms,
+                       f"p99 {worst_p99:.3f} ms <= {self.args.max_p99_ms} ms")
+        return worst_p99
+
+    def test_poll_rate(self):
+        count = 0
+        deadline = time.perf_counter() + self.args.duration
+        begin = time.perf_counter()
+        while time.perf_counter() < deadline:
+            self.client.read(0, 10)
+            count += 1
+        rate = count / (time.perf_counter() - begin)
+        message = f"Maksymalne odpytywanie: {rate:.0f} żądań/s ({count} w {self.args.duration:.1f} s, 10 rejestrów)"
+        if self.args.min_rate is not None:
+            self.check(rate >= self.args.min_rate, f"{message} >= {self.args.min_rate}")
+        else:
+            print(f"ℹ️  {message}")
+
+    def expect_silence_then_reply(self, frame, name):
+        """Po ramce śmieciowej: brak odpowiedzi, następne poprawne żądanie obsłużone"""
+        self.client.send(frame)
+        stray = self.client.drain(self.args.silence_ms / 1000)
+        try:
+            recovered = len(self.client.read(0, 4)) == 4
+        except ModbusRtuError:
+            recovered = False
+        self.check(not stray and recovered,
+                   f"{name}: {'brak odpowiedzi' if not stray else f'{len(stray)} B odpowiedzi'}, "
+                   f"{'następna ramka OK' if recovered else 'następna ramka bez odpowiedzi'}")
+
+    def test_noise(self):
+        print("\n📡 Szum i uszkodzone ramki")
+        rng = random.Random(self.args.seed)
+        valid = rtu_frame(SLAVE_ID, read_pdu(0, 10))
+
+        corrupted = bytearray(valid)
+        corrupted[-1] ^= 0x55
+        self.expect_silence_then_reply(bytes(corrupted), "Zły CRC")
+        self.injected_crc += 1
+
+        flipped = bytearray(valid)
+        flipped[3] ^= 0x04                       # przekłamany bit w adresie rejestru
+        self.expect_silence_then_reply(bytes(flipped), "Przekłamany bit")
+        self.injected_crc += 1
+
+        self.expect_silence_then_reply(rtu_frame(SLAVE_ID + 1, read_pdu(0, 10)), "Inny adres slave")
+        self.expect_silence_then_reply(bytes(rng.randrange(256) for _ in range(MAX_ADU + 40)),
+                                       "Seria szumu dłuższa niż ramka")
+        self.injected_frame += 1
+        self.expect_silence_then_reply(b"\x00", "Pojedynczy bajt")
+        self.injected_frame += 1
+
+        # Mieszany ruch: co N-ta ramka uszkodzona, każda poprawna musi dostać dokładnie swoją odpowiedź
+        answered = 0
+        wrong = 0
+        rounds = self.args.rounds
+        for i in range(rounds):
+            if i % self.args.noise_every == 0:
+                frame = bytearray(rtu_frame(SLAVE_ID, read_pdu(0, 10)))
+                frame[rng.randrange(len(frame))] ^= 1 << rng.randrange(8)
+                self.client.send(bytes(frame))
+                self.injected_crc += 1
+                if self.client.drain(self.args.silence_ms / 1000):
+                    wrong += 1
+                continue
+            start = rng.randrange(0, TOTAL_REGISTERS - 10)
+            try:
+                if len(self.client.read(start, 10)) == 10:
+                    answered += 1
+            except ModbusRtuError:
+                wrong += 1
+        valid_frames = rounds - len(range(0, rounds, self.args.noise_every))
+        self.check(answered == valid_frames and wrong == 0,
+                   f"Ruch z szumem: {answered}/{valid_frames} poprawnych odpowiedzi, {wrong} błędnych")
+
+    def test_device_latency(self):
+        """Percentyle liczone przez firmware (700-713), odświeżane co MODBUS_DIAG_INTERVAL"""
+        time.sleep(1.2)
+        regs = self.client.read(DIAG_BASE, 14)
+
+        def u32(offset):
+            return regs[offset] | (regs[offset + 1] << 16)
+
+        print(f"ℹ️  Firmware ({'task zdarzeniowy' if regs[0] else 'polling z loop()'}, {regs[1]} ramek w oknie): "
+              f"p50 {u32(4)} µs, p90 {u32(6)} µs, p99 {u32(8)} µs, max {u32(10)} µs, ramek {u32(12)}")
+        self.check(regs[0] == 1, "Ramki obsługuje task RTU")
+
+    def check_host_stats(self, stats):
+        crc = stats.get("crc_errors", -1)
+        frame = stats.get("frame_errors", -1)
+        self.check(crc >= self.injected_crc, f"Licznik błędów CRC {crc} (wstrzyknięto {self.injected_crc})")
+        self.check(frame >= self.injected_frame,
+                   f"Licznik błędów ramki {frame} (wstrzyknięto {self.injected_frame})")
+
+    def run(self):
+        self.test_latency()
+        self.test_poll_rate()
+        self.test_noise()
+        self.test_device_latency()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="ESP32 Modbus RTU benchmark")
+    target = parser.add_mutually_exclusive_group(required=True)
+    target.add_argument("--port", help="Port szeregowy urządzenia lub pty slave'a")
+    target.add_argument("--host-binary", help="Uruchom slave hostowy (modbus_rtu_host) i testuj przez pty")
+    parser.add_argument("--baud", type=int, default=38400, help="MODBUS_BAUD (pty: bez znaczenia)")
+    parser.add_argument("--loop-ms", type=int, default=10, help="Okres loop() slave'a hostowego")
+    parser.add_argument("--rounds", type=int, default=500, help="Żądania na pomiar")
+    parser.add_argument("--duration", type=float, default=3.0, help="Czas pomiaru częstotliwości [s]")
+    parser.add_argument("--noise-every", type=int, default=5, help="Co która ramka uszkodzona w ruchu z szumem")
+    parser.add_argument("--silence-ms", type=float, default=50.0, help="Czas czekania na (brak) odpowiedzi")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--max-p99-ms", type=float, help="Próg p99 opóźnienia (CI)")
+    parser.add_argument("--min-rate", type=float, help="Minimalna częstotliwość odpytywania [żądań/s] (CI)")
+    args = parser.parse_args()
+
+    host = None
+    client = None
+    try:
+        if args.host_binary:
+            host = HostSlave(args.host_binary, args.loop_ms)
+            args.port = host.path
+        print(f"🔌 Modbus RTU {args.port} (slave {SLAVE_ID}{', build hostowy' if host else f', {args.baud} bod'})")
+        client = RawModbusRtu(args.port, args.baud)
+        bench = Benchmark(args, client)
+        bench.run()
+        if host:
+            client.close()
+            client = None
+            stats, _ = host.stop()
+            host = None
+            bench.check_host_stats(stats)
+    except (OSError, ModbusRtuError, subprocess.TimeoutExpired) as e:
+        print(f"❌ {e}")
+        sys.exit(1)
+    finally:
+        if client:
+            client.close()
+        if host:
+            host.process.kill()
+
+    print(f"\n{'✅ Wszystkie testy OK' if bench.failures == 0 else f'❌ Błędy: {bench.failures}'}")
+    sys.exit(0 if bench.failures == 0 else 1)
+
+
+if __name__ == "__main__":
+    main()
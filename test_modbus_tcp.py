@@ -0,0 +1,270 @@
+#!/usr/bin/env python3
+"""
+Test serwera Modbus TCP (port 502) ESP Sensor Cube
+Użycie: python test_modbus_tcp.py IP_ADDRESS [--port 502] [--clients 4] [--rounds 50]
+        python test_modbus_tcp.py 127.0.0.1 --port 5020 --host-build   (host/modbus_tcp_host.cpp)
+Sprawdza odczyt całej mapy, pipelining, równoległe połączenia, wyjątki i ramki dzielone na segmenty.
+Z zainstalowanym pymodbus dodatkowo porównuje odczyt klienta pymodbus.
+"""
+
+import argparse
+import socket
+import statistics
+import struct
+import sys
+import threading
+import time
+
+TOTAL_REGISTERS = 732        # MODBUS_REG_TOTAL (modbus_map.h)
+MAX_READ = 125
+UNIT_ID = 30                 # MODBUS_SLAVE_ID - serwer TCP akceptuje dowolny
+
+
+class ModbusTcpError(Exception):
+    pass
+
+
+class RawModbusTcp:
+    """Minimalny klient Modbus TCP na gniazdach - pozwala wysłać kilka żądań bez czekania"""
+
+    def __init__(self, host, port, timeout=5.0):
+        self.sock = socket.create_connection((host, port), timeout=timeout)
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.transaction = 0
+
+    def close(self):
+        self.sock.close()
+
+    def frame(self, pdu):
+        self.transaction = (self.transaction + 1) & 0xFFFF
+        return self.transaction, struct.pack(">HHHB", self.transaction, 0, len(pdu) + 1, UNIT_ID) + pdu
+
+    def recv_exact(self, length):
+        data = b""
+        while len(data) < length:
+            chunk = self.sock.recv(length - len(data))
+            if not chunk:
+                raise ModbusTcpError("Połączenie zamknięte przez serwer")
+            data += chunk
+        return data
+
+    def recv_response(self):
+        transaction, protocol, length, unit = struct.unpack(">HHHB", self.recv_exact(7))
+        if protocol != 0:
+            raise ModbusTcpError(f"Zły protocol id: {protocol}")
+        return transaction, self.recv_exact(length - 1)
+
+    @staticmethod
+    def read_pdu(start, count):
+        return struct.pack(">BHH", 0x03, start, count)
+
+    @staticmethod
+    def parse_read(pdu):
+        if pdu[0] & 0x80:
+            raise ModbusTcpError(f"Wyjątek {pdu[1]:#04x}")
+        return list(struct.unpack(f">{pdu[1] // 2}H", pdu[2:2 + pdu[1]]))
+
+    def request(self, pdu):
+        transaction, data = self.frame(pdu)
+        self.sock.sendall(data)
+        reply_transaction, reply = self.recv_response()
+        if reply_transaction != transaction:
+            raise ModbusTcpError(f"Transakcja {reply_transaction} zamiast {transaction}")
+        return reply
+
+    def read(self, start, count):
+        return self.parse_read(self.request(self.read_pdu(start, count)))
+
+    def read_map_sequential(self):
+        values = []
+        for start in range(0, TOTAL_REGISTERS, MAX_READ):
+            values += self.read(start, min(MAX_READ, TOTAL_REGISTERS - start))
+        return values
+
+    def read_map_pipelined(self):
+        """Wszystkie żądania mapy w jednym segmencie, odpowiedzi dopasowane po transaction id"""
+        pending = {}
+        batch = b""
+        for start in range(0, TOTAL_REGISTERS, MAX_READ):
+            transaction, data = self.frame(self.read_pdu(start, min(MAX_READ, TOTAL_REGISTERS - start)))
+            pending[transaction] = start
+            batch += data
+        self.sock.sendall(batch)
+
+        blocks = {}
+        while pending:
+            transaction, pdu = self.recv_response()
+            if transaction not in pending:
+                raise ModbusTcpError(f"Nieoczekiwana transakcja {transaction}")
+            blocks[pending.pop(transaction)] = self.parse_read(pdu)
+        return [value for start in sorted(blocks) for value in blocks[start]]
+
+
+def timed(function, rounds):
+    times = []
+    result = None
+    for _ in range(rounds):
+        start = time.perf_counter()
+        result = function()
+        times.append((time.perf_counter() - start) * 1000)
+    return result, times
+
+
+def summary(times):
+    ordered = sorted(times)
+    p99 = ordered[min(len(ordered) - 1, int(len(ordered) * 0.99))]
+    return f"mediana {statistics.median(times):.2f} ms, p99 {p99:.2f} ms, max {max(times):.2f} ms"
+
+
+class TestRunner:
+    def __init__(self, args):
+        self.args = args
+        self.failures = 0
+
+    def check(self, condition, message):
+        print(f"{'✅' if condition else '❌'} {message}")
+        if not condition:
+            self.failures += 1
+
+    def connect(self):
+        return RawModbusTcp(self.args.ip, self.args.port)
+
+    def test_full_map(self):
+        client = self.connect()
+        try:
+            values, times = timed(client.read_map_sequential, self.args.rounds)
+            self.check(len(values) == TOTAL_REGISTERS, f"Mapa sekwencyjnie: {len(values)} rejestrów, {summary(times)}")
+            piped, times = timed(client.read_map_pipelined, self.args.rounds)
+            self.check(len(piped) == TOTAL_REGISTERS, f"Mapa z pipeliningiem: {summary(times)}")
+            if self.args.host_build:
+                self.check(values == list(range(TOTAL_REGISTERS)), "Wartości = adresy (build hostowy)")
+                self.check(piped == values, "Pipelining zwraca te same dane")
+        finally:
+            client.close()
+
+    def test_concurrent(self):
+        results = []
+        errors = []
+
+        def worker():
+            try:
+                client = self.connect()
+                _, times = timed(client.read_map_pipelined, self.args.rounds)
+                client.close()
+                results.append(times)
+            except Exception as e:
+                errors.append(str(e))
+
+        threads = [threading.Thread(target=worker) for _ in range(self.args.clients)]
+        start = time.perf_counter()
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        elapsed = time.perf_counter() - start
+
+        maps = len(results) * self.args.rounds
+        self.check(not errors, f"{self.args.clients} klientów równolegle: {maps} map w {elapsed:.2f} s "
+                               f"({maps / elapsed:.0f} map/s){'; ' + errors[0] if errors else ''}")
+        if results:
+            print(f"   {summary([t for times in results for t in times])}")
+
+    def test_exceptions(self):
+        client = self.connect()
+        try:
+            cases = [
+                (RawModbusTcp.read_pdu(TOTAL_REGISTERS - 1, 2), 0x02, "odczyt poza mapą"),
+                (RawModbusTcp.read_pdu(0, MAX_READ + 1), 0x03, "za dużo rejestrów"),
+                (struct.pack(">BHH", 0x2B, 0, 0), 0x01, "nieobsługiwana funkcja"),
+            ]
+            for pdu, expected, name in cases:
+                reply = client.request(pdu)
+                ok = reply[0] == (pdu[0] | 0x80) and reply[1] == expected
+                self.check(ok, f"Wyjątek {expected:#04x}: {name}")
+            # Połączenie działa dalej po wyjątkach
+            self.check(len(client.read(0, 4)) == 4, "Odczyt po wyjątkach")
+        finally:
+            client.close()
+
+    def test_fragmented(self):
+        client = self.connect()
+        try:
+            transaction, data = client.frame(RawModbusTcp.read_pdu(0, 10))
+            for byte in data:
+                client.sock.sendall(bytes([byte]))
+                time.sleep(0.002)
+            reply_transaction, pdu = client.recv_response()
+            self.check(reply_transaction == transaction and len(RawModbusTcp.parse_read(pdu)) == 10,
+                       "Ramka dzielona na pojedyncze bajty")
+        finally:
+            client.close()
+
+    def test_write(self):
+        address = self.args.write_address
+        client = self.connect()
+        try:
+            client.request(struct.pack(">BHH", 0x06, address, 0x1234))
+            self.check(client.read(address, 1) == [0x1234], f"FC06 + odczyt rejestru {address}")
+            values = [0xA000 + i for i in range(4)]
+            client.request(struct.pack(">BHHB4H", 0x10, address, 4, 8, *values))
+            self.check(client.read(address, 4) == values, f"FC16 + odczyt rejestrów {address}-{address + 3}")
+        finally:
+            client.close()
+
+    def test_pymodbus(self):
+        try:
+            from pymodbus.client import ModbusTcpClient
+        except ImportError:
+            print("ℹ️  pymodbus niedostępny - pominięto test zgodności")
+            return
+
+        client = ModbusTcpClient(self.args.ip, port=self.args.port)
+        if not client.connect():
+            self.check(False, "pymodbus: brak połączenia")
+            return
+        try:
+            try:
+                reply = client.read_holding_registers(0, count=MAX_READ, device_id=UNIT_ID)
+            except TypeError:
+                reply = client.read_holding_registers(0, count=MAX_READ, slave=UNIT_ID)
+            self.check(not reply.isError() and len(reply.registers) == MAX_READ, "pymodbus: odczyt 125 rejestrów")
+            if self.args.host_build and not reply.isError():
+                self.check(reply.registers == list(range(MAX_READ)), "pymodbus: wartości = adresy")
+        finally:
+            client.close()
+
+    def run(self):
+        print(f"🔌 Modbus TCP {self.args.ip}:{self.args.port}")
+        self.test_full_map()
+        self.test_concurrent()
+        self.test_exceptions()
+        self.test_fragmented()
+        if self.args.host_build or self.args.write_test:
+            self.test_write()
+        self.test_pymodbus()
+        print(f"\n{'✅ Wszystkie testy OK' if self.failures == 0 else f'❌ Błędy: {self.failures}'}")
+        return self.failures == 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="ESP32 Modbus TCP tester")
+    parser.add_argument("ip", help="Adres IP urządzenia")
+    parser.add_argument("--port", type=int, default=502)
+    parser.add_argument("--clients", type=int, default=4, help="Równoległe połączenia (ESP32: max 4)")
+    parser.add_argument("--rounds", type=int, default=50, help="Odczyty mapy na test")
+    parser.add_argument("--host-build", action="store_true", help="Serwer hostowy: rejestr N = N, test zapisu")
+    parser.add_argument("--write-test", action="store_true", help="Test zapisu FC06/FC16 na urządzeniu")
+    parser.add_argument("--write-address", type=int, default=650,
+                        help="Rejestr do testu zapisu (domyślnie 650 - poza rejestrami kontrolnymi)")
+    args = parser.parse_args()
+
+    try:
+        ok = TestRunner(args).run()
+    except (OSError, ModbusTcpError) as e:
+        print(f"❌ {e}")
+        sys.exit(1)
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == "__main__":
+    main()
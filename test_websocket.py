@@ -2,6 +2,8 @@
 """
 Test WebSocket dla ESP Sensor Cube
 Użycie: python test_websocket.py [IP_ADDRESS]
+        python test_websocket.py IP_ADDRESS --stream SENSOR [OPÓŹNIENIE_MS]
+          (pomiar strumienia historii autoMode; OPÓŹNIENIE_MS symuluje wolnego klienta)
 """
 
 import asyncio
@@ -244,6 +246,66 @@ class ESPWebSocketTester:
         
         print(f"📊 Odebrano {message_count} wiadomości w {duration}s")
     
+    async def measure_history_stream(self, sensor="sht40", time_range="24h", read_delay_ms=0, timeout=120):
+        """Pomiar strumienia historii (autoMode) - tempo pakietów i przepustowość.
+        read_delay_ms > 0 symuluje wolnego klienta (serwer powinien zwolnić, nie zapchać kolejki)."""
+        print(f"\n📶 Test: Strumień historii {sensor} ({time_range}), opóźnienie odczytu {read_delay_ms}ms")
+        
+        await self.websocket.send(json.dumps({
+            "cmd": "getHistory",
+            "sensor": sensor,
+            "timeRange": time_range,
+            "sampleType": "fast"
+        }))
+        
+        start = time.time()
+        arrivals = []
+        received = set()
+        total_bytes = 0
+        total_packets = None
+        
+        while time.time() - start < timeout:
+            try:
+                raw = await asyncio.wait_for(self.websocket.recv(), timeout=20.0)
+            except asyncio.TimeoutError:
+                print("❌ Brak pakietów przez 20s - strumień zatrzymany")
+                break
+            except websockets.ConnectionClosed as e:
+                print(f"❌ Serwer zamknął połączenie: {e.code} {e.reason}")
+                break
+            
+            data = json.loads(raw)
+            if data.get('cmd') != 'history' or data.get('sensor') != sensor:
+                continue
+            
+            arrivals.append(time.time())
+            total_bytes += len(raw)
+            received.add(data.get('packetIndex', 0))
+            total_packets = data.get('totalPackets', 1)
+            
+            if read_delay_ms > 0:
+                await asyncio.sleep(read_delay_ms / 1000.0)
+            
+            if len(received) >= total_packets:
+                break
+        
+        elapsed = (arrivals[-1] - start) if arrivals else 0
+        gaps = [b - a for a, b in zip(arrivals, arrivals[1:])]
+        print(f"📦 Pakiety: {len(received)}/{total_packets}, {total_bytes} bajtów w {elapsed:.2f}s")
+        if elapsed > 0:
+            print(f"📈 Przepustowość: {total_bytes / elapsed:.0f} B/s, {len(arrivals) / elapsed:.1f} pakietów/s")
+        if gaps:
+            gaps.sort()
+            print(f"⏱️ Odstępy: min {gaps[0] * 1000:.0f}ms, mediana {gaps[len(gaps) // 2] * 1000:.0f}ms, max {gaps[-1] * 1000:.0f}ms")
+        
+        status = await self.send_command({"cmd": "getWebSocketStatus"})
+        if status and 'status' in status:
+            for line in status['status'].splitlines():
+                if 'History streams' in line or line.strip().startswith('*'):
+                    print(f"   {line.strip()}")
+        
+        return len(received), total_packets
+
     async def run_all_tests(self):
         """Uruchomienie wszystkich testów"""
         print("🚀 Rozpoczęcie testów WebSocket ESP Sensor Cube")
@@ -296,6 +358,19 @@ async def main():
     print("=" * 50)
     
     tester = ESPWebSocketTester(ip_address)
+    
+    if "--stream" in sys.argv:
+        idx = sys.argv.index("--stream")
+        sensor = sys.argv[idx + 1] if len(sys.argv) > idx + 1 else "sht40"
+        delay_ms = int(sys.argv[idx + 2]) if len(sys.argv) > idx + 2 else 0
+        if await tester.connect():
+            try:
+                await asyncio.sleep(1)
+                await tester.measure_history_stream(sensor, read_delay_ms=delay_ms)
+            finally:
+                await tester.websocket.close()
+        return
+    
     await tester.run_all_tests()
 
 if __name__ == "__main__":